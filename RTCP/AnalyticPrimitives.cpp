@@ -0,0 +1,323 @@
+#include "AnalyticPrimitives.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <emmintrin.h>
+
+AnalyticPrimitives::Primitive AnalyticPrimitives::CreateSphere(const float center[3], float radius)
+{
+	assert(radius > 0.0f && "Sphere radius has to be positive");
+	Primitive primitive = {};
+	primitive.type = Type::Sphere;
+	std::copy(center, center + 3, primitive.center);
+	primitive.extents[0] = radius;
+	primitive.extents[1] = radius;
+	primitive.extents[2] = radius;
+	return primitive;
+}
+
+AnalyticPrimitives::Primitive AnalyticPrimitives::CreateBox(const float center[3], const float halfSize[3])
+{
+	assert(halfSize[0] >= 0.0f && halfSize[1] >= 0.0f && halfSize[2] >= 0.0f && "Box size can't be negative");
+	Primitive primitive = {};
+	primitive.type = Type::Box;
+	std::copy(center, center + 3, primitive.center);
+	std::copy(halfSize, halfSize + 3, primitive.extents);
+	return primitive;
+}
+
+AnalyticPrimitives::Primitive AnalyticPrimitives::CreateDisk(const float center[3], const float normal[3], float radius)
+{
+	assert(radius > 0.0f && "Disk radius has to be positive");
+	const float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+	assert(length > 0.0f && "Disk normal can't be zero");
+	Primitive primitive = {};
+	primitive.type = Type::Disk;
+	std::copy(center, center + 3, primitive.center);
+	primitive.extents[0] = radius;
+	primitive.extents[1] = radius;
+	primitive.extents[2] = radius;
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		primitive.normal[axis] = normal[axis] / length;
+	}
+	return primitive;
+}
+
+AnalyticPrimitives::Bounds AnalyticPrimitives::GetBounds(const Primitive& primitive)
+{
+	Bounds bounds;
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		// Disk is flat along its normal, circle extent along axis is radius * sin of angle between axis and normal
+		float extent = primitive.extents[axis];
+		if (primitive.type == Type::Disk) {
+			extent = primitive.extents[0] * std::sqrt(std::max(1.0f - primitive.normal[axis] * primitive.normal[axis], 0.0f));
+		}
+		bounds.minimum[axis] = primitive.center[axis] - extent;
+		bounds.maximum[axis] = primitive.center[axis] + extent;
+	}
+	return bounds;
+}
+
+bool AnalyticPrimitives::Intersect(const Primitive& primitive, const float origin[3], const float direction[3], float tMin, float tMax, float& distance)
+{
+	const float offset[3] = { origin[0] - primitive.center[0], origin[1] - primitive.center[1], origin[2] - primitive.center[2] };
+	float t = 0.0f;
+	switch (primitive.type)
+	{
+	case Type::Sphere:
+	{
+		const float radius = primitive.extents[0];
+		const float a = direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2];
+		const float b = offset[0] * direction[0] + offset[1] * direction[1] + offset[2] * direction[2];
+		const float c = offset[0] * offset[0] + offset[1] * offset[1] + offset[2] * offset[2] - radius * radius;
+		const float discriminant = b * b - a * c;
+		if (discriminant < 0.0f) {
+			return false;
+		}
+		// Near root first, far one if origin is inside sphere or near root is behind tMin
+		const float root = std::sqrt(discriminant);
+		t = (-b - root) / a;
+		if (t <= tMin) {
+			t = (-b + root) / a;
+		}
+		break;
+	}
+	case Type::Box:
+	{
+		float entry = -INFINITY;
+		float exit = INFINITY;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			const float inverseDirection = 1.0f / direction[axis];
+			float t0 = (-primitive.extents[axis] - offset[axis]) * inverseDirection;
+			float t1 = (primitive.extents[axis] - offset[axis]) * inverseDirection;
+			if (t0 > t1) {
+				std::swap(t0, t1);
+			}
+			// Ray parallel to slab and outside of it gives NaN or infinite interval, comparisons below reject it
+			entry = std::max(entry, t0);
+			exit = std::min(exit, t1);
+		}
+		if (!(entry <= exit)) {
+			return false;
+		}
+		t = entry > tMin ? entry : exit;
+		break;
+	}
+	case Type::Disk:
+	{
+		const float* normal = primitive.normal;
+		const float denominator = normal[0] * direction[0] + normal[1] * direction[1] + normal[2] * direction[2];
+		if (std::fabs(denominator) < PARALLEL_EPSILON) {
+			return false;
+		}
+		t = -(normal[0] * offset[0] + normal[1] * offset[1] + normal[2] * offset[2]) / denominator;
+		const float hit[3] = { offset[0] + t * direction[0], offset[1] + t * direction[1], offset[2] + t * direction[2] };
+		if (hit[0] * hit[0] + hit[1] * hit[1] + hit[2] * hit[2] > primitive.extents[0] * primitive.extents[0]) {
+			return false;
+		}
+		break;
+	}
+	default:
+		assert(false && "Unknown primitive type");
+		return false;
+	}
+
+	if (!(t > tMin && t < tMax)) {
+		return false;
+	}
+	distance = t;
+	return true;
+}
+
+int AnalyticPrimitives::Intersect4(const Primitive& primitive, const RayPacket& rays, float tMin, float distance[4])
+{
+	switch (primitive.type)
+	{
+	case Type::Sphere:
+		return IntersectSphere4(primitive, rays, tMin, distance);
+	case Type::Box:
+		return IntersectBox4(primitive, rays, tMin, distance);
+	case Type::Disk:
+		return IntersectDisk4(primitive, rays, tMin, distance);
+	default:
+		assert(false && "Unknown primitive type");
+		return 0;
+	}
+}
+
+int AnalyticPrimitives::IntersectSphere4(const Primitive& primitive, const RayPacket& rays, float tMin, float distance[4])
+{
+	const __m128 offsetX = _mm_sub_ps(_mm_load_ps(rays.originX), _mm_set1_ps(primitive.center[0]));
+	const __m128 offsetY = _mm_sub_ps(_mm_load_ps(rays.originY), _mm_set1_ps(primitive.center[1]));
+	const __m128 offsetZ = _mm_sub_ps(_mm_load_ps(rays.originZ), _mm_set1_ps(primitive.center[2]));
+	const __m128 directionX = _mm_load_ps(rays.directionX);
+	const __m128 directionY = _mm_load_ps(rays.directionY);
+	const __m128 directionZ = _mm_load_ps(rays.directionZ);
+
+	const __m128 a = _mm_add_ps(_mm_add_ps(_mm_mul_ps(directionX, directionX), _mm_mul_ps(directionY, directionY)), _mm_mul_ps(directionZ, directionZ));
+	const __m128 b = _mm_add_ps(_mm_add_ps(_mm_mul_ps(offsetX, directionX), _mm_mul_ps(offsetY, directionY)), _mm_mul_ps(offsetZ, directionZ));
+	const __m128 c = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(offsetX, offsetX), _mm_mul_ps(offsetY, offsetY)), _mm_mul_ps(offsetZ, offsetZ)),
+		_mm_set1_ps(primitive.extents[0] * primitive.extents[0]));
+	const __m128 discriminant = _mm_sub_ps(_mm_mul_ps(b, b), _mm_mul_ps(a, c));
+	const __m128 root = _mm_sqrt_ps(_mm_max_ps(discriminant, _mm_setzero_ps()));
+	const __m128 near = _mm_div_ps(_mm_sub_ps(_mm_sub_ps(_mm_setzero_ps(), b), root), a);
+	const __m128 far = _mm_div_ps(_mm_sub_ps(root, b), a);
+
+	// Same root selection as scalar version, without branches
+	const __m128 minimum = _mm_set1_ps(tMin);
+	const __m128 maximum = _mm_loadu_ps(distance);
+	const __m128 useNear = _mm_cmpgt_ps(near, minimum);
+	const __m128 t = _mm_or_ps(_mm_and_ps(useNear, near), _mm_andnot_ps(useNear, far));
+	const __m128 hit = _mm_and_ps(_mm_cmpge_ps(discriminant, _mm_setzero_ps()), _mm_and_ps(_mm_cmpgt_ps(t, minimum), _mm_cmplt_ps(t, maximum)));
+	_mm_storeu_ps(distance, _mm_or_ps(_mm_and_ps(hit, t), _mm_andnot_ps(hit, maximum)));
+	return _mm_movemask_ps(hit);
+}
+
+int AnalyticPrimitives::IntersectBox4(const Primitive& primitive, const RayPacket& rays, float tMin, float distance[4])
+{
+	const float* origins[3] = { rays.originX, rays.originY, rays.originZ };
+	const float* directions[3] = { rays.directionX, rays.directionY, rays.directionZ };
+	__m128 entry = _mm_set1_ps(-INFINITY);
+	__m128 exit = _mm_set1_ps(INFINITY);
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		const __m128 inverseDirection = _mm_div_ps(_mm_set1_ps(1.0f), _mm_load_ps(directions[axis]));
+		const __m128 offset = _mm_sub_ps(_mm_load_ps(origins[axis]), _mm_set1_ps(primitive.center[axis]));
+		const __m128 extent = _mm_set1_ps(primitive.extents[axis]);
+		const __m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_sub_ps(_mm_setzero_ps(), extent), offset), inverseDirection);
+		const __m128 t1 = _mm_mul_ps(_mm_sub_ps(extent, offset), inverseDirection);
+		// NaN of ray lying in slab plane is dropped by min/max, which return their second operand for it
+		entry = _mm_max_ps(_mm_min_ps(t0, t1), entry);
+		exit = _mm_min_ps(_mm_max_ps(t0, t1), exit);
+	}
+
+	const __m128 minimum = _mm_set1_ps(tMin);
+	const __m128 maximum = _mm_loadu_ps(distance);
+	const __m128 useEntry = _mm_cmpgt_ps(entry, minimum);
+	const __m128 t = _mm_or_ps(_mm_and_ps(useEntry, entry), _mm_andnot_ps(useEntry, exit));
+	const __m128 hit = _mm_and_ps(_mm_cmple_ps(entry, exit), _mm_and_ps(_mm_cmpgt_ps(t, minimum), _mm_cmplt_ps(t, maximum)));
+	_mm_storeu_ps(distance, _mm_or_ps(_mm_and_ps(hit, t), _mm_andnot_ps(hit, maximum)));
+	return _mm_movemask_ps(hit);
+}
+
+int AnalyticPrimitives::IntersectDisk4(const Primitive& primitive, const RayPacket& rays, float tMin, float distance[4])
+{
+	const __m128 offsetX = _mm_sub_ps(_mm_load_ps(rays.originX), _mm_set1_ps(primitive.center[0]));
+	const __m128 offsetY = _mm_sub_ps(_mm_load_ps(rays.originY), _mm_set1_ps(primitive.center[1]));
+	const __m128 offsetZ = _mm_sub_ps(_mm_load_ps(rays.originZ), _mm_set1_ps(primitive.center[2]));
+	const __m128 directionX = _mm_load_ps(rays.directionX);
+	const __m128 directionY = _mm_load_ps(rays.directionY);
+	const __m128 directionZ = _mm_load_ps(rays.directionZ);
+	const __m128 normalX = _mm_set1_ps(primitive.normal[0]);
+	const __m128 normalY = _mm_set1_ps(primitive.normal[1]);
+	const __m128 normalZ = _mm_set1_ps(primitive.normal[2]);
+
+	const __m128 denominator = _mm_add_ps(_mm_add_ps(_mm_mul_ps(normalX, directionX), _mm_mul_ps(normalY, directionY)), _mm_mul_ps(normalZ, directionZ));
+	const __m128 numerator = _mm_add_ps(_mm_add_ps(_mm_mul_ps(normalX, offsetX), _mm_mul_ps(normalY, offsetY)), _mm_mul_ps(normalZ, offsetZ));
+	const __m128 t = _mm_div_ps(_mm_sub_ps(_mm_setzero_ps(), numerator), denominator);
+	const __m128 hitX = _mm_add_ps(offsetX, _mm_mul_ps(t, directionX));
+	const __m128 hitY = _mm_add_ps(offsetY, _mm_mul_ps(t, directionY));
+	const __m128 hitZ = _mm_add_ps(offsetZ, _mm_mul_ps(t, directionZ));
+	const __m128 hitDistanceSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(hitX, hitX), _mm_mul_ps(hitY, hitY)), _mm_mul_ps(hitZ, hitZ));
+
+	const __m128 minimum = _mm_set1_ps(tMin);
+	const __m128 maximum = _mm_loadu_ps(distance);
+	const __m128 absoluteMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+	const __m128 notParallel = _mm_cmpge_ps(_mm_and_ps(denominator, absoluteMask), _mm_set1_ps(PARALLEL_EPSILON));
+	const __m128 inside = _mm_cmple_ps(hitDistanceSquared, _mm_set1_ps(primitive.extents[0] * primitive.extents[0]));
+	const __m128 hit = _mm_and_ps(_mm_and_ps(notParallel, inside), _mm_and_ps(_mm_cmpgt_ps(t, minimum), _mm_cmplt_ps(t, maximum)));
+	_mm_storeu_ps(distance, _mm_or_ps(_mm_and_ps(hit, t), _mm_andnot_ps(hit, maximum)));
+	return _mm_movemask_ps(hit);
+}
+
+AnalyticPrimitives::SurfaceAttributes AnalyticPrimitives::GetSurfaceAttributes(const Primitive& primitive, const float position[3])
+{
+	const float pi = 3.14159265f;
+	const float local[3] = { position[0] - primitive.center[0], position[1] - primitive.center[1], position[2] - primitive.center[2] };
+	SurfaceAttributes attributes = {};
+	switch (primitive.type)
+	{
+	case Type::Sphere:
+	{
+		// Longitude along U around Y axis, latitude along V from +Y pole
+		const float length = std::sqrt(local[0] * local[0] + local[1] * local[1] + local[2] * local[2]);
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			attributes.normal[axis] = length > 0.0f ? local[axis] / length : (axis == 1 ? 1.0f : 0.0f);
+		}
+		attributes.uv[0] = std::atan2(attributes.normal[2], attributes.normal[0]) / (2.0f * pi) + 0.5f;
+		attributes.uv[1] = std::acos(std::min(std::max(attributes.normal[1], -1.0f), 1.0f)) / pi;
+		const float ringRadius = std::sqrt(attributes.normal[0] * attributes.normal[0] + attributes.normal[2] * attributes.normal[2]);
+		if (ringRadius > 1e-6f)
+		{
+			attributes.tangent[0] = -attributes.normal[2] / ringRadius;
+			attributes.tangent[2] = attributes.normal[0] / ringRadius;
+		}
+		else {
+			// Poles have no longitude direction
+			attributes.tangent[0] = 1.0f;
+		}
+		break;
+	}
+	case Type::Box:
+	{
+		// Face is picked by the axis closest to the surface relative to box size, U and V follow the remaining two axes
+		int faceAxis = 0;
+		float faceCoordinate = -1.0f;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			const float coordinate = primitive.extents[axis] > 0.0f ? std::fabs(local[axis]) / primitive.extents[axis] : 1.0f;
+			if (coordinate > faceCoordinate)
+			{
+				faceCoordinate = coordinate;
+				faceAxis = axis;
+			}
+		}
+		const float sign = local[faceAxis] < 0.0f ? -1.0f : 1.0f;
+		const int uAxis = (faceAxis + 1) % 3;
+		const int vAxis = (faceAxis + 2) % 3;
+		attributes.normal[faceAxis] = sign;
+		attributes.tangent[uAxis] = sign;
+		attributes.uv[0] = primitive.extents[uAxis] > 0.0f ? (sign * local[uAxis] / primitive.extents[uAxis]) * 0.5f + 0.5f : 0.5f;
+		attributes.uv[1] = primitive.extents[vAxis] > 0.0f ? (local[vAxis] / primitive.extents[vAxis]) * 0.5f + 0.5f : 0.5f;
+		break;
+	}
+	case Type::Disk:
+	{
+		std::copy(primitive.normal, primitive.normal + 3, attributes.normal);
+		BuildBasis(primitive.normal, attributes.tangent, attributes.binormal);
+		const float radius = primitive.extents[0];
+		const float u = local[0] * attributes.tangent[0] + local[1] * attributes.tangent[1] + local[2] * attributes.tangent[2];
+		const float v = local[0] * attributes.binormal[0] + local[1] * attributes.binormal[1] + local[2] * attributes.binormal[2];
+		attributes.uv[0] = u / (2.0f * radius) + 0.5f;
+		attributes.uv[1] = v / (2.0f * radius) + 0.5f;
+		break;
+	}
+	default:
+		assert(false && "Unknown primitive type");
+		break;
+	}
+
+	const float* n = attributes.normal;
+	const float* t = attributes.tangent;
+	attributes.binormal[0] = n[1] * t[2] - n[2] * t[1];
+	attributes.binormal[1] = n[2] * t[0] - n[0] * t[2];
+	attributes.binormal[2] = n[0] * t[1] - n[1] * t[0];
+	return attributes;
+}
+
+void AnalyticPrimitives::BuildBasis(const float normal[3], float tangent[3], float binormal[3])
+{
+	const float sign = std::copysign(1.0f, normal[2]);
+	const float a = -1.0f / (sign + normal[2]);
+	const float b = normal[0] * normal[1] * a;
+	tangent[0] = 1.0f + sign * normal[0] * normal[0] * a;
+	tangent[1] = sign * b;
+	tangent[2] = -sign * normal[0];
+	binormal[0] = b;
+	binormal[1] = sign + normal[1] * normal[1] * a;
+	binormal[2] = -normal[1];
+}
@@ -0,0 +1,74 @@
+#pragma once
+#ifndef _ANALYTIC_PRIMITIVES_H_
+#define _ANALYTIC_PRIMITIVES_H_
+
+#include <cstddef>
+#include <cstdint>
+
+// Exact ray intersection of analytic shapes, compared with tessellated meshes on CPU. Doesn't depend on Windows or D3D12 headers, like MeshOptimizer.
+// Primitives are defined in model space - box is axis aligned, rotation comes from instance transform like for triangle meshes.
+class AnalyticPrimitives
+{
+public:
+	enum class Type : uint32_t
+	{
+		Sphere = 0,
+		Box = 1,
+		Disk = 2
+	};
+
+	// 16 byte aligned size, so primitives can be uploaded as structured buffer
+	struct Primitive {
+		Type type;
+		float center[3];
+		float extents[3];		// Sphere and disk - radius in x, box - half size along every axis
+		float normal[3];		// Disk only, unit length
+		float padding[2];
+	};
+
+	// Same layout as D3D12_RAYTRACING_AABB, for procedural BLAS geometry
+	struct Bounds {
+		float minimum[3];
+		float maximum[3];
+	};
+
+	// Normal points out of the surface (disk normal is normal of its plane), tangent follows U and binormal is cross(normal, tangent)
+	struct SurfaceAttributes {
+		float normal[3];
+		float tangent[3];
+		float binormal[3];
+		float uv[2];
+	};
+
+	// Four rays in structure of arrays layout, intersected together with SSE
+	struct alignas(16) RayPacket {
+		float originX[4];
+		float originY[4];
+		float originZ[4];
+		float directionX[4];
+		float directionY[4];
+		float directionZ[4];
+	};
+
+	static Primitive CreateSphere(const float center[3], float radius);
+	static Primitive CreateBox(const float center[3], const float halfSize[3]);
+	static Primitive CreateDisk(const float center[3], const float normal[3], float radius);
+
+	static Bounds GetBounds(const Primitive& primitive);
+	// Closest intersection in (tMin, tMax) - direction doesn't have to be normalized, distance is in its units
+	static bool Intersect(const Primitive& primitive, const float origin[3], const float direction[3], float tMin, float tMax, float& distance);
+	// distance holds tMax of every ray on input and is replaced by distance of rays which hit - returns 4 bit mask of them
+	static int Intersect4(const Primitive& primitive, const RayPacket& rays, float tMin, float distance[4]);
+	static SurfaceAttributes GetSurfaceAttributes(const Primitive& primitive, const float position[3]);
+
+private:
+	static int IntersectSphere4(const Primitive& primitive, const RayPacket& rays, float tMin, float distance[4]);
+	static int IntersectBox4(const Primitive& primitive, const RayPacket& rays, float tMin, float distance[4]);
+	static int IntersectDisk4(const Primitive& primitive, const RayPacket& rays, float tMin, float distance[4]);
+	// Tangent and binormal perpendicular to unit normal (Duff et al. 2017)
+	static void BuildBasis(const float normal[3], float tangent[3], float binormal[3]);
+
+	static constexpr float PARALLEL_EPSILON = 1e-12f;
+};
+
+#endif // !_ANALYTIC_PRIMITIVES_H_
@@ -0,0 +1,39 @@
+#pragma once
+#ifndef _ARRAY_VIEW_H_
+#define _ARRAY_VIEW_H_
+
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+// Non-owning, read-only view of contiguous elements (std::span<const T> replacement, project is built as C++14).
+// View is valid as long as storage it points to isn't modified or released.
+template<typename T>
+class ArrayView
+{
+public:
+	ArrayView() = default;
+	ArrayView(const T* data, size_t size) : m_data(data), m_size(size) {}
+	ArrayView(const std::vector<T>& vector) : m_data(vector.data()), m_size(vector.size()) {}
+
+	const T* data() const { return m_data; }
+	size_t size() const { return m_size; }
+	size_t size_bytes() const { return sizeof(T) * m_size; }
+	bool empty() const { return m_size == 0; }
+
+	const T* begin() const { return m_data; }
+	const T* end() const { return m_data + m_size; }
+	const T& operator[](size_t index) const { assert(index < m_size && "ArrayView index out of range"); return m_data[index]; }
+
+	ArrayView subview(size_t offset, size_t count) const
+	{
+		assert(offset + count <= m_size && "ArrayView subview out of range");
+		return ArrayView(m_data + offset, count);
+	}
+
+private:
+	const T* m_data = nullptr;
+	size_t m_size = 0;
+};
+
+#endif // !_ARRAY_VIEW_H_
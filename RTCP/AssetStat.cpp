@@ -0,0 +1,526 @@
+// AssetStat.cpp - rtcp-assetstat entry point, headless JSON report of what a loaded model costs
+
+#include "pch.h"
+#include "AsyncFileReader.h"
+#include "DeviceManager.h"
+#include "ModelClass.h"
+#include "MeshCache.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+
+namespace
+{
+	// Streaming JSON writer - commas and indentation follow nesting, keys are omitted inside arrays
+	class JsonWriter
+	{
+	public:
+		explicit JsonWriter(std::ostream& stream) : m_stream(stream) {}
+
+		void BeginObject(const char* key = nullptr) { Open(key, '{'); }
+		void EndObject() { Close('}'); }
+		void BeginArray(const char* key = nullptr) { Open(key, '['); }
+		void EndArray() { Close(']'); }
+		void WriteString(const char* key, const std::string& value) { WriteKey(key); WriteQuoted(value); }
+		void WriteUInt(const char* key, UINT64 value) { WriteKey(key); m_stream << value; }
+		void WriteFloat(const char* key, double value) { WriteKey(key); m_stream << value; }
+		void WriteBool(const char* key, bool value) { WriteKey(key); m_stream << (value ? "true" : "false"); }
+		void WriteNull(const char* key) { WriteKey(key); m_stream << "null"; }
+
+	private:
+		void WriteKey(const char* key)
+		{
+			if (!m_scopeEmpty.empty())
+			{
+				m_stream << (m_scopeEmpty.back() ? "\n" : ",\n") << std::string(m_scopeEmpty.size(), '\t');
+				m_scopeEmpty.back() = false;
+			}
+			if (key)
+			{
+				WriteQuoted(key);
+				m_stream << ": ";
+			}
+		}
+
+		void Open(const char* key, char bracket)
+		{
+			WriteKey(key);
+			m_stream << bracket;
+			m_scopeEmpty.push_back(true);
+		}
+
+		void Close(char bracket)
+		{
+			const bool empty = m_scopeEmpty.back();
+			m_scopeEmpty.pop_back();
+			if (!empty) {
+				m_stream << '\n' << std::string(m_scopeEmpty.size(), '\t');
+			}
+			m_stream << bracket;
+			if (m_scopeEmpty.empty()) {
+				m_stream << '\n';
+			}
+		}
+
+		void WriteQuoted(const std::string& value)
+		{
+			m_stream << '"';
+			for (const char character : value)
+			{
+				if (character == '"' || character == '\\') {
+					m_stream << '\\' << character;
+				}
+				else if (static_cast<unsigned char>(character) < 0x20)
+				{
+					char escaped[8];
+					sprintf_s(escaped, "\\u%04x", character);
+					m_stream << escaped;
+				}
+				else {
+					m_stream << character;
+				}
+			}
+			m_stream << '"';
+		}
+
+		std::ostream& m_stream;
+		std::vector<bool> m_scopeEmpty;
+	};
+
+	// Texture file referenced by model, with every mesh and slot using it
+	struct TextureUse {
+		std::string path;
+		std::set<std::string> slots;
+		std::set<size_t> meshes;
+		ComPtr<ID3D12Resource> resource;
+	};
+
+	std::string GetFormatName(DXGI_FORMAT format)
+	{
+#define FORMAT_NAME(name) case DXGI_FORMAT_##name: return #name;
+		switch (format)
+		{
+		FORMAT_NAME(R8_UNORM)
+		FORMAT_NAME(R8G8_UNORM)
+		FORMAT_NAME(R8G8B8A8_UNORM)
+		FORMAT_NAME(R8G8B8A8_UNORM_SRGB)
+		FORMAT_NAME(B8G8R8A8_UNORM)
+		FORMAT_NAME(B8G8R8A8_UNORM_SRGB)
+		FORMAT_NAME(B8G8R8X8_UNORM)
+		FORMAT_NAME(R16G16B16A16_FLOAT)
+		FORMAT_NAME(R32G32B32A32_FLOAT)
+		FORMAT_NAME(R11G11B10_FLOAT)
+		FORMAT_NAME(BC1_UNORM)
+		FORMAT_NAME(BC1_UNORM_SRGB)
+		FORMAT_NAME(BC3_UNORM)
+		FORMAT_NAME(BC3_UNORM_SRGB)
+		FORMAT_NAME(BC4_UNORM)
+		FORMAT_NAME(BC5_UNORM)
+		FORMAT_NAME(BC5_SNORM)
+		FORMAT_NAME(BC6H_UF16)
+		FORMAT_NAME(BC7_UNORM)
+		FORMAT_NAME(BC7_UNORM_SRGB)
+		default: return "DXGI_FORMAT_" + std::to_string(static_cast<int>(format));
+		}
+#undef FORMAT_NAME
+	}
+
+	bool IsTextureFile(const std::string& path)
+	{
+		static const char* const extensions[] = { ".png", ".jpg", ".jpeg", ".tga", ".bmp", ".dds", ".hdr", ".tif", ".tiff" };
+		// Compressed copies written by TextureCompressor replace their source, they aren't separate textures
+		const std::string compressedSuffix = ".rtcp.dds";
+		if (path.size() >= compressedSuffix.size() && path.compare(path.size() - compressedSuffix.size(), compressedSuffix.size(), compressedSuffix) == 0) {
+			return false;
+		}
+		for (const char* extension : extensions)
+		{
+			const size_t length = strlen(extension);
+			if (path.size() >= length && path.compare(path.size() - length, length, extension) == 0) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Vertices which would remain after welding bit-identical ones - model is welded on import, so this shows what welding missed
+	size_t CountUniqueVertices(const ModelClass::Mesh& mesh)
+	{
+		std::vector<ModelClass::VertexBufferStruct> vertices(mesh.vertices.begin(), mesh.vertices.end());
+		std::vector<UINT32> indices(mesh.indices.begin(), mesh.indices.end());
+		for (UINT32& index : indices)
+		{
+			index -= mesh.baseVertex;
+		}
+		return MeshOptimizer::WeldVertices(vertices.data(), vertices.size(), sizeof(ModelClass::VertexBufferStruct), sizeof(ModelClass::VertexBufferStruct) / sizeof(float), 0.0f, indices.data(), indices.size());
+	}
+
+	void WriteGeometry(JsonWriter& json, const ModelClass& model)
+	{
+		const ArrayView<ModelClass::VertexBufferStruct> vertices = model.GetVertices();
+		const ArrayView<UINT32> indices = model.GetIndices();
+		const std::vector<ModelClass::MeshTexturePaths>& texturePaths = model.GetMeshTexturePaths();
+		json.WriteUInt("meshCount", model.GetMeshCount());
+		json.WriteUInt("vertexCount", vertices.size());
+		json.WriteUInt("indexCount", indices.size());
+		json.WriteUInt("triangleCount", indices.size() / 3);
+
+		size_t uniqueVertexCount = 0;
+		json.BeginArray("meshes");
+		for (size_t i = 0; i < model.GetMeshCount(); ++i)
+		{
+			const ModelClass::Mesh mesh = model.GetMesh(i);
+			const size_t meshUniqueVertexCount = CountUniqueVertices(mesh);
+			uniqueVertexCount += meshUniqueVertexCount;
+			json.BeginObject();
+			json.WriteUInt("index", i);
+			json.WriteUInt("vertexCount", mesh.vertices.size());
+			json.WriteUInt("indexCount", mesh.indices.size());
+			json.WriteUInt("uniqueVertexCount", meshUniqueVertexCount);
+			json.WriteFloat("duplicateVertexRatio", mesh.vertices.empty() ? 0.0 : 1.0 - static_cast<double>(meshUniqueVertexCount) / mesh.vertices.size());
+			json.WriteUInt("lodCount", model.GetMeshLodCount(i));
+			const std::pair<const char*, const std::string*> slots[] = { { "albedo", &texturePaths[i].albedo }, { "specular", &texturePaths[i].specular }, { "normal", &texturePaths[i].normal } };
+			for (const auto& slot : slots)
+			{
+				if (slot.second->empty()) {
+					json.WriteNull(slot.first);
+				}
+				else {
+					json.WriteString(slot.first, *slot.second);
+				}
+			}
+			json.EndObject();
+		}
+		json.EndArray();
+		json.WriteFloat("duplicateVertexRatio", vertices.empty() ? 0.0 : 1.0 - static_cast<double>(uniqueVertexCount) / vertices.size());
+
+		// CPU copy of every VertexBufferStruct attribute, as stored by the model and its mesh cache
+		json.BeginObject("vertexStreams");
+		json.WriteUInt("vertexStride", sizeof(ModelClass::VertexBufferStruct));
+		json.WriteUInt("position", sizeof(XMFLOAT3) * vertices.size());
+		json.WriteUInt("normal", sizeof(XMFLOAT3) * vertices.size());
+		json.WriteUInt("tangent", sizeof(XMFLOAT3) * vertices.size());
+		json.WriteUInt("binormal", sizeof(XMFLOAT3) * vertices.size());
+		json.WriteUInt("uv", sizeof(XMFLOAT2) * vertices.size());
+		json.WriteUInt("total", vertices.size_bytes());
+		json.EndObject();
+
+		const ModelClass::MemoryStatistics memory = model.GetMemoryStatistics();
+		json.BeginObject("memory");
+		json.WriteUInt("cpuVertices", memory.cpuVertices);
+		json.WriteUInt("cpuPositions", memory.cpuPositions);
+		json.WriteUInt("cpuIndices", memory.cpuIndices);
+		json.WriteUInt("cpuMeshlets", memory.cpuMeshlets);
+		json.WriteUInt("gpuGeometry", memory.gpuGeometry);
+		json.WriteUInt("gpuMaterials", memory.gpuMaterials);
+		json.EndObject();
+	}
+
+	void WriteTextures(JsonWriter& json, ModelClass& model, ID3D12Device5* device)
+	{
+		// Material texture IDs index slot resources, path of the mesh names the file
+		std::map<std::string, TextureUse> textures;
+		const std::vector<ModelClass::MeshTexturePaths>& texturePaths = model.GetMeshTexturePaths();
+		const std::vector<ModelClass::Material>& materials = model.GetMaterials();
+		for (size_t i = 0; i < texturePaths.size(); ++i)
+		{
+			const struct {
+				const char* name;
+				const std::string& path;
+				UINT32 textureID;
+				const std::vector<ComPtr<ID3D12Resource>>& resources;
+			} slots[] = {
+				{ "albedo", texturePaths[i].albedo, materials[i].albedoTextureID, model.GetTextureResourcesAlbedo() },
+				{ "specular", texturePaths[i].specular, materials[i].specRoughnessTextureID, model.GetTextureResourcesSpecular() },
+				{ "normal", texturePaths[i].normal, materials[i].normalTextureID, model.GetTextureResourcesNormal() }
+			};
+			for (const auto& slot : slots)
+			{
+				if (slot.path.empty()) {
+					continue;
+				}
+				TextureUse& texture = textures[TextureRegistry::NormalizePath(slot.path)];
+				texture.path = slot.path;
+				texture.slots.insert(slot.name);
+				texture.meshes.insert(i);
+				if (!texture.resource && slot.textureID < slot.resources.size()) {
+					texture.resource = slot.resources[slot.textureID];
+				}
+			}
+		}
+
+		UINT64 totalBytes = 0;
+		std::map<UINT64, std::vector<std::string>> pathsByContent;
+		std::set<std::string> directories;
+		json.BeginArray("textures");
+		for (const auto& entry : textures)
+		{
+			const TextureUse& texture = entry.second;
+			json.BeginObject();
+			json.WriteString("path", texture.path);
+			json.BeginArray("slots");
+			for (const std::string& slot : texture.slots)
+			{
+				json.WriteString(nullptr, slot);
+			}
+			json.EndArray();
+			json.WriteUInt("meshCount", texture.meshes.size());
+			if (texture.resource)
+			{
+				const D3D12_RESOURCE_DESC desc = texture.resource->GetDesc();
+				const UINT64 bytes = device->GetResourceAllocationInfo(0, 1, &desc).SizeInBytes;
+				totalBytes += bytes;
+				json.WriteUInt("width", desc.Width);
+				json.WriteUInt("height", desc.Height);
+				json.WriteUInt("mipLevels", desc.MipLevels);
+				json.WriteString("format", GetFormatName(desc.Format));
+				json.WriteUInt("bytes", bytes);
+			}
+			else {
+				json.WriteNull("bytes");
+			}
+			json.EndObject();
+
+			const UINT64 contentHash = MeshCacheFormat::HashFile(texture.path);
+			if (contentHash != 0) {
+				pathsByContent[contentHash].push_back(texture.path);
+			}
+			const size_t separator = entry.first.find_last_of('\\');
+			if (separator != std::string::npos) {
+				directories.insert(entry.first.substr(0, separator));
+			}
+		}
+		json.EndArray();
+		json.WriteUInt("textureBytes", totalBytes);
+
+		// Different paths with the same content - texture registry shares the resource, but files are still shipped and hashed twice
+		json.BeginArray("duplicateTextures");
+		for (const auto& group : pathsByContent)
+		{
+			if (group.second.size() < 2) {
+				continue;
+			}
+			json.BeginArray();
+			for (const std::string& path : group.second)
+			{
+				json.WriteString(nullptr, path);
+			}
+			json.EndArray();
+		}
+		json.EndArray();
+
+		// Texture files next to referenced ones which no mesh uses
+		json.BeginArray("unusedTextures");
+		for (const std::string& directory : directories)
+		{
+			WIN32_FIND_DATAA findData;
+			const HANDLE find = FindFirstFileA((directory + "\\*").c_str(), &findData);
+			if (find == INVALID_HANDLE_VALUE) {
+				continue;
+			}
+			do
+			{
+				const std::string path = directory + "\\" + findData.cFileName;
+				const std::string normalizedPath = TextureRegistry::NormalizePath(path);
+				if (!(findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) && IsTextureFile(normalizedPath) && textures.find(normalizedPath) == textures.end()) {
+					json.WriteString(nullptr, path);
+				}
+			} while (FindNextFileA(find, &findData));
+			FindClose(find);
+		}
+		json.EndArray();
+	}
+
+	void WriteBlas(JsonWriter& json, const ModelClass& model, ID3D12Device5* device)
+	{
+		D3D12_FEATURE_DATA_D3D12_OPTIONS5 options5 = {};
+		const bool raytracingSupported = SUCCEEDED(device->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS5, &options5, sizeof(options5))) && options5.RaytracingTier != D3D12_RAYTRACING_TIER_NOT_SUPPORTED;
+		if (!raytracingSupported || model.GetIndicesCount() == 0)
+		{
+			json.WriteNull("blas");
+			return;
+		}
+
+		// Whole model as single geometry with default flags of RaytracingResources::CreateBLAS - it builds BLAS per placed mesh instead, of similar total size
+		const D3D12_RAYTRACING_GEOMETRY_DESC geometryDesc = model.GetRaytracingGeometryDesc(D3D12_RAYTRACING_GEOMETRY_FLAG_OPAQUE);
+		D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS inputs = {};
+		inputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL;
+		inputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
+		inputs.pGeometryDescs = &geometryDesc;
+		inputs.NumDescs = 1;
+		inputs.Flags = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_TRACE;
+		D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO prebuildInfo = {};
+		device->GetRaytracingAccelerationStructurePrebuildInfo(&inputs, &prebuildInfo);
+
+		json.BeginObject("blas");
+		json.WriteString("positionFormat", GetFormatName(model.GetRaytracingPositionFormat()));
+		json.WriteUInt("positionStride", model.GetRaytracingPositionStride());
+		json.WriteUInt("resultBytes", prebuildInfo.ResultDataMaxSizeInBytes);
+		json.WriteUInt("scratchBytes", prebuildInfo.ScratchDataSizeInBytes);
+		json.EndObject();
+	}
+
+	void WaitForQueue(ID3D12Device5* device, ID3D12CommandQueue* commandQueue)
+	{
+		ComPtr<ID3D12Fence> fence;
+		ThrowIfFailed(device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&fence)));
+		const HANDLE fenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+		assert(fenceEvent && "Failed to create fence event");
+		ThrowIfFailed(commandQueue->Signal(fence.Get(), 1));
+		ThrowIfFailed(fence->SetEventOnCompletion(1, fenceEvent));
+		WaitForSingleObject(fenceEvent, INFINITE);
+		CloseHandle(fenceEvent);
+	}
+
+	void WriteIoBenchmark(JsonWriter& json)
+	{
+		// Shipped texture sets, relative to the working directory like texture paths of models
+		std::vector<std::string> paths;
+		for (const std::string directory : { "textures", "Skyboxes" })
+		{
+			WIN32_FIND_DATAA findData;
+			const HANDLE find = FindFirstFileA((directory + "\\*").c_str(), &findData);
+			if (find == INVALID_HANDLE_VALUE) {
+				continue;
+			}
+			do
+			{
+				if (!(findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+					paths.push_back(directory + "\\" + findData.cFileName);
+				}
+			} while (FindNextFileA(find, &findData));
+			FindClose(find);
+		}
+
+		json.BeginArray("ioBenchmark");
+		for (const AsyncFileReader::BenchmarkResult& result : AsyncFileReader::Benchmark(paths, AsyncFileReader::Settings()))
+		{
+			json.BeginObject();
+			json.WriteString("method", result.method);
+			json.WriteString("pageCache", result.coldCache ? "cold" : "warm");
+			json.WriteUInt("fileCount", result.fileCount);
+			json.WriteUInt("bytes", result.byteCount);
+			json.WriteFloat("timeMs", result.time);
+			json.WriteFloat("megabytesPerSecond", result.byteCount / (1024.0 * 1024.0) / (result.time / 1000.0));
+			json.EndObject();
+		}
+		json.EndArray();
+	}
+
+	void PrintUsage()
+	{
+		fprintf(stderr,
+			"Usage: rtcp-assetstat <model> [--output <file>] [--right-handed] [--no-mesh-cache] [--warp] [--io-benchmark]\n"
+			"  Model path is relative to the executable, texture paths to the working directory - like RTCP itself.\n"
+			"  --right-handed   import like models loaded with upload heap (SunTemple), left handed otherwise\n"
+			"  --no-mesh-cache  import by assimp even if up to date mesh cache exists\n"
+			"  --warp           use WARP adapter, for machines without D3D12 GPU\n"
+			"  --io-benchmark   read textures and Skyboxes directories serially and through every AsyncFileReader backend, with cold and warm page cache.\n"
+			"                   Model is optional with this option.\n");
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	std::string modelPath;
+	std::string outputPath;
+	bool rightHanded = false;
+	bool useWarp = false;
+	bool ioBenchmark = false;
+	ModelLoadSettings settings;
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string argument = argv[i];
+		if (argument == "--output" && i + 1 < argc) {
+			outputPath = argv[++i];
+		}
+		else if (argument == "--right-handed") {
+			rightHanded = true;
+		}
+		else if (argument == "--no-mesh-cache") {
+			settings.useMeshCache = false;
+		}
+		else if (argument == "--warp") {
+			useWarp = true;
+		}
+		else if (argument == "--io-benchmark") {
+			ioBenchmark = true;
+		}
+		else if (modelPath.empty() && argument[0] != '-') {
+			modelPath = argument;
+		}
+		else
+		{
+			PrintUsage();
+			return 1;
+		}
+	}
+	if (modelPath.empty() && !ioBenchmark)
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	std::ofstream file;
+	if (!outputPath.empty())
+	{
+		file.open(outputPath, std::ofstream::out | std::ofstream::trunc);
+		if (!file)
+		{
+			fprintf(stderr, "rtcp-assetstat: can't open %s\n", outputPath.c_str());
+			return 1;
+		}
+	}
+	JsonWriter json(outputPath.empty() ? std::cout : file);
+
+	// Runs before the model is loaded, which would bring its textures into page cache
+	if (modelPath.empty())
+	{
+		json.BeginObject();
+		WriteIoBenchmark(json);
+		json.EndObject();
+		return 0;
+	}
+
+	// Headless device - no window or swap chain, only what the import path needs to create buffers and upload textures
+	ThrowIfFailed(CoInitializeEx(nullptr, COINIT_MULTITHREADED));
+	ComPtr<IDXGIFactory4> dxgiFactory;
+	ThrowIfFailed(CreateDXGIFactory2(0, IID_PPV_ARGS(&dxgiFactory)));
+	ComPtr<ID3D12Device5> device = DeviceManager::CreateDevice(dxgiFactory, useWarp);
+	ComPtr<ID3D12CommandQueue> commandQueue = DeviceManager::CreateCommandQueue(device, D3D12_COMMAND_LIST_TYPE_DIRECT);
+	ComPtr<ID3D12CommandAllocator> commandAllocator;
+	ThrowIfFailed(device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&commandAllocator)));
+	ComPtr<ID3D12GraphicsCommandList4> commandList;
+	ThrowIfFailed(device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, commandAllocator.Get(), nullptr, IID_PPV_ARGS(&commandList)));
+
+	const auto startTime = std::chrono::high_resolution_clock::now();
+	ComPtr<ID3D12Resource> uploadHeap;
+	std::unique_ptr<ModelClass> model = rightHanded ? std::make_unique<ModelClass>(modelPath, device, commandList, uploadHeap, settings) : std::make_unique<ModelClass>(modelPath, device, commandList, settings);
+	const std::chrono::duration<double, std::milli> loadTime = std::chrono::high_resolution_clock::now() - startTime;
+	assert(model->IsLoadComplete() && "Report needs fully loaded model");
+
+	// Texture uploads are executed before upload heaps are released
+	ThrowIfFailed(commandList->Close());
+	ID3D12CommandList* commandLists[] = { commandList.Get() };
+	commandQueue->ExecuteCommandLists(_countof(commandLists), commandLists);
+	WaitForQueue(device.Get(), commandQueue.Get());
+	model->ReleaseUploadHeaps();
+
+	json.BeginObject();
+	json.WriteString("model", modelPath);
+	json.WriteFloat("loadTimeMs", loadTime.count());
+	json.WriteUInt("peakWorkingSetBytes", GetPeakWorkingSetRTCP());
+	WriteGeometry(json, *model);
+	WriteTextures(json, *model, device.Get());
+	WriteBlas(json, *model, device.Get());
+	if (ioBenchmark) {
+		WriteIoBenchmark(json);
+	}
+	json.EndObject();
+
+	CoUninitialize();
+	return 0;
+}
@@ -0,0 +1,837 @@
+#include "AsyncFileReader.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+namespace
+{
+#ifdef _WIN32
+	typedef HANDLE FileHandle;
+	const FileHandle INVALID_FILE = INVALID_HANDLE_VALUE;
+	// Completion keys - reads of files use 0
+	constexpr ULONG_PTR FAILED_READ_KEY = 1;
+	constexpr ULONG_PTR WAKE_KEY = 2;
+#else
+	typedef int FileHandle;
+	constexpr FileHandle INVALID_FILE = -1;
+#endif
+
+	typedef std::chrono::high_resolution_clock Clock;
+}
+
+struct AsyncFileReader::Operation {
+#ifdef _WIN32
+	OVERLAPPED overlapped;		// First member - completion port returns pointer to it
+#endif
+	FileRequest* request;
+	uint64_t offset;
+	uint8_t* destination;
+	size_t size;
+	int64_t result;				// Bytes read, negative error code if read failed
+};
+
+struct AsyncFileReader::FileRequest {
+	std::string path;
+	Callback callback;
+	std::vector<uint8_t> data;
+	FileHandle file = INVALID_FILE;
+	size_t reservedBytes = 0;
+	// Never resized once file is split, operations are referenced by pointers
+	std::vector<Operation> operations;
+	size_t pendingOperations = 0;
+	bool failed = false;
+	Clock::time_point startTime;
+	double readTime = 0.0;
+};
+
+struct AsyncFileReader::Platform {
+#ifdef __linux__
+	// io_uring without liburing - rings are mapped and driven directly through io_uring_setup and io_uring_enter
+	int ring = -1;
+	// Read of eventfd is kept in flight, so Wake can interrupt io_uring_enter
+	int wakeEvent = -1;
+	uint64_t wakeValue = 0;
+	void* sqRing = MAP_FAILED;
+	void* cqRing = MAP_FAILED;
+	void* sqes = MAP_FAILED;
+	size_t sqRingSize = 0;
+	size_t cqRingSize = 0;
+	size_t sqesSize = 0;
+	unsigned* sqTail = nullptr;
+	unsigned* sqArray = nullptr;
+	unsigned sqMask = 0;
+	unsigned* cqHead = nullptr;
+	unsigned* cqTail = nullptr;
+	io_uring_cqe* cqes = nullptr;
+	unsigned cqMask = 0;
+	unsigned unsubmitted = 0;
+
+	// Entry stays zeroed except for what caller fills - submitted by next Enter
+	io_uring_sqe& PushEntry()
+	{
+		const unsigned tail = *sqTail;
+		const unsigned index = tail & sqMask;
+		io_uring_sqe& entry = static_cast<io_uring_sqe*>(sqes)[index];
+		memset(&entry, 0, sizeof(entry));
+		sqArray[index] = index;
+		__atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+		++unsubmitted;
+		return entry;
+	}
+
+	void ArmWake()
+	{
+		io_uring_sqe& entry = PushEntry();
+		entry.opcode = IORING_OP_READ;
+		entry.fd = wakeEvent;
+		entry.addr = reinterpret_cast<uint64_t>(&wakeValue);
+		entry.len = sizeof(wakeValue);
+		entry.user_data = 0;
+	}
+
+	// Submits pushed entries and waits for minComplete completions
+	void Enter(unsigned minComplete)
+	{
+		const long submitted = syscall(__NR_io_uring_enter, ring, unsubmitted, minComplete, minComplete > 0 ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+		if (submitted >= 0) {
+			unsubmitted -= static_cast<unsigned>(submitted);
+		}
+		else {
+			assert((errno == EINTR || errno == EAGAIN || errno == EBUSY) && "io_uring_enter failed");
+		}
+	}
+#endif
+
+#ifdef _WIN32
+	HANDLE port = nullptr;
+#endif
+
+	// ThreadPool backend
+	std::vector<std::thread> readers;
+	std::mutex mutex;
+	std::condition_variable readCondition;
+	std::condition_variable completionCondition;
+	std::deque<Operation*> reads;
+	std::deque<Operation*> completions;
+	bool woken = false;
+	bool stopping = false;
+};
+
+AsyncFileReader::AsyncFileReader(const Settings& settings) :
+	m_settings(settings),
+	m_platform(std::make_unique<Platform>())
+{
+	assert(m_settings.queueDepth > 0 && m_settings.chunkSize > 0 && m_settings.chunkSize <= (1u << 30) && "Chunk has to fit into single read call");
+
+	m_backend = m_settings.backend == Backend::ThreadPool ? Backend::ThreadPool : Backend::Native;
+	InitializePlatform();
+
+	const unsigned int callbackThreadCount = m_settings.callbackThreadCount > 0 ? m_settings.callbackThreadCount : std::max(std::thread::hardware_concurrency(), 1u);
+	m_callbackThreads.reserve(callbackThreadCount);
+	for (unsigned int i = 0; i < callbackThreadCount; ++i)
+	{
+		m_callbackThreads.emplace_back(&AsyncFileReader::CallbackLoop, this);
+	}
+	m_ioThread = std::thread(&AsyncFileReader::IoLoop, this);
+}
+
+AsyncFileReader::~AsyncFileReader()
+{
+	WaitIdle();
+	{
+		std::lock_guard<std::mutex> lock{ m_mutex };
+		m_stopping = true;
+	}
+	Wake();
+	m_ioThread.join();
+
+	{
+		std::lock_guard<std::mutex> lock{ m_callbackMutex };
+		m_callbacksStopping = true;
+	}
+	m_callbackCondition.notify_all();
+	for (std::thread& thread : m_callbackThreads)
+	{
+		thread.join();
+	}
+	ShutdownPlatform();
+}
+
+void AsyncFileReader::Read(const std::string& path, Callback callback)
+{
+	std::vector<std::unique_ptr<FileRequest>> requests(1);
+	requests[0] = std::make_unique<FileRequest>();
+	requests[0]->path = path;
+	requests[0]->callback = std::move(callback);
+	Enqueue(requests);
+}
+
+std::future<AsyncFileReader::Result> AsyncFileReader::Read(const std::string& path)
+{
+	// std::function requires copyable target, so promise is shared
+	auto promise = std::make_shared<std::promise<Result>>();
+	std::future<Result> result = promise->get_future();
+	Read(path, [promise](Result& completed) { promise->set_value(std::move(completed)); });
+	return result;
+}
+
+void AsyncFileReader::ReadBatch(const std::vector<std::string>& paths, const Callback& callback)
+{
+	std::vector<std::unique_ptr<FileRequest>> requests(paths.size());
+	for (size_t i = 0; i < paths.size(); ++i)
+	{
+		requests[i] = std::make_unique<FileRequest>();
+		requests[i]->path = paths[i];
+		requests[i]->callback = callback;
+	}
+	Enqueue(requests);
+}
+
+void AsyncFileReader::WaitIdle()
+{
+	std::unique_lock<std::mutex> lock{ m_idleMutex };
+	m_idleCondition.wait(lock, [this]() { return m_outstanding == 0; });
+}
+
+const char* AsyncFileReader::GetBackendName(Backend backend)
+{
+	switch (backend)
+	{
+	case Backend::Auto:
+		return "auto";
+	case Backend::Native:
+#ifdef _WIN32
+		return "completionPort";
+#else
+		return "io_uring";
+#endif
+	case Backend::ThreadPool:
+		return "threadPool";
+	}
+	return "unknown";
+}
+
+bool AsyncFileReader::EvictFromCache(const std::string& path)
+{
+#if defined(_WIN32)
+	// Cache manager purges pages of file opened without buffering, if no other handle keeps them
+	const HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_NO_BUFFERING, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	CloseHandle(file);
+	return true;
+#elif defined(__linux__)
+	// Only clean pages are dropped, which is every page of asset that isn't being written
+	const int file = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (file < 0) {
+		return false;
+	}
+	const bool evicted = posix_fadvise(file, 0, 0, POSIX_FADV_DONTNEED) == 0;
+	close(file);
+	return evicted;
+#else
+	(void)path;
+	return false;
+#endif
+}
+
+std::vector<AsyncFileReader::BenchmarkResult> AsyncFileReader::Benchmark(const std::vector<std::string>& paths, const Settings& settings)
+{
+	std::vector<BenchmarkResult> results;
+	auto run = [&](const std::string& method, const std::function<void(size_t&, size_t&)>& read) {
+		// Cold run drops the files from page cache first, warm run follows right after it, so every file is cached
+		for (const bool coldCache : { true, false })
+		{
+			if (coldCache)
+			{
+				for (const std::string& path : paths)
+				{
+					EvictFromCache(path);
+				}
+			}
+
+			size_t fileCount = 0;
+			size_t byteCount = 0;
+			const auto startTime = Clock::now();
+			read(fileCount, byteCount);
+			const std::chrono::duration<double, std::milli> time = Clock::now() - startTime;
+			results.push_back({ method, coldCache, fileCount, byteCount, time.count() });
+		}
+	};
+
+	// Baseline - whole file read by blocking call before next one is opened, like ImageDecoder::LoadFile
+	run("serial", [&](size_t& fileCount, size_t& byteCount) {
+		for (const std::string& path : paths)
+		{
+			std::ifstream file{ path, std::ifstream::binary | std::ifstream::ate };
+			if (!file) {
+				continue;
+			}
+			std::vector<char> data(static_cast<size_t>(file.tellg()));
+			file.seekg(0);
+			if (file.read(data.data(), data.size())) {
+				++fileCount;
+				byteCount += data.size();
+			}
+		}
+	});
+
+	for (const Backend backend : { Backend::Native, Backend::ThreadPool })
+	{
+		Settings backendSettings = settings;
+		backendSettings.backend = backend;
+		AsyncFileReader reader{ backendSettings };
+		if (reader.GetBackend() != backend) {
+			continue;
+		}
+
+		run(GetBackendName(backend), [&](size_t& fileCount, size_t& byteCount) {
+			std::atomic<size_t> files{ 0 };
+			std::atomic<size_t> bytes{ 0 };
+			reader.ReadBatch(paths, [&](Result& result) {
+				if (result.succeeded) {
+					files.fetch_add(1, std::memory_order_relaxed);
+					bytes.fetch_add(result.data.size(), std::memory_order_relaxed);
+				}
+			});
+			reader.WaitIdle();
+			fileCount = files.load();
+			byteCount = bytes.load();
+		});
+	}
+	return results;
+}
+
+void AsyncFileReader::Enqueue(std::vector<std::unique_ptr<FileRequest>>& requests)
+{
+	const auto startTime = Clock::now();
+	{
+		std::lock_guard<std::mutex> lock{ m_idleMutex };
+		m_outstanding += requests.size();
+	}
+	{
+		std::lock_guard<std::mutex> lock{ m_mutex };
+		assert(!m_stopping && "Can't read file after reader started stopping");
+		for (std::unique_ptr<FileRequest>& request : requests)
+		{
+			request->startTime = startTime;
+			m_waitingRequests.push_back(std::move(request));
+		}
+	}
+	Wake();
+}
+
+void AsyncFileReader::IoLoop()
+{
+	while (true)
+	{
+		AdmitRequests();
+		while (m_operationsInFlight < m_settings.queueDepth && !m_readyOperations.empty())
+		{
+			Operation* operation = m_readyOperations.front();
+			m_readyOperations.pop_front();
+			++m_operationsInFlight;
+			Submit(operation);
+		}
+
+		// Nothing to wait for except new requests or released bytes in flight
+		if (m_operationsInFlight == 0 && m_openRequests.empty() && !m_nextRequest)
+		{
+			std::lock_guard<std::mutex> lock{ m_mutex };
+			if (m_stopping && m_waitingRequests.empty()) {
+				break;
+			}
+		}
+
+		Operation* operation = WaitOperation();
+		if (operation) {
+			CompleteOperation(operation);
+		}
+	}
+}
+
+void AsyncFileReader::CallbackLoop()
+{
+	while (true)
+	{
+		std::unique_ptr<FileRequest> request;
+		{
+			std::unique_lock<std::mutex> lock{ m_callbackMutex };
+			m_callbackCondition.wait(lock, [this]() { return m_callbacksStopping || !m_finishedRequests.empty(); });
+			if (m_finishedRequests.empty()) {
+				break;
+			}
+			request = std::move(m_finishedRequests.front());
+			m_finishedRequests.pop_front();
+		}
+
+		Result result;
+		result.path = std::move(request->path);
+		result.succeeded = !request->failed;
+		if (result.succeeded) {
+			result.data = std::move(request->data);
+		}
+		result.readTime = request->readTime;
+		request->callback(result);
+
+		// Bytes are in flight until callback returns, so slow consumers hold up further reads
+		if (request->reservedBytes > 0)
+		{
+			m_bytesInFlight.fetch_sub(request->reservedBytes, std::memory_order_acq_rel);
+			Wake();
+		}
+		{
+			std::lock_guard<std::mutex> lock{ m_idleMutex };
+			--m_outstanding;
+		}
+		m_idleCondition.notify_all();
+	}
+}
+
+void AsyncFileReader::AdmitRequests()
+{
+	while (true)
+	{
+		// Front request is opened to know its size, then it waits until its bytes fit into the limit
+		if (!m_nextRequest)
+		{
+			{
+				std::lock_guard<std::mutex> lock{ m_mutex };
+				if (m_waitingRequests.empty()) {
+					return;
+				}
+				m_nextRequest = std::move(m_waitingRequests.front());
+				m_waitingRequests.pop_front();
+			}
+
+			uint64_t fileSize = 0;
+			if (!OpenFile(*m_nextRequest, fileSize) || fileSize > SIZE_MAX)
+			{
+				m_nextRequest->failed = true;
+				FinishRequest(std::move(m_nextRequest));
+				continue;
+			}
+			m_nextRequest->reservedBytes = static_cast<size_t>(std::min<uint64_t>(fileSize, m_settings.maxBytesInFlight));
+			m_nextRequest->data.resize(static_cast<size_t>(fileSize));
+		}
+
+		// File larger than the limit is admitted once nothing else is in flight
+		const size_t reservedBytes = m_nextRequest->reservedBytes;
+		if (m_bytesInFlight.load(std::memory_order_acquire) + reservedBytes > m_settings.maxBytesInFlight) {
+			return;
+		}
+		m_bytesInFlight.fetch_add(reservedBytes, std::memory_order_acq_rel);
+
+		std::unique_ptr<FileRequest> request = std::move(m_nextRequest);
+		const size_t fileSize = request->data.size();
+		if (fileSize == 0)
+		{
+			FinishRequest(std::move(request));
+			continue;
+		}
+
+		const size_t operationCount = (fileSize + m_settings.chunkSize - 1) / m_settings.chunkSize;
+		request->operations.resize(operationCount);
+		request->pendingOperations = operationCount;
+		for (size_t i = 0; i < operationCount; ++i)
+		{
+			Operation& operation = request->operations[i];
+			memset(&operation, 0, sizeof(operation));
+			operation.request = request.get();
+			operation.offset = i * m_settings.chunkSize;
+			operation.destination = request->data.data() + operation.offset;
+			operation.size = std::min(m_settings.chunkSize, fileSize - static_cast<size_t>(operation.offset));
+			m_readyOperations.push_back(&operation);
+		}
+		m_openRequests.push_back(std::move(request));
+	}
+}
+
+void AsyncFileReader::CompleteOperation(Operation* operation)
+{
+	--m_operationsInFlight;
+	FileRequest& request = *operation->request;
+	if (operation->result > 0 && !request.failed)
+	{
+		// Short read - rest of the chunk is read again, ahead of other chunks
+		const size_t readBytes = static_cast<size_t>(operation->result);
+		operation->offset += readBytes;
+		operation->destination += readBytes;
+		operation->size -= readBytes;
+		if (operation->size > 0)
+		{
+			m_readyOperations.push_front(operation);
+			return;
+		}
+	}
+	else if (operation->result <= 0)
+	{
+		// Nothing read means file got shorter since it was opened
+		request.failed = true;
+	}
+
+	if (--request.pendingOperations > 0) {
+		return;
+	}
+	const auto it = std::find_if(m_openRequests.begin(), m_openRequests.end(), [&request](const std::unique_ptr<FileRequest>& openRequest) { return openRequest.get() == &request; });
+	assert(it != m_openRequests.end() && "Completed operation of file which isn't open");
+	std::unique_ptr<FileRequest> finished = std::move(*it);
+	m_openRequests.erase(it);
+	FinishRequest(std::move(finished));
+}
+
+void AsyncFileReader::FinishRequest(std::unique_ptr<FileRequest> request)
+{
+	CloseFile(*request);
+	request->operations.clear();
+	if (request->failed) {
+		request->data.clear();
+	}
+	const std::chrono::duration<double, std::milli> readTime = Clock::now() - request->startTime;
+	request->readTime = readTime.count();
+
+	{
+		std::lock_guard<std::mutex> lock{ m_callbackMutex };
+		m_finishedRequests.push_back(std::move(request));
+	}
+	m_callbackCondition.notify_one();
+}
+
+void AsyncFileReader::InitializePlatform()
+{
+	Platform& platform = *m_platform;
+#if defined(__linux__)
+	if (m_backend == Backend::Native)
+	{
+		// One entry more than queue depth, for read of wake up event
+		io_uring_params params;
+		memset(&params, 0, sizeof(params));
+		platform.ring = static_cast<int>(syscall(__NR_io_uring_setup, m_settings.queueDepth + 1, &params));
+		// IORING_OP_READ came with the same kernel (5.6) as IORING_FEAT_RW_CUR_POS
+		bool ready = platform.ring >= 0 && (params.features & IORING_FEAT_RW_CUR_POS) != 0;
+		// Both rings share one mapping since 5.4
+		const bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+		if (ready)
+		{
+			platform.sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+			platform.cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+			if (singleMap) {
+				platform.sqRingSize = platform.cqRingSize = std::max(platform.sqRingSize, platform.cqRingSize);
+			}
+			platform.sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+			platform.sqRing = mmap(nullptr, platform.sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, platform.ring, IORING_OFF_SQ_RING);
+			if (!singleMap) {
+				platform.cqRing = mmap(nullptr, platform.cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, platform.ring, IORING_OFF_CQ_RING);
+			}
+			platform.sqes = mmap(nullptr, platform.sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, platform.ring, IORING_OFF_SQES);
+			platform.wakeEvent = eventfd(0, EFD_CLOEXEC);
+			ready = platform.sqRing != MAP_FAILED && (singleMap || platform.cqRing != MAP_FAILED) && platform.sqes != MAP_FAILED && platform.wakeEvent >= 0;
+		}
+
+		if (ready)
+		{
+			uint8_t* sqRing = static_cast<uint8_t*>(platform.sqRing);
+			uint8_t* cqRing = static_cast<uint8_t*>(singleMap ? platform.sqRing : platform.cqRing);
+			platform.sqTail = reinterpret_cast<unsigned*>(sqRing + params.sq_off.tail);
+			platform.sqArray = reinterpret_cast<unsigned*>(sqRing + params.sq_off.array);
+			platform.sqMask = *reinterpret_cast<unsigned*>(sqRing + params.sq_off.ring_mask);
+			platform.cqHead = reinterpret_cast<unsigned*>(cqRing + params.cq_off.head);
+			platform.cqTail = reinterpret_cast<unsigned*>(cqRing + params.cq_off.tail);
+			platform.cqes = reinterpret_cast<io_uring_cqe*>(cqRing + params.cq_off.cqes);
+			platform.cqMask = *reinterpret_cast<unsigned*>(cqRing + params.cq_off.ring_mask);
+			platform.ArmWake();
+			return;
+		}
+
+		// Kernel without io_uring, or with io_uring disabled (seccomp of containers)
+		ShutdownPlatform();
+		m_backend = Backend::ThreadPool;
+	}
+#elif defined(_WIN32)
+	if (m_backend == Backend::Native)
+	{
+		platform.port = CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 1);
+		if (platform.port) {
+			return;
+		}
+		m_backend = Backend::ThreadPool;
+	}
+#else
+	m_backend = Backend::ThreadPool;
+#endif
+
+	platform.readers.reserve(m_settings.queueDepth);
+	for (unsigned int i = 0; i < m_settings.queueDepth; ++i)
+	{
+		platform.readers.emplace_back(&AsyncFileReader::ThreadPoolReaderLoop, this);
+	}
+}
+
+void AsyncFileReader::ShutdownPlatform()
+{
+	Platform& platform = *m_platform;
+#ifdef __linux__
+	// Closing the ring cancels read of wake up event
+	if (platform.sqes != MAP_FAILED) {
+		munmap(platform.sqes, platform.sqesSize);
+	}
+	if (platform.cqRing != MAP_FAILED) {
+		munmap(platform.cqRing, platform.cqRingSize);
+	}
+	if (platform.sqRing != MAP_FAILED) {
+		munmap(platform.sqRing, platform.sqRingSize);
+	}
+	if (platform.ring >= 0) {
+		close(platform.ring);
+	}
+	if (platform.wakeEvent >= 0) {
+		close(platform.wakeEvent);
+	}
+	platform.sqes = platform.cqRing = platform.sqRing = MAP_FAILED;
+	platform.ring = platform.wakeEvent = -1;
+	platform.unsubmitted = 0;
+#endif
+#ifdef _WIN32
+	if (platform.port)
+	{
+		CloseHandle(platform.port);
+		platform.port = nullptr;
+	}
+#endif
+
+	{
+		std::lock_guard<std::mutex> lock{ platform.mutex };
+		platform.stopping = true;
+	}
+	platform.readCondition.notify_all();
+	for (std::thread& reader : platform.readers)
+	{
+		reader.join();
+	}
+	platform.readers.clear();
+}
+
+bool AsyncFileReader::OpenFile(FileRequest& request, uint64_t& fileSize)
+{
+#ifdef _WIN32
+	// Completion port needs overlapped handle, reader threads read synchronous one at explicit offsets
+	const DWORD flags = FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN | (m_backend == Backend::Native ? FILE_FLAG_OVERLAPPED : 0);
+	request.file = CreateFileA(request.path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, flags, nullptr);
+	if (request.file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(request.file, &size) || (m_backend == Backend::Native && !CreateIoCompletionPort(request.file, m_platform->port, 0, 0)))
+	{
+		CloseFile(request);
+		return false;
+	}
+	fileSize = static_cast<uint64_t>(size.QuadPart);
+	return true;
+#else
+	request.file = open(request.path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (request.file < 0) {
+		return false;
+	}
+	struct stat status;
+	if (fstat(request.file, &status) != 0 || !S_ISREG(status.st_mode))
+	{
+		CloseFile(request);
+		return false;
+	}
+	fileSize = static_cast<uint64_t>(status.st_size);
+	return true;
+#endif
+}
+
+void AsyncFileReader::CloseFile(FileRequest& request)
+{
+	if (request.file == INVALID_FILE) {
+		return;
+	}
+#ifdef _WIN32
+	CloseHandle(request.file);
+#else
+	close(request.file);
+#endif
+	request.file = INVALID_FILE;
+}
+
+void AsyncFileReader::Submit(Operation* operation)
+{
+	Platform& platform = *m_platform;
+	if (m_backend == Backend::Native)
+	{
+#if defined(__linux__)
+		// Queue depth plus wake up read never exceed ring size, so entry is always free
+		io_uring_sqe& entry = platform.PushEntry();
+		entry.opcode = IORING_OP_READ;
+		entry.fd = operation->request->file;
+		entry.off = operation->offset;
+		entry.addr = reinterpret_cast<uint64_t>(operation->destination);
+		entry.len = static_cast<uint32_t>(operation->size);
+		entry.user_data = reinterpret_cast<uint64_t>(operation);
+#elif defined(_WIN32)
+		memset(&operation->overlapped, 0, sizeof(operation->overlapped));
+		operation->overlapped.Offset = static_cast<DWORD>(operation->offset);
+		operation->overlapped.OffsetHigh = static_cast<DWORD>(operation->offset >> 32);
+		if (!ReadFile(operation->request->file, operation->destination, static_cast<DWORD>(operation->size), nullptr, &operation->overlapped) && GetLastError() != ERROR_IO_PENDING)
+		{
+			// No packet is queued for read which failed right away - it's posted here, so WaitOperation sees every operation complete
+			operation->result = -static_cast<int64_t>(GetLastError());
+			PostQueuedCompletionStatus(platform.port, 0, FAILED_READ_KEY, &operation->overlapped);
+		}
+#endif
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock{ platform.mutex };
+		platform.reads.push_back(operation);
+	}
+	platform.readCondition.notify_one();
+}
+
+AsyncFileReader::Operation* AsyncFileReader::WaitOperation()
+{
+	Platform& platform = *m_platform;
+	if (m_backend == Backend::Native)
+	{
+#if defined(__linux__)
+		while (true)
+		{
+			const unsigned head = *platform.cqHead;
+			if (head == __atomic_load_n(platform.cqTail, __ATOMIC_ACQUIRE))
+			{
+				// Whole batch of reads submitted since last wait goes in with the same call
+				platform.Enter(1);
+				continue;
+			}
+			if (platform.unsubmitted > 0) {
+				platform.Enter(0);
+			}
+
+			const io_uring_cqe& completion = platform.cqes[head & platform.cqMask];
+			Operation* operation = reinterpret_cast<Operation*>(completion.user_data);
+			const int32_t result = completion.res;
+			__atomic_store_n(platform.cqHead, head + 1, __ATOMIC_RELEASE);
+			if (!operation)
+			{
+				platform.ArmWake();
+				return nullptr;
+			}
+			operation->result = result;
+			return operation;
+		}
+#elif defined(_WIN32)
+		DWORD readBytes = 0;
+		ULONG_PTR key = 0;
+		OVERLAPPED* overlapped = nullptr;
+		const BOOL succeeded = GetQueuedCompletionStatus(platform.port, &readBytes, &key, &overlapped, INFINITE);
+		if (!overlapped || key == WAKE_KEY) {
+			return nullptr;
+		}
+		// OVERLAPPED is the first member of operation
+		Operation* operation = reinterpret_cast<Operation*>(overlapped);
+		if (key != FAILED_READ_KEY) {
+			operation->result = succeeded ? static_cast<int64_t>(readBytes) : -static_cast<int64_t>(GetLastError());
+		}
+		return operation;
+#endif
+	}
+
+	std::unique_lock<std::mutex> lock{ platform.mutex };
+	platform.completionCondition.wait(lock, [&platform]() { return platform.woken || !platform.completions.empty(); });
+	if (platform.completions.empty())
+	{
+		platform.woken = false;
+		return nullptr;
+	}
+	Operation* operation = platform.completions.front();
+	platform.completions.pop_front();
+	return operation;
+}
+
+void AsyncFileReader::Wake()
+{
+	Platform& platform = *m_platform;
+	if (m_backend == Backend::Native)
+	{
+#if defined(__linux__)
+		const uint64_t value = 1;
+		const ssize_t written = write(platform.wakeEvent, &value, sizeof(value));
+		assert(written == sizeof(value) && "Failed to wake up I/O thread");
+		(void)written;
+#elif defined(_WIN32)
+		PostQueuedCompletionStatus(platform.port, 0, WAKE_KEY, nullptr);
+#endif
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock{ platform.mutex };
+		platform.woken = true;
+	}
+	platform.completionCondition.notify_one();
+}
+
+void AsyncFileReader::ThreadPoolReaderLoop()
+{
+	Platform& platform = *m_platform;
+	while (true)
+	{
+		Operation* operation;
+		{
+			std::unique_lock<std::mutex> lock{ platform.mutex };
+			platform.readCondition.wait(lock, [&platform]() { return platform.stopping || !platform.reads.empty(); });
+			if (platform.stopping) {
+				break;
+			}
+			operation = platform.reads.front();
+			platform.reads.pop_front();
+		}
+
+#ifdef _WIN32
+		OVERLAPPED overlapped = {};
+		overlapped.Offset = static_cast<DWORD>(operation->offset);
+		overlapped.OffsetHigh = static_cast<DWORD>(operation->offset >> 32);
+		DWORD readBytes = 0;
+		operation->result = ReadFile(operation->request->file, operation->destination, static_cast<DWORD>(operation->size), &readBytes, &overlapped) ?
+			static_cast<int64_t>(readBytes) : -static_cast<int64_t>(GetLastError());
+#else
+		const ssize_t readBytes = pread(operation->request->file, operation->destination, operation->size, static_cast<off_t>(operation->offset));
+		operation->result = readBytes >= 0 ? static_cast<int64_t>(readBytes) : -static_cast<int64_t>(errno);
+#endif
+
+		{
+			std::lock_guard<std::mutex> lock{ platform.mutex };
+			platform.completions.push_back(operation);
+		}
+		platform.completionCondition.notify_one();
+	}
+}
@@ -0,0 +1,141 @@
+#pragma once
+#ifndef _ASYNC_FILE_READER_H_
+#define _ASYNC_FILE_READER_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Reads whole files in batches - io_uring on Linux, I/O completion port on Windows, blocking positional reads on pool of threads where neither is available.
+// Doesn't depend on Windows or D3D12 headers, like MeshOptimizer - platform APIs are used only inside AsyncFileReader.cpp.
+// Single I/O thread splits files into chunks and keeps up to queueDepth of them in flight. Finished files are handed to callback threads,
+// so decoding inside callbacks doesn't hold up further reads.
+class AsyncFileReader
+{
+public:
+	enum class Backend : uint32_t
+	{
+		Auto = 0,			// Native if platform supports it, ThreadPool otherwise
+		Native = 1,			// io_uring (Linux 5.6+) or I/O completion port (Windows)
+		ThreadPool = 2		// queueDepth threads calling pread / ReadFile
+	};
+
+	struct Settings {
+		Backend backend = Backend::Auto;
+		// Bytes of files being read or waiting for their callback to return - file larger than the limit is read alone
+		size_t maxBytesInFlight = 64 * 1024 * 1024;
+		// Chunk reads submitted at once
+		unsigned int queueDepth = 32;
+		size_t chunkSize = 1024 * 1024;
+		// Threads running callbacks - 0 creates one per hardware thread
+		unsigned int callbackThreadCount = 0;
+	};
+
+	struct Result {
+		std::string path;
+		std::vector<uint8_t> data;		// Empty if file couldn't be read
+		bool succeeded = false;
+		double readTime = 0.0;			// Milliseconds from request to its last chunk
+	};
+	typedef std::function<void(Result&)> Callback;
+
+	AsyncFileReader() : AsyncFileReader(Settings()) {}
+	explicit AsyncFileReader(const Settings& settings);
+	// Waits for every request
+	~AsyncFileReader();
+	AsyncFileReader(const AsyncFileReader&) = delete;
+	AsyncFileReader& operator=(const AsyncFileReader&) = delete;
+
+	// Thread safe and never blocks - files are read in request order, as bytes in flight allow. Callback runs on one of callback threads.
+	void Read(const std::string& path, Callback callback);
+	// Bytes in flight are released once data is moved into the future, not when the future is consumed
+	std::future<Result> Read(const std::string& path);
+	// Whole batch wakes I/O thread once
+	void ReadBatch(const std::vector<std::string>& paths, const Callback& callback);
+	// Blocks until every request so far has returned from its callback
+	void WaitIdle();
+
+	Backend GetBackend() const { return m_backend; }
+	size_t GetBytesInFlight() const { return m_bytesInFlight.load(std::memory_order_acquire); }
+	size_t GetMaxBytesInFlight() const { return m_settings.maxBytesInFlight; }
+	static const char* GetBackendName(Backend backend);
+
+	// Drops cached pages of file, so its next read goes to the disk - best effort, false if platform refused
+	static bool EvictFromCache(const std::string& path);
+
+	struct BenchmarkResult {
+		std::string method;		// "serial" for blocking reads of one file after another, backend name otherwise
+		bool coldCache;
+		size_t fileCount;
+		size_t byteCount;
+		double time;			// Milliseconds
+	};
+	// Reads files with blocking calls one after another, then through every available backend - each with cold and warm page cache.
+	// Backend of settings is ignored.
+	static std::vector<BenchmarkResult> Benchmark(const std::vector<std::string>& paths, const Settings& settings);
+
+private:
+	struct Operation;
+	struct FileRequest;
+	struct Platform;
+
+	void Enqueue(std::vector<std::unique_ptr<FileRequest>>& requests);
+	void IoLoop();
+	void CallbackLoop();
+	// Opens waiting files while bytes in flight allow and splits them into chunk operations
+	void AdmitRequests();
+	void CompleteOperation(Operation* operation);
+	// Closes file and hands it to callback threads
+	void FinishRequest(std::unique_ptr<FileRequest> request);
+
+	// Platform layer, used only by I/O thread except for Wake - Native backend falls back to ThreadPool if platform doesn't support it
+	void InitializePlatform();
+	void ShutdownPlatform();
+	bool OpenFile(FileRequest& request, uint64_t& fileSize);
+	void CloseFile(FileRequest& request);
+	void Submit(Operation* operation);
+	// Flushes submitted operations and blocks until one completes - null if I/O thread was woken up instead
+	Operation* WaitOperation();
+	void Wake();
+	void ThreadPoolReaderLoop();
+
+private:
+	Settings m_settings;
+	Backend m_backend = Backend::ThreadPool;
+	std::unique_ptr<Platform> m_platform;
+	std::thread m_ioThread;
+	std::vector<std::thread> m_callbackThreads;
+
+	// Requests not opened yet - only I/O thread takes them
+	std::mutex m_mutex;
+	std::deque<std::unique_ptr<FileRequest>> m_waitingRequests;
+	bool m_stopping = false;
+
+	// Owned by I/O thread - next request is already open, waiting for its bytes to fit into the limit
+	std::unique_ptr<FileRequest> m_nextRequest;
+	std::vector<std::unique_ptr<FileRequest>> m_openRequests;
+	std::deque<Operation*> m_readyOperations;
+	size_t m_operationsInFlight = 0;
+
+	// Finished files waiting for callback threads
+	std::mutex m_callbackMutex;
+	std::condition_variable m_callbackCondition;
+	std::deque<std::unique_ptr<FileRequest>> m_finishedRequests;
+	bool m_callbacksStopping = false;
+
+	std::atomic<size_t> m_bytesInFlight{ 0 };
+	std::mutex m_idleMutex;
+	std::condition_variable m_idleCondition;
+	size_t m_outstanding = 0;
+};
+
+#endif // !_ASYNC_FILE_READER_H_
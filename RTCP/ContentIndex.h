@@ -0,0 +1,127 @@
+#pragma once
+#ifndef _CONTENT_INDEX_H_
+#define _CONTENT_INDEX_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Finds registered files with the same content as a new one. Doesn't depend on Windows or D3D12 headers, like GeometryCodec.
+// Files of different size can't have the same content - file is hashed only once another registered file has its size, and at most once.
+// Hashing runs outside of the lock, so reading one file doesn't block lookups of others. Values are compared with operator==.
+template<typename Value>
+class ContentIndex
+{
+public:
+	// Returns content hash of file, 0 if it can't be read - such files never match
+	typedef std::function<uint64_t(const std::string& path)> HashFunction;
+
+	explicit ContentIndex(HashFunction hashFunction) : m_hashFunction(std::move(hashFunction)) {}
+	ContentIndex(const ContentIndex&) = delete;
+	ContentIndex& operator=(const ContentIndex&) = delete;
+
+	// Registers value of file with given path and size - returns true and a registered value with the same content, if there is one
+	bool Insert(const std::string& path, uint64_t fileSize, const Value& value, Value& sameContent)
+	{
+		std::shared_ptr<Node> node = std::make_shared<Node>();
+		node->path = path;
+		node->value = value;
+
+		std::vector<std::shared_ptr<Node>> sameSize;
+		{
+			std::lock_guard<std::mutex> lock{ m_mutex };
+			const auto range = m_nodesBySize.equal_range(fileSize);
+			for (auto it = range.first; it != range.second; ++it)
+			{
+				sameSize.push_back(it->second);
+			}
+			m_nodesBySize.emplace(fileSize, node);
+		}
+		if (sameSize.empty()) {
+			return false;
+		}
+
+		const uint64_t contentHash = GetHash(*node);
+		if (contentHash == 0) {
+			return false;
+		}
+		for (const std::shared_ptr<Node>& candidate : sameSize)
+		{
+			if (GetHash(*candidate) == contentHash)
+			{
+				sameContent = candidate->value;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Removes value registered with given file size
+	void Erase(uint64_t fileSize, const Value& value)
+	{
+		std::lock_guard<std::mutex> lock{ m_mutex };
+		const auto range = m_nodesBySize.equal_range(fileSize);
+		for (auto it = range.first; it != range.second; ++it)
+		{
+			if (it->second->value == value)
+			{
+				m_nodesBySize.erase(it);
+				return;
+			}
+		}
+	}
+
+	// Files read for content hash, because another registered file had the same size
+	uint64_t GetHashedFileCount() const
+	{
+		std::lock_guard<std::mutex> lock{ m_mutex };
+		return m_hashedFileCount;
+	}
+
+	size_t GetSize() const
+	{
+		std::lock_guard<std::mutex> lock{ m_mutex };
+		return m_nodesBySize.size();
+	}
+
+private:
+	struct Node {
+		std::string path;
+		Value value{};
+		uint64_t contentHash = 0;
+		bool hashed = false;
+	};
+
+	uint64_t GetHash(Node& node)
+	{
+		{
+			std::lock_guard<std::mutex> lock{ m_mutex };
+			if (node.hashed) {
+				return node.contentHash;
+			}
+		}
+
+		// Two threads may hash the same file at once, both get the same result and it's counted once
+		const uint64_t contentHash = m_hashFunction(node.path);
+		std::lock_guard<std::mutex> lock{ m_mutex };
+		if (!node.hashed)
+		{
+			node.contentHash = contentHash;
+			node.hashed = true;
+			++m_hashedFileCount;
+		}
+		return node.contentHash;
+	}
+
+private:
+	const HashFunction m_hashFunction;
+	mutable std::mutex m_mutex;
+	std::unordered_multimap<uint64_t, std::shared_ptr<Node>> m_nodesBySize;
+	uint64_t m_hashedFileCount = 0;
+};
+
+#endif // !_CONTENT_INDEX_H_
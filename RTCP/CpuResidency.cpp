@@ -0,0 +1,40 @@
+#include "CpuResidency.h"
+#include <cstring>
+
+CpuGeometryCounts CpuResidencyPolicy::Apply(CpuResidency residency, const CpuGeometryCounts& counts)
+{
+	CpuGeometryCounts result{};
+	if (KeepsVertices(residency)) {
+		result.vertices = counts.vertices;
+	}
+	if (KeepsPositions(residency))
+	{
+		// Positions are read from kept vertices, or copied out of them before they are released
+		result.positions = KeepsVertices(residency) || counts.vertices == 0 ? counts.positions : counts.vertices;
+	}
+	if (KeepsIndices(residency))
+	{
+		result.indices = counts.indices;
+		result.lodIndices = counts.lodIndices;
+	}
+	return result;
+}
+
+CpuResidencyPolicy::Bytes CpuResidencyPolicy::GetBytes(const CpuGeometryCounts& counts, size_t vertexSize, size_t indexSize)
+{
+	Bytes bytes;
+	bytes.vertices = vertexSize * counts.vertices;
+	bytes.positions = 3 * sizeof(float) * counts.positions;
+	bytes.indices = indexSize * (counts.indices + counts.lodIndices);
+	return bytes;
+}
+
+void CpuResidencyPolicy::ExtractPositions(const void* vertices, size_t vertexCount, size_t vertexStride, size_t positionOffset, float* positions)
+{
+	const uint8_t* position = static_cast<const uint8_t*>(vertices) + positionOffset;
+	for (size_t i = 0; i < vertexCount; ++i)
+	{
+		memcpy(positions + 3 * i, position, 3 * sizeof(float));
+		position += vertexStride;
+	}
+}
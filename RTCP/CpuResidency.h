@@ -0,0 +1,49 @@
+#pragma once
+#ifndef _CPU_RESIDENCY_H_
+#define _CPU_RESIDENCY_H_
+
+#include <cstddef>
+#include <cstdint>
+
+// CPU copies of geometry kept once model is loaded and its buffers are uploaded
+enum class CpuResidency
+{
+	Full,					// Every vertex attribute and index
+	PositionsAndIndices,	// Positions, base and LOD indices - enough for CPU side queries
+	None					// Only counts, ranges and bounds
+};
+
+// Element counts of CPU geometry arrays held by model
+struct CpuGeometryCounts {
+	uint64_t vertices;		// Full vertices with every attribute
+	uint64_t positions;		// Positions copied out of vertices, once vertices are released
+	uint64_t indices;
+	uint64_t lodIndices;
+};
+
+// What each CpuResidency keeps and how many bytes it holds, applied by ModelClass after upload. Doesn't depend on Windows or D3D12 headers, like IndexCompactor.
+class CpuResidencyPolicy
+{
+public:
+	struct Bytes {
+		uint64_t vertices;
+		uint64_t positions;
+		uint64_t indices;		// Base and LOD indices
+		uint64_t GetTotal() const { return vertices + positions + indices; }
+	};
+
+	static bool KeepsVertices(CpuResidency residency) { return residency == CpuResidency::Full; }
+	static bool KeepsPositions(CpuResidency residency) { return residency != CpuResidency::None; }
+	// Base and LOD indices - LOD ranges index LOD indices, so they are released with them
+	static bool KeepsIndices(CpuResidency residency) { return residency != CpuResidency::None; }
+
+	// Counts left once residency is applied to geometry - positions are copied out of vertices only when vertices are released
+	static CpuGeometryCounts Apply(CpuResidency residency, const CpuGeometryCounts& counts);
+	// Positions are 3 floats each, vertices and indices of given size
+	static Bytes GetBytes(const CpuGeometryCounts& counts, size_t vertexSize, size_t indexSize = sizeof(uint32_t));
+
+	// Copies 3 floats at positionOffset of every vertex into tightly packed array
+	static void ExtractPositions(const void* vertices, size_t vertexCount, size_t vertexStride, size_t positionOffset, float* positions);
+};
+
+#endif // !_CPU_RESIDENCY_H_
@@ -0,0 +1,412 @@
+// GeometryBench.cpp - rtcp-geombench entry point, benchmarks of portable geometry processing and codec on generated scenes or OBJ files.
+// Depends only on the standard library and portable modules, so it builds outside of Visual Studio as well:
+//   g++ -std=c++14 -O2 -DNDEBUG -pthread GeometryBench.cpp GeometryCodec.cpp MeshOptimizer.cpp SceneGenerator.cpp -o rtcp-geombench
+
+#include "GeometryCodec.h"
+#include "MeshOptimizer.h"
+#include "SceneGenerator.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+namespace
+{
+	typedef SceneGenerator::Vertex Vertex;
+
+	// Indices are local to the mesh, like MeshOptimizer expects
+	struct Mesh
+	{
+		std::vector<Vertex> vertices;
+		std::vector<uint32_t> indices;
+	};
+
+	struct Options
+	{
+		std::string command;
+		std::string objPath;
+		SceneGenerator::Settings scene;
+		bool shuffle = false;
+		unsigned int cacheSize = MeshOptimizer::DEFAULT_CACHE_SIZE;
+		unsigned int runCount = 3;
+		unsigned int threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+	};
+
+	// Vertex per unique position/uv/normal triplet, polygons are fanned - enough for cube.obj and sphere.obj, not a general OBJ reader
+	bool LoadObj(const std::string& path, Mesh& mesh)
+	{
+		std::ifstream file{ path };
+		if (!file) {
+			return false;
+		}
+
+		std::vector<float> positions;
+		std::vector<float> uvs;
+		std::vector<float> normals;
+		std::map<std::tuple<int, int, int>, uint32_t> vertexIds;
+		std::string line;
+		while (std::getline(file, line))
+		{
+			std::istringstream stream{ line };
+			std::string type;
+			stream >> type;
+			float x = 0.0f, y = 0.0f, z = 0.0f;
+			if (type == "v" && stream >> x >> y >> z) {
+				positions.insert(positions.end(), { x, y, z });
+			}
+			else if (type == "vt" && stream >> x >> y) {
+				uvs.insert(uvs.end(), { x, y });
+			}
+			else if (type == "vn" && stream >> x >> y >> z) {
+				normals.insert(normals.end(), { x, y, z });
+			}
+			else if (type == "f")
+			{
+				std::vector<uint32_t> polygon;
+				std::string corner;
+				while (stream >> corner)
+				{
+					// v, v/vt, v//vn or v/vt/vn - missing parts stay 0
+					int ids[3] = { 0, 0, 0 };
+					size_t part = 0;
+					for (size_t begin = 0; begin <= corner.size() && part < 3; ++part)
+					{
+						const size_t end = std::min(corner.find('/', begin), corner.size());
+						ids[part] = end > begin ? atoi(corner.substr(begin, end - begin).c_str()) : 0;
+						begin = end + 1;
+					}
+					if (ids[0] <= 0 || static_cast<size_t>(ids[0]) * 3 > positions.size() || static_cast<size_t>(ids[1]) * 2 > uvs.size() || static_cast<size_t>(ids[2]) * 3 > normals.size()) {
+						return false;
+					}
+
+					const auto key = std::make_tuple(ids[0], ids[1], ids[2]);
+					auto it = vertexIds.find(key);
+					if (it == vertexIds.end())
+					{
+						Vertex vertex = {};
+						memcpy(vertex.position, &positions[(ids[0] - 1) * 3], sizeof(vertex.position));
+						if (ids[1] > 0) {
+							memcpy(vertex.uv, &uvs[(ids[1] - 1) * 2], sizeof(vertex.uv));
+						}
+						if (ids[2] > 0) {
+							memcpy(vertex.normal, &normals[(ids[2] - 1) * 3], sizeof(vertex.normal));
+						}
+						it = vertexIds.emplace(key, static_cast<uint32_t>(mesh.vertices.size())).first;
+						mesh.vertices.push_back(vertex);
+					}
+					polygon.push_back(it->second);
+				}
+				for (size_t i = 1; i + 1 < polygon.size(); ++i)
+				{
+					mesh.indices.insert(mesh.indices.end(), { polygon[0], polygon[i], polygon[i + 1] });
+				}
+			}
+		}
+		return !mesh.indices.empty();
+	}
+
+	std::vector<Mesh> GenerateMeshes(const SceneGenerator::Settings& settings)
+	{
+		const SceneGenerator::Scene scene = SceneGenerator::Generate(settings);
+		std::vector<Mesh> meshes(scene.layout.meshes.size());
+		for (size_t i = 0; i < meshes.size(); ++i)
+		{
+			const SceneGenerator::MeshRange& range = scene.layout.meshes[i];
+			meshes[i].vertices.assign(scene.vertices.begin() + range.vertexOffset, scene.vertices.begin() + range.vertexOffset + range.vertexCount);
+			meshes[i].indices.assign(scene.indices.begin() + range.indexOffset, scene.indices.begin() + range.indexOffset + range.indexCount);
+			for (uint32_t& index : meshes[i].indices)
+			{
+				index -= range.vertexOffset;
+			}
+		}
+		return meshes;
+	}
+
+	// Fisher-Yates over triangles with fixed seed - stands in for import order which follows no locality at all
+	void ShuffleTriangles(Mesh& mesh)
+	{
+		std::mt19937 random{ 1 };
+		const size_t triangleCount = mesh.indices.size() / 3;
+		for (size_t i = triangleCount; i > 1; --i)
+		{
+			const size_t other = random() % i;
+			std::swap_ranges(&mesh.indices[(i - 1) * 3], &mesh.indices[(i - 1) * 3] + 3, &mesh.indices[other * 3]);
+		}
+	}
+
+	double GetMedian(std::vector<double> times)
+	{
+		std::sort(times.begin(), times.end());
+		return times[times.size() / 2];
+	}
+
+	// Misses are summed over meshes, so ratios of large meshes weigh more
+	MeshOptimizer::VertexCacheStatistics AnalyzeMeshes(const std::vector<Mesh>& meshes, unsigned int cacheSize, MeshOptimizer::CacheModel model)
+	{
+		MeshOptimizer::VertexCacheStatistics total{};
+		for (const Mesh& mesh : meshes)
+		{
+			const MeshOptimizer::VertexCacheStatistics statistics = MeshOptimizer::AnalyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size(), cacheSize, model);
+			total.triangleCount += statistics.triangleCount;
+			total.vertexCount += statistics.vertexCount;
+			total.cacheMisses += statistics.cacheMisses;
+		}
+		total.acmr = total.triangleCount > 0 ? static_cast<float>(total.cacheMisses) / total.triangleCount : 0.0f;
+		total.atvr = total.vertexCount > 0 ? static_cast<float>(total.cacheMisses) / total.vertexCount : 0.0f;
+		return total;
+	}
+
+	// Reorders triangles for vertex cache and vertices for fetch, like ModelClass::OptimizeMesh - reports ACMR/ATVR of FIFO and LRU cache before and after
+	void BenchmarkVertexCache(const Options& options, const std::vector<Mesh>& meshes)
+	{
+		printf("%-6s %-10s %8s %8s    cache of %u\n", "cache", "order", "acmr", "atvr", options.cacheSize);
+		std::vector<Mesh> optimized;
+		std::vector<double> times;
+		for (unsigned int run = 0; run < options.runCount; ++run)
+		{
+			optimized = meshes;
+			const auto startTime = std::chrono::high_resolution_clock::now();
+			for (Mesh& mesh : optimized)
+			{
+				MeshOptimizer::OptimizeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size(), options.cacheSize);
+				MeshOptimizer::OptimizeVertexFetch(mesh.vertices.data(), mesh.vertices.size(), sizeof(Vertex), mesh.indices.data(), mesh.indices.size());
+			}
+			const std::chrono::duration<double, std::milli> time = std::chrono::high_resolution_clock::now() - startTime;
+			times.push_back(time.count());
+		}
+
+		for (MeshOptimizer::CacheModel model : { MeshOptimizer::CacheModel::Fifo, MeshOptimizer::CacheModel::Lru })
+		{
+			const char* modelName = model == MeshOptimizer::CacheModel::Fifo ? "fifo" : "lru";
+			const MeshOptimizer::VertexCacheStatistics before = AnalyzeMeshes(meshes, options.cacheSize, model);
+			const MeshOptimizer::VertexCacheStatistics after = AnalyzeMeshes(optimized, options.cacheSize, model);
+			printf("%-6s %-10s %8.3f %8.3f\n", modelName, "input", before.acmr, before.atvr);
+			printf("%-6s %-10s %8.3f %8.3f\n", modelName, "optimized", after.acmr, after.atvr);
+		}
+
+		size_t triangleCount = 0;
+		for (const Mesh& mesh : meshes)
+		{
+			triangleCount += mesh.indices.size() / 3;
+		}
+		const double time = GetMedian(times);
+		printf("optimized in %.2f ms (median of %u runs), %.2f M triangles/s on one thread\n", time, options.runCount, triangleCount / (time * 1000.0));
+	}
+
+	// Threads pull indices from shared counter, like ThreadPool::ParallelFor - threads are started by every call, which costs tens of microseconds
+	GeometryCodec::ParallelFor CreateParallelFor(unsigned int threadCount)
+	{
+		return [threadCount](size_t count, const std::function<void(size_t)>& func)
+		{
+			std::atomic<size_t> nextIndex{ 0 };
+			auto work = [&]()
+			{
+				for (size_t i = nextIndex++; i < count; i = nextIndex++)
+				{
+					func(i);
+				}
+			};
+			std::vector<std::thread> threads;
+			for (unsigned int i = 1; i < std::min<size_t>(threadCount, count); ++i)
+			{
+				threads.emplace_back(work);
+			}
+			work();
+			for (std::thread& thread : threads)
+			{
+				thread.join();
+			}
+		};
+	}
+
+	// Whole model in two streams, like mesh cache stores it - decode throughput is in decoded bytes per second
+	void BenchmarkCodec(const Options& options, const std::vector<Mesh>& meshes)
+	{
+		std::vector<Vertex> vertices;
+		std::vector<uint32_t> indices;
+		for (const Mesh& mesh : meshes)
+		{
+			const uint32_t vertexOffset = static_cast<uint32_t>(vertices.size());
+			vertices.insert(vertices.end(), mesh.vertices.begin(), mesh.vertices.end());
+			for (uint32_t index : mesh.indices)
+			{
+				indices.push_back(vertexOffset + index);
+			}
+		}
+		const size_t vertexBytes = vertices.size() * sizeof(Vertex);
+		const size_t indexBytes = indices.size() * sizeof(uint32_t);
+
+		std::vector<uint8_t> encodedVertices;
+		std::vector<uint8_t> encodedIndices;
+		const auto encodeStart = std::chrono::high_resolution_clock::now();
+		GeometryCodec::EncodeVertices(vertices.data(), vertices.size(), sizeof(Vertex), encodedVertices);
+		GeometryCodec::EncodeIndices(indices.data(), indices.size(), encodedIndices);
+		const std::chrono::duration<double, std::milli> encodeTime = std::chrono::high_resolution_clock::now() - encodeStart;
+
+		std::vector<Vertex> decodedVertices(vertices.size());
+		std::vector<uint32_t> decodedIndices(indices.size());
+		const GeometryCodec::ParallelFor parallelFor = options.threadCount > 1 ? CreateParallelFor(options.threadCount) : nullptr;
+		bool decoded = true;
+		std::vector<double> vertexTimes[2];
+		std::vector<double> indexTimes[2];
+		for (unsigned int run = 0; run < options.runCount; ++run)
+		{
+			for (int parallel = 0; parallel < 2; ++parallel)
+			{
+				const GeometryCodec::ParallelFor& decodeParallelFor = parallel ? parallelFor : nullptr;
+				const auto vertexStart = std::chrono::high_resolution_clock::now();
+				decoded = GeometryCodec::DecodeVertices(encodedVertices.data(), encodedVertices.size(), decodedVertices.data(), decodedVertices.size(), sizeof(Vertex), decodeParallelFor) && decoded;
+				const auto indexStart = std::chrono::high_resolution_clock::now();
+				decoded = GeometryCodec::DecodeIndices(encodedIndices.data(), encodedIndices.size(), decodedIndices.data(), decodedIndices.size(), decodeParallelFor) && decoded;
+				const auto indexEnd = std::chrono::high_resolution_clock::now();
+				vertexTimes[parallel].push_back(std::chrono::duration<double>(indexStart - vertexStart).count());
+				indexTimes[parallel].push_back(std::chrono::duration<double>(indexEnd - indexStart).count());
+			}
+		}
+		// Triangles may start with different corner, so only vertices are compared bit by bit
+		decoded = decoded && (vertices.empty() || memcmp(vertices.data(), decodedVertices.data(), vertexBytes) == 0);
+
+		printf("%-8s %10s %10s %8s %12s %12s\n", "stream", "raw MB", "coded MB", "ratio", "1 thread", (std::to_string(options.threadCount) + (options.threadCount > 1 ? " threads" : " thread")).c_str());
+		const double gigabyte = 1024.0 * 1024.0 * 1024.0;
+		const double megabyte = 1024.0 * 1024.0;
+		printf("%-8s %10.2f %10.2f %7.1f%% %7.2f GB/s %7.2f GB/s\n", "vertices", vertexBytes / megabyte, encodedVertices.size() / megabyte, vertexBytes > 0 ? 100.0 * encodedVertices.size() / vertexBytes : 100.0,
+			vertexBytes / gigabyte / GetMedian(vertexTimes[0]), vertexBytes / gigabyte / GetMedian(vertexTimes[1]));
+		printf("%-8s %10.2f %10.2f %7.1f%% %7.2f GB/s %7.2f GB/s\n", "indices", indexBytes / megabyte, encodedIndices.size() / megabyte, indexBytes > 0 ? 100.0 * encodedIndices.size() / indexBytes : 100.0,
+			indexBytes / gigabyte / GetMedian(indexTimes[0]), indexBytes / gigabyte / GetMedian(indexTimes[1]));
+		printf("encoded in %.2f ms, %.2f bits per triangle, %zu vertex and %zu index chunks, median of %u runs, round trip %s\n", encodeTime.count(),
+			indices.empty() ? 0.0 : 8.0 * encodedIndices.size() / (indices.size() / 3), GeometryCodec::GetVertexChunkCount(vertices.size()), GeometryCodec::GetIndexChunkCount(indices.size()),
+			options.runCount, decoded ? "ok" : "FAILED");
+	}
+
+	void PrintUsage()
+	{
+		fprintf(stderr,
+			"Usage: rtcp-geombench <command> [--obj <path>] [--triangles <count>] [--meshes <count>] [--seed <seed>] [--distribution uniform|clustered|longthin]\n"
+			"                      [--shuffle] [--cache <size>] [--runs <count>] [--threads <count>]\n"
+			"Commands:\n"
+			"  vcache             vertex cache and fetch optimization, ACMR/ATVR of simulated FIFO and LRU cache before and after\n"
+			"  codec              geometry codec of whole model, compression ratio and decode throughput on one and all threads\n"
+			"Geometry is a generated scene (1M triangles in 256 meshes by default), or single mesh of OBJ file.\n"
+			"  --shuffle          shuffle triangles of every mesh before benchmark - generated patches are already in grid order\n"
+			"  --cache <size>     vertex cache entries, 16 by default\n"
+			"  --runs <count>     timed runs, median is reported, 3 by default\n"
+			"  --threads <count>  threads decoding codec chunks, one per hardware thread by default\n");
+	}
+
+	bool ParseOptions(int argc, char* argv[], Options& options)
+	{
+		if (argc < 2) {
+			return false;
+		}
+		options.command = argv[1];
+		for (int i = 2; i < argc; ++i)
+		{
+			const std::string argument = argv[i];
+			const bool hasValue = i + 1 < argc;
+			if (argument == "--obj" && hasValue) {
+				options.objPath = argv[++i];
+			}
+			else if (argument == "--triangles" && hasValue) {
+				options.scene.triangleCount = std::max<size_t>(strtoull(argv[++i], nullptr, 10), 1000);
+			}
+			else if (argument == "--meshes" && hasValue) {
+				options.scene.meshCount = std::max<size_t>(strtoull(argv[++i], nullptr, 10), 1);
+				options.scene.instanceCount = options.scene.meshCount;
+			}
+			else if (argument == "--seed" && hasValue) {
+				options.scene.seed = strtoull(argv[++i], nullptr, 10);
+			}
+			else if (argument == "--distribution" && hasValue)
+			{
+				const std::string distribution = argv[++i];
+				if (distribution == "uniform") {
+					options.scene.distribution = SceneGenerator::Distribution::Uniform;
+				}
+				else if (distribution == "clustered") {
+					options.scene.distribution = SceneGenerator::Distribution::Clustered;
+				}
+				else if (distribution == "longthin") {
+					options.scene.distribution = SceneGenerator::Distribution::LongThin;
+				}
+				else {
+					return false;
+				}
+			}
+			else if (argument == "--shuffle") {
+				options.shuffle = true;
+			}
+			else if (argument == "--cache" && hasValue) {
+				options.cacheSize = std::max(1, atoi(argv[++i]));
+			}
+			else if (argument == "--runs" && hasValue) {
+				options.runCount = std::max(1, atoi(argv[++i]));
+			}
+			else if (argument == "--threads" && hasValue) {
+				options.threadCount = std::max(1, atoi(argv[++i]));
+			}
+			else {
+				return false;
+			}
+		}
+		return options.command == "vcache" || options.command == "codec";
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	Options options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	std::vector<Mesh> meshes;
+	std::string source;
+	if (!options.objPath.empty())
+	{
+		meshes.resize(1);
+		if (!LoadObj(options.objPath, meshes[0]))
+		{
+			fprintf(stderr, "rtcp-geombench: failed to load %s\n", options.objPath.c_str());
+			return 1;
+		}
+		source = options.objPath;
+	}
+	else
+	{
+		meshes = GenerateMeshes(options.scene);
+		source = "generated scene, seed " + std::to_string(options.scene.seed);
+	}
+
+	size_t vertexCount = 0;
+	size_t triangleCount = 0;
+	for (Mesh& mesh : meshes)
+	{
+		if (options.shuffle) {
+			ShuffleTriangles(mesh);
+		}
+		vertexCount += mesh.vertices.size();
+		triangleCount += mesh.indices.size() / 3;
+	}
+	printf("rtcp-geombench %s: %s%s, %zu meshes, %zu triangles, %zu vertices\n", options.command.c_str(), source.c_str(), options.shuffle ? " (shuffled)" : "",
+		meshes.size(), triangleCount, vertexCount);
+
+	if (options.command == "vcache") {
+		BenchmarkVertexCache(options, meshes);
+	}
+	else {
+		BenchmarkCodec(options, meshes);
+	}
+	return 0;
+}
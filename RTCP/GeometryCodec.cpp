@@ -0,0 +1,548 @@
+#include "GeometryCodec.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <emmintrin.h>
+
+namespace
+{
+	inline uint8_t ZigZag8(uint8_t value)
+	{
+		return static_cast<uint8_t>((value << 1) ^ static_cast<uint8_t>(static_cast<int8_t>(value) >> 7));
+	}
+
+	inline uint32_t ZigZag32(int32_t value)
+	{
+		return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+	}
+
+	inline int32_t UnZigZag32(uint32_t value)
+	{
+		return static_cast<int32_t>((value >> 1) ^ (0u - (value & 1)));
+	}
+
+	void WriteVarint(uint32_t value, std::vector<uint8_t>& data)
+	{
+		while (value >= 0x80)
+		{
+			data.push_back(static_cast<uint8_t>(value | 0x80));
+			value >>= 7;
+		}
+		data.push_back(static_cast<uint8_t>(value));
+	}
+
+	inline void WriteUint32(uint32_t value, uint8_t* data)
+	{
+		memcpy(data, &value, sizeof(value));
+	}
+
+	inline uint32_t ReadUint32(const uint8_t* data)
+	{
+		uint32_t value;
+		memcpy(&value, data, sizeof(value));
+		return value;
+	}
+
+	bool ReadVarint(const uint8_t*& data, const uint8_t* end, uint32_t& value)
+	{
+		value = 0;
+		for (uint32_t shift = 0; shift < 35; shift += 7)
+		{
+			if (data == end) {
+				return false;
+			}
+			const uint8_t byte = *data++;
+			value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+			if ((byte & 0x80) == 0) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Group of 16 values packed with 0, 2, 4 or 8 bits - mode 0 stores nothing
+	inline size_t GetGroupSize(uint32_t mode)
+	{
+		return mode == 0 ? 0 : 2u << mode;
+	}
+
+	void WriteGroup(const uint8_t* values, uint32_t mode, std::vector<uint8_t>& data)
+	{
+		switch (mode)
+		{
+		case 1:
+			for (size_t i = 0; i < 16; i += 4)
+			{
+				data.push_back(static_cast<uint8_t>((values[i] << 6) | (values[i + 1] << 4) | (values[i + 2] << 2) | values[i + 3]));
+			}
+			break;
+		case 2:
+			for (size_t i = 0; i < 16; i += 2)
+			{
+				data.push_back(static_cast<uint8_t>((values[i] << 4) | values[i + 1]));
+			}
+			break;
+		case 3:
+			data.insert(data.end(), values, values + 16);
+			break;
+		default:
+			break;
+		}
+	}
+
+	inline __m128i ReadGroup(const uint8_t* data, uint32_t mode)
+	{
+		switch (mode)
+		{
+		case 1:
+		{
+			// Value 4j + k is stored in bits 7 - 2k of byte j
+			int32_t packed;
+			memcpy(&packed, data, sizeof(packed));
+			const __m128i bytes = _mm_cvtsi32_si128(packed);
+			const __m128i mask = _mm_set1_epi8(3);
+			const __m128i v0 = _mm_and_si128(_mm_srli_epi16(bytes, 6), mask);
+			const __m128i v1 = _mm_and_si128(_mm_srli_epi16(bytes, 4), mask);
+			const __m128i v2 = _mm_and_si128(_mm_srli_epi16(bytes, 2), mask);
+			const __m128i v3 = _mm_and_si128(bytes, mask);
+			return _mm_unpacklo_epi16(_mm_unpacklo_epi8(v0, v1), _mm_unpacklo_epi8(v2, v3));
+		}
+		case 2:
+		{
+			// Value 2j is high nibble of byte j
+			const __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(data));
+			const __m128i mask = _mm_set1_epi8(15);
+			return _mm_unpacklo_epi8(_mm_and_si128(_mm_srli_epi16(bytes, 4), mask), _mm_and_si128(bytes, mask));
+		}
+		case 3:
+			return _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+		default:
+			return _mm_setzero_si128();
+		}
+	}
+
+	// Zigzag decoded deltas are summed into values, carry holds previous value in every byte
+	inline __m128i AccumulateGroup(__m128i zigzag, __m128i carry)
+	{
+		const __m128i sign = _mm_sub_epi8(_mm_setzero_si128(), _mm_and_si128(zigzag, _mm_set1_epi8(1)));
+		__m128i values = _mm_xor_si128(_mm_and_si128(_mm_srli_epi16(zigzag, 1), _mm_set1_epi8(0x7F)), sign);
+		values = _mm_add_epi8(values, _mm_slli_si128(values, 1));
+		values = _mm_add_epi8(values, _mm_slli_si128(values, 2));
+		values = _mm_add_epi8(values, _mm_slli_si128(values, 4));
+		values = _mm_add_epi8(values, _mm_slli_si128(values, 8));
+		return _mm_add_epi8(values, carry);
+	}
+
+	// Stream is version byte, vertex or index count, table of chunkCount entries starting with end offset of chunk and chunk data
+	constexpr size_t STREAM_HEADER_SIZE = 1 + sizeof(uint32_t);
+
+	void WriteStreamHeader(uint8_t version, size_t count, size_t tableSize, std::vector<uint8_t>& data)
+	{
+		assert(count <= UINT32_MAX && "Too many elements for geometry codec");
+		const size_t offset = data.size();
+		data.resize(offset + STREAM_HEADER_SIZE + tableSize, 0);
+		data[offset] = version;
+		WriteUint32(static_cast<uint32_t>(count), data.data() + offset + 1);
+	}
+
+	bool IsStreamHeaderValid(const uint8_t* data, size_t dataSize, uint8_t version, size_t count, size_t tableSize)
+	{
+		return dataSize >= STREAM_HEADER_SIZE + tableSize && data[0] == version && ReadUint32(data + 1) == count;
+	}
+
+	// Last chunk has to end exactly at the end of stream
+	bool GetChunk(const uint8_t* data, size_t dataSize, uint8_t version, size_t count, size_t entrySize, size_t chunkCount, size_t chunk, const uint8_t*& begin, const uint8_t*& end)
+	{
+		const size_t tableSize = entrySize * chunkCount;
+		if (chunk >= chunkCount || !IsStreamHeaderValid(data, dataSize, version, count, tableSize)) {
+			return false;
+		}
+		const uint8_t* table = data + STREAM_HEADER_SIZE;
+		const size_t chunksSize = dataSize - STREAM_HEADER_SIZE - tableSize;
+		const size_t chunkBegin = chunk == 0 ? 0 : ReadUint32(table + entrySize * (chunk - 1));
+		const size_t chunkEnd = ReadUint32(table + entrySize * chunk);
+		if (chunkBegin > chunkEnd || chunkEnd > chunksSize || (chunk + 1 == chunkCount && chunkEnd != chunksSize)) {
+			return false;
+		}
+		begin = table + tableSize + chunkBegin;
+		end = table + tableSize + chunkEnd;
+		return true;
+	}
+
+	template<typename DecodeChunk>
+	bool DecodeChunks(size_t chunkCount, const GeometryCodec::ParallelFor& parallelFor, const DecodeChunk& decodeChunk)
+	{
+		std::vector<uint8_t> chunkDecoded(chunkCount, 0);
+		const std::function<void(size_t)> decode = [&](size_t chunk) { chunkDecoded[chunk] = decodeChunk(chunk) ? 1 : 0; };
+		if (parallelFor && chunkCount > 1) {
+			parallelFor(chunkCount, decode);
+		}
+		else
+		{
+			for (size_t chunk = 0; chunk < chunkCount; ++chunk)
+			{
+				decode(chunk);
+			}
+		}
+		return std::find(chunkDecoded.begin(), chunkDecoded.end(), 0) == chunkDecoded.end();
+	}
+
+	// FIFOs of index codec, shared by encoder and decoder - entry 0 is the most recently pushed one
+	struct IndexCodecState
+	{
+		uint32_t edges[16][2] = {};
+		uint32_t vertices[16] = {};
+		uint32_t edgeOffset = 0;
+		uint32_t vertexOffset = 0;
+		uint32_t next = 0;		// Expected new vertex - vertex fetch optimized meshes introduce vertices in order
+		uint32_t last = 0;		// Last explicitly coded vertex
+
+		void PushEdge(uint32_t a, uint32_t b)
+		{
+			edges[edgeOffset & 15][0] = a;
+			edges[edgeOffset & 15][1] = b;
+			++edgeOffset;
+		}
+		const uint32_t* GetEdge(uint32_t index) const { return edges[(edgeOffset - 1 - index) & 15]; }
+
+		void PushVertex(uint32_t vertex)
+		{
+			vertices[vertexOffset & 15] = vertex;
+			++vertexOffset;
+		}
+		uint32_t GetVertex(uint32_t index) const { return vertices[(vertexOffset - 1 - index) & 15]; }
+
+		// Edges shared with neighbours, as the neighbours traverse them
+		void PushTriangleEdges(uint32_t a, uint32_t b, uint32_t c)
+		{
+			PushEdge(a, c);
+			PushEdge(c, b);
+		}
+	};
+
+	// Vertex code - 0 is next new vertex, 1-14 vertex FIFO entry, 15 explicit vertex stored as varint delta from the last one
+	constexpr uint32_t VERTEX_CODE_NEXT = 0;
+	constexpr uint32_t VERTEX_CODE_EXPLICIT = 15;
+	constexpr uint32_t VERTEX_FIFO_CODES = 14;
+	// Edge code - 0-14 edge FIFO entry, 15 triangle without cached edge
+	constexpr uint32_t EDGE_CODE_NONE = 15;
+
+	uint32_t EncodeVertex(uint32_t vertex, IndexCodecState& state, std::vector<uint8_t>& explicitVertices)
+	{
+		if (vertex == state.next)
+		{
+			++state.next;
+			state.PushVertex(vertex);
+			return VERTEX_CODE_NEXT;
+		}
+		for (uint32_t i = 0; i < VERTEX_FIFO_CODES; ++i)
+		{
+			if (state.GetVertex(i) == vertex) {
+				return 1 + i;
+			}
+		}
+		WriteVarint(ZigZag32(static_cast<int32_t>(vertex - state.last)), explicitVertices);
+		state.last = vertex;
+		state.PushVertex(vertex);
+		return VERTEX_CODE_EXPLICIT;
+	}
+
+	bool DecodeVertex(uint32_t code, IndexCodecState& state, const uint8_t*& data, const uint8_t* end, uint32_t& vertex)
+	{
+		if (code == VERTEX_CODE_NEXT)
+		{
+			vertex = state.next++;
+			state.PushVertex(vertex);
+			return true;
+		}
+		if (code != VERTEX_CODE_EXPLICIT)
+		{
+			vertex = state.GetVertex(code - 1);
+			return true;
+		}
+		uint32_t delta;
+		if (!ReadVarint(data, end, delta)) {
+			return false;
+		}
+		vertex = state.last + static_cast<uint32_t>(UnZigZag32(delta));
+		state.last = vertex;
+		state.PushVertex(vertex);
+		return true;
+	}
+}
+
+void GeometryCodec::EncodeVertices(const void* vertices, size_t vertexCount, size_t vertexStride, std::vector<uint8_t>& data)
+{
+	assert(vertexStride > 0 && vertexStride <= MAX_VERTEX_STRIDE && "Unsupported vertex stride");
+
+	const uint8_t* source = static_cast<const uint8_t*>(vertices);
+	const size_t chunkCount = GetVertexChunkCount(vertexCount);
+	const size_t tableOffset = data.size() + STREAM_HEADER_SIZE;
+	WriteStreamHeader(VERTEX_STREAM_VERSION, vertexCount, sizeof(uint32_t) * chunkCount, data);
+	const size_t chunksOffset = data.size();
+
+	uint8_t deltas[BLOCK_VERTICES];
+	for (size_t chunk = 0; chunk < chunkCount; ++chunk)
+	{
+		// Deltas start from zero in every chunk
+		uint8_t previous[MAX_VERTEX_STRIDE] = {};
+		const size_t chunkEnd = std::min((chunk + 1) * CHUNK_VERTICES, vertexCount);
+		for (size_t blockStart = chunk * CHUNK_VERTICES; blockStart < chunkEnd; blockStart += BLOCK_VERTICES)
+		{
+			const size_t blockSize = std::min(static_cast<size_t>(BLOCK_VERTICES), chunkEnd - blockStart);
+			const size_t groupCount = (blockSize + GROUP_SIZE - 1) / GROUP_SIZE;
+			for (size_t lane = 0; lane < vertexStride; ++lane)
+			{
+				// Padding of the last group is zero delta, so it decodes to the last value
+				memset(deltas, 0, sizeof(deltas));
+				for (size_t i = 0; i < blockSize; ++i)
+				{
+					const uint8_t value = source[(blockStart + i) * vertexStride + lane];
+					deltas[i] = ZigZag8(static_cast<uint8_t>(value - previous[lane]));
+					previous[lane] = value;
+				}
+
+				// 2 bit mode of every group precedes groups of the lane
+				const size_t headerOffset = data.size();
+				data.resize(data.size() + (groupCount + 3) / 4, 0);
+				for (size_t group = 0; group < groupCount; ++group)
+				{
+					const uint8_t* values = deltas + group * GROUP_SIZE;
+					uint8_t bits = 0;
+					for (size_t i = 0; i < GROUP_SIZE; ++i)
+					{
+						bits |= values[i];
+					}
+					const uint32_t mode = bits == 0 ? 0 : bits < 4 ? 1 : bits < 16 ? 2 : 3;
+					data[headerOffset + group / 4] |= static_cast<uint8_t>(mode << (group % 4 * 2));
+					WriteGroup(values, mode, data);
+				}
+			}
+		}
+		assert(data.size() - chunksOffset <= UINT32_MAX && "Encoded vertex stream is too large");
+		WriteUint32(static_cast<uint32_t>(data.size() - chunksOffset), data.data() + tableOffset + sizeof(uint32_t) * chunk);
+	}
+}
+
+bool GeometryCodec::DecodeVertices(const uint8_t* data, size_t dataSize, void* vertices, size_t vertexCount, size_t vertexStride, const ParallelFor& parallelFor)
+{
+	const size_t chunkCount = GetVertexChunkCount(vertexCount);
+	if (chunkCount == 0) {
+		return dataSize == STREAM_HEADER_SIZE && IsStreamHeaderValid(data, dataSize, VERTEX_STREAM_VERSION, 0, 0);
+	}
+	return DecodeChunks(chunkCount, parallelFor, [&](size_t chunk) {
+		return DecodeVertexChunk(data, dataSize, vertices, vertexCount, vertexStride, chunk);
+	});
+}
+
+bool GeometryCodec::DecodeVertexChunk(const uint8_t* data, size_t dataSize, void* vertices, size_t vertexCount, size_t vertexStride, size_t chunk)
+{
+	const uint8_t* end;
+	if (vertexStride == 0 || vertexStride > MAX_VERTEX_STRIDE || !GetChunk(data, dataSize, VERTEX_STREAM_VERSION, vertexCount, sizeof(uint32_t), GetVertexChunkCount(vertexCount), chunk, data, end)) {
+		return false;
+	}
+
+	uint8_t* destination = static_cast<uint8_t*>(vertices);
+	std::vector<uint8_t> lanes(vertexStride * BLOCK_VERTICES);
+	uint8_t previous[MAX_VERTEX_STRIDE] = {};
+	const size_t chunkEnd = std::min((chunk + 1) * CHUNK_VERTICES, vertexCount);
+	for (size_t blockStart = chunk * CHUNK_VERTICES; blockStart < chunkEnd; blockStart += BLOCK_VERTICES)
+	{
+		const size_t blockSize = std::min(static_cast<size_t>(BLOCK_VERTICES), chunkEnd - blockStart);
+		const size_t groupCount = (blockSize + GROUP_SIZE - 1) / GROUP_SIZE;
+		for (size_t lane = 0; lane < vertexStride; ++lane)
+		{
+			const size_t headerSize = (groupCount + 3) / 4;
+			if (static_cast<size_t>(end - data) < headerSize) {
+				return false;
+			}
+			const uint8_t* header = data;
+			data += headerSize;
+
+			uint8_t* laneValues = lanes.data() + lane * BLOCK_VERTICES;
+			__m128i carry = _mm_set1_epi8(static_cast<char>(previous[lane]));
+			for (size_t group = 0; group < groupCount; ++group)
+			{
+				const uint32_t mode = (header[group / 4] >> (group % 4 * 2)) & 3;
+				const size_t groupSize = GetGroupSize(mode);
+				if (static_cast<size_t>(end - data) < groupSize) {
+					return false;
+				}
+				const __m128i values = AccumulateGroup(ReadGroup(data, mode), carry);
+				data += groupSize;
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(laneValues + group * GROUP_SIZE), values);
+				carry = _mm_set1_epi8(static_cast<char>(_mm_cvtsi128_si32(_mm_srli_si128(values, 15))));
+			}
+			previous[lane] = laneValues[blockSize - 1];
+		}
+
+		// Lanes back to interleaved vertices - 4 lanes of 16 vertices are transposed at once
+		const size_t wideLanes = vertexStride / 4 * 4;
+		for (size_t lane = 0; lane < wideLanes; lane += 4)
+		{
+			const uint8_t* laneValues = lanes.data() + lane * BLOCK_VERTICES;
+			for (size_t group = 0; group < groupCount; ++group)
+			{
+				const size_t offset = group * GROUP_SIZE;
+				const __m128i r0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(laneValues + offset));
+				const __m128i r1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(laneValues + BLOCK_VERTICES + offset));
+				const __m128i r2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(laneValues + 2 * BLOCK_VERTICES + offset));
+				const __m128i r3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(laneValues + 3 * BLOCK_VERTICES + offset));
+				const __m128i r01Low = _mm_unpacklo_epi8(r0, r1);
+				const __m128i r01High = _mm_unpackhi_epi8(r0, r1);
+				const __m128i r23Low = _mm_unpacklo_epi8(r2, r3);
+				const __m128i r23High = _mm_unpackhi_epi8(r2, r3);
+
+				alignas(16) uint32_t transposed[GROUP_SIZE];
+				_mm_store_si128(reinterpret_cast<__m128i*>(transposed), _mm_unpacklo_epi16(r01Low, r23Low));
+				_mm_store_si128(reinterpret_cast<__m128i*>(transposed + 4), _mm_unpackhi_epi16(r01Low, r23Low));
+				_mm_store_si128(reinterpret_cast<__m128i*>(transposed + 8), _mm_unpacklo_epi16(r01High, r23High));
+				_mm_store_si128(reinterpret_cast<__m128i*>(transposed + 12), _mm_unpackhi_epi16(r01High, r23High));
+
+				const size_t count = std::min(static_cast<size_t>(GROUP_SIZE), blockSize - offset);
+				uint8_t* vertex = destination + (blockStart + offset) * vertexStride + lane;
+				for (size_t i = 0; i < count; ++i, vertex += vertexStride)
+				{
+					memcpy(vertex, transposed + i, sizeof(uint32_t));
+				}
+			}
+		}
+		for (size_t lane = wideLanes; lane < vertexStride; ++lane)
+		{
+			for (size_t i = 0; i < blockSize; ++i)
+			{
+				destination[(blockStart + i) * vertexStride + lane] = lanes[lane * BLOCK_VERTICES + i];
+			}
+		}
+	}
+	return data == end;
+}
+
+void GeometryCodec::EncodeIndices(const uint32_t* indices, size_t indexCount, std::vector<uint8_t>& data)
+{
+	assert(indexCount % 3 == 0 && "Index codec expects triangle list");
+
+	const size_t chunkCount = GetIndexChunkCount(indexCount);
+	const size_t tableOffset = data.size() + STREAM_HEADER_SIZE;
+	WriteStreamHeader(INDEX_STREAM_VERSION, indexCount, 2 * sizeof(uint32_t) * chunkCount, data);
+	const size_t chunksOffset = data.size();
+
+	std::vector<uint8_t> explicitVertices;
+	uint32_t next = 0;
+	for (size_t chunk = 0; chunk < chunkCount; ++chunk)
+	{
+		// FIFOs start empty in every chunk, only expected new vertex is carried over through the table
+		IndexCodecState state;
+		state.next = next;
+		state.last = next;
+		WriteUint32(next, data.data() + tableOffset + 2 * sizeof(uint32_t) * chunk + sizeof(uint32_t));
+
+		const size_t chunkEnd = std::min((chunk + 1) * CHUNK_TRIANGLES * 3, indexCount);
+		for (size_t i = chunk * CHUNK_TRIANGLES * 3; i < chunkEnd; i += 3)
+		{
+			explicitVertices.clear();
+
+			// Triangle continuing a strip shares edge with recent triangle - only its third vertex is coded
+			bool edgeFound = false;
+			for (size_t rotation = 0; rotation < 3 && !edgeFound; ++rotation)
+			{
+				const uint32_t a = indices[i + rotation];
+				const uint32_t b = indices[i + (rotation + 1) % 3];
+				const uint32_t c = indices[i + (rotation + 2) % 3];
+				for (uint32_t edge = 0; edge < EDGE_CODE_NONE; ++edge)
+				{
+					const uint32_t* cached = state.GetEdge(edge);
+					if (cached[0] != a || cached[1] != b) {
+						continue;
+					}
+					const uint32_t vertexCode = EncodeVertex(c, state, explicitVertices);
+					data.push_back(static_cast<uint8_t>((edge << 4) | vertexCode));
+					state.PushTriangleEdges(a, b, c);
+					edgeFound = true;
+					break;
+				}
+			}
+
+			if (!edgeFound)
+			{
+				const uint32_t a = indices[i];
+				const uint32_t b = indices[i + 1];
+				const uint32_t c = indices[i + 2];
+				const uint32_t codeA = EncodeVertex(a, state, explicitVertices);
+				const uint32_t codeB = EncodeVertex(b, state, explicitVertices);
+				const uint32_t codeC = EncodeVertex(c, state, explicitVertices);
+				data.push_back(static_cast<uint8_t>((EDGE_CODE_NONE << 4) | codeA));
+				data.push_back(static_cast<uint8_t>((codeB << 4) | codeC));
+				state.PushEdge(b, a);
+				state.PushTriangleEdges(a, b, c);
+			}
+			data.insert(data.end(), explicitVertices.begin(), explicitVertices.end());
+		}
+		next = state.next;
+		assert(data.size() - chunksOffset <= UINT32_MAX && "Encoded index stream is too large");
+		WriteUint32(static_cast<uint32_t>(data.size() - chunksOffset), data.data() + tableOffset + 2 * sizeof(uint32_t) * chunk);
+	}
+}
+
+bool GeometryCodec::DecodeIndices(const uint8_t* data, size_t dataSize, uint32_t* indices, size_t indexCount, const ParallelFor& parallelFor)
+{
+	const size_t chunkCount = GetIndexChunkCount(indexCount);
+	if (indexCount % 3 != 0) {
+		return false;
+	}
+	if (chunkCount == 0) {
+		return dataSize == STREAM_HEADER_SIZE && IsStreamHeaderValid(data, dataSize, INDEX_STREAM_VERSION, 0, 0);
+	}
+	return DecodeChunks(chunkCount, parallelFor, [&](size_t chunk) {
+		return DecodeIndexChunk(data, dataSize, indices, indexCount, chunk);
+	});
+}
+
+bool GeometryCodec::DecodeIndexChunk(const uint8_t* data, size_t dataSize, uint32_t* indices, size_t indexCount, size_t chunk)
+{
+	const uint8_t* end;
+	const uint8_t* table = data + STREAM_HEADER_SIZE;
+	if (!GetChunk(data, dataSize, INDEX_STREAM_VERSION, indexCount, 2 * sizeof(uint32_t), GetIndexChunkCount(indexCount), chunk, data, end)) {
+		return false;
+	}
+
+	IndexCodecState state;
+	state.next = ReadUint32(table + 2 * sizeof(uint32_t) * chunk + sizeof(uint32_t));
+	state.last = state.next;
+	const size_t chunkEnd = std::min((chunk + 1) * CHUNK_TRIANGLES * 3, indexCount);
+	for (size_t i = chunk * CHUNK_TRIANGLES * 3; i < chunkEnd; i += 3)
+	{
+		if (data == end) {
+			return false;
+		}
+		const uint32_t code = *data++;
+		const uint32_t edge = code >> 4;
+		uint32_t a, b, c;
+		if (edge != EDGE_CODE_NONE)
+		{
+			// Codes of explicit vertices are followed by their varints, in order of vertices
+			const uint32_t* cached = state.GetEdge(edge);
+			a = cached[0];
+			b = cached[1];
+			if (!DecodeVertex(code & 15, state, data, end, c)) {
+				return false;
+			}
+		}
+		else
+		{
+			if (data == end) {
+				return false;
+			}
+			const uint32_t codes = *data++;
+			if (!DecodeVertex(code & 15, state, data, end, a) || !DecodeVertex(codes >> 4, state, data, end, b) || !DecodeVertex(codes & 15, state, data, end, c)) {
+				return false;
+			}
+			state.PushEdge(b, a);
+		}
+		state.PushTriangleEdges(a, b, c);
+		indices[i] = a;
+		indices[i + 1] = b;
+		indices[i + 2] = c;
+	}
+	return data == end;
+}
@@ -0,0 +1,48 @@
+#pragma once
+#ifndef _GEOMETRY_CODEC_H_
+#define _GEOMETRY_CODEC_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Compresses vertex and index streams for storage, decoding is meant to run on the load path. Doesn't depend on Windows or D3D12 headers, like MeshOptimizer.
+// Vertices - every byte of vertex is delta encoded against the same byte of previous vertex, zigzag encoded and bit packed in groups of 16 (SSE2 decoder).
+// Indices - triangles are coded against FIFOs of recently seen edges and vertices, so triangles continuing a strip cost a single byte.
+// Both streams are split into chunks coded independently, with their count and table of chunk offsets up front - chunks are decoded in parallel if parallelFor is given.
+class GeometryCodec
+{
+public:
+	// Calls func(i) for every i in [0, count) and returns once all calls finished - ThreadPool::ParallelFor fits
+	typedef std::function<void(size_t count, const std::function<void(size_t)>& func)> ParallelFor;
+
+	static void EncodeVertices(const void* vertices, size_t vertexCount, size_t vertexStride, std::vector<uint8_t>& data);
+	// Returns false if data is malformed or doesn't match vertex count and stride
+	static bool DecodeVertices(const uint8_t* data, size_t dataSize, void* vertices, size_t vertexCount, size_t vertexStride, const ParallelFor& parallelFor = nullptr);
+
+	// Triangle list - decoded triangles keep their order and winding, but may start with different vertex
+	static void EncodeIndices(const uint32_t* indices, size_t indexCount, std::vector<uint8_t>& data);
+	static bool DecodeIndices(const uint8_t* data, size_t dataSize, uint32_t* indices, size_t indexCount, const ParallelFor& parallelFor = nullptr);
+
+	static size_t GetVertexChunkCount(size_t vertexCount) { return (vertexCount + CHUNK_VERTICES - 1) / CHUNK_VERTICES; }
+	static size_t GetIndexChunkCount(size_t indexCount) { return (indexCount / 3 + CHUNK_TRIANGLES - 1) / CHUNK_TRIANGLES; }
+
+private:
+	static bool DecodeVertexChunk(const uint8_t* data, size_t dataSize, void* vertices, size_t vertexCount, size_t vertexStride, size_t chunk);
+	static bool DecodeIndexChunk(const uint8_t* data, size_t dataSize, uint32_t* indices, size_t indexCount, size_t chunk);
+
+private:
+	static constexpr uint8_t VERTEX_STREAM_VERSION = 0xA2;
+	static constexpr uint8_t INDEX_STREAM_VERSION = 0xB2;
+	// Chunk of 16K vertices or triangles is 1 MB of typical vertices - big enough that its offset and reset FIFOs cost nothing
+	static constexpr size_t CHUNK_VERTICES = 16384;
+	static constexpr size_t CHUNK_TRIANGLES = 16384;
+	// Vertices are decoded in blocks, block of every byte lane stays in L1 while it's transposed back to vertices
+	static constexpr size_t BLOCK_VERTICES = 256;
+	static constexpr size_t GROUP_SIZE = 16;
+	static constexpr size_t MAX_VERTEX_STRIDE = 256;
+	static constexpr size_t FIFO_SIZE = 16;
+};
+
+#endif // !_GEOMETRY_CODEC_H_
@@ -2,7 +2,10 @@
 
 #define WIN32_LEAN_AND_MEAN
 #include <Windows.h>
+#include <Psapi.h>
 #include "CBuffer.h"
+#include <cstdarg>
+#include <cstdio>
 
 #define SizeOfInUint32(obj) ((sizeof(obj) - 1) / sizeof(UINT32) + 1)
 #define ALIGN(_alignment, _val) (((_val + _alignment - 1) / _alignment) * _alignment)
@@ -34,6 +37,27 @@ inline void ThrowIfFalse(bool value, const wchar_t* msg)
     ThrowIfFailed(value ? S_OK : E_FAIL, msg);
 }
 
+inline void LogDebugRTCP(const char* format, ...)
+{
+    char buffer[1024];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    OutputDebugStringA(buffer);
+}
+
+// Peak working set of the process in bytes, used by load time and memory logs
+inline size_t GetPeakWorkingSetRTCP()
+{
+    PROCESS_MEMORY_COUNTERS counters{};
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+    {
+        return 0;
+    }
+    return counters.PeakWorkingSetSize;
+}
+
 template<class T>
 inline void CreateUploadHeapRTCP(ID3D12Device5* device, CBuffer<T>& cbuffer)
 {
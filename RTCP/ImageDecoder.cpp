@@ -0,0 +1,2240 @@
+#include "ImageDecoder.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <emmintrin.h>
+#include <fstream>
+
+namespace
+{
+	inline uint32_t ReadBigEndian16(const uint8_t* data)
+	{
+		return (static_cast<uint32_t>(data[0]) << 8) | data[1];
+	}
+
+	inline uint32_t ReadBigEndian32(const uint8_t* data)
+	{
+		return (static_cast<uint32_t>(data[0]) << 24) | (static_cast<uint32_t>(data[1]) << 16) | (static_cast<uint32_t>(data[2]) << 8) | data[3];
+	}
+
+	inline uint32_t ReadLittleEndian32(const uint8_t* data)
+	{
+		return data[0] | (static_cast<uint32_t>(data[1]) << 8) | (static_cast<uint32_t>(data[2]) << 16) | (static_cast<uint32_t>(data[3]) << 24);
+	}
+
+	inline uint8_t* GetRow(uint8_t* destination, const ImageDecoder::Subresource& subresource, size_t row)
+	{
+		return destination + subresource.offset + row * subresource.rowPitch;
+	}
+
+	// Bytes per 4x4 block of BC1 - BC7, 0 for other formats
+	size_t GetBlockSize(uint32_t format)
+	{
+		if ((format >= 70 && format <= 72) || (format >= 79 && format <= 81)) {
+			return 8;
+		}
+		if ((format >= 73 && format <= 78) || (format >= 82 && format <= 84) || (format >= 94 && format <= 99)) {
+			return 16;
+		}
+		return 0;
+	}
+
+	// Uncompressed formats with whole pixels - packed and video formats aren't supported
+	size_t GetBitsPerPixel(uint32_t format)
+	{
+		if (format >= 1 && format <= 4) {
+			return 128;
+		}
+		if (format >= 5 && format <= 8) {
+			return 96;
+		}
+		if (format >= 9 && format <= 22) {
+			return 64;
+		}
+		if ((format >= 23 && format <= 47) || format == 67 || (format >= 87 && format <= 93)) {
+			return 32;
+		}
+		if ((format >= 48 && format <= 59) || format == 85 || format == 86 || format == 115) {
+			return 16;
+		}
+		if (format >= 60 && format <= 65) {
+			return 8;
+		}
+		return 0;
+	}
+
+	// 4 pixels per iteration - every load reads 16 bytes for 12 used ones, so vector loop stops while whole load is inside source
+	void ExpandRgbToRgba(const uint8_t* source, uint8_t* destination, size_t pixelCount)
+	{
+		const __m128i mask0 = _mm_setr_epi32(0x00FFFFFF, 0, 0, 0);
+		const __m128i mask1 = _mm_setr_epi32(0, 0x00FFFFFF, 0, 0);
+		const __m128i mask2 = _mm_setr_epi32(0, 0, 0x00FFFFFF, 0);
+		const __m128i mask3 = _mm_setr_epi32(0, 0, 0, 0x00FFFFFF);
+		const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000));
+
+		size_t i = 0;
+		for (; (i + 4) * 3 + 4 <= pixelCount * 3; i += 4)
+		{
+			// Pixel n is moved n bytes up, to start of its 32 bit lane
+			const __m128i rgb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 3));
+			__m128i rgba = _mm_or_si128(_mm_and_si128(rgb, mask0), _mm_and_si128(_mm_slli_si128(rgb, 1), mask1));
+			rgba = _mm_or_si128(rgba, _mm_and_si128(_mm_slli_si128(rgb, 2), mask2));
+			rgba = _mm_or_si128(rgba, _mm_and_si128(_mm_slli_si128(rgb, 3), mask3));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i * 4), _mm_or_si128(rgba, alpha));
+		}
+		for (; i < pixelCount; ++i)
+		{
+			destination[i * 4 + 0] = source[i * 3 + 0];
+			destination[i * 4 + 1] = source[i * 3 + 1];
+			destination[i * 4 + 2] = source[i * 3 + 2];
+			destination[i * 4 + 3] = 0xFF;
+		}
+	}
+
+	void ExpandGrayAlphaToRgba(const uint8_t* source, uint8_t* destination, size_t pixelCount)
+	{
+		const __m128i keep = _mm_set1_epi32(static_cast<int>(0xFFFF00FF));
+		const __m128i green = _mm_set1_epi32(0x0000FF00);
+
+		size_t i = 0;
+		for (; i + 8 <= pixelCount; i += 8)
+		{
+			// Lanes hold gray, alpha, gray, alpha after unpacking - second byte is replaced by gray from first one
+			const __m128i grayAlpha = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 2));
+			const __m128i low = _mm_unpacklo_epi16(grayAlpha, grayAlpha);
+			const __m128i high = _mm_unpackhi_epi16(grayAlpha, grayAlpha);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i * 4), _mm_or_si128(_mm_and_si128(low, keep), _mm_and_si128(_mm_slli_epi32(low, 8), green)));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i * 4 + 16), _mm_or_si128(_mm_and_si128(high, keep), _mm_and_si128(_mm_slli_epi32(high, 8), green)));
+		}
+		for (; i < pixelCount; ++i)
+		{
+			destination[i * 4 + 0] = source[i * 2];
+			destination[i * 4 + 1] = source[i * 2];
+			destination[i * 4 + 2] = source[i * 2];
+			destination[i * 4 + 3] = source[i * 2 + 1];
+		}
+	}
+
+	// JPEG YCbCr to RGBA with Q16 constants of libjpeg (jdcolor.c), which are too large for 16 bit lanes - they are split into integer part
+	// and fraction, which gives exactly the rounded results of libjpeg tables. Scalar tail uses the same arithmetic.
+	constexpr int32_t CR_TO_R = 26345;		// 1.40200 - 1
+	constexpr int32_t CB_TO_B = -14942;		// 1.77200 - 2
+	constexpr int32_t CB_TO_G = -22554;		// -0.34414
+	constexpr int32_t CR_TO_G = 18734;		// -0.71414 + 1
+
+	inline uint8_t Saturate(int32_t value)
+	{
+		return static_cast<uint8_t>(std::min(std::max(value, 0), 255));
+	}
+
+	void ConvertYCbCrToRgba(const uint8_t* y, const uint8_t* cb, const uint8_t* cr, uint8_t* destination, size_t pixelCount)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i center = _mm_set1_epi16(128);
+		const __m128i one = _mm_set1_epi16(1);
+		const __m128i half = _mm_set1_epi32(1 << 15);
+		const __m128i greenFactors = _mm_setr_epi16(CB_TO_G, CR_TO_G, CB_TO_G, CR_TO_G, CB_TO_G, CR_TO_G, CB_TO_G, CR_TO_G);
+		const __m128i alpha = _mm_set1_epi8(static_cast<char>(0xFF));
+
+		size_t i = 0;
+		for (; i + 8 <= pixelCount; i += 8)
+		{
+			const __m128i luma = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(y + i)), zero);
+			const __m128i blue = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(cb + i)), zero), center);
+			const __m128i red = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(cr + i)), zero), center);
+
+			// High half of product of doubled chroma is twice the fraction, rounded by adding one before halving
+			const __m128i r = _mm_add_epi16(red, _mm_srai_epi16(_mm_add_epi16(_mm_mulhi_epi16(_mm_add_epi16(red, red), _mm_set1_epi16(CR_TO_R)), one), 1));
+			const __m128i b = _mm_add_epi16(_mm_add_epi16(blue, blue), _mm_srai_epi16(_mm_add_epi16(_mm_mulhi_epi16(_mm_add_epi16(blue, blue), _mm_set1_epi16(CB_TO_B)), one), 1));
+			const __m128i greenLow = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(blue, red), greenFactors), half), 16);
+			const __m128i greenHigh = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(blue, red), greenFactors), half), 16);
+			const __m128i g = _mm_sub_epi16(_mm_packs_epi32(greenLow, greenHigh), red);
+
+			// Saturating packs clamp to [0, 255], RG and BA pairs are interleaved into RGBA
+			const __m128i rg = _mm_unpacklo_epi8(_mm_packus_epi16(_mm_add_epi16(luma, r), zero), _mm_packus_epi16(_mm_add_epi16(luma, g), zero));
+			const __m128i ba = _mm_unpacklo_epi8(_mm_packus_epi16(_mm_add_epi16(luma, b), zero), alpha);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i * 4), _mm_unpacklo_epi16(rg, ba));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i * 4 + 16), _mm_unpackhi_epi16(rg, ba));
+		}
+		for (; i < pixelCount; ++i)
+		{
+			const int32_t blue = cb[i] - 128;
+			const int32_t red = cr[i] - 128;
+			destination[i * 4 + 0] = Saturate(y[i] + red + ((red * CR_TO_R + (1 << 15)) >> 16));
+			destination[i * 4 + 1] = Saturate(y[i] - red + ((blue * CB_TO_G + red * CR_TO_G + (1 << 15)) >> 16));
+			destination[i * 4 + 2] = Saturate(y[i] + 2 * blue + ((blue * CB_TO_B + (1 << 15)) >> 16));
+			destination[i * 4 + 3] = 0xFF;
+		}
+	}
+
+	// ---------------------------------------------------------------- DEFLATE
+
+	// Canonical Huffman code of DEFLATE - codes up to FAST_BITS long are decoded by single lookup, longer ones by code length ranges
+	struct InflateTable {
+		static constexpr int FAST_BITS = 9;
+		static constexpr size_t MAX_SYMBOLS = 288;
+
+		uint16_t fast[1 << FAST_BITS];	// Code length << 9 | symbol, 0 if code is longer than FAST_BITS
+		uint16_t firstCode[16];
+		uint16_t firstSymbol[16];
+		int32_t maxCode[17];			// First code after codes of given length, aligned to 16 bits
+		uint8_t lengths[MAX_SYMBOLS];
+		uint16_t symbols[MAX_SYMBOLS];
+
+		bool Build(const uint8_t* codeLengths, size_t count);
+	};
+
+	inline uint32_t ReverseBits(uint32_t value, int count)
+	{
+		uint32_t result = 0;
+		for (int i = 0; i < count; ++i)
+		{
+			result = (result << 1) | ((value >> i) & 1);
+		}
+		return result;
+	}
+
+	bool InflateTable::Build(const uint8_t* codeLengths, size_t count)
+	{
+		uint32_t lengthCounts[17] = {};
+		for (size_t i = 0; i < count; ++i)
+		{
+			++lengthCounts[codeLengths[i]];
+		}
+		lengthCounts[0] = 0;
+		memset(fast, 0, sizeof(fast));
+
+		uint32_t nextCode[16];
+		uint32_t code = 0;
+		uint32_t symbol = 0;
+		for (int length = 1; length < 16; ++length)
+		{
+			nextCode[length] = code;
+			firstCode[length] = static_cast<uint16_t>(code);
+			firstSymbol[length] = static_cast<uint16_t>(symbol);
+			code += lengthCounts[length];
+			// Over-subscribed code, incomplete ones are valid (single distance code)
+			if (lengthCounts[length] > 0 && code - 1 >= (1u << length)) {
+				return false;
+			}
+			maxCode[length] = static_cast<int32_t>(code << (16 - length));
+			code <<= 1;
+			symbol += lengthCounts[length];
+		}
+		maxCode[16] = 0x10000;
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			const int length = codeLengths[i];
+			if (length == 0) {
+				continue;
+			}
+			const uint32_t index = nextCode[length] - firstCode[length] + firstSymbol[length];
+			lengths[index] = static_cast<uint8_t>(length);
+			symbols[index] = static_cast<uint16_t>(i);
+			if (length <= FAST_BITS) {
+				// Codes are stored bit reversed in stream, every index ending with the code maps to it
+				for (uint32_t j = ReverseBits(nextCode[length], length); j < (1u << FAST_BITS); j += 1u << length)
+				{
+					fast[j] = static_cast<uint16_t>((length << 9) | i);
+				}
+			}
+			++nextCode[length];
+		}
+		return true;
+	}
+
+	class Inflater
+	{
+	public:
+		Inflater(const uint8_t* data, size_t size, uint8_t* output, size_t outputSize) :
+			m_data(data), m_size(size), m_output(output), m_outputSize(outputSize) {}
+
+		// Whole zlib stream has to fill output exactly - Adler-32 isn't verified
+		bool Inflate();
+
+	private:
+		void Refill()
+		{
+			while (m_bitCount <= 56)
+			{
+				// Zeros past end of data, decoding stops on output overflow or invalid code
+				const uint64_t byte = m_position < m_size ? m_data[m_position] : 0;
+				++m_position;
+				m_bits |= byte << m_bitCount;
+				m_bitCount += 8;
+			}
+		}
+
+		uint32_t GetBits(int count)
+		{
+			if (m_bitCount < count) {
+				Refill();
+			}
+			const uint32_t value = static_cast<uint32_t>(m_bits & ((1ull << count) - 1));
+			m_bits >>= count;
+			m_bitCount -= count;
+			return value;
+		}
+
+		int DecodeSymbol(const InflateTable& table);
+		bool InflateStored();
+		bool InflateCompressed(const InflateTable& literals, const InflateTable& distances);
+		bool ReadDynamicTables(InflateTable& literals, InflateTable& distances);
+
+	private:
+		const uint8_t* m_data;
+		size_t m_size;
+		size_t m_position = 0;
+		uint64_t m_bits = 0;
+		int m_bitCount = 0;
+		uint8_t* m_output;
+		size_t m_outputSize;
+		size_t m_written = 0;
+	};
+
+	int Inflater::DecodeSymbol(const InflateTable& table)
+	{
+		if (m_bitCount < 16) {
+			Refill();
+		}
+		const uint16_t fast = table.fast[m_bits & ((1 << InflateTable::FAST_BITS) - 1)];
+		if (fast != 0) {
+			const int length = fast >> 9;
+			m_bits >>= length;
+			m_bitCount -= length;
+			return fast & 511;
+		}
+
+		const int32_t code = static_cast<int32_t>(ReverseBits(static_cast<uint32_t>(m_bits & 0xFFFF), 16));
+		int length = InflateTable::FAST_BITS + 1;
+		while (length < 16 && code >= table.maxCode[length])
+		{
+			++length;
+		}
+		if (length >= 16) {
+			return -1;
+		}
+		const uint32_t index = (code >> (16 - length)) - table.firstCode[length] + table.firstSymbol[length];
+		if (index >= InflateTable::MAX_SYMBOLS || table.lengths[index] != length) {
+			return -1;
+		}
+		m_bits >>= length;
+		m_bitCount -= length;
+		return table.symbols[index];
+	}
+
+	bool Inflater::InflateStored()
+	{
+		GetBits(m_bitCount & 7);
+		const uint32_t length = GetBits(16);
+		const uint32_t inverted = GetBits(16);
+		if ((length ^ 0xFFFF) != inverted || length > m_outputSize - m_written) {
+			return false;
+		}
+
+		// Whole bytes still in bit buffer come first, rest is copied straight from input
+		uint32_t remaining = length;
+		while (remaining > 0 && m_bitCount >= 8)
+		{
+			m_output[m_written++] = static_cast<uint8_t>(GetBits(8));
+			--remaining;
+		}
+		if (remaining > 0) {
+			if (m_position + remaining > m_size) {
+				return false;
+			}
+			memcpy(m_output + m_written, m_data + m_position, remaining);
+			m_position += remaining;
+			m_written += remaining;
+		}
+		return true;
+	}
+
+	bool Inflater::InflateCompressed(const InflateTable& literals, const InflateTable& distances)
+	{
+		static const uint16_t lengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+		static const uint8_t lengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+		static const uint16_t distanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+		static const uint8_t distanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+		while (true)
+		{
+			const int symbol = DecodeSymbol(literals);
+			if (symbol < 0) {
+				return false;
+			}
+			if (symbol < 256) {
+				if (m_written >= m_outputSize) {
+					return false;
+				}
+				m_output[m_written++] = static_cast<uint8_t>(symbol);
+				continue;
+			}
+			if (symbol == 256) {
+				return true;
+			}
+			if (symbol > 285) {
+				return false;
+			}
+
+			const size_t length = lengthBase[symbol - 257] + GetBits(lengthExtra[symbol - 257]);
+			const int distanceSymbol = DecodeSymbol(distances);
+			if (distanceSymbol < 0 || distanceSymbol >= 30) {
+				return false;
+			}
+			const size_t distance = distanceBase[distanceSymbol] + GetBits(distanceExtra[distanceSymbol]);
+			if (distance > m_written || length > m_outputSize - m_written) {
+				return false;
+			}
+
+			// Overlapping copy repeats last distance bytes, byte by byte
+			uint8_t* target = m_output + m_written;
+			const uint8_t* source = target - distance;
+			if (distance >= length) {
+				memcpy(target, source, length);
+			}
+			else {
+				for (size_t i = 0; i < length; ++i)
+				{
+					target[i] = source[i];
+				}
+			}
+			m_written += length;
+		}
+	}
+
+	bool Inflater::ReadDynamicTables(InflateTable& literals, InflateTable& distances)
+	{
+		static const uint8_t codeLengthOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+		const uint32_t literalCount = GetBits(5) + 257;
+		const uint32_t distanceCount = GetBits(5) + 1;
+		const uint32_t codeLengthCount = GetBits(4) + 4;
+
+		uint8_t codeLengthLengths[19] = {};
+		for (uint32_t i = 0; i < codeLengthCount; ++i)
+		{
+			codeLengthLengths[codeLengthOrder[i]] = static_cast<uint8_t>(GetBits(3));
+		}
+		InflateTable codeLengths;
+		if (!codeLengths.Build(codeLengthLengths, 19)) {
+			return false;
+		}
+
+		// Literal and distance lengths are one sequence, repeats may cross from one to the other
+		uint8_t lengths[286 + 30] = {};
+		uint32_t count = 0;
+		while (count < literalCount + distanceCount)
+		{
+			const int symbol = DecodeSymbol(codeLengths);
+			if (symbol < 0) {
+				return false;
+			}
+			if (symbol < 16) {
+				lengths[count++] = static_cast<uint8_t>(symbol);
+				continue;
+			}
+
+			uint8_t value = 0;
+			uint32_t repeat;
+			if (symbol == 16) {
+				if (count == 0) {
+					return false;
+				}
+				value = lengths[count - 1];
+				repeat = GetBits(2) + 3;
+			}
+			else if (symbol == 17) {
+				repeat = GetBits(3) + 3;
+			}
+			else {
+				repeat = GetBits(7) + 11;
+			}
+			if (count + repeat > literalCount + distanceCount) {
+				return false;
+			}
+			memset(lengths + count, value, repeat);
+			count += repeat;
+		}
+		return literals.Build(lengths, literalCount) && distances.Build(lengths + literalCount, distanceCount);
+	}
+
+	bool Inflater::Inflate()
+	{
+		// zlib header - deflate with no preset dictionary
+		if (m_size < 2 || (m_data[0] & 15) != 8 || ((m_data[0] << 8) | m_data[1]) % 31 != 0 || (m_data[1] & 32) != 0) {
+			return false;
+		}
+		m_position = 2;
+
+		InflateTable literals;
+		InflateTable distances;
+		bool lastBlock = false;
+		while (!lastBlock)
+		{
+			lastBlock = GetBits(1) != 0;
+			const uint32_t type = GetBits(2);
+			if (type == 0) {
+				if (!InflateStored()) {
+					return false;
+				}
+				continue;
+			}
+
+			if (type == 1) {
+				uint8_t lengths[InflateTable::MAX_SYMBOLS + 32];
+				memset(lengths, 8, 144);
+				memset(lengths + 144, 9, 112);
+				memset(lengths + 256, 7, 24);
+				memset(lengths + 280, 8, 8);
+				memset(lengths + InflateTable::MAX_SYMBOLS, 5, 32);
+				literals.Build(lengths, InflateTable::MAX_SYMBOLS);
+				distances.Build(lengths + InflateTable::MAX_SYMBOLS, 32);
+			}
+			else if (type != 2 || !ReadDynamicTables(literals, distances)) {
+				return false;
+			}
+			if (!InflateCompressed(literals, distances)) {
+				return false;
+			}
+		}
+		return m_written == m_outputSize;
+	}
+
+	// ---------------------------------------------------------------- PNG
+
+	enum PngColorType : uint8_t
+	{
+		PNG_GRAY = 0,
+		PNG_RGB = 2,
+		PNG_PALETTE = 3,
+		PNG_GRAY_ALPHA = 4,
+		PNG_RGBA = 6
+	};
+
+	struct PngHeader {
+		uint32_t width = 0;
+		uint32_t height = 0;
+		uint8_t bitDepth = 0;
+		uint8_t colorType = 0;
+		bool interlaced = false;
+		bool srgb = false;
+		bool hasTransparency = false;
+		uint16_t transparentColor[3] = {};	// tRNS of gray and RGB images - pixels of this color are transparent
+		uint8_t palette[256][4];			// RGBA, tRNS of palette images fills alpha
+		uint32_t paletteSize = 0;
+		size_t channels = 0;
+		uint32_t format = 0;
+	};
+
+	// Chunks up to first IDAT, or whole file if compressed data is requested - CRCs aren't verified
+	bool ReadPng(const uint8_t* data, size_t size, PngHeader& header, std::vector<uint8_t>* compressed)
+	{
+		static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+		if (size < 8 + 25 || memcmp(data, signature, 8) != 0 || memcmp(data + 12, "IHDR", 4) != 0 || ReadBigEndian32(data + 8) != 13) {
+			return false;
+		}
+
+		const uint8_t* ihdr = data + 16;
+		header.width = ReadBigEndian32(ihdr);
+		header.height = ReadBigEndian32(ihdr + 4);
+		header.bitDepth = ihdr[8];
+		header.colorType = ihdr[9];
+		header.interlaced = ihdr[12] == 1;
+		if (header.width == 0 || header.height == 0 || header.width > ImageDecoder::MAX_DIMENSION || header.height > ImageDecoder::MAX_DIMENSION || ihdr[10] != 0 || ihdr[11] != 0 || ihdr[12] > 1) {
+			return false;
+		}
+
+		const uint8_t depth = header.bitDepth;
+		switch (header.colorType)
+		{
+		case PNG_GRAY:
+			header.channels = 1;
+			if (depth != 1 && depth != 2 && depth != 4 && depth != 8 && depth != 16) {
+				return false;
+			}
+			break;
+		case PNG_PALETTE:
+			header.channels = 1;
+			if (depth != 1 && depth != 2 && depth != 4 && depth != 8) {
+				return false;
+			}
+			break;
+		case PNG_RGB:
+		case PNG_GRAY_ALPHA:
+		case PNG_RGBA:
+			header.channels = header.colorType == PNG_RGB ? 3 : (header.colorType == PNG_GRAY_ALPHA ? 2 : 4);
+			if (depth != 8 && depth != 16) {
+				return false;
+			}
+			break;
+		default:
+			return false;
+		}
+
+		for (uint32_t i = 0; i < 256; ++i)
+		{
+			header.palette[i][0] = header.palette[i][1] = header.palette[i][2] = 0;
+			header.palette[i][3] = 0xFF;
+		}
+
+		bool hasData = false;
+		size_t position = 8 + 25;
+		while (position + 12 <= size)
+		{
+			const uint32_t length = ReadBigEndian32(data + position);
+			const uint8_t* type = data + position + 4;
+			const uint8_t* chunk = data + position + 8;
+			// Headers end with first IDAT, which may lie past prefix of file
+			if (!compressed && memcmp(type, "IDAT", 4) == 0) {
+				hasData = true;
+				break;
+			}
+			if (length > size - position - 12) {
+				return false;
+			}
+			position += 12 + length;
+
+			if (memcmp(type, "IDAT", 4) == 0) {
+				hasData = true;
+				compressed->insert(compressed->end(), chunk, chunk + length);
+			}
+			else if (memcmp(type, "IEND", 4) == 0) {
+				break;
+			}
+			else if (memcmp(type, "PLTE", 4) == 0) {
+				if (length % 3 != 0 || length / 3 > 256) {
+					return false;
+				}
+				header.paletteSize = length / 3;
+				for (uint32_t i = 0; i < header.paletteSize; ++i)
+				{
+					memcpy(header.palette[i], chunk + i * 3, 3);
+				}
+			}
+			else if (memcmp(type, "tRNS", 4) == 0) {
+				header.hasTransparency = true;
+				if (header.colorType == PNG_PALETTE) {
+					for (uint32_t i = 0; i < std::min(length, 256u); ++i)
+					{
+						header.palette[i][3] = chunk[i];
+					}
+				}
+				else if (header.colorType == PNG_GRAY && length >= 2) {
+					header.transparentColor[0] = static_cast<uint16_t>(ReadBigEndian16(chunk));
+				}
+				else if (header.colorType == PNG_RGB && length >= 6) {
+					for (int i = 0; i < 3; ++i)
+					{
+						header.transparentColor[i] = static_cast<uint16_t>(ReadBigEndian16(chunk + i * 2));
+					}
+				}
+				else {
+					header.hasTransparency = false;
+				}
+			}
+			// Same rule as DirectXTex - sRGB chunk, or gamma of 1/2.2
+			else if (memcmp(type, "sRGB", 4) == 0 && !hasData) {
+				header.srgb = true;
+			}
+			else if (memcmp(type, "gAMA", 4) == 0 && length == 4 && !hasData && ReadBigEndian32(chunk) == 45455) {
+				header.srgb = true;
+			}
+		}
+		if (!hasData || (header.colorType == PNG_PALETTE && header.paletteSize == 0)) {
+			return false;
+		}
+
+		if (header.colorType == PNG_GRAY && !header.hasTransparency) {
+			header.format = depth == 16 ? ImageDecoder::FORMAT_R16_UNORM : ImageDecoder::FORMAT_R8_UNORM;
+		}
+		else if (depth == 16) {
+			header.format = ImageDecoder::FORMAT_R16G16B16A16_UNORM;
+		}
+		else {
+			header.format = header.srgb ? ImageDecoder::FORMAT_R8G8B8A8_UNORM_SRGB : ImageDecoder::FORMAT_R8G8B8A8_UNORM;
+		}
+		return true;
+	}
+
+	struct PngPass {
+		uint32_t x;
+		uint32_t y;
+		uint32_t stepX;
+		uint32_t stepY;
+		uint32_t width;
+		uint32_t height;
+	};
+
+	// Single pass of whole image, or 7 Adam7 passes - empty passes have zero width or height
+	size_t GetPngPasses(const PngHeader& header, PngPass passes[7])
+	{
+		if (!header.interlaced) {
+			passes[0] = { 0, 0, 1, 1, header.width, header.height };
+			return 1;
+		}
+
+		static const uint8_t startX[7] = { 0, 4, 0, 2, 0, 1, 0 };
+		static const uint8_t startY[7] = { 0, 0, 4, 0, 2, 0, 1 };
+		static const uint8_t stepX[7] = { 8, 8, 4, 4, 2, 2, 1 };
+		static const uint8_t stepY[7] = { 8, 8, 8, 4, 4, 2, 2 };
+		for (size_t i = 0; i < 7; ++i)
+		{
+			passes[i].x = startX[i];
+			passes[i].y = startY[i];
+			passes[i].stepX = stepX[i];
+			passes[i].stepY = stepY[i];
+			passes[i].width = header.width > startX[i] ? (header.width - startX[i] + stepX[i] - 1) / stepX[i] : 0;
+			passes[i].height = header.height > startY[i] ? (header.height - startY[i] + stepY[i] - 1) / stepY[i] : 0;
+		}
+		return 7;
+	}
+
+	inline size_t GetPngRowSize(const PngHeader& header, uint32_t width)
+	{
+		return (static_cast<size_t>(width) * header.channels * header.bitDepth + 7) / 8;
+	}
+
+	bool UnfilterPngRow(uint8_t filter, uint8_t* row, const uint8_t* previous, size_t rowSize, size_t pixelSize)
+	{
+		switch (filter)
+		{
+		case 0:
+			return true;
+		case 1:
+			for (size_t i = pixelSize; i < rowSize; ++i)
+			{
+				row[i] = static_cast<uint8_t>(row[i] + row[i - pixelSize]);
+			}
+			return true;
+		case 2:
+			for (size_t i = 0; i < rowSize; ++i)
+			{
+				row[i] = static_cast<uint8_t>(row[i] + previous[i]);
+			}
+			return true;
+		case 3:
+			for (size_t i = 0; i < rowSize; ++i)
+			{
+				const uint32_t left = i >= pixelSize ? row[i - pixelSize] : 0;
+				row[i] = static_cast<uint8_t>(row[i] + ((left + previous[i]) >> 1));
+			}
+			return true;
+		case 4:
+			for (size_t i = 0; i < rowSize; ++i)
+			{
+				const int32_t left = i >= pixelSize ? row[i - pixelSize] : 0;
+				const int32_t up = previous[i];
+				const int32_t upLeft = i >= pixelSize ? previous[i - pixelSize] : 0;
+				const int32_t distanceLeft = std::abs(up - upLeft);
+				const int32_t distanceUp = std::abs(left - upLeft);
+				const int32_t distanceUpLeft = std::abs(left + up - 2 * upLeft);
+				const int32_t predictor = distanceLeft <= distanceUp && distanceLeft <= distanceUpLeft ? left : (distanceUp <= distanceUpLeft ? up : upLeft);
+				row[i] = static_cast<uint8_t>(row[i] + predictor);
+			}
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	// Unfiltered row to pixels of output format
+	void ConvertPngRow(const PngHeader& header, const uint8_t* source, uint32_t width, uint8_t* destination)
+	{
+		const uint32_t depth = header.bitDepth;
+		if (depth < 8) {
+			// Gray is scaled to 8 bits, palette indices are looked up - both may have transparency
+			const uint32_t mask = (1u << depth) - 1;
+			const uint32_t scale = 255 / mask;
+			for (uint32_t x = 0; x < width; ++x)
+			{
+				const size_t bit = static_cast<size_t>(x) * depth;
+				const uint32_t value = (source[bit >> 3] >> (8 - depth - (bit & 7))) & mask;
+				if (header.colorType == PNG_PALETTE) {
+					memcpy(destination + x * 4, header.palette[value], 4);
+				}
+				else if (header.hasTransparency) {
+					memset(destination + x * 4, static_cast<int>(value * scale), 3);
+					destination[x * 4 + 3] = value == header.transparentColor[0] ? 0 : 0xFF;
+				}
+				else {
+					destination[x] = static_cast<uint8_t>(value * scale);
+				}
+			}
+			return;
+		}
+
+		if (depth == 16) {
+			// Big endian samples to little endian, gray and RGB get alpha
+			const size_t channels = header.channels;
+			if (header.format == ImageDecoder::FORMAT_R16_UNORM || channels == 4) {
+				for (size_t i = 0; i < width * channels; ++i)
+				{
+					destination[i * 2] = source[i * 2 + 1];
+					destination[i * 2 + 1] = source[i * 2];
+				}
+				return;
+			}
+			for (uint32_t x = 0; x < width; ++x)
+			{
+				const uint8_t* pixel = source + x * channels * 2;
+				uint8_t* output = destination + x * 8;
+				const size_t colorChannels = channels == 3 ? 3 : 1;
+				bool transparent = header.hasTransparency;
+				for (size_t c = 0; c < 3; ++c)
+				{
+					const uint8_t* sample = pixel + (colorChannels == 3 ? c * 2 : 0);
+					output[c * 2] = sample[1];
+					output[c * 2 + 1] = sample[0];
+					transparent = transparent && ReadBigEndian16(sample) == header.transparentColor[colorChannels == 3 ? c : 0];
+				}
+				if (channels == 2) {
+					output[6] = pixel[3];
+					output[7] = pixel[2];
+				}
+				else {
+					output[6] = output[7] = transparent ? 0 : 0xFF;
+				}
+			}
+			return;
+		}
+
+		switch (header.colorType)
+		{
+		case PNG_GRAY:
+			if (!header.hasTransparency) {
+				memcpy(destination, source, width);
+				return;
+			}
+			for (uint32_t x = 0; x < width; ++x)
+			{
+				memset(destination + x * 4, source[x], 3);
+				destination[x * 4 + 3] = source[x] == header.transparentColor[0] ? 0 : 0xFF;
+			}
+			return;
+		case PNG_RGB:
+			ExpandRgbToRgba(source, destination, width);
+			if (header.hasTransparency) {
+				for (uint32_t x = 0; x < width; ++x)
+				{
+					const uint8_t* pixel = source + x * 3;
+					if (pixel[0] == header.transparentColor[0] && pixel[1] == header.transparentColor[1] && pixel[2] == header.transparentColor[2]) {
+						destination[x * 4 + 3] = 0;
+					}
+				}
+			}
+			return;
+		case PNG_PALETTE:
+			for (uint32_t x = 0; x < width; ++x)
+			{
+				memcpy(destination + x * 4, header.palette[source[x]], 4);
+			}
+			return;
+		case PNG_GRAY_ALPHA:
+			ExpandGrayAlphaToRgba(source, destination, width);
+			return;
+		default:
+			memcpy(destination, source, static_cast<size_t>(width) * 4);
+			return;
+		}
+	}
+
+	size_t GetOutputPixelSize(uint32_t format)
+	{
+		switch (format)
+		{
+		case ImageDecoder::FORMAT_R8_UNORM:
+			return 1;
+		case ImageDecoder::FORMAT_R16_UNORM:
+			return 2;
+		case ImageDecoder::FORMAT_R16G16B16A16_UNORM:
+			return 8;
+		case ImageDecoder::FORMAT_R32G32B32A32_FLOAT:
+			return 16;
+		default:
+			return 4;
+		}
+	}
+
+	bool DecodePng(const uint8_t* data, size_t size, uint8_t* destination, const ImageDecoder::Subresource& subresource)
+	{
+		PngHeader header;
+		std::vector<uint8_t> compressed;
+		if (!ReadPng(data, size, header, &compressed)) {
+			return false;
+		}
+
+		PngPass passes[7];
+		const size_t passCount = GetPngPasses(header, passes);
+		size_t filteredSize = 0;
+		for (size_t i = 0; i < passCount; ++i)
+		{
+			if (passes[i].width > 0) {
+				filteredSize += passes[i].height * (GetPngRowSize(header, passes[i].width) + 1);
+			}
+		}
+
+		// Filter byte precedes every row - rows are unfiltered in place
+		std::vector<uint8_t> filtered(filteredSize);
+		Inflater inflater{ compressed.data(), compressed.size(), filtered.data(), filtered.size() };
+		if (!inflater.Inflate()) {
+			return false;
+		}
+
+		const size_t filterPixelSize = std::max<size_t>(header.channels * header.bitDepth / 8, 1);
+		const size_t outputPixelSize = GetOutputPixelSize(header.format);
+		std::vector<uint8_t> zeroRow(GetPngRowSize(header, header.width));
+		std::vector<uint8_t> passRow(header.interlaced ? header.width * outputPixelSize : 0);
+		uint8_t* row = filtered.data();
+		for (size_t i = 0; i < passCount; ++i)
+		{
+			const PngPass& pass = passes[i];
+			if (pass.width == 0) {
+				continue;
+			}
+
+			const size_t rowSize = GetPngRowSize(header, pass.width);
+			const uint8_t* previous = zeroRow.data();
+			for (uint32_t y = 0; y < pass.height; ++y, row += rowSize + 1)
+			{
+				if (!UnfilterPngRow(row[0], row + 1, previous, rowSize, filterPixelSize)) {
+					return false;
+				}
+				previous = row + 1;
+
+				uint8_t* output = GetRow(destination, subresource, pass.y + y * pass.stepY);
+				if (!header.interlaced) {
+					ConvertPngRow(header, row + 1, pass.width, output);
+					continue;
+				}
+				ConvertPngRow(header, row + 1, pass.width, passRow.data());
+				for (uint32_t x = 0; x < pass.width; ++x)
+				{
+					memcpy(output + (pass.x + x * pass.stepX) * outputPixelSize, passRow.data() + x * outputPixelSize, outputPixelSize);
+				}
+			}
+		}
+		return true;
+	}
+
+	// ---------------------------------------------------------------- JPEG
+
+	// Natural order index of zigzag ordered coefficient
+	const uint8_t ZIGZAG[64] = {
+		0, 1, 8, 16, 9, 2, 3, 10, 17, 24, 32, 25, 18, 11, 4, 5,
+		12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6, 7, 14, 21, 28,
+		35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+		58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63
+	};
+
+	// Canonical Huffman code of JPEG, most significant bit first
+	struct JpegHuffmanTable {
+		static constexpr int FAST_BITS = 9;
+
+		uint8_t fastLength[1 << FAST_BITS];		// 0 if code is longer than FAST_BITS
+		uint8_t fastSymbol[1 << FAST_BITS];
+		int32_t maxCode[17];					// Largest code of given length, -1 if there is none
+		int32_t symbolOffset[17];
+		uint8_t symbols[256];
+		// AC coefficients whose code and value bits fit into FAST_BITS - value << 8 | zero run << 4 | bits, 0 if slow path is needed
+		int16_t fastCoefficients[1 << FAST_BITS];
+		bool defined = false;
+
+		bool Build(const uint8_t* counts, const uint8_t* tableSymbols, size_t symbolCount)
+		{
+			memset(fastLength, 0, sizeof(fastLength));
+			memcpy(symbols, tableSymbols, symbolCount);
+
+			int32_t code = 0;
+			int32_t symbol = 0;
+			for (int length = 1; length <= 16; ++length)
+			{
+				const int32_t count = counts[length - 1];
+				symbolOffset[length] = symbol - code;
+				for (int32_t i = 0; i < count; ++i, ++code, ++symbol)
+				{
+					if (length <= FAST_BITS) {
+						const int shift = FAST_BITS - length;
+						for (int32_t j = 0; j < (1 << shift); ++j)
+						{
+							fastLength[(code << shift) | j] = static_cast<uint8_t>(length);
+							fastSymbol[(code << shift) | j] = symbols[symbol];
+						}
+					}
+				}
+				maxCode[length] = count > 0 ? code - 1 : -1;
+				if (code > (1 << length)) {
+					return false;
+				}
+				code <<= 1;
+			}
+
+			for (int32_t i = 0; i < (1 << FAST_BITS); ++i)
+			{
+				fastCoefficients[i] = 0;
+				const int32_t codeLength = fastLength[i];
+				const int32_t valueLength = fastSymbol[i] & 15;
+				if (codeLength == 0 || valueLength == 0 || codeLength + valueLength > FAST_BITS) {
+					continue;
+				}
+				const int32_t bits = (i >> (FAST_BITS - codeLength - valueLength)) & ((1 << valueLength) - 1);
+				const int32_t value = bits < (1 << (valueLength - 1)) ? bits - (1 << valueLength) + 1 : bits;
+				if (value >= -128 && value <= 127) {
+					fastCoefficients[i] = static_cast<int16_t>(value * 256 + (fastSymbol[i] >> 4) * 16 + codeLength + valueLength);
+				}
+			}
+			defined = true;
+			return true;
+		}
+	};
+
+	// Entropy coded segment - stuffed zero bytes are dropped, marker or end of data is followed by zero bits
+	class JpegBitReader
+	{
+	public:
+		JpegBitReader(const uint8_t* data, size_t size, size_t position) : m_data(data), m_size(size), m_position(position) {}
+
+		// Huffman symbol, -1 if no code matches
+		int Decode(const JpegHuffmanTable& table)
+		{
+			Fill();
+			const uint32_t fastIndex = static_cast<uint32_t>(m_bits >> (64 - JpegHuffmanTable::FAST_BITS));
+			const int fastLength = table.fastLength[fastIndex];
+			if (fastLength > 0) {
+				Consume(fastLength);
+				return table.fastSymbol[fastIndex];
+			}
+
+			const int32_t code16 = static_cast<int32_t>(m_bits >> 48);
+			for (int length = JpegHuffmanTable::FAST_BITS + 1; length <= 16; ++length)
+			{
+				const int32_t code = code16 >> (16 - length);
+				if (code <= table.maxCode[length]) {
+					Consume(length);
+					return table.symbols[(code + table.symbolOffset[length]) & 255];
+				}
+			}
+			return -1;
+		}
+
+		// Packed entry of fastCoefficients, consumed if it isn't 0
+		int32_t DecodeShortCoefficient(const JpegHuffmanTable& table)
+		{
+			Fill();
+			const int32_t entry = table.fastCoefficients[m_bits >> (64 - JpegHuffmanTable::FAST_BITS)];
+			Consume(entry & 15);
+			return entry;
+		}
+
+		// Next count bits as signed coefficient value
+		int32_t Receive(int count)
+		{
+			if (count == 0) {
+				return 0;
+			}
+			Fill();
+			const int32_t value = static_cast<int32_t>(m_bits >> (64 - count));
+			Consume(count);
+			return value < (1 << (count - 1)) ? value - (1 << count) + 1 : value;
+		}
+
+		// Drops remaining bits and skips RSTn marker
+		void Restart()
+		{
+			m_bits = 0;
+			m_bitCount = 0;
+			m_marker = false;
+			while (m_position + 1 < m_size && !(m_data[m_position] == 0xFF && m_data[m_position + 1] >= 0xD0 && m_data[m_position + 1] <= 0xD7))
+			{
+				++m_position;
+			}
+			m_position = std::min(m_position + 2, m_size);
+		}
+
+		size_t GetPosition() const { return m_position; }
+
+	private:
+		void Fill()
+		{
+			if (m_bitCount >= 32) {
+				return;
+			}
+			while (m_bitCount <= 56)
+			{
+				uint64_t byte = 0;
+				if (!m_marker && m_position < m_size) {
+					byte = m_data[m_position];
+					if (byte != 0xFF) {
+						++m_position;
+					}
+					else if (m_position + 1 < m_size && m_data[m_position + 1] == 0) {
+						m_position += 2;
+					}
+					else {
+						// Position stays on marker, so scan end can find it
+						m_marker = true;
+						byte = 0;
+					}
+				}
+				m_bits |= byte << (56 - m_bitCount);
+				m_bitCount += 8;
+			}
+		}
+
+		void Consume(int count)
+		{
+			m_bits <<= count;
+			m_bitCount -= count;
+		}
+
+	private:
+		const uint8_t* m_data;
+		size_t m_size;
+		size_t m_position;
+		uint64_t m_bits = 0;
+		int m_bitCount = 0;
+		bool m_marker = false;
+	};
+
+	inline void Transpose8x8(__m128i rows[8])
+	{
+		const __m128i a0 = _mm_unpacklo_epi16(rows[0], rows[1]);
+		const __m128i a1 = _mm_unpackhi_epi16(rows[0], rows[1]);
+		const __m128i a2 = _mm_unpacklo_epi16(rows[2], rows[3]);
+		const __m128i a3 = _mm_unpackhi_epi16(rows[2], rows[3]);
+		const __m128i a4 = _mm_unpacklo_epi16(rows[4], rows[5]);
+		const __m128i a5 = _mm_unpackhi_epi16(rows[4], rows[5]);
+		const __m128i a6 = _mm_unpacklo_epi16(rows[6], rows[7]);
+		const __m128i a7 = _mm_unpackhi_epi16(rows[6], rows[7]);
+		const __m128i b0 = _mm_unpacklo_epi32(a0, a2);
+		const __m128i b1 = _mm_unpackhi_epi32(a0, a2);
+		const __m128i b2 = _mm_unpacklo_epi32(a1, a3);
+		const __m128i b3 = _mm_unpackhi_epi32(a1, a3);
+		const __m128i b4 = _mm_unpacklo_epi32(a4, a6);
+		const __m128i b5 = _mm_unpackhi_epi32(a4, a6);
+		const __m128i b6 = _mm_unpacklo_epi32(a5, a7);
+		const __m128i b7 = _mm_unpackhi_epi32(a5, a7);
+		rows[0] = _mm_unpacklo_epi64(b0, b4);
+		rows[1] = _mm_unpackhi_epi64(b0, b4);
+		rows[2] = _mm_unpacklo_epi64(b1, b5);
+		rows[3] = _mm_unpackhi_epi64(b1, b5);
+		rows[4] = _mm_unpacklo_epi64(b2, b6);
+		rows[5] = _mm_unpackhi_epi64(b2, b6);
+		rows[6] = _mm_unpacklo_epi64(b3, b7);
+		rows[7] = _mm_unpackhi_epi64(b3, b7);
+	}
+
+	// 1D pass of integer inverse DCT of libjpeg (jidctint.c) over 8 lanes at once - inputs[k] holds k-th coefficient of every lane.
+	// Every product of jidctint is expanded into linear combination of inputs, so pairs of products are single _mm_madd_epi16 and
+	// 32 bit results are exactly the ones of libjpeg.
+	template <int SHIFT>
+	void InverseDctPass(const __m128i inputs[8], __m128i outputs[8])
+	{
+		constexpr int16_t FIX_0_298631336 = 2446;
+		constexpr int16_t FIX_0_390180644 = 3196;
+		constexpr int16_t FIX_0_541196100 = 4433;
+		constexpr int16_t FIX_0_765366865 = 6270;
+		constexpr int16_t FIX_0_899976223 = 7373;
+		constexpr int16_t FIX_1_175875602 = 9633;
+		constexpr int16_t FIX_1_501321110 = 12299;
+		constexpr int16_t FIX_1_847759065 = 15137;
+		constexpr int16_t FIX_1_961570560 = 16069;
+		constexpr int16_t FIX_2_053119869 = 16819;
+		constexpr int16_t FIX_2_562915447 = 20995;
+		constexpr int16_t FIX_3_072711026 = 25172;
+		constexpr int CONST_BITS = 13;
+
+		// Even part - (z2 + z3) * c is distributed into z2 and z3
+		const __m128i even2 = _mm_setr_epi16(FIX_0_541196100, FIX_0_541196100 - FIX_1_847759065, FIX_0_541196100, FIX_0_541196100 - FIX_1_847759065,
+			FIX_0_541196100, FIX_0_541196100 - FIX_1_847759065, FIX_0_541196100, FIX_0_541196100 - FIX_1_847759065);
+		const __m128i even3 = _mm_setr_epi16(FIX_0_541196100 + FIX_0_765366865, FIX_0_541196100, FIX_0_541196100 + FIX_0_765366865, FIX_0_541196100,
+			FIX_0_541196100 + FIX_0_765366865, FIX_0_541196100, FIX_0_541196100 + FIX_0_765366865, FIX_0_541196100);
+		// Odd part - z1 .. z5 are sums of inputs 1, 3, 5, 7, so every odd output is weighted sum of the 4 inputs
+		constexpr int16_t K = FIX_1_175875602;
+		auto pair = [](int16_t first, int16_t second) { return _mm_setr_epi16(first, second, first, second, first, second, first, second); };
+		const __m128i odd0Low = pair(K - FIX_0_899976223, K - FIX_1_961570560);
+		const __m128i odd0High = pair(K, K + FIX_0_298631336 - FIX_0_899976223 - FIX_1_961570560);
+		const __m128i odd1Low = pair(K - FIX_0_390180644, K - FIX_2_562915447);
+		const __m128i odd1High = pair(K + FIX_2_053119869 - FIX_2_562915447 - FIX_0_390180644, K);
+		const __m128i odd2Low = pair(K, K + FIX_3_072711026 - FIX_2_562915447 - FIX_1_961570560);
+		const __m128i odd2High = pair(K - FIX_2_562915447, K - FIX_1_961570560);
+		const __m128i odd3Low = pair(K + FIX_1_501321110 - FIX_0_899976223 - FIX_0_390180644, K);
+		const __m128i odd3High = pair(K - FIX_0_390180644, K - FIX_0_899976223);
+		const __m128i round = _mm_set1_epi32(1 << (SHIFT - 1));
+
+		__m128i halves[2][8];
+		for (int half = 0; half < 2; ++half)
+		{
+			auto unpack = [half](__m128i a, __m128i b) { return half == 0 ? _mm_unpacklo_epi16(a, b) : _mm_unpackhi_epi16(a, b); };
+			const __m128i inputs26 = unpack(inputs[2], inputs[6]);
+			const __m128i tmp2 = _mm_madd_epi16(inputs26, even2);
+			const __m128i tmp3 = _mm_madd_epi16(inputs26, even3);
+			// Sign extension - input lands in high half of 32 bit lane
+			const __m128i input0 = _mm_srai_epi32(unpack(_mm_setzero_si128(), inputs[0]), 16);
+			const __m128i input4 = _mm_srai_epi32(unpack(_mm_setzero_si128(), inputs[4]), 16);
+			const __m128i tmp0 = _mm_slli_epi32(_mm_add_epi32(input0, input4), CONST_BITS);
+			const __m128i tmp1 = _mm_slli_epi32(_mm_sub_epi32(input0, input4), CONST_BITS);
+			const __m128i tmp10 = _mm_add_epi32(tmp0, tmp3);
+			const __m128i tmp13 = _mm_sub_epi32(tmp0, tmp3);
+			const __m128i tmp11 = _mm_add_epi32(tmp1, tmp2);
+			const __m128i tmp12 = _mm_sub_epi32(tmp1, tmp2);
+
+			const __m128i inputs13 = unpack(inputs[1], inputs[3]);
+			const __m128i inputs57 = unpack(inputs[5], inputs[7]);
+			const __m128i odd0 = _mm_add_epi32(_mm_madd_epi16(inputs13, odd0Low), _mm_madd_epi16(inputs57, odd0High));
+			const __m128i odd1 = _mm_add_epi32(_mm_madd_epi16(inputs13, odd1Low), _mm_madd_epi16(inputs57, odd1High));
+			const __m128i odd2 = _mm_add_epi32(_mm_madd_epi16(inputs13, odd2Low), _mm_madd_epi16(inputs57, odd2High));
+			const __m128i odd3 = _mm_add_epi32(_mm_madd_epi16(inputs13, odd3Low), _mm_madd_epi16(inputs57, odd3High));
+
+			__m128i* output = halves[half];
+			output[0] = _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(tmp10, odd3), round), SHIFT);
+			output[7] = _mm_srai_epi32(_mm_add_epi32(_mm_sub_epi32(tmp10, odd3), round), SHIFT);
+			output[1] = _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(tmp11, odd2), round), SHIFT);
+			output[6] = _mm_srai_epi32(_mm_add_epi32(_mm_sub_epi32(tmp11, odd2), round), SHIFT);
+			output[2] = _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(tmp12, odd1), round), SHIFT);
+			output[5] = _mm_srai_epi32(_mm_add_epi32(_mm_sub_epi32(tmp12, odd1), round), SHIFT);
+			output[3] = _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(tmp13, odd0), round), SHIFT);
+			output[4] = _mm_srai_epi32(_mm_add_epi32(_mm_sub_epi32(tmp13, odd0), round), SHIFT);
+		}
+		for (int i = 0; i < 8; ++i)
+		{
+			outputs[i] = _mm_packs_epi32(halves[0][i], halves[1][i]);
+		}
+	}
+
+	// Integer inverse DCT of libjpeg, so decoded pixels match common decoders - block is dequantized, in natural order.
+	// Columns are transformed first, every lane being one column, then rows of transposed intermediate result.
+	void InverseDct(const int16_t* block, uint8_t* destination, size_t stride)
+	{
+		constexpr int CONST_BITS = 13;
+		constexpr int PASS1_BITS = 2;
+
+		__m128i rows[8];
+		for (int i = 0; i < 8; ++i)
+		{
+			rows[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i * 8));
+		}
+		__m128i columns[8];
+		InverseDctPass<CONST_BITS - PASS1_BITS>(rows, columns);
+		Transpose8x8(columns);
+		InverseDctPass<CONST_BITS + PASS1_BITS + 3>(columns, rows);
+		Transpose8x8(rows);
+
+		const __m128i center = _mm_set1_epi16(128);
+		for (int i = 0; i < 8; ++i)
+		{
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(destination + i * stride), _mm_packus_epi16(_mm_adds_epi16(rows[i], center), rows[i]));
+		}
+	}
+
+	struct JpegComponent {
+		uint8_t id;
+		uint32_t samplingX;
+		uint32_t samplingY;
+		uint32_t quantizationTable;
+		uint32_t dcTable;
+		uint32_t acTable;
+		int32_t dcPredictor;
+		// Samples of component, not upsampled - plane is padded to whole MCUs
+		uint32_t width;
+		uint32_t height;
+		size_t stride;
+		std::vector<uint8_t> plane;
+	};
+
+	// Baseline and extended sequential Huffman JPEG with 8 bit samples, gray or YCbCr (or RGB with Adobe marker) - progressive,
+	// arithmetic coded, lossless and CMYK files are rejected
+	class JpegDecoder
+	{
+	public:
+		JpegDecoder(const uint8_t* data, size_t size) : m_data(data), m_size(size) {}
+
+		// Reads markers up to frame header
+		bool ReadFrame(ImageDecoder::Info& info);
+		// Continues after ReadFrame
+		bool Decode(uint8_t* destination, const ImageDecoder::Subresource& subresource);
+
+	private:
+		bool NextMarker(uint8_t& marker);
+		bool ReadSegment(const uint8_t*& segment, size_t& length);
+		bool ReadTables(uint8_t marker, const uint8_t* segment, size_t length);
+		bool ReadFrameHeader(const uint8_t* segment, size_t length);
+		bool DecodeScan(const uint8_t* segment, size_t length);
+		bool DecodeBlock(JpegBitReader& reader, JpegComponent& component, uint8_t* destination);
+		void UpsampleRow(const JpegComponent& component, uint32_t row, uint8_t* destination);
+		void WriteImage(uint8_t* destination, const ImageDecoder::Subresource& subresource);
+		static bool ReadExifColorSpace(const uint8_t* tiff, size_t size, uint32_t& colorSpace);
+
+	private:
+		const uint8_t* m_data;
+		size_t m_size;
+		size_t m_position = 0;
+
+		uint32_t m_width = 0;
+		uint32_t m_height = 0;
+		std::vector<JpegComponent> m_components;
+		uint32_t m_maxSamplingX = 1;
+		uint32_t m_maxSamplingY = 1;
+		uint32_t m_mcuCountX = 0;
+		uint32_t m_mcuCountY = 0;
+
+		uint16_t m_quantization[4][64];
+		bool m_quantizationDefined[4] = {};
+		JpegHuffmanTable m_dcTables[4];
+		JpegHuffmanTable m_acTables[4];
+		uint32_t m_restartInterval = 0;
+
+		bool m_jfif = false;
+		int32_t m_adobeTransform = -1;
+		bool m_srgb = false;
+		std::vector<int16_t> m_rowSums;
+	};
+
+	bool JpegDecoder::NextMarker(uint8_t& marker)
+	{
+		// Garbage before marker is skipped, like libjpeg does
+		while (m_position + 1 < m_size && (m_data[m_position] != 0xFF || m_data[m_position + 1] == 0xFF || m_data[m_position + 1] == 0))
+		{
+			++m_position;
+		}
+		if (m_position + 1 >= m_size) {
+			return false;
+		}
+		marker = m_data[m_position + 1];
+		m_position += 2;
+		return true;
+	}
+
+	bool JpegDecoder::ReadSegment(const uint8_t*& segment, size_t& length)
+	{
+		if (m_position + 2 > m_size) {
+			return false;
+		}
+		const size_t segmentLength = ReadBigEndian16(m_data + m_position);
+		if (segmentLength < 2 || m_position + segmentLength > m_size) {
+			return false;
+		}
+		segment = m_data + m_position + 2;
+		length = segmentLength - 2;
+		m_position += segmentLength;
+		return true;
+	}
+
+	bool JpegDecoder::ReadExifColorSpace(const uint8_t* tiff, size_t size, uint32_t& colorSpace)
+	{
+		if (size < 8 || !((tiff[0] == 'I' && tiff[1] == 'I') || (tiff[0] == 'M' && tiff[1] == 'M'))) {
+			return false;
+		}
+		const bool bigEndian = tiff[0] == 'M';
+		auto read16 = [&](size_t offset) { return bigEndian ? ReadBigEndian16(tiff + offset) : static_cast<uint32_t>(tiff[offset] | (tiff[offset + 1] << 8)); };
+		auto read32 = [&](size_t offset) { return bigEndian ? ReadBigEndian32(tiff + offset) : ReadLittleEndian32(tiff + offset); };
+
+		// ColorSpace tag lives in Exif IFD, which is referenced from IFD0
+		auto findTag = [&](size_t directory, uint32_t tag, size_t& entry) {
+			if (directory + 2 > size) {
+				return false;
+			}
+			const size_t entryCount = read16(directory);
+			for (size_t i = 0; i < entryCount && directory + 2 + i * 12 + 12 <= size; ++i)
+			{
+				entry = directory + 2 + i * 12;
+				if (read16(entry) == tag) {
+					return true;
+				}
+			}
+			return false;
+		};
+
+		size_t entry;
+		if (!findTag(read32(4), 0x8769, entry) || !findTag(read32(entry + 8), 0xA001, entry) || read16(entry + 2) != 3) {
+			return false;
+		}
+		colorSpace = read16(entry + 8);
+		return true;
+	}
+
+	bool JpegDecoder::ReadTables(uint8_t marker, const uint8_t* segment, size_t length)
+	{
+		const uint8_t* end = segment + length;
+		switch (marker)
+		{
+		case 0xDB:
+			while (segment < end)
+			{
+				const uint32_t precision = segment[0] >> 4;
+				const uint32_t table = segment[0] & 15;
+				const size_t tableSize = precision == 0 ? 64 : 128;
+				if (table >= 4 || precision > 1 || static_cast<size_t>(end - segment) < 1 + tableSize) {
+					return false;
+				}
+				for (size_t i = 0; i < 64; ++i)
+				{
+					m_quantization[table][ZIGZAG[i]] = static_cast<uint16_t>(precision == 0 ? segment[1 + i] : ReadBigEndian16(segment + 1 + i * 2));
+				}
+				m_quantizationDefined[table] = true;
+				segment += 1 + tableSize;
+			}
+			return true;
+		case 0xC4:
+			while (segment < end)
+			{
+				if (end - segment < 17) {
+					return false;
+				}
+				const uint32_t tableClass = segment[0] >> 4;
+				const uint32_t table = segment[0] & 15;
+				size_t symbolCount = 0;
+				for (size_t i = 0; i < 16; ++i)
+				{
+					symbolCount += segment[1 + i];
+				}
+				if (tableClass > 1 || table >= 4 || symbolCount > 256 || static_cast<size_t>(end - segment) < 17 + symbolCount) {
+					return false;
+				}
+				JpegHuffmanTable& huffman = tableClass == 0 ? m_dcTables[table] : m_acTables[table];
+				if (!huffman.Build(segment + 1, segment + 17, symbolCount)) {
+					return false;
+				}
+				segment += 17 + symbolCount;
+			}
+			return true;
+		case 0xDD:
+			if (length < 2) {
+				return false;
+			}
+			m_restartInterval = ReadBigEndian16(segment);
+			return true;
+		case 0xE0:
+			m_jfif = m_jfif || (length >= 5 && memcmp(segment, "JFIF", 5) == 0);
+			return true;
+		case 0xE1: {
+			// Same rule as DirectXTex - Exif ColorSpace 1 means sRGB
+			uint32_t colorSpace;
+			if (length >= 6 && memcmp(segment, "Exif\0\0", 6) == 0 && ReadExifColorSpace(segment + 6, length - 6, colorSpace)) {
+				m_srgb = colorSpace == 1;
+			}
+			return true;
+		}
+		case 0xEE:
+			if (length >= 12 && memcmp(segment, "Adobe", 5) == 0) {
+				m_adobeTransform = segment[11];
+			}
+			return true;
+		default:
+			return true;
+		}
+	}
+
+	bool JpegDecoder::ReadFrameHeader(const uint8_t* segment, size_t length)
+	{
+		if (length < 6) {
+			return false;
+		}
+		m_height = ReadBigEndian16(segment + 1);
+		m_width = ReadBigEndian16(segment + 3);
+		const size_t componentCount = segment[5];
+		// Height defined by DNL marker isn't supported
+		if (segment[0] != 8 || m_width == 0 || m_height == 0 || (componentCount != 1 && componentCount != 3) || length < 6 + componentCount * 3) {
+			return false;
+		}
+
+		m_components.resize(componentCount);
+		for (size_t i = 0; i < componentCount; ++i)
+		{
+			JpegComponent& component = m_components[i];
+			const uint8_t* parameters = segment + 6 + i * 3;
+			component.id = parameters[0];
+			// Single component scan is never interleaved, its MCU is one block whatever sampling says
+			component.samplingX = componentCount == 1 ? 1 : parameters[1] >> 4;
+			component.samplingY = componentCount == 1 ? 1 : parameters[1] & 15;
+			component.quantizationTable = parameters[2];
+			if (component.samplingX < 1 || component.samplingX > 4 || component.samplingY < 1 || component.samplingY > 4 || component.quantizationTable >= 4) {
+				return false;
+			}
+			m_maxSamplingX = std::max(m_maxSamplingX, component.samplingX);
+			m_maxSamplingY = std::max(m_maxSamplingY, component.samplingY);
+		}
+
+		m_mcuCountX = (m_width + 8 * m_maxSamplingX - 1) / (8 * m_maxSamplingX);
+		m_mcuCountY = (m_height + 8 * m_maxSamplingY - 1) / (8 * m_maxSamplingY);
+		for (JpegComponent& component : m_components)
+		{
+			// Upsampling works with whole ratios only
+			if (m_maxSamplingX % component.samplingX != 0 || m_maxSamplingY % component.samplingY != 0) {
+				return false;
+			}
+			component.width = (m_width * component.samplingX + m_maxSamplingX - 1) / m_maxSamplingX;
+			component.height = (m_height * component.samplingY + m_maxSamplingY - 1) / m_maxSamplingY;
+			component.stride = static_cast<size_t>(m_mcuCountX) * component.samplingX * 8;
+		}
+		return true;
+	}
+
+	bool JpegDecoder::ReadFrame(ImageDecoder::Info& info)
+	{
+		if (m_size < 4 || m_data[0] != 0xFF || m_data[1] != 0xD8) {
+			return false;
+		}
+		m_position = 2;
+
+		uint8_t marker;
+		while (NextMarker(marker))
+		{
+			const uint8_t* segment;
+			size_t length;
+			if (marker == 0xD8 || marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) {
+				continue;
+			}
+			if (marker == 0xD9 || marker == 0xDA || !ReadSegment(segment, length)) {
+				return false;
+			}
+			if (marker == 0xC0 || marker == 0xC1) {
+				if (!ReadFrameHeader(segment, length)) {
+					return false;
+				}
+				info.type = ImageDecoder::FileType::Jpeg;
+				info.width = m_width;
+				info.height = m_height;
+				info.mipLevels = 1;
+				info.arraySize = 1;
+				info.cubemap = false;
+				info.format = m_components.size() == 1 ? ImageDecoder::FORMAT_R8_UNORM : (m_srgb ? ImageDecoder::FORMAT_R8G8B8A8_UNORM_SRGB : ImageDecoder::FORMAT_R8G8B8A8_UNORM);
+				return true;
+			}
+			// Remaining SOF markers - progressive, lossless, arithmetic coded
+			if (marker >= 0xC2 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC) {
+				return false;
+			}
+			if (!ReadTables(marker, segment, length)) {
+				return false;
+			}
+		}
+		return false;
+	}
+
+	bool JpegDecoder::DecodeBlock(JpegBitReader& reader, JpegComponent& component, uint8_t* destination)
+	{
+		const uint16_t* quantization = m_quantization[component.quantizationTable];
+		const int dcLength = reader.Decode(m_dcTables[component.dcTable]);
+		if (dcLength < 0 || dcLength > 11) {
+			return false;
+		}
+		component.dcPredictor += reader.Receive(dcLength);
+
+		// 16 bit coefficients like libjpeg - dequantized values of valid files fit
+		int16_t block[64] = {};
+		block[0] = static_cast<int16_t>(component.dcPredictor * quantization[0]);
+		bool hasAc = false;
+		const JpegHuffmanTable& acTable = m_acTables[component.acTable];
+		for (size_t k = 1; k < 64; ++k)
+		{
+			const int32_t shortCoefficient = reader.DecodeShortCoefficient(acTable);
+			if (shortCoefficient != 0) {
+				k += (shortCoefficient >> 4) & 15;
+				if (k > 63) {
+					return false;
+				}
+				block[ZIGZAG[k]] = static_cast<int16_t>((shortCoefficient >> 8) * quantization[ZIGZAG[k]]);
+				hasAc = true;
+				continue;
+			}
+
+			const int symbol = reader.Decode(acTable);
+			if (symbol < 0) {
+				return false;
+			}
+			const int run = symbol >> 4;
+			const int length = symbol & 15;
+			if (length == 0) {
+				if (run != 15) {
+					break;
+				}
+				k += 15;
+				continue;
+			}
+			k += run;
+			if (k > 63) {
+				return false;
+			}
+			block[ZIGZAG[k]] = static_cast<int16_t>(reader.Receive(length) * quantization[ZIGZAG[k]]);
+			hasAc = true;
+		}
+
+		if (hasAc) {
+			InverseDct(block, destination, component.stride);
+			return true;
+		}
+		// Flat block, same rounding as full transform
+		const uint8_t value = Saturate(((block[0] + 4) >> 3) + 128);
+		for (size_t row = 0; row < 8; ++row)
+		{
+			memset(destination + row * component.stride, value, 8);
+		}
+		return true;
+	}
+
+	bool JpegDecoder::DecodeScan(const uint8_t* segment, size_t length)
+	{
+		if (length < 1) {
+			return false;
+		}
+		const size_t scanComponentCount = segment[0];
+		if (scanComponentCount < 1 || scanComponentCount > m_components.size() || length < 4 + scanComponentCount * 2) {
+			return false;
+		}
+
+		JpegComponent* components[4];
+		uint32_t blocksPerMcu = 0;
+		for (size_t i = 0; i < scanComponentCount; ++i)
+		{
+			const uint8_t id = segment[1 + i * 2];
+			const uint8_t tables = segment[2 + i * 2];
+			const auto it = std::find_if(m_components.begin(), m_components.end(), [id](const JpegComponent& component) { return component.id == id; });
+			if (it == m_components.end()) {
+				return false;
+			}
+			it->dcTable = tables >> 4;
+			it->acTable = tables & 15;
+			if (it->dcTable >= 4 || it->acTable >= 4 || !m_dcTables[it->dcTable].defined || !m_acTables[it->acTable].defined || !m_quantizationDefined[it->quantizationTable]) {
+				return false;
+			}
+			it->dcPredictor = 0;
+			components[i] = &*it;
+			blocksPerMcu += it->samplingX * it->samplingY;
+		}
+		// Sequential scan covers all coefficients
+		const uint8_t* spectral = segment + 1 + scanComponentCount * 2;
+		if (spectral[0] != 0 || spectral[1] != 63 || spectral[2] != 0 || blocksPerMcu > 10) {
+			return false;
+		}
+
+		JpegBitReader reader{ m_data, m_size, m_position };
+		// Single component scan goes through blocks of that component only, in raster order
+		const bool interleaved = scanComponentCount > 1;
+		const uint32_t countX = interleaved ? m_mcuCountX : (components[0]->width + 7) / 8;
+		const uint32_t countY = interleaved ? m_mcuCountY : (components[0]->height + 7) / 8;
+		uint32_t mcu = 0;
+		for (uint32_t mcuY = 0; mcuY < countY; ++mcuY)
+		{
+			for (uint32_t mcuX = 0; mcuX < countX; ++mcuX, ++mcu)
+			{
+				if (m_restartInterval > 0 && mcu > 0 && mcu % m_restartInterval == 0) {
+					reader.Restart();
+					for (size_t i = 0; i < scanComponentCount; ++i)
+					{
+						components[i]->dcPredictor = 0;
+					}
+				}
+
+				if (!interleaved) {
+					JpegComponent& component = *components[0];
+					if (!DecodeBlock(reader, component, component.plane.data() + mcuY * 8 * component.stride + mcuX * 8)) {
+						return false;
+					}
+					continue;
+				}
+				for (size_t i = 0; i < scanComponentCount; ++i)
+				{
+					JpegComponent& component = *components[i];
+					for (uint32_t blockY = 0; blockY < component.samplingY; ++blockY)
+					{
+						for (uint32_t blockX = 0; blockX < component.samplingX; ++blockX)
+						{
+							const size_t x = (static_cast<size_t>(mcuX) * component.samplingX + blockX) * 8;
+							const size_t y = (static_cast<size_t>(mcuY) * component.samplingY + blockY) * 8;
+							if (!DecodeBlock(reader, component, component.plane.data() + y * component.stride + x)) {
+								return false;
+							}
+						}
+					}
+				}
+			}
+		}
+		m_position = reader.GetPosition();
+		return true;
+	}
+
+	// Triangle filter of libjpeg ("fancy upsampling") for 2x ratios, nearest sample for larger ones
+	void JpegDecoder::UpsampleRow(const JpegComponent& component, uint32_t row, uint8_t* destination)
+	{
+		const uint32_t ratioX = m_maxSamplingX / component.samplingX;
+		const uint32_t ratioY = m_maxSamplingY / component.samplingY;
+		const uint32_t sourceRow = row / ratioY;
+		const uint8_t* near = component.plane.data() + sourceRow * component.stride;
+		if (ratioX > 2 || ratioY > 2) {
+			for (uint32_t x = 0; x < m_width; ++x)
+			{
+				destination[x] = near[x / ratioX];
+			}
+			return;
+		}
+
+		// Column sums are 4x sample, nearer row has weight 3 - at most 1020, so 8 of them fit into SSE register
+		const uint8_t* far = near;
+		if (ratioY == 2) {
+			const uint32_t farRow = row % 2 == 0 ? (sourceRow > 0 ? sourceRow - 1 : 0) : std::min(sourceRow + 1, component.height - 1);
+			far = component.plane.data() + farRow * component.stride;
+		}
+		const __m128i zero = _mm_setzero_si128();
+		int16_t* sums = m_rowSums.data();
+		uint32_t x = 0;
+		for (; x + 8 <= component.width; x += 8)
+		{
+			const __m128i nearSamples = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(near + x)), zero);
+			const __m128i farSamples = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(far + x)), zero);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(sums + x), _mm_add_epi16(_mm_add_epi16(nearSamples, _mm_add_epi16(nearSamples, nearSamples)), farSamples));
+		}
+		for (; x < component.width; ++x)
+		{
+			sums[x] = static_cast<int16_t>(near[x] * 3 + far[x]);
+		}
+
+		if (ratioX == 1) {
+			const int16_t bias = row % 2 == 0 ? 1 : 2;
+			x = 0;
+			for (; x + 8 <= m_width; x += 8)
+			{
+				const __m128i value = _mm_srli_epi16(_mm_add_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(sums + x)), _mm_set1_epi16(bias)), 2);
+				_mm_storel_epi64(reinterpret_cast<__m128i*>(destination + x), _mm_packus_epi16(value, zero));
+			}
+			for (; x < m_width; ++x)
+			{
+				destination[x] = static_cast<uint8_t>((sums[x] + bias) >> 2);
+			}
+			return;
+		}
+
+		// Biases alternate like in libjpeg, so halves of pixel pair round the opposite ways - edge columns are their own neighbours
+		const int16_t evenBias = ratioY == 2 ? 8 : 4;
+		const int16_t oddBias = ratioY == 2 ? 7 : 8;
+		auto writePair = [&](uint32_t sourceX) {
+			const int32_t center = sums[sourceX] * 3;
+			destination[sourceX * 2] = static_cast<uint8_t>((center + sums[sourceX > 0 ? sourceX - 1 : 0] + evenBias) >> 4);
+			if (sourceX * 2 + 1 < m_width) {
+				destination[sourceX * 2 + 1] = static_cast<uint8_t>((center + sums[std::min(sourceX + 1, component.width - 1)] + oddBias) >> 4);
+			}
+		};
+
+		writePair(0);
+		uint32_t sourceX = 1;
+		for (; sourceX + 9 <= component.width; sourceX += 8)
+		{
+			// Even outputs go to low bytes and odd ones to high bytes of 16 bit lanes, which interleaves them in memory
+			const __m128i center = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sums + sourceX));
+			const __m128i center3 = _mm_add_epi16(center, _mm_add_epi16(center, center));
+			const __m128i left = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sums + sourceX - 1));
+			const __m128i right = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sums + sourceX + 1));
+			const __m128i even = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(center3, left), _mm_set1_epi16(evenBias)), 4);
+			const __m128i odd = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(center3, right), _mm_set1_epi16(oddBias)), 4);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + sourceX * 2), _mm_or_si128(even, _mm_slli_epi16(odd, 8)));
+		}
+		for (; sourceX < component.width; ++sourceX)
+		{
+			writePair(sourceX);
+		}
+	}
+
+	void JpegDecoder::WriteImage(uint8_t* destination, const ImageDecoder::Subresource& subresource)
+	{
+		if (m_components.size() == 1) {
+			for (uint32_t y = 0; y < m_height; ++y)
+			{
+				memcpy(GetRow(destination, subresource, y), m_components[0].plane.data() + y * m_components[0].stride, m_width);
+			}
+			return;
+		}
+
+		// Like libjpeg - Adobe marker decides, otherwise component IDs 'R', 'G', 'B' without JFIF marker mean RGB
+		const bool rgb = m_adobeTransform == 0 ||
+			(m_adobeTransform < 0 && !m_jfif && m_components[0].id == 'R' && m_components[1].id == 'G' && m_components[2].id == 'B');
+		m_rowSums.resize(m_width);
+		std::vector<uint8_t> upsampled(static_cast<size_t>(m_width) * 3);
+		for (uint32_t y = 0; y < m_height; ++y)
+		{
+			const uint8_t* channels[3];
+			for (size_t c = 0; c < 3; ++c)
+			{
+				const JpegComponent& component = m_components[c];
+				if (component.samplingX == m_maxSamplingX && component.samplingY == m_maxSamplingY) {
+					channels[c] = component.plane.data() + y * component.stride;
+				}
+				else {
+					UpsampleRow(component, y, upsampled.data() + c * m_width);
+					channels[c] = upsampled.data() + c * m_width;
+				}
+			}
+
+			uint8_t* output = GetRow(destination, subresource, y);
+			if (!rgb) {
+				ConvertYCbCrToRgba(channels[0], channels[1], channels[2], output, m_width);
+				continue;
+			}
+			for (uint32_t x = 0; x < m_width; ++x)
+			{
+				output[x * 4 + 0] = channels[0][x];
+				output[x * 4 + 1] = channels[1][x];
+				output[x * 4 + 2] = channels[2][x];
+				output[x * 4 + 3] = 0xFF;
+			}
+		}
+	}
+
+	bool JpegDecoder::Decode(uint8_t* destination, const ImageDecoder::Subresource& subresource)
+	{
+		for (JpegComponent& component : m_components)
+		{
+			component.plane.assign(component.stride * m_mcuCountY * component.samplingY * 8, 0);
+		}
+
+		bool decodedScan = false;
+		uint8_t marker;
+		while (NextMarker(marker))
+		{
+			if (marker == 0xD9) {
+				break;
+			}
+			if (marker == 0xD8 || marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) {
+				continue;
+			}
+
+			const uint8_t* segment;
+			size_t length;
+			if (!ReadSegment(segment, length)) {
+				return false;
+			}
+			if (marker == 0xDA) {
+				if (!DecodeScan(segment, length)) {
+					return false;
+				}
+				decodedScan = true;
+			}
+			else if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC) {
+				return false;
+			}
+			else if (!ReadTables(marker, segment, length)) {
+				return false;
+			}
+		}
+		// Truncated file keeps what was decoded, like libjpeg
+		if (!decodedScan) {
+			return false;
+		}
+		WriteImage(destination, subresource);
+		return true;
+	}
+
+	// ---------------------------------------------------------------- DDS
+
+	constexpr uint32_t MakeFourCC(char a, char b, char c, char d)
+	{
+		return static_cast<uint32_t>(static_cast<uint8_t>(a)) | (static_cast<uint32_t>(static_cast<uint8_t>(b)) << 8) |
+			(static_cast<uint32_t>(static_cast<uint8_t>(c)) << 16) | (static_cast<uint32_t>(static_cast<uint8_t>(d)) << 24);
+	}
+
+	// Legacy pixel formats loaded by DirectXTex without conversion
+	uint32_t GetLegacyDdsFormat(const uint8_t* pixelFormat)
+	{
+		constexpr uint32_t DDPF_ALPHA = 0x2;
+		constexpr uint32_t DDPF_FOURCC = 0x4;
+		constexpr uint32_t DDPF_RGB = 0x40;
+		constexpr uint32_t DDPF_LUMINANCE = 0x20000;
+
+		const uint32_t flags = ReadLittleEndian32(pixelFormat + 4);
+		const uint32_t fourCC = ReadLittleEndian32(pixelFormat + 8);
+		const uint32_t bitCount = ReadLittleEndian32(pixelFormat + 12);
+		const uint32_t masks[4] = { ReadLittleEndian32(pixelFormat + 16), ReadLittleEndian32(pixelFormat + 20), ReadLittleEndian32(pixelFormat + 24), ReadLittleEndian32(pixelFormat + 28) };
+
+		if (flags & DDPF_FOURCC) {
+			switch (fourCC)
+			{
+			case MakeFourCC('D', 'X', 'T', '1'): return 71;		// BC1_UNORM
+			case MakeFourCC('D', 'X', 'T', '2'):
+			case MakeFourCC('D', 'X', 'T', '3'): return 74;		// BC2_UNORM
+			case MakeFourCC('D', 'X', 'T', '4'):
+			case MakeFourCC('D', 'X', 'T', '5'): return 77;		// BC3_UNORM
+			case MakeFourCC('A', 'T', 'I', '1'):
+			case MakeFourCC('B', 'C', '4', 'U'): return 80;		// BC4_UNORM
+			case MakeFourCC('B', 'C', '4', 'S'): return 81;		// BC4_SNORM
+			case MakeFourCC('A', 'T', 'I', '2'):
+			case MakeFourCC('B', 'C', '5', 'U'): return 83;		// BC5_UNORM
+			case MakeFourCC('B', 'C', '5', 'S'): return 84;		// BC5_SNORM
+			case 36: return 11;		// R16G16B16A16_UNORM
+			case 111: return 54;	// R16_FLOAT
+			case 112: return 34;	// R16G16_FLOAT
+			case 113: return 10;	// R16G16B16A16_FLOAT
+			case 114: return 41;	// R32_FLOAT
+			case 115: return 16;	// R32G32_FLOAT
+			case 116: return 2;		// R32G32B32A32_FLOAT
+			default: return 0;
+			}
+		}
+		if ((flags & DDPF_RGB) && bitCount == 32) {
+			if (masks[0] == 0x000000FF && masks[1] == 0x0000FF00 && masks[2] == 0x00FF0000) {
+				return 28;			// R8G8B8A8_UNORM
+			}
+			if (masks[0] == 0x00FF0000 && masks[1] == 0x0000FF00 && masks[2] == 0x000000FF) {
+				return masks[3] != 0 ? 87 : 88;		// B8G8R8A8_UNORM, B8G8R8X8_UNORM
+			}
+			return 0;
+		}
+		if ((flags & DDPF_LUMINANCE) && bitCount == 8 && masks[0] == 0xFF) {
+			return 61;				// R8_UNORM
+		}
+		if ((flags & DDPF_ALPHA) && bitCount == 8) {
+			return 65;				// A8_UNORM
+		}
+		return 0;
+	}
+
+	bool ReadDds(const uint8_t* data, size_t size, ImageDecoder::Info& info, size_t& dataOffset)
+	{
+		constexpr size_t HEADER_SIZE = 4 + 124;
+		constexpr size_t DX10_HEADER_SIZE = 20;
+		constexpr uint32_t DDSCAPS2_CUBEMAP = 0x200;
+		constexpr uint32_t DDSCAPS2_CUBEMAP_ALLFACES = 0xFC00;
+		constexpr uint32_t DDSCAPS2_VOLUME = 0x200000;
+		constexpr uint32_t DIMENSION_TEXTURE2D = 3;
+		constexpr uint32_t MISC_TEXTURECUBE = 0x4;
+
+		if (size < HEADER_SIZE || memcmp(data, "DDS ", 4) != 0 || ReadLittleEndian32(data + 4) != 124 || ReadLittleEndian32(data + 76) != 32) {
+			return false;
+		}
+		info.type = ImageDecoder::FileType::Dds;
+		info.height = ReadLittleEndian32(data + 12);
+		info.width = ReadLittleEndian32(data + 16);
+		info.mipLevels = std::max(ReadLittleEndian32(data + 28), 1u);
+		const uint8_t* pixelFormat = data + 76;
+		const uint32_t caps2 = ReadLittleEndian32(data + 112);
+
+		if ((ReadLittleEndian32(pixelFormat + 4) & 0x4) && ReadLittleEndian32(pixelFormat + 8) == MakeFourCC('D', 'X', '1', '0')) {
+			if (size < HEADER_SIZE + DX10_HEADER_SIZE) {
+				return false;
+			}
+			const uint8_t* extended = data + HEADER_SIZE;
+			info.format = ReadLittleEndian32(extended);
+			info.cubemap = (ReadLittleEndian32(extended + 8) & MISC_TEXTURECUBE) != 0;
+			info.arraySize = ReadLittleEndian32(extended + 12) * (info.cubemap ? 6 : 1);
+			if (ReadLittleEndian32(extended + 4) != DIMENSION_TEXTURE2D || info.arraySize == 0 || info.arraySize > 2048 * 6) {
+				return false;
+			}
+			dataOffset = HEADER_SIZE + DX10_HEADER_SIZE;
+		}
+		else {
+			if (caps2 & DDSCAPS2_VOLUME) {
+				return false;
+			}
+			info.cubemap = (caps2 & DDSCAPS2_CUBEMAP) != 0;
+			if (info.cubemap && (caps2 & DDSCAPS2_CUBEMAP_ALLFACES) != DDSCAPS2_CUBEMAP_ALLFACES) {
+				return false;
+			}
+			info.arraySize = info.cubemap ? 6 : 1;
+			info.format = GetLegacyDdsFormat(pixelFormat);
+			dataOffset = HEADER_SIZE;
+		}
+
+		// Mip chain can't be longer than full one
+		uint32_t fullMipLevels = 1;
+		while ((std::max(info.width, info.height) >> fullMipLevels) > 0)
+		{
+			++fullMipLevels;
+		}
+		return info.width > 0 && info.height > 0 && info.width <= ImageDecoder::MAX_DIMENSION && info.height <= ImageDecoder::MAX_DIMENSION &&
+			info.mipLevels <= fullMipLevels && ImageDecoder::GetRowSize(info.format, 1) > 0;
+	}
+
+	// DDS stores tightly packed subresources in the same order as D3D12
+	bool DecodeDds(const uint8_t* data, size_t size, const ImageDecoder::Info& info, uint8_t* destination, const ImageDecoder::Subresource* subresources)
+	{
+		ImageDecoder::Info header;
+		size_t offset;
+		if (!ReadDds(data, size, header, offset)) {
+			return false;
+		}
+
+		for (uint32_t item = 0; item < info.arraySize; ++item)
+		{
+			for (uint32_t mip = 0; mip < info.mipLevels; ++mip)
+			{
+				const ImageDecoder::Subresource& subresource = subresources[mip + item * info.mipLevels];
+				const size_t rowSize = ImageDecoder::GetRowSize(info.format, ImageDecoder::GetMipSize(info.width, mip));
+				const uint32_t rowCount = ImageDecoder::GetRowCount(info.format, ImageDecoder::GetMipSize(info.height, mip));
+				if (rowSize * rowCount > size - offset) {
+					return false;
+				}
+				for (uint32_t row = 0; row < rowCount; ++row, offset += rowSize)
+				{
+					memcpy(GetRow(destination, subresource, row), data + offset, rowSize);
+				}
+			}
+		}
+		return true;
+	}
+
+	// ---------------------------------------------------------------- HDR
+
+	// Radiance header - only RGBE pixels with standard top to bottom, left to right orientation
+	bool ReadHdr(const uint8_t* data, size_t size, ImageDecoder::Info& info, size_t& dataOffset)
+	{
+		size_t position = 0;
+		auto readLine = [&](std::string& line) {
+			const uint8_t* end = static_cast<const uint8_t*>(memchr(data + position, '\n', size - position));
+			if (!end) {
+				return false;
+			}
+			line.assign(reinterpret_cast<const char*>(data + position), end - (data + position));
+			position = end - data + 1;
+			return true;
+		};
+
+		std::string line;
+		if (!readLine(line) || (line != "#?RADIANCE" && line != "#?RGBE")) {
+			return false;
+		}
+		while (true)
+		{
+			if (!readLine(line)) {
+				return false;
+			}
+			if (line.empty()) {
+				break;
+			}
+			if (line.compare(0, 7, "FORMAT=") == 0 && line != "FORMAT=32-bit_rle_rgbe") {
+				return false;
+			}
+		}
+
+		// "-Y height +X width"
+		if (!readLine(line) || line.compare(0, 3, "-Y ") != 0) {
+			return false;
+		}
+		char* end;
+		const unsigned long height = std::strtoul(line.c_str() + 3, &end, 10);
+		if (strncmp(end, " +X ", 4) != 0) {
+			return false;
+		}
+		const unsigned long width = std::strtoul(end + 4, &end, 10);
+		if (width == 0 || height == 0 || width > ImageDecoder::MAX_DIMENSION || height > ImageDecoder::MAX_DIMENSION) {
+			return false;
+		}
+
+		info.type = ImageDecoder::FileType::Hdr;
+		info.width = static_cast<uint32_t>(width);
+		info.height = static_cast<uint32_t>(height);
+		info.mipLevels = 1;
+		info.arraySize = 1;
+		info.cubemap = false;
+		info.format = ImageDecoder::FORMAT_R32G32B32A32_FLOAT;
+		dataOffset = position;
+		return true;
+	}
+
+	// Scanline of RGBE pixels - run length encoded per channel, or flat pixels with old style runs
+	bool ReadHdrScanline(const uint8_t* data, size_t size, size_t& position, uint32_t width, uint8_t* rgbe)
+	{
+		if (position + 4 > size) {
+			return false;
+		}
+		const uint8_t* start = data + position;
+		if (width >= 8 && width < 0x8000 && start[0] == 2 && start[1] == 2 && (start[2] & 0x80) == 0) {
+			if (ReadBigEndian16(start + 2) != width) {
+				return false;
+			}
+			position += 4;
+			for (size_t channel = 0; channel < 4; ++channel)
+			{
+				uint32_t x = 0;
+				while (x < width)
+				{
+					if (position >= size) {
+						return false;
+					}
+					uint32_t count = data[position++];
+					if (count > 128) {
+						count -= 128;
+						if (position >= size || count > width - x) {
+							return false;
+						}
+						const uint8_t value = data[position++];
+						for (uint32_t i = 0; i < count; ++i, ++x)
+						{
+							rgbe[x * 4 + channel] = value;
+						}
+					}
+					else {
+						if (count == 0 || count > width - x || position + count > size) {
+							return false;
+						}
+						for (uint32_t i = 0; i < count; ++i, ++x)
+						{
+							rgbe[x * 4 + channel] = data[position++];
+						}
+					}
+				}
+			}
+			return true;
+		}
+
+		uint32_t shift = 0;
+		for (uint32_t x = 0; x < width;)
+		{
+			if (position + 4 > size) {
+				return false;
+			}
+			const uint8_t* pixel = data + position;
+			position += 4;
+			if (pixel[0] == 1 && pixel[1] == 1 && pixel[2] == 1) {
+				// Repeats previous pixel, consecutive runs make larger counts
+				const uint64_t count = static_cast<uint64_t>(pixel[3]) << shift;
+				if (x == 0 || count > width - x) {
+					return false;
+				}
+				for (uint64_t i = 0; i < count; ++i, ++x)
+				{
+					memcpy(rgbe + x * 4, rgbe + (x - 1) * 4, 4);
+				}
+				shift += 8;
+				continue;
+			}
+			memcpy(rgbe + x * 4, pixel, 4);
+			shift = 0;
+			++x;
+		}
+		return true;
+	}
+
+	bool DecodeHdr(const uint8_t* data, size_t size, uint8_t* destination, const ImageDecoder::Subresource& subresource)
+	{
+		ImageDecoder::Info info;
+		size_t position;
+		if (!ReadHdr(data, size, info, position)) {
+			return false;
+		}
+
+		std::vector<uint8_t> rgbe(static_cast<size_t>(info.width) * 4);
+		for (uint32_t y = 0; y < info.height; ++y)
+		{
+			if (!ReadHdrScanline(data, size, position, info.width, rgbe.data())) {
+				return false;
+			}
+			float* output = reinterpret_cast<float*>(GetRow(destination, subresource, y));
+			for (uint32_t x = 0; x < info.width; ++x)
+			{
+				const uint8_t* pixel = &rgbe[x * 4];
+				const float scale = pixel[3] != 0 ? std::ldexp(1.0f, pixel[3] - (128 + 8)) : 0.0f;
+				output[x * 4 + 0] = pixel[0] * scale;
+				output[x * 4 + 1] = pixel[1] * scale;
+				output[x * 4 + 2] = pixel[2] * scale;
+				output[x * 4 + 3] = 1.0f;
+			}
+		}
+		return true;
+	}
+}
+
+ImageDecoder::FileType ImageDecoder::DetectType(const uint8_t* data, size_t size)
+{
+	if (size >= 8 && memcmp(data, "\x89PNG\r\n\x1A\n", 8) == 0) {
+		return FileType::Png;
+	}
+	if (size >= 3 && data[0] == 0xFF && data[1] == 0xD8 && data[2] == 0xFF) {
+		return FileType::Jpeg;
+	}
+	if (size >= 4 && memcmp(data, "DDS ", 4) == 0) {
+		return FileType::Dds;
+	}
+	if ((size >= 10 && memcmp(data, "#?RADIANCE", 10) == 0) || (size >= 6 && memcmp(data, "#?RGBE", 6) == 0)) {
+		return FileType::Hdr;
+	}
+	return FileType::Unknown;
+}
+
+bool ImageDecoder::ReadInfo(const uint8_t* data, size_t size, Info& info)
+{
+	info = Info();
+	switch (DetectType(data, size))
+	{
+	case FileType::Png: {
+		PngHeader header;
+		if (!ReadPng(data, size, header, nullptr)) {
+			return false;
+		}
+		info.type = FileType::Png;
+		info.width = header.width;
+		info.height = header.height;
+		info.format = header.format;
+		return true;
+	}
+	case FileType::Jpeg:
+		return JpegDecoder(data, size).ReadFrame(info);
+	case FileType::Dds: {
+		size_t dataOffset;
+		return ReadDds(data, size, info, dataOffset);
+	}
+	case FileType::Hdr: {
+		size_t dataOffset;
+		return ReadHdr(data, size, info, dataOffset);
+	}
+	default:
+		return false;
+	}
+}
+
+bool ImageDecoder::Decode(const uint8_t* data, size_t size, const Info& info, uint8_t* destination, const Subresource* subresources)
+{
+	// Info has to describe this file, as destination is laid out by it
+	Info fileInfo;
+	if (!ReadInfo(data, size, fileInfo) || fileInfo.type != info.type || fileInfo.width != info.width || fileInfo.height != info.height ||
+		fileInfo.mipLevels != info.mipLevels || fileInfo.arraySize != info.arraySize || fileInfo.format != info.format) {
+		return false;
+	}
+
+	switch (info.type)
+	{
+	case FileType::Png:
+		return DecodePng(data, size, destination, subresources[0]);
+	case FileType::Jpeg: {
+		JpegDecoder decoder{ data, size };
+		return decoder.ReadFrame(fileInfo) && decoder.Decode(destination, subresources[0]);
+	}
+	case FileType::Dds:
+		return DecodeDds(data, size, info, destination, subresources);
+	case FileType::Hdr:
+		return DecodeHdr(data, size, destination, subresources[0]);
+	default:
+		return false;
+	}
+}
+
+size_t ImageDecoder::GetRowSize(uint32_t format, uint32_t width)
+{
+	const size_t blockSize = GetBlockSize(format);
+	if (blockSize > 0) {
+		return std::max<size_t>((width + 3) / 4, 1) * blockSize;
+	}
+	return (static_cast<size_t>(width) * GetBitsPerPixel(format) + 7) / 8;
+}
+
+uint32_t ImageDecoder::GetRowCount(uint32_t format, uint32_t height)
+{
+	return GetBlockSize(format) > 0 ? std::max((height + 3) / 4, 1u) : height;
+}
+
+bool ImageDecoder::LoadFile(const std::string& path, std::vector<uint8_t>& data, size_t maxSize)
+{
+	std::ifstream file{ path, std::ios::binary | std::ios::ate };
+	if (!file) {
+		return false;
+	}
+	const std::streamoff fileSize = file.tellg();
+	if (fileSize < 0) {
+		return false;
+	}
+
+	const size_t readSize = std::min(static_cast<size_t>(fileSize), maxSize);
+	data.resize(readSize);
+	file.seekg(0);
+	file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(readSize));
+	return static_cast<size_t>(file.gcount()) == readSize;
+}
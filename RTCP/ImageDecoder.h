@@ -0,0 +1,69 @@
+#pragma once
+#ifndef _IMAGE_DECODER_H_
+#define _IMAGE_DECODER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Decodes PNG, baseline JPEG, DDS and Radiance HDR files without WIC or DirectXTK. Doesn't depend on Windows or D3D12 headers, like MeshOptimizer.
+// Pixels are written straight into memory of the caller - every subresource at its own offset and row pitch, so upload heap laid out
+// by GetCopyableFootprints is filled without intermediate image. Decoder has no state, any number of files can be decoded in parallel.
+class ImageDecoder
+{
+public:
+	enum class FileType : uint32_t
+	{
+		Unknown = 0,
+		Png = 1,
+		Jpeg = 2,
+		Dds = 3,
+		Hdr = 4
+	};
+
+	struct Info {
+		FileType type = FileType::Unknown;
+		uint32_t width = 0;
+		uint32_t height = 0;
+		uint32_t mipLevels = 1;
+		// 6 faces per cube for cubemaps
+		uint32_t arraySize = 1;
+		bool cubemap = false;
+		// DXGI_FORMAT value, formats match WIC_FLAGS_FORCE_RGB of DirectXTex - grayscale PNG and JPEG decode to R8 or R16, other PNG and JPEG
+		// to RGBA8 (_SRGB if file is flagged as sRGB) or RGBA16, HDR to RGBA32 float. DDS keeps its own format, including block compressed ones
+		uint32_t format = 0;
+	};
+
+	// Where subresource starts in destination memory - rows are GetRowSize bytes long and rowPitch apart
+	struct Subresource {
+		size_t offset;
+		size_t rowPitch;
+	};
+
+	static FileType DetectType(const uint8_t* data, size_t size);
+	// Reads only headers, so prefix of file is usually enough - fails for files Decode doesn't support, like progressive JPEG or volume DDS
+	static bool ReadInfo(const uint8_t* data, size_t size, Info& info);
+	// subresources holds mipLevels * arraySize entries in D3D12 order (mip + item * mipLevels) - returns false if file is corrupted
+	static bool Decode(const uint8_t* data, size_t size, const Info& info, uint8_t* destination, const Subresource* subresources);
+
+	// Bytes of row of pixels, or of row of 4x4 blocks for block compressed formats - 0 for formats decoder can't lay out
+	static size_t GetRowSize(uint32_t format, uint32_t width);
+	// Rows of pixels, or of 4x4 blocks for block compressed formats
+	static uint32_t GetRowCount(uint32_t format, uint32_t height);
+	static uint32_t GetMipSize(uint32_t size, uint32_t mip) { return size >> mip > 0 ? size >> mip : 1; }
+
+	// Reads at most maxSize bytes - header prefix is enough for ReadInfo
+	static bool LoadFile(const std::string& path, std::vector<uint8_t>& data, size_t maxSize = SIZE_MAX);
+
+	// DXGI_FORMAT values produced by PNG, JPEG and HDR decoders
+	static constexpr uint32_t FORMAT_R32G32B32A32_FLOAT = 2;
+	static constexpr uint32_t FORMAT_R16G16B16A16_UNORM = 11;
+	static constexpr uint32_t FORMAT_R8G8B8A8_UNORM = 28;
+	static constexpr uint32_t FORMAT_R8G8B8A8_UNORM_SRGB = 29;
+	static constexpr uint32_t FORMAT_R16_UNORM = 56;
+	static constexpr uint32_t FORMAT_R8_UNORM = 61;
+	static constexpr uint32_t MAX_DIMENSION = 1 << 16;
+};
+
+#endif // !_IMAGE_DECODER_H_
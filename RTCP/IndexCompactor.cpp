@@ -0,0 +1,49 @@
+#include "IndexCompactor.h"
+#include <cassert>
+#include <cstring>
+
+CompactIndexRange IndexCompactor::Append(const uint32_t* indices, size_t indexCount, uint32_t baseVertex, size_t vertexCount, std::vector<uint8_t>& data)
+{
+	// Every range starts aligned, so it can be bound with either index format
+	data.resize((data.size() + RANGE_ALIGNMENT - 1) / RANGE_ALIGNMENT * RANGE_ALIGNMENT);
+
+	CompactIndexRange range;
+	range.byteOffset = static_cast<uint32_t>(data.size());
+	range.indexCount = static_cast<uint32_t>(indexCount);
+	range.baseVertex = baseVertex;
+	range.indexSize = vertexCount <= MAX_16BIT_VERTICES ? sizeof(uint16_t) : sizeof(uint32_t);
+	data.resize(data.size() + range.indexSize * indexCount);
+
+	uint8_t* destination = data.data() + range.byteOffset;
+	for (size_t i = 0; i < indexCount; ++i)
+	{
+		assert(indices[i] >= baseVertex && indices[i] - baseVertex < vertexCount && "Index outside of mesh vertex range");
+		const uint32_t index = indices[i] - baseVertex;
+		if (range.indexSize == sizeof(uint16_t)) {
+			const uint16_t shortIndex = static_cast<uint16_t>(index);
+			memcpy(destination + i * sizeof(uint16_t), &shortIndex, sizeof(uint16_t));
+		}
+		else {
+			memcpy(destination + i * sizeof(uint32_t), &index, sizeof(uint32_t));
+		}
+	}
+	return range;
+}
+
+void IndexCompactor::Decode(const uint8_t* data, const CompactIndexRange& range, uint32_t* indices)
+{
+	const uint8_t* source = data + range.byteOffset;
+	for (size_t i = 0; i < range.indexCount; ++i)
+	{
+		if (range.indexSize == sizeof(uint16_t)) {
+			uint16_t shortIndex;
+			memcpy(&shortIndex, source + i * sizeof(uint16_t), sizeof(uint16_t));
+			indices[i] = shortIndex + range.baseVertex;
+		}
+		else {
+			uint32_t index;
+			memcpy(&index, source + i * sizeof(uint32_t), sizeof(uint32_t));
+			indices[i] = index + range.baseVertex;
+		}
+	}
+}
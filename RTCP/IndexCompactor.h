@@ -0,0 +1,30 @@
+#pragma once
+#ifndef _INDEX_COMPACTOR_H_
+#define _INDEX_COMPACTOR_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Range of single mesh inside compact index data - indices are local to the mesh, add baseVertex for model vertex index
+struct CompactIndexRange {
+	uint32_t byteOffset;	// Aligned to RANGE_ALIGNMENT, usable as index buffer view location
+	uint32_t indexCount;
+	uint32_t baseVertex;
+	uint32_t indexSize;		// 2 or 4 bytes
+};
+
+// Stores indices of every mesh with smallest index type able to address its vertices. Doesn't depend on Windows or D3D12 headers, like MeshOptimizer.
+class IndexCompactor
+{
+public:
+	static constexpr size_t MAX_16BIT_VERTICES = 65536;
+	static constexpr size_t RANGE_ALIGNMENT = 4;
+
+	// Appends indices of single mesh to data - indices are global, baseVertex is subtracted from all of them
+	static CompactIndexRange Append(const uint32_t* indices, size_t indexCount, uint32_t baseVertex, size_t vertexCount, std::vector<uint8_t>& data);
+	// Writes indexCount global indices of range
+	static void Decode(const uint8_t* data, const CompactIndexRange& range, uint32_t* indices);
+};
+
+#endif // !_INDEX_COMPACTOR_H_
@@ -23,6 +23,8 @@ public:
 class LightSettings 
 {
 public:
+	explicit LightSettings(std::string dataPath = "lights.txt") : lightDataPath(dataPath) {}
+
 	void AddLight(Light light);
 	void RemoveLight(int lightIndex);
 	void SaveLightToFile();
@@ -32,7 +34,7 @@ public:
 
 private:
 	std::vector<Light> m_lights;
-	const std::string lightDataPath = "lights.txt";
+	const std::string lightDataPath;
 };
 
 #endif // !_LIGHT_SETTINGS_H_
@@ -0,0 +1,66 @@
+#pragma once
+#ifndef _LOCK_FREE_QUEUE_H_
+#define _LOCK_FREE_QUEUE_H_
+
+#include <atomic>
+#include <utility>
+
+// Unbounded multiple producer, single consumer queue (D. Vyukov's MPSC node queue).
+// Push is wait-free and may be called from any thread, TryPop and IsEmpty only from one consumer thread.
+// Consumer may briefly see queue as empty while producer is between its two stores - it has to poll again.
+template<typename T>
+class LockFreeQueue
+{
+public:
+	LockFreeQueue()
+	{
+		Node* stub = new Node();
+		m_head.store(stub, std::memory_order_relaxed);
+		m_tail = stub;
+	}
+
+	~LockFreeQueue()
+	{
+		T value;
+		while (TryPop(value)) {}
+		delete m_tail;
+	}
+
+	LockFreeQueue(const LockFreeQueue&) = delete;
+	LockFreeQueue& operator=(const LockFreeQueue&) = delete;
+
+	void Push(T value)
+	{
+		Node* node = new Node();
+		node->value = std::move(value);
+		Node* previous = m_head.exchange(node, std::memory_order_acq_rel);
+		previous->next.store(node, std::memory_order_release);
+	}
+
+	bool TryPop(T& value)
+	{
+		// Tail is always a consumed node - its successor holds the oldest value and becomes the new tail
+		Node* tail = m_tail;
+		Node* next = tail->next.load(std::memory_order_acquire);
+		if (next == nullptr) {
+			return false;
+		}
+		value = std::move(next->value);
+		m_tail = next;
+		delete tail;
+		return true;
+	}
+
+	bool IsEmpty() const { return m_tail->next.load(std::memory_order_acquire) == nullptr; }
+
+private:
+	struct Node {
+		std::atomic<Node*> next{ nullptr };
+		T value{};
+	};
+
+	alignas(64) std::atomic<Node*> m_head;	// Producers - separate cache line from consumer
+	alignas(64) Node* m_tail;				// Consumer
+};
+
+#endif // !_LOCK_FREE_QUEUE_H_
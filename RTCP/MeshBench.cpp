@@ -0,0 +1,208 @@
+// MeshBench.cpp - rtcp-meshbench entry point, cold assimp import on growing number of threads against warm loads from mesh cache
+
+#include "pch.h"
+#include "AsyncFileReader.h"
+#include "DeviceManager.h"
+#include "MeshCache.h"
+#include "ModelClass.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace
+{
+	// Headless device - only what the import path needs to create buffers and upload textures
+	struct HeadlessDevice
+	{
+		ComPtr<ID3D12Device5> device;
+		ComPtr<ID3D12CommandQueue> commandQueue;
+		ComPtr<ID3D12CommandAllocator> commandAllocator;
+		ComPtr<ID3D12GraphicsCommandList4> commandList;
+		ComPtr<ID3D12Fence> fence;
+		UINT64 fenceValue = 0;
+	};
+
+	struct Options
+	{
+		std::string modelPath;
+		bool rightHanded = false;
+		bool useWarp = false;
+		bool coldPageCache = false;
+		unsigned int runCount = 5;
+	};
+
+	struct Timing
+	{
+		double min;
+		double median;
+	};
+
+	HeadlessDevice CreateHeadlessDevice(bool useWarp)
+	{
+		HeadlessDevice result;
+		ComPtr<IDXGIFactory4> dxgiFactory;
+		ThrowIfFailed(CreateDXGIFactory2(0, IID_PPV_ARGS(&dxgiFactory)));
+		result.device = DeviceManager::CreateDevice(dxgiFactory, useWarp);
+		result.commandQueue = DeviceManager::CreateCommandQueue(result.device, D3D12_COMMAND_LIST_TYPE_DIRECT);
+		ThrowIfFailed(result.device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&result.commandAllocator)));
+		ThrowIfFailed(result.device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, result.commandAllocator.Get(), nullptr, IID_PPV_ARGS(&result.commandList)));
+		ThrowIfFailed(result.device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&result.fence)));
+		return result;
+	}
+
+	// Executes uploads recorded by the load and reopens command list for the next one
+	void ExecuteAndReset(HeadlessDevice& device)
+	{
+		ThrowIfFailed(device.commandList->Close());
+		ID3D12CommandList* commandLists[] = { device.commandList.Get() };
+		device.commandQueue->ExecuteCommandLists(_countof(commandLists), commandLists);
+		ThrowIfFailed(device.commandQueue->Signal(device.fence.Get(), ++device.fenceValue));
+		const HANDLE fenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+		assert(fenceEvent && "Failed to create fence event");
+		ThrowIfFailed(device.fence->SetEventOnCompletion(device.fenceValue, fenceEvent));
+		WaitForSingleObject(fenceEvent, INFINITE);
+		CloseHandle(fenceEvent);
+		ThrowIfFailed(device.commandAllocator->Reset());
+		ThrowIfFailed(device.commandList->Reset(device.commandAllocator.Get(), nullptr));
+	}
+
+	// Milliseconds from construction of the model until it's fully loaded, textures included - GPU work isn't timed
+	double LoadModel(const Options& options, const ModelLoadSettings& settings, HeadlessDevice& device)
+	{
+		if (options.coldPageCache)
+		{
+			const std::string fullPath = ModelClass::GetFullPath(options.modelPath);
+			AsyncFileReader::EvictFromCache(fullPath);
+			AsyncFileReader::EvictFromCache(MeshCache::GetCachePath(fullPath));
+		}
+
+		const auto startTime = std::chrono::high_resolution_clock::now();
+		ComPtr<ID3D12Resource> uploadHeap;
+		std::unique_ptr<ModelClass> model = options.rightHanded ? std::make_unique<ModelClass>(options.modelPath, device.device, device.commandList, uploadHeap, settings) :
+			std::make_unique<ModelClass>(options.modelPath, device.device, device.commandList, settings);
+		const std::chrono::duration<double, std::milli> loadTime = std::chrono::high_resolution_clock::now() - startTime;
+		assert(model->IsLoadComplete() && "Benchmark needs fully loaded model");
+
+		ExecuteAndReset(device);
+		model->ReleaseUploadHeaps();
+		return loadTime.count();
+	}
+
+	Timing MeasureLoads(const Options& options, const ModelLoadSettings& settings, HeadlessDevice& device)
+	{
+		std::vector<double> times;
+		for (unsigned int i = 0; i < options.runCount; ++i)
+		{
+			times.push_back(LoadModel(options, settings, device));
+		}
+		std::sort(times.begin(), times.end());
+		return { times.front(), times[times.size() / 2] };
+	}
+
+	UINT64 GetFileSize(const std::string& path)
+	{
+		WIN32_FILE_ATTRIBUTE_DATA attributes;
+		if (!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &attributes)) {
+			return 0;
+		}
+		return (static_cast<UINT64>(attributes.nFileSizeHigh) << 32) | attributes.nFileSizeLow;
+	}
+
+	void PrintRow(const char* load, const std::string& threads, const Timing& timing, double baseline)
+	{
+		printf("%-30s %8s %10.2f %10.2f %8.2fx\n", load, threads.c_str(), timing.min, timing.median, baseline / timing.median);
+	}
+
+	void PrintUsage()
+	{
+		fprintf(stderr,
+			"Usage: rtcp-meshbench <model> [--right-handed] [--warp] [--runs <count>] [--cold-page-cache]\n"
+			"  Loads model without mesh cache on 1, 2, 4... hardware threads, then from freshly written compressed and mapped mesh cache.\n"
+			"  Times include textures, every row reports minimum and median of its runs. Mesh cache of the model is rewritten.\n"
+			"  Model path is relative to the executable, texture paths to the working directory - like RTCP itself.\n"
+			"  --right-handed     import like models loaded with upload heap (SunTemple), left handed otherwise\n"
+			"  --warp             use WARP adapter, for machines without D3D12 GPU\n"
+			"  --runs <count>     loads per row, 5 by default\n"
+			"  --cold-page-cache  drop model and its cache from page cache before every load\n");
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	Options options;
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string argument = argv[i];
+		if (argument == "--right-handed") {
+			options.rightHanded = true;
+		}
+		else if (argument == "--warp") {
+			options.useWarp = true;
+		}
+		else if (argument == "--runs" && i + 1 < argc) {
+			options.runCount = std::max(1, atoi(argv[++i]));
+		}
+		else if (argument == "--cold-page-cache") {
+			options.coldPageCache = true;
+		}
+		else if (options.modelPath.empty() && argument[0] != '-') {
+			options.modelPath = argument;
+		}
+		else
+		{
+			PrintUsage();
+			return 1;
+		}
+	}
+	if (options.modelPath.empty())
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	ThrowIfFailed(CoInitializeEx(nullptr, COINIT_MULTITHREADED));
+	HeadlessDevice device = CreateHeadlessDevice(options.useWarp);
+	const std::string cachePath = MeshCache::GetCachePath(ModelClass::GetFullPath(options.modelPath));
+	const unsigned int maxThreadCount = ThreadPool::GetDefaultThreadCount();
+	printf("rtcp-meshbench: %s, %u hardware threads, %u runs per row, %s page cache\n", options.modelPath.c_str(), maxThreadCount, options.runCount, options.coldPageCache ? "cold" : "warm");
+	printf("%-30s %8s %10s %10s %9s\n", "load", "threads", "min ms", "median ms", "speedup");
+
+	// Cold import - meshes are processed by growing number of threads, speedup of every row is against serial import
+	ModelLoadSettings settings;
+	settings.useMeshCache = false;
+	std::vector<unsigned int> threadCounts;
+	for (unsigned int threadCount = 1; threadCount < maxThreadCount; threadCount *= 2)
+	{
+		threadCounts.push_back(threadCount);
+	}
+	threadCounts.push_back(maxThreadCount);
+	double serialTime = 0.0;
+	for (unsigned int threadCount : threadCounts)
+	{
+		settings.importThreadCount = threadCount;
+		const Timing timing = MeasureLoads(options, settings, device);
+		if (threadCount == 1) {
+			serialTime = timing.median;
+		}
+		PrintRow("cold import", std::to_string(threadCount), timing, serialTime);
+	}
+
+	// Warm loads - first load imports and writes the cache, the rest read it. Mapped cache is written last, it's the default of RTCP.
+	settings.useMeshCache = true;
+	settings.importThreadCount = 0;
+	for (bool compressed : { true, false })
+	{
+		settings.compressMeshCache = compressed;
+		DeleteFileA(cachePath.c_str());
+		const double writeTime = LoadModel(options, settings, device);
+		PrintRow(compressed ? "cold import + compressed write" : "cold import + mapped write", std::to_string(maxThreadCount), { writeTime, writeTime }, serialTime);
+		const Timing timing = MeasureLoads(options, settings, device);
+		PrintRow(compressed ? "warm compressed cache" : "warm mapped cache", compressed ? std::to_string(maxThreadCount) : "-", timing, serialTime);
+		printf("%-30s %.2f MB\n", compressed ? "compressed cache size" : "mapped cache size", GetFileSize(cachePath) / (1024.0 * 1024.0));
+	}
+
+	CoUninitialize();
+	return 0;
+}
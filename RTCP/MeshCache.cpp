@@ -0,0 +1,262 @@
+#include "MeshCache.h"
+#include "GeometryCodec.h"
+#include "ThreadPool.h"
+#include <fstream>
+#include <unordered_map>
+
+MeshCache::~MeshCache()
+{
+	Close();
+}
+
+bool MeshCache::Open(const std::string& sourcePath, UINT32 importFlags, UINT64 processingKey)
+{
+	Close();
+
+	MeshCacheFormat::SourceInfo sourceInfo;
+	if (!GetSourceInfo(sourcePath, sourceInfo)) {
+		return false;
+	}
+
+	const std::string cachePath = GetCachePath(sourcePath);
+	m_file = CreateFileA(cachePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (m_file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(m_file, &fileSize) || static_cast<UINT64>(fileSize.QuadPart) < sizeof(Header)) {
+		Close();
+		return false;
+	}
+
+	m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (m_mapping == NULL) {
+		Close();
+		return false;
+	}
+
+	m_view = static_cast<const UINT8*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+	if (m_view == nullptr) {
+		Close();
+		return false;
+	}
+	m_viewSize = static_cast<UINT64>(fileSize.QuadPart);
+
+	// Validate layout first, content hash is the most expensive check so it goes last
+	const MeshCacheFormat::ElementSizes sizes = { sizeof(ModelClass::VertexBufferStruct), sizeof(MeshRange), sizeof(LodRange), sizeof(ModelClass::Material), sizeof(SceneNode) };
+	const bool sourceValid = MeshCacheFormat::IsLayoutValid(*GetHeader(), m_viewSize, importFlags, processingKey, sizes) &&
+		MeshCacheFormat::IsSourceValid(*GetHeader(), sourceInfo, [&sourcePath]() { return MeshCacheFormat::HashFile(sourcePath); });
+
+	if (!sourceValid || !DecodeGeometry()) {
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+bool MeshCache::DecodeGeometry()
+{
+	const Header* header = GetHeader();
+	if (header->geometryEncoding == MeshCacheFormat::GEOMETRY_RAW) {
+		return MeshCacheFormat::IsRawGeometryValid(*header);
+	}
+
+	m_decodedVertices.resize(static_cast<size_t>(header->vertexCount));
+	m_decodedIndices.resize(static_cast<size_t>(header->indexCount));
+	m_decodedLodIndices.resize(static_cast<size_t>(header->lodIndexCount));
+
+	// Chunks of encoded streams are independent - caches with more than one chunk are decoded on all hardware threads
+	const size_t chunkCount = std::max(GeometryCodec::GetVertexChunkCount(m_decodedVertices.size()), GeometryCodec::GetIndexChunkCount(m_decodedIndices.size()));
+	std::unique_ptr<ThreadPool> threadPool = chunkCount > 1 && ThreadPool::GetDefaultThreadCount() > 1 ? std::make_unique<ThreadPool>() : nullptr;
+	GeometryCodec::ParallelFor parallelFor;
+	if (threadPool) {
+		parallelFor = [&threadPool](size_t count, const std::function<void(size_t)>& func) { threadPool->ParallelFor(count, func); };
+	}
+	return GeometryCodec::DecodeVertices(m_view + header->verticesOffset, static_cast<size_t>(header->verticesSize), m_decodedVertices.data(), m_decodedVertices.size(), sizeof(ModelClass::VertexBufferStruct), parallelFor) &&
+		GeometryCodec::DecodeIndices(m_view + header->indicesOffset, static_cast<size_t>(header->indicesSize), m_decodedIndices.data(), m_decodedIndices.size(), parallelFor) &&
+		GeometryCodec::DecodeIndices(m_view + header->lodIndicesOffset, static_cast<size_t>(header->lodIndicesSize), m_decodedLodIndices.data(), m_decodedLodIndices.size(), parallelFor);
+}
+
+void MeshCache::Close()
+{
+	if (m_view != nullptr) {
+		UnmapViewOfFile(m_view);
+		m_view = nullptr;
+	}
+	if (m_mapping != NULL) {
+		CloseHandle(m_mapping);
+		m_mapping = NULL;
+	}
+	if (m_file != INVALID_HANDLE_VALUE) {
+		CloseHandle(m_file);
+		m_file = INVALID_HANDLE_VALUE;
+	}
+	m_viewSize = 0;
+	m_decodedVertices.clear();
+	m_decodedIndices.clear();
+	m_decodedLodIndices.clear();
+}
+
+bool MeshCache::Write(const std::string& sourcePath, UINT32 importFlags, UINT64 processingKey, const std::vector<ModelClass::VertexBufferStruct>& vertices, const std::vector<UINT32>& indices, const std::vector<MeshRange>& meshRanges, const std::vector<ModelClass::MeshTexturePaths>& texturePaths,
+	const std::vector<ModelClass::Material>& materials, const std::vector<UINT32>& meshLodOffsets, const std::vector<LodRange>& lodRanges, const std::vector<UINT32>& lodIndices, const std::vector<SceneNode>& nodes, const std::vector<UINT32>& nodeMeshes, bool encodeGeometry)
+{
+	assert(meshRanges.size() == texturePaths.size() && "Every mesh range requires texture paths entry");
+	assert(meshRanges.size() == materials.size() && "Every mesh range requires material");
+	assert(meshLodOffsets.size() == meshRanges.size() + 1 && "Every mesh requires LOD offset entry");
+
+	MeshCacheFormat::SourceInfo sourceInfo;
+	if (!GetSourceInfo(sourcePath, sourceInfo)) {
+		return false;
+	}
+
+	// Prepare string table - every path is stored only once
+	std::string stringTable;
+	std::unordered_map<std::string, UINT32> stringOffsets;
+	auto addString = [&stringTable, &stringOffsets](const std::string& str) -> UINT32
+	{
+		if (str.empty()) {
+			return MeshCacheFormat::INVALID_STRING;
+		}
+		const auto it = stringOffsets.find(str);
+		if (it != stringOffsets.end()) {
+			return it->second;
+		}
+		const UINT32 offset = static_cast<UINT32>(stringTable.size());
+		stringTable.append(str);
+		stringTable.push_back('\0');
+		stringOffsets[str] = offset;
+		return offset;
+	};
+
+	std::vector<TextureEntry> textureTable(texturePaths.size());
+	for (size_t i = 0; i < texturePaths.size(); ++i)
+	{
+		textureTable[i].albedo = addString(texturePaths[i].albedo);
+		textureTable[i].specular = addString(texturePaths[i].specular);
+		textureTable[i].normal = addString(texturePaths[i].normal);
+	}
+
+	// Encoded sections replace raw vertices and indices
+	std::vector<UINT8> encodedVertices;
+	std::vector<UINT8> encodedIndices;
+	std::vector<UINT8> encodedLodIndices;
+	if (encodeGeometry)
+	{
+		GeometryCodec::EncodeVertices(vertices.data(), vertices.size(), sizeof(ModelClass::VertexBufferStruct), encodedVertices);
+		GeometryCodec::EncodeIndices(indices.data(), indices.size(), encodedIndices);
+		GeometryCodec::EncodeIndices(lodIndices.data(), lodIndices.size(), encodedLodIndices);
+	}
+	const void* verticesData = encodeGeometry ? static_cast<const void*>(encodedVertices.data()) : vertices.data();
+	const void* indicesData = encodeGeometry ? static_cast<const void*>(encodedIndices.data()) : indices.data();
+	const void* lodIndicesData = encodeGeometry ? static_cast<const void*>(encodedLodIndices.data()) : lodIndices.data();
+
+	// Fill header and compute page aligned section offsets
+	Header header;
+	MeshCacheFormat::InitHeader(header);
+	header.importFlags = importFlags;
+	header.processingKey = processingKey;
+	header.sourceSize = sourceInfo.size;
+	header.sourceWriteTime = sourceInfo.writeTime;
+	header.sourceHash = MeshCacheFormat::HashFile(sourcePath);
+	header.vertexStride = sizeof(ModelClass::VertexBufferStruct);
+	header.meshCount = static_cast<UINT32>(meshRanges.size());
+	header.geometryEncoding = encodeGeometry ? MeshCacheFormat::GEOMETRY_CODEC : MeshCacheFormat::GEOMETRY_RAW;
+	header.vertexCount = vertices.size();
+	header.indexCount = indices.size();
+	header.stringTableSize = stringTable.size();
+	header.lodCount = lodRanges.size();
+	header.lodIndexCount = lodIndices.size();
+	header.nodeCount = nodes.size();
+	header.nodeMeshCount = nodeMeshes.size();
+	header.verticesSize = encodeGeometry ? encodedVertices.size() : sizeof(ModelClass::VertexBufferStruct) * vertices.size();
+	header.indicesSize = encodeGeometry ? encodedIndices.size() : sizeof(UINT32) * indices.size();
+	header.lodIndicesSize = encodeGeometry ? encodedLodIndices.size() : sizeof(UINT32) * lodIndices.size();
+
+	header.meshRangesOffset = ALIGN(MeshCacheFormat::PAGE_ALIGNMENT, sizeof(Header));
+	header.meshLodOffsetsOffset = ALIGN(MeshCacheFormat::PAGE_ALIGNMENT, header.meshRangesOffset + sizeof(MeshRange) * meshRanges.size());
+	header.lodRangesOffset = ALIGN(MeshCacheFormat::PAGE_ALIGNMENT, header.meshLodOffsetsOffset + sizeof(UINT32) * meshLodOffsets.size());
+	header.textureTableOffset = ALIGN(MeshCacheFormat::PAGE_ALIGNMENT, header.lodRangesOffset + sizeof(LodRange) * lodRanges.size());
+	header.materialsOffset = ALIGN(MeshCacheFormat::PAGE_ALIGNMENT, header.textureTableOffset + sizeof(TextureEntry) * textureTable.size());
+	header.stringTableOffset = ALIGN(MeshCacheFormat::PAGE_ALIGNMENT, header.materialsOffset + sizeof(ModelClass::Material) * materials.size());
+	header.verticesOffset = ALIGN(MeshCacheFormat::PAGE_ALIGNMENT, header.stringTableOffset + stringTable.size());
+	header.indicesOffset = ALIGN(MeshCacheFormat::PAGE_ALIGNMENT, header.verticesOffset + header.verticesSize);
+	header.lodIndicesOffset = ALIGN(MeshCacheFormat::PAGE_ALIGNMENT, header.indicesOffset + header.indicesSize);
+	header.nodesOffset = ALIGN(MeshCacheFormat::PAGE_ALIGNMENT, header.lodIndicesOffset + header.lodIndicesSize);
+	header.nodeMeshesOffset = ALIGN(MeshCacheFormat::PAGE_ALIGNMENT, header.nodesOffset + sizeof(SceneNode) * nodes.size());
+	header.fileSize = header.nodeMeshesOffset + sizeof(UINT32) * nodeMeshes.size();
+
+	// Write to temporary file first, so interrupted write never leaves valid looking cache
+	const std::string cachePath = GetCachePath(sourcePath);
+	const std::string tempPath = cachePath + ".tmp";
+	{
+		std::ofstream file{ tempPath, std::ofstream::out | std::ofstream::binary | std::ofstream::trunc };
+		if (!file) {
+			return false;
+		}
+
+		UINT64 written = 0;
+		auto writeSection = [&file, &written](UINT64 offset, const void* data, size_t size)
+		{
+			static const char padding[MeshCacheFormat::PAGE_ALIGNMENT] = {};
+			while (written < offset)
+			{
+				const size_t paddingSize = static_cast<size_t>(std::min<UINT64>(offset - written, MeshCacheFormat::PAGE_ALIGNMENT));
+				file.write(padding, paddingSize);
+				written += paddingSize;
+			}
+			if (size > 0) {
+				file.write(reinterpret_cast<const char*>(data), size);
+				written += size;
+			}
+		};
+
+		writeSection(0, &header, sizeof(Header));
+		writeSection(header.meshRangesOffset, meshRanges.data(), sizeof(MeshRange) * meshRanges.size());
+		writeSection(header.meshLodOffsetsOffset, meshLodOffsets.data(), sizeof(UINT32) * meshLodOffsets.size());
+		writeSection(header.lodRangesOffset, lodRanges.data(), sizeof(LodRange) * lodRanges.size());
+		writeSection(header.textureTableOffset, textureTable.data(), sizeof(TextureEntry) * textureTable.size());
+		writeSection(header.materialsOffset, materials.data(), sizeof(ModelClass::Material) * materials.size());
+		writeSection(header.stringTableOffset, stringTable.data(), stringTable.size());
+		writeSection(header.verticesOffset, verticesData, static_cast<size_t>(header.verticesSize));
+		writeSection(header.indicesOffset, indicesData, static_cast<size_t>(header.indicesSize));
+		writeSection(header.lodIndicesOffset, lodIndicesData, static_cast<size_t>(header.lodIndicesSize));
+		writeSection(header.nodesOffset, nodes.data(), sizeof(SceneNode) * nodes.size());
+		writeSection(header.nodeMeshesOffset, nodeMeshes.data(), sizeof(UINT32) * nodeMeshes.size());
+
+		if (!file) {
+			return false;
+		}
+	}
+
+	return MoveFileExA(tempPath.c_str(), cachePath.c_str(), MOVEFILE_REPLACE_EXISTING) != FALSE;
+}
+
+ModelClass::MeshTexturePaths MeshCache::GetTexturePaths(UINT32 meshIndex) const
+{
+	assert(meshIndex < GetMeshCount());
+
+	const TextureEntry& entry = reinterpret_cast<const TextureEntry*>(m_view + GetHeader()->textureTableOffset)[meshIndex];
+	return { GetString(entry.albedo), GetString(entry.specular), GetString(entry.normal) };
+}
+
+std::string MeshCache::GetString(UINT32 offset) const
+{
+	if (offset == MeshCacheFormat::INVALID_STRING || offset >= GetHeader()->stringTableSize) {
+		return "";
+	}
+	return std::string(reinterpret_cast<const char*>(m_view + GetHeader()->stringTableOffset + offset));
+}
+
+bool MeshCache::GetSourceInfo(const std::string& path, MeshCacheFormat::SourceInfo& info)
+{
+	WIN32_FILE_ATTRIBUTE_DATA data;
+	if (!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &data)) {
+		return false;
+	}
+
+	info.size = (static_cast<UINT64>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+	info.writeTime = (static_cast<UINT64>(data.ftLastWriteTime.dwHighDateTime) << 32) | data.ftLastWriteTime.dwLowDateTime;
+	return true;
+}
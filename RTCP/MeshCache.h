@@ -0,0 +1,76 @@
+#pragma once
+#ifndef _MESH_CACHE_H_
+#define _MESH_CACHE_H_
+
+#include "pch.h"
+#include "ModelClass.h"
+#include "MeshCacheFormat.h"
+
+// Binary cache of imported model (*.rtcpmesh), stored next to the source asset. File layout and its validation are in MeshCacheFormat.
+// Every section starts at page boundary, so mapped file can be passed directly to PrepareBuffers.
+// Vertices and indices may be stored encoded by GeometryCodec - they are decoded into memory owned by the cache when it's opened.
+class MeshCache
+{
+public:
+	typedef MeshCacheFormat::Header Header;
+	typedef MeshCacheFormat::TextureEntry TextureEntry;
+	typedef ModelClass::MeshRange MeshRange;
+	typedef ModelClass::LodRange LodRange;
+	typedef ModelClass::SceneNode SceneNode;
+
+	MeshCache() = default;
+	~MeshCache();
+	MeshCache(const MeshCache&) = delete;
+	MeshCache& operator=(const MeshCache&) = delete;
+
+	// Maps cache of given source file - returns false if cache is missing or outdated.
+	// importFlags are assimp flags, processingKey identifies processing done by ModelClass after import.
+	bool Open(const std::string& sourcePath, UINT32 importFlags, UINT64 processingKey);
+	void Close();
+
+	static bool Write(const std::string& sourcePath, UINT32 importFlags, UINT64 processingKey, const std::vector<ModelClass::VertexBufferStruct>& vertices, const std::vector<UINT32>& indices, const std::vector<MeshRange>& meshRanges, const std::vector<ModelClass::MeshTexturePaths>& texturePaths,
+		const std::vector<ModelClass::Material>& materials, const std::vector<UINT32>& meshLodOffsets, const std::vector<LodRange>& lodRanges, const std::vector<UINT32>& lodIndices, const std::vector<SceneNode>& nodes, const std::vector<UINT32>& nodeMeshes, bool encodeGeometry = false);
+	static std::string GetCachePath(const std::string& sourcePath) { return sourcePath + ".rtcpmesh"; }
+
+	// Mapped data - valid until Close()
+	UINT32 GetMeshCount() const { return GetHeader()->meshCount; }
+	const MeshRange* GetMeshRanges() const { return reinterpret_cast<const MeshRange*>(m_view + GetHeader()->meshRangesOffset); }
+	const ModelClass::VertexBufferStruct* GetVertices() const { return IsEncoded() ? m_decodedVertices.data() : reinterpret_cast<const ModelClass::VertexBufferStruct*>(m_view + GetHeader()->verticesOffset); }
+	size_t GetVertexCount() const { return static_cast<size_t>(GetHeader()->vertexCount); }
+	const UINT32* GetIndices() const { return IsEncoded() ? m_decodedIndices.data() : reinterpret_cast<const UINT32*>(m_view + GetHeader()->indicesOffset); }
+	size_t GetIndexCount() const { return static_cast<size_t>(GetHeader()->indexCount); }
+	ModelClass::MeshTexturePaths GetTexturePaths(UINT32 meshIndex) const;
+	// One material per mesh
+	const ModelClass::Material* GetMaterials() const { return reinterpret_cast<const ModelClass::Material*>(m_view + GetHeader()->materialsOffset); }
+	// LOD chains - meshLodOffsets has meshCount + 1 entries, LODs of mesh i are lodRanges[offsets[i]..offsets[i + 1]]
+	const UINT32* GetMeshLodOffsets() const { return reinterpret_cast<const UINT32*>(m_view + GetHeader()->meshLodOffsetsOffset); }
+	const LodRange* GetLodRanges() const { return reinterpret_cast<const LodRange*>(m_view + GetHeader()->lodRangesOffset); }
+	size_t GetLodCount() const { return static_cast<size_t>(GetHeader()->lodCount); }
+	const UINT32* GetLodIndices() const { return IsEncoded() ? m_decodedLodIndices.data() : reinterpret_cast<const UINT32*>(m_view + GetHeader()->lodIndicesOffset); }
+	size_t GetLodIndexCount() const { return static_cast<size_t>(GetHeader()->lodIndexCount); }
+	// Scene graph - nodes are stored parents first, meshes of node are nodeMeshes[meshOffset..meshOffset + meshCount]
+	const SceneNode* GetSceneNodes() const { return reinterpret_cast<const SceneNode*>(m_view + GetHeader()->nodesOffset); }
+	size_t GetNodeCount() const { return static_cast<size_t>(GetHeader()->nodeCount); }
+	const UINT32* GetNodeMeshes() const { return reinterpret_cast<const UINT32*>(m_view + GetHeader()->nodeMeshesOffset); }
+	size_t GetNodeMeshCount() const { return static_cast<size_t>(GetHeader()->nodeMeshCount); }
+	bool IsEncoded() const { return GetHeader()->geometryEncoding == MeshCacheFormat::GEOMETRY_CODEC; }
+
+private:
+	const Header* GetHeader() const { return reinterpret_cast<const Header*>(m_view); }
+	std::string GetString(UINT32 offset) const;
+
+	static bool GetSourceInfo(const std::string& path, MeshCacheFormat::SourceInfo& info);
+	bool DecodeGeometry();
+
+private:
+	HANDLE m_file = INVALID_HANDLE_VALUE;
+	HANDLE m_mapping = NULL;
+	const UINT8* m_view = nullptr;
+	UINT64 m_viewSize = 0;
+	// Geometry of encoded cache, decoded when it's opened
+	std::vector<ModelClass::VertexBufferStruct> m_decodedVertices;
+	std::vector<UINT32> m_decodedIndices;
+	std::vector<UINT32> m_decodedLodIndices;
+};
+
+#endif // !_MESH_CACHE_H_
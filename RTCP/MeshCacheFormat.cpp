@@ -0,0 +1,96 @@
+#include "MeshCacheFormat.h"
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+// Constants are bound to references (std::min by MeshCache::Write), which needs out-of-line definition before C++17
+constexpr uint32_t MeshCacheFormat::VERSION;
+constexpr uint64_t MeshCacheFormat::PAGE_ALIGNMENT;
+constexpr uint32_t MeshCacheFormat::INVALID_STRING;
+
+void MeshCacheFormat::InitHeader(Header& header)
+{
+	header = {};
+	memcpy(header.magic, "RTCPMSH", sizeof(header.magic));
+	header.version = VERSION;
+}
+
+bool MeshCacheFormat::IsLayoutValid(const Header& header, uint64_t fileSize, uint32_t importFlags, uint64_t processingKey, const ElementSizes& sizes)
+{
+	return fileSize >= sizeof(Header) &&
+		memcmp(header.magic, "RTCPMSH", sizeof(header.magic)) == 0 &&
+		header.version == VERSION &&
+		header.importFlags == importFlags &&
+		header.processingKey == processingKey &&
+		header.vertexStride == sizes.vertex &&
+		(header.geometryEncoding == GEOMETRY_RAW || header.geometryEncoding == GEOMETRY_CODEC) &&
+		header.fileSize == fileSize &&
+		IsSectionValid(header.meshRangesOffset, sizes.meshRange, header.meshCount, fileSize) &&
+		IsSectionValid(header.textureTableOffset, sizeof(TextureEntry), header.meshCount, fileSize) &&
+		IsSectionValid(header.materialsOffset, sizes.material, header.meshCount, fileSize) &&
+		IsSectionValid(header.stringTableOffset, 1, header.stringTableSize, fileSize) &&
+		IsSectionValid(header.verticesOffset, 1, header.verticesSize, fileSize) &&
+		IsSectionValid(header.indicesOffset, 1, header.indicesSize, fileSize) &&
+		IsSectionValid(header.meshLodOffsetsOffset, sizeof(uint32_t), static_cast<uint64_t>(header.meshCount) + 1, fileSize) &&
+		IsSectionValid(header.lodRangesOffset, sizes.lodRange, header.lodCount, fileSize) &&
+		IsSectionValid(header.lodIndicesOffset, 1, header.lodIndicesSize, fileSize) &&
+		IsSectionValid(header.nodesOffset, sizes.sceneNode, header.nodeCount, fileSize) &&
+		IsSectionValid(header.nodeMeshesOffset, sizeof(uint32_t), header.nodeMeshCount, fileSize);
+}
+
+bool MeshCacheFormat::IsSourceValid(const Header& header, const SourceInfo& source, const HashSource& hashSource)
+{
+	// Content hash is the most expensive check so it goes last
+	return header.sourceSize == source.size &&
+		header.sourceWriteTime == source.writeTime &&
+		header.sourceHash == hashSource();
+}
+
+bool MeshCacheFormat::IsRawGeometryValid(const Header& header)
+{
+	// Sizes are divided rather than counts multiplied - product of corrupted count could wrap around to stored size
+	return header.vertexStride > 0 &&
+		header.verticesSize % header.vertexStride == 0 && header.verticesSize / header.vertexStride == header.vertexCount &&
+		header.indicesSize % sizeof(uint32_t) == 0 && header.indicesSize / sizeof(uint32_t) == header.indexCount &&
+		header.lodIndicesSize % sizeof(uint32_t) == 0 && header.lodIndicesSize / sizeof(uint32_t) == header.lodIndexCount;
+}
+
+uint64_t MeshCacheFormat::HashFile(const std::string& path)
+{
+	// FNV-1a, consuming 8 bytes per step
+	constexpr uint64_t FNV_OFFSET = 14695981039346656037ull;
+	constexpr uint64_t FNV_PRIME = 1099511628211ull;
+	// Multiple of 8, so words never straddle two reads
+	constexpr size_t BLOCK_SIZE = 1 << 20;
+	uint64_t hash = FNV_OFFSET;
+
+	std::ifstream file{ path, std::ifstream::in | std::ifstream::binary };
+	if (!file) {
+		return 0;
+	}
+
+	std::vector<char> block(BLOCK_SIZE);
+	while (file)
+	{
+		file.read(block.data(), block.size());
+		const size_t size = static_cast<size_t>(file.gcount());
+		const size_t wordCount = size / sizeof(uint64_t);
+		for (size_t i = 0; i < wordCount; ++i)
+		{
+			uint64_t word;
+			memcpy(&word, block.data() + i * sizeof(uint64_t), sizeof(uint64_t));
+			hash = (hash ^ word) * FNV_PRIME;
+		}
+		// Only the last read may end with partial word
+		for (size_t i = wordCount * sizeof(uint64_t); i < size; ++i)
+		{
+			hash = (hash ^ static_cast<uint8_t>(block[i])) * FNV_PRIME;
+		}
+	}
+	return hash;
+}
+
+bool MeshCacheFormat::IsSectionValid(uint64_t offset, uint64_t elementSize, uint64_t count, uint64_t fileSize)
+{
+	return offset <= fileSize && elementSize > 0 && count <= (fileSize - offset) / elementSize;
+}
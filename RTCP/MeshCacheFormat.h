@@ -0,0 +1,105 @@
+#pragma once
+#ifndef _MESH_CACHE_FORMAT_H_
+#define _MESH_CACHE_FORMAT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+// Layout of mesh cache file (*.rtcpmesh) and the checks deciding whether cache may replace import. Doesn't depend on Windows or D3D12 headers, like GeometryCodec.
+// Sizes of ModelClass structures stored in sections are passed in by MeshCache, so validation doesn't need to see them.
+class MeshCacheFormat
+{
+public:
+	static constexpr uint32_t VERSION = 7;
+	static constexpr uint64_t PAGE_ALIGNMENT = 4096;
+	static constexpr uint32_t INVALID_STRING = 0xFFFFFFFF;
+
+	struct Header {
+		char magic[8];
+		uint32_t version;
+		uint32_t importFlags;
+		uint64_t processingKey;
+		uint64_t sourceSize;
+		uint64_t sourceWriteTime;
+		uint64_t sourceHash;
+		uint32_t vertexStride;
+		uint32_t meshCount;
+		uint32_t geometryEncoding;
+		uint32_t padding;
+		uint64_t vertexCount;
+		uint64_t indexCount;
+		uint64_t stringTableSize;
+		uint64_t meshRangesOffset;
+		uint64_t textureTableOffset;
+		uint64_t materialsOffset;
+		uint64_t stringTableOffset;
+		uint64_t verticesOffset;
+		uint64_t indicesOffset;
+		uint64_t verticesSize;
+		uint64_t indicesSize;
+		uint64_t lodCount;
+		uint64_t lodIndexCount;
+		uint64_t meshLodOffsetsOffset;
+		uint64_t lodRangesOffset;
+		uint64_t lodIndicesOffset;
+		uint64_t lodIndicesSize;
+		uint64_t nodeCount;
+		uint64_t nodeMeshCount;
+		uint64_t nodesOffset;
+		uint64_t nodeMeshesOffset;
+		uint64_t fileSize;
+	};
+
+	// Storage of vertex, index and LOD index sections
+	enum GeometryEncoding : uint32_t
+	{
+		GEOMETRY_RAW = 0,
+		GEOMETRY_CODEC = 1
+	};
+
+	// Offsets into string table, INVALID_STRING if mesh has no texture in given slot
+	struct TextureEntry {
+		uint32_t albedo;
+		uint32_t specular;
+		uint32_t normal;
+	};
+
+	// Sizes of structures stored in sections, as compiled into the reader
+	struct ElementSizes {
+		uint64_t vertex;
+		uint64_t meshRange;
+		uint64_t lodRange;
+		uint64_t material;
+		uint64_t sceneNode;
+	};
+
+	// Identity of source asset - compared before its content hash
+	struct SourceInfo {
+		uint64_t size;
+		uint64_t writeTime;
+	};
+
+	// Returns content hash of source asset, called only if everything cheaper matched
+	typedef std::function<uint64_t()> HashSource;
+
+	// Magic and version of current format, everything else zeroed
+	static void InitHeader(Header& header);
+
+	// Cache was written by this version with the same import settings and structure sizes, and every section lies within file of given size
+	static bool IsLayoutValid(const Header& header, uint64_t fileSize, uint32_t importFlags, uint64_t processingKey, const ElementSizes& sizes);
+	// Cache was written from source of given size, write time and content
+	static bool IsSourceValid(const Header& header, const SourceInfo& source, const HashSource& hashSource);
+	// Raw geometry sections hold exactly as many elements as header says - encoded ones are checked by GeometryCodec while decoding
+	static bool IsRawGeometryValid(const Header& header);
+
+	// FNV-1a of file content, 0 if file can't be opened
+	static uint64_t HashFile(const std::string& path);
+
+private:
+	// count elements starting at offset fit into file - written so that offsets and counts read from corrupted header can't overflow
+	static bool IsSectionValid(uint64_t offset, uint64_t elementSize, uint64_t count, uint64_t fileSize);
+};
+
+#endif // !_MESH_CACHE_FORMAT_H_
@@ -0,0 +1,472 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cassert>
+#include <climits>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+// Constant is bound to references (fill constructor of std::vector), which needs out-of-line definition before C++17
+constexpr uint32_t MeshOptimizer::INVALID_INDEX;
+
+size_t MeshOptimizer::WeldVertices(void* vertices, size_t vertexCount, size_t vertexStride, size_t floatCount, float epsilon, uint32_t* indices, size_t indexCount)
+{
+	assert(vertexStride % sizeof(uint32_t) == 0 && "Vertex has to consist of 32 bit words");
+	assert(floatCount * sizeof(uint32_t) <= vertexStride);
+	if (vertexCount == 0) {
+		return 0;
+	}
+
+	uint8_t* vertexData = static_cast<uint8_t*>(vertices);
+	const size_t wordCount = vertexStride / sizeof(uint32_t);
+
+	// Keys compared by hash table - vertex itself, or copy with floats replaced by epsilon grid cell
+	std::vector<uint32_t> snappedKeys;
+	if (epsilon > 0.0f)
+	{
+		snappedKeys.resize(vertexCount * wordCount);
+		for (size_t i = 0; i < vertexCount; ++i)
+		{
+			uint32_t* key = &snappedKeys[i * wordCount];
+			memcpy(key, vertexData + i * vertexStride, vertexStride);
+			for (size_t word = 0; word < floatCount; ++word)
+			{
+				float value;
+				memcpy(&value, &key[word], sizeof(float));
+				const double scaled = std::floor(static_cast<double>(value) / epsilon + 0.5);
+				const int32_t cell = static_cast<int32_t>(std::min(std::max(scaled, static_cast<double>(INT32_MIN)), static_cast<double>(INT32_MAX)));
+				memcpy(&key[word], &cell, sizeof(int32_t));
+			}
+		}
+	}
+	auto getKey = [&](size_t vertex) -> const uint32_t*
+	{
+		return snappedKeys.empty() ? reinterpret_cast<const uint32_t*>(vertexData + vertex * vertexStride) : &snappedKeys[vertex * wordCount];
+	};
+
+	// Open addressing with linear probing, sized to power of two above twice the vertex count (load factor <= 0.5)
+	size_t capacity = 1;
+	while (capacity < vertexCount * 2)
+	{
+		capacity *= 2;
+	}
+	std::vector<uint32_t> table(capacity, INVALID_INDEX);
+	std::vector<uint32_t> remap(vertexCount);
+
+	uint32_t uniqueCount = 0;
+	for (size_t i = 0; i < vertexCount; ++i)
+	{
+		const uint32_t* key = getKey(i);
+		size_t slot = HashWords(key, wordCount) & (capacity - 1);
+		while (table[slot] != INVALID_INDEX && memcmp(getKey(table[slot]), key, vertexStride) != 0)
+		{
+			slot = (slot + 1) & (capacity - 1);
+		}
+
+		if (table[slot] == INVALID_INDEX) {
+			// First occurrence - stored vertex index is the original one, its key is never moved
+			table[slot] = static_cast<uint32_t>(i);
+			remap[i] = uniqueCount++;
+		}
+		else {
+			remap[i] = remap[table[slot]];
+		}
+	}
+
+	// Compact unique vertices - first occurrences come in increasing order of new index, so destination never overtakes source
+	uint32_t nextVertex = 0;
+	for (size_t i = 0; i < vertexCount; ++i)
+	{
+		if (remap[i] != nextVertex) {
+			continue;
+		}
+		if (nextVertex != i) {
+			memcpy(vertexData + nextVertex * vertexStride, vertexData + i * vertexStride, vertexStride);
+		}
+		nextVertex++;
+	}
+
+	for (size_t i = 0; i < indexCount; ++i)
+	{
+		assert(indices[i] < vertexCount && "Index out of mesh range");
+		indices[i] = remap[indices[i]];
+	}
+	return uniqueCount;
+}
+
+MeshOptimizer::VertexCacheStatistics MeshOptimizer::AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize, CacheModel model)
+{
+	assert(indexCount % 3 == 0 && "Only triangle lists are supported");
+	assert(cacheSize > 0);
+
+	VertexCacheStatistics statistics{};
+	statistics.triangleCount = indexCount / 3;
+
+	// FIFO - vertex is cached while less than cacheSize misses happened after it was transformed
+	std::vector<size_t> timestamps(vertexCount, 0);
+	size_t time = cacheSize + 1;
+	// LRU - most recently used vertex at the front
+	std::vector<uint32_t> lru;
+	lru.reserve(cacheSize + 1);
+	std::vector<bool> referenced(vertexCount, false);
+
+	for (size_t i = 0; i < indexCount; ++i)
+	{
+		const uint32_t index = indices[i];
+		assert(index < vertexCount && "Index out of mesh range");
+		if (!referenced[index]) {
+			referenced[index] = true;
+			statistics.vertexCount++;
+		}
+
+		if (model == CacheModel::Fifo)
+		{
+			if (time - timestamps[index] > cacheSize) {
+				timestamps[index] = time++;
+				statistics.cacheMisses++;
+			}
+		}
+		else
+		{
+			const auto it = std::find(lru.begin(), lru.end(), index);
+			if (it == lru.end())
+			{
+				statistics.cacheMisses++;
+				lru.insert(lru.begin(), index);
+				if (lru.size() > cacheSize) {
+					lru.pop_back();
+				}
+			}
+			else {
+				std::rotate(lru.begin(), it, it + 1);
+			}
+		}
+	}
+
+	statistics.acmr = statistics.triangleCount > 0 ? static_cast<float>(statistics.cacheMisses) / statistics.triangleCount : 0.0f;
+	statistics.atvr = statistics.vertexCount > 0 ? static_cast<float>(statistics.cacheMisses) / statistics.vertexCount : 0.0f;
+	return statistics;
+}
+
+void MeshOptimizer::OptimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize)
+{
+	assert(indexCount % 3 == 0 && "Only triangle lists are supported");
+	const size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0) {
+		return;
+	}
+
+	const TriangleAdjacency adjacency = BuildTriangleAdjacency(indices, indexCount, vertexCount);
+	std::vector<uint32_t> liveTriangles = adjacency.counts;
+	std::vector<size_t> timestamps(vertexCount, 0);
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<uint32_t> deadEndStack;
+	std::vector<uint32_t> candidates;
+	std::vector<uint32_t> result;
+	result.reserve(indexCount);
+
+	size_t time = cacheSize + 1;
+	uint32_t cursor = 0;
+	uint32_t fanningVertex = indices[0];
+
+	while (fanningVertex != INVALID_INDEX)
+	{
+		// Emit all remaining triangles around fanning vertex
+		candidates.clear();
+		const uint32_t* triangles = &adjacency.triangles[adjacency.offsets[fanningVertex]];
+		for (uint32_t i = 0; i < adjacency.counts[fanningVertex]; ++i)
+		{
+			const uint32_t triangle = triangles[i];
+			if (emitted[triangle]) {
+				continue;
+			}
+
+			for (uint32_t corner = 0; corner < 3; ++corner)
+			{
+				const uint32_t vertex = indices[triangle * 3 + corner];
+				result.push_back(vertex);
+				deadEndStack.push_back(vertex);
+				candidates.push_back(vertex);
+				liveTriangles[vertex]--;
+				if (time - timestamps[vertex] > cacheSize) {
+					timestamps[vertex] = time++;
+				}
+			}
+			emitted[triangle] = true;
+		}
+
+		// Next fanning vertex - prefer one that will still be in cache after its remaining triangles are emitted
+		uint32_t bestVertex = INVALID_INDEX;
+		size_t bestPriority = 0;
+		for (const uint32_t vertex : candidates)
+		{
+			if (liveTriangles[vertex] == 0) {
+				continue;
+			}
+
+			size_t priority = 1;
+			if (time - timestamps[vertex] + 2 * liveTriangles[vertex] <= cacheSize) {
+				priority += time - timestamps[vertex];
+			}
+			if (priority > bestPriority)
+			{
+				bestPriority = priority;
+				bestVertex = vertex;
+			}
+		}
+
+		// Dead end - take most recently used vertex with remaining triangles, then any vertex in input order
+		while (bestVertex == INVALID_INDEX && !deadEndStack.empty())
+		{
+			const uint32_t vertex = deadEndStack.back();
+			deadEndStack.pop_back();
+			if (liveTriangles[vertex] > 0) {
+				bestVertex = vertex;
+			}
+		}
+		while (bestVertex == INVALID_INDEX && cursor < vertexCount)
+		{
+			if (liveTriangles[cursor] > 0) {
+				bestVertex = cursor;
+			}
+			cursor++;
+		}
+
+		fanningVertex = bestVertex;
+	}
+
+	assert(result.size() == indexCount && "Every triangle has to be emitted exactly once");
+	std::copy(result.begin(), result.end(), indices);
+}
+
+void MeshOptimizer::SortTrianglesSpatially(uint32_t* indices, size_t indexCount, const float* positions, size_t vertexCount, size_t positionStride, const ParallelFor& parallelFor)
+{
+	assert(indexCount % 3 == 0 && "Index count has to be multiple of 3");
+	const size_t triangleCount = indexCount / 3;
+	if (triangleCount < 2) {
+		return;
+	}
+
+	auto getPosition = [positions, positionStride](uint32_t vertex)
+	{
+		return reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(positions) + vertex * positionStride);
+	};
+
+	// Every pass works on fixed blocks of triangles, so the result doesn't depend on whether blocks run in parallel
+	const size_t blockCount = (triangleCount + SORT_BLOCK_TRIANGLES - 1) / SORT_BLOCK_TRIANGLES;
+	auto forEachBlock = [&parallelFor, blockCount, triangleCount](const std::function<void(size_t, size_t, size_t)>& function)
+	{
+		auto runBlock = [&function, triangleCount](size_t block)
+		{
+			function(block, block * SORT_BLOCK_TRIANGLES, std::min((block + 1) * SORT_BLOCK_TRIANGLES, triangleCount));
+		};
+		if (parallelFor && blockCount > 1) {
+			parallelFor(blockCount, runBlock);
+			return;
+		}
+		for (size_t block = 0; block < blockCount; ++block)
+		{
+			runBlock(block);
+		}
+	};
+
+	// Centroids are kept multiplied by 3, scale cancels out in quantization. Bounds are reduced from bounds of blocks.
+	std::vector<float> centroids(triangleCount * 3);
+	std::vector<float> blockBounds(blockCount * 6);
+	forEachBlock([&](size_t block, size_t begin, size_t end) {
+		float* minimum = &blockBounds[block * 6];
+		float* maximum = minimum + 3;
+		std::fill(minimum, minimum + 3, FLT_MAX);
+		std::fill(maximum, maximum + 3, -FLT_MAX);
+		for (size_t i = begin; i < end; ++i)
+		{
+			const uint32_t* triangle = indices + i * 3;
+			assert(triangle[0] < vertexCount && triangle[1] < vertexCount && triangle[2] < vertexCount && "Index out of mesh range");
+			const float* a = getPosition(triangle[0]);
+			const float* b = getPosition(triangle[1]);
+			const float* c = getPosition(triangle[2]);
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				const float centroid = a[axis] + b[axis] + c[axis];
+				centroids[i * 3 + axis] = centroid;
+				minimum[axis] = std::min(minimum[axis], centroid);
+				maximum[axis] = std::max(maximum[axis], centroid);
+			}
+		}
+	});
+	float minimum[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+	float maximum[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (size_t block = 0; block < blockCount; ++block)
+	{
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			minimum[axis] = std::min(minimum[axis], blockBounds[block * 6 + axis]);
+			maximum[axis] = std::max(maximum[axis], blockBounds[block * 6 + 3 + axis]);
+		}
+	}
+
+	// Uniform scale keeps the curve isotropic for flat meshes
+	const float extent = std::max(std::max(maximum[0] - minimum[0], maximum[1] - minimum[1]), maximum[2] - minimum[2]);
+	const float gridMax = static_cast<float>((1u << MORTON_AXIS_BITS) - 1);
+	const float scale = extent > 0.0f ? gridMax / extent : 0.0f;
+	std::vector<uint32_t> keys(triangleCount);
+	std::vector<uint32_t> order(triangleCount);
+	forEachBlock([&](size_t, size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i)
+		{
+			uint32_t cell[3];
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				const float quantized = (centroids[i * 3 + axis] - minimum[axis]) * scale + 0.5f;
+				cell[axis] = static_cast<uint32_t>(std::min(std::max(quantized, 0.0f), gridMax));
+			}
+			keys[i] = EncodeMorton(cell[0], cell[1], cell[2]);
+			order[i] = static_cast<uint32_t>(i);
+		}
+	});
+
+	// LSD radix sort of (key, triangle) pairs - digits of RADIX_BITS cover all 30 key bits in 3 passes.
+	// Every block counts its digits, offsets are assigned bucket by bucket in block order, so blocks scatter independently and the sort stays stable.
+	constexpr uint32_t bucketCount = 1u << RADIX_BITS;
+	std::vector<uint32_t> sortedKeys(triangleCount);
+	std::vector<uint32_t> sortedOrder(triangleCount);
+	std::vector<uint32_t> offsets(blockCount * bucketCount);
+	for (unsigned int shift = 0; shift < 3 * MORTON_AXIS_BITS; shift += RADIX_BITS)
+	{
+		forEachBlock([&](size_t block, size_t begin, size_t end) {
+			uint32_t* blockOffsets = &offsets[block * bucketCount];
+			std::fill(blockOffsets, blockOffsets + bucketCount, 0);
+			for (size_t i = begin; i < end; ++i)
+			{
+				blockOffsets[(keys[i] >> shift) & (bucketCount - 1)]++;
+			}
+		});
+		uint32_t offset = 0;
+		for (uint32_t bucket = 0; bucket < bucketCount; ++bucket)
+		{
+			for (size_t block = 0; block < blockCount; ++block)
+			{
+				uint32_t& blockOffset = offsets[block * bucketCount + bucket];
+				const uint32_t count = blockOffset;
+				blockOffset = offset;
+				offset += count;
+			}
+		}
+		forEachBlock([&](size_t block, size_t begin, size_t end) {
+			uint32_t* blockOffsets = &offsets[block * bucketCount];
+			for (size_t i = begin; i < end; ++i)
+			{
+				const uint32_t destination = blockOffsets[(keys[i] >> shift) & (bucketCount - 1)]++;
+				sortedKeys[destination] = keys[i];
+				sortedOrder[destination] = order[i];
+			}
+		});
+		keys.swap(sortedKeys);
+		order.swap(sortedOrder);
+	}
+
+	const std::vector<uint32_t> source(indices, indices + indexCount);
+	forEachBlock([&](size_t, size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i)
+		{
+			memcpy(indices + i * 3, &source[order[i] * 3], 3 * sizeof(uint32_t));
+		}
+	});
+}
+
+void MeshOptimizer::OptimizeVertexFetch(void* vertices, size_t vertexCount, size_t vertexStride, uint32_t* indices, size_t indexCount)
+{
+	std::vector<uint32_t> remap(vertexCount, INVALID_INDEX);
+	uint32_t nextVertex = 0;
+	for (size_t i = 0; i < indexCount; ++i)
+	{
+		uint32_t& newIndex = remap[indices[i]];
+		if (newIndex == INVALID_INDEX) {
+			newIndex = nextVertex++;
+		}
+		indices[i] = newIndex;
+	}
+
+	// Keep unreferenced vertices, so vertex count of mesh doesn't change
+	for (uint32_t& newIndex : remap)
+	{
+		if (newIndex == INVALID_INDEX) {
+			newIndex = nextVertex++;
+		}
+	}
+
+	std::vector<uint8_t> reordered(vertexCount * vertexStride);
+	uint8_t* source = static_cast<uint8_t*>(vertices);
+	for (size_t i = 0; i < vertexCount; ++i)
+	{
+		memcpy(&reordered[remap[i] * vertexStride], source + i * vertexStride, vertexStride);
+	}
+	if (!reordered.empty()) {
+		memcpy(source, reordered.data(), reordered.size());
+	}
+}
+
+uint32_t MeshOptimizer::HashWords(const uint32_t* words, size_t wordCount)
+{
+	// Murmur3 style mixing of every word
+	uint32_t hash = 0;
+	for (size_t i = 0; i < wordCount; ++i)
+	{
+		uint32_t word = words[i] * 0xCC9E2D51u;
+		word = (word << 15) | (word >> 17);
+		hash ^= word * 0x1B873593u;
+		hash = ((hash << 13) | (hash >> 19)) * 5 + 0xE6546B64u;
+	}
+	hash ^= hash >> 16;
+	hash *= 0x85EBCA6Bu;
+	hash ^= hash >> 13;
+	return hash;
+}
+
+uint32_t MeshOptimizer::EncodeMorton(uint32_t x, uint32_t y, uint32_t z)
+{
+	// Spreads 10 bits so there are two zero bits between every pair of them
+	auto spread = [](uint32_t value)
+	{
+		value &= 0x3FF;
+		value = (value | (value << 16)) & 0x030000FF;
+		value = (value | (value << 8)) & 0x0300F00F;
+		value = (value | (value << 4)) & 0x030C30C3;
+		value = (value | (value << 2)) & 0x09249249;
+		return value;
+	};
+	return spread(x) | (spread(y) << 1) | (spread(z) << 2);
+}
+
+MeshOptimizer::TriangleAdjacency MeshOptimizer::BuildTriangleAdjacency(const uint32_t* indices, size_t indexCount, size_t vertexCount)
+{
+	TriangleAdjacency adjacency;
+	adjacency.counts.assign(vertexCount, 0);
+	adjacency.offsets.assign(vertexCount, 0);
+	adjacency.triangles.resize(indexCount);
+
+	for (size_t i = 0; i < indexCount; ++i)
+	{
+		assert(indices[i] < vertexCount && "Index out of mesh range");
+		adjacency.counts[indices[i]]++;
+	}
+
+	uint32_t offset = 0;
+	for (size_t v = 0; v < vertexCount; ++v)
+	{
+		adjacency.offsets[v] = offset;
+		offset += adjacency.counts[v];
+	}
+
+	// Offsets are used as write cursors and restored afterwards
+	for (size_t i = 0; i < indexCount; ++i)
+	{
+		adjacency.triangles[adjacency.offsets[indices[i]]++] = static_cast<uint32_t>(i / 3);
+	}
+	for (size_t v = 0; v < vertexCount; ++v)
+	{
+		adjacency.offsets[v] -= adjacency.counts[v];
+	}
+
+	return adjacency;
+}
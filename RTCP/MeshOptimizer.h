@@ -0,0 +1,68 @@
+#pragma once
+#ifndef _MESH_OPTIMIZER_H_
+#define _MESH_OPTIMIZER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Import-time processing of indexed triangle lists. Doesn't depend on Windows or D3D12 headers,
+// so it can be built and benchmarked outside of the renderer. Indices are local to processed mesh.
+class MeshOptimizer
+{
+public:
+	// Post-transform cache size assumed by optimization and used by default in statistics
+	static constexpr unsigned int DEFAULT_CACHE_SIZE = 16;
+
+	// Calls func(i) for every i in [0, count) and returns once all calls finished - ThreadPool::ParallelFor fits
+	typedef std::function<void(size_t count, const std::function<void(size_t)>& func)> ParallelFor;
+
+	enum class CacheModel
+	{
+		Fifo,
+		Lru
+	};
+
+	struct VertexCacheStatistics {
+		size_t triangleCount = 0;
+		size_t vertexCount = 0;			// Vertices referenced by at least one triangle
+		size_t cacheMisses = 0;
+		float acmr = 0.0f;				// Average cache miss ratio - transformed vertices per triangle, 0.5 is optimal for regular grids, 3 is worst
+		float atvr = 0.0f;				// Average transform to vertex ratio - 1 is optimal
+	};
+
+	// Collapses duplicated vertices and rewrites indices, returns new vertex count. Unique vertices are compacted to the front in order of first occurrence.
+	// Vertex is treated as 32 bit words - first floatCount words are floats snapped to epsilon grid (bitwise compared if epsilon is 0), remaining words are compared exactly.
+	static size_t WeldVertices(void* vertices, size_t vertexCount, size_t vertexStride, size_t floatCount, float epsilon, uint32_t* indices, size_t indexCount);
+	// Simulates post-transform vertex cache over index buffer
+	static VertexCacheStatistics AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize = DEFAULT_CACHE_SIZE, CacheModel model = CacheModel::Fifo);
+	// Reorders triangles for vertex cache reuse (Tipsify - Sander, Nehab, Barczak 2007)
+	static void OptimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize = DEFAULT_CACHE_SIZE);
+	// Reorders triangles along 3D Morton curve of their centroids, quantized to 10 bits per axis within mesh bounds (LSD radix sort, stable for equal codes).
+	// Triangles close in space end up close in index buffer, which helps BVH leaves and meshlets, but gives worse vertex cache reuse than OptimizeVertexCache.
+	// With parallelFor, blocks of SORT_BLOCK_TRIANGLES are counted and scattered in parallel - order is the same as without it.
+	static void SortTrianglesSpatially(uint32_t* indices, size_t indexCount, const float* positions, size_t vertexCount, size_t positionStride, const ParallelFor& parallelFor = nullptr);
+	// Reorders vertices in order of first use by index buffer and remaps indices. Unreferenced vertices are moved to the end.
+	static void OptimizeVertexFetch(void* vertices, size_t vertexCount, size_t vertexStride, uint32_t* indices, size_t indexCount);
+
+private:
+	static constexpr uint32_t INVALID_INDEX = 0xFFFFFFFF;
+	static constexpr unsigned int MORTON_AXIS_BITS = 10;
+	static constexpr unsigned int RADIX_BITS = 11;
+	static constexpr size_t SORT_BLOCK_TRIANGLES = 64 * 1024;
+
+	// Vertex to triangle adjacency in compressed form - triangles of vertex v are triangles[offsets[v]..offsets[v] + counts[v]]
+	struct TriangleAdjacency {
+		std::vector<uint32_t> counts;
+		std::vector<uint32_t> offsets;
+		std::vector<uint32_t> triangles;
+	};
+
+	static uint32_t HashWords(const uint32_t* words, size_t wordCount);
+	// Interleaves lowest 10 bits of every coordinate - x goes to bit 0, y to bit 1, z to bit 2
+	static uint32_t EncodeMorton(uint32_t x, uint32_t y, uint32_t z);
+	static TriangleAdjacency BuildTriangleAdjacency(const uint32_t* indices, size_t indexCount, size_t vertexCount);
+};
+
+#endif // !_MESH_OPTIMIZER_H_
@@ -0,0 +1,566 @@
+#include "MeshSimplifier.h"
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+
+namespace
+{
+	constexpr uint32_t INVALID_INDEX = 0xFFFFFFFF;
+	// Border and seam edges weigh more than surface planes, so outlines keep their shape
+	constexpr float BOUNDARY_WEIGHT = 10.0f;
+	// Collapse is rejected if any remaining triangle normal would rotate by more than ~75 degrees
+	constexpr float MIN_NORMAL_COS = 0.25f;
+
+	struct Collapse {
+		uint32_t source;
+		uint32_t target;
+		float cost;
+	};
+
+	uint64_t EdgeKey(uint32_t a, uint32_t b)
+	{
+		return (static_cast<uint64_t>(a) << 32) | b;
+	}
+
+	size_t CountEdges(const std::vector<uint64_t>& sortedEdges, uint32_t a, uint32_t b)
+	{
+		const auto range = std::equal_range(sortedEdges.begin(), sortedEdges.end(), EdgeKey(a, b));
+		return static_cast<size_t>(range.second - range.first);
+	}
+
+	void Cross(const float* a, const float* b, const float* c, float normal[3])
+	{
+		const float e0[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+		const float e1[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+		normal[0] = e0[1] * e1[2] - e0[2] * e1[1];
+		normal[1] = e0[2] * e1[0] - e0[0] * e1[2];
+		normal[2] = e0[0] * e1[1] - e0[1] * e1[0];
+	}
+
+	float Dot(const float* a, const float* b)
+	{
+		return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+	}
+
+	// Triangles around every position in compressed form - triangles of position p are triangles[offsets[p]..offsets[p + 1]]
+	struct PositionAdjacency {
+		std::vector<uint32_t> offsets;
+		std::vector<uint32_t> triangles;
+	};
+
+	void BuildPositionAdjacency(PositionAdjacency& adjacency, const uint32_t* indices, size_t indexCount, const std::vector<uint32_t>& remap)
+	{
+		adjacency.offsets.assign(remap.size() + 1, 0);
+		adjacency.triangles.resize(indexCount);
+		for (size_t i = 0; i < indexCount; ++i)
+		{
+			adjacency.offsets[remap[indices[i]] + 1]++;
+		}
+		std::partial_sum(adjacency.offsets.begin(), adjacency.offsets.end(), adjacency.offsets.begin());
+
+		std::vector<uint32_t> cursors(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+		for (size_t i = 0; i < indexCount; ++i)
+		{
+			adjacency.triangles[cursors[remap[indices[i]]]++] = static_cast<uint32_t>(i / 3);
+		}
+	}
+}
+
+size_t MeshSimplifier::Simplify(uint32_t* destination, const uint32_t* indices, size_t indexCount, const float* positions, size_t vertexCount, size_t positionStride,
+	size_t targetIndexCount, float targetError, float* resultError)
+{
+	assert(indexCount % 3 == 0 && "Only triangle lists are supported");
+
+	// Work in unit cube, so error is relative to mesh extent
+	std::vector<float> points(vertexCount * 3);
+	float minimum[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+	float maximum[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (size_t v = 0; v < vertexCount; ++v)
+	{
+		const float* position = reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(positions) + v * positionStride);
+		for (int i = 0; i < 3; ++i)
+		{
+			minimum[i] = std::min(minimum[i], position[i]);
+			maximum[i] = std::max(maximum[i], position[i]);
+		}
+	}
+	const float extent = std::max(std::max(maximum[0] - minimum[0], maximum[1] - minimum[1]), maximum[2] - minimum[2]);
+	const float scale = extent > 0.0f ? 1.0f / extent : 1.0f;
+	for (size_t v = 0; v < vertexCount; ++v)
+	{
+		const float* position = reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(positions) + v * positionStride);
+		for (int i = 0; i < 3; ++i)
+		{
+			points[v * 3 + i] = (position[i] - minimum[i]) * scale;
+		}
+	}
+	auto point = [&points](uint32_t vertex) { return &points[vertex * 3]; };
+
+	// Wedges - vertices with the same position form circular list, remap points to first of them
+	const std::vector<uint32_t> remap = BuildPositionRemap(positions, vertexCount, positionStride);
+	std::vector<uint32_t> wedges(vertexCount);
+	for (uint32_t v = 0; v < vertexCount; ++v)
+	{
+		wedges[v] = v;
+		if (remap[v] != v)
+		{
+			wedges[v] = wedges[remap[v]];
+			wedges[remap[v]] = v;
+		}
+	}
+
+	std::copy(indices, indices + indexCount, destination);
+	size_t resultCount = indexCount;
+
+	// Surface quadrics, accumulated at first wedge of every position
+	std::vector<Quadric> quadrics(vertexCount, Quadric{});
+	for (size_t i = 0; i < indexCount; i += 3)
+	{
+		float normal[3];
+		Cross(point(indices[i]), point(indices[i + 1]), point(indices[i + 2]), normal);
+		const float length = std::sqrt(Dot(normal, normal));
+		if (length <= 0.0f) {
+			continue;
+		}
+		for (float& component : normal)
+		{
+			component /= length;
+		}
+		const float distance = -Dot(normal, point(indices[i]));
+		for (size_t corner = 0; corner < 3; ++corner)
+		{
+			AddPlane(quadrics[remap[indices[i + corner]]], normal, distance, length * 0.5f);
+		}
+	}
+
+	const float errorLimit = targetError * targetError;
+	float maxError = 0.0f;
+	bool boundaryQuadricsAdded = false;
+
+	std::vector<uint64_t> vertexEdges;
+	std::vector<uint64_t> positionEdges;
+	std::vector<uint32_t> loop(vertexCount);
+	std::vector<uint32_t> loopBack(vertexCount);
+	std::vector<uint8_t> openOut(vertexCount);
+	std::vector<uint8_t> openIn(vertexCount);
+	std::vector<uint8_t> referenced(vertexCount);
+	std::vector<uint8_t> referencedWedges(vertexCount);
+	std::vector<VertexKind> kinds(vertexCount);
+	std::vector<Collapse> collapses;
+	std::vector<uint32_t> collapseRemap(vertexCount);
+	std::vector<uint8_t> locked(vertexCount);
+	std::vector<uint32_t> sourceNeighbors;
+	std::vector<uint32_t> targetNeighbors;
+	PositionAdjacency adjacency;
+
+	// Second wedge of seam vertex - the other one with open edges at the same position
+	auto otherWedge = [&](uint32_t vertex)
+	{
+		for (uint32_t wedge = wedges[vertex]; wedge != vertex; wedge = wedges[wedge])
+		{
+			if (openOut[wedge] > 0 || openIn[wedge] > 0) {
+				return wedge;
+			}
+		}
+		return INVALID_INDEX;
+	};
+
+	while (resultCount > targetIndexCount)
+	{
+		// Directed edges of current mesh, in vertex and in position space
+		vertexEdges.clear();
+		positionEdges.clear();
+		for (size_t i = 0; i < resultCount; ++i)
+		{
+			const uint32_t a = destination[i];
+			const uint32_t b = destination[i % 3 == 2 ? i - 2 : i + 1];
+			vertexEdges.push_back(EdgeKey(a, b));
+			positionEdges.push_back(EdgeKey(remap[a], remap[b]));
+		}
+		std::sort(vertexEdges.begin(), vertexEdges.end());
+		std::sort(positionEdges.begin(), positionEdges.end());
+
+		// Open edges - directed edge without opposite one, they form border and seam loops
+		std::fill(loop.begin(), loop.end(), INVALID_INDEX);
+		std::fill(loopBack.begin(), loopBack.end(), INVALID_INDEX);
+		std::fill(openOut.begin(), openOut.end(), 0);
+		std::fill(openIn.begin(), openIn.end(), 0);
+		std::fill(referencedWedges.begin(), referencedWedges.end(), 0);
+		std::fill(kinds.begin(), kinds.end(), VertexKind::Manifold);
+		for (size_t i = 0; i < resultCount; ++i)
+		{
+			const uint32_t a = destination[i];
+			const uint32_t b = destination[i % 3 == 2 ? i - 2 : i + 1];
+			if (CountEdges(vertexEdges, b, a) == 0)
+			{
+				openOut[a] = static_cast<uint8_t>(std::min(openOut[a] + 1, 2));
+				openIn[b] = static_cast<uint8_t>(std::min(openIn[b] + 1, 2));
+				loop[a] = b;
+				loopBack[b] = a;
+			}
+			// Edge used by more than two triangles, or twice in the same direction, can't be simplified safely
+			const size_t forward = CountEdges(positionEdges, remap[a], remap[b]);
+			if (forward > 1 || forward + CountEdges(positionEdges, remap[b], remap[a]) > 2)
+			{
+				kinds[a] = VertexKind::Locked;
+				kinds[b] = VertexKind::Locked;
+			}
+		}
+
+		// Count wedges still used by mesh
+		std::fill(referenced.begin(), referenced.end(), 0);
+		for (size_t i = 0; i < resultCount; ++i)
+		{
+			if (referenced[destination[i]] == 0)
+			{
+				referenced[destination[i]] = 1;
+				referencedWedges[remap[destination[i]]] = static_cast<uint8_t>(std::min(referencedWedges[remap[destination[i]]] + 1, 3));
+			}
+		}
+
+		// Classify vertices
+		for (uint32_t v = 0; v < vertexCount; ++v)
+		{
+			if (referenced[v] == 0 || kinds[v] == VertexKind::Locked) {
+				continue;
+			}
+
+			const uint8_t wedgeCount = referencedWedges[remap[v]];
+			if (wedgeCount == 1)
+			{
+				if (openOut[v] == 0 && openIn[v] == 0) {
+					kinds[v] = VertexKind::Manifold;
+				}
+				else {
+					kinds[v] = openOut[v] == 1 && openIn[v] == 1 ? VertexKind::Border : VertexKind::Locked;
+				}
+			}
+			else if (wedgeCount == 2 && openOut[v] == 1 && openIn[v] == 1 &&
+				CountEdges(positionEdges, remap[loop[v]], remap[v]) > 0 && CountEdges(positionEdges, remap[v], remap[loopBack[v]]) > 0)
+			{
+				// Open in vertex space, closed in position space - attribute seam
+				kinds[v] = VertexKind::Seam;
+			}
+			else {
+				kinds[v] = VertexKind::Locked;
+			}
+		}
+		for (uint32_t v = 0; v < vertexCount; ++v)
+		{
+			if (kinds[v] == VertexKind::Seam)
+			{
+				const uint32_t wedge = otherWedge(v);
+				if (wedge == INVALID_INDEX || kinds[wedge] != VertexKind::Seam) {
+					kinds[v] = VertexKind::Locked;
+				}
+			}
+		}
+
+		// Border and seam edges are kept in place by planes perpendicular to them
+		if (!boundaryQuadricsAdded)
+		{
+			for (size_t i = 0; i < resultCount; ++i)
+			{
+				const uint32_t a = destination[i];
+				const uint32_t b = destination[i % 3 == 2 ? i - 2 : i + 1];
+				if (loop[a] != b) {
+					continue;
+				}
+
+				const size_t triangle = i - i % 3;
+				float triangleNormal[3];
+				Cross(point(destination[triangle]), point(destination[triangle + 1]), point(destination[triangle + 2]), triangleNormal);
+				const float edge[3] = { point(b)[0] - point(a)[0], point(b)[1] - point(a)[1], point(b)[2] - point(a)[2] };
+				float normal[3] = { edge[1] * triangleNormal[2] - edge[2] * triangleNormal[1], edge[2] * triangleNormal[0] - edge[0] * triangleNormal[2], edge[0] * triangleNormal[1] - edge[1] * triangleNormal[0] };
+				const float length = std::sqrt(Dot(normal, normal));
+				if (length <= 0.0f) {
+					continue;
+				}
+				for (float& component : normal)
+				{
+					component /= length;
+				}
+				const float distance = -Dot(normal, point(a));
+				const float weight = Dot(edge, edge) * BOUNDARY_WEIGHT;
+				AddPlane(quadrics[remap[a]], normal, distance, weight);
+				AddPlane(quadrics[remap[b]], normal, distance, weight);
+			}
+			boundaryQuadricsAdded = true;
+		}
+
+		// Candidates - borders and seams only along their loop
+		collapses.clear();
+		auto addCollapse = [&](uint32_t source, uint32_t target)
+		{
+			const VertexKind kind = kinds[source];
+			if (remap[source] == remap[target] || kind == VertexKind::Locked) {
+				return;
+			}
+			if (kind != VertexKind::Manifold && target != loop[source] && target != loopBack[source]) {
+				return;
+			}
+			collapses.push_back({ source, target, EvaluateQuadric(quadrics[remap[source]], point(target)) });
+		};
+		for (size_t i = 0; i < resultCount; ++i)
+		{
+			const uint32_t a = destination[i];
+			const uint32_t b = destination[i % 3 == 2 ? i - 2 : i + 1];
+			addCollapse(a, b);
+			addCollapse(b, a);
+		}
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+		BuildPositionAdjacency(adjacency, destination, resultCount, remap);
+		auto collectNeighbors = [&](uint32_t position, std::vector<uint32_t>& neighbors)
+		{
+			neighbors.clear();
+			for (uint32_t i = adjacency.offsets[position]; i < adjacency.offsets[position + 1]; ++i)
+			{
+				for (uint32_t corner = 0; corner < 3; ++corner)
+				{
+					const uint32_t neighbor = remap[destination[adjacency.triangles[i] * 3 + corner]];
+					if (neighbor != position) {
+						neighbors.push_back(neighbor);
+					}
+				}
+			}
+			std::sort(neighbors.begin(), neighbors.end());
+			neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+		};
+
+		// Perform cheapest independent collapses - every position around collapsed vertex is locked until next pass
+		std::iota(collapseRemap.begin(), collapseRemap.end(), 0);
+		std::fill(locked.begin(), locked.end(), 0);
+		const size_t triangleGoal = (resultCount - targetIndexCount) / 3;
+		size_t removedTriangles = 0;
+		size_t collapseCount = 0;
+		for (const Collapse& collapse : collapses)
+		{
+			if (collapse.cost > errorLimit || removedTriangles >= triangleGoal) {
+				break;
+			}
+
+			const uint32_t sourcePosition = remap[collapse.source];
+			const uint32_t targetPosition = remap[collapse.target];
+			if (locked[sourcePosition] || locked[targetPosition]) {
+				continue;
+			}
+
+			// Other wedge of seam moves to the wedge of target on the same side of the seam
+			uint32_t seamSource = INVALID_INDEX;
+			uint32_t seamTarget = INVALID_INDEX;
+			if (kinds[collapse.source] == VertexKind::Seam)
+			{
+				seamSource = otherWedge(collapse.source);
+				seamTarget = collapse.target == loop[collapse.source] ? loopBack[seamSource] : loop[seamSource];
+				if (seamTarget == INVALID_INDEX || remap[seamTarget] != targetPosition) {
+					continue;
+				}
+			}
+
+			// Link condition - positions adjacent to both ends have to be exactly the ones of triangles removed by collapse
+			collectNeighbors(sourcePosition, sourceNeighbors);
+			collectNeighbors(targetPosition, targetNeighbors);
+			size_t sharedTriangles = 0;
+			bool flipped = false;
+			for (uint32_t i = adjacency.offsets[sourcePosition]; i < adjacency.offsets[sourcePosition + 1] && !flipped; ++i)
+			{
+				const uint32_t* corners = &destination[adjacency.triangles[i] * 3];
+				if (remap[corners[0]] == targetPosition || remap[corners[1]] == targetPosition || remap[corners[2]] == targetPosition)
+				{
+					sharedTriangles++;
+					continue;
+				}
+
+				// Remaining triangles can't flip or turn too far
+				const float* oldPoints[3] = { point(corners[0]), point(corners[1]), point(corners[2]) };
+				const float* newPoints[3] = { oldPoints[0], oldPoints[1], oldPoints[2] };
+				for (uint32_t corner = 0; corner < 3; ++corner)
+				{
+					if (remap[corners[corner]] == sourcePosition) {
+						newPoints[corner] = point(collapse.target);
+					}
+				}
+				float oldNormal[3];
+				float newNormal[3];
+				Cross(oldPoints[0], oldPoints[1], oldPoints[2], oldNormal);
+				Cross(newPoints[0], newPoints[1], newPoints[2], newNormal);
+				const float oldLength = std::sqrt(Dot(oldNormal, oldNormal));
+				const float newLength = std::sqrt(Dot(newNormal, newNormal));
+				flipped = oldLength > 0.0f && Dot(oldNormal, newNormal) < MIN_NORMAL_COS * oldLength * newLength;
+				flipped |= newLength <= 0.0f;
+			}
+			if (flipped) {
+				continue;
+			}
+
+			std::vector<uint32_t>& commonNeighbors = sourceNeighbors;
+			commonNeighbors.erase(std::remove_if(commonNeighbors.begin(), commonNeighbors.end(), [&](uint32_t neighbor) {
+				return neighbor == targetPosition || !std::binary_search(targetNeighbors.begin(), targetNeighbors.end(), neighbor);
+			}), commonNeighbors.end());
+			if (commonNeighbors.size() != sharedTriangles) {
+				continue;
+			}
+
+			collapseRemap[collapse.source] = collapse.target;
+			if (seamSource != INVALID_INDEX) {
+				collapseRemap[seamSource] = seamTarget;
+			}
+			AddQuadric(quadrics[targetPosition], quadrics[sourcePosition]);
+
+			locked[sourcePosition] = 1;
+			locked[targetPosition] = 1;
+			for (uint32_t i = adjacency.offsets[sourcePosition]; i < adjacency.offsets[sourcePosition + 1]; ++i)
+			{
+				for (uint32_t corner = 0; corner < 3; ++corner)
+				{
+					locked[remap[destination[adjacency.triangles[i] * 3 + corner]]] = 1;
+				}
+			}
+
+			maxError = std::max(maxError, collapse.cost);
+			removedTriangles += sharedTriangles;
+			collapseCount++;
+		}
+
+		if (collapseCount == 0) {
+			break;
+		}
+
+		// Remap indices and drop triangles collapsed to zero area
+		size_t writeIndex = 0;
+		for (size_t i = 0; i < resultCount; i += 3)
+		{
+			const uint32_t a = collapseRemap[destination[i]];
+			const uint32_t b = collapseRemap[destination[i + 1]];
+			const uint32_t c = collapseRemap[destination[i + 2]];
+			if (remap[a] == remap[b] || remap[b] == remap[c] || remap[a] == remap[c]) {
+				continue;
+			}
+			destination[writeIndex++] = a;
+			destination[writeIndex++] = b;
+			destination[writeIndex++] = c;
+		}
+		resultCount = writeIndex;
+	}
+
+	if (resultError) {
+		*resultError = std::sqrt(maxError);
+	}
+	return resultCount;
+}
+
+size_t MeshSimplifier::CountNonManifoldEdges(const uint32_t* indices, size_t indexCount, const float* positions, size_t vertexCount, size_t positionStride)
+{
+	const std::vector<uint32_t> remap = BuildPositionRemap(positions, vertexCount, positionStride);
+	std::vector<uint64_t> edges;
+	edges.reserve(indexCount);
+	for (size_t i = 0; i < indexCount; ++i)
+	{
+		const uint32_t a = remap[indices[i]];
+		const uint32_t b = remap[indices[i % 3 == 2 ? i - 2 : i + 1]];
+		edges.push_back(EdgeKey(std::min(a, b), std::max(a, b)));
+	}
+	std::sort(edges.begin(), edges.end());
+
+	size_t nonManifoldEdges = 0;
+	for (size_t i = 0; i < edges.size();)
+	{
+		size_t j = i;
+		while (j < edges.size() && edges[j] == edges[i])
+		{
+			j++;
+		}
+		nonManifoldEdges += j - i > 2 ? 1 : 0;
+		i = j;
+	}
+	return nonManifoldEdges;
+}
+
+void MeshSimplifier::AddPlane(Quadric& quadric, const float normal[3], float distance, float weight)
+{
+	quadric.a00 += weight * normal[0] * normal[0];
+	quadric.a11 += weight * normal[1] * normal[1];
+	quadric.a22 += weight * normal[2] * normal[2];
+	quadric.a01 += weight * normal[0] * normal[1];
+	quadric.a02 += weight * normal[0] * normal[2];
+	quadric.a12 += weight * normal[1] * normal[2];
+	quadric.b0 += weight * normal[0] * distance;
+	quadric.b1 += weight * normal[1] * distance;
+	quadric.b2 += weight * normal[2] * distance;
+	quadric.c += weight * distance * distance;
+	quadric.weight += weight;
+}
+
+void MeshSimplifier::AddQuadric(Quadric& destination, const Quadric& source)
+{
+	destination.a00 += source.a00;
+	destination.a11 += source.a11;
+	destination.a22 += source.a22;
+	destination.a01 += source.a01;
+	destination.a02 += source.a02;
+	destination.a12 += source.a12;
+	destination.b0 += source.b0;
+	destination.b1 += source.b1;
+	destination.b2 += source.b2;
+	destination.c += source.c;
+	destination.weight += source.weight;
+}
+
+float MeshSimplifier::EvaluateQuadric(const Quadric& quadric, const float position[3])
+{
+	// Weighted mean of squared distances to accumulated planes
+	const double x = position[0];
+	const double y = position[1];
+	const double z = position[2];
+	const double error = quadric.a00 * x * x + quadric.a11 * y * y + quadric.a22 * z * z +
+		2.0 * (quadric.a01 * x * y + quadric.a02 * x * z + quadric.a12 * y * z) +
+		2.0 * (quadric.b0 * x + quadric.b1 * y + quadric.b2 * z) + quadric.c;
+	return quadric.weight > 0.0 ? static_cast<float>(std::max(error, 0.0) / quadric.weight) : 0.0f;
+}
+
+std::vector<uint32_t> MeshSimplifier::BuildPositionRemap(const float* positions, size_t vertexCount, size_t positionStride)
+{
+	// Open addressing over bit patterns of positions
+	size_t capacity = 1;
+	while (capacity < vertexCount * 2)
+	{
+		capacity *= 2;
+	}
+	std::vector<uint32_t> table(capacity, INVALID_INDEX);
+	std::vector<uint32_t> remap(vertexCount);
+
+	auto load = [positions, positionStride](uint32_t vertex, uint32_t bits[3])
+	{
+		memcpy(bits, reinterpret_cast<const uint8_t*>(positions) + vertex * positionStride, sizeof(uint32_t) * 3);
+	};
+
+	for (uint32_t v = 0; v < vertexCount; ++v)
+	{
+		uint32_t bits[3];
+		load(v, bits);
+		uint32_t hash = (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+		hash ^= hash >> 16;
+		size_t slot = hash & (capacity - 1);
+
+		remap[v] = v;
+		while (table[slot] != INVALID_INDEX)
+		{
+			uint32_t other[3];
+			load(table[slot], other);
+			if (memcmp(bits, other, sizeof(bits)) == 0)
+			{
+				remap[v] = table[slot];
+				break;
+			}
+			slot = (slot + 1) & (capacity - 1);
+		}
+		if (remap[v] == v) {
+			table[slot] = v;
+		}
+	}
+	return remap;
+}
@@ -0,0 +1,47 @@
+#pragma once
+#ifndef _MESH_SIMPLIFIER_H_
+#define _MESH_SIMPLIFIER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Quadric error metric simplification of indexed triangle lists (Garland, Heckbert 1997).
+// Vertices are only collapsed onto other existing vertices, so simplified index buffer references the original vertex buffer
+// and every vertex keeps its own UV, normal and texture IDs. Vertices sharing position (attribute seams) are collapsed together
+// only along the seam, open borders only along the border, and vertices where more than two attribute regions meet are locked.
+// Doesn't depend on Windows or D3D12 headers, like MeshOptimizer.
+class MeshSimplifier
+{
+public:
+	// Writes simplified triangle list to destination (at least indexCount entries), returns its index count.
+	// Simplification stops at targetIndexCount or when next collapse would exceed targetError - both errors are relative to mesh extent.
+	static size_t Simplify(uint32_t* destination, const uint32_t* indices, size_t indexCount, const float* positions, size_t vertexCount, size_t positionStride,
+		size_t targetIndexCount, float targetError, float* resultError = nullptr);
+
+	// Number of edges shared by more than two triangles, by position - simplification must not increase it
+	static size_t CountNonManifoldEdges(const uint32_t* indices, size_t indexCount, const float* positions, size_t vertexCount, size_t positionStride);
+
+private:
+	enum class VertexKind : uint8_t
+	{
+		Manifold,	// Interior vertex, can be collapsed onto any neighbor
+		Border,		// Single open edge loop passes through, collapsed only along it
+		Seam,		// Two wedges with the same position, collapsed together along the seam
+		Locked
+	};
+
+	struct Quadric {
+		double a00, a11, a22, a01, a02, a12;
+		double b0, b1, b2;
+		double c;
+		double weight;
+	};
+
+	static void AddPlane(Quadric& quadric, const float normal[3], float distance, float weight);
+	static void AddQuadric(Quadric& destination, const Quadric& source);
+	static float EvaluateQuadric(const Quadric& quadric, const float position[3]);
+	static std::vector<uint32_t> BuildPositionRemap(const float* positions, size_t vertexCount, size_t positionStride);
+};
+
+#endif // !_MESH_SIMPLIFIER_H_
@@ -0,0 +1,175 @@
+#include "MeshletBuilder.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	struct Float3 {
+		float x, y, z;
+	};
+
+	Float3 LoadPosition(const float* positions, size_t positionStride, uint32_t vertex)
+	{
+		const float* position = reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(positions) + vertex * positionStride);
+		return { position[0], position[1], position[2] };
+	}
+
+	Float3 Subtract(const Float3& a, const Float3& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+	Float3 Cross(const Float3& a, const Float3& b) { return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; }
+	float Dot(const Float3& a, const Float3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+	float Length(const Float3& a) { return std::sqrt(Dot(a, a)); }
+}
+
+MeshletData MeshletBuilder::Build(const uint32_t* indices, size_t indexCount, const float* positions, size_t vertexCount, size_t positionStride, size_t maxVertices, size_t maxTriangles)
+{
+	assert(indexCount % 3 == 0 && "Only triangle lists are supported");
+	assert(maxVertices >= 3 && maxVertices <= 256 && "Meshlet local indices are stored in 8 bits");
+	assert(maxTriangles >= 1);
+
+	MeshletData data;
+	const size_t triangleCount = indexCount / 3;
+	data.meshlets.reserve(triangleCount / maxTriangles + 1);
+	data.triangles.reserve(indexCount);
+
+	// Meshlet local index of every vertex, reset only for vertices of finished meshlet
+	constexpr uint8_t UNUSED = 0xFF;
+	std::vector<uint8_t> localIndices(vertexCount, UNUSED);
+	Meshlet meshlet = {};
+
+	auto finishMeshlet = [&]()
+	{
+		if (meshlet.triangleCount == 0) {
+			return;
+		}
+		for (uint32_t i = 0; i < meshlet.vertexCount; ++i)
+		{
+			localIndices[data.vertices[meshlet.vertexOffset + i]] = UNUSED;
+		}
+		AppendMeshlet(data, meshlet, positions, positionStride);
+		meshlet = { static_cast<uint32_t>(data.vertices.size()), 0, static_cast<uint32_t>(data.triangles.size() / 3), 0 };
+	};
+
+	for (size_t triangle = 0; triangle < triangleCount; ++triangle)
+	{
+		const uint32_t* corners = &indices[triangle * 3];
+		assert(corners[0] < vertexCount && corners[1] < vertexCount && corners[2] < vertexCount && "Index out of mesh range");
+
+		// Degenerate triangles may reference the same vertex twice
+		const size_t newVertices = (localIndices[corners[0]] == UNUSED) +
+			(localIndices[corners[1]] == UNUSED && corners[1] != corners[0]) +
+			(localIndices[corners[2]] == UNUSED && corners[2] != corners[0] && corners[2] != corners[1]);
+		if (meshlet.vertexCount + newVertices > maxVertices || meshlet.triangleCount + 1 > maxTriangles) {
+			finishMeshlet();
+		}
+
+		for (uint32_t corner = 0; corner < 3; ++corner)
+		{
+			uint8_t& localIndex = localIndices[corners[corner]];
+			if (localIndex == UNUSED)
+			{
+				localIndex = static_cast<uint8_t>(meshlet.vertexCount++);
+				data.vertices.push_back(corners[corner]);
+			}
+			data.triangles.push_back(localIndex);
+		}
+		meshlet.triangleCount++;
+	}
+	finishMeshlet();
+
+	return data;
+}
+
+MeshletBounds MeshletBuilder::ComputeBounds(const MeshletData& data, const Meshlet& meshlet, const float* positions, size_t positionStride)
+{
+	assert(meshlet.vertexCount > 0 && meshlet.triangleCount > 0);
+	MeshletBounds bounds;
+
+	// Box, and sphere around its center
+	Float3 minimum = LoadPosition(positions, positionStride, data.vertices[meshlet.vertexOffset]);
+	Float3 maximum = minimum;
+	for (uint32_t i = 1; i < meshlet.vertexCount; ++i)
+	{
+		const Float3 position = LoadPosition(positions, positionStride, data.vertices[meshlet.vertexOffset + i]);
+		minimum = { std::min(minimum.x, position.x), std::min(minimum.y, position.y), std::min(minimum.z, position.z) };
+		maximum = { std::max(maximum.x, position.x), std::max(maximum.y, position.y), std::max(maximum.z, position.z) };
+	}
+	const Float3 center = { (minimum.x + maximum.x) * 0.5f, (minimum.y + maximum.y) * 0.5f, (minimum.z + maximum.z) * 0.5f };
+	float radius = 0.0f;
+	for (uint32_t i = 0; i < meshlet.vertexCount; ++i)
+	{
+		radius = std::max(radius, Length(Subtract(LoadPosition(positions, positionStride, data.vertices[meshlet.vertexOffset + i]), center)));
+	}
+
+	memcpy(bounds.aabbMin, &minimum, sizeof(bounds.aabbMin));
+	memcpy(bounds.aabbMax, &maximum, sizeof(bounds.aabbMax));
+	memcpy(bounds.center, &center, sizeof(bounds.center));
+	bounds.radius = radius;
+
+	// Normal cone - axis is average of triangle normals, half angle covers the widest one
+	std::vector<Float3> normals;
+	normals.reserve(meshlet.triangleCount);
+	Float3 axis = { 0.0f, 0.0f, 0.0f };
+	for (uint32_t triangle = 0; triangle < meshlet.triangleCount; ++triangle)
+	{
+		const uint8_t* corners = &data.triangles[(meshlet.triangleOffset + triangle) * 3];
+		const Float3 p0 = LoadPosition(positions, positionStride, data.vertices[meshlet.vertexOffset + corners[0]]);
+		const Float3 p1 = LoadPosition(positions, positionStride, data.vertices[meshlet.vertexOffset + corners[1]]);
+		const Float3 p2 = LoadPosition(positions, positionStride, data.vertices[meshlet.vertexOffset + corners[2]]);
+		const Float3 normal = Cross(Subtract(p1, p0), Subtract(p2, p0));
+		const float length = Length(normal);
+		if (length > 0.0f)
+		{
+			normals.push_back({ normal.x / length, normal.y / length, normal.z / length });
+			axis = { axis.x + normals.back().x, axis.y + normals.back().y, axis.z + normals.back().z };
+		}
+	}
+
+	const float axisLength = Length(axis);
+	float minimumDot = 1.0f;
+	if (axisLength > 0.0f)
+	{
+		axis = { axis.x / axisLength, axis.y / axisLength, axis.z / axisLength };
+		for (const Float3& normal : normals)
+		{
+			minimumDot = std::min(minimumDot, Dot(axis, normal));
+		}
+	}
+
+	memcpy(bounds.coneAxis, &axis, sizeof(bounds.coneAxis));
+	memcpy(bounds.coneApex, &center, sizeof(bounds.coneApex));
+	// Cone wider than hemisphere (or close to it) can't be rejected from any point of view
+	if (axisLength <= 0.0f || minimumDot <= 0.1f)
+	{
+		bounds.coneCutoff = NO_CONE_CUTOFF;
+		return bounds;
+	}
+
+	// Move apex back along axis, until every triangle plane is in front of it
+	float maxDistance = 0.0f;
+	size_t normalIndex = 0;
+	for (uint32_t triangle = 0; triangle < meshlet.triangleCount; ++triangle)
+	{
+		const uint8_t* corners = &data.triangles[(meshlet.triangleOffset + triangle) * 3];
+		const Float3 p0 = LoadPosition(positions, positionStride, data.vertices[meshlet.vertexOffset + corners[0]]);
+		const Float3 p1 = LoadPosition(positions, positionStride, data.vertices[meshlet.vertexOffset + corners[1]]);
+		const Float3 p2 = LoadPosition(positions, positionStride, data.vertices[meshlet.vertexOffset + corners[2]]);
+		if (Length(Cross(Subtract(p1, p0), Subtract(p2, p0))) <= 0.0f) {
+			continue;
+		}
+		const Float3& normal = normals[normalIndex++];
+		maxDistance = std::max(maxDistance, Dot(Subtract(center, p0), normal) / Dot(axis, normal));
+	}
+
+	const Float3 apex = { center.x - axis.x * maxDistance, center.y - axis.y * maxDistance, center.z - axis.z * maxDistance };
+	memcpy(bounds.coneApex, &apex, sizeof(bounds.coneApex));
+	bounds.coneCutoff = std::sqrt(1.0f - minimumDot * minimumDot);
+	return bounds;
+}
+
+void MeshletBuilder::AppendMeshlet(MeshletData& data, const Meshlet& meshlet, const float* positions, size_t positionStride)
+{
+	data.meshlets.push_back(meshlet);
+	data.bounds.push_back(ComputeBounds(data, meshlet, positions, positionStride));
+}
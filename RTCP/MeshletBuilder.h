@@ -0,0 +1,52 @@
+#pragma once
+#ifndef _MESHLET_BUILDER_H_
+#define _MESHLET_BUILDER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Small cluster of mesh triangles - vertices and triangles index MeshletData arrays
+struct Meshlet {
+	uint32_t vertexOffset;		// First entry in MeshletData::vertices
+	uint32_t vertexCount;
+	uint32_t triangleOffset;	// First triangle in MeshletData::triangles (3 entries per triangle)
+	uint32_t triangleCount;
+};
+
+// Bounds of meshlet in model space, used by MeshletCulling
+struct MeshletBounds {
+	float aabbMin[3];
+	float aabbMax[3];
+	float center[3];			// Bounding sphere
+	float radius;
+	float coneApex[3];			// Normal cone - every triangle faces away from camera if dot(normalize(coneApex - camera), coneAxis) >= coneCutoff
+	float coneAxis[3];
+	float coneCutoff;			// Sine of cone half angle, NO_CONE_CUTOFF if triangles face too many directions
+};
+
+struct MeshletData {
+	std::vector<Meshlet> meshlets;
+	std::vector<MeshletBounds> bounds;
+	std::vector<uint32_t> vertices;		// Mesh local vertex indices
+	std::vector<uint8_t> triangles;		// Meshlet local vertex indices, 3 per triangle
+};
+
+// Splits indexed triangle list into meshlets. Doesn't depend on Windows or D3D12 headers, like MeshOptimizer.
+class MeshletBuilder
+{
+public:
+	static constexpr size_t DEFAULT_MAX_VERTICES = 64;
+	static constexpr size_t DEFAULT_MAX_TRIANGLES = 124;
+	static constexpr float NO_CONE_CUTOFF = 2.0f;
+
+	// Triangles are taken in index buffer order - optimizing mesh for vertex cache first gives tighter meshlets.
+	// positions point to first vertex position (3 floats), positionStride is distance between vertices in bytes.
+	static MeshletData Build(const uint32_t* indices, size_t indexCount, const float* positions, size_t vertexCount, size_t positionStride, size_t maxVertices = DEFAULT_MAX_VERTICES, size_t maxTriangles = DEFAULT_MAX_TRIANGLES);
+	static MeshletBounds ComputeBounds(const MeshletData& data, const Meshlet& meshlet, const float* positions, size_t positionStride);
+
+private:
+	static void AppendMeshlet(MeshletData& data, const Meshlet& meshlet, const float* positions, size_t positionStride);
+};
+
+#endif // !_MESHLET_BUILDER_H_
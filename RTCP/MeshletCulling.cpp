@@ -0,0 +1,82 @@
+#include "MeshletCulling.h"
+#include <cmath>
+
+MeshletCulling::Frustum MeshletCulling::ExtractFrustum(const float viewProjection[16])
+{
+	// Gribb-Hartmann - clip = v * M, so planes are built from matrix columns
+	auto column = [viewProjection](int index, int row) { return viewProjection[row * 4 + index]; };
+
+	Frustum frustum;
+	for (int row = 0; row < 4; ++row)
+	{
+		frustum.planes[0][row] = column(3, row) + column(0, row);	// Left
+		frustum.planes[1][row] = column(3, row) - column(0, row);	// Right
+		frustum.planes[2][row] = column(3, row) + column(1, row);	// Bottom
+		frustum.planes[3][row] = column(3, row) - column(1, row);	// Top
+		frustum.planes[4][row] = column(2, row);					// Near
+		frustum.planes[5][row] = column(3, row) - column(2, row);	// Far
+	}
+
+	for (float* plane : frustum.planes)
+	{
+		const float length = std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+		if (length > 0.0f)
+		{
+			for (int i = 0; i < 4; ++i)
+			{
+				plane[i] /= length;
+			}
+		}
+	}
+	return frustum;
+}
+
+bool MeshletCulling::IsInsideFrustum(const MeshletBounds& bounds, const Frustum& frustum)
+{
+	for (const float* plane : frustum.planes)
+	{
+		if (plane[0] * bounds.center[0] + plane[1] * bounds.center[1] + plane[2] * bounds.center[2] + plane[3] < -bounds.radius) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool MeshletCulling::IsBackFacing(const MeshletBounds& bounds, const float cameraPosition[3])
+{
+	if (bounds.coneCutoff >= MeshletBuilder::NO_CONE_CUTOFF) {
+		return false;
+	}
+
+	const float direction[3] = { bounds.coneApex[0] - cameraPosition[0], bounds.coneApex[1] - cameraPosition[1], bounds.coneApex[2] - cameraPosition[2] };
+	const float distance = std::sqrt(direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2]);
+	const float dot = direction[0] * bounds.coneAxis[0] + direction[1] * bounds.coneAxis[1] + direction[2] * bounds.coneAxis[2];
+	return dot >= bounds.coneCutoff * distance;
+}
+
+size_t MeshletCulling::Cull(const MeshletBounds* bounds, size_t count, const Frustum& frustum, const float cameraPosition[3], uint32_t* visibleMeshlets, Statistics* statistics)
+{
+	size_t visibleCount = 0;
+	size_t frustumCulled = 0;
+	size_t backfaceCulled = 0;
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (!IsInsideFrustum(bounds[i], frustum)) {
+			frustumCulled++;
+		}
+		else if (IsBackFacing(bounds[i], cameraPosition)) {
+			backfaceCulled++;
+		}
+		else {
+			visibleMeshlets[visibleCount++] = static_cast<uint32_t>(i);
+		}
+	}
+
+	if (statistics)
+	{
+		statistics->tested += count;
+		statistics->frustumCulled += frustumCulled;
+		statistics->backfaceCulled += backfaceCulled;
+	}
+	return visibleCount;
+}
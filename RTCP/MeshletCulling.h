@@ -0,0 +1,32 @@
+#pragma once
+#ifndef _MESHLET_CULLING_H_
+#define _MESHLET_CULLING_H_
+
+#include "MeshletBuilder.h"
+
+// CPU side culling of meshlets against view frustum and by normal cone. Bounds and camera are in the same (model) space.
+class MeshletCulling
+{
+public:
+	// Planes as (normal, distance) - point is inside if dot(normal, point) + distance >= 0 for every plane
+	struct Frustum {
+		float planes[6][4];
+	};
+
+	struct Statistics {
+		size_t tested = 0;
+		size_t frustumCulled = 0;
+		size_t backfaceCulled = 0;
+	};
+
+	// viewProjection is row major matrix transforming row vectors (DirectXMath convention, XMFLOAT4X4 layout), with D3D clip space depth [0, w]
+	static Frustum ExtractFrustum(const float viewProjection[16]);
+
+	static bool IsInsideFrustum(const MeshletBounds& bounds, const Frustum& frustum);
+	static bool IsBackFacing(const MeshletBounds& bounds, const float cameraPosition[3]);
+
+	// Writes indices of visible meshlets, returns their count
+	static size_t Cull(const MeshletBounds* bounds, size_t count, const Frustum& frustum, const float cameraPosition[3], uint32_t* visibleMeshlets, Statistics* statistics = nullptr);
+};
+
+#endif // !_MESHLET_CULLING_H_
@@ -1,12 +1,23 @@
 #include "ModelClass.h"
+#include "MeshCache.h"
+#include "GeometryCodec.h"
+#include "ThreadPool.h"
+#include "VertexPacking.h"
+#include "MeshletCulling.h"
+#include "TangentGenerator.h"
+#include "TextureCompressor.h"
+#include "TraversalSimulator.h"
 #include <WICTextureLoader.h>
 #include <DDSTextureLoader.h>
 #include <DirectXHelpers.h>
 #include <DirectXTex.h>
 #include <SimpleMath.h>
 #include <regex>
+#include <random>
+#include <numeric>
 
-ModelClass::ModelClass(std::string path, ComPtr<ID3D12Device2> device, ComPtr<ID3D12GraphicsCommandList4> commandList)
+ModelClass::ModelClass(std::string path, ComPtr<ID3D12Device2> device, ComPtr<ID3D12GraphicsCommandList4> commandList, ModelLoadSettings settings)
+	: m_loadSettings(settings)
 {
 #if (_WIN32_WINNT >= 0x0A00 /*_WIN32_WINNT_WIN10*/)
 	Microsoft::WRL::Wrappers::RoInitializeWrapper initialize(RO_INIT_MULTITHREADED);
@@ -25,7 +36,8 @@ ModelClass::ModelClass(std::string path, ComPtr<ID3D12Device2> device, ComPtr<ID
 	LoadModel(path, device, commandList);
 }
 
-ModelClass::ModelClass(std::string path, ComPtr<ID3D12Device2> device, ComPtr<ID3D12GraphicsCommandList4> commandList, ComPtr<ID3D12Resource>& uploadHeap)
+ModelClass::ModelClass(std::string path, ComPtr<ID3D12Device2> device, ComPtr<ID3D12GraphicsCommandList4> commandList, ComPtr<ID3D12Resource>& uploadHeap, ModelLoadSettings settings)
+	: m_loadSettings(settings)
 {
 #if (_WIN32_WINNT >= 0x0A00 /*_WIN32_WINNT_WIN10*/)
 	Microsoft::WRL::Wrappers::RoInitializeWrapper initialize(RO_INIT_MULTITHREADED);
@@ -44,123 +56,395 @@ ModelClass::ModelClass(std::string path, ComPtr<ID3D12Device2> device, ComPtr<ID
 	LoadModel(path, device, commandList, uploadHeap);
 }
 
+ModelClass::ModelClass(const SceneGenerator::Settings& sceneSettings, ComPtr<ID3D12Device2> device, ModelLoadSettings settings)
+	: m_loadSettings(settings)
+{
+	GenerateScene(sceneSettings, device);
+}
+
+ModelClass::~ModelClass() = default;
+
 void ModelClass::LoadModel(std::string path, ComPtr<ID3D12Device2> device, ComPtr<ID3D12GraphicsCommandList4> commandList, DXGI_FORMAT indexFormat)
 {
-	ProcessScene(path, device, commandList);
-	assert(PrepareBuffers(device, indexFormat) && "Failed to prepare buffers");
+	LoadModelFromFile(path, IMPORT_FLAGS_LEFT_HANDED, device, commandList, indexFormat);
 }
 
 void ModelClass::LoadModel(std::string path, ComPtr<ID3D12Device2> device, ComPtr<ID3D12GraphicsCommandList4> commandList, ComPtr<ID3D12Resource>& uploadHeap, DXGI_FORMAT indexFormat)
 {
-	Assimp::Importer importer;
-	char result[MAX_PATH];
-	const std::string filename = path;
-	path = std::string(result, GetModuleFileNameA(NULL, result, MAX_PATH));
-	const auto index = path.find_last_of('\\');
-	path = path.substr(0, index + 1) + filename;
+	LoadModelFromFile(path, IMPORT_FLAGS_RIGHT_HANDED, device, commandList, indexFormat);
+}
 
-	const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | /*aiProcess_ConvertToLeftHanded | */ aiProcess_OptimizeMeshes | aiProcess_CalcTangentSpace | aiProcess_FlipUVs);
+void ModelClass::ProcessScene(std::string path, ComPtr<ID3D12Device2> device, ComPtr<ID3D12GraphicsCommandList4> commandList)
+{
+	ImportScene(GetFullPath(path), IMPORT_FLAGS_LEFT_HANDED, device, commandList);
+}
 
-	assert(scene);
-#pragma warning(push)
-#pragma warning(disable : 6011)
-	//ProcessNode(scene->mRootNode, scene);
-	for (unsigned int i = 0; i < scene->mNumMeshes; ++i)
+void ModelClass::LoadModelFromFile(const std::string& path, unsigned int importFlags, ComPtr<ID3D12Device2> device, ComPtr<ID3D12GraphicsCommandList4> commandList, DXGI_FORMAT indexFormat)
+{
+	m_loadStartTime = std::chrono::high_resolution_clock::now();
+	const auto startTime = m_loadStartTime;
+	const std::string fullPath = GetFullPath(path);
+	m_positions.clear();
+	m_cpuResidency = CpuResidency::Full;
+	assert((!m_loadSettings.progressiveLoading || indexFormat == DXGI_FORMAT_R32_UINT) && "Progressive loading publishes meshes into R32_UINT index buffer");
+	if (m_loadSettings.streamTextures) {
+		m_textureStreamer = std::make_unique<TextureStreamer>(m_loadSettings.textureStreamingThreadCount);
+	}
+
+	// Warm start - geometry is mapped from cache, only textures have to be loaded
+	if (m_loadSettings.useMeshCache && LoadModelFromCache(fullPath, importFlags, device, commandList, indexFormat))
 	{
-		m_meshes.push_back(ProcessMesh(scene->mMeshes[i], scene, i, device, commandList));
+		// Progressively loaded model keeps streaming textures while its meshes are published
+		if (m_loadComplete) {
+			FinishTextureStreaming(device, commandList);
+		}
+		const std::chrono::duration<double, std::milli> loadTime = std::chrono::high_resolution_clock::now() - startTime;
+		LogDebugRTCP("ModelClass: %s loaded from mesh cache in %.2f ms, geometry %.1f MB, peak working set %.1f MB\n", path.c_str(), loadTime.count(),
+			(GetVertices().size_bytes() + GetIndices().size_bytes()) / (1024.0 * 1024.0), GetPeakWorkingSetRTCP() / (1024.0 * 1024.0));
+		if (m_loadComplete)
+		{
+			LogTextureStatistics();
+			ApplyCpuResidency();
+		}
+		return;
+	}
+
+	// Cold start - import by assimp
+	ImportScene(fullPath, importFlags, device, commandList);
+	BuildMeshlets();
+
+	const bool buffersPrepared = PrepareBuffers(device, indexFormat);
+	assert(buffersPrepared && "Failed to prepare buffers");
+
+	// Cache is written while remaining textures are still decoded
+	if (m_loadSettings.useMeshCache && !MeshCache::Write(fullPath, importFlags, GetProcessingKey(), m_vertices, m_indices, m_meshRanges, m_meshTexturePaths, m_materials, m_meshLodOffsets, m_lodRanges, m_lodIndices, m_sceneNodes, m_nodeMeshes, m_loadSettings.compressMeshCache)) {
+		LogDebugRTCP("ModelClass: failed to write mesh cache %s\n", MeshCache::GetCachePath(fullPath).c_str());
+	}
+	if (m_loadComplete) {
+		FinishTextureStreaming(device, commandList);
 	}
-#pragma warning(pop)
 
-	assert(PrepareBuffers(device, indexFormat) && "Failed to prepare buffers");
+	const std::chrono::duration<double, std::milli> loadTime = std::chrono::high_resolution_clock::now() - startTime;
+	LogDebugRTCP("ModelClass: %s imported by assimp in %.2f ms, geometry %.1f MB, peak working set %.1f MB\n", path.c_str(), loadTime.count(),
+		(GetVertices().size_bytes() + GetIndices().size_bytes()) / (1024.0 * 1024.0), GetPeakWorkingSetRTCP() / (1024.0 * 1024.0));
+	if (m_loadComplete)
+	{
+		LogTextureStatistics();
+		ApplyCpuResidency();
+	}
 }
 
-void ModelClass::ProcessScene(std::string path, ComPtr<ID3D12Device2> device, ComPtr<ID3D12GraphicsCommandList4> commandList)
+bool ModelClass::LoadModelFromCache(const std::string& fullPath, unsigned int importFlags, ComPtr<ID3D12Device2> device, ComPtr<ID3D12GraphicsCommandList4> commandList, DXGI_FORMAT indexFormat)
 {
-	Assimp::Importer importer;
-	char result[MAX_PATH];
-	const std::string filename = path;
-	path = std::string(result, GetModuleFileNameA(NULL, result, MAX_PATH));
-	const auto index = path.find_last_of('\\');
-	path = path.substr(0, index + 1) + filename;
+	// Cache stays mapped for lifetime of the model, vertex and index views point directly into it
+	std::unique_ptr<MeshCache> cache = std::make_unique<MeshCache>();
+	if (!cache->Open(fullPath, importFlags, GetProcessingKey())) {
+		return false;
+	}
 
-	const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_ConvertToLeftHanded |  aiProcess_OptimizeMeshes | aiProcess_CalcTangentSpace | aiProcess_FlipUVs);
+	const UINT32 meshCount = cache->GetMeshCount();
+	m_meshCache = std::move(cache);
+	m_vertices.clear();
+	m_indices.clear();
+	m_meshRanges.assign(m_meshCache->GetMeshRanges(), m_meshCache->GetMeshRanges() + meshCount);
+	m_meshLodOffsets.assign(m_meshCache->GetMeshLodOffsets(), m_meshCache->GetMeshLodOffsets() + meshCount + 1);
+	m_lodRanges.assign(m_meshCache->GetLodRanges(), m_meshCache->GetLodRanges() + m_meshCache->GetLodCount());
+	m_lodIndices.clear();
+	m_sceneNodes.assign(m_meshCache->GetSceneNodes(), m_meshCache->GetSceneNodes() + m_meshCache->GetNodeCount());
+	m_nodeMeshes.assign(m_meshCache->GetNodeMeshes(), m_meshCache->GetNodeMeshes() + m_meshCache->GetNodeMeshCount());
+	m_meshTexturePaths.resize(meshCount);
+	m_materials.assign(m_meshCache->GetMaterials(), m_meshCache->GetMaterials() + meshCount);
+	for (UINT32 i = 0; i < meshCount; ++i)
+	{
+		// Textures are registered in the same order as during import, so texture IDs stored in materials stay valid
+		m_meshTexturePaths[i] = m_meshCache->GetTexturePaths(i);
+	}
+	if (m_loadSettings.compressTextures)
+	{
+		std::vector<TextureCompressor::Job> jobs;
+		for (const MeshTexturePaths& paths : m_meshTexturePaths)
+		{
+			jobs.push_back({ paths.albedo, TextureCompressor::TextureSlot::Albedo });
+			jobs.push_back({ paths.specular, TextureCompressor::TextureSlot::Specular });
+			jobs.push_back({ paths.normal, TextureCompressor::TextureSlot::Normal });
+		}
+		CompressTextures(jobs);
+	}
+	for (UINT32 i = 0; i < meshCount; ++i)
+	{
+		LoadCachedTextures(m_meshTexturePaths[i], device, commandList, static_cast<int>(i));
+	}
+	BuildMeshlets();
+	LogSceneGraphStatistics();
+	if (m_loadSettings.benchmarkImport) {
+		BenchmarkGeometryCodec();
+	}
+
+	const bool buffersPrepared = PrepareBuffers(device, indexFormat);
+	assert(buffersPrepared && "Failed to prepare buffers");
+	return buffersPrepared;
+}
+
+void ModelClass::ImportScene(const std::string& fullPath, unsigned int importFlags, ComPtr<ID3D12Device2> device, ComPtr<ID3D12GraphicsCommandList4> commandList)
+{
+	Assimp::Importer importer;
+	const aiScene* scene = importer.ReadFile(fullPath, importFlags);
 
 	assert(scene);
+	assert(m_meshRanges.empty() && "Scene has to be imported into empty model");
 #pragma warning(push)
 #pragma warning(disable : 6011)
-	//ProcessNode(scene->mRootNode, scene);
-	for (unsigned int i = 0; i < scene->mNumMeshes; ++i)
+	// Reserve range of every mesh up front, so whole model is stored in one vertex and one index array
+	const unsigned int meshCount = scene->mNumMeshes;
+	m_meshRanges.resize(meshCount);
+	UINT32 vertexOffset = 0;
+	UINT32 indexOffset = 0;
+	for (unsigned int i = 0; i < meshCount; ++i)
+	{
+		m_meshRanges[i] = { vertexOffset, scene->mMeshes[i]->mNumVertices, indexOffset, GetMeshIndexCount(scene->mMeshes[i]) };
+		vertexOffset += m_meshRanges[i].vertexCount;
+		indexOffset += m_meshRanges[i].indexCount;
+	}
+	m_meshCache.reset();
+	m_vertices.resize(vertexOffset);
+	m_indices.resize(indexOffset);
+
+	// Every mesh writes only to its own slots, so meshes can be processed in any order with the same result as serial import
+	m_meshTexturePaths.resize(meshCount);
+	m_materials.resize(meshCount);
+	m_diffuseTexturesResources.resize(meshCount);
+	m_specularTexturesResources.resize(meshCount);
+	m_normalTexturesResources.resize(meshCount);
+	const TextureOwners textureOwners = FindTextureOwners(scene);
+	if (m_loadSettings.compressTextures)
+	{
+		std::vector<TextureCompressor::Job> jobs;
+		for (const auto& owner : textureOwners.albedo)
+		{
+			jobs.push_back({ owner.first, TextureCompressor::TextureSlot::Albedo });
+		}
+		for (const auto& owner : textureOwners.specular)
+		{
+			jobs.push_back({ owner.first, TextureCompressor::TextureSlot::Specular });
+		}
+		for (const auto& owner : textureOwners.normal)
+		{
+			jobs.push_back({ owner.first, TextureCompressor::TextureSlot::Normal });
+		}
+		CompressTextures(jobs);
+	}
+
+	const auto startTime = std::chrono::high_resolution_clock::now();
+	const unsigned int threadCount = m_loadSettings.importThreadCount > 0 ? m_loadSettings.importThreadCount : ThreadPool::GetDefaultThreadCount();
+	std::unique_ptr<ThreadPool> threadPool = threadCount > 1 ? std::make_unique<ThreadPool>(threadCount) : nullptr;
+	auto forEachMesh = [&threadPool, meshCount](const std::function<void(size_t)>& function)
+	{
+		if (threadPool) {
+			threadPool->ParallelFor(meshCount, function);
+			return;
+		}
+		for (size_t i = 0; i < meshCount; ++i)
+		{
+			function(i);
+		}
+	};
+
+	forEachMesh([&](size_t i) {
+		ProcessMesh(scene->mMeshes[i], scene, static_cast<unsigned int>(i), textureOwners, device, commandList);
+	});
+	const std::chrono::duration<double, std::milli> processTime = std::chrono::high_resolution_clock::now() - startTime;
+	LogDebugRTCP("ModelClass: processed %u meshes on %u threads in %.2f ms\n", meshCount, threadCount, processTime.count());
+
+	// Node hierarchy only references processed meshes, repeated meshes stay stored once
+	m_sceneNodes.clear();
+	m_nodeMeshes.clear();
+	if (scene->mRootNode) {
+		ProcessNode(scene->mRootNode, -1);
+	}
+
+	if (m_loadSettings.weldVertices)
 	{
-		m_meshes.push_back(ProcessMesh(scene->mMeshes[i], scene, i, device, commandList));
+		const auto weldStartTime = std::chrono::high_resolution_clock::now();
+		const size_t vertexCountBefore = m_vertices.size();
+		std::vector<UINT32> vertexCounts(meshCount);
+		forEachMesh([&](size_t i) {
+			vertexCounts[i] = WeldMesh(m_meshRanges[i]);
+		});
+		CompactMeshes(vertexCounts);
+		const std::chrono::duration<double, std::milli> weldTime = std::chrono::high_resolution_clock::now() - weldStartTime;
+		LogDebugRTCP("ModelClass: welded vertices in %.2f ms - %zu -> %zu vertices (%.1f%%), %.2f MB -> %.2f MB\n", weldTime.count(),
+			vertexCountBefore, m_vertices.size(), vertexCountBefore > 0 ? 100.0 * m_vertices.size() / vertexCountBefore : 100.0,
+			sizeof(VertexBufferStruct) * vertexCountBefore / (1024.0 * 1024.0), sizeof(VertexBufferStruct) * m_vertices.size() / (1024.0 * 1024.0));
+	}
+
+	// Meshes are optimized independently, each one only within its own range
+	if (m_loadSettings.optimizeMeshes)
+	{
+		if (m_loadSettings.benchmarkImport) {
+			BenchmarkTraversal("before optimization");
+		}
+		const auto optimizationStartTime = std::chrono::high_resolution_clock::now();
+		std::vector<MeshOptimizationStatistics> statistics(meshCount);
+		// One large mesh would keep a single thread busy long after the rest finished - such meshes are optimized one by one from this thread,
+		// with radix sort passes spread over the pool. Pool tasks can't wait for other pool tasks, so they are never started from forEachMesh.
+		std::vector<bool> sortInParallel(meshCount, false);
+		if (threadPool && m_loadSettings.spatialTriangleOrder)
+		{
+			const MeshOptimizer::ParallelFor parallelFor = [&threadPool](size_t count, const std::function<void(size_t)>& func) { threadPool->ParallelFor(count, func); };
+			for (size_t i = 0; i < meshCount; ++i)
+			{
+				if (m_meshRanges[i].indexCount / 3 >= PARALLEL_SORT_MIN_TRIANGLES)
+				{
+					sortInParallel[i] = true;
+					statistics[i] = OptimizeMesh(m_meshRanges[i], parallelFor);
+				}
+			}
+		}
+		forEachMesh([&](size_t i) {
+			if (!sortInParallel[i]) {
+				statistics[i] = OptimizeMesh(m_meshRanges[i]);
+			}
+		});
+		const std::chrono::duration<double, std::milli> optimizationTime = std::chrono::high_resolution_clock::now() - optimizationStartTime;
+		LogOptimizationStatistics(statistics, optimizationTime.count());
+		if (m_loadSettings.benchmarkImport) {
+			BenchmarkTraversal(m_loadSettings.spatialTriangleOrder ? "after spatial order" : "after vertex cache order");
+		}
+	}
+
+	// LODs are generated after optimization, so they are simplified from the final vertex order and share the vertex buffer
+	m_lodRanges.clear();
+	m_lodIndices.clear();
+	m_meshLodOffsets.assign(meshCount + 1, 0);
+	if (!m_loadSettings.lodTargetRatios.empty())
+	{
+		const auto lodStartTime = std::chrono::high_resolution_clock::now();
+		std::vector<std::vector<LodRange>> meshLods(meshCount);
+		std::vector<std::vector<UINT32>> meshLodIndices(meshCount);
+		forEachMesh([&](size_t i) {
+			GenerateMeshLods(m_meshRanges[i], meshLods[i], meshLodIndices[i]);
+		});
+
+		// Concatenate serially - LOD index offsets are relative to the mesh until now
+		std::vector<size_t> levelTriangles(m_loadSettings.lodTargetRatios.size() + 1, 0);
+		for (unsigned int i = 0; i < meshCount; ++i)
+		{
+			const UINT32 lodIndexOffset = static_cast<UINT32>(m_lodIndices.size());
+			levelTriangles[0] += m_meshRanges[i].indexCount / 3;
+			for (size_t lod = 0; lod < meshLods[i].size(); ++lod)
+			{
+				LodRange range = meshLods[i][lod];
+				range.indexOffset += lodIndexOffset;
+				m_lodRanges.push_back(range);
+				levelTriangles[lod + 1] += range.indexCount / 3;
+			}
+			m_lodIndices.insert(m_lodIndices.end(), meshLodIndices[i].begin(), meshLodIndices[i].end());
+			m_meshLodOffsets[i + 1] = static_cast<UINT32>(m_lodRanges.size());
+		}
+		const std::chrono::duration<double, std::milli> lodTime = std::chrono::high_resolution_clock::now() - lodStartTime;
+		LogDebugRTCP("ModelClass: generated %zu LODs in %.2f ms, %.2f MB of indices\n", m_lodRanges.size(), lodTime.count(), sizeof(UINT32) * m_lodIndices.size() / (1024.0 * 1024.0));
+		for (size_t lod = 0; lod < levelTriangles.size(); ++lod)
+		{
+			LogDebugRTCP("ModelClass: LOD %zu - %zu triangles (%.1f%%)\n", lod, levelTriangles[lod], levelTriangles[0] > 0 ? 100.0 * levelTriangles[lod] / levelTriangles[0] : 0.0);
+		}
+	}
+
+	LogSceneGraphStatistics();
+
+	if (m_loadSettings.benchmarkImport)
+	{
+		BenchmarkImport(scene);
+		BenchmarkGeometryCodec();
 	}
 #pragma warning(pop)
 }
 
-void ModelClass::ProcessNode(std::vector<Mesh>& meshes, aiNode* node, const aiScene* scene, ComPtr<ID3D12Device2> device, ComPtr<ID3D12GraphicsCommandList4> commandList)
+std::string ModelClass::GetFullPath(const std::string& path)
 {
-	for (unsigned int i = 0; i < node->mNumMeshes; ++i)
-	{
-		aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-		meshes.push_back(ProcessMesh(mesh, scene, i, device, commandList));
-	}
+	char result[MAX_PATH];
+	const std::string executablePath = std::string(result, GetModuleFileNameA(NULL, result, MAX_PATH));
+	const auto index = executablePath.find_last_of('\\');
+	return executablePath.substr(0, index + 1) + path;
+}
 
+void ModelClass::ProcessNode(const aiNode* node, INT32 parentIndex)
+{
+	// Assimp matrices transform column vectors, DirectXMath ones row vectors - stored transposed
+	const aiMatrix4x4& m = node->mTransformation;
+	SceneNode sceneNode;
+	sceneNode.localTransform = XMFLOAT4X4(m.a1, m.b1, m.c1, m.d1, m.a2, m.b2, m.c2, m.d2, m.a3, m.b3, m.c3, m.d3, m.a4, m.b4, m.c4, m.d4);
+	XMMATRIX world = XMLoadFloat4x4(&sceneNode.localTransform);
+	if (parentIndex >= 0) {
+		world = world * XMLoadFloat4x4(&m_sceneNodes[parentIndex].worldTransform);
+	}
+	XMStoreFloat4x4(&sceneNode.worldTransform, world);
+	sceneNode.parent = parentIndex;
+	// Mesh ranges and texture slots are indexed by scene mesh index
+	sceneNode.meshOffset = static_cast<UINT32>(m_nodeMeshes.size());
+	sceneNode.meshCount = node->mNumMeshes;
+	m_nodeMeshes.insert(m_nodeMeshes.end(), node->mMeshes, node->mMeshes + node->mNumMeshes);
+
+	const INT32 nodeIndex = static_cast<INT32>(m_sceneNodes.size());
+	m_sceneNodes.push_back(sceneNode);
 	for (unsigned int i = 0; i < node->mNumChildren; ++i)
 	{
-		ProcessNode(meshes, node->mChildren[i], scene, device, commandList);
+		ProcessNode(node->mChildren[i], nodeIndex);
 	}
 }
 
-ModelClass::Mesh ModelClass::ProcessMesh(aiMesh* mesh, const aiScene* scene, unsigned int textureID, ComPtr<ID3D12Device2> device, ComPtr<ID3D12GraphicsCommandList4> commandList)
+void ModelClass::ProcessMesh(aiMesh* mesh, const aiScene* scene, unsigned int meshIndex, const TextureOwners& textureOwners, ComPtr<ID3D12Device2> device, ComPtr<ID3D12GraphicsCommandList4> commandList)
 {
-	Mesh localMesh;
-	localMesh.vertices.resize(mesh->mNumVertices);
-	bool hasTexAlbedo = false;
-	bool hasTexSpecRoughness = false;
-	bool hasTexNormal = false;
-	unsigned int albedoTexID = -1;
-	unsigned int specRoughnessTexID = -1;
-	unsigned int normalTexID = -1;
+	Material meshMaterial{ INVALID_TEXTURE_ID, INVALID_TEXTURE_ID, INVALID_TEXTURE_ID, 1.0f, XMFLOAT3{ 1.0f, 1.0f, 1.0f }, 0.0f };
+	MeshTexturePaths texturePaths{};
 
 	if (mesh->mMaterialIndex >= 0)
 	{
 		aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
 
-		m_diffuseTexturesResources.push_back({});
-		std::vector<Texture> diffuseMaps = LoadMaterialTextures(m_diffuseTexturesResources[textureID], m_diffuseTextures, material, DetermineTextureType(scene, material), aiTextureType_DIFFUSE, "texture_diffuse", scene, device, commandList, textureID);
+		std::vector<Texture> diffuseMaps = LoadMaterialTextures(m_diffuseTexturesResources[meshIndex], m_diffuseTextures, textureOwners.albedo, material, DetermineTextureType(scene, material), aiTextureType_DIFFUSE, "texture_diffuse", scene, device, commandList, meshIndex);
 		if (diffuseMaps.size() > 0) 
 		{
-			hasTexAlbedo = true;
-			albedoTexID = diffuseMaps[0].textureID;
+			meshMaterial.albedoTextureID = diffuseMaps[0].textureID;
+			texturePaths.albedo = diffuseMaps[0].path;
+		}
+		else
+		{
+			// Untextured mesh is shaded by its diffuse color only
+			aiColor3D diffuseColor{ 1.0f, 1.0f, 1.0f };
+			if (material->Get(AI_MATKEY_COLOR_DIFFUSE, diffuseColor) == AI_SUCCESS) {
+				meshMaterial.albedoFactor = XMFLOAT3{ diffuseColor.r, diffuseColor.g, diffuseColor.b };
+			}
 		}
 
-		m_specularTexturesResources.push_back({});
-		std::vector<Texture> specularMaps = LoadMaterialTextures(m_specularTexturesResources[textureID], m_specularTextures, material, DetermineTextureType(scene, material), aiTextureType_SPECULAR, "texture_specRoughness", scene, device, commandList, textureID);
+		std::vector<Texture> specularMaps = LoadMaterialTextures(m_specularTexturesResources[meshIndex], m_specularTextures, textureOwners.specular, material, DetermineTextureType(scene, material), aiTextureType_SPECULAR, "texture_specRoughness", scene, device, commandList, meshIndex);
 		if (specularMaps.size() > 0)
 		{
-			hasTexSpecRoughness = true;
-			specRoughnessTexID = specularMaps[0].textureID;
+			meshMaterial.specRoughnessTextureID = specularMaps[0].textureID;
+			texturePaths.specular = specularMaps[0].path;
 		}
 
-		m_normalTexturesResources.push_back({});
-		std::vector<Texture> normalMaps = LoadMaterialTextures(m_normalTexturesResources[textureID], m_normalTextures, material, DetermineTextureType(scene, material), aiTextureType_NORMALS, "texture_normal", scene, device, commandList, textureID, true);
+		std::vector<Texture> normalMaps = LoadMaterialTextures(m_normalTexturesResources[meshIndex], m_normalTextures, textureOwners.normal, material, DetermineTextureType(scene, material), aiTextureType_NORMALS, "texture_normal", scene, device, commandList, meshIndex, true);
 		if (normalMaps.size() > 0)
 		{
-			hasTexNormal = true;
-			normalTexID = normalMaps[0].textureID;
+			meshMaterial.normalTextureID = normalMaps[0].textureID;
+			texturePaths.normal = normalMaps[0].path;
 		}
 	}
+	m_meshTexturePaths[meshIndex] = texturePaths;
+	m_materials[meshIndex] = meshMaterial;
+
+	const MeshRange& range = m_meshRanges[meshIndex];
+	ProcessMeshGeometry(mesh, range.vertexOffset, m_vertices.data() + range.vertexOffset, m_indices.data() + range.indexOffset);
+}
 
+void ModelClass::ProcessMeshGeometry(aiMesh* mesh, UINT32 baseVertex, VertexBufferStruct* vertices, UINT32* indices)
+{
 	for (unsigned int i = 0; i < mesh->mNumVertices; ++i)
 	{
 		//POSITION
 		VertexBufferStruct vertex;
 		vertex.position = XMFLOAT3{ mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z };
 
-		// TEXTURE ID
-		vertex.textureAlbedoID = hasTexAlbedo ? albedoTexID : -1;
-		vertex.textureSpecRoughnessID = hasTexSpecRoughness ? specRoughnessTexID : -1;
-		vertex.textureNormalID = hasTexNormal ? normalTexID : -1;
-
 		//NORMAL
 		if (mesh->mNormals) {
 			vertex.normal = XMFLOAT3{ mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z };
@@ -178,300 +462,1559 @@ ModelClass::Mesh ModelClass::ProcessMesh(aiMesh* mesh, const aiScene* scene, uns
 			vertex.uv = XMFLOAT2{ 0,0 };
 		}
 
-		//TANGENT and BINORMAL
-		if (!mesh->mBitangents || !mesh->mTangents)
-		{
-			if (i >= 2 && (i - 2) % 3 == 0)
-			{
-				// https://learnopengl.com/Advanced-Lighting/Normal-Mapping
-				const XMFLOAT3 pos1 = localMesh.vertices[i - 2].position;
-				const XMFLOAT3 pos2 = localMesh.vertices[i - 1].position;
-				const XMFLOAT3 pos3 = localMesh.vertices[i].position;
-				const XMFLOAT3 edge1 = XMFLOAT3{ pos2.x - pos1.x, pos2.y - pos1.y, pos2.z - pos1.z };
-				const XMFLOAT3 edge2 = XMFLOAT3{ pos3.x - pos1.x, pos3.y - pos1.y, pos3.z - pos1.z };
-
-				const XMFLOAT2 uv1 = localMesh.vertices[i - 2].uv;
-				const XMFLOAT2 uv2 = localMesh.vertices[i - 1].uv;
-				const XMFLOAT2 uv3 = localMesh.vertices[i].uv;
-				const XMFLOAT2 deltaUV1 = XMFLOAT2{ uv2.x - uv1.x, uv2.y - uv1.y };
-				const XMFLOAT2 deltaUV2 = XMFLOAT2{ uv3.x - uv1.x, uv3.y - uv1.y };
-
-				const float denominator = 1.0f / (deltaUV1.x * deltaUV2.y - deltaUV2.x * deltaUV1.y);
-
-				XMVECTOR tangent = XMVectorSet(denominator * (deltaUV2.y * edge1.x - deltaUV1.y * edge2.x),
-					denominator * (deltaUV2.y * edge1.y - deltaUV1.y * edge2.y),
-					denominator * (deltaUV2.y * edge1.z - deltaUV1.y * edge2.z),
-					0.0f);
-				tangent = XMVector3Normalize(tangent);
-
-				XMVECTOR binormal = XMVectorSet(denominator * (-deltaUV2.x * edge1.x + deltaUV1.x * edge2.x),
-					denominator * (-deltaUV2.x * edge1.y + deltaUV1.x * edge2.y),
-					denominator * (-deltaUV2.x * edge1.z + deltaUV1.x * edge2.z),
-					0.0f);
-				binormal = XMVector3Normalize(binormal);
-
-				localMesh.vertices[i].tangent = XMFLOAT3{ tangent.m128_f32[0], tangent.m128_f32[1], tangent.m128_f32[2] };
-				localMesh.vertices[i].binormal = XMFLOAT3{ binormal.m128_f32[0], binormal.m128_f32[1], binormal.m128_f32[2] };
-			}
-		}
-		else
+		//TANGENT and BINORMAL - generated below from indexed triangles, if assimp didn't provide them
+		if (mesh->mTangents && mesh->mBitangents)
 		{
-			if (mesh->mBitangents) {
-				vertex.binormal = XMFLOAT3{ mesh->mBitangents[i].x, mesh->mBitangents[i].y, mesh->mBitangents[i].z };
-			}
-
-			if (mesh->mTangents) {
-				vertex.tangent = XMFLOAT3{ mesh->mTangents[i].x, mesh->mTangents[i].y, mesh->mTangents[i].z };
-			}
+			vertex.tangent = XMFLOAT3{ mesh->mTangents[i].x, mesh->mTangents[i].y, mesh->mTangents[i].z };
+			vertex.binormal = XMFLOAT3{ mesh->mBitangents[i].x, mesh->mBitangents[i].y, mesh->mBitangents[i].z };
 		}
 
 		//Store in array
-		localMesh.vertices[i] = vertex;
+		vertices[i] = vertex;
 	}
 
-	unsigned int indicesCount = 0;
-	for (unsigned int i = 0; i < mesh->mNumFaces; ++i)
-	{
-		aiFace face = mesh->mFaces[i];
-		indicesCount += face.mNumIndices;
-	}
-	localMesh.indices.resize(indicesCount);
-	localMesh.indexCount = indicesCount;
-	localMesh.vertexCount = mesh->mNumVertices;
 	size_t currentIndexCounter = 0;
-
 	for (unsigned int i = 0; i < mesh->mNumFaces; ++i)
 	{
-		aiFace face = mesh->mFaces[i];
+		const aiFace& face = mesh->mFaces[i];
 		for (unsigned int j = 0; j < face.mNumIndices; ++j)
 		{
-			localMesh.indices[currentIndexCounter++] = static_cast<unsigned long>(face.mIndices[j]);
+			indices[currentIndexCounter++] = face.mIndices[j];
 		}
 	}
 
-	return localMesh;
-}
-
-std::string ModelClass::DetermineTextureType(const aiScene* scene, aiMaterial* mat)
-{
-	aiString texTypeString;
-	mat->GetTexture(aiTextureType_DIFFUSE, 0, &texTypeString);
-	std::string texTypeTestStr = texTypeString.C_Str();
-	if (texTypeTestStr == "*0" || texTypeTestStr == "*1" || texTypeTestStr == "*2" || texTypeTestStr == "*3" || texTypeTestStr == "*4" || texTypeTestStr == "*5") {
-		if (scene->mTextures[0]->mHeight == 0) {
-			return "embedded compressed texture";
-		}
-		else {
-			return "embedded non-compressed texture";
-		}
+	// Triangulated import leaves only triangles, point and line meshes keep tangents undefined
+	if ((!mesh->mTangents || !mesh->mBitangents) && currentIndexCounter % 3 == 0) {
+		GenerateTangents(vertices, mesh->mNumVertices, indices, currentIndexCounter);
 	}
-	if (texTypeTestStr.find('.') != std::string::npos) {
-		return "textures are on disk";
+
+	// Indices are stored relative to whole model
+	for (size_t i = 0; i < currentIndexCounter; ++i)
+	{
+		indices[i] += baseVertex;
 	}
+}
 
-	return ".";
+TangentGenerator::Statistics ModelClass::GenerateTangents(VertexBufferStruct* vertices, size_t vertexCount, const UINT32* indices, size_t indexCount)
+{
+	// Indices are mesh local
+	const TangentGenerator::VertexStreams streams = { &vertices->position.x, &vertices->normal.x, &vertices->uv.x, &vertices->tangent.x, &vertices->binormal.x, sizeof(VertexBufferStruct) };
+	return TangentGenerator::Generate(streams, vertexCount, indices, indexCount);
 }
 
-std::vector<ModelClass::Texture> ModelClass::LoadMaterialTextures(ComPtr<ID3D12Resource>& resource, std::vector<Texture>& texturesRef, aiMaterial* mat, std::string texType, aiTextureType type, std::string typeName, const aiScene* scene, ComPtr<ID3D12Device2> device, ComPtr<ID3D12GraphicsCommandList4> commandList, int index, bool forceDDS /* = false */)
+UINT32 ModelClass::GetMeshIndexCount(const aiMesh* mesh)
 {
-	std::vector<Texture> textures;
+	UINT32 indicesCount = 0;
+	for (unsigned int i = 0; i < mesh->mNumFaces; ++i)
+	{
+		indicesCount += mesh->mFaces[i].mNumIndices;
+	}
+	return indicesCount;
+}
 
-	for (UINT i = 0; i < mat->GetTextureCount(type); ++i)
+ModelClass::TextureOwners ModelClass::FindTextureOwners(const aiScene* scene)
+{
+	// Serial pass over materials only - matches order in which serial import registered textures
+	TextureOwners owners{};
+	auto registerOwners = [scene](std::unordered_map<std::string, int>& typeOwners, aiMaterial* material, aiTextureType type, int meshIndex)
 	{
-		aiString str;
-		mat->GetTexture(type, i, &str);
-		// Check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
-		bool skip = false;
-		for (UINT j = 0; j < texturesRef.size(); j++) {
-			if (std::strcmp(texturesRef[j].path.c_str(), str.C_Str()) == 0) {
-				textures.push_back(texturesRef[j]);
-				textures[textures.size() - 1].textureID = texturesRef[j].textureID;
-				skip = true; // A texture with the same filepath has already been loaded, continue to next one. (optimization)
-				break;
-			}
+		for (UINT i = 0; i < material->GetTextureCount(type); ++i)
+		{
+			aiString str;
+			material->GetTexture(type, i, &str);
+			typeOwners.emplace(str.C_Str(), meshIndex);
 		}
+	};
 
-		if (!skip) {   // If texture hasn't been loaded already, load it
-			Texture texture;
-			if (texType == "embedded compressed texture") {
-				//int textureindex = GetTextureIndex(&str);
-				//texture.resource = GetTextureFromModel(scene, textureindex, device, commandList);
-			}
-			else 
-			{
-				//int textureindex = GetTextureIndex(&str);
-				std::string filename = std::string(str.C_Str());
-				auto data = GetTextureFromModel(resource, scene, filename, device, commandList, index, forceDDS);
-				texture.resource = data.first;
-				texture.subresourceData = data.second;
-			}
-			texture.textureID = index;
-			texture.type = typeName;
-			texture.path = str.C_Str();
-			textures.push_back(texture);
-			texturesRef.push_back(texture);  // Store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
-		}
+	for (unsigned int i = 0; i < scene->mNumMeshes; ++i)
+	{
+		aiMaterial* material = scene->mMaterials[scene->mMeshes[i]->mMaterialIndex];
+		registerOwners(owners.albedo, material, aiTextureType_DIFFUSE, static_cast<int>(i));
+		registerOwners(owners.specular, material, aiTextureType_SPECULAR, static_cast<int>(i));
+		registerOwners(owners.normal, material, aiTextureType_NORMALS, static_cast<int>(i));
 	}
-
-	return textures;
+	return owners;
 }
 
-int ModelClass::GetTextureIndex(aiString* str)
+void ModelClass::CompressTextures(std::vector<TextureCompressor::Job> jobs) const
 {
-	std::string tistr;
-	tistr = str->C_Str();
-	tistr = tistr.substr(1);
-	return stoi(tistr);
+	// Empty slots and textures embedded in model file ("*index") have no file to compress
+	jobs.erase(std::remove_if(jobs.begin(), jobs.end(), [](const TextureCompressor::Job& job) {
+		return job.sourcePath.empty() || job.sourcePath[0] == '*';
+	}), jobs.end());
+	TextureCompressor::CompressAll(jobs, m_loadSettings.importThreadCount);
 }
 
-std::pair<ComPtr<ID3D12Resource>, D3D12_SUBRESOURCE_DATA> ModelClass::GetTextureFromModel(ComPtr<ID3D12Resource>& resource, const aiScene* scene, std::string filename, ComPtr<ID3D12Device2> device, ComPtr<ID3D12GraphicsCommandList4> commandList, int index, bool forceDDS /* = false */)
+void ModelClass::BenchmarkImport(const aiScene* scene) const
 {
-	std::vector<D3D12_SUBRESOURCE_DATA> textureData;
-	D3D12_SUBRESOURCE_DATA textureDataSingle;
-	std::unique_ptr<uint8_t[]> decodedData;
-	ComPtr<ID3D12Resource> texture;
-	m_uploadHeaps.push_back({});
-
-	std::string s = std::regex_replace(filename, std::regex("\\\\"), "/");
-
-	std::wstring ws(s.begin(), s.end());
-	if (forceDDS) {
-		ThrowIfFailed(LoadDDSTextureFromFileEx(device.Get(), ws.c_str(), 0, D3D12_RESOURCE_FLAG_NONE, DDS_LOADER_DEFAULT, texture.ReleaseAndGetAddressOf(), decodedData, textureData));
-		textureDataSingle = textureData[0];
-	}
-	else {
-		ThrowIfFailed(LoadWICTextureFromFileEx(device.Get(), ws.c_str(), 0, D3D12_RESOURCE_FLAG_NONE, WIC_LOADER_DEFAULT, texture.ReleaseAndGetAddressOf(), decodedData, textureDataSingle));
+	// Only geometry is reprocessed, into scratch arrays - loading textures again would record duplicated uploads
+	const unsigned int meshCount = scene->mNumMeshes;
+	const unsigned int maxThreadCount = ThreadPool::GetDefaultThreadCount();
+	std::vector<unsigned int> threadCounts;
+	for (unsigned int threadCount = 1; threadCount < maxThreadCount; threadCount *= 2)
+	{
+		threadCounts.push_back(threadCount);
 	}
+	threadCounts.push_back(maxThreadCount);
 
-	const UINT64 uploadBufferSize = GetRequiredIntermediateSize(texture.Get(), 0, 1);
-	//auto desc = texture->GetDesc();
-
-	// uploadHeap must outlive this function - until command list is closed
-	ThrowIfFailed(device->CreateCommittedResource(
-		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-		D3D12_HEAP_FLAG_NONE,
-		&CD3DX12_RESOURCE_DESC::Buffer(uploadBufferSize),
-		D3D12_RESOURCE_STATE_GENERIC_READ,
-		nullptr,
-		IID_PPV_ARGS(&m_uploadHeaps[m_uploadHeaps.size() - 1])
-	));
-
-	UpdateSubresources(commandList.Get(), texture.Get(), m_uploadHeaps[m_uploadHeaps.size() - 1].Get(), 0, 0, 1, &textureDataSingle);
-	//commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_texture.Get(), D3D12_RESOURCE_STATE_COPY_DEST, InitialResourceState));
-
-	//if (textureDataSingle.SlicePitch == 128 * 128 * 4)
-	//if (texture->GetDesc().Width == 128 && texture->GetDesc().Height == 128)
+	// Model ranges may be already shrunk by welding, scratch ranges follow imported meshes
+	std::vector<MeshRange> ranges(meshCount);
+	UINT32 vertexOffset = 0;
+	UINT32 indexOffset = 0;
+	for (unsigned int i = 0; i < meshCount; ++i)
 	{
-		commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(texture.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_COPY_SOURCE));
+		ranges[i] = { vertexOffset, scene->mMeshes[i]->mNumVertices, indexOffset, GetMeshIndexCount(scene->mMeshes[i]) };
+		vertexOffset += ranges[i].vertexCount;
+		indexOffset += ranges[i].indexCount;
+	}
 
-		D3D12_RESOURCE_DESC textureDesc = {};
-		textureDesc.MipLevels = 1;
-/*		if (texture->GetDesc().Format == DXGI_FORMAT_BC1_UNORM  || texture->GetDesc().Format == DXGI_FORMAT_BC1_TYPELESS) {
-			textureDesc.Format = DXGI_FORMAT_R16G16B16A16_FLOAT;
-		}
-		else if (texture->GetDesc().Format == DXGI_FORMAT_BC3_UNORM || texture->GetDesc().Format == DXGI_FORMAT_BC3_TYPELESS || texture->GetDesc().Format == DXGI_FORMAT_BC5_UNORM) {
-			textureDesc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
-		}
-		else */{
-			textureDesc.Format = texture->GetDesc().Format; /*DXGI_FORMAT_R8G8B8A8_UNORM*/;
+	double serialTime = 0.0;
+	std::vector<VertexBufferStruct> vertices(vertexOffset);
+	std::vector<UINT32> indices(indexOffset);
+	for (unsigned int threadCount : threadCounts)
+	{
+		ThreadPool threadPool{ threadCount };
+		const auto startTime = std::chrono::high_resolution_clock::now();
+		threadPool.ParallelFor(meshCount, [&](size_t i) {
+			const MeshRange& range = ranges[i];
+			ProcessMeshGeometry(scene->mMeshes[i], range.vertexOffset, vertices.data() + range.vertexOffset, indices.data() + range.indexOffset);
+		});
+		const std::chrono::duration<double, std::milli> processTime = std::chrono::high_resolution_clock::now() - startTime;
+
+		if (threadCount == 1) {
+			serialTime = processTime.count();
 		}
-		textureDesc.Width = texture->GetDesc().Width;
-		textureDesc.Height = texture->GetDesc().Height;
-		textureDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
-		textureDesc.DepthOrArraySize = 1;
-		textureDesc.SampleDesc.Count = 1;
-		textureDesc.SampleDesc.Quality = 0;
-		textureDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+		LogDebugRTCP("ModelClass: import benchmark - %u meshes, %2u threads: %8.2f ms (speedup x%.2f)\n", meshCount, threadCount, processTime.count(), serialTime / processTime.count());
+	}
 
-		ThrowIfFailed(device->CreateCommittedResource(
-			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
-			D3D12_HEAP_FLAG_NONE,
-			&textureDesc,
-			D3D12_RESOURCE_STATE_COPY_DEST,
-			nullptr,
-			IID_PPV_ARGS(&resource)
-		));
+	// Tangent generation alone, over scratch geometry - indices are converted back to mesh local first
+	for (unsigned int i = 0; i < meshCount; ++i)
+	{
+		for (UINT32 j = 0; j < ranges[i].indexCount; ++j)
+		{
+			indices[ranges[i].indexOffset + j] -= ranges[i].vertexOffset;
+		}
+	}
+	const size_t triangleCount = indices.size() / 3;
+	for (unsigned int threadCount : { 1u, maxThreadCount })
+	{
+		ThreadPool threadPool{ threadCount };
+		const auto startTime = std::chrono::high_resolution_clock::now();
+		threadPool.ParallelFor(meshCount, [&](size_t i) {
+			const MeshRange& range = ranges[i];
+			GenerateTangents(vertices.data() + range.vertexOffset, range.vertexCount, indices.data() + range.indexOffset, range.indexCount);
+		});
+		const std::chrono::duration<double> tangentTime = std::chrono::high_resolution_clock::now() - startTime;
+		LogDebugRTCP("ModelClass: tangent benchmark - %zu triangles, %2u threads: %8.2f ms (%.1f M triangles/s)\n", triangleCount, threadCount,
+			tangentTime.count() * 1000.0, tangentTime.count() > 0.0 ? triangleCount / tangentTime.count() / 1e6 : 0.0);
+	}
+}
 
-		D3D12_TEXTURE_COPY_LOCATION dst{};
-		dst.pResource = resource.Get();
+void ModelClass::BenchmarkGeometryCodec() const
+{
+	// Whole model is encoded as single stream, same as in mesh cache
+	const ArrayView<VertexBufferStruct> vertices = GetVertices();
+	const ArrayView<UINT32> indices = GetIndices();
+	std::vector<UINT8> encodedVertices;
+	std::vector<UINT8> encodedIndices;
+	const auto encodeStart = std::chrono::high_resolution_clock::now();
+	GeometryCodec::EncodeVertices(vertices.data(), vertices.size(), sizeof(VertexBufferStruct), encodedVertices);
+	GeometryCodec::EncodeIndices(indices.data(), indices.size(), encodedIndices);
+	const std::chrono::duration<double> encodeTime = std::chrono::high_resolution_clock::now() - encodeStart;
+
+	std::vector<VertexBufferStruct> decodedVertices(vertices.size());
+	std::vector<UINT32> decodedIndices(indices.size());
+	const auto vertexStart = std::chrono::high_resolution_clock::now();
+	const bool verticesDecoded = GeometryCodec::DecodeVertices(encodedVertices.data(), encodedVertices.size(), decodedVertices.data(), decodedVertices.size(), sizeof(VertexBufferStruct));
+	const std::chrono::duration<double> vertexTime = std::chrono::high_resolution_clock::now() - vertexStart;
+	const auto indexStart = std::chrono::high_resolution_clock::now();
+	const bool indicesDecoded = GeometryCodec::DecodeIndices(encodedIndices.data(), encodedIndices.size(), decodedIndices.data(), decodedIndices.size());
+	const std::chrono::duration<double> indexTime = std::chrono::high_resolution_clock::now() - indexStart;
+
+	// Same streams with chunks spread over all hardware threads, as mesh cache decodes them
+	const unsigned int threadCount = ThreadPool::GetDefaultThreadCount();
+	ThreadPool threadPool{ threadCount };
+	const GeometryCodec::ParallelFor parallelFor = [&threadPool](size_t count, const std::function<void(size_t)>& func) { threadPool.ParallelFor(count, func); };
+	const auto parallelStart = std::chrono::high_resolution_clock::now();
+	const bool parallelDecoded = GeometryCodec::DecodeVertices(encodedVertices.data(), encodedVertices.size(), decodedVertices.data(), decodedVertices.size(), sizeof(VertexBufferStruct), parallelFor) &&
+		GeometryCodec::DecodeIndices(encodedIndices.data(), encodedIndices.size(), decodedIndices.data(), decodedIndices.size(), parallelFor);
+	const std::chrono::duration<double> parallelTime = std::chrono::high_resolution_clock::now() - parallelStart;
+
+	// Vertices are lossless, triangles may start with different vertex but keep winding
+	bool roundTrip = verticesDecoded && indicesDecoded && parallelDecoded && (vertices.size() == 0 || memcmp(vertices.data(), decodedVertices.data(), vertices.size_bytes()) == 0);
+	for (size_t i = 0; roundTrip && i + 2 < indices.size(); i += 3)
+	{
+		const UINT32* a = indices.data() + i;
+		const UINT32* b = decodedIndices.data() + i;
+		roundTrip = (a[0] == b[0] && a[1] == b[1] && a[2] == b[2]) || (a[0] == b[1] && a[1] == b[2] && a[2] == b[0]) || (a[0] == b[2] && a[1] == b[0] && a[2] == b[1]);
+	}
+	assert(roundTrip && "Geometry codec round trip failed");
+
+	const size_t triangleCount = indices.size() / 3;
+	LogDebugRTCP("ModelClass: geometry codec - vertices %.2f MB -> %.2f MB (%.1f%%), indices %.2f MB -> %.2f MB (%.1f%%, %.1f bits/triangle), encoded in %.2f ms, round trip %s\n",
+		vertices.size_bytes() / (1024.0 * 1024.0), encodedVertices.size() / (1024.0 * 1024.0), vertices.size() > 0 ? 100.0 * encodedVertices.size() / vertices.size_bytes() : 100.0,
+		indices.size_bytes() / (1024.0 * 1024.0), encodedIndices.size() / (1024.0 * 1024.0), indices.size() > 0 ? 100.0 * encodedIndices.size() / indices.size_bytes() : 100.0,
+		triangleCount > 0 ? 8.0 * encodedIndices.size() / triangleCount : 0.0, encodeTime.count() * 1000.0, roundTrip ? "ok" : "FAILED");
+	LogDebugRTCP("ModelClass: geometry codec - vertex decode %.2f ms (%.2f GB/s), index decode %.2f ms (%.2f GB/s)\n",
+		vertexTime.count() * 1000.0, vertexTime.count() > 0.0 ? vertices.size_bytes() / vertexTime.count() / 1e9 : 0.0,
+		indexTime.count() * 1000.0, indexTime.count() > 0.0 ? indices.size_bytes() / indexTime.count() / 1e9 : 0.0);
+	LogDebugRTCP("ModelClass: geometry codec - %zu vertex chunks and %zu index chunks decoded on %u threads in %.2f ms (%.2f GB/s)\n",
+		GeometryCodec::GetVertexChunkCount(vertices.size()), GeometryCodec::GetIndexChunkCount(indices.size()), threadCount, parallelTime.count() * 1000.0,
+		parallelTime.count() > 0.0 ? (vertices.size_bytes() + indices.size_bytes()) / parallelTime.count() / 1e9 : 0.0);
+}
 
-		D3D12_TEXTURE_COPY_LOCATION src{};
-		src.pResource = texture.Get();
+UINT64 ModelClass::GetProcessingKey() const
+{
+	// FNV-1a over processing flags and every setting affecting processed geometry
+	constexpr UINT64 FNV_OFFSET = 14695981039346656037ull;
+	constexpr UINT64 FNV_PRIME = 1099511628211ull;
+	UINT64 key = FNV_OFFSET;
+	auto hash = [&key](const void* data, size_t size)
+	{
+		for (size_t i = 0; i < size; ++i)
+		{
+			key = (key ^ static_cast<const UINT8*>(data)[i]) * FNV_PRIME;
+		}
+	};
 
-		commandList->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+	UINT32 flags = 0;
+	if (m_loadSettings.optimizeMeshes) {
+		flags |= PROCESSING_OPTIMIZE_MESHES;
 	}
-
-	return { texture, textureDataSingle };
+	if (m_loadSettings.weldVertices) {
+		flags |= PROCESSING_WELD_VERTICES;
+	}
+	if (!m_loadSettings.lodTargetRatios.empty()) {
+		flags |= PROCESSING_GENERATE_LODS;
+	}
+	if (m_loadSettings.compressMeshCache) {
+		flags |= PROCESSING_COMPRESS_CACHE;
+	}
+	if (m_loadSettings.optimizeMeshes && m_loadSettings.spatialTriangleOrder) {
+		flags |= PROCESSING_SPATIAL_ORDER;
+	}
+	hash(&flags, sizeof(flags));
+	if (m_loadSettings.weldVertices) {
+		hash(&m_loadSettings.weldEpsilon, sizeof(float));
+	}
+	if (!m_loadSettings.lodTargetRatios.empty())
+	{
+		hash(m_loadSettings.lodTargetRatios.data(), sizeof(float) * m_loadSettings.lodTargetRatios.size());
+		hash(&m_loadSettings.lodTargetError, sizeof(float));
+	}
+	return key;
 }
 
-bool ModelClass::CreateRectangle(ComPtr<ID3D12Device2> device, float left, float right, float top, float bottom)
+UINT32 ModelClass::WeldMesh(const MeshRange& range)
 {
-	Mesh localMesh;
-	constexpr size_t verticesCount = 6;
+	static_assert(sizeof(VertexBufferStruct) == VERTEX_FLOAT_COUNT * sizeof(float), "Welding expects vertex made of floats only");
 
-	localMesh.vertices.resize(verticesCount);
-	localMesh.indices.resize(verticesCount);
-	localMesh.vertexCount = verticesCount;
-	localMesh.indexCount = verticesCount;
-	for (size_t i = 0; i < verticesCount; ++i)
+	// Welding works on mesh local indices, result stays in the same range until meshes are compacted
+	VertexBufferStruct* vertices = m_vertices.data() + range.vertexOffset;
+	UINT32* indices = m_indices.data() + range.indexOffset;
+	for (UINT32 i = 0; i < range.indexCount; ++i)
 	{
-		localMesh.indices[i] = static_cast<unsigned long>(i);
+		indices[i] -= range.vertexOffset;
 	}
 
-	//First triangle
-	localMesh.vertices[0].position = XMFLOAT3(left, top, 0.0f);  // Top left.	
-	localMesh.vertices[1].position = XMFLOAT3(right, bottom, 0.0f);  // Bottom right.
-	localMesh.vertices[2].position = XMFLOAT3(left, bottom, 0.0f);  // Bottom left.
-	//Second triangle
-	localMesh.vertices[3].position = XMFLOAT3(left, top, 0.0f);  // Top left.
-	localMesh.vertices[4].position = XMFLOAT3(right, top, 0.0f);  // Top right.
-	localMesh.vertices[5].position = XMFLOAT3(right, bottom, 0.0f);  // Bottom right.
+#ifndef NDEBUG
+	const std::vector<VertexBufferStruct> originalVertices(vertices, vertices + range.vertexCount);
+	const std::vector<UINT32> originalIndices(indices, indices + range.indexCount);
+#endif
 
-	localMesh.vertices[0].normal = XMFLOAT3(0.0f, 0.0f, -1.0f);
-	localMesh.vertices[1].normal = XMFLOAT3(0.0f, 0.0f, -1.0f);
-	localMesh.vertices[2].normal = XMFLOAT3(0.0f, 0.0f, -1.0f);
-	localMesh.vertices[3].normal = XMFLOAT3(0.0f, 0.0f, -1.0f);
-	localMesh.vertices[4].normal = XMFLOAT3(0.0f, 0.0f, -1.0f);
-	localMesh.vertices[5].normal = XMFLOAT3(0.0f, 0.0f, -1.0f);
+	const UINT32 vertexCount = static_cast<UINT32>(MeshOptimizer::WeldVertices(vertices, range.vertexCount, sizeof(VertexBufferStruct), VERTEX_FLOAT_COUNT, m_loadSettings.weldEpsilon, indices, range.indexCount));
 
-	//Set UV values
+#ifndef NDEBUG
+	// Every corner has to keep attributes used by rendering - floats may only move within epsilon grid cell
+	for (UINT32 i = 0; i < range.indexCount; ++i)
 	{
-		//First triangle	
-		localMesh.vertices[0].uv = XMFLOAT2(0.0, 0.0);  // Top left.	
-		localMesh.vertices[1].uv = XMFLOAT2(1.0, 1.0);  // Bottom right.
-		localMesh.vertices[2].uv = XMFLOAT2(0.0, 1.0);  // Bottom left.
-		//Second triangle
-		localMesh.vertices[3].uv = XMFLOAT2(0.0, 0.0);  // Top left.
-		localMesh.vertices[4].uv = XMFLOAT2(1.0, 0.0);  // Top right.
-		localMesh.vertices[5].uv = XMFLOAT2(1.0, 1.0);  // Bottom right.
+		const VertexBufferStruct& welded = vertices[indices[i]];
+		const VertexBufferStruct& original = originalVertices[originalIndices[i]];
+		const float* weldedFloats = &welded.position.x;
+		const float* originalFloats = &original.position.x;
+		for (size_t j = 0; j < VERTEX_FLOAT_COUNT; ++j)
+		{
+			assert((weldedFloats[j] == originalFloats[j] || std::abs(weldedFloats[j] - originalFloats[j]) <= m_loadSettings.weldEpsilon) && "Welding changed vertex attribute");
+		}
 	}
+#endif
 
-	m_meshes.clear();
-	m_meshes.push_back(localMesh);
-
-	return true;
+	for (UINT32 i = 0; i < range.indexCount; ++i)
+	{
+		indices[i] += range.vertexOffset;
+	}
+	return vertexCount;
 }
 
-bool ModelClass::PrepareBuffers(ComPtr<ID3D12Device2> device, DXGI_FORMAT indexFormat)
+void ModelClass::CompactMeshes(const std::vector<UINT32>& vertexCounts)
 {
-	std::vector<ModelClass::VertexBufferStruct> vertices{};
-	std::vector<unsigned long> indices{};
+	assert(vertexCounts.size() == m_meshRanges.size());
 
-	for (Mesh mesh : m_meshes)
+	// Meshes only shrink, so moving them front to back never overwrites mesh that wasn't moved yet
+	UINT32 vertexOffset = 0;
+	for (size_t i = 0; i < m_meshRanges.size(); ++i)
 	{
-		std::copy(mesh.vertices.begin(), mesh.vertices.end(), back_inserter(vertices));
-		//std::copy(mesh.indices.begin(), mesh.indices.end(), back_inserter(indices));
-		unsigned long count = static_cast<unsigned long>(indices.size());
-		for (unsigned long i : mesh.indices)
+		MeshRange& range = m_meshRanges[i];
+		assert(vertexCounts[i] <= range.vertexCount);
+		if (vertexOffset != range.vertexOffset)
 		{
-			indices.push_back(i + count);
-		}
+			memmove(m_vertices.data() + vertexOffset, m_vertices.data() + range.vertexOffset, sizeof(VertexBufferStruct) * vertexCounts[i]);
+			UINT32* indices = m_indices.data() + range.indexOffset;
+			for (UINT32 j = 0; j < range.indexCount; ++j)
+			{
+				indices[j] = indices[j] - range.vertexOffset + vertexOffset;
+			}
+		}
+		range.vertexOffset = vertexOffset;
+		range.vertexCount = vertexCounts[i];
+		vertexOffset += vertexCounts[i];
+	}
+	m_vertices.resize(vertexOffset);
+	m_vertices.shrink_to_fit();
+}
+
+ModelClass::MeshOptimizationStatistics ModelClass::OptimizeMesh(const MeshRange& range, const MeshOptimizer::ParallelFor& parallelFor)
+{
+	// Optimizer works on mesh local indices
+	VertexBufferStruct* vertices = m_vertices.data() + range.vertexOffset;
+	UINT32* indices = m_indices.data() + range.indexOffset;
+	for (UINT32 i = 0; i < range.indexCount; ++i)
+	{
+		indices[i] -= range.vertexOffset;
+	}
+
+	MeshOptimizationStatistics statistics;
+	statistics.fifoBefore = MeshOptimizer::AnalyzeVertexCache(indices, range.indexCount, range.vertexCount, MeshOptimizer::DEFAULT_CACHE_SIZE, MeshOptimizer::CacheModel::Fifo);
+	statistics.lruBefore = MeshOptimizer::AnalyzeVertexCache(indices, range.indexCount, range.vertexCount, MeshOptimizer::DEFAULT_CACHE_SIZE, MeshOptimizer::CacheModel::Lru);
+
+	// Vertex order depends on triangle order, so triangles have to be reordered first
+	if (m_loadSettings.spatialTriangleOrder) {
+		MeshOptimizer::SortTrianglesSpatially(indices, range.indexCount, &vertices->position.x, range.vertexCount, sizeof(VertexBufferStruct), parallelFor);
+	}
+	else {
+		MeshOptimizer::OptimizeVertexCache(indices, range.indexCount, range.vertexCount);
+	}
+	MeshOptimizer::OptimizeVertexFetch(vertices, range.vertexCount, sizeof(VertexBufferStruct), indices, range.indexCount);
+
+	statistics.fifoAfter = MeshOptimizer::AnalyzeVertexCache(indices, range.indexCount, range.vertexCount, MeshOptimizer::DEFAULT_CACHE_SIZE, MeshOptimizer::CacheModel::Fifo);
+	statistics.lruAfter = MeshOptimizer::AnalyzeVertexCache(indices, range.indexCount, range.vertexCount, MeshOptimizer::DEFAULT_CACHE_SIZE, MeshOptimizer::CacheModel::Lru);
+
+	for (UINT32 i = 0; i < range.indexCount; ++i)
+	{
+		indices[i] += range.vertexOffset;
+	}
+	return statistics;
+}
+
+void ModelClass::LogOptimizationStatistics(const std::vector<MeshOptimizationStatistics>& statistics, double optimizationTime) const
+{
+	// Model ratios are computed from summed misses, so large meshes weigh more than small ones
+	auto sum = [&statistics](MeshOptimizer::VertexCacheStatistics MeshOptimizationStatistics::* member)
+	{
+		MeshOptimizer::VertexCacheStatistics total{};
+		for (const MeshOptimizationStatistics& mesh : statistics)
+		{
+			total.triangleCount += (mesh.*member).triangleCount;
+			total.vertexCount += (mesh.*member).vertexCount;
+			total.cacheMisses += (mesh.*member).cacheMisses;
+		}
+		total.acmr = total.triangleCount > 0 ? static_cast<float>(total.cacheMisses) / total.triangleCount : 0.0f;
+		total.atvr = total.vertexCount > 0 ? static_cast<float>(total.cacheMisses) / total.vertexCount : 0.0f;
+		return total;
+	};
+
+	const MeshOptimizer::VertexCacheStatistics fifoBefore = sum(&MeshOptimizationStatistics::fifoBefore);
+	const MeshOptimizer::VertexCacheStatistics fifoAfter = sum(&MeshOptimizationStatistics::fifoAfter);
+	const MeshOptimizer::VertexCacheStatistics lruBefore = sum(&MeshOptimizationStatistics::lruBefore);
+	const MeshOptimizer::VertexCacheStatistics lruAfter = sum(&MeshOptimizationStatistics::lruAfter);
+	LogDebugRTCP("ModelClass: optimized %zu meshes (%zu triangles) in %.2f ms\n", statistics.size(), fifoAfter.triangleCount, optimizationTime);
+	LogDebugRTCP("ModelClass: vertex cache FIFO %u - ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", MeshOptimizer::DEFAULT_CACHE_SIZE, fifoBefore.acmr, fifoAfter.acmr, fifoBefore.atvr, fifoAfter.atvr);
+	LogDebugRTCP("ModelClass: vertex cache LRU %u - ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", MeshOptimizer::DEFAULT_CACHE_SIZE, lruBefore.acmr, lruAfter.acmr, lruBefore.atvr, lruAfter.atvr);
+}
+
+void ModelClass::BenchmarkTraversal(const char* stage) const
+{
+	if (m_indices.empty()) {
+		return;
+	}
+
+	const auto startTime = std::chrono::high_resolution_clock::now();
+	const TraversalSimulator::Statistics statistics = TraversalSimulator::Simulate(m_indices.data(), m_indices.size(), &m_vertices.data()->position.x, m_vertices.size(), sizeof(VertexBufferStruct), TraversalSimulator::Settings{});
+	const std::chrono::duration<double, std::milli> simulationTime = std::chrono::high_resolution_clock::now() - startTime;
+	LogDebugRTCP("ModelClass: traversal benchmark %s - %zu rays (%zu hits), %zu triangle tests, %zu of %zu cache lines missed (%.1f%%, %.2f per ray), simulated in %.2f ms\n", stage,
+		statistics.rayCount, statistics.hitCount, statistics.triangleTests, statistics.cacheMisses, statistics.cacheAccesses, 100.0f * statistics.missRate, statistics.missesPerRay, simulationTime.count());
+}
+
+void ModelClass::BenchmarkVertexStreams() const
+{
+	const ArrayView<VertexBufferStruct> vertices = GetVertices();
+	const ArrayView<UINT32> indices = GetIndices();
+	if (indices.empty()) {
+		return;
+	}
+
+	// Positions are always read from full vertices, only simulated addresses follow every layout
+	struct Layout {
+		const char* name;
+		size_t vertexStride;
+		size_t attributeSize;
+		bool split;
+	};
+	const Layout layouts[] = {
+		{ "full interleaved", sizeof(VertexBufferStruct), sizeof(VertexAttributes), false },
+		{ "full split", sizeof(VertexBufferStruct), sizeof(VertexAttributes), true },
+		{ "packed interleaved", sizeof(PackedVertex), sizeof(PackedVertexAttributes), false },
+		{ "packed split", sizeof(PackedVertex), sizeof(PackedVertexAttributes), true }
+	};
+	for (const Layout& layout : layouts)
+	{
+		TraversalSimulator::Settings settings;
+		settings.layoutVertexStride = layout.vertexStride;
+		settings.attributeSize = layout.attributeSize;
+		settings.splitStreams = layout.split;
+		const TraversalSimulator::Statistics statistics = TraversalSimulator::Simulate(indices.data(), indices.size(), &vertices.data()->position.x, vertices.size(), sizeof(VertexBufferStruct), settings);
+		LogDebugRTCP("ModelClass: vertex streams benchmark %-18s - %.1f B touched per ray, %.1f B missed per ray (triangle fetch %zu/%zu lines missed, hit attributes %zu/%zu)\n", layout.name,
+			statistics.bytesPerRay, statistics.missedBytesPerRay, statistics.cacheMisses, statistics.cacheAccesses, statistics.shadingMisses, statistics.shadingAccesses);
+	}
+}
+
+void ModelClass::BenchmarkAnalyticPrimitive(AnalyticPrimitives::Type type) const
+{
+	const XMFLOAT3* positions = GetPositions();
+	const ArrayView<UINT32> indices = GetIndices();
+	if (!positions || indices.empty()) {
+		return;
+	}
+
+	// Box is bounds of the mesh, sphere and disk (in XZ plane) are centered in them and reach the farthest vertex
+	const size_t vertexCount = static_cast<size_t>(GetVerticesCount());
+	BoundingBox bounds;
+	BoundingBox::CreateFromPoints(bounds, vertexCount, positions, GetPositionStride());
+	const XMVECTOR center = XMLoadFloat3(&bounds.Center);
+	float radius = 0.0f;
+	for (size_t i = 0; i < vertexCount; ++i)
+	{
+		const XMFLOAT3& position = *reinterpret_cast<const XMFLOAT3*>(reinterpret_cast<const UINT8*>(positions) + i * GetPositionStride());
+		radius = std::max(radius, XMVectorGetX(XMVector3Length(XMLoadFloat3(&position) - center)));
+	}
+	const float centerArray[3] = { bounds.Center.x, bounds.Center.y, bounds.Center.z };
+	const float extentsArray[3] = { bounds.Extents.x, bounds.Extents.y, bounds.Extents.z };
+	const float up[3] = { 0.0f, 1.0f, 0.0f };
+	const char* typeName = type == AnalyticPrimitives::Type::Sphere ? "sphere" : (type == AnalyticPrimitives::Type::Box ? "box" : "disk");
+	const AnalyticPrimitives::Primitive primitive = type == AnalyticPrimitives::Type::Sphere ? AnalyticPrimitives::CreateSphere(centerArray, radius) :
+		(type == AnalyticPrimitives::Type::Box ? AnalyticPrimitives::CreateBox(centerArray, extentsArray) : AnalyticPrimitives::CreateDisk(centerArray, up, radius));
+
+	// Rays start outside of bounding sphere and aim at random points of the bounds, so most of them hit
+	constexpr size_t rayCount = 256 * 256;
+	std::vector<float> rays(rayCount * 6);
+	std::mt19937 generator(0);
+	std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+	for (size_t i = 0; i < rayCount; ++i)
+	{
+		XMVECTOR offset;
+		do {
+			offset = XMVectorSet(distribution(generator), distribution(generator), distribution(generator), 0.0f);
+		} while (XMVectorGetX(XMVector3LengthSq(offset)) < 1e-4f);
+		const XMVECTOR origin = center + XMVector3Normalize(offset) * (radius * 3.0f);
+		const XMVECTOR target = center + XMVectorSet(distribution(generator) * bounds.Extents.x, distribution(generator) * bounds.Extents.y, distribution(generator) * bounds.Extents.z, 0.0f);
+		XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(&rays[i * 6]), origin);
+		XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(&rays[i * 6 + 3]), target - origin);
+	}
+
+	// Triangles through BVH, timing includes the build
+	std::vector<float> triangleDistances(rayCount);
+	auto startTime = std::chrono::high_resolution_clock::now();
+	const size_t nodeCount = TraversalSimulator::CastRays(indices.data(), indices.size(), &positions->x, vertexCount, GetPositionStride(), rays.data(), rayCount, 4, triangleDistances.data());
+	const std::chrono::duration<double> triangleTime = std::chrono::high_resolution_clock::now() - startTime;
+
+	std::vector<float> scalarDistances(rayCount);
+	startTime = std::chrono::high_resolution_clock::now();
+	for (size_t i = 0; i < rayCount; ++i)
+	{
+		if (!AnalyticPrimitives::Intersect(primitive, &rays[i * 6], &rays[i * 6 + 3], 0.0f, FLT_MAX, scalarDistances[i])) {
+			scalarDistances[i] = FLT_MAX;
+		}
+	}
+	const std::chrono::duration<double> scalarTime = std::chrono::high_resolution_clock::now() - startTime;
+
+	std::vector<float> packetDistances(rayCount, FLT_MAX);
+	std::vector<AnalyticPrimitives::RayPacket> packets(rayCount / 4);
+	for (size_t i = 0; i < rayCount; ++i)
+	{
+		AnalyticPrimitives::RayPacket& packet = packets[i / 4];
+		const float* ray = &rays[i * 6];
+		packet.originX[i % 4] = ray[0];
+		packet.originY[i % 4] = ray[1];
+		packet.originZ[i % 4] = ray[2];
+		packet.directionX[i % 4] = ray[3];
+		packet.directionY[i % 4] = ray[4];
+		packet.directionZ[i % 4] = ray[5];
+	}
+	startTime = std::chrono::high_resolution_clock::now();
+	for (size_t i = 0; i < packets.size(); ++i)
+	{
+		AnalyticPrimitives::Intersect4(primitive, packets[i], 0.0f, &packetDistances[i * 4]);
+	}
+	const std::chrono::duration<double> packetTime = std::chrono::high_resolution_clock::now() - startTime;
+
+	// Tessellation makes triangles cut inside of curved surfaces, distance difference is relative to the radius
+	size_t triangleHits = 0;
+	size_t analyticHits = 0;
+	size_t bothHits = 0;
+	size_t packetMismatches = 0;
+	double distanceDifference = 0.0;
+	for (size_t i = 0; i < rayCount; ++i)
+	{
+		const bool triangleHit = triangleDistances[i] < FLT_MAX;
+		const bool analyticHit = packetDistances[i] < FLT_MAX;
+		packetMismatches += analyticHit != (scalarDistances[i] < FLT_MAX) ? 1 : 0;
+		triangleHits += triangleHit ? 1 : 0;
+		analyticHits += analyticHit ? 1 : 0;
+		if (triangleHit && analyticHit)
+		{
+			++bothHits;
+			const float directionLength = std::sqrt(rays[i * 6 + 3] * rays[i * 6 + 3] + rays[i * 6 + 4] * rays[i * 6 + 4] + rays[i * 6 + 5] * rays[i * 6 + 5]);
+			distanceDifference += std::fabs(triangleDistances[i] - packetDistances[i]) * directionLength / radius;
+		}
+	}
+
+	const size_t triangleBytes = sizeof(VertexBufferStruct) * vertexCount + sizeof(UINT32) * indices.size();
+	LogDebugRTCP("ModelClass: analytic %s benchmark - %zu rays, triangles %.1f Mrays/s (%zu triangles, %zu BVH nodes, %.1f KB of geometry), analytic %.1f Mrays/s, SSE %.1f Mrays/s (%zu B with AABB)\n", typeName, rayCount,
+		rayCount / triangleTime.count() * 1e-6, indices.size() / 3, nodeCount, triangleBytes / 1024.0, rayCount / scalarTime.count() * 1e-6, rayCount / packetTime.count() * 1e-6, sizeof(AnalyticPrimitives::Primitive) + sizeof(AnalyticPrimitives::Bounds));
+	LogDebugRTCP("ModelClass: analytic %s benchmark - %zu triangle hits, %zu analytic hits, %zu both, mean distance difference %.4f of radius, %zu SSE hits differ from scalar\n", typeName,
+		triangleHits, analyticHits, bothHits, bothHits > 0 ? distanceDifference / bothHits : 0.0, packetMismatches);
+}
+
+void ModelClass::GenerateMeshLods(const MeshRange& range, std::vector<LodRange>& lods, std::vector<UINT32>& lodIndices) const
+{
+	if (range.indexCount == 0) {
+		return;
+	}
+
+	// Simplifier works on mesh local indices, LOD index offsets are relative to lodIndices
+	const float* positions = &m_vertices[range.vertexOffset].position.x;
+	std::vector<UINT32> source(m_indices.begin() + range.indexOffset, m_indices.begin() + range.indexOffset + range.indexCount);
+	for (UINT32& index : source)
+	{
+		index -= range.vertexOffset;
+	}
+#ifndef NDEBUG
+	const size_t nonManifoldEdges = MeshSimplifier::CountNonManifoldEdges(source.data(), source.size(), positions, range.vertexCount, sizeof(VertexBufferStruct));
+#endif
+
+	// Every level is simplified from the previous one, so error accumulates over the chain
+	std::vector<UINT32> destination(source.size());
+	float accumulatedError = 0.0f;
+	for (const float ratio : m_loadSettings.lodTargetRatios)
+	{
+		const size_t targetIndexCount = static_cast<size_t>(range.indexCount / 3 * ratio) * 3;
+		const float errorBudget = m_loadSettings.lodTargetError - accumulatedError;
+		if (targetIndexCount >= source.size() || errorBudget <= 0.0f) {
+			break;
+		}
+
+		float error = 0.0f;
+		const size_t indexCount = MeshSimplifier::Simplify(destination.data(), source.data(), source.size(), positions, range.vertexCount, sizeof(VertexBufferStruct),
+			targetIndexCount, errorBudget, &error);
+		if (indexCount == 0 || indexCount > source.size() * (1.0f - LOD_MIN_REDUCTION)) {
+			break;
+		}
+		MeshOptimizer::OptimizeVertexCache(destination.data(), indexCount, range.vertexCount);
+		assert(MeshSimplifier::CountNonManifoldEdges(destination.data(), indexCount, positions, range.vertexCount, sizeof(VertexBufferStruct)) <= nonManifoldEdges && "Simplification created non-manifold edges");
+
+		accumulatedError += error;
+		lods.push_back({ static_cast<UINT32>(lodIndices.size()), static_cast<UINT32>(indexCount), accumulatedError });
+		for (size_t i = 0; i < indexCount; ++i)
+		{
+			assert(destination[i] < range.vertexCount && "LOD references vertex outside of its mesh");
+			lodIndices.push_back(destination[i] + range.vertexOffset);
+		}
+		source.assign(destination.begin(), destination.begin() + indexCount);
+	}
+}
+
+void ModelClass::BuildMeshlets()
+{
+	m_meshlets.clear();
+	if (!m_loadSettings.buildMeshlets) {
+		return;
+	}
+
+	m_meshlets.resize(m_meshRanges.size());
+	// Meshlets of progressively loaded meshes are built when their chunk is published
+	if (m_loadSettings.progressiveLoading) {
+		return;
+	}
+
+	const auto startTime = std::chrono::high_resolution_clock::now();
+	const unsigned int threadCount = m_loadSettings.importThreadCount > 0 ? m_loadSettings.importThreadCount : ThreadPool::GetDefaultThreadCount();
+	ThreadPool threadPool{ threadCount };
+	threadPool.ParallelFor(m_meshRanges.size(), [this](size_t i) {
+		m_meshlets[i] = BuildMeshMeshlets(i);
+	});
+	const std::chrono::duration<double, std::milli> buildTime = std::chrono::high_resolution_clock::now() - startTime;
+
+	size_t meshletCount = 0;
+	for (const MeshletData& meshlets : m_meshlets)
+	{
+		meshletCount += meshlets.meshlets.size();
+	}
+	LogDebugRTCP("ModelClass: built %zu meshlets (max %zu vertices, %zu triangles) on %u threads in %.2f ms\n", meshletCount,
+		MeshletBuilder::DEFAULT_MAX_VERTICES, MeshletBuilder::DEFAULT_MAX_TRIANGLES, threadCount, buildTime.count());
+
+	if (m_loadSettings.benchmarkImport) {
+		BenchmarkMeshlets();
+	}
+}
+
+MeshletData ModelClass::BuildMeshMeshlets(size_t meshIndex) const
+{
+	// Meshlet builder expects mesh local indices
+	const Mesh mesh = GetMesh(meshIndex);
+	if (mesh.indices.empty()) {
+		return {};
+	}
+	std::vector<UINT32> indices(mesh.indices.begin(), mesh.indices.end());
+	for (UINT32& index : indices)
+	{
+		index -= mesh.baseVertex;
+	}
+	return MeshletBuilder::Build(indices.data(), indices.size(), &mesh.vertices.data()->position.x, mesh.vertices.size(), sizeof(VertexBufferStruct));
+}
+
+void ModelClass::BenchmarkMeshlets() const
+{
+	// Single core build of all meshes
+	const auto buildStartTime = std::chrono::high_resolution_clock::now();
+	size_t meshletCount = 0;
+	for (size_t i = 0; i < m_meshRanges.size(); ++i)
+	{
+		meshletCount += BuildMeshMeshlets(i).meshlets.size();
+	}
+	const std::chrono::duration<double, std::milli> buildTime = std::chrono::high_resolution_clock::now() - buildStartTime;
+	LogDebugRTCP("ModelClass: meshlet benchmark - build of %zu meshlets on single core: %.2f ms\n", meshletCount, buildTime.count());
+
+	// Culling throughput - cameras placed around model, looking at random points inside of it
+	const ArrayView<VertexBufferStruct> vertices = GetVertices();
+	if (vertices.empty()) {
+		return;
+	}
+	BoundingBox bounds;
+	BoundingBox::CreateFromPoints(bounds, vertices.size(), &vertices.data()->position, sizeof(VertexBufferStruct));
+
+	constexpr int VIEW_COUNT = 64;
+	std::vector<MeshletCulling::Frustum> frustums(VIEW_COUNT);
+	std::vector<XMFLOAT3> cameraPositions(VIEW_COUNT);
+	std::mt19937 generator{ 0 };
+	std::uniform_real_distribution<float> distribution{ -1.0f, 1.0f };
+	const XMVECTOR center = XMLoadFloat3(&bounds.Center);
+	const XMVECTOR extents = XMLoadFloat3(&bounds.Extents);
+	for (int i = 0; i < VIEW_COUNT; ++i)
+	{
+		const XMVECTOR eye = XMVectorMultiplyAdd(XMVectorSet(distribution(generator), distribution(generator), distribution(generator), 0.0f), extents, center);
+		const XMVECTOR target = XMVectorMultiplyAdd(XMVectorSet(distribution(generator), distribution(generator), distribution(generator), 0.0f), extents, center);
+		const XMMATRIX viewProjection = XMMatrixLookAtLH(eye, target, XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)) * XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, 1.0f, 20000.0f);
+		XMFLOAT4X4 matrix;
+		XMStoreFloat4x4(&matrix, viewProjection);
+		frustums[i] = MeshletCulling::ExtractFrustum(&matrix.m[0][0]);
+		XMStoreFloat3(&cameraPositions[i], eye);
+	}
+
+	std::vector<UINT32> visibleMeshlets;
+	MeshletCulling::Statistics statistics;
+	size_t visibleCount = 0;
+	const auto cullStartTime = std::chrono::high_resolution_clock::now();
+	for (int view = 0; view < VIEW_COUNT; ++view)
+	{
+		for (const MeshletData& meshlets : m_meshlets)
+		{
+			visibleMeshlets.resize(meshlets.bounds.size());
+			visibleCount += MeshletCulling::Cull(meshlets.bounds.data(), meshlets.bounds.size(), frustums[view], &cameraPositions[view].x, visibleMeshlets.data(), &statistics);
+		}
+	}
+	const std::chrono::duration<double> cullTime = std::chrono::high_resolution_clock::now() - cullStartTime;
+	LogDebugRTCP("ModelClass: meshlet benchmark - culling on single core: %.1f M meshlets/s, %zu views, %.1f%% visible, %.1f%% frustum culled, %.1f%% backface culled\n",
+		statistics.tested / std::max(cullTime.count(), 1e-9) / 1e6, static_cast<size_t>(VIEW_COUNT),
+		statistics.tested > 0 ? 100.0 * visibleCount / statistics.tested : 0.0,
+		statistics.tested > 0 ? 100.0 * statistics.frustumCulled / statistics.tested : 0.0,
+		statistics.tested > 0 ? 100.0 * statistics.backfaceCulled / statistics.tested : 0.0);
+}
+
+std::string ModelClass::DetermineTextureType(const aiScene* scene, aiMaterial* mat)
+{
+	aiString texTypeString;
+	mat->GetTexture(aiTextureType_DIFFUSE, 0, &texTypeString);
+	std::string texTypeTestStr = texTypeString.C_Str();
+	if (texTypeTestStr == "*0" || texTypeTestStr == "*1" || texTypeTestStr == "*2" || texTypeTestStr == "*3" || texTypeTestStr == "*4" || texTypeTestStr == "*5") {
+		if (scene->mTextures[0]->mHeight == 0) {
+			return "embedded compressed texture";
+		}
+		else {
+			return "embedded non-compressed texture";
+		}
+	}
+	if (texTypeTestStr.find('.') != std::string::npos) {
+		return "textures are on disk";
+	}
+
+	return ".";
+}
+
+std::vector<ModelClass::Texture> ModelClass::LoadMaterialTextures(ComPtr<ID3D12Resource>& resource, TextureMap& texturesRef, const std::unordered_map<std::string, int>& owners, aiMaterial* mat, std::string texType, aiTextureType type, std::string typeName, const aiScene* scene, ComPtr<ID3D12Device2> device, ComPtr<ID3D12GraphicsCommandList4> commandList, int index, bool forceDDS /* = false */)
+{
+	std::vector<Texture> textures;
+
+	for (UINT i = 0; i < mat->GetTextureCount(type); ++i)
+	{
+		aiString str;
+		mat->GetTexture(type, i, &str);
+
+		// Texture is loaded only by first mesh referencing it, other meshes just use its ID
+		const auto owner = owners.find(str.C_Str());
+		assert(owner != owners.end() && "Texture owners have to be found before processing meshes");
+		if (owner->second != index) {
+			Texture texture;
+			texture.textureID = owner->second;
+			texture.type = typeName;
+			texture.path = str.C_Str();
+			textures.push_back(texture);
+			continue;
+		}
+
+		if (texType == "embedded compressed texture") {
+			// Check if texture was registered before and if so, skip registering it again
+			std::lock_guard<std::mutex> lock{ m_textureMutex };
+			const Texture* loadedTexture = FindLoadedTexture(texturesRef, str.C_Str());
+			if (loadedTexture) {
+				textures.push_back(*loadedTexture);
+				continue;
+			}
+
+			//int textureindex = GetTextureIndex(&str);
+			//texture.resource = GetTextureFromModel(scene, textureindex, device, commandList);
+			Texture texture;
+			texture.textureID = index;
+			texture.type = typeName;
+			texture.path = str.C_Str();
+			textures.push_back(texture);
+			texturesRef.emplace(texture.path, texture);
+			continue;
+		}
+		textures.push_back(LoadTexture(resource, texturesRef, str.C_Str(), typeName, scene, device, commandList, index, forceDDS));
+	}
+
+	return textures;
+}
+
+ModelClass::Texture ModelClass::LoadTexture(ComPtr<ID3D12Resource>& resource, TextureMap& texturesRef, const std::string& path, std::string typeName, const aiScene* scene, ComPtr<ID3D12Device2> device, ComPtr<ID3D12GraphicsCommandList4> commandList, int index, bool forceDDS /* = false */)
+{
+	// Check if texture was loaded before by this model and if so, mesh just uses its ID
+	{
+		std::lock_guard<std::mutex> lock{ m_textureMutex };
+		const Texture* loadedTexture = FindLoadedTexture(texturesRef, path);
+		if (loadedTexture) {
+			return *loadedTexture;
+		}
+	}
+
+	// Compressed DDS with mip chain is loaded in place of the source, texture keeps source path
+	std::string loadPath = path;
+	bool loadDDS = forceDDS;
+	if (m_loadSettings.preferCompressedTextures)
+	{
+		const std::string compressedPath = TextureCompressor::GetCompressedPath(path);
+		if (TextureCompressor::IsUpToDate(path, compressedPath)) {
+			loadPath = compressedPath;
+			loadDDS = true;
+		}
+	}
+
+	// Texture registry decodes file only if no model loaded the same path or content before.
+	// Upload is recorded to command list of the model which decoded it first, so it has to be executed before any model using the texture.
+	TextureRegistry::Handle handle = TextureRegistry::Get().Acquire(loadPath, [&]() {
+		// Textures used by larger meshes are decoded first
+		if (m_textureStreamer) {
+			return StreamTexture(loadPath, typeName, static_cast<float>(m_meshRanges[index].indexCount), device, commandList, loadDDS);
+		}
+		ComPtr<ID3D12Resource> loaded;
+		GetTextureFromModel(loaded, scene, loadPath, device, commandList, index, loadDDS);
+		return loaded;
+	});
+	resource = handle.GetResource();
+
+	Texture texture;
+	texture.resource = resource;
+	texture.subresourceData = {};
+	texture.textureID = index;
+	texture.type = typeName;
+	texture.path = path;
+	{
+		std::lock_guard<std::mutex> lock{ m_textureMutex };
+		texturesRef.emplace(path, texture);
+		m_textureHandles.push_back(std::move(handle));
+
+		// Progressively loaded model is rendered before streamed data arrives - slot binds placeholder until upload of the texture is recorded
+		if (m_loadSettings.progressiveLoading && IsStreamingTexture(resource.Get()))
+		{
+			m_pendingTextureSlots[resource.Get()].push_back({ &GetTextureSlots(typeName), static_cast<size_t>(index) });
+			resource = GetPlaceholderTexture(typeName, device, commandList);
+		}
+	}
+
+	return texture;
+}
+
+const ModelClass::Texture* ModelClass::FindLoadedTexture(const TextureMap& texturesRef, const std::string& path) const
+{
+	const auto it = texturesRef.find(path);
+	return it != texturesRef.end() ? &it->second : nullptr;
+}
+
+ComPtr<ID3D12Resource> ModelClass::StreamTexture(const std::string& path, const std::string& typeName, float priority, ComPtr<ID3D12Device2> device, ComPtr<ID3D12GraphicsCommandList4> commandList, bool forceDDS)
+{
+	// Resource is created from file header right away, so slots of completely loaded model don't change when data arrives
+	DirectX::TexMetadata metadata;
+	if (!TextureStreamer::GetMetadata(path, forceDDS, metadata))
+	{
+		// Unreadable file gets 1x1 placeholder
+		LogDebugRTCP("ModelClass: failed to read texture %s, using placeholder\n", path.c_str());
+		std::lock_guard<std::mutex> lock{ m_textureMutex };
+		return GetPlaceholderTexture(typeName, device, commandList);
+	}
+
+	// Texture isn't bound before its upload is recorded - progressively loaded model binds placeholder until then
+	ComPtr<ID3D12Resource> texture = TextureStreamer::CreateTexture(device.Get(), metadata);
+	std::lock_guard<std::mutex> lock{ m_textureMutex };
+	m_streamingTextures.emplace(m_textureStreamer->Enqueue({ path, priority, forceDDS }), texture);
+	++m_streamedTextureCount;
+	return texture;
+}
+
+void ModelClass::FinishTextureStreaming(ComPtr<ID3D12Device2> device, ComPtr<ID3D12GraphicsCommandList4> commandList)
+{
+	if (!m_textureStreamer) {
+		return;
+	}
+
+	// Decoding overlapped with geometry processing, only the remaining decodes are waited for here
+	const auto startTime = std::chrono::high_resolution_clock::now();
+	TextureStreamer::Completion completion;
+	while (m_textureStreamer->WaitCompletion(completion))
+	{
+		UploadStreamedTexture(completion, device, commandList);
+	}
+	const std::chrono::duration<double, std::milli> waitTime = std::chrono::high_resolution_clock::now() - startTime;
+	LogDebugRTCP("ModelClass: streamed %zu textures on %u workers - %.2f ms of decoding, %.2f ms waited at the end of load\n", m_streamedTextureCount,
+		m_textureStreamer->GetWorkerCount(), m_streamedDecodeTime, waitTime.count());
+	m_textureStreamer.reset();
+	m_streamedTextureCount = 0;
+	m_streamedDecodeTime = 0.0;
+
+	if (m_loadSettings.benchmarkImport)
+	{
+		std::vector<std::string> paths;
+		for (const TextureMap* textures : { &m_diffuseTextures, &m_specularTextures, &m_normalTextures })
+		{
+			for (const auto& texture : *textures)
+			{
+				paths.push_back(texture.first);
+			}
+		}
+		TextureStreamer::BenchmarkDecode(paths, ThreadPool::GetDefaultThreadCount());
+	}
+}
+
+void ModelClass::UploadStreamedTexture(TextureStreamer::Completion& completion, ComPtr<ID3D12Device2> device, ComPtr<ID3D12GraphicsCommandList4> commandList)
+{
+	const auto it = m_streamingTextures.find(completion.id);
+	assert(it != m_streamingTextures.end() && "Completed texture wasn't requested by this model");
+	m_streamedDecodeTime += completion.decodeTime;
+
+	// Header was readable but data isn't - texture is cleared instead of left uninitialized
+	std::unique_ptr<DirectX::ScratchImage> image = std::move(completion.image);
+	if (!image)
+	{
+		LogDebugRTCP("ModelClass: failed to decode texture %s\n", completion.path.c_str());
+		const D3D12_RESOURCE_DESC desc = it->second->GetDesc();
+		image = std::make_unique<DirectX::ScratchImage>();
+		ThrowIfFailed(image->Initialize2D(desc.Format, static_cast<size_t>(desc.Width), desc.Height, 1, desc.MipLevels));
+		memset(image->GetPixels(), 0, image->GetPixelsSize());
+	}
+
+	ComPtr<ID3D12Resource> uploadHeap;
+	TextureStreamer::RecordUpload(device.Get(), commandList.Get(), it->second.Get(), *image, uploadHeap);
+	m_uploadHeaps.push_back(uploadHeap);
+
+	// Upload is recorded in the middle of frame, texture has to be readable by the rest of it
+	if (m_loadSettings.progressiveLoading) {
+		commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(it->second.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE));
+	}
+
+	// Slots bound to placeholder so far are bound to the uploaded texture from now on
+	const auto pending = m_pendingTextureSlots.find(it->second.Get());
+	if (pending != m_pendingTextureSlots.end())
+	{
+		for (const PendingTextureSlot& slot : pending->second)
+		{
+			(*slot.slots)[slot.index] = it->second;
+		}
+		m_pendingTextureSlots.erase(pending);
+		++m_textureGeneration;
+	}
+	m_streamingTextures.erase(it);
+}
+
+bool ModelClass::IsStreamingTexture(const ID3D12Resource* texture) const
+{
+	for (const auto& streaming : m_streamingTextures)
+	{
+		if (streaming.second.Get() == texture) {
+			return true;
+		}
+	}
+	return false;
+}
+
+ComPtr<ID3D12Resource> ModelClass::GetPlaceholderTexture(const std::string& typeName, ComPtr<ID3D12Device2> device, ComPtr<ID3D12GraphicsCommandList4> commandList)
+{
+	// White for color textures, flat tangent space normal for normal maps
+	const UINT32 placeholderColor = typeName == "texture_normal" ? 0xFFFF8080 : 0xFFFFFFFF;
+	ComPtr<ID3D12Resource>& placeholder = m_placeholderTextures[placeholderColor];
+	if (!placeholder)
+	{
+		ComPtr<ID3D12Resource> uploadHeap;
+		placeholder = TextureStreamer::CreatePlaceholder(device.Get(), commandList.Get(), placeholderColor, uploadHeap);
+		m_uploadHeaps.push_back(uploadHeap);
+		// Sampled by every frame until streamed textures replace it
+		commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(placeholder.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE));
+	}
+	return placeholder;
+}
+
+std::vector<ComPtr<ID3D12Resource>>& ModelClass::GetTextureSlots(const std::string& typeName)
+{
+	if (typeName == "texture_normal") {
+		return m_normalTexturesResources;
+	}
+	return typeName == "texture_specRoughness" ? m_specularTexturesResources : m_diffuseTexturesResources;
+}
+
+void ModelClass::LogTextureStatistics() const
+{
+	// Registry statistics are cumulative over all models loaded so far
+	const TextureRegistry::Statistics statistics = TextureRegistry::Get().GetStatistics();
+	const UINT64 hits = statistics.pathHits + statistics.contentHits;
+	LogDebugRTCP("ModelClass: texture registry - %llu requests, %llu path hits, %llu content hits (hit rate %.1f%%), %llu decodes, %llu files hashed\n", statistics.requests,
+		statistics.pathHits, statistics.contentHits, statistics.requests > 0 ? 100.0 * hits / statistics.requests : 0.0, statistics.decodes, statistics.hashedFiles);
+	LogDebugRTCP("ModelClass: texture registry - %zu textures registered, %.1f MB decoded, %.1f MB saved by sharing\n", statistics.textureCount,
+		statistics.decodedBytes / (1024.0 * 1024.0), statistics.savedBytes / (1024.0 * 1024.0));
+}
+
+void ModelClass::LoadCachedTextures(const MeshTexturePaths& paths, ComPtr<ID3D12Device2> device, ComPtr<ID3D12GraphicsCommandList4> commandList, int index)
+{
+	// Mirrors texture slots created by ProcessMesh, one slot per mesh
+	m_diffuseTexturesResources.push_back({});
+	if (!paths.albedo.empty()) {
+		LoadTexture(m_diffuseTexturesResources[index], m_diffuseTextures, paths.albedo, "texture_diffuse", nullptr, device, commandList, index);
+	}
+
+	m_specularTexturesResources.push_back({});
+	if (!paths.specular.empty()) {
+		LoadTexture(m_specularTexturesResources[index], m_specularTextures, paths.specular, "texture_specRoughness", nullptr, device, commandList, index);
+	}
+
+	m_normalTexturesResources.push_back({});
+	if (!paths.normal.empty()) {
+		LoadTexture(m_normalTexturesResources[index], m_normalTextures, paths.normal, "texture_normal", nullptr, device, commandList, index, true);
+	}
+}
+
+int ModelClass::GetTextureIndex(aiString* str)
+{
+	std::string tistr;
+	tistr = str->C_Str();
+	tistr = tistr.substr(1);
+	return stoi(tistr);
+}
+
+std::pair<ComPtr<ID3D12Resource>, D3D12_SUBRESOURCE_DATA> ModelClass::GetTextureFromModel(ComPtr<ID3D12Resource>& resource, const aiScene* scene, std::string filename, ComPtr<ID3D12Device2> device, ComPtr<ID3D12GraphicsCommandList4> commandList, int index, bool forceDDS /* = false */)
+{
+	std::vector<D3D12_SUBRESOURCE_DATA> textureData;
+	D3D12_SUBRESOURCE_DATA textureDataSingle = {};
+	std::unique_ptr<uint8_t[]> decodedData;
+	ComPtr<ID3D12Resource> texture;
+	ComPtr<ID3D12Resource> uploadHeap;
+
+	std::string s = std::regex_replace(filename, std::regex("\\\\"), "/");
+
+	// Portable decoder writes straight into upload heap, DirectXTK loaders are left for files it doesn't support
+	texture = TextureStreamer::DecodeToUploadHeap(device.Get(), s, uploadHeap);
+	const bool decodedToUploadHeap = texture != nullptr;
+	if (!decodedToUploadHeap)
+	{
+		std::wstring ws(s.begin(), s.end());
+		if (forceDDS) {
+			ThrowIfFailed(LoadDDSTextureFromFileEx(device.Get(), ws.c_str(), 0, D3D12_RESOURCE_FLAG_NONE, DDS_LOADER_DEFAULT, texture.ReleaseAndGetAddressOf(), decodedData, textureData));
+			textureDataSingle = textureData[0];
+		}
+		else {
+			ThrowIfFailed(LoadWICTextureFromFileEx(device.Get(), ws.c_str(), 0, D3D12_RESOURCE_FLAG_NONE, WIC_LOADER_DEFAULT, texture.ReleaseAndGetAddressOf(), decodedData, textureDataSingle));
+			textureData.push_back(textureDataSingle);
+		}
+	}
+
+	// Whole mip chain is uploaded - compressed DDS textures carry it, other files have single mip
+	const UINT16 mipLevels = texture->GetDesc().MipLevels;
+	//auto desc = texture->GetDesc();
+
+	// uploadHeap must outlive this function - until command list is closed
+	if (!decodedToUploadHeap) {
+		ThrowIfFailed(device->CreateCommittedResource(
+			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+			D3D12_HEAP_FLAG_NONE,
+			&CD3DX12_RESOURCE_DESC::Buffer(GetRequiredIntermediateSize(texture.Get(), 0, mipLevels)),
+			D3D12_RESOURCE_STATE_GENERIC_READ,
+			nullptr,
+			IID_PPV_ARGS(&uploadHeap)
+		));
+	}
+
+	// Decoding and resource creation above are free-threaded, command list recording is not
+	std::lock_guard<std::mutex> lock{ m_textureMutex };
+	m_uploadHeaps.push_back(uploadHeap);
+	if (decodedToUploadHeap) {
+		TextureStreamer::RecordCopy(device.Get(), commandList.Get(), texture.Get(), uploadHeap.Get());
+	}
+	else {
+		UpdateSubresources(commandList.Get(), texture.Get(), uploadHeap.Get(), 0, 0, mipLevels, textureData.data());
+	}
+	//commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_texture.Get(), D3D12_RESOURCE_STATE_COPY_DEST, InitialResourceState));
+
+	//if (textureDataSingle.SlicePitch == 128 * 128 * 4)
+	//if (texture->GetDesc().Width == 128 && texture->GetDesc().Height == 128)
+	{
+		commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(texture.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_COPY_SOURCE));
+
+		D3D12_RESOURCE_DESC textureDesc = {};
+		textureDesc.MipLevels = mipLevels;
+/*		if (texture->GetDesc().Format == DXGI_FORMAT_BC1_UNORM  || texture->GetDesc().Format == DXGI_FORMAT_BC1_TYPELESS) {
+			textureDesc.Format = DXGI_FORMAT_R16G16B16A16_FLOAT;
+		}
+		else if (texture->GetDesc().Format == DXGI_FORMAT_BC3_UNORM || texture->GetDesc().Format == DXGI_FORMAT_BC3_TYPELESS || texture->GetDesc().Format == DXGI_FORMAT_BC5_UNORM) {
+			textureDesc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+		}
+		else */{
+			textureDesc.Format = texture->GetDesc().Format; /*DXGI_FORMAT_R8G8B8A8_UNORM*/;
+		}
+		textureDesc.Width = texture->GetDesc().Width;
+		textureDesc.Height = texture->GetDesc().Height;
+		textureDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+		textureDesc.DepthOrArraySize = 1;
+		textureDesc.SampleDesc.Count = 1;
+		textureDesc.SampleDesc.Quality = 0;
+		textureDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+
+		ThrowIfFailed(device->CreateCommittedResource(
+			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+			D3D12_HEAP_FLAG_NONE,
+			&textureDesc,
+			D3D12_RESOURCE_STATE_COPY_DEST,
+			nullptr,
+			IID_PPV_ARGS(&resource)
+		));
+
+		for (UINT mip = 0; mip < mipLevels; ++mip)
+		{
+			D3D12_TEXTURE_COPY_LOCATION dst = CD3DX12_TEXTURE_COPY_LOCATION(resource.Get(), mip);
+			D3D12_TEXTURE_COPY_LOCATION src = CD3DX12_TEXTURE_COPY_LOCATION(texture.Get(), mip);
+			commandList->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+		}
+	}
+
+	return { texture, textureDataSingle };
+}
+
+bool ModelClass::CreateRectangle(ComPtr<ID3D12Device2> device, float left, float right, float top, float bottom)
+{
+	constexpr size_t verticesCount = 6;
+
+	m_meshCache.reset();
+	m_sceneNodes.clear();
+	m_nodeMeshes.clear();
+	m_materials.clear();
+	m_positions.clear();
+	m_cpuResidency = CpuResidency::Full;
+	m_vertices.assign(verticesCount, VertexBufferStruct{});
+	m_indices.resize(verticesCount);
+	m_meshRanges = { { 0, static_cast<UINT32>(verticesCount), 0, static_cast<UINT32>(verticesCount) } };
+	for (size_t i = 0; i < verticesCount; ++i)
+	{
+		m_indices[i] = static_cast<UINT32>(i);
+	}
+
+	//First triangle
+	m_vertices[0].position = XMFLOAT3(left, top, 0.0f);  // Top left.	
+	m_vertices[1].position = XMFLOAT3(right, bottom, 0.0f);  // Bottom right.
+	m_vertices[2].position = XMFLOAT3(left, bottom, 0.0f);  // Bottom left.
+	//Second triangle
+	m_vertices[3].position = XMFLOAT3(left, top, 0.0f);  // Top left.
+	m_vertices[4].position = XMFLOAT3(right, top, 0.0f);  // Top right.
+	m_vertices[5].position = XMFLOAT3(right, bottom, 0.0f);  // Bottom right.
+
+	m_vertices[0].normal = XMFLOAT3(0.0f, 0.0f, -1.0f);
+	m_vertices[1].normal = XMFLOAT3(0.0f, 0.0f, -1.0f);
+	m_vertices[2].normal = XMFLOAT3(0.0f, 0.0f, -1.0f);
+	m_vertices[3].normal = XMFLOAT3(0.0f, 0.0f, -1.0f);
+	m_vertices[4].normal = XMFLOAT3(0.0f, 0.0f, -1.0f);
+	m_vertices[5].normal = XMFLOAT3(0.0f, 0.0f, -1.0f);
+
+	//Set UV values
+	{
+		//First triangle	
+		m_vertices[0].uv = XMFLOAT2(0.0, 0.0);  // Top left.	
+		m_vertices[1].uv = XMFLOAT2(1.0, 1.0);  // Bottom right.
+		m_vertices[2].uv = XMFLOAT2(0.0, 1.0);  // Bottom left.
+		//Second triangle
+		m_vertices[3].uv = XMFLOAT2(0.0, 0.0);  // Top left.
+		m_vertices[4].uv = XMFLOAT2(1.0, 0.0);  // Top right.
+		m_vertices[5].uv = XMFLOAT2(1.0, 1.0);  // Bottom right.
+	}
+
+	return true;
+}
+
+bool ModelClass::PrepareBuffers(ComPtr<ID3D12Device2> device, DXGI_FORMAT indexFormat)
+{
+	// Model is already stored contiguously, buffers are filled straight from the store
+	const ArrayView<VertexBufferStruct> vertices = GetVertices();
+	const ArrayView<UINT32> indices = GetIndices();
+	const bool progressive = m_loadSettings.progressiveLoading && !m_meshRanges.empty();
+	if (!PrepareBuffers(device, indexFormat, vertices.data(), vertices.size(), progressive ? nullptr : indices.data(), indices.size())) {
+		return false;
+	}
+
+	// Progressively loaded model starts with no mesh published, otherwise every mesh is available right away
+	++m_loadGeneration;
+	m_loadComplete = !progressive;
+	if (progressive)
+	{
+		m_meshLoadOrder = ComputeMeshLoadOrder();
+		m_loadedMeshCount = 0;
+		if (m_loadSettings.benchmarkImport) {
+			BenchmarkProgressiveLoad();
+		}
+	}
+	else
+	{
+		m_meshLoadOrder.resize(m_meshRanges.size());
+		std::iota(m_meshLoadOrder.begin(), m_meshLoadOrder.end(), 0);
+		m_loadedMeshCount = m_meshRanges.size();
+	}
+	if (m_loadSettings.benchmarkImport) {
+		BenchmarkVertexStreams();
+	}
+
+	if (!PrepareMaterialBuffers(device)) {
+		return false;
+	}
+
+	m_compactIndexBuffer.Reset();
+	m_compactIndexRanges.clear();
+	if (m_loadSettings.compactIndices && !m_meshRanges.empty()) {
+		return PrepareCompactIndexBuffer(device);
+	}
+	return true;
+}
+
+ModelClass::Mesh ModelClass::GetMesh(size_t index) const
+{
+	// Geometry released by CPU residency policy is returned as empty views
+	const MeshRange& range = m_meshRanges.at(index);
+	const ArrayView<VertexBufferStruct> vertices = GetVertices();
+	const ArrayView<UINT32> indices = GetIndices();
+	return { vertices.empty() ? ArrayView<VertexBufferStruct>{} : vertices.subview(range.vertexOffset, range.vertexCount),
+		indices.empty() ? ArrayView<UINT32>{} : indices.subview(range.indexOffset, range.indexCount), range.vertexOffset };
+}
+
+size_t ModelClass::GetMeshLodCount(size_t meshIndex) const
+{
+	assert(meshIndex < m_meshRanges.size());
+	return m_meshLodOffsets.empty() ? 1 : 1 + m_meshLodOffsets[meshIndex + 1] - m_meshLodOffsets[meshIndex];
+}
+
+ModelClass::MeshLod ModelClass::GetMeshLod(size_t meshIndex, size_t lod) const
+{
+	assert(lod < GetMeshLodCount(meshIndex));
+	if (lod == 0) {
+		return { GetMesh(meshIndex).indices, 0.0f };
+	}
+
+	// LOD indices are mapped from mesh cache if model was loaded from it
+	const LodRange& range = m_lodRanges[m_meshLodOffsets[meshIndex] + lod - 1];
+	const ArrayView<UINT32> lodIndices = m_meshCache ? ArrayView<UINT32>{ m_meshCache->GetLodIndices(), m_meshCache->GetLodIndexCount() } : ArrayView<UINT32>{ m_lodIndices };
+	return { lodIndices.subview(range.indexOffset, range.indexCount), range.error };
+}
+
+std::vector<ModelClass::MeshInstance> ModelClass::GetMeshInstances() const
+{
+	std::vector<MeshInstance> instances;
+	if (m_sceneNodes.empty())
+	{
+		XMFLOAT4X4 identity;
+		XMStoreFloat4x4(&identity, XMMatrixIdentity());
+		for (size_t i = 0; i < m_meshRanges.size(); ++i)
+		{
+			instances.push_back({ identity, static_cast<UINT32>(i), -1 });
+		}
+		return instances;
+	}
+
+	instances.reserve(m_nodeMeshes.size());
+	for (size_t nodeIndex = 0; nodeIndex < m_sceneNodes.size(); ++nodeIndex)
+	{
+		const SceneNode& node = m_sceneNodes[nodeIndex];
+		for (UINT32 i = node.meshOffset; i < node.meshOffset + node.meshCount; ++i)
+		{
+			instances.push_back({ node.worldTransform, m_nodeMeshes[i], static_cast<INT32>(nodeIndex) });
+		}
+	}
+	return instances;
+}
+
+void ModelClass::FlattenInstances(std::vector<VertexBufferStruct>& vertices, std::vector<UINT32>& indices) const
+{
+	assert(m_cpuResidency == CpuResidency::Full && "Flattening needs every vertex attribute kept on CPU");
+	const std::vector<MeshInstance> instances = GetMeshInstances();
+	size_t vertexCount = 0;
+	size_t indexCount = 0;
+	for (const MeshInstance& instance : instances)
+	{
+		vertexCount += m_meshRanges[instance.meshIndex].vertexCount;
+		indexCount += m_meshRanges[instance.meshIndex].indexCount;
+	}
+	vertices.clear();
+	indices.clear();
+	vertices.reserve(vertexCount);
+	indices.reserve(indexCount);
+
+	for (const MeshInstance& instance : instances)
+	{
+		// Normals use inverse transpose, so non-uniform scale keeps them perpendicular to surface
+		const XMMATRIX world = XMLoadFloat4x4(&instance.transform);
+		const XMMATRIX normalTransform = XMMatrixTranspose(XMMatrixInverse(nullptr, world));
+		const Mesh mesh = GetMesh(instance.meshIndex);
+		const UINT32 baseVertex = static_cast<UINT32>(vertices.size());
+		for (VertexBufferStruct vertex : mesh.vertices)
+		{
+			XMStoreFloat3(&vertex.position, XMVector3TransformCoord(XMLoadFloat3(&vertex.position), world));
+			XMStoreFloat3(&vertex.normal, XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(&vertex.normal), normalTransform)));
+			XMStoreFloat3(&vertex.tangent, XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(&vertex.tangent), world)));
+			XMStoreFloat3(&vertex.binormal, XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(&vertex.binormal), world)));
+			vertices.push_back(vertex);
+		}
+
+		// Mirroring transform flips orientation of triangles - winding is swapped back
+		const bool mirrored = XMVectorGetX(XMMatrixDeterminant(world)) < 0.0f;
+		for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+		{
+			indices.push_back(mesh.indices[i] - mesh.baseVertex + baseVertex);
+			indices.push_back(mesh.indices[mirrored ? i + 2 : i + 1] - mesh.baseVertex + baseVertex);
+			indices.push_back(mesh.indices[mirrored ? i + 1 : i + 2] - mesh.baseVertex + baseVertex);
+		}
+	}
+}
+
+void ModelClass::LogSceneGraphStatistics() const
+{
+	// Flattened representation stores copy of mesh for every instance, instanced one every mesh once plus nodes
+	const std::vector<MeshInstance> instances = GetMeshInstances();
+	std::vector<UINT32> instanceCounts(m_meshRanges.size(), 0);
+	UINT64 flattenedBytes = 0;
+	for (const MeshInstance& instance : instances)
+	{
+		const MeshRange& range = m_meshRanges[instance.meshIndex];
+		flattenedBytes += sizeof(VertexBufferStruct) * range.vertexCount + sizeof(UINT32) * range.indexCount;
+		++instanceCounts[instance.meshIndex];
+	}
+
+	size_t referencedMeshes = 0;
+	size_t repeatedMeshes = 0;
+	UINT64 instancedBytes = sizeof(SceneNode) * m_sceneNodes.size() + sizeof(UINT32) * m_nodeMeshes.size();
+	for (size_t i = 0; i < m_meshRanges.size(); ++i)
+	{
+		if (instanceCounts[i] == 0) {
+			continue;
+		}
+		++referencedMeshes;
+		repeatedMeshes += instanceCounts[i] > 1 ? 1 : 0;
+		instancedBytes += sizeof(VertexBufferStruct) * m_meshRanges[i].vertexCount + sizeof(UINT32) * m_meshRanges[i].indexCount;
+	}
+
+	LogDebugRTCP("ModelClass: scene graph - %zu nodes, %zu instances of %zu meshes (%zu meshes instanced more than once)\n", m_sceneNodes.size(), instances.size(), referencedMeshes, repeatedMeshes);
+	LogDebugRTCP("ModelClass: scene geometry flattened %.2f MB, instanced %.2f MB (%.1f%%)\n", flattenedBytes / (1024.0 * 1024.0), instancedBytes / (1024.0 * 1024.0),
+		flattenedBytes > 0 ? 100.0 * instancedBytes / flattenedBytes : 100.0);
+}
+
+bool ModelClass::UpdateProgressiveLoad(ComPtr<ID3D12Device2> device, ComPtr<ID3D12GraphicsCommandList4> commandList)
+{
+	if (m_loadComplete) {
+		return false;
+	}
+
+	// Textures decoded so far are uploaded, the rest keeps decoding in background
+	if (m_textureStreamer)
+	{
+		TextureStreamer::Completion completion;
+		while (m_textureStreamer->TryPopCompletion(completion))
+		{
+			UploadStreamedTexture(completion, device, commandList);
+		}
+	}
+
+	const size_t meshCount = m_meshLoadOrder.size();
+	const size_t chunkMeshCount = std::max<size_t>(m_loadSettings.progressiveChunkMeshCount, 1);
+	const size_t chunkEnd = std::min(m_loadedMeshCount + chunkMeshCount, meshCount);
+	const bool published = chunkEnd > m_loadedMeshCount;
+	if (published)
+	{
+		const bool firstChunk = m_loadedMeshCount == 0;
+		PublishMeshes(m_loadedMeshCount, chunkEnd);
+		m_loadedMeshCount = chunkEnd;
+		++m_loadGeneration;
+
+		if (firstChunk)
+		{
+			UINT64 publishedIndices = 0;
+			for (size_t i = 0; i < chunkEnd; ++i)
+			{
+				publishedIndices += m_meshRanges[m_meshLoadOrder[i]].indexCount;
+			}
+			const std::chrono::duration<double, std::milli> time = std::chrono::high_resolution_clock::now() - m_loadStartTime;
+			LogDebugRTCP("ModelClass: first chunk of %zu/%zu meshes (%.1f%% of triangles) published %.2f ms after load started\n", chunkEnd, meshCount,
+				100.0 * publishedIndices / std::max<size_t>(GetIndices().size(), 1), time.count());
+		}
+	}
+
+	// Load is complete after the last chunk, once every texture is uploaded
+	if (m_loadedMeshCount == meshCount && (!m_textureStreamer || m_textureStreamer->GetOutstandingCount() == 0))
+	{
+		FinishTextureStreaming(device, commandList);
+		m_loadComplete = true;
+		const std::chrono::duration<double, std::milli> time = std::chrono::high_resolution_clock::now() - m_loadStartTime;
+		LogDebugRTCP("ModelClass: progressive load complete - %zu meshes in %zu chunks, %.2f ms after load started\n", meshCount,
+			(meshCount + chunkMeshCount - 1) / chunkMeshCount, time.count());
+		LogTextureStatistics();
+		ApplyCpuResidency();
+	}
+	return published;
+}
+
+std::vector<UINT32> ModelClass::ComputeMeshLoadOrder() const
+{
+	std::vector<UINT32> order(m_meshRanges.size());
+	std::iota(order.begin(), order.end(), 0);
+	if (m_loadSettings.progressiveOrder == ProgressiveOrder::Size)
+	{
+		std::stable_sort(order.begin(), order.end(), [this](UINT32 a, UINT32 b) { return m_meshRanges[a].indexCount > m_meshRanges[b].indexCount; });
+		return order;
+	}
+
+	// Passes draw meshes untransformed, so distance is measured in mesh space - empty meshes go last
+	std::vector<float> distances(order.size(), FLT_MAX);
+	const XMVECTOR viewPoint = XMLoadFloat3(&m_loadSettings.progressiveViewPoint);
+	for (size_t i = 0; i < order.size(); ++i)
+	{
+		const Mesh mesh = GetMesh(i);
+		if (mesh.vertices.empty()) {
+			continue;
+		}
+		BoundingBox bounds;
+		BoundingBox::CreateFromPoints(bounds, mesh.vertices.size(), &mesh.vertices.data()->position, sizeof(VertexBufferStruct));
+		distances[i] = XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(XMLoadFloat3(&bounds.Center), viewPoint)));
+	}
+	std::stable_sort(order.begin(), order.end(), [&distances](UINT32 a, UINT32 b) { return distances[a] < distances[b]; });
+	return order;
+}
+
+void ModelClass::PublishMeshes(size_t begin, size_t end)
+{
+	const ArrayView<UINT32> indices = GetIndices();
+	for (size_t i = begin; i < end; ++i)
+	{
+		if (m_loadSettings.buildMeshlets) {
+			m_meshlets[m_meshLoadOrder[i]] = BuildMeshMeshlets(m_meshLoadOrder[i]);
+		}
+	}
+
+	// Only ranges of published meshes are written - caller waited for frames reading the buffer, unpublished ranges stay zero (degenerate triangles)
+	UINT8* pIndexDataBegin;
+	CD3DX12_RANGE readRange(0, 0);
+	ThrowIfFailed(m_indexBuffer->Map(0, &readRange, reinterpret_cast<void**>(&pIndexDataBegin)));
+	for (size_t i = begin; i < end; ++i)
+	{
+		const MeshRange& range = m_meshRanges[m_meshLoadOrder[i]];
+		memcpy(pIndexDataBegin + sizeof(UINT32) * range.indexOffset, indices.data() + range.indexOffset, sizeof(UINT32) * range.indexCount);
 	}
+	m_indexBuffer->Unmap(0, nullptr);
+}
+
+void ModelClass::BenchmarkProgressiveLoad() const
+{
+	// Replays CPU work of publishing chunks into scratch indices - upload of textures and BLAS rebuilds are not included
+	const ArrayView<UINT32> indices = GetIndices();
+	const size_t meshCount = m_meshLoadOrder.size();
+	std::vector<UINT32> scratchIndices(indices.size());
+	for (const size_t chunkMeshCount : { static_cast<size_t>(8), static_cast<size_t>(32), static_cast<size_t>(128), meshCount })
+	{
+		const auto startTime = std::chrono::high_resolution_clock::now();
+		std::chrono::duration<double, std::milli> firstChunkTime{ 0.0 };
+		UINT64 firstChunkIndices = 0;
+		for (size_t begin = 0; begin < meshCount; begin += chunkMeshCount)
+		{
+			const size_t end = std::min(begin + chunkMeshCount, meshCount);
+			for (size_t i = begin; i < end; ++i)
+			{
+				const MeshRange& range = m_meshRanges[m_meshLoadOrder[i]];
+				if (m_loadSettings.buildMeshlets) {
+					BuildMeshMeshlets(m_meshLoadOrder[i]);
+				}
+				std::copy(indices.data() + range.indexOffset, indices.data() + range.indexOffset + range.indexCount, scratchIndices.data() + range.indexOffset);
+				if (begin == 0) {
+					firstChunkIndices += range.indexCount;
+				}
+			}
+			if (begin == 0) {
+				firstChunkTime = std::chrono::high_resolution_clock::now() - startTime;
+			}
+		}
+		const std::chrono::duration<double, std::milli> completeTime = std::chrono::high_resolution_clock::now() - startTime;
+		LogDebugRTCP("ModelClass: progressive load benchmark - %zu meshes per chunk: first chunk %.2f ms (%.1f%% of triangles), complete %.2f ms\n", chunkMeshCount,
+			firstChunkTime.count(), 100.0 * firstChunkIndices / std::max<size_t>(indices.size(), 1), completeTime.count());
+	}
+}
+
+const XMFLOAT3* ModelClass::GetPositions() const
+{
+	if (!m_positions.empty()) {
+		return m_positions.data();
+	}
+	const ArrayView<VertexBufferStruct> vertices = GetVertices();
+	return vertices.empty() ? nullptr : &vertices.data()->position;
+}
+
+ModelClass::MemoryStatistics ModelClass::GetMemoryStatistics() const
+{
+	MemoryStatistics statistics{};
+	const CpuResidencyPolicy::Bytes cpuBytes = CpuResidencyPolicy::GetBytes(GetCpuGeometryCounts(), sizeof(VertexBufferStruct));
+	statistics.cpuVertices = cpuBytes.vertices;
+	statistics.cpuPositions = cpuBytes.positions;
+	statistics.cpuIndices = cpuBytes.indices;
+	for (const MeshletData& meshlets : m_meshlets)
+	{
+		statistics.cpuMeshlets += sizeof(Meshlet) * meshlets.meshlets.size() + sizeof(MeshletBounds) * meshlets.bounds.size() +
+			sizeof(uint32_t) * meshlets.vertices.size() + sizeof(uint8_t) * meshlets.triangles.size();
+	}
+	for (const ComPtr<ID3D12Resource>& uploadHeap : m_uploadHeaps)
+	{
+		statistics.uploadHeaps += uploadHeap->GetDesc().Width;
+	}
+	for (const ComPtr<ID3D12Resource>& buffer : { m_vertexBuffer, m_indexBuffer, m_packedVertexBuffer, m_positionTransformBuffer, m_positionStreamBuffer, m_attributeStreamBuffer, m_compactIndexBuffer })
+	{
+		if (buffer) {
+			statistics.gpuGeometry += buffer->GetDesc().Width;
+		}
+	}
+	for (const ComPtr<ID3D12Resource>& buffer : { m_materialBuffer, m_triangleMaterialBuffer })
+	{
+		if (buffer) {
+			statistics.gpuMaterials += buffer->GetDesc().Width;
+		}
+	}
+	return statistics;
+}
+
+void ModelClass::ReleaseUploadHeaps()
+{
+	if (m_uploadHeaps.empty()) {
+		return;
+	}
+	const UINT64 uploadHeapBytes = GetMemoryStatistics().uploadHeaps;
+	m_uploadHeaps.clear();
+	m_uploadHeaps.shrink_to_fit();
+	LogDebugRTCP("ModelClass: released %.1f MB of upload heaps\n", uploadHeapBytes / (1024.0 * 1024.0));
+}
 
+void ModelClass::ApplyCpuResidency()
+{
+	const CpuResidency residency = m_loadSettings.cpuResidency;
+	if (residency == CpuResidency::Full) {
+		return;
+	}
+
+	const CpuGeometryCounts before = GetCpuGeometryCounts();
+	if (CpuResidencyPolicy::KeepsPositions(residency))
+	{
+		const ArrayView<VertexBufferStruct> vertices = GetVertices();
+		m_positions.resize(vertices.size());
+		CpuResidencyPolicy::ExtractPositions(vertices.data(), vertices.size(), sizeof(VertexBufferStruct), offsetof(VertexBufferStruct, position), reinterpret_cast<float*>(m_positions.data()));
+	}
+	if (CpuResidencyPolicy::KeepsIndices(residency))
+	{
+		// Indices mapped from mesh cache are copied, so the mapping can be closed
+		if (m_meshCache)
+		{
+			const ArrayView<UINT32> indices = GetIndices();
+			m_indices.assign(indices.begin(), indices.end());
+			m_lodIndices.assign(m_meshCache->GetLodIndices(), m_meshCache->GetLodIndices() + m_meshCache->GetLodIndexCount());
+		}
+	}
+	else
+	{
+		// LODs index released data, every mesh is left with LOD 0 only
+		std::vector<UINT32>().swap(m_indices);
+		std::vector<UINT32>().swap(m_lodIndices);
+		m_lodRanges.clear();
+		m_meshLodOffsets.clear();
+	}
+	std::vector<VertexBufferStruct>().swap(m_vertices);
+	m_meshCache.reset();
+	m_cpuResidency = residency;
+
+	const CpuGeometryCounts after = GetCpuGeometryCounts();
+	const CpuGeometryCounts expected = CpuResidencyPolicy::Apply(residency, before);
+	assert(after.vertices == expected.vertices && after.positions == expected.positions && after.indices == expected.indices && after.lodIndices == expected.lodIndices &&
+		"CPU geometry left after release has to match residency policy");
+	LogDebugRTCP("ModelClass: CPU geometry reduced after upload from %.1f MB to %.1f MB\n",
+		CpuResidencyPolicy::GetBytes(before, sizeof(VertexBufferStruct)).GetTotal() / (1024.0 * 1024.0), CpuResidencyPolicy::GetBytes(after, sizeof(VertexBufferStruct)).GetTotal() / (1024.0 * 1024.0));
+}
+
+CpuGeometryCounts ModelClass::GetCpuGeometryCounts() const
+{
+	return { GetVertices().size(), m_positions.size(), GetIndices().size(), m_meshCache ? m_meshCache->GetLodIndexCount() : m_lodIndices.size() };
+}
+
+ArrayView<ModelClass::VertexBufferStruct> ModelClass::GetVertices() const
+{
+	if (m_meshCache) {
+		return { m_meshCache->GetVertices(), m_meshCache->GetVertexCount() };
+	}
+	return m_vertices;
+}
+
+ArrayView<UINT32> ModelClass::GetIndices() const
+{
+	if (m_meshCache) {
+		return { m_meshCache->GetIndices(), m_meshCache->GetIndexCount() };
+	}
+	return m_indices;
+}
+
+bool ModelClass::PrepareBuffers(ComPtr<ID3D12Device2> device, DXGI_FORMAT indexFormat, const VertexBufferStruct* vertices, size_t vertexCount, const UINT32* indices, size_t indexCount)
+{
 	// Create vertex buffer
 	{
-		const UINT vertexBufferSize = static_cast<UINT>(sizeof(ModelClass::VertexBufferStruct) * static_cast<UINT>(vertices.size()));
-		m_verticesCount = static_cast<UINT>(vertices.size());
+		const UINT vertexBufferSize = static_cast<UINT>(sizeof(ModelClass::VertexBufferStruct) * vertexCount);
+		m_verticesCount = static_cast<UINT>(vertexCount);
 
 		ThrowIfFailed(device->CreateCommittedResource(
 			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
@@ -485,7 +2028,7 @@ bool ModelClass::PrepareBuffers(ComPtr<ID3D12Device2> device, DXGI_FORMAT indexF
 		UINT8* pVertexDataBegin;
 		CD3DX12_RANGE readRange(0, 0);        // We do not intend to read from this resource on the CPU.
 		ThrowIfFailed(m_vertexBuffer->Map(0, &readRange, reinterpret_cast<void**>(&pVertexDataBegin)));
-		memcpy(pVertexDataBegin, &vertices[0], vertexBufferSize);
+		memcpy(pVertexDataBegin, vertices, vertexBufferSize);
 		m_vertexBuffer->Unmap(0, nullptr);
 
 		// Initialize the vertex buffer view.
@@ -509,13 +2052,21 @@ bool ModelClass::PrepareBuffers(ComPtr<ID3D12Device2> device, DXGI_FORMAT indexF
 			return false;
 		}
 
-		const UINT indexBufferSize = static_cast<UINT>(indices.size()) * indicesByteMultiplier;
-		m_indicesCount = static_cast<UINT>(indices.size());
+		const UINT indexBufferSize = static_cast<UINT>(indexCount) * indicesByteMultiplier;
+		m_indicesCount = static_cast<UINT>(indexCount);
+
+		// Indices are stored as 32 bit, 16 bit buffer is narrowed copy
+		std::vector<UINT16> shortIndices;
+		if (indexFormat == DXGI_FORMAT_R16_UINT && indices)
+		{
+			assert(vertexCount <= IndexCompactor::MAX_16BIT_VERTICES && "Model has too many vertices for R16_UINT index buffer");
+			shortIndices.assign(indices, indices + indexCount);
+		}
 
 		ThrowIfFailed(device->CreateCommittedResource(
 			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
 			D3D12_HEAP_FLAG_NONE,
-			&CD3DX12_RESOURCE_DESC::Buffer(indexBufferSize),
+			&CD3DX12_RESOURCE_DESC::Buffer(ALIGN(sizeof(UINT32), indexBufferSize)),	// Raw views of 16 bit buffer read whole 32 bit elements
 			D3D12_RESOURCE_STATE_GENERIC_READ,
 			nullptr,
 			IID_PPV_ARGS(&m_indexBuffer)));
@@ -524,7 +2075,13 @@ bool ModelClass::PrepareBuffers(ComPtr<ID3D12Device2> device, DXGI_FORMAT indexF
 		UINT8* pIndexDataBegin;
 		CD3DX12_RANGE readRange(0, 0);        // We do not intend to read from this resource on the CPU.
 		ThrowIfFailed(m_indexBuffer->Map(0, &readRange, reinterpret_cast<void**>(&pIndexDataBegin)));
-		memcpy(pIndexDataBegin, &indices[0], indexBufferSize);
+		// No indices - buffer is zeroed, every triangle is degenerate until indices are written into it
+		if (indices) {
+			memcpy(pIndexDataBegin, shortIndices.empty() ? static_cast<const void*>(indices) : shortIndices.data(), indexBufferSize);
+		}
+		else {
+			memset(pIndexDataBegin, 0, indexBufferSize);
+		}
 		m_indexBuffer->Unmap(0, nullptr);
 
 		// Initialize the vertex buffer view.
@@ -533,9 +2090,270 @@ bool ModelClass::PrepareBuffers(ComPtr<ID3D12Device2> device, DXGI_FORMAT indexF
 		m_indexBufferView.SizeInBytes = indexBufferSize;
 	}
 
+	// Create packed copy of vertices read by raytracing, or split position and attribute streams
+	m_packedVertexBuffer.Reset();
+	m_positionTransformBuffer.Reset();
+	m_positionStreamBuffer.Reset();
+	m_attributeStreamBuffer.Reset();
+	if (m_loadSettings.splitVertexStreams && vertexCount > 0)
+	{
+		return PrepareSplitVertexStreams(device, vertices, vertexCount);
+	}
+	if (m_loadSettings.raytracingVertexFormat != VertexFormat::Full && vertexCount > 0)
+	{
+		return PreparePackedVertexBuffer(device, vertices, vertexCount);
+	}
+
+	return true;
+}
+
+bool ModelClass::PrepareCompactIndexBuffer(ComPtr<ID3D12Device2> device)
+{
+	const ArrayView<UINT32> indices = GetIndices();
+	std::vector<UINT8> data;
+	data.reserve(indices.size_bytes());
+	m_compactIndexRanges.reserve(m_meshRanges.size());
+	size_t shortMeshCount = 0;
+	for (const MeshRange& range : m_meshRanges)
+	{
+		m_compactIndexRanges.push_back(IndexCompactor::Append(indices.data() + range.indexOffset, range.indexCount, range.vertexOffset, range.vertexCount, data));
+		shortMeshCount += m_compactIndexRanges.back().indexSize == sizeof(UINT16) ? 1 : 0;
+	}
+
+#ifndef NDEBUG
+	// Decoded triangles have to match the 32 bit index buffer exactly
+	for (size_t i = 0; i < m_meshRanges.size(); ++i)
+	{
+		std::vector<UINT32> decoded(m_compactIndexRanges[i].indexCount);
+		IndexCompactor::Decode(data.data(), m_compactIndexRanges[i], decoded.data());
+		assert(std::equal(decoded.begin(), decoded.end(), indices.data() + m_meshRanges[i].indexOffset) && "Compact indices don't decode to original triangles");
+	}
+#endif
+
+	const UINT compactIndexBufferSize = static_cast<UINT>(std::max<size_t>(data.size(), IndexCompactor::RANGE_ALIGNMENT));
+	ThrowIfFailed(device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(compactIndexBufferSize),
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&m_compactIndexBuffer)));
+
+	UINT8* pIndexDataBegin;
+	CD3DX12_RANGE readRange(0, 0);
+	ThrowIfFailed(m_compactIndexBuffer->Map(0, &readRange, reinterpret_cast<void**>(&pIndexDataBegin)));
+	memcpy(pIndexDataBegin, data.data(), data.size());
+	m_compactIndexBuffer->Unmap(0, nullptr);
+
+	LogDebugRTCP("ModelClass: compact indices - %zu/%zu meshes use 16 bit indices, %.2f MB -> %.2f MB (%.1f%%)\n", shortMeshCount, m_meshRanges.size(),
+		indices.size_bytes() / (1024.0 * 1024.0), data.size() / (1024.0 * 1024.0), indices.size_bytes() > 0 ? 100.0 * data.size() / indices.size_bytes() : 100.0);
+	return true;
+}
+
+bool ModelClass::PrepareMaterialBuffers(ComPtr<ID3D12Device2> device)
+{
+	m_materialBuffer.Reset();
+	m_triangleMaterialBuffer.Reset();
+	if (m_materials.empty()) {
+		return true;
+	}
+	assert(m_materials.size() == m_meshRanges.size() && "Every mesh needs its material");
+
+	const UINT materialBufferSize = static_cast<UINT>(sizeof(Material) * m_materials.size());
+	ThrowIfFailed(device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(materialBufferSize),
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&m_materialBuffer)));
+
+	UINT8* pMaterialDataBegin;
+	CD3DX12_RANGE readRange(0, 0);
+	ThrowIfFailed(m_materialBuffer->Map(0, &readRange, reinterpret_cast<void**>(&pMaterialDataBegin)));
+	memcpy(pMaterialDataBegin, m_materials.data(), materialBufferSize);
+	m_materialBuffer->Unmap(0, nullptr);
+
+	// Indexed by triangle of whole model in mesh order - hit shaders get it as InstanceID() + PrimitiveIndex().
+	// Written for every mesh before progressive load publishes any, so views created with the pipeline cover whole model
+	const size_t triangleCount = GetIndicesCount() / 3;
+	assert(triangleCount == GetIndices().size() / 3 && "Triangle materials have to cover every mesh, published or not");
+	m_triangleMaterialFormat = m_materials.size() <= 0xFFFF ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+	const UINT materialIndexSize = m_triangleMaterialFormat == DXGI_FORMAT_R16_UINT ? sizeof(UINT16) : sizeof(UINT32);
+	const UINT triangleMaterialBufferSize = static_cast<UINT>(std::max<size_t>(materialIndexSize * triangleCount, sizeof(UINT32)));
+	ThrowIfFailed(device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(triangleMaterialBufferSize),
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&m_triangleMaterialBuffer)));
+
+	UINT8* pTriangleDataBegin;
+	ThrowIfFailed(m_triangleMaterialBuffer->Map(0, &readRange, reinterpret_cast<void**>(&pTriangleDataBegin)));
+	for (size_t meshIndex = 0; meshIndex < m_meshRanges.size(); ++meshIndex)
+	{
+		const MeshRange& range = m_meshRanges[meshIndex];
+		const size_t firstTriangle = range.indexOffset / 3;
+		for (size_t i = 0; i < range.indexCount / 3; ++i)
+		{
+			if (materialIndexSize == sizeof(UINT16)) {
+				reinterpret_cast<UINT16*>(pTriangleDataBegin)[firstTriangle + i] = static_cast<UINT16>(meshIndex);
+			}
+			else {
+				reinterpret_cast<UINT32*>(pTriangleDataBegin)[firstTriangle + i] = static_cast<UINT32>(meshIndex);
+			}
+		}
+	}
+	m_triangleMaterialBuffer->Unmap(0, nullptr);
+
+	// Texture IDs used to take 3x 4 bytes of every vertex
+	LogDebugRTCP("ModelClass: materials - %zu materials, %.2f MB per triangle indices, %.2f MB of per vertex texture IDs saved\n", m_materials.size(),
+		(materialIndexSize * triangleCount) / (1024.0 * 1024.0), (3 * sizeof(UINT32) * GetVerticesCount()) / (1024.0 * 1024.0));
+	return true;
+}
+
+D3D12_INDEX_BUFFER_VIEW ModelClass::GetCompactIndexBufferView(size_t meshIndex) const
+{
+	assert(HasCompactIndices() && "Model was loaded without compact indices");
+	const CompactIndexRange& range = m_compactIndexRanges.at(meshIndex);
+	D3D12_INDEX_BUFFER_VIEW view;
+	view.BufferLocation = m_compactIndexBuffer->GetGPUVirtualAddress() + range.byteOffset;
+	view.SizeInBytes = range.indexSize * range.indexCount;
+	view.Format = range.indexSize == sizeof(UINT16) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+	return view;
+}
+
+bool ModelClass::PreparePackedVertexBuffer(ComPtr<ID3D12Device2> device, const VertexBufferStruct* vertices, size_t vertexCount)
+{
+	const VertexFormat format = m_loadSettings.raytracingVertexFormat;
+	const bool quantizePosition = format == VertexFormat::PackedQuantizedPosition;
+	BoundingBox::CreateFromPoints(m_bounds, vertexCount, &vertices[0].position, sizeof(VertexBufferStruct));
+
+	m_packedVertexStride = quantizePosition ? sizeof(PackedVertexQuantized) : sizeof(PackedVertex);
+	const UINT packedVertexBufferSize = static_cast<UINT>(m_packedVertexStride * vertexCount);
+	ThrowIfFailed(device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(packedVertexBufferSize),
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&m_packedVertexBuffer)));
+
+	// Encode straight into upload heap - no intermediate copy of packed vertices
+	UINT8* pVertexDataBegin;
+	CD3DX12_RANGE readRange(0, 0);
+	ThrowIfFailed(m_packedVertexBuffer->Map(0, &readRange, reinterpret_cast<void**>(&pVertexDataBegin)));
+	if (quantizePosition) {
+		VertexPacking::Encode(vertices, vertexCount, m_bounds, reinterpret_cast<PackedVertexQuantized*>(pVertexDataBegin));
+	}
+	else {
+		VertexPacking::Encode(vertices, vertexCount, reinterpret_cast<PackedVertex*>(pVertexDataBegin));
+	}
+	m_packedVertexBuffer->Unmap(0, nullptr);
+
+	if (quantizePosition) {
+		PreparePositionTransformBuffer(device);
+	}
+
+	const VertexPacking::RoundTripError error = VertexPacking::MeasureRoundTripError(vertices, vertexCount, format, m_bounds);
+	LogDebugRTCP("Packed vertices: %u B/vertex instead of %u B (%.2f MB instead of %.2f MB), hit shader fetch %u B/triangle instead of %u B\n",
+		m_packedVertexStride, static_cast<UINT>(sizeof(VertexBufferStruct)),
+		packedVertexBufferSize / (1024.0 * 1024.0), sizeof(VertexBufferStruct) * vertexCount / (1024.0 * 1024.0),
+		3 * m_packedVertexStride, static_cast<UINT>(3 * sizeof(VertexBufferStruct)));
+	LogDebugRTCP("Packed vertices max error: position %f, normal %.3f deg, tangent %.3f deg, binormal %.3f deg, uv %f (%zu degenerate vertices skipped)\n",
+		error.position, error.normal, error.tangent, error.binormal, error.uv, error.degenerateVertices);
+
+	return true;
+}
+
+bool ModelClass::PrepareSplitVertexStreams(ComPtr<ID3D12Device2> device, const VertexBufferStruct* vertices, size_t vertexCount)
+{
+	const VertexFormat format = m_loadSettings.raytracingVertexFormat;
+	const bool quantizePosition = format == VertexFormat::PackedQuantizedPosition;
+	BoundingBox::CreateFromPoints(m_bounds, vertexCount, &vertices[0].position, sizeof(VertexBufferStruct));
+
+	// Hot stream - positions only, so BLAS build reads 12 (or 8 quantized) bytes per vertex instead of whole vertex
+	m_positionStreamStride = quantizePosition ? sizeof(XMSHORTN4) : sizeof(XMFLOAT3);
+	const UINT positionStreamSize = static_cast<UINT>(m_positionStreamStride * vertexCount);
+	ThrowIfFailed(device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(positionStreamSize),
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&m_positionStreamBuffer)));
+
+	UINT8* pPositionDataBegin;
+	CD3DX12_RANGE readRange(0, 0);
+	ThrowIfFailed(m_positionStreamBuffer->Map(0, &readRange, reinterpret_cast<void**>(&pPositionDataBegin)));
+	if (quantizePosition) {
+		VertexPacking::EncodePositions(vertices, vertexCount, m_bounds, reinterpret_cast<XMSHORTN4*>(pPositionDataBegin));
+	}
+	else
+	{
+		XMFLOAT3* positions = reinterpret_cast<XMFLOAT3*>(pPositionDataBegin);
+		for (size_t i = 0; i < vertexCount; ++i)
+		{
+			positions[i] = vertices[i].position;
+		}
+	}
+	m_positionStreamBuffer->Unmap(0, nullptr);
+
+	// Cold stream - everything else, read by hit shaders only after closest hit is found
+	m_attributeStreamStride = format == VertexFormat::Full ? sizeof(VertexAttributes) : sizeof(PackedVertexAttributes);
+	const UINT attributeStreamSize = static_cast<UINT>(m_attributeStreamStride * vertexCount);
+	ThrowIfFailed(device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(attributeStreamSize),
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&m_attributeStreamBuffer)));
+
+	UINT8* pAttributeDataBegin;
+	ThrowIfFailed(m_attributeStreamBuffer->Map(0, &readRange, reinterpret_cast<void**>(&pAttributeDataBegin)));
+	if (format == VertexFormat::Full)
+	{
+		VertexAttributes* attributes = reinterpret_cast<VertexAttributes*>(pAttributeDataBegin);
+		for (size_t i = 0; i < vertexCount; ++i)
+		{
+			attributes[i] = VertexAttributes{ vertices[i].normal, vertices[i].tangent, vertices[i].binormal, vertices[i].uv };
+		}
+	}
+	else {
+		VertexPacking::EncodeAttributes(vertices, vertexCount, reinterpret_cast<PackedVertexAttributes*>(pAttributeDataBegin));
+	}
+	m_attributeStreamBuffer->Unmap(0, nullptr);
+
+	if (quantizePosition) {
+		PreparePositionTransformBuffer(device);
+	}
+
+	const UINT interleavedStride = format == VertexFormat::Full ? static_cast<UINT>(sizeof(VertexBufferStruct)) : static_cast<UINT>(quantizePosition ? sizeof(PackedVertexQuantized) : sizeof(PackedVertex));
+	LogDebugRTCP("ModelClass: split vertex streams - positions %u B/vertex (%.2f MB), attributes %u B/vertex (%.2f MB), BLAS build reads %u B/vertex instead of %u B\n",
+		m_positionStreamStride, positionStreamSize / (1024.0 * 1024.0), m_attributeStreamStride, attributeStreamSize / (1024.0 * 1024.0), m_positionStreamStride, interleavedStride);
 	return true;
 }
 
+void ModelClass::PreparePositionTransformBuffer(ComPtr<ID3D12Device2> device)
+{
+	const std::array<float, 12> transform = VertexPacking::GetDequantizeTransform(m_bounds);
+	ThrowIfFailed(device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(sizeof(transform)),
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&m_positionTransformBuffer)));
+
+	UINT8* pTransformDataBegin;
+	CD3DX12_RANGE readRange(0, 0);
+	ThrowIfFailed(m_positionTransformBuffer->Map(0, &readRange, reinterpret_cast<void**>(&pTransformDataBegin)));
+	memcpy(pTransformDataBegin, transform.data(), sizeof(transform));
+	m_positionTransformBuffer->Unmap(0, nullptr);
+}
+
 void ModelClass::UpdateBufferResource(ComPtr<ID3D12Device2> device, ComPtr<ID3D12GraphicsCommandList4> commandList, ID3D12Resource** pDestinationResource, ID3D12Resource** pIntermediateResource, size_t numElements, size_t elementSize, const void* bufferData, D3D12_RESOURCE_FLAGS flags)
 {
 	size_t bufferSize = numElements * elementSize;
@@ -563,6 +2381,114 @@ void ModelClass::UpdateBufferResource(ComPtr<ID3D12Device2> device, ComPtr<ID3D1
 
 void ModelClass::SetFullScreenRectangleModel(ComPtr<ID3D12Device2> device, ComPtr<ID3D12GraphicsCommandList4> commandList, float left, float right, float top, float bottom, DXGI_FORMAT indexFormat)
 {
-	assert(CreateRectangle(device, left, right, top, bottom) && "Failed to create full screen rectangle");
-	assert(PrepareBuffers(device, indexFormat) && "Failed to prepare buffers");
+	const bool rectangleCreated = CreateRectangle(device, left, right, top, bottom);
+	assert(rectangleCreated && "Failed to create full screen rectangle");
+	const bool buffersPrepared = PrepareBuffers(device, indexFormat);
+	assert(buffersPrepared && "Failed to prepare buffers");
+}
+
+void ModelClass::GenerateScene(const SceneGenerator::Settings& sceneSettings, ComPtr<ID3D12Device2> device, DXGI_FORMAT indexFormat)
+{
+	static_assert(sizeof(SceneGenerator::Vertex) == sizeof(VertexBufferStruct) && sizeof(SceneGenerator::MeshRange) == sizeof(MeshRange), "Generator writes straight into model's vertex store");
+	assert(m_meshRanges.empty() && "Scene has to be generated into empty model");
+	assert((!m_loadSettings.progressiveLoading || indexFormat == DXGI_FORMAT_R32_UINT) && "Progressive loading publishes meshes into R32_UINT index buffer");
+	m_loadStartTime = std::chrono::high_resolution_clock::now();
+	m_meshCache.reset();
+	m_positions.clear();
+	m_cpuResidency = CpuResidency::Full;
+
+	// Same single vertex and index array as imported scene, every mesh is generated into its own range
+	const SceneGenerator::Layout layout = SceneGenerator::Plan(sceneSettings);
+	const size_t meshCount = layout.meshes.size();
+	m_meshRanges.resize(meshCount);
+	memcpy(m_meshRanges.data(), layout.meshes.data(), sizeof(MeshRange) * meshCount);
+	m_vertices.resize(layout.vertexCount);
+	m_indices.resize(layout.indexCount);
+
+	const unsigned int threadCount = m_loadSettings.importThreadCount > 0 ? m_loadSettings.importThreadCount : ThreadPool::GetDefaultThreadCount();
+	std::unique_ptr<ThreadPool> threadPool = threadCount > 1 ? std::make_unique<ThreadPool>(threadCount) : nullptr;
+	const auto generateMesh = [&](size_t i) {
+		SceneGenerator::GenerateMesh(sceneSettings, layout, i, reinterpret_cast<SceneGenerator::Vertex*>(m_vertices.data()), m_indices.data());
+	};
+	if (threadPool) {
+		threadPool->ParallelFor(meshCount, generateMesh);
+	}
+	else
+	{
+		for (size_t i = 0; i < meshCount; ++i)
+		{
+			generateMesh(i);
+		}
+	}
+
+	// Untextured materials - texture slots stay empty, so generated scene doesn't read anything from disk
+	const std::vector<SceneGenerator::Material> materials = SceneGenerator::GenerateMaterials(sceneSettings);
+	m_meshTexturePaths.assign(meshCount, MeshTexturePaths{});
+	m_materials.resize(meshCount);
+	for (size_t i = 0; i < meshCount; ++i)
+	{
+		const SceneGenerator::Material& material = materials[SceneGenerator::GetMeshMaterial(sceneSettings, i)];
+		m_materials[i] = { INVALID_TEXTURE_ID, INVALID_TEXTURE_ID, INVALID_TEXTURE_ID, material.specular, XMFLOAT3(material.albedo), 0.0f };
+	}
+	m_diffuseTexturesResources.assign(meshCount, nullptr);
+	m_specularTexturesResources.assign(meshCount, nullptr);
+	m_normalTexturesResources.assign(meshCount, nullptr);
+
+	// Every instance is root node with single mesh - repeated meshes stay stored once, like instanced meshes of imported scene
+	const std::vector<SceneGenerator::Instance> instances = SceneGenerator::GenerateInstances(sceneSettings, layout);
+	m_sceneNodes.resize(instances.size());
+	m_nodeMeshes.resize(instances.size());
+	for (size_t i = 0; i < instances.size(); ++i)
+	{
+		SceneNode& node = m_sceneNodes[i];
+		node.localTransform = XMFLOAT4X4(instances[i].transform);
+		node.worldTransform = node.localTransform;
+		node.parent = -1;
+		node.meshOffset = static_cast<UINT32>(i);
+		node.meshCount = 1;
+		m_nodeMeshes[i] = instances[i].mesh;
+	}
+
+	m_lodRanges.clear();
+	m_lodIndices.clear();
+	m_meshLodOffsets.assign(meshCount + 1, 0);
+	const std::chrono::duration<double, std::milli> generateTime = std::chrono::high_resolution_clock::now() - m_loadStartTime;
+	LogDebugRTCP("ModelClass: generated %zu triangles in %zu meshes on %u threads in %.2f ms, geometry %.1f MB, seed %llu\n", m_indices.size() / 3, meshCount, threadCount,
+		generateTime.count(), (sizeof(VertexBufferStruct) * m_vertices.size() + sizeof(UINT32) * m_indices.size()) / (1024.0 * 1024.0), static_cast<unsigned long long>(sceneSettings.seed));
+	LogSceneGraphStatistics();
+
+	BuildMeshlets();
+	const bool buffersPrepared = PrepareBuffers(device, indexFormat);
+	assert(buffersPrepared && "Failed to prepare buffers");
+	if (m_loadComplete) {
+		ApplyCpuResidency();
+	}
+}
+
+D3D12_RAYTRACING_GEOMETRY_DESC ModelClass::GetRaytracingGeometryDesc(D3D12_RAYTRACING_GEOMETRY_FLAGS flags) const
+{
+	D3D12_RAYTRACING_GEOMETRY_DESC geometryDesc = {};
+	geometryDesc.Type = D3D12_RAYTRACING_GEOMETRY_TYPE_TRIANGLES;
+	// Split model is built from its position stream only, hit shaders read attributes from separate buffer
+	geometryDesc.Triangles.VertexBuffer.StartAddress = GetRaytracingPositionBuffer()->GetGPUVirtualAddress();
+	geometryDesc.Triangles.VertexBuffer.StrideInBytes = GetRaytracingPositionStride();
+	geometryDesc.Triangles.VertexCount = static_cast<UINT>(GetVerticesCount());
+	geometryDesc.Triangles.VertexFormat = GetRaytracingPositionFormat();
+	geometryDesc.Triangles.IndexBuffer = m_indexBuffer->GetGPUVirtualAddress();
+	geometryDesc.Triangles.IndexFormat = m_indexBufferView.Format;
+	geometryDesc.Triangles.IndexCount = static_cast<UINT>(GetIndicesCount());
+	// Quantized positions are expanded back to model space during build
+	geometryDesc.Triangles.Transform3x4 = GetRaytracingPositionTransform();
+	geometryDesc.Flags = flags;
+	return geometryDesc;
+}
+
+D3D12_RAYTRACING_GEOMETRY_DESC ModelClass::GetRaytracingMeshGeometryDesc(size_t meshIndex, D3D12_RAYTRACING_GEOMETRY_FLAGS flags) const
+{
+	const MeshRange& range = m_meshRanges.at(meshIndex);
+	const UINT64 indexSize = m_indexBufferView.Format == DXGI_FORMAT_R32_UINT ? sizeof(UINT32) : sizeof(UINT16);
+	D3D12_RAYTRACING_GEOMETRY_DESC geometryDesc = GetRaytracingGeometryDesc(flags);
+	geometryDesc.Triangles.IndexBuffer += indexSize * range.indexOffset;
+	geometryDesc.Triangles.IndexCount = range.indexCount;
+	return geometryDesc;
 }
@@ -3,6 +3,22 @@
 #include "pch.h"
 #include <vector>
 #include <array>
+#include <mutex>
+#include <unordered_map>
+#include <memory>
+#include "ArrayView.h"
+#include "AnalyticPrimitives.h"
+#include "CpuResidency.h"
+#include "MeshOptimizer.h"
+#include "MeshletBuilder.h"
+#include "IndexCompactor.h"
+#include "MeshSimplifier.h"
+#include "SceneGenerator.h"
+#include "TangentGenerator.h"
+#include "TextureCompressor.h"
+#include "TextureRegistry.h"
+#include "TextureStreamer.h"
+#include <DirectXCollision.h>
 
 #include "assimp/Importer.hpp"
 #include "assimp/scene.h"
@@ -10,12 +26,80 @@
 
 using namespace DirectX;
 
+class MeshCache;
+
+// Layout of vertex buffer read by raytracing shaders - raster pipeline always uses full VertexBufferStruct
+enum class VertexFormat
+{
+	Full,						// VertexBufferStruct, 56 bytes
+	Packed,						// PackedVertex - octahedral normal/tangent, half UV, 24 bytes
+	PackedQuantizedPosition		// PackedVertexQuantized - as Packed, with snorm16 position relative to model bounds, 20 bytes
+};
+
+// Order in which meshes of progressively loaded model become available
+enum class ProgressiveOrder
+{
+	Size,		// Meshes with most triangles first
+	Distance	// Meshes closest to progressiveViewPoint first, by center of their bounds
+};
+
+struct ModelLoadSettings
+{
+	// Use binary cache (*.rtcpmesh) stored next to the source asset, instead of importing through assimp
+	bool useMeshCache = true;
+	// Store geometry of mesh cache encoded by GeometryCodec - file is several times smaller, but it's decoded on load instead of mapped directly
+	bool compressMeshCache = false;
+	// Number of threads processing meshes during import - 0 uses all hardware threads, 1 processes meshes serially
+	unsigned int importThreadCount = 0;
+	// Reprocess imported geometry with growing number of threads and log timings
+	bool benchmarkImport = false;
+	// Collapse duplicated vertices of every mesh after import - floats closer than weldEpsilon are merged, 0 merges only bit-identical vertices
+	bool weldVertices = true;
+	float weldEpsilon = 0.0f;
+	// Reorder triangles for post-transform vertex cache and vertices for fetch locality after import
+	bool optimizeMeshes = true;
+	// Optimization orders triangles along Morton curve of their centroids instead of vertex cache order - better BVH leaf and hit shader fetch locality, worse vertex cache reuse
+	bool spatialTriangleOrder = false;
+	// Split every mesh into meshlets with culling bounds, after import or cache load
+	bool buildMeshlets = true;
+	// Simplified LODs generated for every mesh after import - fraction of base triangle count per level, empty disables LODs
+	std::vector<float> lodTargetRatios = { 0.5f, 0.25f, 0.125f };
+	// Maximal accumulated simplification error of the last LOD, relative to mesh extent
+	float lodTargetError = 0.01f;
+	// Decode textures on streaming workers, overlapped with geometry processing - uploads are recorded at the end of load
+	bool streamTextures = true;
+	// Number of texture decoding workers - 0 uses all hardware threads
+	unsigned int textureStreamingThreadCount = 0;
+	// Write mip mapped, BCn compressed DDS (*.rtcp.dds) next to every source texture which has none up to date, before textures are loaded
+	bool compressTextures = false;
+	// Load up to date *.rtcp.dds instead of source texture
+	bool preferCompressedTextures = true;
+	// Create per mesh index ranges for rasterization - 16 bit indices for meshes up to 65536 vertices, rebased by base vertex.
+	// 32 bit index buffer is still created, raytracing indexes whole model with it.
+	bool compactIndices = true;
+	// Vertex layout used by BLAS build and hit shaders - shaders have to be compiled with matching VERTEX_FORMAT define
+	VertexFormat raytracingVertexFormat = VertexFormat::Full;
+	// Raytracing reads positions from tightly packed stream (BLAS build) and remaining attributes from separate stream (hit shaders),
+	// instead of one interleaved buffer - shaders have to be compiled with VERTEX_STREAMS_SPLIT define
+	bool splitVertexStreams = false;
+	// Publish meshes in chunks from UpdateProgressiveLoad instead of all at once - buffers are created at full size,
+	// indices of meshes not published yet are zero (degenerate triangles). Requires R32_UINT index format.
+	bool progressiveLoading = false;
+	size_t progressiveChunkMeshCount = 32;
+	ProgressiveOrder progressiveOrder = ProgressiveOrder::Size;
+	XMFLOAT3 progressiveViewPoint = { 0.0f, 0.0f, 0.0f };
+	// Geometry kept on CPU once load is complete - released data is returned as empty views, mapped mesh cache is closed unless residency is Full
+	CpuResidency cpuResidency = CpuResidency::Full;
+};
+
 class ModelClass
 {
 public:
 	ModelClass() = default;
-	ModelClass(std::string path, ComPtr<ID3D12Device2> device, ComPtr<ID3D12GraphicsCommandList4> commandList);
-	ModelClass(std::string path, ComPtr<ID3D12Device2> device, ComPtr<ID3D12GraphicsCommandList4> commandList, ComPtr<ID3D12Resource>& uploadHeap);
+	ModelClass(std::string path, ComPtr<ID3D12Device2> device, ComPtr<ID3D12GraphicsCommandList4> commandList, ModelLoadSettings settings = ModelLoadSettings());
+	ModelClass(std::string path, ComPtr<ID3D12Device2> device, ComPtr<ID3D12GraphicsCommandList4> commandList, ComPtr<ID3D12Resource>& uploadHeap, ModelLoadSettings settings = ModelLoadSettings());
+	ModelClass(const SceneGenerator::Settings& sceneSettings, ComPtr<ID3D12Device2> device, ModelLoadSettings settings = ModelLoadSettings());
+	~ModelClass();
 
 	struct Texture {
 		std::string type;
@@ -31,17 +115,78 @@ public:
 		XMFLOAT3 tangent;
 		XMFLOAT3 binormal;
 		XMFLOAT2 uv;
-		unsigned int textureAlbedoID;
-		unsigned int textureSpecRoughnessID;
-		unsigned int textureNormalID;
 	};
 
+	// Cold stream of split vertices in Full format - VertexBufferStruct without position
+	struct VertexAttributes {
+		XMFLOAT3 normal;
+		XMFLOAT3 tangent;
+		XMFLOAT3 binormal;
+		XMFLOAT2 uv;
+	};
+
+	// Material of single mesh, read by raytracing shaders through per triangle material index - mirrored by Material in ALL_CommonBuffers.hlsl.
+	// Texture IDs index model's albedo, specular and normal texture slots, INVALID_TEXTURE_ID if mesh doesn't use the slot.
+	struct Material {
+		UINT32 albedoTextureID;
+		UINT32 specRoughnessTextureID;
+		UINT32 normalTextureID;
+		float specularFactor;			// Multiplies specular/roughness texture, value used without texture
+		XMFLOAT3 albedoFactor;			// Multiplies albedo texture, diffuse color of material without texture
+		float padding;
+	};
+	static constexpr UINT32 INVALID_TEXTURE_ID = 0xFFFFFFFF;
+
+	// Position of single mesh inside model's vertex and index arrays
+	struct MeshRange {
+		UINT32 vertexOffset;
+		UINT32 vertexCount;
+		UINT32 indexOffset;
+		UINT32 indexCount;
+	};
+
+	// View of single mesh - indices are global (relative to whole vertex array), subtract baseVertex for mesh local index
 	struct Mesh {
-		unsigned int vertexCount;
-		unsigned int indexCount;
+		ArrayView<VertexBufferStruct> vertices;
+		ArrayView<UINT32> indices;
+		UINT32 baseVertex;
+	};
 
-		std::vector<VertexBufferStruct> vertices;
-		std::vector<unsigned long> indices;
+	// Simplified index range of single mesh - indices are global, as in MeshRange, error is relative to mesh extent
+	struct LodRange {
+		UINT32 indexOffset;
+		UINT32 indexCount;
+		float error;
+	};
+
+	// View of single LOD - LOD 0 is the base mesh with error 0
+	struct MeshLod {
+		ArrayView<UINT32> indices;
+		float error;
+	};
+
+	// Node of imported scene graph - transforms are row major (DirectXMath convention), world = local * parent world.
+	// Nodes are stored parents first, node references meshes through GetNodeMeshes()[meshOffset..meshOffset + meshCount].
+	struct SceneNode {
+		XMFLOAT4X4 localTransform;
+		XMFLOAT4X4 worldTransform;
+		INT32 parent;
+		UINT32 meshOffset;
+		UINT32 meshCount;
+	};
+
+	// Single placement of unique mesh in the scene
+	struct MeshInstance {
+		XMFLOAT4X4 transform;
+		UINT32 meshIndex;
+		INT32 nodeIndex;
+	};
+
+	// Paths of textures used by single mesh - empty if mesh doesn't use given slot
+	struct MeshTexturePaths {
+		std::string albedo;
+		std::string specular;
+		std::string normal;
 	};
 
 	// Creating or loading new model
@@ -49,10 +194,57 @@ public:
 	void LoadModel(std::string path, ComPtr<ID3D12Device2> device, ComPtr<ID3D12GraphicsCommandList4> commandList, DXGI_FORMAT indexFormat = DXGI_FORMAT_R32_UINT);
 	void LoadModel(std::string path, ComPtr<ID3D12Device2> device, ComPtr<ID3D12GraphicsCommandList4> commandList, ComPtr<ID3D12Resource>& uploadHeap, DXGI_FORMAT indexFormat = DXGI_FORMAT_R32_UINT);
 	void ProcessScene(std::string path, ComPtr<ID3D12Device2> device, ComPtr<ID3D12GraphicsCommandList4> commandList);
+	// Replaces geometry by deterministic procedural scene - untextured, no mesh cache or LODs, instances are scene graph nodes
+	void GenerateScene(const SceneGenerator::Settings& sceneSettings, ComPtr<ID3D12Device2> device, DXGI_FORMAT indexFormat = DXGI_FORMAT_R32_UINT);
 
-	// Get meshes
-	Mesh GetMesh(int index) const { return m_meshes.at(index); };
-	std::vector<Mesh> GetMeshes() const { return m_meshes; };
+	// Get meshes - views stay valid until model is loaded again
+	Mesh GetMesh(size_t index) const;
+	size_t GetMeshCount() const { return m_meshRanges.size(); }
+	const std::vector<MeshRange>& GetMeshRanges() const { return m_meshRanges; }
+	ArrayView<VertexBufferStruct> GetVertices() const;
+	ArrayView<UINT32> GetIndices() const;
+	// Progressive loading - call UpdateProgressiveLoad once per frame until IsLoadComplete(), it returns true when new meshes were published.
+	// Index buffer is written in place, so GPU has to finish every frame using the model before the call.
+	// Generation changes with every published chunk, consumers caching anything depending on the mesh set rebuild it then.
+	bool UpdateProgressiveLoad(ComPtr<ID3D12Device2> device, ComPtr<ID3D12GraphicsCommandList4> commandList);
+	bool IsLoadComplete() const { return m_loadComplete; }
+	UINT64 GetLoadGeneration() const { return m_loadGeneration; }
+	// Changes whenever texture slot is rebound - progressively loaded model binds placeholders until streamed textures are uploaded, descriptors of slots have to be recreated then
+	UINT64 GetTextureGeneration() const { return m_textureGeneration; }
+	// Meshes available so far are the first GetLoadedMeshCount() entries of GetMeshLoadOrder() - every mesh in order of indices once load is complete
+	size_t GetLoadedMeshCount() const { return m_loadedMeshCount; }
+	const std::vector<UINT32>& GetMeshLoadOrder() const { return m_meshLoadOrder; }
+	// Get meshlets of single mesh - meshlet vertices are local to the mesh (add MeshRange::vertexOffset for model vertex index)
+	const MeshletData& GetMeshlets(size_t meshIndex) const { return m_meshlets.at(meshIndex); }
+	// Get LODs of single mesh - LODs share vertices of the base mesh, count includes LOD 0
+	size_t GetMeshLodCount(size_t meshIndex) const;
+	MeshLod GetMeshLod(size_t meshIndex, size_t lod) const;
+	// Get scene graph - meshes are stored once, nodes place them in the scene
+	const std::vector<SceneNode>& GetSceneNodes() const { return m_sceneNodes; }
+	const std::vector<UINT32>& GetNodeMeshes() const { return m_nodeMeshes; }
+	// Every mesh referenced by every node, with world transform of the node - every mesh once, untransformed, if model has no scene graph
+	std::vector<MeshInstance> GetMeshInstances() const;
+	// Single vertex and index array with every instance transformed to world space, for consumers which can't use instances
+	void FlattenInstances(std::vector<VertexBufferStruct>& vertices, std::vector<UINT32>& indices) const;
+	// Positions for CPU side queries, GetVerticesCount() of them with stride in bytes - nullptr if CPU residency is None
+	const XMFLOAT3* GetPositions() const;
+	UINT GetPositionStride() const { return m_positions.empty() ? sizeof(VertexBufferStruct) : sizeof(XMFLOAT3); }
+	CpuResidency GetCpuResidency() const { return m_cpuResidency; }
+
+	// Bytes held by the model per category - mesh cache mapping counts as CPU memory, textures are shared through registry and not included
+	struct MemoryStatistics {
+		UINT64 cpuVertices;
+		UINT64 cpuPositions;
+		UINT64 cpuIndices;		// Base and LOD indices
+		UINT64 cpuMeshlets;
+		UINT64 uploadHeaps;		// Texture uploads kept until ReleaseUploadHeaps
+		UINT64 gpuGeometry;		// Vertex, index, packed vertex, split stream and compact index buffers
+		UINT64 gpuMaterials;	// Material table and per triangle material indices
+	};
+	MemoryStatistics GetMemoryStatistics() const;
+	// Upload heaps have to live until command lists recording the uploads finished executing
+	bool HasUploadHeaps() const { return !m_uploadHeaps.empty(); }
+	void ReleaseUploadHeaps();
 
 	// Get textures
 	std::vector<ComPtr<ID3D12Resource>>& GetTextureResourcesAlbedo() { return m_diffuseTexturesResources; };
@@ -63,30 +255,151 @@ public:
 	D3D12_VERTEX_BUFFER_VIEW GetVertexBufferView() const { return m_vertexBufferView; }
 	ComPtr<ID3D12Resource> GetVertexBuffer() const { return m_vertexBuffer; }
 
+	// Get vertex data read by raytracing shaders - packed copy of vertex buffer if model was loaded with packed format, attribute stream if streams are split
+	VertexFormat GetRaytracingVertexFormat() const { return m_packedVertexBuffer || m_attributeStreamBuffer ? m_loadSettings.raytracingVertexFormat : VertexFormat::Full; }
+	ComPtr<ID3D12Resource> GetRaytracingVertexBuffer() const { return m_attributeStreamBuffer ? m_attributeStreamBuffer : (m_packedVertexBuffer ? m_packedVertexBuffer : m_vertexBuffer); }
+	UINT GetRaytracingVertexStride() const { return m_attributeStreamBuffer ? m_attributeStreamStride : (m_packedVertexBuffer ? m_packedVertexStride : sizeof(VertexBufferStruct)); }
+	bool HasSplitVertexStreams() const { return m_attributeStreamBuffer != nullptr; }
+	// Get positions read by BLAS build - position stream if streams are split, raytracing vertex buffer otherwise
+	ComPtr<ID3D12Resource> GetRaytracingPositionBuffer() const { return m_positionStreamBuffer ? m_positionStreamBuffer : GetRaytracingVertexBuffer(); }
+	UINT GetRaytracingPositionStride() const { return m_positionStreamBuffer ? m_positionStreamStride : GetRaytracingVertexStride(); }
+	DXGI_FORMAT GetRaytracingPositionFormat() const { return GetRaytracingVertexFormat() == VertexFormat::PackedQuantizedPosition ? DXGI_FORMAT_R16G16B16A16_SNORM : DXGI_FORMAT_R32G32B32_FLOAT; }
+	// Row major 3x4 transform dequantizing positions during BLAS build, 0 if positions are not quantized
+	D3D12_GPU_VIRTUAL_ADDRESS GetRaytracingPositionTransform() const { return m_positionTransformBuffer ? m_positionTransformBuffer->GetGPUVirtualAddress() : 0; }
+	const BoundingBox& GetBounds() const { return m_bounds; }
+	// Geometry of the model's BLAS - triangles from raytracing position buffer
+	D3D12_RAYTRACING_GEOMETRY_DESC GetRaytracingGeometryDesc(D3D12_RAYTRACING_GEOMETRY_FLAGS flags) const;
+	// Geometry of single mesh, built into its own BLAS and placed by TLAS instances - index range of the mesh, indices still address whole vertex buffer
+	D3D12_RAYTRACING_GEOMETRY_DESC GetRaytracingMeshGeometryDesc(size_t meshIndex, D3D12_RAYTRACING_GEOMETRY_FLAGS flags) const;
+
 	// Get index buffer data
 	D3D12_INDEX_BUFFER_VIEW GetIndexBufferView() const { return m_indexBufferView; }
 	ComPtr<ID3D12Resource> GetIndexBuffer() const { return m_indexBuffer; }
 	int GetIndicesCount() const { return m_indicesCount; }
 	int GetVerticesCount() const { return m_verticesCount; }
+	// Get compact index data - per mesh view and range, draw with range.baseVertex as BaseVertexLocation
+	bool HasCompactIndices() const { return m_compactIndexBuffer != nullptr; }
+	const CompactIndexRange& GetCompactIndexRange(size_t meshIndex) const { return m_compactIndexRanges.at(meshIndex); }
+	D3D12_INDEX_BUFFER_VIEW GetCompactIndexBufferView(size_t meshIndex) const;
+
+	// Get materials - one per mesh, triangle material buffer holds material index of every triangle of the index buffer
+	const std::vector<Material>& GetMaterials() const { return m_materials; }
+	const std::vector<MeshTexturePaths>& GetMeshTexturePaths() const { return m_meshTexturePaths; }
+	ComPtr<ID3D12Resource> GetMaterialBuffer() const { return m_materialBuffer; }
+	ComPtr<ID3D12Resource> GetTriangleMaterialBuffer() const { return m_triangleMaterialBuffer; }
+	DXGI_FORMAT GetTriangleMaterialFormat() const { return m_triangleMaterialFormat; }
+
+	// Fits primitive of given type to triangle geometry of the model and casts the same random rays against both - logs rays per second, hit agreement and memory
+	void BenchmarkAnalyticPrimitive(AnalyticPrimitives::Type type) const;
+	// Model paths are relative to the executable
+	static std::string GetFullPath(const std::string& path);
 
 private:
+	// Loading whole model - through mesh cache if possible, otherwise by assimp
+	void LoadModelFromFile(const std::string& path, unsigned int importFlags, ComPtr<ID3D12Device2> device, ComPtr<ID3D12GraphicsCommandList4> commandList, DXGI_FORMAT indexFormat);
+	bool LoadModelFromCache(const std::string& fullPath, unsigned int importFlags, ComPtr<ID3D12Device2> device, ComPtr<ID3D12GraphicsCommandList4> commandList, DXGI_FORMAT indexFormat);
+	void ImportScene(const std::string& fullPath, unsigned int importFlags, ComPtr<ID3D12Device2> device, ComPtr<ID3D12GraphicsCommandList4> commandList);
+
+	// Index of first mesh referencing given texture path - texture is loaded only into slot of that mesh
+	struct TextureOwners {
+		std::unordered_map<std::string, int> albedo;
+		std::unordered_map<std::string, int> specular;
+		std::unordered_map<std::string, int> normal;
+	};
+
 	// Processing data by assimp
-	void ProcessNode(std::vector<Mesh>& meshes, aiNode* node, const aiScene* scene, ComPtr<ID3D12Device2> device, ComPtr<ID3D12GraphicsCommandList4> commandList);
-	Mesh ProcessMesh(aiMesh* mesh, const aiScene* scene, unsigned int textureAlbedoID, ComPtr<ID3D12Device2> device, ComPtr<ID3D12GraphicsCommandList4> commandList);
+	void ProcessNode(const aiNode* node, INT32 parentIndex);
+	void ProcessMesh(aiMesh* mesh, const aiScene* scene, unsigned int meshIndex, const TextureOwners& textureOwners, ComPtr<ID3D12Device2> device, ComPtr<ID3D12GraphicsCommandList4> commandList);
+	static void ProcessMeshGeometry(aiMesh* mesh, UINT32 baseVertex, VertexBufferStruct* vertices, UINT32* indices);
+	static TangentGenerator::Statistics GenerateTangents(VertexBufferStruct* vertices, size_t vertexCount, const UINT32* indices, size_t indexCount);
+	static UINT32 GetMeshIndexCount(const aiMesh* mesh);
+	static TextureOwners FindTextureOwners(const aiScene* scene);
+	void CompressTextures(std::vector<TextureCompressor::Job> jobs) const;
+	void BenchmarkImport(const aiScene* scene) const;
+	void BenchmarkGeometryCodec() const;
+	UINT64 GetProcessingKey() const;
 	std::string DetermineTextureType(const aiScene* scene, aiMaterial* mat);
-	std::vector<Texture> LoadMaterialTextures(ComPtr<ID3D12Resource>& resource, std::vector<Texture>& textures, aiMaterial* mat, std::string texType, aiTextureType type, std::string typeName, const aiScene* scene, ComPtr<ID3D12Device2> device, ComPtr<ID3D12GraphicsCommandList4> commandList, int index, bool forceDDS = false);
+	// Textures loaded by this model, by path as referenced by materials
+	typedef std::unordered_map<std::string, Texture> TextureMap;
+	std::vector<Texture> LoadMaterialTextures(ComPtr<ID3D12Resource>& resource, TextureMap& textures, const std::unordered_map<std::string, int>& owners, aiMaterial* mat, std::string texType, aiTextureType type, std::string typeName, const aiScene* scene, ComPtr<ID3D12Device2> device, ComPtr<ID3D12GraphicsCommandList4> commandList, int index, bool forceDDS = false);
+	Texture LoadTexture(ComPtr<ID3D12Resource>& resource, TextureMap& texturesRef, const std::string& path, std::string typeName, const aiScene* scene, ComPtr<ID3D12Device2> device, ComPtr<ID3D12GraphicsCommandList4> commandList, int index, bool forceDDS = false);
+	const Texture* FindLoadedTexture(const TextureMap& texturesRef, const std::string& path) const;
+	void LogTextureStatistics() const;
+	ComPtr<ID3D12Resource> StreamTexture(const std::string& path, const std::string& typeName, float priority, ComPtr<ID3D12Device2> device, ComPtr<ID3D12GraphicsCommandList4> commandList, bool forceDDS);
+	void FinishTextureStreaming(ComPtr<ID3D12Device2> device, ComPtr<ID3D12GraphicsCommandList4> commandList);
+	void UploadStreamedTexture(TextureStreamer::Completion& completion, ComPtr<ID3D12Device2> device, ComPtr<ID3D12GraphicsCommandList4> commandList);
+	bool IsStreamingTexture(const ID3D12Resource* texture) const;
+	// Shared 1x1 texture bound in place of streamed texture of given type - has to be called with texture mutex locked
+	ComPtr<ID3D12Resource> GetPlaceholderTexture(const std::string& typeName, ComPtr<ID3D12Device2> device, ComPtr<ID3D12GraphicsCommandList4> commandList);
+	std::vector<ComPtr<ID3D12Resource>>& GetTextureSlots(const std::string& typeName);
+	void LoadCachedTextures(const MeshTexturePaths& paths, ComPtr<ID3D12Device2> device, ComPtr<ID3D12GraphicsCommandList4> commandList, int index);
 	int GetTextureIndex(aiString* str);
 	std::pair<ComPtr<ID3D12Resource>, D3D12_SUBRESOURCE_DATA> GetTextureFromModel(ComPtr<ID3D12Resource>& resource, const aiScene* scene, std::string filename, ComPtr<ID3D12Device2> device, ComPtr<ID3D12GraphicsCommandList4> commandList, int index, bool forceDDS = false);
 
+	// Welding imported geometry - mesh is welded in its own range, then ranges are compacted
+	UINT32 WeldMesh(const MeshRange& range);
+	void CompactMeshes(const std::vector<UINT32>& vertexCounts);
+
+	// Optimizing imported geometry - statistics of single mesh, before and after optimization
+	struct MeshOptimizationStatistics {
+		MeshOptimizer::VertexCacheStatistics fifoBefore;
+		MeshOptimizer::VertexCacheStatistics fifoAfter;
+		MeshOptimizer::VertexCacheStatistics lruBefore;
+		MeshOptimizer::VertexCacheStatistics lruAfter;
+	};
+	// Spatial sort of triangles runs its radix passes through parallelFor if given
+	MeshOptimizationStatistics OptimizeMesh(const MeshRange& range, const MeshOptimizer::ParallelFor& parallelFor = nullptr);
+	void LogOptimizationStatistics(const std::vector<MeshOptimizationStatistics>& statistics, double optimizationTime) const;
+	// Simulates ray traversal over whole model and logs cache misses of triangle fetches
+	void BenchmarkTraversal(const char* stage) const;
+	// Simulates ray traversal with interleaved and split vertex streams and logs bytes touched per ray
+	void BenchmarkVertexStreams() const;
+	void BuildMeshlets();
+	MeshletData BuildMeshMeshlets(size_t meshIndex) const;
+	// Simplifying imported geometry - every LOD is simplified from the previous one, indices are written to lodIndices
+	void GenerateMeshLods(const MeshRange& range, std::vector<LodRange>& lods, std::vector<UINT32>& lodIndices) const;
+	void BenchmarkMeshlets() const;
+	void LogSceneGraphStatistics() const;
+	void ApplyCpuResidency();
+	CpuGeometryCounts GetCpuGeometryCounts() const;
+
+	// Progressive loading - load order is computed once geometry is known, chunks are published from UpdateProgressiveLoad
+	std::vector<UINT32> ComputeMeshLoadOrder() const;
+	void PublishMeshes(size_t begin, size_t end);
+	void BenchmarkProgressiveLoad() const;
+
 	// Internal functions - creating shapes
 	bool CreateRectangle(ComPtr<ID3D12Device2> device, float left, float right, float top, float bottom);
 
 	// Modifying vertex/index buffer, stored in class
 	bool PrepareBuffers(ComPtr<ID3D12Device2> device, DXGI_FORMAT indexFormat);
+	bool PrepareBuffers(ComPtr<ID3D12Device2> device, DXGI_FORMAT indexFormat, const VertexBufferStruct* vertices, size_t vertexCount, const UINT32* indices, size_t indexCount);
+	bool PreparePackedVertexBuffer(ComPtr<ID3D12Device2> device, const VertexBufferStruct* vertices, size_t vertexCount);
+	bool PrepareSplitVertexStreams(ComPtr<ID3D12Device2> device, const VertexBufferStruct* vertices, size_t vertexCount);
+	void PreparePositionTransformBuffer(ComPtr<ID3D12Device2> device);
+	bool PrepareCompactIndexBuffer(ComPtr<ID3D12Device2> device);
+	bool PrepareMaterialBuffers(ComPtr<ID3D12Device2> device);
 	void UpdateBufferResource(ComPtr<ID3D12Device2> device, ComPtr<ID3D12GraphicsCommandList4> commandList, ID3D12Resource** pDestinationResource, ID3D12Resource** pIntermediateResource, size_t numElements, size_t elementSize, const void* bufferData, D3D12_RESOURCE_FLAGS flags = D3D12_RESOURCE_FLAG_NONE);
 
 //VARIABLES
 private:
+	static constexpr unsigned int IMPORT_FLAGS_LEFT_HANDED = aiProcess_Triangulate | aiProcess_ConvertToLeftHanded | aiProcess_OptimizeMeshes | aiProcess_CalcTangentSpace | aiProcess_FlipUVs;
+	static constexpr unsigned int IMPORT_FLAGS_RIGHT_HANDED = aiProcess_Triangulate | aiProcess_OptimizeMeshes | aiProcess_CalcTangentSpace | aiProcess_FlipUVs;
+	// Processing done after import - stored in mesh cache together with weld epsilon, so cache is rebuilt when settings change
+	static constexpr UINT32 PROCESSING_OPTIMIZE_MESHES = 1 << 0;
+	static constexpr UINT32 PROCESSING_WELD_VERTICES = 1 << 1;
+	static constexpr UINT32 PROCESSING_GENERATE_LODS = 1 << 2;
+	static constexpr UINT32 PROCESSING_COMPRESS_CACHE = 1 << 3;
+	static constexpr UINT32 PROCESSING_SPATIAL_ORDER = 1 << 4;
+	// Mesh this large is sorted spatially on its own with every thread, instead of together with other meshes on a single thread each
+	static constexpr UINT32 PARALLEL_SORT_MIN_TRIANGLES = 256 * 1024;
+	// LOD is dropped if it doesn't remove at least this fraction of triangles of the previous level
+	static constexpr float LOD_MIN_REDUCTION = 0.05f;
+	// Float members of VertexBufferStruct - position, normal, tangent, binormal, uv
+	static constexpr size_t VERTEX_FLOAT_COUNT = 14;
+
+	ModelLoadSettings m_loadSettings;
+
 	// Resources storing textures
 	//ComPtr<ID3D12Resource> m_resourceAlbedo;
 	//ComPtr<ID3D12Resource> m_resourceSpecRoughness;
@@ -94,12 +407,51 @@ private:
 	std::vector<ComPtr<ID3D12Resource>> m_diffuseTexturesResources{};
 	std::vector<ComPtr<ID3D12Resource>> m_specularTexturesResources{};
 	std::vector<ComPtr<ID3D12Resource>> m_normalTexturesResources{};
-	std::vector<Texture> m_diffuseTextures;
-	std::vector<Texture> m_specularTextures;
-	std::vector<Texture> m_normalTextures;
+	TextureMap m_diffuseTextures;
+	TextureMap m_specularTextures;
+	TextureMap m_normalTextures;
+	// References to shared textures - resources are released when last model using them is destroyed
+	std::vector<TextureRegistry::Handle> m_textureHandles;
+	// Textures created from file metadata, waiting for their decoded data - streamer exists only while model is loading
+	std::unique_ptr<TextureStreamer> m_textureStreamer;
+	std::unordered_map<TextureStreamer::RequestID, ComPtr<ID3D12Resource>> m_streamingTextures;
+	size_t m_streamedTextureCount = 0;
+	double m_streamedDecodeTime = 0.0;
+	// Slots of progressively loaded model bound to placeholder, by streamed texture they get once it's uploaded
+	struct PendingTextureSlot {
+		std::vector<ComPtr<ID3D12Resource>>* slots;
+		size_t index;
+	};
+	std::unordered_map<const ID3D12Resource*, std::vector<PendingTextureSlot>> m_pendingTextureSlots;
+	std::unordered_map<UINT32, ComPtr<ID3D12Resource>> m_placeholderTextures;
+	UINT64 m_textureGeneration = 0;
+	// Guards texture registration and command list recording - meshes may be processed on worker threads
+	std::mutex m_textureMutex;
 
-	// Stored meshes
-	std::vector<Mesh> m_meshes;
+	// Stored meshes - one contiguous vertex and index array for whole model, owned after import or mapped from mesh cache
+	std::vector<VertexBufferStruct> m_vertices;
+	std::vector<UINT32> m_indices;
+	std::vector<MeshRange> m_meshRanges;
+	std::unique_ptr<MeshCache> m_meshCache;
+	std::vector<MeshTexturePaths> m_meshTexturePaths;
+	std::vector<Material> m_materials;
+	std::vector<MeshletData> m_meshlets;
+	// LODs of meshes, excluding LOD 0 - m_meshLodOffsets has GetMeshCount() + 1 entries indexing m_lodRanges
+	std::vector<LodRange> m_lodRanges;
+	std::vector<UINT32> m_meshLodOffsets;
+	std::vector<UINT32> m_lodIndices;
+	// Scene graph - nodes reference meshes by index instead of baking copies of them
+	std::vector<SceneNode> m_sceneNodes;
+	std::vector<UINT32> m_nodeMeshes;
+	// Positions kept after vertices were released, only for PositionsAndIndices residency
+	std::vector<XMFLOAT3> m_positions;
+	CpuResidency m_cpuResidency = CpuResidency::Full;
+	// Progressive loading state - complete load publishes every mesh at once
+	std::vector<UINT32> m_meshLoadOrder;
+	size_t m_loadedMeshCount = 0;
+	UINT64 m_loadGeneration = 0;
+	bool m_loadComplete = true;
+	std::chrono::high_resolution_clock::time_point m_loadStartTime;
 
 	// Vertices and indices data
 	ComPtr<ID3D12Resource> m_vertexBuffer = NULL;
@@ -108,4 +460,25 @@ private:
 	D3D12_INDEX_BUFFER_VIEW m_indexBufferView;
 	int m_indicesCount = 0;
 	int m_verticesCount = 0;
+
+	// Packed vertices used by raytracing, only if load settings request packed format
+	ComPtr<ID3D12Resource> m_packedVertexBuffer = NULL;
+	UINT m_packedVertexStride = 0;
+	ComPtr<ID3D12Resource> m_positionTransformBuffer = NULL;
+	BoundingBox m_bounds;
+
+	// Split vertices used by raytracing, only if load settings request them - hot position stream and cold attribute stream
+	ComPtr<ID3D12Resource> m_positionStreamBuffer = NULL;
+	UINT m_positionStreamStride = 0;
+	ComPtr<ID3D12Resource> m_attributeStreamBuffer = NULL;
+	UINT m_attributeStreamStride = 0;
+
+	// Per mesh 16/32 bit indices used by rasterization, only if load settings request them
+	ComPtr<ID3D12Resource> m_compactIndexBuffer = NULL;
+	std::vector<CompactIndexRange> m_compactIndexRanges;
+
+	// Material table and material index of every triangle, read by raytracing shaders
+	ComPtr<ID3D12Resource> m_materialBuffer = NULL;
+	ComPtr<ID3D12Resource> m_triangleMaterialBuffer = NULL;
+	DXGI_FORMAT m_triangleMaterialFormat = DXGI_FORMAT_R16_UINT;
 };
\ No newline at end of file
@@ -14,7 +14,7 @@ RaytracingResources::RaytracingResources(ID3D12Device5* device, ComPtr<ID3D12Gra
     m_hitGroups.push_back(hitGroup);
 
     CreateBLAS(model, device, commandList);
-    CreateTLAS(device, commandList);
+    CreateTLAS(model, device, commandList);
 }
 
 RaytracingResources::RaytracingResources(ID3D12Device5* device, ComPtr<ID3D12GraphicsCommandList4> commandList, std::shared_ptr<ModelClass> model, RtProgram rayGenShader, RtProgram missShader, HitProgram hitShader, LPCWSTR hitGroupName)
@@ -28,7 +28,7 @@ RaytracingResources::RaytracingResources(ID3D12Device5* device, ComPtr<ID3D12Gra
     m_hitGroups.push_back(hitGroup);
 
     CreateBLAS(model, device, commandList);
-    CreateTLAS(device, commandList);
+    CreateTLAS(model, device, commandList);
 }
 
 RaytracingResources::RaytracingResources(ID3D12Device5* device, ComPtr<ID3D12GraphicsCommandList4> commandList, std::shared_ptr<ModelClass> model, HitGroup hitGroup)
@@ -36,7 +36,7 @@ RaytracingResources::RaytracingResources(ID3D12Device5* device, ComPtr<ID3D12Gra
     m_hitGroups.push_back(hitGroup);
 
     CreateBLAS(model, device, commandList);
-    CreateTLAS(device, commandList);
+    CreateTLAS(model, device, commandList);
 }
 
 RaytracingResources::RaytracingResources(ID3D12Device5* device, ComPtr<ID3D12GraphicsCommandList4> commandList, std::shared_ptr<ModelClass> model, std::vector<HitGroup> hitGroups)
@@ -44,7 +44,7 @@ RaytracingResources::RaytracingResources(ID3D12Device5* device, ComPtr<ID3D12Gra
     m_hitGroups = hitGroups;
 
     CreateBLAS(model, device, commandList);
-    CreateTLAS(device, commandList);
+    CreateTLAS(model, device, commandList);
 }
 
 void RaytracingResources::CreateRaytracingPipelineContinue(ID3D12Device5* device, ModelClass* model, std::vector<TextureWithDesc> texturesWithDesc, D3D12_SHADER_RESOURCE_VIEW_DESC indexDesc, D3D12_SHADER_RESOURCE_VIEW_DESC vertexDesc, std::vector<ResourceWithSize> buffersWithSize, std::vector<bool> isUAV, size_t maxPayloadSize)
@@ -80,35 +80,45 @@ D3D12_DISPATCH_RAYS_DESC RaytracingResources::GetDispatchRaysDesc(UINT width, UI
 
 void RaytracingResources::CreateBLAS(std::shared_ptr<ModelClass> model, ID3D12Device5* device, ComPtr<ID3D12GraphicsCommandList4> commandList, D3D12_RAYTRACING_GEOMETRY_FLAGS rayTracingFlags, D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAGS buildFlags)
 {
-    // Describe the geometry that goes in the bottom acceleration structure(s)
-    D3D12_RAYTRACING_GEOMETRY_DESC geometryDesc = {};
-    geometryDesc.Type = D3D12_RAYTRACING_GEOMETRY_TYPE_TRIANGLES;
-    geometryDesc.Triangles.VertexBuffer.StartAddress = model->GetVertexBuffer()->GetGPUVirtualAddress();
-    geometryDesc.Triangles.VertexBuffer.StrideInBytes = model->GetVertexBufferView().StrideInBytes;
-    geometryDesc.Triangles.VertexCount = static_cast<UINT>(model->GetMesh(0).vertices.size());
-    geometryDesc.Triangles.VertexFormat = DXGI_FORMAT_R32G32B32_FLOAT;
-    geometryDesc.Triangles.IndexBuffer = model->GetIndexBuffer()->GetGPUVirtualAddress();
-    geometryDesc.Triangles.IndexFormat = model->GetIndexBufferView().Format;
-    geometryDesc.Triangles.IndexCount = static_cast<UINT>(model->GetIndicesCount());
-    geometryDesc.Triangles.Transform3x4 = 0;
-    geometryDesc.Flags = rayTracingFlags;
-
-    // Get the size requirements for the BLAS buffers
-    D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS ASInputs = {};
-    ASInputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL;
-    ASInputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
-    ASInputs.pGeometryDescs = &geometryDesc;
-    ASInputs.NumDescs = 1;
-    ASInputs.Flags = buildFlags;
-
-    D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO ASPreBuildInfo = {};
-    device->GetRaytracingAccelerationStructurePrebuildInfo(&ASInputs, &ASPreBuildInfo);
-
-    ASPreBuildInfo.ScratchDataSizeInBytes = ALIGN(D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT, ASPreBuildInfo.ScratchDataSizeInBytes);
-    ASPreBuildInfo.ResultDataMaxSizeInBytes = ALIGN(D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT, ASPreBuildInfo.ResultDataMaxSizeInBytes);
+    // Describe the geometry that goes in the bottom acceleration structure(s) - every mesh placed by the scene graph gets its own BLAS
+    m_blasGeometryDescs.clear();
+    m_meshBlasIndices.assign(model->GetMeshCount(), INVALID_BLAS_INDEX);
+    for (const ModelClass::MeshInstance& instance : model->GetMeshInstances())
+    {
+        // Empty meshes have nothing to build, their instances are skipped
+        if (m_meshBlasIndices[instance.meshIndex] != INVALID_BLAS_INDEX || model->GetMeshRanges()[instance.meshIndex].indexCount == 0) {
+            continue;
+        }
+        m_meshBlasIndices[instance.meshIndex] = static_cast<UINT32>(m_blasGeometryDescs.size());
+        m_blasGeometryDescs.push_back(model->GetRaytracingMeshGeometryDesc(instance.meshIndex, rayTracingFlags));
+    }
+    m_blasBuildFlags = buildFlags;
+
+    // Get the size requirements for the BLAS buffers - all structures share one result and one scratch buffer, so they are built without barriers in between
+    UINT64 resultSize = 0;
+    UINT64 scratchSize = 0;
+    m_blasResultOffsets.resize(m_blasGeometryDescs.size());
+    m_blasScratchOffsets.resize(m_blasGeometryDescs.size());
+    for (size_t i = 0; i < m_blasGeometryDescs.size(); ++i)
+    {
+        D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS ASInputs = {};
+        ASInputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL;
+        ASInputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
+        ASInputs.pGeometryDescs = &m_blasGeometryDescs[i];
+        ASInputs.NumDescs = 1;
+        ASInputs.Flags = buildFlags;
+
+        D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO ASPreBuildInfo = {};
+        device->GetRaytracingAccelerationStructurePrebuildInfo(&ASInputs, &ASPreBuildInfo);
+
+        m_blasResultOffsets[i] = resultSize;
+        m_blasScratchOffsets[i] = scratchSize;
+        resultSize += ALIGN(D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT, ASPreBuildInfo.ResultDataMaxSizeInBytes);
+        scratchSize += ALIGN(D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT, ASPreBuildInfo.ScratchDataSizeInBytes);
+    }
 
     // Create the BLAS scratch buffer
-    auto bufferInfo = CD3DX12_RESOURCE_DESC::Buffer(ASPreBuildInfo.ScratchDataSizeInBytes, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, std::max(D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT));
+    auto bufferInfo = CD3DX12_RESOURCE_DESC::Buffer(std::max<UINT64>(scratchSize, D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT), D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, std::max(D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT));
 
     ThrowIfFailed(device->CreateCommittedResource(
         &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
@@ -120,7 +130,7 @@ void RaytracingResources::CreateBLAS(std::shared_ptr<ModelClass> model, ID3D12De
     ));
 
     // Create the BLAS buffer
-    bufferInfo = CD3DX12_RESOURCE_DESC::Buffer(ASPreBuildInfo.ResultDataMaxSizeInBytes, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, std::max(D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT));
+    bufferInfo = CD3DX12_RESOURCE_DESC::Buffer(std::max<UINT64>(resultSize, D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT), D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, std::max(D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT));
 
     ThrowIfFailed(device->CreateCommittedResource(
         &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
@@ -131,34 +141,67 @@ void RaytracingResources::CreateBLAS(std::shared_ptr<ModelClass> model, ID3D12De
         IID_PPV_ARGS(&m_blasResult)
     ));
 
-    // Describe and build the bottom level acceleration structure
-    D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC buildDesc = {};
-    buildDesc.Inputs = ASInputs;
-    buildDesc.ScratchAccelerationStructureData = m_blasScratch->GetGPUVirtualAddress();
-    buildDesc.DestAccelerationStructureData = m_blasResult->GetGPUVirtualAddress();
+    // Build the bottom level acceleration structures
+    BuildBLAS(commandList);
+}
 
-    commandList->BuildRaytracingAccelerationStructure(&buildDesc, 0, nullptr);
+void RaytracingResources::BuildBLAS(ComPtr<ID3D12GraphicsCommandList4> commandList)
+{
+    for (size_t i = 0; i < m_blasGeometryDescs.size(); ++i)
+    {
+        D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC buildDesc = {};
+        buildDesc.Inputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL;
+        buildDesc.Inputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
+        buildDesc.Inputs.pGeometryDescs = &m_blasGeometryDescs[i];
+        buildDesc.Inputs.NumDescs = 1;
+        buildDesc.Inputs.Flags = m_blasBuildFlags;
+        buildDesc.ScratchAccelerationStructureData = m_blasScratch->GetGPUVirtualAddress() + m_blasScratchOffsets[i];
+        buildDesc.DestAccelerationStructureData = m_blasResult->GetGPUVirtualAddress() + m_blasResultOffsets[i];
+
+        commandList->BuildRaytracingAccelerationStructure(&buildDesc, 0, nullptr);
+    }
 
-    // Wait for the BLAS build to complete
+    // Wait for the BLAS builds to complete
     commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::UAV(m_blasResult.Get()));
 }
 
-void RaytracingResources::CreateTLAS(ID3D12Device5* device, ComPtr<ID3D12GraphicsCommandList4> commandList, UINT tlasFlags, D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAGS buildFlags)
+void RaytracingResources::CreateTLAS(std::shared_ptr<ModelClass> model, ID3D12Device5* device, ComPtr<ID3D12GraphicsCommandList4> commandList, UINT tlasFlags, D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAGS buildFlags)
 {
-    // Describe the TLAS geometry instance(s)
-    D3D12_RAYTRACING_INSTANCE_DESC instanceDesc = {};
-    instanceDesc.InstanceID = 0;
-    instanceDesc.InstanceContributionToHitGroupIndex = 0;
-    instanceDesc.InstanceMask = 0xFF;
-    instanceDesc.Transform[0][0] = instanceDesc.Transform[1][1] = instanceDesc.Transform[2][2] = 1;
-    instanceDesc.AccelerationStructure = m_blasResult->GetGPUVirtualAddress();
-    instanceDesc.Flags = tlasFlags;
+    // Describe the TLAS geometry instance(s) - one per placement of mesh in the scene graph.
+    // Instance ID is first triangle of the mesh, so hit shaders index model's whole index buffer and triangle materials by InstanceID() + PrimitiveIndex().
+    std::vector<D3D12_RAYTRACING_INSTANCE_DESC> instanceDescs;
+    for (const ModelClass::MeshInstance& instance : model->GetMeshInstances())
+    {
+        const UINT32 blasIndex = m_meshBlasIndices[instance.meshIndex];
+        if (blasIndex == INVALID_BLAS_INDEX) {
+            continue;
+        }
+
+        D3D12_RAYTRACING_INSTANCE_DESC instanceDesc = {};
+        const UINT32 firstTriangle = model->GetMeshRanges()[instance.meshIndex].indexOffset / 3;
+        assert(firstTriangle < (1u << 24) && "Instance ID has 24 bits");
+        instanceDesc.InstanceID = firstTriangle;
+        instanceDesc.InstanceContributionToHitGroupIndex = 0;
+        instanceDesc.InstanceMask = 0xFF;
+        // Scene graph transforms row vectors, instance transform is 3x4 matrix transforming column vectors
+        for (int row = 0; row < 3; ++row)
+        {
+            for (int column = 0; column < 4; ++column)
+            {
+                instanceDesc.Transform[row][column] = instance.transform.m[column][row];
+            }
+        }
+        instanceDesc.AccelerationStructure = m_blasResult->GetGPUVirtualAddress() + m_blasResultOffsets[blasIndex];
+        instanceDesc.Flags = tlasFlags;
+        instanceDescs.push_back(instanceDesc);
+    }
+    m_tlasInstanceCount = static_cast<UINT>(instanceDescs.size());
 
     // Create the TLAS instance buffer
     ThrowIfFailed(device->CreateCommittedResource(
         &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
         D3D12_HEAP_FLAG_NONE,
-        &CD3DX12_RESOURCE_DESC::Buffer(sizeof(instanceDesc)),
+        &CD3DX12_RESOURCE_DESC::Buffer(std::max<size_t>(sizeof(D3D12_RAYTRACING_INSTANCE_DESC) * instanceDescs.size(), sizeof(D3D12_RAYTRACING_INSTANCE_DESC))),
         D3D12_RESOURCE_STATE_GENERIC_READ,
         nullptr,
         IID_PPV_ARGS(&m_tlasInstanceDesc)
@@ -167,7 +210,7 @@ void RaytracingResources::CreateTLAS(ID3D12Device5* device, ComPtr<ID3D12Graphic
     // Copy the instance data to the buffer
     UINT8* pData;
     m_tlasInstanceDesc->Map(0, nullptr, (void**)&pData);
-    memcpy(pData, &instanceDesc, sizeof(instanceDesc));
+    memcpy(pData, instanceDescs.data(), sizeof(D3D12_RAYTRACING_INSTANCE_DESC) * instanceDescs.size());
     m_tlasInstanceDesc->Unmap(0, nullptr);
 
     // Get the size requirements for the TLAS buffers
@@ -175,8 +218,9 @@ void RaytracingResources::CreateTLAS(ID3D12Device5* device, ComPtr<ID3D12Graphic
     ASInputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL;
     ASInputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
     ASInputs.InstanceDescs = m_tlasInstanceDesc->GetGPUVirtualAddress();
-    ASInputs.NumDescs = 1;
+    ASInputs.NumDescs = m_tlasInstanceCount;
     ASInputs.Flags = buildFlags;
+    m_tlasBuildFlags = buildFlags;
 
     D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO ASPreBuildInfo = {};
     device->GetRaytracingAccelerationStructurePrebuildInfo(&ASInputs, &ASPreBuildInfo);
@@ -209,8 +253,17 @@ void RaytracingResources::CreateTLAS(ID3D12Device5* device, ComPtr<ID3D12Graphic
     ));
 
     // Describe and build the TLAS
+    BuildTLAS(commandList);
+}
+
+void RaytracingResources::BuildTLAS(ComPtr<ID3D12GraphicsCommandList4> commandList)
+{
     D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC buildDesc = {};
-    buildDesc.Inputs = ASInputs;
+    buildDesc.Inputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL;
+    buildDesc.Inputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
+    buildDesc.Inputs.InstanceDescs = m_tlasInstanceDesc->GetGPUVirtualAddress();
+    buildDesc.Inputs.NumDescs = m_tlasInstanceCount;
+    buildDesc.Inputs.Flags = m_tlasBuildFlags;
     buildDesc.ScratchAccelerationStructureData = m_tlasScratch->GetGPUVirtualAddress();
     buildDesc.DestAccelerationStructureData = m_tlasResult->GetGPUVirtualAddress();
 
@@ -220,6 +273,15 @@ void RaytracingResources::CreateTLAS(ID3D12Device5* device, ComPtr<ID3D12Graphic
     commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::UAV(m_tlasResult.Get()));
 }
 
+void RaytracingResources::RebuildAccelerationStructures(ComPtr<ID3D12GraphicsCommandList4> commandList)
+{
+    // Geometry counts and buffers are unchanged, so structures fit into buffers sized at creation
+    BuildBLAS(commandList);
+
+    // Instances still point to the same BLASes, TLAS is rebuilt only because their bounds changed
+    BuildTLAS(commandList);
+}
+
 void RaytracingResources::CreateDxrPipelineAssets(ID3D12Device5* device, ModelClass* model, std::vector<TextureWithDesc> texturesWithDesc, D3D12_SHADER_RESOURCE_VIEW_DESC indexDesc, D3D12_SHADER_RESOURCE_VIEW_DESC vertexDesc, std::vector<ResourceWithSize> buffersWithSize, std::vector<bool> isUAV)
 {
     // Create descriptor heaps
@@ -329,24 +391,43 @@ void RaytracingResources::CreateDxrPipelineAssets(ID3D12Device5* device, ModelCl
 
         // Create the vertex buffer SRV
         handle.ptr += handleIncrement;
-        device->CreateShaderResourceView(vertexDesc.Buffer.NumElements == 0 ? nullptr : model->GetVertexBuffer().Get(), &vertexDesc, handle);
+        device->CreateShaderResourceView(vertexDesc.Buffer.NumElements == 0 ? nullptr : model->GetRaytracingVertexBuffer().Get(), &vertexDesc, handle);
 
         // Create texture buffer SRV
-        for (auto& tex : texturesWithDesc)
+        m_textureViewsHandle = handle;
+        CreateTextureViews(device, texturesWithDesc, handle);
+    }
+}
+
+void RaytracingResources::UpdateTextureViews(ID3D12Device5* device, std::vector<TextureWithDesc> texturesWithDesc)
+{
+    CreateTextureViews(device, texturesWithDesc, m_textureViewsHandle);
+}
+
+void RaytracingResources::CreateTextureViews(ID3D12Device5* device, std::vector<TextureWithDesc>& texturesWithDesc, D3D12_CPU_DESCRIPTOR_HANDLE handle)
+{
+    const UINT handleIncrement = device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+    size_t viewCount = 0;
+    for (auto& tex : texturesWithDesc)
+    {
+        for (auto& singleTextureResource : tex.resources)
         {
-            for (auto& singleTextureResource : tex.resources)
+            if (tex.isSRV)
             {
-                if (tex.isSRV)
-                {
-                    handle.ptr += handleIncrement;
-                    if (singleTextureResource.Get() != nullptr && singleTextureResource.Get()->GetDesc().Format != tex.srvDesc.Format) {
-                        tex.srvDesc.Format = singleTextureResource.Get()->GetDesc().Format;
-                    }
-                    device->CreateShaderResourceView(singleTextureResource.Get(), &tex.srvDesc, handle);
+                handle.ptr += handleIncrement;
+                // Buffers keep format of their view, resource format is always unknown
+                if (singleTextureResource.Get() != nullptr && tex.srvDesc.ViewDimension != D3D12_SRV_DIMENSION_BUFFER && singleTextureResource.Get()->GetDesc().Format != tex.srvDesc.Format) {
+                    tex.srvDesc.Format = singleTextureResource.Get()->GetDesc().Format;
                 }
+                device->CreateShaderResourceView(singleTextureResource.Get(), &tex.srvDesc, handle);
+                ++viewCount;
             }
         }
     }
+
+    // Update has to write exactly the descriptors created with pipeline
+    assert((m_textureViewCount == 0 || viewCount == m_textureViewCount) && "Texture list doesn't match the one pipeline was created with");
+    m_textureViewCount = viewCount;
 }
 
 void RaytracingResources::CreateShaderTable(ID3D12Device5* device)
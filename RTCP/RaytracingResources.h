@@ -67,16 +67,26 @@ public:
 	uint32_t GetShaderTableRecordSize() const { return m_shaderTableRecordSize; };
 	ComPtr<ID3D12StateObject> GetRTPSO() const { return m_rtpso; };
 	D3D12_DISPATCH_RAYS_DESC GetDispatchRaysDesc(UINT width, UINT height, UINT depth) const;
+	// Rebuilds BLAS and TLAS from the same buffers they were created from - used when model publishes more meshes into them.
+	// Buffers are reused, so GPU has to finish every frame tracing them first.
+	void RebuildAccelerationStructures(ComPtr<ID3D12GraphicsCommandList4> commandList);
+	// Recreates SRVs of the same list of textures pipeline was created with, its resources may differ - GPU mustn't be reading the descriptors
+	void UpdateTextureViews(ID3D12Device5* device, std::vector<TextureWithDesc> texturesWithDesc);
 
 private:
 	// Called in constructor
 	void CreateBLAS(std::shared_ptr<ModelClass> model, ID3D12Device5* device, ComPtr<ID3D12GraphicsCommandList4> commandList, D3D12_RAYTRACING_GEOMETRY_FLAGS rayTracingFlags = D3D12_RAYTRACING_GEOMETRY_FLAG_OPAQUE, D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAGS buildFlags = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_TRACE);
-	void CreateTLAS(ID3D12Device5* device, ComPtr<ID3D12GraphicsCommandList4> commandList, UINT tlasFlags = D3D12_RAYTRACING_INSTANCE_FLAG_TRIANGLE_FRONT_COUNTERCLOCKWISE, D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAGS buildFlags = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_TRACE);
+	void CreateTLAS(std::shared_ptr<ModelClass> model, ID3D12Device5* device, ComPtr<ID3D12GraphicsCommandList4> commandList, UINT tlasFlags = D3D12_RAYTRACING_INSTANCE_FLAG_TRIANGLE_FRONT_COUNTERCLOCKWISE, D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAGS buildFlags = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_TRACE);
+	// Record builds into buffers created by CreateBLAS and CreateTLAS
+	void BuildBLAS(ComPtr<ID3D12GraphicsCommandList4> commandList);
+	void BuildTLAS(ComPtr<ID3D12GraphicsCommandList4> commandList);
 
 	// Called through CreateRaytracingPipeline
 	void CreateDxrPipelineAssets(ID3D12Device5* device, ModelClass* model, std::vector<TextureWithDesc> texturesWithDesc, D3D12_SHADER_RESOURCE_VIEW_DESC indexDesc, D3D12_SHADER_RESOURCE_VIEW_DESC vertexDesc, std::vector<ResourceWithSize> buffersWithSize, std::vector<bool> isUAV);
 	void CreateShaderTable(ID3D12Device5* device);
 	void CreateRTPSO(ID3D12Device5* device, size_t maxPayloadSize);
+	// Creates SRVs of textures one after another, handle points one descriptor before the first of them
+	void CreateTextureViews(ID3D12Device5* device, std::vector<TextureWithDesc>& texturesWithDesc, D3D12_CPU_DESCRIPTOR_HANDLE handle);
 
 public:
 	//RtProgram m_rayGenShader;
@@ -87,17 +97,28 @@ public:
 	std::vector<HitGroup> m_hitGroups;
 
 private:
-	// Acceleration structure data
+	// Acceleration structure data - BLAS of every mesh placed in the scene, at its offset of shared result and scratch buffers
+	static constexpr UINT32 INVALID_BLAS_INDEX = 0xFFFFFFFF;
 	ComPtr<ID3D12Resource> m_blasScratch = NULL;
 	ComPtr<ID3D12Resource> m_blasResult = NULL;
 	ComPtr<ID3D12Resource> m_tlasInstanceDesc = NULL;
 	ComPtr<ID3D12Resource> m_tlasScratch = NULL;
 	ComPtr<ID3D12Resource> m_tlasResult = NULL;
+	std::vector<D3D12_RAYTRACING_GEOMETRY_DESC> m_blasGeometryDescs;
+	std::vector<UINT64> m_blasResultOffsets;
+	std::vector<UINT64> m_blasScratchOffsets;
+	// BLAS of every mesh of model, INVALID_BLAS_INDEX if mesh isn't placed or is empty
+	std::vector<UINT32> m_meshBlasIndices;
+	UINT m_tlasInstanceCount = 0;
+	D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAGS m_blasBuildFlags = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_NONE;
+	D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAGS m_tlasBuildFlags = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_NONE;
 
 	// RTPSO data
 	ComPtr<ID3D12StateObject> m_rtpso = NULL;
 	ComPtr<ID3D12StateObjectProperties> m_rtpsoInfo = NULL;
 	ComPtr<ID3D12DescriptorHeap> m_descriptorHeap = NULL;
+	D3D12_CPU_DESCRIPTOR_HANDLE m_textureViewsHandle = {};
+	size_t m_textureViewCount = 0;
 
 	// Shader table data
 	uint32_t m_shaderTableRecordSize;
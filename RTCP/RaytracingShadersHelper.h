@@ -20,7 +20,7 @@ struct D3D12ShaderInfo
 	LPCWSTR		entryPoint = nullptr;
 	LPCWSTR		targetProfile = nullptr;
 	LPCWSTR* arguments = nullptr;
-	DxcDefine* defines = nullptr;
+	const DxcDefine* defines = nullptr;
 	UINT32		argCount = 0;
 	UINT32		defineCount = 0;
 
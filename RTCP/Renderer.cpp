@@ -61,8 +61,20 @@ void Renderer::OnInit(HWND hwnd)
     m_profiler = std::shared_ptr<Profiler>(new Profiler());
     m_profiler->Initialize(m_device.Get(), m_frameCount);
 
-    m_lightSettings = std::unique_ptr<LightSettings>(new LightSettings());
-    m_lightSettings->LoadLightFromFile();
+    if (PROCEDURAL_SCENE)
+    {
+        // Generated lights replace lights.txt of SunTemple, edits are saved to separate file
+        m_lightSettings = std::unique_ptr<LightSettings>(new LightSettings("lights_procedural.txt"));
+        for (const SceneGenerator::Light& light : SceneGenerator::GenerateLights(PROCEDURAL_SCENE_SETTINGS))
+        {
+            m_lightSettings->AddLight({ static_cast<LightType>(light.type), XMFLOAT3(light.position), XMFLOAT3{ 0.0f, 0.0f, 0.0f }, XMFLOAT4(light.color) });
+        }
+    }
+    else
+    {
+        m_lightSettings = std::unique_ptr<LightSettings>(new LightSettings());
+        m_lightSettings->LoadLightFromFile();
+    }
     m_updateLightCount = true;
 }
 
@@ -390,10 +402,12 @@ void Renderer::LoadAssets()
 
     // Create an empty root signature.
     {
-        CD3DX12_ROOT_PARAMETER rootParameters[2] = {};
+        CD3DX12_ROOT_PARAMETER rootParameters[3] = {};
         CD3DX12_DESCRIPTOR_RANGE range{ D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0 };
         rootParameters[0].InitAsDescriptorTable(1, &range);
         rootParameters[1].InitAsConstantBufferView(0, 0, D3D12_SHADER_VISIBILITY_VERTEX);
+        // World matrix of drawn mesh instance, set per draw
+        rootParameters[2].InitAsConstants(sizeof(XMFLOAT4X4) / sizeof(UINT32), 1, 0, D3D12_SHADER_VISIBILITY_VERTEX);
 
         D3D12_ROOT_SIGNATURE_FLAGS rootSignatureFlags = ROOT_SIGNATURE_PIXEL;
 
@@ -484,8 +498,26 @@ void Renderer::LoadAssets()
     {
         m_modelCube = std::shared_ptr<ModelClass>(new ModelClass("cube.obj", m_device, m_commandList));
         m_modelSphere = std::shared_ptr<ModelClass>(new ModelClass("sphere.obj", m_device, m_commandList));
+        // Analytic primitives have no intersection shader hit group, they are only compared with tessellated models here
+        if (BENCHMARK_ANALYTIC_PRIMITIVES)
+        {
+            m_modelSphere->BenchmarkAnalyticPrimitive(AnalyticPrimitives::Type::Sphere);
+            m_modelCube->BenchmarkAnalyticPrimitive(AnalyticPrimitives::Type::Box);
+        }
         //m_modelBuddha = std::shared_ptr<ModelClass>(new ModelClass("happy-buddha.fbx", m_device, m_commandList));
-        m_modelPinkRoom = std::shared_ptr<ModelClass>(new ModelClass("SunTemple.fbx", m_device, m_commandList, modelHeap));
+        ModelLoadSettings sceneLoadSettings;
+        sceneLoadSettings.raytracingVertexFormat = RAYTRACING_VERTEX_FORMAT;
+        sceneLoadSettings.splitVertexStreams = SPLIT_VERTEX_STREAMS;
+        sceneLoadSettings.progressiveLoading = PROGRESSIVE_LOADING;
+        sceneLoadSettings.progressiveOrder = ProgressiveOrder::Distance;
+        sceneLoadSettings.progressiveViewPoint = m_cameraPosition;
+        sceneLoadSettings.cpuResidency = CpuResidency::PositionsAndIndices;
+        if (PROCEDURAL_SCENE) {
+            m_modelPinkRoom = std::shared_ptr<ModelClass>(new ModelClass(PROCEDURAL_SCENE_SETTINGS, m_device, sceneLoadSettings));
+        }
+        else {
+            m_modelPinkRoom = std::shared_ptr<ModelClass>(new ModelClass("SunTemple.fbx", m_device, m_commandList, modelHeap, sceneLoadSettings));
+        }
         m_modelFullscreen = std::shared_ptr<ModelClass>(new ModelClass());
         m_modelFullscreen->SetFullScreenRectangleModel(m_device, m_commandList);
     }
@@ -578,6 +610,21 @@ void Renderer::LoadAssets()
 
     // Preparation of raytracing - create resources objects with RTPSO
     const std::shared_ptr<ModelClass> model = m_modelPinkRoom;
+    switch (model->GetRaytracingVertexFormat())
+    {
+    case VertexFormat::Packed:
+        m_raytracingShaderDefines = { { L"VERTEX_FORMAT", L"1" } };
+        break;
+    case VertexFormat::PackedQuantizedPosition:
+        m_raytracingShaderDefines = { { L"VERTEX_FORMAT", L"2" } };
+        break;
+    default:
+        m_raytracingShaderDefines = { { L"VERTEX_FORMAT", L"0" } };
+        break;
+    }
+    if (model->HasSplitVertexStreams()) {
+        m_raytracingShaderDefines.push_back({ L"VERTEX_STREAMS_SPLIT", L"1" });
+    }
     PrepareRaytracingResources(model);
     PrepareRaytracingResourcesAO(model);
     PrepareRaytracingResourcesLambert(model);
@@ -602,6 +649,12 @@ void Renderer::LoadAssets()
         }
         WaitForPreviousFrame();
     }
+
+    // Initial uploads finished executing
+    for (const std::shared_ptr<ModelClass>& model : { m_modelCube, m_modelSphere, m_modelPinkRoom, m_modelFullscreen })
+    {
+        model->ReleaseUploadHeaps();
+    }
 }
 
 void Renderer::PopulateCommandList()
@@ -610,6 +663,7 @@ void Renderer::PopulateCommandList()
     {
         ThrowIfFailed(m_commandAllocators[m_frameIndex]->Reset());
         ThrowIfFailed(m_commandList->Reset(m_commandAllocators[m_frameIndex].Get(), m_pipelineState.Get()));
+        UpdateSceneLoading();
 
         ThrowIfFailed(m_commandAllocatorsSkybox[m_frameIndex]->Reset());
         ThrowIfFailed(m_commandListSkybox->Reset(m_commandAllocatorsSkybox[m_frameIndex].Get(), m_pipelineStateSkybox.Get()));
@@ -744,6 +798,7 @@ void Renderer::PopulateCommandList()
     {
         ThrowIfFailed(m_commandAllocators[m_frameIndex]->Reset());
         ThrowIfFailed(m_commandList->Reset(m_commandAllocators[m_frameIndex].Get(), m_pipelineState.Get()));
+        UpdateSceneLoading();
 
         m_commandList->SetGraphicsRootSignature(m_rootSignature.Get());
 
@@ -773,7 +828,27 @@ void Renderer::PopulateCommandList()
         m_commandList->ClearDepthStencilView(m_dsvHeap->GetCPUDescriptorHandleForHeapStart(), D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
         m_commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
         m_commandList->IASetVertexBuffers(0, 1, &m_modelPinkRoom->GetVertexBufferView());
-        m_commandList->DrawInstanced(m_modelPinkRoom->GetIndicesCount(), 1, 0, 0);
+        // Draw per placement of mesh in the scene graph, in the same world space as TLAS instances - most meshes fetch 16 bit indices if compacted
+        UpdateRasterInstances();
+        const bool compactIndices = m_modelPinkRoom->HasCompactIndices();
+        if (!compactIndices) {
+            m_commandList->IASetIndexBuffer(&m_modelPinkRoom->GetIndexBufferView());
+        }
+        for (const RasterInstance& instance : m_rasterInstances)
+        {
+            m_commandList->SetGraphicsRoot32BitConstants(2, sizeof(XMFLOAT4X4) / sizeof(UINT32), &instance.world, 0);
+            if (compactIndices)
+            {
+                const CompactIndexRange& range = m_modelPinkRoom->GetCompactIndexRange(instance.meshIndex);
+                m_commandList->IASetIndexBuffer(&m_modelPinkRoom->GetCompactIndexBufferView(instance.meshIndex));
+                m_commandList->DrawIndexedInstanced(range.indexCount, 1, 0, static_cast<INT>(range.baseVertex), 0);
+            }
+            else
+            {
+                const ModelClass::MeshRange& range = m_modelPinkRoom->GetMeshRanges()[instance.meshIndex];
+                m_commandList->DrawIndexedInstanced(range.indexCount, 1, range.indexOffset, 0, 0);
+            }
+        }
 
         // Indicate that the back buffer will now be used to present.
         m_commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_backBuffers[m_frameIndex].Get(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT));
@@ -801,7 +876,9 @@ void Renderer::PopulateCommandList()
         // Record commands.
         m_commandListSkybox->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
         m_commandListSkybox->IASetVertexBuffers(0, 1, &m_modelCube->GetVertexBufferView());
-        m_commandListSkybox->DrawInstanced(m_modelCube->GetIndicesCount(), 1, 0, 0);
+        // Cube is welded on import - its vertices are shared between faces, so it has to be drawn through index buffer
+        m_commandListSkybox->IASetIndexBuffer(&m_modelCube->GetIndexBufferView());
+        m_commandListSkybox->DrawIndexedInstanced(m_modelCube->GetIndicesCount(), 1, 0, 0, 0);
 
         // Indicate that the back buffer will now be used to present.
         m_commandListSkybox->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_backBuffers[m_frameIndex].Get(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT));
@@ -809,6 +886,69 @@ void Renderer::PopulateCommandList()
     }
 }
 
+void Renderer::UpdateSceneLoading()
+{
+    if (m_modelPinkRoom->IsLoadComplete())
+    {
+        // Textures uploaded during progressive load - heaps are released once, after GPU finished every frame which recorded them
+        if (m_modelPinkRoom->HasUploadHeaps())
+        {
+            WaitForPreviousFrame();
+            m_modelPinkRoom->ReleaseUploadHeaps();
+        }
+        return;
+    }
+
+    // Index buffer, acceleration structures and texture descriptors are rewritten in place below - previous frames still reading them have to finish first.
+    // Uploads recorded by those frames are done then too.
+    WaitForPreviousFrame();
+    m_modelPinkRoom->ReleaseUploadHeaps();
+
+    // New meshes were written into scene buffers - every pass traces its own acceleration structures, all of them are rebuilt
+    const UINT64 textureGeneration = m_modelPinkRoom->GetTextureGeneration();
+    if (m_modelPinkRoom->UpdateProgressiveLoad(m_device, m_commandList))
+    {
+        for (const std::shared_ptr<RaytracingResources>& resources : { m_raytracingGBuffer, m_raytracingAO, m_raytracingLambert, m_raytracingGGX })
+        {
+            resources->RebuildAccelerationStructures(m_commandList);
+        }
+    }
+
+    // Uploaded textures replace placeholders bound to their slots - only G-buffer pass samples model textures
+    if (m_modelPinkRoom->GetTextureGeneration() != textureGeneration)
+    {
+        m_raytracingGBuffer->UpdateTextureViews(m_device.Get(), GetGBufferTextures());
+    }
+}
+
+void Renderer::UpdateRasterInstances()
+{
+    if (m_rasterInstanceGeneration == m_modelPinkRoom->GetLoadGeneration()) {
+        return;
+    }
+    m_rasterInstanceGeneration = m_modelPinkRoom->GetLoadGeneration();
+
+    // Only meshes loaded so far are drawn, empty meshes are skipped like in BLAS build
+    std::vector<bool> loadedMeshes(m_modelPinkRoom->GetMeshCount(), false);
+    const std::vector<UINT32>& loadOrder = m_modelPinkRoom->GetMeshLoadOrder();
+    for (size_t i = 0; i < m_modelPinkRoom->GetLoadedMeshCount(); ++i)
+    {
+        loadedMeshes[loadOrder[i]] = m_modelPinkRoom->GetMeshRanges()[loadOrder[i]].indexCount > 0;
+    }
+
+    m_rasterInstances.clear();
+    for (const ModelClass::MeshInstance& instance : m_modelPinkRoom->GetMeshInstances())
+    {
+        if (!loadedMeshes[instance.meshIndex]) {
+            continue;
+        }
+        RasterInstance rasterInstance;
+        XMStoreFloat4x4(&rasterInstance.world, XMMatrixTranspose(XMLoadFloat4x4(&instance.transform)));
+        rasterInstance.meshIndex = instance.meshIndex;
+        m_rasterInstances.push_back(rasterInstance);
+    }
+}
+
 void Renderer::CloseCommandList()
 {
     ThrowIfFailed(m_commandList->Close());
@@ -1014,10 +1154,10 @@ D3D12_SHADER_RESOURCE_VIEW_DESC Renderer::GetDefaultSkyboxDesc(DXGI_FORMAT forma
     return skyboxDesc;
 }
 
-D3D12_SHADER_RESOURCE_VIEW_DESC Renderer::GetDefaultSRVTexture2DDesc(DXGI_FORMAT format) const
+D3D12_SHADER_RESOURCE_VIEW_DESC Renderer::GetDefaultSRVTexture2DDesc(DXGI_FORMAT format, UINT mipLevels) const
 {
     D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = { format, D3D12_SRV_DIMENSION_TEXTURE2D, D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING };
-    srvDesc.Texture2D.MipLevels = 1;
+    srvDesc.Texture2D.MipLevels = mipLevels;
     return srvDesc;
 }
 
@@ -1048,12 +1188,44 @@ D3D12_SHADER_RESOURCE_VIEW_DESC Renderer::GetIndexBufferSRVDesc(ModelClass* mode
     indexSRVDesc.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_RAW;
     indexSRVDesc.Buffer.StructureByteStride = 0;
     indexSRVDesc.Buffer.FirstElement = 0;
-    indexSRVDesc.Buffer.NumElements = model == nullptr ? 0 : (model->GetIndicesCount() * sizeof(UINT)) / sizeof(float);
+    // Raw view counts 32 bit elements, 16 bit buffer with odd index count is rounded up
+    indexSRVDesc.Buffer.NumElements = model == nullptr ? 0 : (model->GetIndexBufferView().SizeInBytes + sizeof(UINT) - 1) / sizeof(UINT);
     indexSRVDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
 
     return indexSRVDesc;
 }
 
+// Material views are created once with the pipeline - progressively loaded model fills both buffers for every mesh up front,
+// so chunks published later don't need them refreshed
+D3D12_SHADER_RESOURCE_VIEW_DESC Renderer::GetMaterialBufferSRVDesc(ModelClass* model)
+{
+    D3D12_SHADER_RESOURCE_VIEW_DESC materialSRVDesc;
+    materialSRVDesc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
+    materialSRVDesc.Format = DXGI_FORMAT_UNKNOWN;
+    materialSRVDesc.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_NONE;
+    materialSRVDesc.Buffer.StructureByteStride = sizeof(ModelClass::Material);
+    materialSRVDesc.Buffer.FirstElement = 0;
+    materialSRVDesc.Buffer.NumElements = model == nullptr ? 0 : static_cast<UINT>(model->GetMaterials().size());
+    materialSRVDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+
+    return materialSRVDesc;
+}
+
+D3D12_SHADER_RESOURCE_VIEW_DESC Renderer::GetTriangleMaterialBufferSRVDesc(ModelClass* model)
+{
+    D3D12_SHADER_RESOURCE_VIEW_DESC triangleSRVDesc;
+    triangleSRVDesc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
+    // Typed view widens R16 material indices to uint in shader
+    triangleSRVDesc.Format = model == nullptr ? DXGI_FORMAT_R16_UINT : model->GetTriangleMaterialFormat();
+    triangleSRVDesc.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_NONE;
+    triangleSRVDesc.Buffer.StructureByteStride = 0;
+    triangleSRVDesc.Buffer.FirstElement = 0;
+    triangleSRVDesc.Buffer.NumElements = model == nullptr || !model->GetTriangleMaterialBuffer() ? 0 : static_cast<UINT>(model->GetIndicesCount() / 3);
+    triangleSRVDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+
+    return triangleSRVDesc;
+}
+
 D3D12_SHADER_RESOURCE_VIEW_DESC Renderer::GetAccelerationStructureDesc(ComPtr<ID3D12Resource>& tlasResult)
 {
     D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc;
@@ -1085,8 +1257,7 @@ BasicInputLayout Renderer::CreateBasicInputLayout()
         { "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
         { "TANGENT", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 24, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
         { "BINORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 36, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-        { "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 48, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-        { "TEXCOORD", 1, DXGI_FORMAT_R32_UINT, 0, 56, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
+        { "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 48, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
     };
 
     BasicInputLayout arr;
@@ -1170,19 +1341,11 @@ void Renderer::PrepareRaytracingResources(const std::shared_ptr<ModelClass> mode
     RtProgram rayGenShader, missShader;
     HitProgram hitShader;
 
+    // Hit shader selects fractional mip level by ray cone, blended between mips
     std::vector<CD3DX12_STATIC_SAMPLER_DESC> samplers(1);
-    samplers[0].Init(0, D3D12_FILTER_MIN_MAG_LINEAR_MIP_POINT);
+    samplers[0].Init(0, D3D12_FILTER_MIN_MAG_MIP_LINEAR);
 
-    // UAV
-    std::vector<TextureWithDesc> textures{};
-    textures.push_back({ TextureWithDesc{m_rtNormalTexture, GetAccessViewDesc(DXGI_FORMAT_UNKNOWN, D3D12_UAV_DIMENSION_TEXTURE2D)} });
-    textures.push_back({ TextureWithDesc{m_rtAlbedoTexture, GetAccessViewDesc(DXGI_FORMAT_UNKNOWN, D3D12_UAV_DIMENSION_TEXTURE2D)} });
-    textures.push_back({ TextureWithDesc{m_rtSpecularTexture, GetAccessViewDesc(DXGI_FORMAT_UNKNOWN, D3D12_UAV_DIMENSION_TEXTURE2D)} });
-    // SRV
-    textures.push_back({ TextureWithDesc{m_skyboxTexture, GetDefaultSkyboxDesc() } });
-    textures.push_back({ TextureWithDesc{m_modelPinkRoom->GetTextureResourcesAlbedo(), GetDefaultSRVTexture2DDesc() } });
-    textures.push_back({ TextureWithDesc{m_modelPinkRoom->GetTextureResourcesSpecular(), GetDefaultSRVTexture2DDesc() } });
-    textures.push_back({ TextureWithDesc{m_modelPinkRoom->GetTextureResourcesNormal(), GetDefaultSRVTexture2DDesc() } });
+    std::vector<TextureWithDesc> textures = GetGBufferTextures();
 
     // Craete specular texture ID offset
     m_sceneBuffer.value.specularIndex = static_cast<int>(m_modelPinkRoom->GetTextureResourcesAlbedo().size());
@@ -1194,7 +1357,28 @@ void Renderer::PrepareRaytracingResources(const std::shared_ptr<ModelClass> mode
     CreateClosestHitShader(hitShader, m_shaderCompiler, L"Shaders/RT_gBuffer.hlsl", L"ClosestHit");
     m_raytracingGBuffer = std::shared_ptr<RaytracingResources>(new RaytracingResources(m_device.Get(), m_commandList, model, rayGenShader, missShader, hitShader, L"Group_gBuffer"));
 
-    CreateRaytracingPipeline(m_raytracingGBuffer.get(), m_device.Get(), model.get(), textures, GetIndexBufferSRVDesc(model.get()), GetVertexBufferSRVDesc(model.get(), sizeof(ModelClass::VertexBufferStruct)), m_sceneBuffer, m_cameraBuffer, { }, sizeof(int));
+    CreateRaytracingPipeline(m_raytracingGBuffer.get(), m_device.Get(), model.get(), textures, GetIndexBufferSRVDesc(model.get()), GetVertexBufferSRVDesc(model.get(), model->GetRaytracingVertexStride()), m_sceneBuffer, m_cameraBuffer, { }, sizeof(int));
+}
+
+std::vector<TextureWithDesc> Renderer::GetGBufferTextures()
+{
+    // UAV
+    std::vector<TextureWithDesc> textures{};
+    textures.push_back({ TextureWithDesc{m_rtNormalTexture, GetAccessViewDesc(DXGI_FORMAT_UNKNOWN, D3D12_UAV_DIMENSION_TEXTURE2D)} });
+    textures.push_back({ TextureWithDesc{m_rtAlbedoTexture, GetAccessViewDesc(DXGI_FORMAT_UNKNOWN, D3D12_UAV_DIMENSION_TEXTURE2D)} });
+    textures.push_back({ TextureWithDesc{m_rtSpecularTexture, GetAccessViewDesc(DXGI_FORMAT_UNKNOWN, D3D12_UAV_DIMENSION_TEXTURE2D)} });
+    // SRV
+    textures.push_back({ TextureWithDesc{m_skyboxTexture, GetDefaultSkyboxDesc() } });
+    // Material table and material index of every triangle replace texture IDs stored in vertices
+    ComPtr<ID3D12Resource> materialBuffer = m_modelPinkRoom->GetMaterialBuffer();
+    ComPtr<ID3D12Resource> triangleMaterialBuffer = m_modelPinkRoom->GetTriangleMaterialBuffer();
+    textures.push_back({ TextureWithDesc{materialBuffer, GetMaterialBufferSRVDesc(m_modelPinkRoom.get()) } });
+    textures.push_back({ TextureWithDesc{triangleMaterialBuffer, GetTriangleMaterialBufferSRVDesc(m_modelPinkRoom.get()) } });
+    textures.push_back({ TextureWithDesc{m_modelPinkRoom->GetTextureResourcesAlbedo(), GetDefaultSRVTexture2DDesc(DXGI_FORMAT_R8G8B8A8_UNORM, MODEL_TEXTURE_MIP_LEVELS) } });
+    textures.push_back({ TextureWithDesc{m_modelPinkRoom->GetTextureResourcesSpecular(), GetDefaultSRVTexture2DDesc(DXGI_FORMAT_R8G8B8A8_UNORM, MODEL_TEXTURE_MIP_LEVELS) } });
+    textures.push_back({ TextureWithDesc{m_modelPinkRoom->GetTextureResourcesNormal(), GetDefaultSRVTexture2DDesc(DXGI_FORMAT_R8G8B8A8_UNORM, MODEL_TEXTURE_MIP_LEVELS) } });
+
+    return textures;
 }
 
 void Renderer::PrepareRaytracingResourcesAO(const std::shared_ptr<ModelClass> model)
@@ -1215,7 +1399,7 @@ void Renderer::PrepareRaytracingResourcesAO(const std::shared_ptr<ModelClass> mo
     CreateClosestHitShader(hitShader, m_shaderCompiler, L"Shaders/RT_AO.hlsl", L"ClosestHit");
     m_raytracingAO = std::shared_ptr<RaytracingResources>(new RaytracingResources(m_device.Get(), m_commandList, model, rayGenShader, missShader, hitShader, L"GroupAO"));
 
-    CreateRaytracingPipeline(m_raytracingAO.get(), m_device.Get(), model.get(), textures, GetIndexBufferSRVDesc(model.get()), GetVertexBufferSRVDesc(model.get(), sizeof(ModelClass::VertexBufferStruct)), m_sceneBuffer, m_cameraBuffer, m_aoBuffer, {}, sizeof(XMFLOAT4) * 2);
+    CreateRaytracingPipeline(m_raytracingAO.get(), m_device.Get(), model.get(), textures, GetIndexBufferSRVDesc(model.get()), GetVertexBufferSRVDesc(model.get(), model->GetRaytracingVertexStride()), m_sceneBuffer, m_cameraBuffer, m_aoBuffer, {}, sizeof(XMFLOAT4) * 2);
 }
 
 void Renderer::PrepareRaytracingResourcesLambert(const std::shared_ptr<ModelClass> model)
@@ -1250,7 +1434,7 @@ void Renderer::PrepareRaytracingResourcesLambert(const std::shared_ptr<ModelClas
 
     m_raytracingLambert = std::shared_ptr<RaytracingResources>(new RaytracingResources(m_device.Get(), m_commandList, model, { group, groupIndirect}));
 
-    CreateRaytracingPipeline(m_raytracingLambert.get(), m_device.Get(), model.get(), textures, GetIndexBufferSRVDesc(model.get()), GetVertexBufferSRVDesc(model.get(), sizeof(ModelClass::VertexBufferStruct)), m_sceneBuffer, m_cameraBuffer, m_giBuffer, m_lightBuffer, {}, sizeof(XMFLOAT4) * 3);
+    CreateRaytracingPipeline(m_raytracingLambert.get(), m_device.Get(), model.get(), textures, GetIndexBufferSRVDesc(model.get()), GetVertexBufferSRVDesc(model.get(), model->GetRaytracingVertexStride()), m_sceneBuffer, m_cameraBuffer, m_giBuffer, m_lightBuffer, {}, sizeof(XMFLOAT4) * 3);
 }
 
 void Renderer::PrepareRaytracingResourcesGGX(const std::shared_ptr<ModelClass> model)
@@ -1286,7 +1470,7 @@ void Renderer::PrepareRaytracingResourcesGGX(const std::shared_ptr<ModelClass> m
 
     m_raytracingGGX = std::shared_ptr<RaytracingResources>(new RaytracingResources(m_device.Get(), m_commandList, model, { group, groupIndirect }));
 
-    CreateRaytracingPipeline(m_raytracingGGX.get(), m_device.Get(), model.get(), textures, GetIndexBufferSRVDesc(model.get()), GetVertexBufferSRVDesc(model.get(), sizeof(ModelClass::VertexBufferStruct)), m_sceneBuffer, m_cameraBuffer, m_giBuffer, m_lightBuffer, {}, sizeof(XMFLOAT4) * 3);
+    CreateRaytracingPipeline(m_raytracingGGX.get(), m_device.Get(), model.get(), textures, GetIndexBufferSRVDesc(model.get()), GetVertexBufferSRVDesc(model.get(), model->GetRaytracingVertexStride()), m_sceneBuffer, m_cameraBuffer, m_giBuffer, m_lightBuffer, {}, sizeof(XMFLOAT4) * 3);
 }
 
 void Renderer::CreateRayGenShader(RtProgram& shader, D3D12ShaderCompilerInfo& shaderCompiler, const wchar_t* path, int cbvDescriptors, std::vector<TextureWithDesc> textures, std::vector<CD3DX12_STATIC_SAMPLER_DESC> samplers, LPCWSTR name, LPCWSTR nameToExport)
@@ -1331,7 +1515,7 @@ void Renderer::CreateRayGenShader(RtProgram& shader, D3D12ShaderCompilerInfo& sh
 void Renderer::CreateRayGenShader(RtProgram& shader, D3D12ShaderCompilerInfo& shaderCompiler, const wchar_t* path, std::vector<D3D12_DESCRIPTOR_RANGE> ranges, std::vector<CD3DX12_STATIC_SAMPLER_DESC> samplers, LPCWSTR name, LPCWSTR nameToExport)
 {
     // Load and compile the ray generation shader
-    shader = RtProgram(D3D12ShaderInfo(path, L"", L"lib_6_3"));
+    shader = RtProgram(GetRaytracingShaderInfo(path));
     shader.name = name;
     shader.exportToRename = nameToExport;
     Compile_Shader(shaderCompiler, shader);
@@ -1351,7 +1535,7 @@ void Renderer::CreateRayGenShader(RtProgram& shader, D3D12ShaderCompilerInfo& sh
 void Renderer::CreateMissShader(RtProgram& shader, D3D12ShaderCompilerInfo& shaderCompiler, const wchar_t* path, LPCWSTR name, LPCWSTR nameToExport) const
 {
     // Load and compile the miss shader
-    shader = RtProgram(D3D12ShaderInfo(path, L"", L"lib_6_3"));
+    shader = RtProgram(GetRaytracingShaderInfo(path));
     shader.name = name;
     shader.exportToRename = nameToExport;
     Compile_Shader(shaderCompiler, shader);
@@ -1360,7 +1544,7 @@ void Renderer::CreateMissShader(RtProgram& shader, D3D12ShaderCompilerInfo& shad
 void Renderer::CreateClosestHitShader(HitProgram& shader, D3D12ShaderCompilerInfo& shaderCompiler, const wchar_t* path, LPCWSTR name, LPCWSTR nameToExport) const
 {
     // Load and compile the Closest Hit shader
-    shader.chs = RtProgram(D3D12ShaderInfo(path, L"", L"lib_6_3"));
+    shader.chs = RtProgram(GetRaytracingShaderInfo(path));
     shader.chs.name = name;
     shader.chs.exportToRename = nameToExport;
     Compile_Shader(shaderCompiler, shader.chs);
@@ -1369,12 +1553,20 @@ void Renderer::CreateClosestHitShader(HitProgram& shader, D3D12ShaderCompilerInf
 void Renderer::CreateAnyHitShader(HitProgram& shader, D3D12ShaderCompilerInfo& shaderCompiler, const wchar_t* path, LPCWSTR name, LPCWSTR nameToExport) const
 {    
     // Load and compile the Any Hit shader
-    shader.ahs = RtProgram(D3D12ShaderInfo(path, L"", L"lib_6_3"));
+    shader.ahs = RtProgram(GetRaytracingShaderInfo(path));
     shader.ahs.name = name;
     shader.ahs.exportToRename = nameToExport;
     Compile_Shader(shaderCompiler, shader.ahs);
 }
 
+D3D12ShaderInfo Renderer::GetRaytracingShaderInfo(const wchar_t* path) const
+{
+    D3D12ShaderInfo info(path, L"", L"lib_6_3");
+    info.defines = m_raytracingShaderDefines.empty() ? nullptr : m_raytracingShaderDefines.data();
+    info.defineCount = static_cast<UINT32>(m_raytracingShaderDefines.size());
+    return info;
+}
+
 void Renderer::InitShaderCompiler(D3D12ShaderCompilerInfo& shaderCompiler) const 
 {
     ThrowIfFailed(shaderCompiler.DxcDllHelper.Initialize());
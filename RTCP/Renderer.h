@@ -16,7 +16,7 @@
 #include "LightSettings.h"
 
 using namespace DirectX;
-typedef std::array<D3D12_INPUT_ELEMENT_DESC, 6> BasicInputLayout;
+typedef std::array<D3D12_INPUT_ELEMENT_DESC, 5> BasicInputLayout;
 struct WindowSize {
 	int x, y;
 };
@@ -57,6 +57,8 @@ private:
 
 	// Executing commands/synchronization functions
 	void PopulateCommandList();
+	void UpdateSceneLoading();
+	void UpdateRasterInstances();
 	void CloseCommandList();
 	void WaitForPreviousFrame();
 	void MoveToNextFrame();
@@ -79,9 +81,11 @@ private:
 	static void CreateSRV_TextureCube(ComPtr<ID3D12Resource>& resource, ID3D12DescriptorHeap* srvHeap, int srvIndex, ID3D12Device* device, int mipLevels = 1, D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = { DXGI_FORMAT_R8G8B8A8_UNORM, D3D12_SRV_DIMENSION_TEXTURECUBE, D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING });
 
 	D3D12_SHADER_RESOURCE_VIEW_DESC GetDefaultSkyboxDesc(DXGI_FORMAT format = DXGI_FORMAT_R8G8B8A8_UNORM) const;
-	D3D12_SHADER_RESOURCE_VIEW_DESC GetDefaultSRVTexture2DDesc(DXGI_FORMAT format = DXGI_FORMAT_R8G8B8A8_UNORM) const;
+	D3D12_SHADER_RESOURCE_VIEW_DESC GetDefaultSRVTexture2DDesc(DXGI_FORMAT format = DXGI_FORMAT_R8G8B8A8_UNORM, UINT mipLevels = 1) const;
 	D3D12_SHADER_RESOURCE_VIEW_DESC GetVertexBufferSRVDesc(ModelClass* model, UINT vertexStructSize);
 	D3D12_SHADER_RESOURCE_VIEW_DESC GetIndexBufferSRVDesc(ModelClass* model);
+	D3D12_SHADER_RESOURCE_VIEW_DESC GetMaterialBufferSRVDesc(ModelClass* model);
+	D3D12_SHADER_RESOURCE_VIEW_DESC GetTriangleMaterialBufferSRVDesc(ModelClass* model);
 	template <class T>
 	D3D12_CONSTANT_BUFFER_VIEW_DESC GetConstantBufferViewDesc(CBuffer<T> cbuffer);
 	D3D12_SHADER_RESOURCE_VIEW_DESC GetAccelerationStructureDesc(ComPtr<ID3D12Resource>& tlasResult);
@@ -95,12 +99,15 @@ private:
 	// Compiling shaders
 	void InitShaderCompiler(D3D12ShaderCompilerInfo& shaderCompiler) const;
 	void Compile_Shader(D3D12ShaderCompilerInfo& compilerInfo, D3D12ShaderInfo& info, IDxcBlob** blob) const;
+	D3D12ShaderInfo GetRaytracingShaderInfo(const wchar_t* path) const;
 	void Compile_Shader(D3D12ShaderCompilerInfo& compilerInfo, RtProgram& program) const;
 	void Compile_Shader(_In_ LPCWSTR pFileName, _In_reads_opt_(_Inexpressible_(pDefines->Name != NULL)) CONST D3D_SHADER_MACRO* pDefines, _In_opt_ ID3DInclude* pInclude, _In_ LPCSTR pEntrypoint, _In_ LPCSTR pTarget, _In_ UINT Flags1, _In_ UINT Flags2, _Out_ ID3DBlob** ppCode) const;
 
 #pragma region Raytracing functions
 	// Main function, invoked to prepare DXR pipeline
 	void PrepareRaytracingResources(const std::shared_ptr<ModelClass> model);
+	// Output, skybox, material and model textures of G-buffer pass, in order of its descriptors
+	std::vector<TextureWithDesc> GetGBufferTextures();
 	void PrepareRaytracingResourcesAO(const std::shared_ptr<ModelClass> model);
 	void PrepareRaytracingResourcesLambert(const std::shared_ptr<ModelClass> model);
 	void PrepareRaytracingResourcesGGX(const std::shared_ptr<ModelClass> model);
@@ -119,6 +126,8 @@ private:
 	// CONST PROPERTIES
 	static constexpr float Z_NEAR = 10.f;
 	static constexpr float Z_FAR = 20000.0f;
+	// Views of model textures expose whole mip chain - compressed DDS textures carry full chain, others have single mip
+	static constexpr UINT MODEL_TEXTURE_MIP_LEVELS = static_cast<UINT>(-1);
 	static constexpr int m_frameCount = 2;
 	static constexpr int m_windowWidth = 1920;
 	static constexpr int m_windowHeight = 1080;
@@ -143,6 +152,18 @@ private:
 	bool SAMPLE_UNIFORM = false;
 	bool SAMPLE_RANDOM = false;
 
+	// Vertex layout read by raytracing shaders - packed formats reduce geometry memory and hit shader fetch
+	VertexFormat RAYTRACING_VERTEX_FORMAT = VertexFormat::Full;
+	// BLAS is built from position only stream, hit shaders read remaining attributes from separate stream
+	bool SPLIT_VERTEX_STREAMS = false;
+	// Scene meshes are published in chunks over first frames, closest to the camera first - GPU is waited for before every chunk
+	bool PROGRESSIVE_LOADING = false;
+	// Compare analytic sphere and box with tessellated sphere.obj and cube.obj after load - rays per second, hits and memory
+	bool BENCHMARK_ANALYTIC_PRIMITIVES = false;
+	// Replace SunTemple by generated scene for scaling studies - lights come from the generator and are saved to their own file
+	bool PROCEDURAL_SCENE = false;
+	SceneGenerator::Settings PROCEDURAL_SCENE_SETTINGS;
+
 	// Frame data
 	UINT64 m_currentCPUFrame = 0;
 	UINT64 m_currentGPUFrame = 0;
@@ -230,6 +251,14 @@ private:
 	std::shared_ptr<ModelClass> m_modelBuddha = NULL;
 	std::shared_ptr<ModelClass> m_modelPinkRoom = NULL;
 	std::shared_ptr<ModelClass> m_modelFullscreen = NULL;
+
+	// Rasterized placements of loaded scene meshes - same instances as TLAS, rebuilt when load generation changes
+	struct RasterInstance {
+		XMFLOAT4X4 world;	// Transposed for shader
+		UINT32 meshIndex;
+	};
+	std::vector<RasterInstance> m_rasterInstances;
+	UINT64 m_rasterInstanceGeneration = UINT64_MAX;
 #pragma endregion
 	
 #pragma region Raytracing variables
@@ -249,6 +278,8 @@ private:
 
 	// Shader compiler
 	D3D12ShaderCompilerInfo m_shaderCompiler{};
+	// Defines passed to every raytracing shader - VERTEX_FORMAT matching model's raytracing vertex buffer
+	std::vector<DxcDefine> m_raytracingShaderDefines;
 #pragma endregion
 
 	// Synchronization
@@ -0,0 +1,62 @@
+#include "RequestQueue.h"
+#include <algorithm>
+#include <cassert>
+
+void RequestQueue::Push(RequestID id, float priority)
+{
+	const bool inserted = m_priorities.emplace(id, priority).second;
+	assert(inserted && "Request is already queued");
+	(void)inserted;
+	PushEntry(id, priority);
+}
+
+bool RequestQueue::UpdatePriority(RequestID id, float priority)
+{
+	const auto it = m_priorities.find(id);
+	if (it == m_priorities.end()) {
+		return false;
+	}
+	if (it->second != priority)
+	{
+		it->second = priority;
+		PushEntry(id, priority);
+	}
+	return true;
+}
+
+bool RequestQueue::Pop(RequestID& id)
+{
+	while (!m_heap.empty())
+	{
+		std::pop_heap(m_heap.begin(), m_heap.end());
+		const Entry entry = m_heap.back();
+		m_heap.pop_back();
+
+		const auto it = m_priorities.find(entry.id);
+		if (it == m_priorities.end() || it->second != entry.priority) {
+			continue;
+		}
+		m_priorities.erase(it);
+		id = entry.id;
+		return true;
+	}
+	return false;
+}
+
+void RequestQueue::PushEntry(RequestID id, float priority)
+{
+	// Requests reprioritized every frame would grow heap without bound - it's rebuilt from live requests once stale entries dominate
+	if (m_heap.size() >= 64 && m_heap.size() > 2 * m_priorities.size())
+	{
+		m_heap.clear();
+		for (const auto& request : m_priorities)
+		{
+			if (request.first != id) {
+				m_heap.push_back({ request.second, request.first });
+			}
+		}
+		std::make_heap(m_heap.begin(), m_heap.end());
+	}
+	m_heap.push_back({ priority, id });
+	std::push_heap(m_heap.begin(), m_heap.end());
+}
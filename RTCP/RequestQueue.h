@@ -0,0 +1,45 @@
+#pragma once
+#ifndef _REQUEST_QUEUE_H_
+#define _REQUEST_QUEUE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Priority queue of request IDs whose priority may change while they wait, used by TextureStreamer. Doesn't depend on Windows or D3D12 headers, like IndexCompactor.
+// Higher priority is popped first, equal priorities in order of IDs - i.e. request order, not order in which requests were pushed.
+// Reprioritized request gets new heap entry, the old one stays in the heap as stale and is skipped by Pop. Not thread safe.
+class RequestQueue
+{
+public:
+	typedef uint32_t RequestID;
+
+	// Request must not be queued already
+	void Push(RequestID id, float priority);
+	// Returns false if request isn't queued
+	bool UpdatePriority(RequestID id, float priority);
+	// Removes request with highest priority - returns false if no request is queued
+	bool Pop(RequestID& id);
+
+	bool IsEmpty() const { return m_priorities.empty(); }
+	size_t GetSize() const { return m_priorities.size(); }
+	// Heap entries including stale ones
+	size_t GetEntryCount() const { return m_heap.size(); }
+
+private:
+	struct Entry {
+		float priority;
+		RequestID id;
+		bool operator<(const Entry& other) const { return priority < other.priority || (priority == other.priority && id > other.id); }
+	};
+
+	void PushEntry(RequestID id, float priority);
+
+private:
+	std::vector<Entry> m_heap;
+	// Current priority of every queued request - heap entry with different priority is stale
+	std::unordered_map<RequestID, float> m_priorities;
+};
+
+#endif // !_REQUEST_QUEUE_H_
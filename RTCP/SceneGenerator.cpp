@@ -0,0 +1,390 @@
+#include "SceneGenerator.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	uint64_t Mix(uint64_t x)
+	{
+		x += 0x9E3779B97F4A7C15ull;
+		x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+		x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+		return x ^ (x >> 31);
+	}
+
+	void Normalize(float vector[3])
+	{
+		const float length = std::sqrt(vector[0] * vector[0] + vector[1] * vector[1] + vector[2] * vector[2]);
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			vector[axis] /= length;
+		}
+	}
+
+	void Cross(const float a[3], const float b[3], float result[3])
+	{
+		result[0] = a[1] * b[2] - a[2] * b[1];
+		result[1] = a[2] * b[0] - a[0] * b[2];
+		result[2] = a[0] * b[1] - a[1] * b[0];
+	}
+
+	template <typename T>
+	void HashBytes(uint64_t& hash, const std::vector<T>& data)
+	{
+		const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data.data());
+		for (size_t i = 0; i < sizeof(T) * data.size(); ++i)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+	}
+}
+
+SceneGenerator::Layout SceneGenerator::Plan(const Settings& settings)
+{
+	assert(settings.triangleCount > 0 && "Scene needs at least one triangle");
+	const size_t meshCount = std::max<size_t>(std::min(settings.meshCount, settings.triangleCount), 1);
+	const size_t width = GetPatchWidth(settings);
+	const size_t fullPatchVertexCount = GetPatchVertexCount(PATCH_TRIANGLES, width);
+
+	Layout layout;
+	layout.meshes.resize(meshCount);
+	for (size_t i = 0; i < meshCount; ++i)
+	{
+		const size_t triangleCount = GetMeshTriangleCount(settings, meshCount, i);
+		const size_t remainder = triangleCount % PATCH_TRIANGLES;
+		const size_t vertexCount = (triangleCount / PATCH_TRIANGLES) * fullPatchVertexCount + (remainder > 0 ? GetPatchVertexCount(remainder, width) : 0);
+		assert(layout.vertexCount + vertexCount <= UINT32_MAX && layout.indexCount + triangleCount * 3 <= UINT32_MAX && "Scene has to be addressable by 32 bit offsets");
+		layout.meshes[i] = { static_cast<uint32_t>(layout.vertexCount), static_cast<uint32_t>(vertexCount), static_cast<uint32_t>(layout.indexCount), static_cast<uint32_t>(triangleCount * 3) };
+		layout.vertexCount += vertexCount;
+		layout.indexCount += triangleCount * 3;
+	}
+	return layout;
+}
+
+void SceneGenerator::GenerateMesh(const Settings& settings, const Layout& layout, size_t meshIndex, Vertex* vertices, uint32_t* indices)
+{
+	assert(meshIndex < layout.meshes.size());
+	const MeshRange& range = layout.meshes[meshIndex];
+	Random random{ settings.seed, STREAM_MESH_GEOMETRY, meshIndex };
+	float center[3];
+	GetMeshCenter(settings, meshIndex, center);
+
+	// Patch size scales with 1 / sqrt(patch count), so total surface area and depth complexity of mesh don't depend on triangle count
+	const float meshExtent = GetMeshExtent(settings, layout.meshes.size());
+	const size_t triangleCount = range.indexCount / 3;
+	const size_t patchCount = (triangleCount + PATCH_TRIANGLES - 1) / PATCH_TRIANGLES;
+	const float patchSize = 3.0f * meshExtent / std::sqrt(static_cast<float>(patchCount));
+	const size_t width = GetPatchWidth(settings);
+
+	size_t vertexOffset = range.vertexOffset;
+	size_t indexOffset = range.indexOffset;
+	for (size_t patch = 0; patch < patchCount; ++patch)
+	{
+		float patchCenter[3];
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			patchCenter[axis] = center[axis] + (settings.distribution == Distribution::Clustered ? random.NextGaussian() * meshExtent * 0.125f : random.NextFloat(-0.5f, 0.5f) * meshExtent);
+		}
+		const size_t patchTriangles = std::min(static_cast<size_t>(PATCH_TRIANGLES), triangleCount - patch * PATCH_TRIANGLES);
+		GeneratePatch(settings, random, patchCenter, patchSize, patchTriangles, vertices + vertexOffset, indices + indexOffset, static_cast<uint32_t>(vertexOffset));
+		vertexOffset += GetPatchVertexCount(patchTriangles, width);
+		indexOffset += patchTriangles * 3;
+	}
+	assert(vertexOffset == range.vertexOffset + range.vertexCount && indexOffset == range.indexOffset + range.indexCount && "Generated mesh doesn't match its planned range");
+}
+
+std::vector<SceneGenerator::Material> SceneGenerator::GenerateMaterials(const Settings& settings)
+{
+	std::vector<Material> materials(std::max<size_t>(settings.materialCount, 1));
+	for (size_t i = 0; i < materials.size(); ++i)
+	{
+		Random random{ settings.seed, STREAM_MATERIALS, i };
+		for (int channel = 0; channel < 3; ++channel)
+		{
+			materials[i].albedo[channel] = random.NextFloat(0.2f, 0.9f);
+		}
+		materials[i].specular = random.NextFloat();
+	}
+	return materials;
+}
+
+uint32_t SceneGenerator::GetMeshMaterial(const Settings& settings, size_t meshIndex)
+{
+	return static_cast<uint32_t>(meshIndex % std::max<size_t>(settings.materialCount, 1));
+}
+
+std::vector<SceneGenerator::Instance> SceneGenerator::GenerateInstances(const Settings& settings, const Layout& layout)
+{
+	const size_t meshCount = layout.meshes.size();
+	std::vector<Instance> instances(std::max(settings.instanceCount, meshCount));
+	for (size_t i = 0; i < instances.size(); ++i)
+	{
+		Instance& instance = instances[i];
+		std::fill(instance.transform, instance.transform + 16, 0.0f);
+		instance.transform[0] = instance.transform[5] = instance.transform[10] = instance.transform[15] = 1.0f;
+		if (i < meshCount)
+		{
+			instance.mesh = static_cast<uint32_t>(i);
+			continue;
+		}
+
+		// Mesh is moved to origin, rotated around Y and moved to new position - rotation is random unit vector, not angle, to avoid sine and cosine
+		Random random{ settings.seed, STREAM_INSTANCES, i };
+		instance.mesh = static_cast<uint32_t>(random.Next() % meshCount);
+		float cosine;
+		float sine;
+		float lengthSquared;
+		do {
+			cosine = random.NextFloat(-1.0f, 1.0f);
+			sine = random.NextFloat(-1.0f, 1.0f);
+			lengthSquared = cosine * cosine + sine * sine;
+		} while (lengthSquared > 1.0f || lengthSquared < 1e-4f);
+		const float length = std::sqrt(lengthSquared);
+		cosine /= length;
+		sine /= length;
+		float meshCenter[3];
+		float position[3];
+		GetMeshCenter(settings, instance.mesh, meshCenter);
+		GetScenePoint(settings, random, position);
+
+		// Row vectors - v' = v * R + t, R is XMMatrixRotationY
+		instance.transform[0] = cosine;
+		instance.transform[2] = -sine;
+		instance.transform[8] = sine;
+		instance.transform[10] = cosine;
+		instance.transform[12] = -meshCenter[0] * cosine - meshCenter[2] * sine + position[0];
+		instance.transform[13] = -meshCenter[1] + position[1];
+		instance.transform[14] = meshCenter[0] * sine - meshCenter[2] * cosine + position[2];
+	}
+	return instances;
+}
+
+std::vector<SceneGenerator::Light> SceneGenerator::GenerateLights(const Settings& settings)
+{
+	std::vector<Light> lights(settings.lightCount);
+	for (size_t i = 0; i < lights.size(); ++i)
+	{
+		Random random{ settings.seed, STREAM_LIGHTS, i };
+		Light& light = lights[i];
+		if (i == 0)
+		{
+			// Sun from upper hemisphere
+			light.type = LightType::Directional;
+			random.NextDirection(light.position);
+			light.position[1] = std::fabs(light.position[1]);
+			light.color[0] = 1.0f;
+			light.color[1] = random.NextFloat(0.85f, 1.0f);
+			light.color[2] = random.NextFloat(0.7f, 0.95f);
+		}
+		else
+		{
+			light.type = LightType::Point;
+			GetScenePoint(settings, random, light.position);
+			for (int channel = 0; channel < 3; ++channel)
+			{
+				light.color[channel] = random.NextFloat(0.5f, 1.0f);
+			}
+		}
+		light.color[3] = 1.0f;
+	}
+	return lights;
+}
+
+SceneGenerator::Scene SceneGenerator::Generate(const Settings& settings)
+{
+	Scene scene;
+	scene.layout = Plan(settings);
+	scene.vertices.resize(scene.layout.vertexCount);
+	scene.indices.resize(scene.layout.indexCount);
+	scene.meshMaterials.resize(scene.layout.meshes.size());
+	for (size_t i = 0; i < scene.layout.meshes.size(); ++i)
+	{
+		GenerateMesh(settings, scene.layout, i, scene.vertices.data(), scene.indices.data());
+		scene.meshMaterials[i] = GetMeshMaterial(settings, i);
+	}
+	scene.materials = GenerateMaterials(settings);
+	scene.instances = GenerateInstances(settings, scene.layout);
+	scene.lights = GenerateLights(settings);
+	return scene;
+}
+
+uint64_t SceneGenerator::Checksum(const Scene& scene)
+{
+	uint64_t hash = 14695981039346656037ull;
+	HashBytes(hash, scene.layout.meshes);
+	HashBytes(hash, scene.vertices);
+	HashBytes(hash, scene.indices);
+	HashBytes(hash, scene.materials);
+	HashBytes(hash, scene.meshMaterials);
+	HashBytes(hash, scene.instances);
+	HashBytes(hash, scene.lights);
+	return hash;
+}
+
+size_t SceneGenerator::GetMeshTriangleCount(const Settings& settings, size_t meshCount, size_t meshIndex)
+{
+	return settings.triangleCount / meshCount + (meshIndex < settings.triangleCount % meshCount ? 1 : 0);
+}
+
+size_t SceneGenerator::GetPatchVertexCount(size_t triangleCount, size_t width)
+{
+	const size_t quadCount = (triangleCount + 1) / 2;
+	width = std::min(width, quadCount);
+	const size_t fullRows = quadCount / width;
+	const size_t partialQuads = quadCount % width;
+	return (width + 1) * (fullRows + 1) + (partialQuads > 0 ? partialQuads + 1 : 0);
+}
+
+float SceneGenerator::GetMeshExtent(const Settings& settings, size_t meshCount)
+{
+	// Meshes overlap, total surface of the scene doesn't depend on mesh count
+	return std::min(settings.sceneExtent, 2.0f * settings.sceneExtent / std::sqrt(static_cast<float>(meshCount)));
+}
+
+void SceneGenerator::GetMeshCenter(const Settings& settings, size_t meshIndex, float center[3])
+{
+	Random random{ settings.seed, STREAM_MESH_CENTERS, meshIndex };
+	GetScenePoint(settings, random, center);
+}
+
+void SceneGenerator::GetScenePoint(const Settings& settings, Random& random, float point[3])
+{
+	const float halfExtent = 0.5f * settings.sceneExtent;
+	if (settings.distribution != Distribution::Clustered)
+	{
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			point[axis] = random.NextFloat(-halfExtent, halfExtent);
+		}
+		return;
+	}
+
+	// Cluster centers are shared by the whole scene, points are spread around them
+	Random clusterRandom{ settings.seed, STREAM_CLUSTERS, random.Next() % CLUSTER_COUNT };
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		const float clusterCenter = clusterRandom.NextFloat(-0.8f * halfExtent, 0.8f * halfExtent);
+		point[axis] = clusterCenter + random.NextGaussian() * settings.sceneExtent * 0.0625f;
+	}
+}
+
+void SceneGenerator::GeneratePatch(const Settings& settings, Random& random, const float center[3], float size, size_t triangleCount, Vertex* vertices, uint32_t* indices, uint32_t baseVertex)
+{
+	float normal[3];
+	float tangent[3];
+	float binormal[3];
+	random.NextDirection(normal);
+	BuildBasis(normal, tangent, binormal);
+
+	const bool arch = settings.distribution == Distribution::LongThin;
+	const size_t quadCount = (triangleCount + 1) / 2;
+	const size_t width = std::min(GetPatchWidth(settings), quadCount);
+	const size_t rowCount = (quadCount + width - 1) / width;
+	const size_t partialQuads = quadCount % width;
+	const float step = size / PATCH_WIDTH;
+	for (size_t row = 0; row <= rowCount; ++row)
+	{
+		const size_t rowVertices = row == rowCount && partialQuads > 0 ? partialQuads + 1 : width + 1;
+		for (size_t column = 0; column < rowVertices; ++column)
+		{
+			Vertex& vertex = vertices[row * (width + 1) + column];
+			if (arch)
+			{
+				// Parabola across the rows, every quad spans whole patch size along tangent
+				const float x = -1.0f + 2.0f * row / (PATCH_TRIANGLES / 2);
+				const float along = (static_cast<float>(column) - 0.5f) * size;
+				const float height = (1.0f - x * x) * 0.5f * size;
+				const float length = std::sqrt(1.0f + 4.0f * x * x);
+				for (int axis = 0; axis < 3; ++axis)
+				{
+					vertex.position[axis] = center[axis] + along * tangent[axis] + x * 0.5f * size * binormal[axis] + height * normal[axis];
+					vertex.tangent[axis] = tangent[axis];
+					vertex.binormal[axis] = (binormal[axis] - 2.0f * x * normal[axis]) / length;
+					vertex.normal[axis] = (normal[axis] + 2.0f * x * binormal[axis]) / length;
+				}
+				vertex.uv[0] = static_cast<float>(column);
+				vertex.uv[1] = static_cast<float>(row) / PATCH_WIDTH;
+			}
+			else
+			{
+				for (int axis = 0; axis < 3; ++axis)
+				{
+					vertex.position[axis] = center[axis] + (column * step - 0.5f * size) * tangent[axis] + (row * step - 0.5f * size) * binormal[axis];
+					vertex.tangent[axis] = tangent[axis];
+					vertex.binormal[axis] = binormal[axis];
+					vertex.normal[axis] = normal[axis];
+				}
+				vertex.uv[0] = static_cast<float>(column) / PATCH_WIDTH;
+				vertex.uv[1] = static_cast<float>(row) / PATCH_WIDTH;
+			}
+		}
+	}
+
+	// Clockwise seen from the normal side in left handed space, like imported meshes - odd triangle count leaves last vertex unreferenced
+	for (size_t quad = 0; quad < quadCount; ++quad)
+	{
+		const uint32_t a = baseVertex + static_cast<uint32_t>((quad / width) * (width + 1) + quad % width);
+		const uint32_t b = a + 1;
+		const uint32_t c = a + static_cast<uint32_t>(width + 1);
+		const uint32_t d = c + 1;
+		uint32_t* triangle = indices + quad * 6;
+		triangle[0] = a;
+		triangle[1] = b;
+		triangle[2] = c;
+		if (quad * 2 + 1 < triangleCount)
+		{
+			triangle[3] = b;
+			triangle[4] = d;
+			triangle[5] = c;
+		}
+	}
+}
+
+void SceneGenerator::BuildBasis(const float normal[3], float tangent[3], float binormal[3])
+{
+	// cross(tangent, binormal) == normal
+	const float up[3] = { 0.0f, 1.0f, 0.0f };
+	const float right[3] = { 1.0f, 0.0f, 0.0f };
+	Cross(std::fabs(normal[1]) < 0.9f ? up : right, normal, tangent);
+	Normalize(tangent);
+	Cross(normal, tangent, binormal);
+}
+
+SceneGenerator::Random::Random(uint64_t seed, uint64_t stream, uint64_t index)
+	: m_state(Mix(Mix(seed ^ Mix(stream)) + index))
+{
+}
+
+uint64_t SceneGenerator::Random::Next()
+{
+	const uint64_t value = Mix(m_state);
+	m_state += 0x9E3779B97F4A7C15ull;
+	return value;
+}
+
+float SceneGenerator::Random::NextFloat()
+{
+	return static_cast<float>(Next() >> 40) * (1.0f / 16777216.0f);
+}
+
+float SceneGenerator::Random::NextGaussian()
+{
+	// Sum of 4 uniform numbers has variance 1/3
+	return (NextFloat() + NextFloat() + NextFloat() + NextFloat() - 2.0f) * 1.7320508f;
+}
+
+void SceneGenerator::Random::NextDirection(float direction[3])
+{
+	float lengthSquared;
+	do {
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			direction[axis] = NextFloat(-1.0f, 1.0f);
+		}
+		lengthSquared = direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2];
+	} while (lengthSquared > 1.0f || lengthSquared < 1e-4f);
+	Normalize(direction);
+}
@@ -0,0 +1,155 @@
+#pragma once
+#ifndef _SCENE_GENERATOR_H_
+#define _SCENE_GENERATOR_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Deterministic procedural scenes for benchmarks - the same settings always produce the same scene. Doesn't depend on Windows or D3D12 headers, like MeshOptimizer.
+// Geometry is made of patches - 16x16 quad grids, or 1 quad wide parabolic arches of long thin triangles. Only + - * / and sqrt are used,
+// so output doesn't depend on C runtime. Every mesh is generated from its own random stream, so meshes can be generated in parallel and in any order.
+class SceneGenerator
+{
+public:
+	enum class Distribution : uint32_t
+	{
+		Uniform = 0,		// Meshes and their patches spread evenly through the scene
+		Clustered = 1,		// Meshes gathered around few centers, patches packed tightly inside meshes
+		LongThin = 2		// Evenly spread arches of long thin triangles with large bounding boxes, like arches of SunTemple
+	};
+
+	struct Settings {
+		uint64_t seed = 1;
+		// Unique triangles stored in vertex and index buffers, 1K to 100M
+		size_t triangleCount = 1000000;
+		// Triangles are split evenly between meshes, every mesh has its own material slot
+		size_t meshCount = 256;
+		// Placements of meshes - first meshCount instances are the meshes themselves, remaining ones repeat meshes elsewhere
+		size_t instanceCount = 256;
+		Distribution distribution = Distribution::Uniform;
+		// Meshes take materials round robin, so at most meshCount of them are used
+		size_t materialCount = 16;
+		// First light is directional, remaining ones are point lights
+		size_t lightCount = 4;
+		// Edge of cube centered at origin containing the scene
+		float sceneExtent = 2000.0f;
+	};
+
+	// Same layout as ModelClass::VertexBufferStruct
+	struct Vertex {
+		float position[3];
+		float normal[3];
+		float tangent[3];
+		float binormal[3];
+		float uv[2];
+	};
+
+	// Same layout as ModelClass::MeshRange
+	struct MeshRange {
+		uint32_t vertexOffset;
+		uint32_t vertexCount;
+		uint32_t indexOffset;
+		uint32_t indexCount;
+	};
+
+	struct Material {
+		float albedo[3];
+		float specular;
+	};
+
+	// Row major transform of mesh vertices (DirectXMath convention) - identity for the first instance of every mesh
+	struct Instance {
+		float transform[16];
+		uint32_t mesh;
+	};
+
+	// Same values as LightType of LightSettings
+	enum class LightType : uint32_t
+	{
+		Directional = 0,
+		Point = 1
+	};
+
+	// Position of point light, unit direction towards directional one
+	struct Light {
+		LightType type;
+		float position[3];
+		float color[4];
+	};
+
+	// Ranges of every mesh in the scene - geometry itself is generated per mesh, straight into buffers of the caller
+	struct Layout {
+		std::vector<MeshRange> meshes;
+		size_t vertexCount = 0;
+		size_t indexCount = 0;
+	};
+
+	// Whole scene in memory, for consumers without their own vertex store
+	struct Scene {
+		Layout layout;
+		std::vector<Vertex> vertices;
+		std::vector<uint32_t> indices;
+		std::vector<Material> materials;
+		std::vector<uint32_t> meshMaterials;
+		std::vector<Instance> instances;
+		std::vector<Light> lights;
+	};
+
+	static Layout Plan(const Settings& settings);
+	// Writes vertices of the mesh to vertices[range.vertexOffset..] and indices to indices[range.indexOffset..] - indices are global, like in ModelClass
+	static void GenerateMesh(const Settings& settings, const Layout& layout, size_t meshIndex, Vertex* vertices, uint32_t* indices);
+	static std::vector<Material> GenerateMaterials(const Settings& settings);
+	static uint32_t GetMeshMaterial(const Settings& settings, size_t meshIndex);
+	static std::vector<Instance> GenerateInstances(const Settings& settings, const Layout& layout);
+	static std::vector<Light> GenerateLights(const Settings& settings);
+
+	static Scene Generate(const Settings& settings);
+	// FNV-1a of every generated array, for checking that runs use the same scene
+	static uint64_t Checksum(const Scene& scene);
+
+private:
+	// SplitMix64 - random stream of every mesh is seeded by hash of scene seed, stream and index
+	class Random
+	{
+	public:
+		Random(uint64_t seed, uint64_t stream, uint64_t index);
+		uint64_t Next();
+		// [0, 1)
+		float NextFloat();
+		// [minimum, maximum)
+		float NextFloat(float minimum, float maximum) { return minimum + (maximum - minimum) * NextFloat(); }
+		// Approximately normal distribution with unit variance - sum of uniform numbers instead of Box-Muller, which would need logarithm and cosine
+		float NextGaussian();
+		void NextDirection(float direction[3]);
+
+	private:
+		uint64_t m_state;
+	};
+
+	enum Stream : uint64_t
+	{
+		STREAM_CLUSTERS = 1,
+		STREAM_MESH_CENTERS = 2,
+		STREAM_MESH_GEOMETRY = 3,
+		STREAM_MATERIALS = 4,
+		STREAM_INSTANCES = 5,
+		STREAM_LIGHTS = 6
+	};
+
+	static size_t GetMeshTriangleCount(const Settings& settings, size_t meshCount, size_t meshIndex);
+	static size_t GetPatchWidth(const Settings& settings) { return settings.distribution == Distribution::LongThin ? 1 : PATCH_WIDTH; }
+	static size_t GetPatchVertexCount(size_t triangleCount, size_t width);
+	static float GetMeshExtent(const Settings& settings, size_t meshCount);
+	static void GetMeshCenter(const Settings& settings, size_t meshIndex, float center[3]);
+	static void GetScenePoint(const Settings& settings, Random& random, float point[3]);
+	// Quads are filled row by row - last row may be partial and last quad may have only its first triangle
+	static void GeneratePatch(const Settings& settings, Random& random, const float center[3], float size, size_t triangleCount, Vertex* vertices, uint32_t* indices, uint32_t baseVertex);
+	static void BuildBasis(const float normal[3], float tangent[3], float binormal[3]);
+
+	static constexpr size_t PATCH_WIDTH = 16;
+	static constexpr size_t PATCH_TRIANGLES = 2 * PATCH_WIDTH * PATCH_WIDTH;
+	static constexpr size_t CLUSTER_COUNT = 8;
+};
+
+#endif // !_SCENE_GENERATOR_H_
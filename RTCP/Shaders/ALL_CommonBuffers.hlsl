@@ -9,19 +9,121 @@ struct VertexInputType
 	float3 tangent : TANGENT;
 	float3 binormal : BINORMAL;
 	float2 uv : TEXCOORD0;
-	uint textureID : TEXCOORD1;
 };
 
+// Vertex layout read by raytracing shaders - has to match ModelClass VertexFormat, passed by renderer as VERTEX_FORMAT define
+#define VERTEX_FORMAT_FULL 0
+#define VERTEX_FORMAT_PACKED 1
+#define VERTEX_FORMAT_PACKED_QUANTIZED_POSITION 2
+
+#ifndef VERTEX_FORMAT
+#define VERTEX_FORMAT VERTEX_FORMAT_FULL
+#endif
+
+// Split streams - positions are read only by BLAS build, so vertex buffer bound to shaders holds remaining attributes
+#ifndef VERTEX_STREAMS_SPLIT
+#define VERTEX_STREAMS_SPLIT 0
+#endif
+
+#if VERTEX_FORMAT == VERTEX_FORMAT_FULL
 struct Vertex
 {
+#if !VERTEX_STREAMS_SPLIT
 	float3 position;
+#endif
 	float3 normal;
 	float3 tangent;
 	float3 binormal;
 	float2 uv;
-	uint textureAlbedoID;
-	uint textureSpecRoughnessID;
-	uint textureNormalID;
+};
+#else
+struct Vertex
+{
+#if VERTEX_FORMAT == VERTEX_FORMAT_PACKED_QUANTIZED_POSITION && !VERTEX_STREAMS_SPLIT
+	uint2 position;					// 4x snorm16 relative to model bounds, dequantized by BLAS transform
+#elif !VERTEX_STREAMS_SPLIT
+	float3 position;
+#endif
+	uint normal;					// Octahedral, 2x snorm16
+	uint tangent;					// Octahedral, 2x snorm16 - lowest bit stores negative bitangent sign
+	uint uv;						// 2x half
+};
+
+float2 UnpackSnorm16x2(uint packed)
+{
+	const int2 value = int2(packed << 16, packed) >> 16;
+	return max(float2(value) / 32767.0, -1.0);
+}
+
+float3 OctahedralDecode(uint packed)
+{
+	float2 f = UnpackSnorm16x2(packed);
+	float3 n = float3(f.x, f.y, 1.0 - abs(f.x) - abs(f.y));
+	const float t = max(-n.z, 0.0);
+	n.xy += n.xy >= 0.0 ? -t : t;
+	return normalize(n);
+}
+#endif
+
+// Vertex attribute accessors - hit shaders use them instead of reading Vertex fields directly
+float3 GetVertexNormal(Vertex v)
+{
+#if VERTEX_FORMAT == VERTEX_FORMAT_FULL
+	return v.normal;
+#else
+	return OctahedralDecode(v.normal);
+#endif
+}
+
+float3 GetVertexTangent(Vertex v)
+{
+#if VERTEX_FORMAT == VERTEX_FORMAT_FULL
+	return v.tangent;
+#else
+	return OctahedralDecode(v.tangent & ~1u);
+#endif
+}
+
+float3 GetVertexBinormal(Vertex v)
+{
+#if VERTEX_FORMAT == VERTEX_FORMAT_FULL
+	return v.binormal;
+#else
+	const float3 binormal = cross(OctahedralDecode(v.normal), OctahedralDecode(v.tangent & ~1u));
+	return (v.tangent & 1u) ? -binormal : binormal;
+#endif
+}
+
+float2 GetVertexUV(Vertex v)
+{
+#if VERTEX_FORMAT == VERTEX_FORMAT_FULL
+	return v.uv;
+#else
+	return f16tof32(uint2(v.uv, v.uv >> 16));
+#endif
+}
+
+// Object space position in hit shaders - split streams and quantized positions leave it to BLAS build only
+#define VERTEX_POSITION_AVAILABLE (!VERTEX_STREAMS_SPLIT && VERTEX_FORMAT != VERTEX_FORMAT_PACKED_QUANTIZED_POSITION)
+
+#if VERTEX_POSITION_AVAILABLE
+float3 GetVertexPosition(Vertex v)
+{
+	return v.position;
+}
+#endif
+
+// Material of mesh, indexed by per triangle material index - has to match ModelClass::Material
+#define MATERIAL_INVALID_TEXTURE_ID 0xFFFFFFFF
+
+struct Material
+{
+	uint albedoTextureID;
+	uint specRoughnessTextureID;
+	uint normalTextureID;
+	float specularFactor;
+	float3 albedoFactor;
+	float padding;
 };
 
 // Constant Buffers
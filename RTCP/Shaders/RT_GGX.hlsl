@@ -63,16 +63,16 @@ void loadHitData(out float3 normal, out float3 tangent, out float3 bitangent, in
 	uint indexSizeInBytes = 4;
 	uint indicesPerTriangle = 3;
 	uint triangleIndexStride = indicesPerTriangle * indexSizeInBytes;
-	uint baseIndex = PrimitiveIndex() * triangleIndexStride;
+	uint baseIndex = GetModelTriangleIndex() * triangleIndexStride;
 	
 	const uint3 indices_ = indices.Load3(baseIndex);
-	float3 vertexNormals[3] = { vertices[indices_[0]].normal, vertices[indices_[1]].normal, vertices[indices_[2]].normal };
-	float3 vertexTangents[3] = { vertices[indices_[0]].tangent, vertices[indices_[1]].tangent, vertices[indices_[2]].tangent };
-	float3 vertexBitangents[3] = { vertices[indices_[0]].binormal, vertices[indices_[1]].binormal, vertices[indices_[2]].binormal };
+	float3 vertexNormals[3] = { GetVertexNormal(vertices[indices_[0]]), GetVertexNormal(vertices[indices_[1]]), GetVertexNormal(vertices[indices_[2]]) };
+	float3 vertexTangents[3] = { GetVertexTangent(vertices[indices_[0]]), GetVertexTangent(vertices[indices_[1]]), GetVertexTangent(vertices[indices_[2]]) };
+	float3 vertexBitangents[3] = { GetVertexBinormal(vertices[indices_[0]]), GetVertexBinormal(vertices[indices_[1]]), GetVertexBinormal(vertices[indices_[2]]) };
 	
-	normal = HitAttribute(vertexNormals, attribs);
-	tangent = HitAttribute(vertexTangents, attribs);
-	bitangent = HitAttribute(vertexBitangents, attribs);
+	normal = ObjectToWorldNormal(HitAttribute(vertexNormals, attribs));
+	tangent = ObjectToWorldDirection(HitAttribute(vertexTangents, attribs));
+	bitangent = ObjectToWorldDirection(HitAttribute(vertexBitangents, attribs));
 }
 
 float3 shootIndirectRay(float3 rayOrigin, float3 rayDir, float minT, PayloadIndirect payload)
@@ -344,16 +344,16 @@ float3 CalculateRadiance(inout PayloadIndirect payload, in BuiltInTriangleInters
 		uint indexSizeInBytes = 4;
 		uint indicesPerTriangle = 3;
 		uint triangleIndexStride = indicesPerTriangle * indexSizeInBytes;
-		uint baseIndex = PrimitiveIndex() * triangleIndexStride;
+		uint baseIndex = GetModelTriangleIndex() * triangleIndexStride;
 	
 		const uint3 indices_ = indices.Load3(baseIndex);
 	
 		float3 barycentrics = float3(1.0 - attribs.barycentrics.x - attribs.barycentrics.y, attribs.barycentrics.x, attribs.barycentrics.y);
 		float2 vertexUVs[3] =
 		{
-			vertices[indices_[0]].uv,
-			vertices[indices_[1]].uv,
-			vertices[indices_[2]].uv
+			GetVertexUV(vertices[indices_[0]]),
+			GetVertexUV(vertices[indices_[1]]),
+			GetVertexUV(vertices[indices_[2]])
 		};
 	
 		float2 uv = barycentrics.x * vertexUVs[0] + barycentrics.y * vertexUVs[1] + barycentrics.z * vertexUVs[2];
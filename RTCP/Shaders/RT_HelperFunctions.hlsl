@@ -75,6 +75,55 @@ float2 HitAttribute(float2 vertexAttribute[3], in BuiltInTriangleIntersectionAtt
         attrib.barycentrics.y * (vertexAttribute[2] - vertexAttribute[0]);
 }
 
+// Triangle of whole model - instance ID is first triangle of mesh placed by the instance, PrimitiveIndex() counts from it
+uint GetModelTriangleIndex()
+{
+	return InstanceID() + PrimitiveIndex();
+}
+
+// Object space attributes of hit to world space of instance - normals by inverse transpose
+float3 ObjectToWorldNormal(float3 normal)
+{
+	return normalize(mul(normal, (float3x3)WorldToObject3x4()));
+}
+
+float3 ObjectToWorldDirection(float3 direction)
+{
+	return normalize(mul((float3x3)ObjectToWorld3x4(), direction));
+}
+
+// Texture LOD by ray cones (Akenine-Moller et al., Texture Level of Detail Strategies for Real-Time Ray Tracing) - primary rays only.
+// Cone starts at the camera and spreads by angle between rays of neighbouring pixels.
+#define TEXTURE_LOD_BASE_MIP0 -1e+30f
+
+float ComputePixelSpreadAngle(float4x4 projectionToWorld, float3 cameraPosition)
+{
+	float3 origin = cameraPosition;
+	float3 direction;
+	GenerateCameraRay(DispatchRaysIndex().xy + uint2(0, 1), DispatchRaysDimensions().xy, projectionToWorld, origin, direction);
+	// Sine of small angle is the angle, and unlike acos it keeps precision
+	return length(cross(direction, WorldRayDirection()));
+}
+
+// LOD of texture with single texel at the hit - ComputeTextureLod adds resolution of sampled texture
+float ComputeRayConeLodBase(float3 worldPositions[3], float2 uvs[3], float pixelSpreadAngle)
+{
+	const float3 worldCross = cross(worldPositions[1] - worldPositions[0], worldPositions[2] - worldPositions[0]);
+	const float worldArea = max(length(worldCross), 1e-20f);
+	const float uvArea = max(abs((uvs[1].x - uvs[0].x) * (uvs[2].y - uvs[0].y) - (uvs[2].x - uvs[0].x) * (uvs[1].y - uvs[0].y)), 1e-20f);
+	const float coneWidth = max(pixelSpreadAngle * RayTCurrent(), 1e-20f);
+	// Footprint grows as the surface turns away from the ray
+	const float cosine = max(abs(dot(worldCross, WorldRayDirection())) / worldArea, 1e-4f);
+	return 0.5f * log2(uvArea / worldArea) + log2(coneWidth) - log2(cosine);
+}
+
+float ComputeTextureLod(Texture2D<float4> tex, float lodBase)
+{
+	uint width, height, levelCount;
+	tex.GetDimensions(0, width, height, levelCount);
+	return max(lodBase + 0.5f * log2(float(width) * float(height)), 0.0f);
+}
+
 uint3 Load3x32BitIndices(ByteAddressBuffer indices, uint offsetBytes)
 {
 	return indices.Load3(offsetBytes);
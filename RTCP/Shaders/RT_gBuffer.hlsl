@@ -25,7 +25,9 @@ RaytracingAccelerationStructure SceneBVH : register(t0);
 ByteAddressBuffer indices : register(t1);
 StructuredBuffer<Vertex> vertices : register(t2);
 TextureCube<float4> skyboxTexture : register(t3);
-Texture2D<float4> textures[] : register(t4);
+StructuredBuffer<Material> materials : register(t4);
+Buffer<uint> triangleMaterials : register(t5);
+Texture2D<float4> textures[] : register(t6);
 //Texture2DArray<float4> specularRoughnessTex : register(t4);
 
 SamplerState g_sampler : register(s0);
@@ -59,33 +61,70 @@ void ClosestHit(inout RayPayload payload, in BuiltInTriangleIntersectionAttribut
 	uint indexSizeInBytes = 4;
 	uint indicesPerTriangle = 3;
 	uint triangleIndexStride = indicesPerTriangle * indexSizeInBytes;
-	uint baseIndex = PrimitiveIndex() * triangleIndexStride;
+	uint baseIndex = GetModelTriangleIndex() * triangleIndexStride;
 	
 	const uint3 indices_ = indices.Load3(baseIndex);
 
 	float3 vertexNormals[3] =
 	{
-		vertices[indices_[0]].normal,
-		vertices[indices_[1]].normal,
-		vertices[indices_[2]].normal
+		GetVertexNormal(vertices[indices_[0]]),
+		GetVertexNormal(vertices[indices_[1]]),
+		GetVertexNormal(vertices[indices_[2]])
 	};
 	
-	float3 triangleNormal = HitAttribute(vertexNormals, attribs);
+	float3 triangleNormal = ObjectToWorldNormal(HitAttribute(vertexNormals, attribs));
 	
 	RTOutputNormal[DispatchRaysIndex().xy] = float4(triangleNormal, RayTCurrent());
 	
 	float3 barycentrics = float3(1.0 - attribs.barycentrics.x - attribs.barycentrics.y, attribs.barycentrics.x, attribs.barycentrics.y);
 	float2 vertexUVs[3] =
 	{
-		vertices[indices_[0]].uv,
-		vertices[indices_[1]].uv,
-		vertices[indices_[2]].uv
+		GetVertexUV(vertices[indices_[0]]),
+		GetVertexUV(vertices[indices_[1]]),
+		GetVertexUV(vertices[indices_[2]])
 	};
 	
 	float2 uv = barycentrics.x * vertexUVs[0] + barycentrics.y * vertexUVs[1] + barycentrics.z * vertexUVs[2];
-	RTOutputAlbedo[DispatchRaysIndex().xy] = float4(textures[vertices[indices_[0]].textureAlbedoID].SampleLevel(g_sampler, uv, 0).xyz, 1);
-	RTOutputSpecRoughness[DispatchRaysIndex().xy] = float4(textures[vertices[indices_[0]].textureSpecRoughnessID + g_sceneCB.specularIndex].SampleLevel(g_sampler, uv, 0).xyz, 1);
-	RTOutputNormal[DispatchRaysIndex().xy] = float4(textures[vertices[indices_[0]].textureNormalID + g_sceneCB.normalIndex].SampleLevel(g_sampler, uv, 0).xyz, 1);
+	
+	// Mip level from ray cone of the pixel - without positions in hit shaders textures are sampled at mip 0
+#if VERTEX_POSITION_AVAILABLE
+	float3 worldPositions[3] =
+	{
+		mul(ObjectToWorld3x4(), float4(GetVertexPosition(vertices[indices_[0]]), 1.0f)),
+		mul(ObjectToWorld3x4(), float4(GetVertexPosition(vertices[indices_[1]]), 1.0f)),
+		mul(ObjectToWorld3x4(), float4(GetVertexPosition(vertices[indices_[2]]), 1.0f))
+	};
+	const float lodBase = ComputeRayConeLodBase(worldPositions, vertexUVs, ComputePixelSpreadAngle(g_sceneCB.projectionToWorld, g_sceneCB.cameraPosition.xyz));
+#else
+	const float lodBase = TEXTURE_LOD_BASE_MIP0;
+#endif
+	
+	// Material is shared by whole mesh, slots without texture fall back to material factors
+	const Material material = materials[triangleMaterials[GetModelTriangleIndex()]];
+	float3 albedo = material.albedoFactor;
+	if (material.albedoTextureID != MATERIAL_INVALID_TEXTURE_ID)
+	{
+		albedo *= textures[material.albedoTextureID].SampleLevel(g_sampler, uv, ComputeTextureLod(textures[material.albedoTextureID], lodBase)).xyz;
+	}
+	float3 specRoughness = material.specularFactor;
+	if (material.specRoughnessTextureID != MATERIAL_INVALID_TEXTURE_ID)
+	{
+		const uint specRoughnessIndex = material.specRoughnessTextureID + g_sceneCB.specularIndex;
+		specRoughness *= textures[specRoughnessIndex].SampleLevel(g_sampler, uv, ComputeTextureLod(textures[specRoughnessIndex], lodBase)).xyz;
+	}
+	RTOutputAlbedo[DispatchRaysIndex().xy] = float4(albedo, 1);
+	RTOutputSpecRoughness[DispatchRaysIndex().xy] = float4(specRoughness, 1);
+	
+	// Z is reconstructed from XY, so two channel (BC5) normal maps are read the same way as RGB ones
+	float3 normalMap = float3(0.5f, 0.5f, 1.0f);
+	if (material.normalTextureID != MATERIAL_INVALID_TEXTURE_ID)
+	{
+		const uint normalIndex = material.normalTextureID + g_sceneCB.normalIndex;
+		float2 normalXY = textures[normalIndex].SampleLevel(g_sampler, uv, ComputeTextureLod(textures[normalIndex], lodBase)).xy * 2.0f - 1.0f;
+		float normalZ = sqrt(saturate(1.0f - dot(normalXY, normalXY)));
+		normalMap = float3(normalXY, normalZ) * 0.5f + 0.5f;
+	}
+	RTOutputNormal[DispatchRaysIndex().xy] = float4(normalMap, 1);
 }
 
 [shader("miss")]
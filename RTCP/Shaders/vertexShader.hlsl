@@ -10,7 +10,6 @@ struct PixelInputType
 	float3 tangent : TANGENT;
 	float3 binormal : BINORMAL;
 	float2 uv : TEXCOORD0;
-	uint textureID : TEXCOORD1;
 };
 
 cbuffer SceneConstantBuffer : register(b0)
@@ -21,23 +20,29 @@ cbuffer SceneConstantBuffer : register(b0)
 	matrix g_paddingMatrix;
 };
 
+// Scene graph placement of drawn mesh, root constants set per draw
+cbuffer InstanceConstantBuffer : register(b1)
+{
+	matrix g_instanceWorldMatrix;
+};
+
 PixelInputType main(VertexInputType input)
 {
 	PixelInputType output;
 	
 	float4 position = float4(input.position, 1.0f);
+	position = mul(position, g_instanceWorldMatrix);
 	position = mul(position, g_worldMatrix);
 	position = mul(position, g_viewMatrix);
 	output.position = mul(position, g_projMatrix);
 	
 	//output.position = float4(input.position, 1.0f);
 	
-	output.normal = input.normal;
+	// Scene graph transforms are expected without non-uniform scale, tangent frame is rotated by upper 3x3
+	output.normal = normalize(mul(input.normal, (float3x3)g_instanceWorldMatrix));
 	output.uv = input.uv;
-	output.binormal = input.binormal;
-	output.tangent = input.tangent;
-	
-	output.textureID = input.textureID;
+	output.binormal = normalize(mul(input.binormal, (float3x3)g_instanceWorldMatrix));
+	output.tangent = normalize(mul(input.tangent, (float3x3)g_instanceWorldMatrix));
 	
 	return output;
 }
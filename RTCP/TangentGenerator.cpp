@@ -0,0 +1,263 @@
+#include "TangentGenerator.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <emmintrin.h>
+
+// Constant is bound to reference by std::min, which needs out-of-line definition before C++17
+constexpr size_t TangentGenerator::BATCH_SIZE;
+
+namespace
+{
+	// Squared length under which accumulated tangent is considered unusable
+	constexpr float MIN_TANGENT_LENGTH_SQUARED = 1e-12f;
+
+	inline const float* Attribute(const float* stream, size_t stride, uint32_t vertex)
+	{
+		return reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(stream) + stride * vertex);
+	}
+
+	inline float* Attribute(float* stream, size_t stride, uint32_t vertex)
+	{
+		return reinterpret_cast<float*>(reinterpret_cast<uint8_t*>(stream) + stride * vertex);
+	}
+
+	inline __m128 Dot(__m128 ax, __m128 ay, __m128 az, __m128 bx, __m128 by, __m128 bz)
+	{
+		return _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)), _mm_mul_ps(az, bz));
+	}
+}
+
+TangentGenerator::Statistics TangentGenerator::Generate(const VertexStreams& streams, size_t vertexCount, const uint32_t* indices, size_t indexCount)
+{
+	assert(indexCount % 3 == 0 && "Tangent generation expects triangle list");
+
+	Statistics statistics{};
+	statistics.triangleCount = indexCount / 3;
+
+	// Accumulate area weighted, normalized UV derivatives of every triangle into its vertices
+	std::vector<float> sdir(vertexCount * 3, 0.0f);
+	std::vector<float> tdir(vertexCount * 3, 0.0f);
+	size_t triangle = 0;
+	for (; triangle + BATCH_SIZE <= statistics.triangleCount; triangle += BATCH_SIZE)
+	{
+		statistics.degenerateTriangles += AccumulateBatch(streams, indices, triangle, sdir.data(), tdir.data());
+	}
+	for (; triangle < statistics.triangleCount; ++triangle)
+	{
+		statistics.degenerateTriangles += AccumulateTriangle(streams, indices, triangle, sdir.data(), tdir.data());
+	}
+
+	// Gram-Schmidt against vertex normal, binormal is rebuilt from normal and tangent with handedness of accumulated tdir
+	for (size_t vertex = 0; vertex < vertexCount; vertex += BATCH_SIZE)
+	{
+		statistics.fallbackVertices += OrthonormalizeBatch(streams, vertex, std::min(BATCH_SIZE, vertexCount - vertex), sdir.data(), tdir.data());
+	}
+	return statistics;
+}
+
+size_t TangentGenerator::AccumulateBatch(const VertexStreams& streams, const uint32_t* indices, size_t firstTriangle, float* sdir, float* tdir)
+{
+	// Gather 4 triangles into SoA registers - lane i holds triangle firstTriangle + i
+	alignas(16) float position[3][3][BATCH_SIZE];
+	alignas(16) float uv[3][2][BATCH_SIZE];
+	for (size_t lane = 0; lane < BATCH_SIZE; ++lane)
+	{
+		for (size_t corner = 0; corner < 3; ++corner)
+		{
+			const uint32_t vertex = indices[(firstTriangle + lane) * 3 + corner];
+			const float* p = Attribute(streams.positions, streams.stride, vertex);
+			const float* t = Attribute(streams.uvs, streams.stride, vertex);
+			position[corner][0][lane] = p[0];
+			position[corner][1][lane] = p[1];
+			position[corner][2][lane] = p[2];
+			uv[corner][0][lane] = t[0];
+			uv[corner][1][lane] = t[1];
+		}
+	}
+
+	const __m128 p0x = _mm_load_ps(position[0][0]), p0y = _mm_load_ps(position[0][1]), p0z = _mm_load_ps(position[0][2]);
+	const __m128 e1x = _mm_sub_ps(_mm_load_ps(position[1][0]), p0x);
+	const __m128 e1y = _mm_sub_ps(_mm_load_ps(position[1][1]), p0y);
+	const __m128 e1z = _mm_sub_ps(_mm_load_ps(position[1][2]), p0z);
+	const __m128 e2x = _mm_sub_ps(_mm_load_ps(position[2][0]), p0x);
+	const __m128 e2y = _mm_sub_ps(_mm_load_ps(position[2][1]), p0y);
+	const __m128 e2z = _mm_sub_ps(_mm_load_ps(position[2][2]), p0z);
+	const __m128 u0 = _mm_load_ps(uv[0][0]), v0 = _mm_load_ps(uv[0][1]);
+	const __m128 s1 = _mm_sub_ps(_mm_load_ps(uv[1][0]), u0), t1 = _mm_sub_ps(_mm_load_ps(uv[1][1]), v0);
+	const __m128 s2 = _mm_sub_ps(_mm_load_ps(uv[2][0]), u0), t2 = _mm_sub_ps(_mm_load_ps(uv[2][1]), v0);
+
+	// Derivatives scaled by determinant - only its sign matters, since directions are normalized below
+	const __m128 det = _mm_sub_ps(_mm_mul_ps(s1, t2), _mm_mul_ps(s2, t1));
+	const __m128 sx = _mm_sub_ps(_mm_mul_ps(t2, e1x), _mm_mul_ps(t1, e2x));
+	const __m128 sy = _mm_sub_ps(_mm_mul_ps(t2, e1y), _mm_mul_ps(t1, e2y));
+	const __m128 sz = _mm_sub_ps(_mm_mul_ps(t2, e1z), _mm_mul_ps(t1, e2z));
+	const __m128 tx = _mm_sub_ps(_mm_mul_ps(s1, e2x), _mm_mul_ps(s2, e1x));
+	const __m128 ty = _mm_sub_ps(_mm_mul_ps(s1, e2y), _mm_mul_ps(s2, e1y));
+	const __m128 tz = _mm_sub_ps(_mm_mul_ps(s1, e2z), _mm_mul_ps(s2, e1z));
+
+	// Weight by triangle area, so large triangles dominate and slivers with tiny UV area don't blow up the sum
+	const __m128 nx = _mm_sub_ps(_mm_mul_ps(e1y, e2z), _mm_mul_ps(e1z, e2y));
+	const __m128 ny = _mm_sub_ps(_mm_mul_ps(e1z, e2x), _mm_mul_ps(e1x, e2z));
+	const __m128 nz = _mm_sub_ps(_mm_mul_ps(e1x, e2y), _mm_mul_ps(e1y, e2x));
+	const __m128 area = _mm_sqrt_ps(Dot(nx, ny, nz, nx, ny, nz));
+	const __m128 sLength = _mm_sqrt_ps(Dot(sx, sy, sz, sx, sy, sz));
+	const __m128 tLength = _mm_sqrt_ps(Dot(tx, ty, tz, tx, ty, tz));
+
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 valid = _mm_and_ps(_mm_and_ps(_mm_cmpneq_ps(det, zero), _mm_cmpgt_ps(area, zero)),
+		_mm_and_ps(_mm_cmpgt_ps(sLength, zero), _mm_cmpgt_ps(tLength, zero)));
+	const __m128 signMask = _mm_and_ps(det, _mm_set1_ps(-0.0f));
+	const __m128 signedArea = _mm_and_ps(_mm_xor_ps(area, signMask), valid);
+	// Invalid lanes divide by 1 and are zeroed by signedArea
+	const __m128 sScale = _mm_div_ps(signedArea, _mm_or_ps(_mm_and_ps(valid, sLength), _mm_andnot_ps(valid, _mm_set1_ps(1.0f))));
+	const __m128 tScale = _mm_div_ps(signedArea, _mm_or_ps(_mm_and_ps(valid, tLength), _mm_andnot_ps(valid, _mm_set1_ps(1.0f))));
+
+	alignas(16) float s[3][BATCH_SIZE];
+	alignas(16) float t[3][BATCH_SIZE];
+	_mm_store_ps(s[0], _mm_mul_ps(sx, sScale));
+	_mm_store_ps(s[1], _mm_mul_ps(sy, sScale));
+	_mm_store_ps(s[2], _mm_mul_ps(sz, sScale));
+	_mm_store_ps(t[0], _mm_mul_ps(tx, tScale));
+	_mm_store_ps(t[1], _mm_mul_ps(ty, tScale));
+	_mm_store_ps(t[2], _mm_mul_ps(tz, tScale));
+
+	// Scatter serially - triangles of one batch often share vertices
+	for (size_t lane = 0; lane < BATCH_SIZE; ++lane)
+	{
+		for (size_t corner = 0; corner < 3; ++corner)
+		{
+			const uint32_t vertex = indices[(firstTriangle + lane) * 3 + corner];
+			for (size_t axis = 0; axis < 3; ++axis)
+			{
+				sdir[vertex * 3 + axis] += s[axis][lane];
+				tdir[vertex * 3 + axis] += t[axis][lane];
+			}
+		}
+	}
+	const int validMask = _mm_movemask_ps(valid);
+	size_t degenerateTriangles = 0;
+	for (size_t lane = 0; lane < BATCH_SIZE; ++lane)
+	{
+		degenerateTriangles += ((validMask >> lane) & 1) ^ 1;
+	}
+	return degenerateTriangles;
+}
+
+size_t TangentGenerator::AccumulateTriangle(const VertexStreams& streams, const uint32_t* indices, size_t triangle, float* sdir, float* tdir)
+{
+	// Scalar version of AccumulateBatch, for triangles left after the last full batch
+	const uint32_t* corners = indices + triangle * 3;
+	const float* p0 = Attribute(streams.positions, streams.stride, corners[0]);
+	const float* p1 = Attribute(streams.positions, streams.stride, corners[1]);
+	const float* p2 = Attribute(streams.positions, streams.stride, corners[2]);
+	const float* uv0 = Attribute(streams.uvs, streams.stride, corners[0]);
+	const float* uv1 = Attribute(streams.uvs, streams.stride, corners[1]);
+	const float* uv2 = Attribute(streams.uvs, streams.stride, corners[2]);
+
+	const float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+	const float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+	const float s1 = uv1[0] - uv0[0], t1 = uv1[1] - uv0[1];
+	const float s2 = uv2[0] - uv0[0], t2 = uv2[1] - uv0[1];
+
+	const float det = s1 * t2 - s2 * t1;
+	const float s[3] = { t2 * e1[0] - t1 * e2[0], t2 * e1[1] - t1 * e2[1], t2 * e1[2] - t1 * e2[2] };
+	const float t[3] = { s1 * e2[0] - s2 * e1[0], s1 * e2[1] - s2 * e1[1], s1 * e2[2] - s2 * e1[2] };
+	const float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+	const float area = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+	const float sLength = std::sqrt(s[0] * s[0] + s[1] * s[1] + s[2] * s[2]);
+	const float tLength = std::sqrt(t[0] * t[0] + t[1] * t[1] + t[2] * t[2]);
+	if (det == 0.0f || !(area > 0.0f) || !(sLength > 0.0f) || !(tLength > 0.0f)) {
+		return 1;
+	}
+
+	const float signedArea = det < 0.0f ? -area : area;
+	const float sScale = signedArea / sLength;
+	const float tScale = signedArea / tLength;
+	for (size_t corner = 0; corner < 3; ++corner)
+	{
+		for (size_t axis = 0; axis < 3; ++axis)
+		{
+			sdir[corners[corner] * 3 + axis] += s[axis] * sScale;
+			tdir[corners[corner] * 3 + axis] += t[axis] * tScale;
+		}
+	}
+	return 0;
+}
+
+size_t TangentGenerator::OrthonormalizeBatch(const VertexStreams& streams, size_t firstVertex, size_t count, const float* sdir, const float* tdir)
+{
+	// Gather up to 4 vertices, missing lanes repeat the first vertex and are not written back
+	alignas(16) float n[3][BATCH_SIZE];
+	alignas(16) float s[3][BATCH_SIZE];
+	alignas(16) float t[3][BATCH_SIZE];
+	for (size_t lane = 0; lane < BATCH_SIZE; ++lane)
+	{
+		const uint32_t vertex = static_cast<uint32_t>(firstVertex + (lane < count ? lane : 0));
+		const float* normal = Attribute(streams.normals, streams.stride, vertex);
+		for (size_t axis = 0; axis < 3; ++axis)
+		{
+			n[axis][lane] = normal[axis];
+			s[axis][lane] = sdir[vertex * 3 + axis];
+			t[axis][lane] = tdir[vertex * 3 + axis];
+		}
+	}
+
+	const __m128 nx = _mm_load_ps(n[0]), ny = _mm_load_ps(n[1]), nz = _mm_load_ps(n[2]);
+	__m128 sx = _mm_load_ps(s[0]), sy = _mm_load_ps(s[1]), sz = _mm_load_ps(s[2]);
+
+	// Vertices without usable derivatives get any tangent perpendicular to normal - X axis, or Y if normal is close to X
+	const __m128 sn = Dot(nx, ny, nz, sx, sy, sz);
+	__m128 ox = _mm_sub_ps(sx, _mm_mul_ps(nx, sn));
+	__m128 oy = _mm_sub_ps(sy, _mm_mul_ps(ny, sn));
+	__m128 oz = _mm_sub_ps(sz, _mm_mul_ps(nz, sn));
+	const __m128 fallback = _mm_cmplt_ps(Dot(ox, oy, oz, ox, oy, oz), _mm_set1_ps(MIN_TANGENT_LENGTH_SQUARED));
+	const int fallbackMask = _mm_movemask_ps(fallback);
+	if (fallbackMask != 0)
+	{
+		const __m128 useY = _mm_cmpgt_ps(_mm_andnot_ps(_mm_set1_ps(-0.0f), nx), _mm_set1_ps(0.9f));
+		const __m128 ax = _mm_andnot_ps(useY, _mm_set1_ps(1.0f));
+		const __m128 ay = _mm_and_ps(useY, _mm_set1_ps(1.0f));
+		const __m128 an = Dot(nx, ny, nz, ax, ay, _mm_setzero_ps());
+		ox = _mm_or_ps(_mm_and_ps(fallback, _mm_sub_ps(ax, _mm_mul_ps(nx, an))), _mm_andnot_ps(fallback, ox));
+		oy = _mm_or_ps(_mm_and_ps(fallback, _mm_sub_ps(ay, _mm_mul_ps(ny, an))), _mm_andnot_ps(fallback, oy));
+		oz = _mm_or_ps(_mm_and_ps(fallback, _mm_mul_ps(_mm_sub_ps(_mm_setzero_ps(), nz), an)), _mm_andnot_ps(fallback, oz));
+	}
+
+	// Normalize tangent - degenerate normal can still leave zero vector, divide by 1 in that case
+	const __m128 length = _mm_sqrt_ps(Dot(ox, oy, oz, ox, oy, oz));
+	const __m128 safeLength = _mm_or_ps(_mm_and_ps(_mm_cmpgt_ps(length, _mm_setzero_ps()), length), _mm_andnot_ps(_mm_cmpgt_ps(length, _mm_setzero_ps()), _mm_set1_ps(1.0f)));
+	sx = _mm_div_ps(ox, safeLength);
+	sy = _mm_div_ps(oy, safeLength);
+	sz = _mm_div_ps(oz, safeLength);
+
+	// Binormal = cross(normal, tangent), flipped if accumulated tdir points the other way (mirrored UVs)
+	__m128 bx = _mm_sub_ps(_mm_mul_ps(ny, sz), _mm_mul_ps(nz, sy));
+	__m128 by = _mm_sub_ps(_mm_mul_ps(nz, sx), _mm_mul_ps(nx, sz));
+	__m128 bz = _mm_sub_ps(_mm_mul_ps(nx, sy), _mm_mul_ps(ny, sx));
+	const __m128 handedness = _mm_and_ps(_mm_cmplt_ps(Dot(bx, by, bz, _mm_load_ps(t[0]), _mm_load_ps(t[1]), _mm_load_ps(t[2])), _mm_setzero_ps()), _mm_set1_ps(-0.0f));
+	bx = _mm_xor_ps(bx, handedness);
+	by = _mm_xor_ps(by, handedness);
+	bz = _mm_xor_ps(bz, handedness);
+
+	_mm_store_ps(s[0], sx);
+	_mm_store_ps(s[1], sy);
+	_mm_store_ps(s[2], sz);
+	_mm_store_ps(t[0], bx);
+	_mm_store_ps(t[1], by);
+	_mm_store_ps(t[2], bz);
+	size_t fallbackVertices = 0;
+	for (size_t lane = 0; lane < count; ++lane)
+	{
+		const uint32_t vertex = static_cast<uint32_t>(firstVertex + lane);
+		float* tangent = Attribute(streams.tangents, streams.stride, vertex);
+		float* binormal = Attribute(streams.binormals, streams.stride, vertex);
+		for (size_t axis = 0; axis < 3; ++axis)
+		{
+			tangent[axis] = s[axis][lane];
+			binormal[axis] = t[axis][lane];
+		}
+		fallbackVertices += (fallbackMask >> lane) & 1;
+	}
+	return fallbackVertices;
+}
@@ -0,0 +1,44 @@
+#pragma once
+#ifndef _TANGENT_GENERATOR_H_
+#define _TANGENT_GENERATOR_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Tangent frame generation for indexed triangle lists, in the spirit of MikkTSpace - per triangle UV derivatives are
+// accumulated into every referenced vertex, then orthonormalized against vertex normal, so shared vertices get smooth frames.
+// Triangles are processed in batches of 4 with SSE2. Doesn't depend on Windows or D3D12 headers, like MeshOptimizer.
+class TangentGenerator
+{
+public:
+	// Attribute streams of interleaved vertices - every pointer addresses attribute of first vertex, stride is distance between vertices in bytes
+	struct VertexStreams {
+		const float* positions;		// 3 floats
+		const float* normals;		// 3 floats, expected normalized
+		const float* uvs;			// 2 floats
+		float* tangents;			// 3 floats, written
+		float* binormals;			// 3 floats, written - sign follows UV winding, so mirrored UVs get flipped binormal
+		size_t stride;
+	};
+
+	struct Statistics {
+		size_t triangleCount;
+		size_t degenerateTriangles;		// Zero area in UV space, not contributing to any vertex
+		size_t fallbackVertices;		// No usable UV derivatives, frame was chosen only from normal
+	};
+
+	// Indices are local to the streams, every vertex gets tangent and binormal written (unreferenced ones get fallback frame)
+	static Statistics Generate(const VertexStreams& streams, size_t vertexCount, const uint32_t* indices, size_t indexCount);
+
+private:
+	static constexpr size_t BATCH_SIZE = 4;
+
+	// Accumulates derivatives of triangles [first, first + count) into sdir/tdir (3 floats per vertex), returns number of degenerate triangles
+	static size_t AccumulateBatch(const VertexStreams& streams, const uint32_t* indices, size_t firstTriangle, float* sdir, float* tdir);
+	static size_t AccumulateTriangle(const VertexStreams& streams, const uint32_t* indices, size_t triangle, float* sdir, float* tdir);
+	// Orthonormalizes frames of vertices [first, first + count), count <= BATCH_SIZE, returns number of fallback vertices
+	static size_t OrthonormalizeBatch(const VertexStreams& streams, size_t firstVertex, size_t count, const float* sdir, const float* tdir);
+};
+
+#endif // !_TANGENT_GENERATOR_H_
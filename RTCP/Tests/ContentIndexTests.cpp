@@ -0,0 +1,164 @@
+#include "TestFramework.h"
+#include "ContentIndex.h"
+#include <atomic>
+#include <map>
+#include <thread>
+
+namespace
+{
+	// Content hash of every test path, with count of hash calls per path - files are never read
+	class FakeFiles
+	{
+	public:
+		explicit FakeFiles(std::map<std::string, uint64_t> hashes) : m_hashes(std::move(hashes)) {}
+
+		ContentIndex<int>::HashFunction GetHashFunction()
+		{
+			return [this](const std::string& path)
+			{
+				std::lock_guard<std::mutex> lock{ m_mutex };
+				++m_hashCounts[path];
+				const auto it = m_hashes.find(path);
+				return it != m_hashes.end() ? it->second : 0;
+			};
+		}
+
+		size_t GetHashCount(const std::string& path)
+		{
+			std::lock_guard<std::mutex> lock{ m_mutex };
+			return m_hashCounts[path];
+		}
+
+	private:
+		std::mutex m_mutex;
+		std::map<std::string, uint64_t> m_hashes;
+		std::map<std::string, size_t> m_hashCounts;
+	};
+}
+
+TEST_CASE(ContentIndex_DifferentSizesAreNeverHashed)
+{
+	FakeFiles files{ { { "a.png", 1 }, { "b.png", 1 } } };
+	ContentIndex<int> index{ files.GetHashFunction() };
+	int sameContent = -1;
+	CHECK(!index.Insert("a.png", 100, 1, sameContent));
+	CHECK(!index.Insert("b.png", 101, 2, sameContent));
+
+	// Equal hashes don't matter, sizes differ
+	CHECK(sameContent == -1);
+	CHECK(index.GetHashedFileCount() == 0);
+	CHECK(files.GetHashCount("a.png") == 0);
+	CHECK(files.GetHashCount("b.png") == 0);
+}
+
+TEST_CASE(ContentIndex_SameSizeDifferentContentIsNotMatched)
+{
+	FakeFiles files{ { { "a.png", 1 }, { "b.png", 2 } } };
+	ContentIndex<int> index{ files.GetHashFunction() };
+	int sameContent = -1;
+	CHECK(!index.Insert("a.png", 100, 1, sameContent));
+	CHECK(!index.Insert("b.png", 100, 2, sameContent));
+
+	CHECK(sameContent == -1);
+	CHECK(index.GetHashedFileCount() == 2);
+}
+
+TEST_CASE(ContentIndex_SameContentIsMatched)
+{
+	FakeFiles files{ { { "a.png", 1 }, { "b.png", 2 }, { "copy.png", 1 } } };
+	ContentIndex<int> index{ files.GetHashFunction() };
+	int sameContent = -1;
+	CHECK(!index.Insert("a.png", 100, 1, sameContent));
+	CHECK(!index.Insert("b.png", 100, 2, sameContent));
+	CHECK(index.Insert("copy.png", 100, 3, sameContent));
+	CHECK(sameContent == 1);
+	CHECK(index.GetSize() == 3);
+}
+
+TEST_CASE(ContentIndex_HashesEveryFileOnce)
+{
+	FakeFiles files{ { { "a.png", 1 }, { "b.png", 2 }, { "c.png", 3 }, { "d.png", 4 } } };
+	ContentIndex<int> index{ files.GetHashFunction() };
+	int sameContent = -1;
+	CHECK(!index.Insert("a.png", 100, 1, sameContent));
+	CHECK(!index.Insert("b.png", 100, 2, sameContent));
+	CHECK(!index.Insert("c.png", 100, 3, sameContent));
+	CHECK(!index.Insert("d.png", 100, 4, sameContent));
+
+	// Every later insert compares against all earlier files, each of them still read once
+	for (const char* path : { "a.png", "b.png", "c.png", "d.png" })
+	{
+		CHECK(files.GetHashCount(path) == 1);
+	}
+	CHECK(index.GetHashedFileCount() == 4);
+}
+
+TEST_CASE(ContentIndex_UnreadableFileIsNotMatched)
+{
+	// Both files fail to hash - equal (zero) hashes don't make them the same texture
+	FakeFiles files{ {} };
+	ContentIndex<int> index{ files.GetHashFunction() };
+	int sameContent = -1;
+	CHECK(!index.Insert("missing.png", 100, 1, sameContent));
+	CHECK(!index.Insert("missing-too.png", 100, 2, sameContent));
+	CHECK(sameContent == -1);
+}
+
+TEST_CASE(ContentIndex_ErasedValueIsNotMatched)
+{
+	FakeFiles files{ { { "a.png", 1 }, { "copy.png", 1 } } };
+	ContentIndex<int> index{ files.GetHashFunction() };
+	int sameContent = -1;
+	CHECK(!index.Insert("a.png", 100, 1, sameContent));
+	// Erase with wrong size doesn't remove anything
+	index.Erase(101, 1);
+	CHECK(index.GetSize() == 1);
+	index.Erase(100, 1);
+	CHECK(index.GetSize() == 0);
+
+	// Alone in its size again - not even hashed
+	CHECK(!index.Insert("copy.png", 100, 2, sameContent));
+	CHECK(files.GetHashCount("copy.png") == 0);
+}
+
+TEST_CASE(ContentIndex_ConcurrentInsertsMatchSameContent)
+{
+	constexpr int THREAD_COUNT = 8;
+	std::map<std::string, uint64_t> hashes;
+	for (int i = 0; i < THREAD_COUNT; ++i)
+	{
+		hashes["file" + std::to_string(i) + ".png"] = 1 + i % 2;
+	}
+	FakeFiles files{ hashes };
+	ContentIndex<int> index{ files.GetHashFunction() };
+
+	std::atomic<int> matchCount{ 0 };
+	std::atomic<int> wrongMatchCount{ 0 };
+	std::vector<std::thread> threads;
+	for (int i = 0; i < THREAD_COUNT; ++i)
+	{
+		threads.emplace_back([&index, &matchCount, &wrongMatchCount, i]()
+		{
+			int sameContent = -1;
+			if (index.Insert("file" + std::to_string(i) + ".png", 100, i, sameContent))
+			{
+				// Matched value has the same content - same parity of index
+				++matchCount;
+				if (sameContent % 2 != i % 2) {
+					++wrongMatchCount;
+				}
+			}
+		});
+	}
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+
+	CHECK(wrongMatchCount.load() == 0);
+	// Files hashed at the same time by two threads are counted once
+	CHECK(index.GetHashedFileCount() <= THREAD_COUNT);
+	CHECK(index.GetSize() == THREAD_COUNT);
+	// The first file of each content can't match, every later one may only miss a file still being inserted
+	CHECK(matchCount.load() <= THREAD_COUNT - 2);
+}
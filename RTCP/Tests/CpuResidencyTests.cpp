@@ -0,0 +1,106 @@
+#include "TestFramework.h"
+#include "CpuResidency.h"
+#include <cstddef>
+#include <vector>
+
+namespace
+{
+	// Shape of VertexBufferStruct - position first, followed by other attributes
+	struct TestVertex {
+		float position[3];
+		float normal[3];
+		float tangent[3];
+		float binormal[3];
+		float uv[2];
+	};
+
+	// Loaded model before residency is applied - every vertex attribute, base and LOD indices
+	const CpuGeometryCounts LOADED = { 1000, 0, 3000, 1200 };
+}
+
+TEST_CASE(CpuResidency_FullKeepsEverything)
+{
+	const CpuGeometryCounts counts = CpuResidencyPolicy::Apply(CpuResidency::Full, LOADED);
+	CHECK(counts.vertices == LOADED.vertices);
+	CHECK(counts.positions == 0);
+	CHECK(counts.indices == LOADED.indices);
+	CHECK(counts.lodIndices == LOADED.lodIndices);
+
+	const CpuResidencyPolicy::Bytes bytes = CpuResidencyPolicy::GetBytes(counts, sizeof(TestVertex));
+	CHECK(bytes.vertices == sizeof(TestVertex) * 1000);
+	CHECK(bytes.positions == 0);
+	CHECK(bytes.indices == sizeof(uint32_t) * (3000 + 1200));
+	CHECK(bytes.GetTotal() == bytes.vertices + bytes.indices);
+}
+
+TEST_CASE(CpuResidency_PositionsAndIndicesReplacesVertices)
+{
+	const CpuGeometryCounts counts = CpuResidencyPolicy::Apply(CpuResidency::PositionsAndIndices, LOADED);
+	CHECK(counts.vertices == 0);
+	CHECK(counts.positions == LOADED.vertices);
+	CHECK(counts.indices == LOADED.indices);
+	CHECK(counts.lodIndices == LOADED.lodIndices);
+
+	// Only vertices shrink - 12 bytes per position instead of the whole vertex
+	const CpuResidencyPolicy::Bytes full = CpuResidencyPolicy::GetBytes(LOADED, sizeof(TestVertex));
+	const CpuResidencyPolicy::Bytes bytes = CpuResidencyPolicy::GetBytes(counts, sizeof(TestVertex));
+	CHECK(bytes.vertices == 0);
+	CHECK(bytes.positions == 3 * sizeof(float) * LOADED.vertices);
+	CHECK(bytes.indices == full.indices);
+	CHECK(full.GetTotal() - bytes.GetTotal() == (sizeof(TestVertex) - 3 * sizeof(float)) * LOADED.vertices);
+
+	// Applying it again to reduced model keeps positions
+	const CpuGeometryCounts again = CpuResidencyPolicy::Apply(CpuResidency::PositionsAndIndices, counts);
+	CHECK(again.positions == counts.positions);
+	CHECK(again.indices == counts.indices);
+}
+
+TEST_CASE(CpuResidency_NoneReleasesEverything)
+{
+	for (const CpuGeometryCounts& before : { LOADED, CpuResidencyPolicy::Apply(CpuResidency::PositionsAndIndices, LOADED) })
+	{
+		const CpuGeometryCounts counts = CpuResidencyPolicy::Apply(CpuResidency::None, before);
+		CHECK(counts.vertices == 0);
+		CHECK(counts.positions == 0);
+		CHECK(counts.indices == 0);
+		CHECK(counts.lodIndices == 0);
+		CHECK(CpuResidencyPolicy::GetBytes(counts, sizeof(TestVertex)).GetTotal() == 0);
+	}
+}
+
+TEST_CASE(CpuResidency_KeepsMatchApply)
+{
+	for (const CpuResidency residency : { CpuResidency::Full, CpuResidency::PositionsAndIndices, CpuResidency::None })
+	{
+		const CpuGeometryCounts counts = CpuResidencyPolicy::Apply(residency, LOADED);
+		CHECK(CpuResidencyPolicy::KeepsVertices(residency) == (counts.vertices > 0));
+		// Positions are part of vertices while those are kept
+		CHECK(CpuResidencyPolicy::KeepsPositions(residency) == (counts.vertices > 0 || counts.positions > 0));
+		CHECK(CpuResidencyPolicy::KeepsIndices(residency) == (counts.indices > 0 && counts.lodIndices > 0));
+	}
+}
+
+TEST_CASE(CpuResidency_ExtractsPositions)
+{
+	std::vector<TestVertex> vertices(37);
+	for (size_t i = 0; i < vertices.size(); ++i)
+	{
+		const float f = static_cast<float>(i);
+		vertices[i] = { { f, f * 0.5f, -f }, { 0.0f, 1.0f, 0.0f }, { 1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f }, { f, f } };
+	}
+
+	std::vector<float> positions(3 * vertices.size());
+	CpuResidencyPolicy::ExtractPositions(vertices.data(), vertices.size(), sizeof(TestVertex), offsetof(TestVertex, position), positions.data());
+	bool positionsEqual = true;
+	for (size_t i = 0; i < vertices.size(); ++i)
+	{
+		positionsEqual = positionsEqual && positions[3 * i] == vertices[i].position[0] && positions[3 * i + 1] == vertices[i].position[1] && positions[3 * i + 2] == vertices[i].position[2];
+	}
+	CHECK(positionsEqual);
+
+	// Any attribute of 3 floats can be extracted the same way
+	CpuResidencyPolicy::ExtractPositions(vertices.data(), vertices.size(), sizeof(TestVertex), offsetof(TestVertex, normal), positions.data());
+	CHECK(positions[3 * 5 + 1] == 1.0f);
+	// Empty model leaves output untouched
+	CpuResidencyPolicy::ExtractPositions(nullptr, 0, sizeof(TestVertex), 0, nullptr);
+}
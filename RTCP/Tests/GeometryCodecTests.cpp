@@ -0,0 +1,211 @@
+#include "TestFramework.h"
+#include "GeometryCodec.h"
+#include <cstring>
+#include <random>
+#include <thread>
+
+namespace
+{
+	// Shape of VertexBufferStruct - position, normal, tangent, binormal, uv
+	struct TestVertex {
+		float position[3];
+		float normal[3];
+		float tangent[3];
+		float binormal[3];
+		float uv[2];
+	};
+
+	// Height field of size x size vertices, two triangles per quad - vertices are introduced in order, as after vertex fetch optimization
+	void GenerateGrid(uint32_t size, std::vector<TestVertex>& vertices, std::vector<uint32_t>& indices)
+	{
+		vertices.clear();
+		indices.clear();
+		for (uint32_t y = 0; y < size; ++y)
+		{
+			for (uint32_t x = 0; x < size; ++x)
+			{
+				TestVertex vertex{};
+				vertex.position[0] = x * 0.1f;
+				vertex.position[1] = std::sin(x * 0.05f) * std::cos(y * 0.05f);
+				vertex.position[2] = y * 0.1f;
+				vertex.normal[1] = 1.0f;
+				vertex.tangent[0] = 1.0f;
+				vertex.binormal[2] = 1.0f;
+				vertex.uv[0] = x / static_cast<float>(size);
+				vertex.uv[1] = y / static_cast<float>(size);
+				vertices.push_back(vertex);
+			}
+		}
+		for (uint32_t y = 0; y + 1 < size; ++y)
+		{
+			for (uint32_t x = 0; x + 1 < size; ++x)
+			{
+				const uint32_t a = y * size + x;
+				const uint32_t c = a + size;
+				indices.insert(indices.end(), { a, c, a + 1, a + 1, c, c + 1 });
+			}
+		}
+	}
+
+	// Decoded triangles may start with different vertex, but keep order and winding
+	bool SameTriangles(const std::vector<uint32_t>& expected, const std::vector<uint32_t>& decoded)
+	{
+		if (expected.size() != decoded.size()) {
+			return false;
+		}
+		for (size_t i = 0; i < expected.size(); i += 3)
+		{
+			bool found = false;
+			for (size_t rotation = 0; rotation < 3; ++rotation)
+			{
+				found = found || (expected[i + rotation] == decoded[i] && expected[i + (rotation + 1) % 3] == decoded[i + 1] && expected[i + (rotation + 2) % 3] == decoded[i + 2]);
+			}
+			if (!found) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Every chunk on its own thread
+	void ThreadPerChunk(size_t count, const std::function<void(size_t)>& func)
+	{
+		std::vector<std::thread> threads;
+		for (size_t i = 0; i < count; ++i)
+		{
+			threads.emplace_back(func, i);
+		}
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+	}
+}
+
+TEST_CASE(GeometryCodec_VerticesRoundTripLosslessly)
+{
+	// Odd stride and random bytes exercise every group mode and lanes left after 4 wide transpose
+	std::mt19937 random(7);
+	for (size_t vertexCount : { 0u, 1u, 15u, 17u, 256u, 1000u })
+	{
+		for (size_t stride : { 1u, 3u, 4u, 7u, 56u })
+		{
+			std::vector<uint8_t> vertices(vertexCount * stride);
+			for (size_t i = 0; i < vertices.size(); ++i)
+			{
+				vertices[i] = static_cast<uint8_t>(i % 5 == 0 ? random() : i / stride);
+			}
+			std::vector<uint8_t> data;
+			GeometryCodec::EncodeVertices(vertices.data(), vertexCount, stride, data);
+			std::vector<uint8_t> decoded(vertices.size() + 1, 0xCD);
+			CHECK(GeometryCodec::DecodeVertices(data.data(), data.size(), decoded.data(), vertexCount, stride));
+			CHECK(vertices.empty() || memcmp(decoded.data(), vertices.data(), vertices.size()) == 0);
+			CHECK(decoded.back() == 0xCD);
+		}
+	}
+}
+
+TEST_CASE(GeometryCodec_IndicesRoundTripWithWinding)
+{
+	std::vector<TestVertex> vertices;
+	std::vector<uint32_t> indices;
+	GenerateGrid(64, vertices, indices);
+
+	// Shuffled copy forces explicit vertices and triangles without cached edge
+	std::vector<uint32_t> shuffled = indices;
+	std::mt19937 random(11);
+	for (size_t i = shuffled.size() / 3; i > 1; --i)
+	{
+		const size_t j = random() % i;
+		std::swap_ranges(shuffled.begin() + (i - 1) * 3, shuffled.begin() + i * 3, shuffled.begin() + j * 3);
+	}
+
+	for (const std::vector<uint32_t>* source : { &indices, &shuffled })
+	{
+		std::vector<uint8_t> data;
+		GeometryCodec::EncodeIndices(source->data(), source->size(), data);
+		std::vector<uint32_t> decoded(source->size());
+		CHECK(GeometryCodec::DecodeIndices(data.data(), data.size(), decoded.data(), decoded.size()));
+		CHECK(SameTriangles(*source, decoded));
+	}
+}
+
+TEST_CASE(GeometryCodec_GridCompresses)
+{
+	std::vector<TestVertex> vertices;
+	std::vector<uint32_t> indices;
+	GenerateGrid(128, vertices, indices);
+	std::vector<uint8_t> vertexData;
+	std::vector<uint8_t> indexData;
+	GeometryCodec::EncodeVertices(vertices.data(), vertices.size(), sizeof(TestVertex), vertexData);
+	GeometryCodec::EncodeIndices(indices.data(), indices.size(), indexData);
+
+	// Strip order costs about one byte per triangle, smooth attributes compress several times
+	CHECK(vertexData.size() * 2 < vertices.size() * sizeof(TestVertex));
+	CHECK(8.0 * indexData.size() / (indices.size() / 3) < 14.0);
+}
+
+TEST_CASE(GeometryCodec_ParallelDecodeMatchesSerial)
+{
+	// Several chunks of both streams, last chunks partially filled
+	std::vector<TestVertex> vertices;
+	std::vector<uint32_t> indices;
+	GenerateGrid(300, vertices, indices);
+	REQUIRE(GeometryCodec::GetVertexChunkCount(vertices.size()) > 2);
+	REQUIRE(GeometryCodec::GetIndexChunkCount(indices.size()) > 2);
+
+	std::vector<uint8_t> vertexData;
+	std::vector<uint8_t> indexData;
+	GeometryCodec::EncodeVertices(vertices.data(), vertices.size(), sizeof(TestVertex), vertexData);
+	GeometryCodec::EncodeIndices(indices.data(), indices.size(), indexData);
+
+	std::vector<TestVertex> decodedVertices(vertices.size());
+	std::vector<uint32_t> decodedIndices(indices.size());
+	CHECK(GeometryCodec::DecodeVertices(vertexData.data(), vertexData.size(), decodedVertices.data(), decodedVertices.size(), sizeof(TestVertex), ThreadPerChunk));
+	CHECK(GeometryCodec::DecodeIndices(indexData.data(), indexData.size(), decodedIndices.data(), decodedIndices.size(), ThreadPerChunk));
+	CHECK(memcmp(decodedVertices.data(), vertices.data(), sizeof(TestVertex) * vertices.size()) == 0);
+	CHECK(SameTriangles(indices, decodedIndices));
+
+	std::vector<uint32_t> serialIndices(indices.size());
+	CHECK(GeometryCodec::DecodeIndices(indexData.data(), indexData.size(), serialIndices.data(), serialIndices.size()));
+	CHECK(serialIndices == decodedIndices);
+}
+
+TEST_CASE(GeometryCodec_RejectsMalformedStreams)
+{
+	std::vector<TestVertex> vertices;
+	std::vector<uint32_t> indices;
+	GenerateGrid(200, vertices, indices);
+	std::vector<uint8_t> vertexData;
+	std::vector<uint8_t> indexData;
+	GeometryCodec::EncodeVertices(vertices.data(), vertices.size(), sizeof(TestVertex), vertexData);
+	GeometryCodec::EncodeIndices(indices.data(), indices.size(), indexData);
+	std::vector<TestVertex> decodedVertices(vertices.size());
+	std::vector<uint32_t> decodedIndices(indices.size());
+
+	// Wrong counts, stride, version and truncated or extended streams
+	CHECK(!GeometryCodec::DecodeVertices(vertexData.data(), vertexData.size(), decodedVertices.data(), vertices.size() - 1, sizeof(TestVertex)));
+	CHECK(!GeometryCodec::DecodeVertices(vertexData.data(), vertexData.size(), decodedVertices.data(), vertices.size(), sizeof(TestVertex) - 4));
+	CHECK(!GeometryCodec::DecodeVertices(vertexData.data(), vertexData.size() - 1, decodedVertices.data(), vertices.size(), sizeof(TestVertex)));
+	CHECK(!GeometryCodec::DecodeIndices(indexData.data(), indexData.size(), decodedIndices.data(), indices.size() - 3));
+	CHECK(!GeometryCodec::DecodeIndices(indexData.data(), indexData.size(), decodedIndices.data(), indices.size() - 1));
+	CHECK(!GeometryCodec::DecodeIndices(indexData.data(), indexData.size() - 1, decodedIndices.data(), indices.size()));
+	vertexData.push_back(0);
+	CHECK(!GeometryCodec::DecodeVertices(vertexData.data(), vertexData.size(), decodedVertices.data(), vertices.size(), sizeof(TestVertex)));
+	indexData[0] ^= 1;
+	CHECK(!GeometryCodec::DecodeIndices(indexData.data(), indexData.size(), decodedIndices.data(), indices.size()));
+
+	// Random corruption may decode to garbage, but never reads or writes out of bounds
+	vertexData.pop_back();
+	indexData[0] ^= 1;
+	std::mt19937 random(5);
+	for (int i = 0; i < 200; ++i)
+	{
+		std::vector<uint8_t> corruptedVertices(vertexData.begin(), vertexData.begin() + 1 + random() % vertexData.size());
+		std::vector<uint8_t> corruptedIndices(indexData.begin(), indexData.begin() + 1 + random() % indexData.size());
+		corruptedVertices[random() % corruptedVertices.size()] ^= static_cast<uint8_t>(1 + random() % 255);
+		corruptedIndices[random() % corruptedIndices.size()] ^= static_cast<uint8_t>(1 + random() % 255);
+		GeometryCodec::DecodeVertices(corruptedVertices.data(), corruptedVertices.size(), decodedVertices.data(), vertices.size(), sizeof(TestVertex));
+		GeometryCodec::DecodeIndices(corruptedIndices.data(), corruptedIndices.size(), decodedIndices.data(), indices.size());
+	}
+}
@@ -0,0 +1,89 @@
+#include "TestFramework.h"
+#include "IndexCompactor.h"
+
+namespace
+{
+	// Triangle fan over vertexCount vertices starting at baseVertex - references the first and the last vertex
+	std::vector<uint32_t> GenerateFan(uint32_t baseVertex, uint32_t vertexCount)
+	{
+		std::vector<uint32_t> indices;
+		for (uint32_t v = 1; v + 1 < vertexCount; ++v)
+		{
+			indices.insert(indices.end(), { baseVertex, baseVertex + v, baseVertex + v + 1 });
+		}
+		return indices;
+	}
+
+	std::vector<uint32_t> Decode(const std::vector<uint8_t>& data, const CompactIndexRange& range)
+	{
+		std::vector<uint32_t> indices(range.indexCount);
+		IndexCompactor::Decode(data.data(), range, indices.data());
+		return indices;
+	}
+}
+
+TEST_CASE(IndexCompactor_SmallMeshesUse16BitIndices)
+{
+	// Base vertex far above 16 bit range doesn't matter, only vertex count of mesh does
+	std::vector<uint8_t> data;
+	const std::vector<uint32_t> indices = GenerateFan(1000000, 300);
+	const CompactIndexRange range = IndexCompactor::Append(indices.data(), indices.size(), 1000000, 300, data);
+
+	CHECK(range.indexSize == sizeof(uint16_t));
+	CHECK(range.baseVertex == 1000000);
+	CHECK(range.indexCount == indices.size());
+	CHECK(data.size() == range.byteOffset + indices.size() * sizeof(uint16_t));
+	CHECK(Decode(data, range) == indices);
+}
+
+TEST_CASE(IndexCompactor_IndexSizeBoundary)
+{
+	std::vector<uint8_t> data;
+	const std::vector<uint32_t> largest16Bit = GenerateFan(7, static_cast<uint32_t>(IndexCompactor::MAX_16BIT_VERTICES));
+	const std::vector<uint32_t> smallest32Bit = GenerateFan(7, static_cast<uint32_t>(IndexCompactor::MAX_16BIT_VERTICES + 1));
+	const CompactIndexRange range16 = IndexCompactor::Append(largest16Bit.data(), largest16Bit.size(), 7, IndexCompactor::MAX_16BIT_VERTICES, data);
+	const CompactIndexRange range32 = IndexCompactor::Append(smallest32Bit.data(), smallest32Bit.size(), 7, IndexCompactor::MAX_16BIT_VERTICES + 1, data);
+
+	// Local index 0xFFFF is the last vertex of the 16 bit mesh and has to survive round trip
+	CHECK(range16.indexSize == sizeof(uint16_t));
+	CHECK(range32.indexSize == sizeof(uint32_t));
+	CHECK(Decode(data, range16) == largest16Bit);
+	CHECK(Decode(data, range32) == smallest32Bit);
+}
+
+TEST_CASE(IndexCompactor_RangesStayAlignedAndIndependent)
+{
+	// Odd index counts of 16 bit ranges would leave next range misaligned without padding
+	std::vector<uint8_t> data;
+	std::vector<std::vector<uint32_t>> meshes;
+	std::vector<CompactIndexRange> ranges;
+	uint32_t baseVertex = 0;
+	for (uint32_t i = 0; i < 6; ++i)
+	{
+		const uint32_t vertexCount = i == 3 ? 70000 : 5 + 2 * i;
+		meshes.push_back(GenerateFan(baseVertex, vertexCount));
+		if (i % 2 == 1) {
+			meshes.back().resize(meshes.back().size() - 2);
+		}
+		ranges.push_back(IndexCompactor::Append(meshes.back().data(), meshes.back().size(), baseVertex, vertexCount, data));
+		baseVertex += vertexCount;
+	}
+
+	for (size_t i = 0; i < ranges.size(); ++i)
+	{
+		CHECK(ranges[i].byteOffset % IndexCompactor::RANGE_ALIGNMENT == 0);
+		CHECK(ranges[i].byteOffset + ranges[i].indexCount * ranges[i].indexSize <= data.size());
+		CHECK(i == 0 || ranges[i].byteOffset >= ranges[i - 1].byteOffset + ranges[i - 1].indexCount * ranges[i - 1].indexSize);
+		CHECK(Decode(data, ranges[i]) == meshes[i]);
+	}
+	CHECK(ranges[3].indexSize == sizeof(uint32_t));
+}
+
+TEST_CASE(IndexCompactor_EmptyMesh)
+{
+	std::vector<uint8_t> data = { 1, 2, 3 };
+	const CompactIndexRange range = IndexCompactor::Append(nullptr, 0, 0, 0, data);
+	CHECK(range.indexCount == 0);
+	CHECK(range.byteOffset == 4);
+	CHECK(Decode(data, range).empty());
+}
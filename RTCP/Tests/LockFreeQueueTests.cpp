@@ -0,0 +1,86 @@
+#include "TestFramework.h"
+#include "LockFreeQueue.h"
+#include <memory>
+#include <thread>
+
+TEST_CASE(LockFreeQueue_SingleProducerIsFifo)
+{
+	LockFreeQueue<int> queue;
+	int value = -1;
+	CHECK(queue.IsEmpty());
+	CHECK(!queue.TryPop(value));
+
+	int expected = 0;
+	for (int i = 0; i < 1000; ++i)
+	{
+		queue.Push(i);
+		// Interleaved pops see the same order as pushes
+		if (i % 3 == 2)
+		{
+			REQUIRE(queue.TryPop(value));
+			CHECK(value == expected++);
+		}
+	}
+	while (queue.TryPop(value))
+	{
+		CHECK(value == expected++);
+	}
+	CHECK(expected == 1000);
+	CHECK(queue.IsEmpty());
+}
+
+TEST_CASE(LockFreeQueue_MovesOnlyValues)
+{
+	LockFreeQueue<std::unique_ptr<int>> queue;
+	queue.Push(std::unique_ptr<int>(new int(7)));
+	std::unique_ptr<int> value;
+	REQUIRE(queue.TryPop(value));
+	REQUIRE(value != nullptr);
+	CHECK(*value == 7);
+}
+
+TEST_CASE(LockFreeQueue_ProducersKeepTheirOrder)
+{
+	// Values of different producers interleave, but every producer's values arrive in the order it pushed them
+	const int producerCount = 4;
+	const int valuesPerProducer = 50000;
+	LockFreeQueue<int> queue;
+	std::vector<std::thread> producers;
+	for (int producer = 0; producer < producerCount; ++producer)
+	{
+		producers.emplace_back([&queue, producer]() {
+			for (int i = 0; i < valuesPerProducer; ++i)
+			{
+				queue.Push(producer * valuesPerProducer + i);
+			}
+		});
+	}
+
+	std::vector<int> nextValues(producerCount, 0);
+	int received = 0;
+	bool ordered = true;
+	while (received < producerCount * valuesPerProducer)
+	{
+		int value;
+		if (!queue.TryPop(value))
+		{
+			std::this_thread::yield();
+			continue;
+		}
+		const int producer = value / valuesPerProducer;
+		ordered = ordered && value % valuesPerProducer == nextValues[producer];
+		nextValues[producer] = value % valuesPerProducer + 1;
+		++received;
+	}
+	for (std::thread& thread : producers)
+	{
+		thread.join();
+	}
+
+	CHECK(ordered);
+	for (int producer = 0; producer < producerCount; ++producer)
+	{
+		CHECK(nextValues[producer] == valuesPerProducer);
+	}
+	CHECK(queue.IsEmpty());
+}
@@ -0,0 +1,201 @@
+#include "TestFramework.h"
+#include "TestImages.h"
+#include "MeshCacheFormat.h"
+#include <cstring>
+#include <limits>
+
+namespace
+{
+	constexpr uint32_t IMPORT_FLAGS = 0x8000;
+	constexpr uint64_t PROCESSING_KEY = 0x1234;
+	// Sizes of ModelClass structures don't matter to validation, only that reader and header agree
+	const MeshCacheFormat::ElementSizes SIZES = { 56, 16, 12, 40, 144 };
+
+	// Header of raw cache with one mesh and every section page aligned, as MeshCache::Write lays it out
+	MeshCacheFormat::Header CreateHeader()
+	{
+		MeshCacheFormat::Header header;
+		MeshCacheFormat::InitHeader(header);
+		header.importFlags = IMPORT_FLAGS;
+		header.processingKey = PROCESSING_KEY;
+		header.sourceSize = 1000;
+		header.sourceWriteTime = 2000;
+		header.sourceHash = 3000;
+		header.vertexStride = static_cast<uint32_t>(SIZES.vertex);
+		header.meshCount = 1;
+		header.geometryEncoding = MeshCacheFormat::GEOMETRY_RAW;
+		header.vertexCount = 4;
+		header.indexCount = 6;
+		header.stringTableSize = 32;
+		header.lodCount = 1;
+		header.lodIndexCount = 3;
+		header.nodeCount = 1;
+		header.nodeMeshCount = 1;
+		header.verticesSize = SIZES.vertex * header.vertexCount;
+		header.indicesSize = sizeof(uint32_t) * header.indexCount;
+		header.lodIndicesSize = sizeof(uint32_t) * header.lodIndexCount;
+
+		uint64_t* offsets[] = { &header.meshRangesOffset, &header.meshLodOffsetsOffset, &header.lodRangesOffset, &header.textureTableOffset, &header.materialsOffset,
+			&header.stringTableOffset, &header.verticesOffset, &header.indicesOffset, &header.lodIndicesOffset, &header.nodesOffset, &header.nodeMeshesOffset };
+		uint64_t offset = MeshCacheFormat::PAGE_ALIGNMENT;
+		for (uint64_t* sectionOffset : offsets)
+		{
+			*sectionOffset = offset;
+			offset += MeshCacheFormat::PAGE_ALIGNMENT;
+		}
+		header.fileSize = header.nodeMeshesOffset + sizeof(uint32_t) * header.nodeMeshCount;
+		return header;
+	}
+
+	// FNV-1a over 8 byte words of data in memory, as hashed by the mapped reader it replaced
+	uint64_t HashData(const std::vector<uint8_t>& data)
+	{
+		uint64_t hash = 14695981039346656037ull;
+		const size_t wordCount = data.size() / sizeof(uint64_t);
+		for (size_t i = 0; i < wordCount; ++i)
+		{
+			uint64_t word;
+			memcpy(&word, data.data() + i * sizeof(uint64_t), sizeof(uint64_t));
+			hash = (hash ^ word) * 1099511628211ull;
+		}
+		for (size_t i = wordCount * sizeof(uint64_t); i < data.size(); ++i)
+		{
+			hash = (hash ^ data[i]) * 1099511628211ull;
+		}
+		return hash;
+	}
+
+	bool IsLayoutValid(const MeshCacheFormat::Header& header)
+	{
+		return MeshCacheFormat::IsLayoutValid(header, header.fileSize, IMPORT_FLAGS, PROCESSING_KEY, SIZES);
+	}
+}
+
+TEST_CASE(MeshCacheFormat_AcceptsValidHeader)
+{
+	const MeshCacheFormat::Header header = CreateHeader();
+	CHECK(IsLayoutValid(header));
+	CHECK(MeshCacheFormat::IsRawGeometryValid(header));
+
+	size_t hashCount = 0;
+	CHECK(MeshCacheFormat::IsSourceValid(header, { 1000, 2000 }, [&hashCount]() { ++hashCount; return 3000ull; }));
+	CHECK(hashCount == 1);
+}
+
+TEST_CASE(MeshCacheFormat_RejectsDifferentWriter)
+{
+	const MeshCacheFormat::Header valid = CreateHeader();
+	CHECK(!MeshCacheFormat::IsLayoutValid(valid, valid.fileSize, IMPORT_FLAGS + 1, PROCESSING_KEY, SIZES));
+	CHECK(!MeshCacheFormat::IsLayoutValid(valid, valid.fileSize, IMPORT_FLAGS, PROCESSING_KEY + 1, SIZES));
+	// Reader compiled with different vertex layout
+	MeshCacheFormat::ElementSizes sizes = SIZES;
+	sizes.vertex += 4;
+	CHECK(!MeshCacheFormat::IsLayoutValid(valid, valid.fileSize, IMPORT_FLAGS, PROCESSING_KEY, sizes));
+
+	MeshCacheFormat::Header header = valid;
+	header.magic[0] = 'X';
+	CHECK(!IsLayoutValid(header));
+	header = valid;
+	header.version = MeshCacheFormat::VERSION - 1;
+	CHECK(!IsLayoutValid(header));
+	header = valid;
+	header.geometryEncoding = MeshCacheFormat::GEOMETRY_CODEC + 1;
+	CHECK(!IsLayoutValid(header));
+}
+
+TEST_CASE(MeshCacheFormat_RejectsTruncatedFile)
+{
+	const MeshCacheFormat::Header header = CreateHeader();
+	CHECK(!MeshCacheFormat::IsLayoutValid(header, header.fileSize - 1, IMPORT_FLAGS, PROCESSING_KEY, SIZES));
+	CHECK(!MeshCacheFormat::IsLayoutValid(header, sizeof(MeshCacheFormat::Header) - 1, IMPORT_FLAGS, PROCESSING_KEY, SIZES));
+}
+
+TEST_CASE(MeshCacheFormat_RejectsSectionOutsideFile)
+{
+	const MeshCacheFormat::Header valid = CreateHeader();
+	MeshCacheFormat::Header header = valid;
+	header.nodeMeshCount = 2;
+	CHECK(!IsLayoutValid(header));
+	header = valid;
+	header.stringTableOffset = valid.fileSize;
+	CHECK(!IsLayoutValid(header));
+	// Last section may end exactly at the end of file, but not start past it
+	header = valid;
+	header.nodeMeshesOffset = valid.fileSize;
+	header.nodeMeshCount = 0;
+	CHECK(IsLayoutValid(header));
+	header.nodeMeshesOffset = valid.fileSize + 1;
+	CHECK(!IsLayoutValid(header));
+}
+
+TEST_CASE(MeshCacheFormat_RejectsOverflowingSection)
+{
+	const MeshCacheFormat::Header valid = CreateHeader();
+	// offset + size wraps around to a small value
+	MeshCacheFormat::Header header = valid;
+	header.verticesSize = std::numeric_limits<uint64_t>::max() - header.verticesOffset + 2;
+	CHECK(!IsLayoutValid(header));
+	// size * count wraps around to a small value
+	header = valid;
+	header.lodCount = (std::numeric_limits<uint64_t>::max() / SIZES.lodRange) + 1;
+	CHECK(!IsLayoutValid(header));
+	header = valid;
+	header.nodeMeshCount = 1ull << 62;
+	CHECK(!IsLayoutValid(header));
+	// Wrapped product of raw geometry count equal to stored size
+	header = valid;
+	header.indexCount += 1ull << 62;
+	CHECK(!MeshCacheFormat::IsRawGeometryValid(header));
+}
+
+TEST_CASE(MeshCacheFormat_RejectsRawSizeMismatch)
+{
+	const MeshCacheFormat::Header valid = CreateHeader();
+	MeshCacheFormat::Header header = valid;
+	header.vertexCount += 1;
+	CHECK(!MeshCacheFormat::IsRawGeometryValid(header));
+	header = valid;
+	header.indicesSize -= 2;
+	CHECK(!MeshCacheFormat::IsRawGeometryValid(header));
+	header = valid;
+	header.lodIndexCount = 0;
+	CHECK(!MeshCacheFormat::IsRawGeometryValid(header));
+}
+
+TEST_CASE(MeshCacheFormat_HashesSourceLast)
+{
+	const MeshCacheFormat::Header header = CreateHeader();
+	size_t hashCount = 0;
+	const MeshCacheFormat::HashSource hashSource = [&hashCount]() { ++hashCount; return 3000ull; };
+	CHECK(!MeshCacheFormat::IsSourceValid(header, { 1001, 2000 }, hashSource));
+	CHECK(!MeshCacheFormat::IsSourceValid(header, { 1000, 2001 }, hashSource));
+	CHECK(hashCount == 0);
+
+	// Same size and write time, different content
+	CHECK(!MeshCacheFormat::IsSourceValid(header, { 1000, 2000 }, []() { return 3001ull; }));
+}
+
+TEST_CASE(MeshCacheFormat_HashesFileContent)
+{
+	// Sizes around 8 byte words and around read block
+	for (const size_t size : { static_cast<size_t>(0), static_cast<size_t>(7), static_cast<size_t>(8), static_cast<size_t>(13), static_cast<size_t>((1 << 20) + 3) })
+	{
+		std::vector<uint8_t> data(size);
+		for (size_t i = 0; i < size; ++i)
+		{
+			data[i] = static_cast<uint8_t>(i * 31 + 7);
+		}
+		const TestImages::TemporaryFile file{ "format-hash.bin", data };
+		const TestImages::TemporaryFile copy{ "format-hash-copy.bin", data };
+		CHECK(MeshCacheFormat::HashFile(file.GetPath()) == HashData(data));
+		CHECK(MeshCacheFormat::HashFile(file.GetPath()) == MeshCacheFormat::HashFile(copy.GetPath()));
+
+		if (size > 0)
+		{
+			data.back() ^= 1;
+			const TestImages::TemporaryFile changed{ "format-hash-changed.bin", data };
+			CHECK(MeshCacheFormat::HashFile(file.GetPath()) != MeshCacheFormat::HashFile(changed.GetPath()));
+		}
+	}
+	CHECK(MeshCacheFormat::HashFile("format-hash-missing.bin") == 0);
+}
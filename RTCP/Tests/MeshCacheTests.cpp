@@ -0,0 +1,228 @@
+#include "TestFramework.h"
+#include "TestImages.h"
+#include "MeshCache.h"
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
+namespace
+{
+	typedef ModelClass::VertexBufferStruct Vertex;
+
+	// Two meshes in one stream, first with one LOD, both placed by single node - vertexCount makes the second mesh as large as needed
+	struct TestModel
+	{
+		std::vector<Vertex> vertices;
+		std::vector<UINT32> indices;
+		std::vector<MeshCache::MeshRange> meshRanges;
+		std::vector<ModelClass::MeshTexturePaths> texturePaths;
+		std::vector<ModelClass::Material> materials;
+		std::vector<UINT32> meshLodOffsets;
+		std::vector<MeshCache::LodRange> lodRanges;
+		std::vector<UINT32> lodIndices;
+		std::vector<MeshCache::SceneNode> nodes;
+		std::vector<UINT32> nodeMeshes;
+	};
+
+	TestModel CreateTestModel(UINT32 vertexCount)
+	{
+		TestModel model;
+		for (UINT32 i = 0; i < vertexCount; ++i)
+		{
+			const float f = static_cast<float>(i);
+			model.vertices.push_back({ { f, f * 0.5f, -f }, { 0.0f, 1.0f, 0.0f }, { 1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f }, { f / vertexCount, 1.0f - f / vertexCount } });
+		}
+		// Quad of first 4 vertices, strip over the rest
+		model.indices = { 0, 1, 2, 2, 1, 3 };
+		for (UINT32 i = 4; i + 2 < vertexCount; ++i)
+		{
+			model.indices.insert(model.indices.end(), { i, i + 1, i + 2 });
+		}
+		model.meshRanges = { { 0, 4, 0, 6 }, { 4, vertexCount - 4, 6, static_cast<UINT32>(model.indices.size()) - 6 } };
+		model.texturePaths = { { "textures\\albedo.png", "", "textures\\normal.png" }, { "textures\\albedo.png", "textures\\specular.png", "" } };
+		model.materials = { { 0, ModelClass::INVALID_TEXTURE_ID, 0, 0.5f, { 1.0f, 1.0f, 1.0f }, 0.0f }, { 1, 0, ModelClass::INVALID_TEXTURE_ID, 1.0f, { 0.2f, 0.4f, 0.8f }, 0.0f } };
+		model.meshLodOffsets = { 0, 1, 1 };
+		model.lodIndices = { 0, 1, 3 };
+		model.lodRanges = { { 0, 3, 0.25f } };
+		MeshCache::SceneNode node = {};
+		node.localTransform = XMFLOAT4X4(1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 2.0f, 3.0f, 4.0f, 1.0f);
+		node.worldTransform = node.localTransform;
+		node.parent = -1;
+		node.meshOffset = 0;
+		node.meshCount = 2;
+		model.nodes = { node };
+		model.nodeMeshes = { 0, 1 };
+		return model;
+	}
+
+	// Source asset with its cache - cache is removed with it, every MeshCache has to be closed by then
+	class CachedSource
+	{
+	public:
+		CachedSource(const std::string& name, const std::vector<uint8_t>& data) : m_source(name, data) {}
+		~CachedSource() { remove(MeshCache::GetCachePath(m_source.GetPath()).c_str()); }
+		const std::string& GetPath() const { return m_source.GetPath(); }
+
+		bool Write(const TestModel& model, UINT32 importFlags, UINT64 processingKey, bool encodeGeometry) const
+		{
+			return MeshCache::Write(GetPath(), importFlags, processingKey, model.vertices, model.indices, model.meshRanges, model.texturePaths, model.materials,
+				model.meshLodOffsets, model.lodRanges, model.lodIndices, model.nodes, model.nodeMeshes, encodeGeometry);
+		}
+
+	private:
+		TestImages::TemporaryFile m_source;
+	};
+
+	// Encoded triangles may start with different vertex, but keep order and winding
+	bool SameTriangles(const UINT32* expected, const UINT32* decoded, size_t indexCount)
+	{
+		for (size_t i = 0; i < indexCount; i += 3)
+		{
+			bool found = false;
+			for (size_t rotation = 0; rotation < 3; ++rotation)
+			{
+				found = found || (expected[i + rotation] == decoded[i] && expected[i + (rotation + 1) % 3] == decoded[i + 1] && expected[i + (rotation + 2) % 3] == decoded[i + 2]);
+			}
+			if (!found) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void CheckContent(const MeshCache& cache, const TestModel& model)
+	{
+		REQUIRE(cache.GetMeshCount() == model.meshRanges.size());
+		REQUIRE(cache.GetVertexCount() == model.vertices.size());
+		REQUIRE(cache.GetIndexCount() == model.indices.size());
+		REQUIRE(cache.GetLodCount() == model.lodRanges.size());
+		REQUIRE(cache.GetLodIndexCount() == model.lodIndices.size());
+		REQUIRE(cache.GetNodeCount() == model.nodes.size());
+		REQUIRE(cache.GetNodeMeshCount() == model.nodeMeshes.size());
+
+		CHECK(memcmp(cache.GetVertices(), model.vertices.data(), sizeof(Vertex) * model.vertices.size()) == 0);
+		CHECK(memcmp(cache.GetMeshRanges(), model.meshRanges.data(), sizeof(MeshCache::MeshRange) * model.meshRanges.size()) == 0);
+		CHECK(memcmp(cache.GetMaterials(), model.materials.data(), sizeof(ModelClass::Material) * model.materials.size()) == 0);
+		CHECK(memcmp(cache.GetMeshLodOffsets(), model.meshLodOffsets.data(), sizeof(UINT32) * model.meshLodOffsets.size()) == 0);
+		CHECK(memcmp(cache.GetLodRanges(), model.lodRanges.data(), sizeof(MeshCache::LodRange) * model.lodRanges.size()) == 0);
+		CHECK(memcmp(cache.GetSceneNodes(), model.nodes.data(), sizeof(MeshCache::SceneNode) * model.nodes.size()) == 0);
+		CHECK(memcmp(cache.GetNodeMeshes(), model.nodeMeshes.data(), sizeof(UINT32) * model.nodeMeshes.size()) == 0);
+		for (UINT32 i = 0; i < cache.GetMeshCount(); ++i)
+		{
+			const ModelClass::MeshTexturePaths paths = cache.GetTexturePaths(i);
+			CHECK(paths.albedo == model.texturePaths[i].albedo);
+			CHECK(paths.specular == model.texturePaths[i].specular);
+			CHECK(paths.normal == model.texturePaths[i].normal);
+		}
+
+		if (cache.IsEncoded())
+		{
+			CHECK(SameTriangles(model.indices.data(), cache.GetIndices(), model.indices.size()));
+			CHECK(SameTriangles(model.lodIndices.data(), cache.GetLodIndices(), model.lodIndices.size()));
+		}
+		else
+		{
+			CHECK(memcmp(cache.GetIndices(), model.indices.data(), sizeof(UINT32) * model.indices.size()) == 0);
+			CHECK(memcmp(cache.GetLodIndices(), model.lodIndices.data(), sizeof(UINT32) * model.lodIndices.size()) == 0);
+		}
+	}
+
+	constexpr UINT32 IMPORT_FLAGS = 0x1234;
+	constexpr UINT64 PROCESSING_KEY = 0xABCDEF0123456789ull;
+}
+
+TEST_CASE(MeshCache_RawRoundTrip)
+{
+	const CachedSource source{ "raw.obj", std::vector<uint8_t>(1000, 'v') };
+	const TestModel model = CreateTestModel(100);
+	REQUIRE(source.Write(model, IMPORT_FLAGS, PROCESSING_KEY, false));
+
+	MeshCache cache;
+	REQUIRE(cache.Open(source.GetPath(), IMPORT_FLAGS, PROCESSING_KEY));
+	CHECK(!cache.IsEncoded());
+	CheckContent(cache, model);
+}
+
+TEST_CASE(MeshCache_EncodedRoundTrip)
+{
+	// Enough vertices and triangles for several codec chunks, decoded in parallel
+	const CachedSource source{ "encoded.obj", std::vector<uint8_t>(1000, 'v') };
+	const TestModel model = CreateTestModel(50000);
+	REQUIRE(source.Write(model, IMPORT_FLAGS, PROCESSING_KEY, true));
+
+	MeshCache cache;
+	REQUIRE(cache.Open(source.GetPath(), IMPORT_FLAGS, PROCESSING_KEY));
+	CHECK(cache.IsEncoded());
+	CheckContent(cache, model);
+}
+
+TEST_CASE(MeshCache_RejectsDifferentSettings)
+{
+	const CachedSource source{ "settings.obj", std::vector<uint8_t>(1000, 'v') };
+	REQUIRE(source.Write(CreateTestModel(100), IMPORT_FLAGS, PROCESSING_KEY, false));
+
+	MeshCache cache;
+	CHECK(!cache.Open(source.GetPath(), IMPORT_FLAGS ^ 1, PROCESSING_KEY));
+	CHECK(!cache.Open(source.GetPath(), IMPORT_FLAGS, PROCESSING_KEY + 1));
+	CHECK(cache.Open(source.GetPath(), IMPORT_FLAGS, PROCESSING_KEY));
+}
+
+TEST_CASE(MeshCache_RejectsChangedSource)
+{
+	const CachedSource source{ "changed.obj", std::vector<uint8_t>(1000, 'v') };
+	REQUIRE(source.Write(CreateTestModel(100), IMPORT_FLAGS, PROCESSING_KEY, false));
+	FILETIME writeTime;
+	{
+		const HANDLE file = CreateFileA(source.GetPath().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		REQUIRE(file != INVALID_HANDLE_VALUE);
+		CHECK(GetFileTime(file, nullptr, nullptr, &writeTime) != FALSE);
+		CloseHandle(file);
+	}
+
+	// Same size and write time - only content hash tells the source changed
+	{
+		std::ofstream file{ source.GetPath(), std::ofstream::in | std::ofstream::out | std::ofstream::binary };
+		file.seekp(500);
+		file.put('x');
+	}
+	{
+		const HANDLE file = CreateFileA(source.GetPath().c_str(), FILE_WRITE_ATTRIBUTES, 0, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		REQUIRE(file != INVALID_HANDLE_VALUE);
+		CHECK(SetFileTime(file, nullptr, nullptr, &writeTime) != FALSE);
+		CloseHandle(file);
+	}
+	MeshCache cache;
+	CHECK(!cache.Open(source.GetPath(), IMPORT_FLAGS, PROCESSING_KEY));
+
+	// Grown source is caught by its size
+	REQUIRE(source.Write(CreateTestModel(100), IMPORT_FLAGS, PROCESSING_KEY, false));
+	CHECK(cache.Open(source.GetPath(), IMPORT_FLAGS, PROCESSING_KEY));
+	cache.Close();
+	{
+		std::ofstream file{ source.GetPath(), std::ofstream::out | std::ofstream::binary | std::ofstream::app };
+		file.put('v');
+	}
+	CHECK(!cache.Open(source.GetPath(), IMPORT_FLAGS, PROCESSING_KEY));
+}
+
+TEST_CASE(MeshCache_RejectsTruncatedCache)
+{
+	const CachedSource source{ "truncated.obj", std::vector<uint8_t>(1000, 'v') };
+	REQUIRE(source.Write(CreateTestModel(2000), IMPORT_FLAGS, PROCESSING_KEY, true));
+
+	// Cache cut in the middle of its last section
+	const std::string cachePath = MeshCache::GetCachePath(source.GetPath());
+	std::vector<char> data;
+	{
+		std::ifstream file{ cachePath, std::ifstream::in | std::ifstream::binary };
+		data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	}
+	REQUIRE(data.size() > sizeof(MeshCache::Header));
+	{
+		std::ofstream file{ cachePath, std::ofstream::out | std::ofstream::binary | std::ofstream::trunc };
+		file.write(data.data(), data.size() - 4);
+	}
+
+	MeshCache cache;
+	CHECK(!cache.Open(source.GetPath(), IMPORT_FLAGS, PROCESSING_KEY));
+}
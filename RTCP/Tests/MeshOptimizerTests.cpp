@@ -0,0 +1,349 @@
+#include "TestFramework.h"
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	// Grid of quads in XZ plane, triangles row by row or in shuffled order
+	struct TestMesh
+	{
+		std::vector<float> positions;
+		std::vector<uint32_t> indices;
+	};
+
+	TestMesh CreateGrid(uint32_t size, bool shuffle)
+	{
+		TestMesh mesh;
+		for (uint32_t z = 0; z <= size; ++z)
+		{
+			for (uint32_t x = 0; x <= size; ++x)
+			{
+				mesh.positions.insert(mesh.positions.end(), { static_cast<float>(x), 0.0f, static_cast<float>(z) });
+			}
+		}
+		std::vector<uint32_t> triangles;
+		for (uint32_t z = 0; z < size; ++z)
+		{
+			for (uint32_t x = 0; x < size; ++x)
+			{
+				const uint32_t corner = z * (size + 1) + x;
+				triangles.insert(triangles.end(), { corner, corner + size + 1, corner + 1, corner + 1, corner + size + 1, corner + size + 2 });
+			}
+		}
+
+		if (!shuffle)
+		{
+			mesh.indices = triangles;
+			return mesh;
+		}
+
+		// Fixed seed LCG, so failures reproduce
+		uint32_t state = 12345;
+		const size_t triangleCount = triangles.size() / 3;
+		std::vector<uint32_t> order(triangleCount);
+		for (uint32_t i = 0; i < triangleCount; ++i)
+		{
+			order[i] = i;
+		}
+		for (size_t i = triangleCount - 1; i > 0; --i)
+		{
+			state = state * 1664525u + 1013904223u;
+			std::swap(order[i], order[state % (i + 1)]);
+		}
+		for (uint32_t triangle : order)
+		{
+			mesh.indices.insert(mesh.indices.end(), triangles.begin() + triangle * 3, triangles.begin() + triangle * 3 + 3);
+		}
+		return mesh;
+	}
+
+	// Triangles rotated to start with their smallest index, so reordering passes may start triangle with any corner but can't flip winding
+	std::vector<std::vector<uint32_t>> GetSortedTriangles(const std::vector<uint32_t>& indices)
+	{
+		std::vector<std::vector<uint32_t>> triangles;
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			std::vector<uint32_t> triangle = { indices[i], indices[i + 1], indices[i + 2] };
+			std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+			triangles.push_back(triangle);
+		}
+		std::sort(triangles.begin(), triangles.end());
+		return triangles;
+	}
+
+	// Sum of distances between centroids of consecutive triangles - spatial order keeps it close to triangle count
+	double GetPathLength(const TestMesh& mesh, const std::vector<uint32_t>& indices)
+	{
+		double length = 0.0;
+		for (size_t i = 3; i < indices.size(); i += 3)
+		{
+			double distance = 0.0;
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				const float current = mesh.positions[indices[i] * 3 + axis] + mesh.positions[indices[i + 1] * 3 + axis] + mesh.positions[indices[i + 2] * 3 + axis];
+				const float previous = mesh.positions[indices[i - 3] * 3 + axis] + mesh.positions[indices[i - 2] * 3 + axis] + mesh.positions[indices[i - 1] * 3 + axis];
+				distance += (current - previous) * (current - previous) / 9.0;
+			}
+			length += std::sqrt(distance);
+		}
+		return length;
+	}
+
+	// Layout of ModelClass::VertexBufferStruct followed by material word, which has to be compared exactly
+	struct WeldVertex
+	{
+		float position[3];
+		float normal[3];
+		float tangent[3];
+		float binormal[3];
+		float uv[2];
+		uint32_t material;
+	};
+	constexpr size_t WELD_FLOAT_COUNT = 14;
+
+	WeldVertex CreateWeldVertex(float x, float y, float z, float u, float v)
+	{
+		return { { x, y, z }, { 0.0f, 1.0f, 0.0f }, { 1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f }, { u, v }, 7 };
+	}
+
+	// Every corner of every triangle keeps its attributes - floats may only move within epsilon, material not at all
+	bool CornersKept(const std::vector<WeldVertex>& originalVertices, const std::vector<uint32_t>& originalIndices, const std::vector<WeldVertex>& vertices, const std::vector<uint32_t>& indices, float epsilon)
+	{
+		for (size_t i = 0; i < indices.size(); ++i)
+		{
+			const WeldVertex& welded = vertices[indices[i]];
+			const WeldVertex& original = originalVertices[originalIndices[i]];
+			const float* weldedFloats = welded.position;
+			const float* originalFloats = original.position;
+			for (size_t j = 0; j < WELD_FLOAT_COUNT; ++j)
+			{
+				if (std::abs(weldedFloats[j] - originalFloats[j]) > epsilon) {
+					return false;
+				}
+			}
+			if (welded.material != original.material) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	size_t Weld(std::vector<WeldVertex>& vertices, std::vector<uint32_t>& indices, float epsilon)
+	{
+		return MeshOptimizer::WeldVertices(vertices.data(), vertices.size(), sizeof(WeldVertex), WELD_FLOAT_COUNT, epsilon, indices.data(), indices.size());
+	}
+
+	// One thread per call, enough to run blocks concurrently without ThreadPool
+	void ParallelForThreads(size_t count, const std::function<void(size_t)>& func)
+	{
+		std::vector<std::thread> threads;
+		for (size_t i = 0; i < count; ++i)
+		{
+			threads.emplace_back(func, i);
+		}
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+	}
+}
+
+TEST_CASE(MeshOptimizer_SortSpatiallyKeepsTriangles)
+{
+	const TestMesh mesh = CreateGrid(64, true);
+	std::vector<uint32_t> indices = mesh.indices;
+	MeshOptimizer::SortTrianglesSpatially(indices.data(), indices.size(), mesh.positions.data(), mesh.positions.size() / 3, 3 * sizeof(float));
+
+	CHECK(GetSortedTriangles(indices) == GetSortedTriangles(mesh.indices));
+	CHECK(GetPathLength(mesh, indices) < 0.1 * GetPathLength(mesh, mesh.indices));
+}
+
+TEST_CASE(MeshOptimizer_SortSpatiallyParallelMatchesSerial)
+{
+	// Several sort blocks, last one partial
+	const TestMesh mesh = CreateGrid(300, true);
+	std::vector<uint32_t> serial = mesh.indices;
+	std::vector<uint32_t> parallel = mesh.indices;
+	MeshOptimizer::SortTrianglesSpatially(serial.data(), serial.size(), mesh.positions.data(), mesh.positions.size() / 3, 3 * sizeof(float));
+	MeshOptimizer::SortTrianglesSpatially(parallel.data(), parallel.size(), mesh.positions.data(), mesh.positions.size() / 3, 3 * sizeof(float), ParallelForThreads);
+
+	CHECK(serial == parallel);
+	CHECK(GetSortedTriangles(parallel) == GetSortedTriangles(mesh.indices));
+}
+
+TEST_CASE(MeshOptimizer_SortSpatiallyIsStable)
+{
+	// Every triangle has the same centroid, so input order is kept
+	const std::vector<float> positions = { 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f, 1.0f, 0.0f };
+	std::vector<uint32_t> indices;
+	for (uint32_t i = 0; i < 100; ++i)
+	{
+		indices.insert(indices.end(), { 0, 1, 2 });
+		indices.insert(indices.end(), { 1, 2, 0 });
+	}
+	const std::vector<uint32_t> expected = indices;
+	MeshOptimizer::SortTrianglesSpatially(indices.data(), indices.size(), positions.data(), 4, 3 * sizeof(float), ParallelForThreads);
+	CHECK(indices == expected);
+}
+
+TEST_CASE(MeshOptimizer_AnalyzeVertexCacheCountsMisses)
+{
+	// Fan around vertex 0 with cache of 3 - FIFO evicts it by the second triangle, LRU keeps it since every triangle refreshes it
+	const std::vector<uint32_t> indices = { 0, 1, 2, 0, 3, 4, 0, 5, 6 };
+	const MeshOptimizer::VertexCacheStatistics fifo = MeshOptimizer::AnalyzeVertexCache(indices.data(), indices.size(), 7, 3, MeshOptimizer::CacheModel::Fifo);
+	CHECK(fifo.triangleCount == 3);
+	CHECK(fifo.vertexCount == 7);
+	CHECK(fifo.cacheMisses == 8);
+	CHECK_NEAR(fifo.acmr, 8.0f / 3.0f, 1e-6f);
+	CHECK_NEAR(fifo.atvr, 8.0f / 7.0f, 1e-6f);
+
+	const MeshOptimizer::VertexCacheStatistics lru = MeshOptimizer::AnalyzeVertexCache(indices.data(), indices.size(), 7, 3, MeshOptimizer::CacheModel::Lru);
+	CHECK(lru.cacheMisses == 7);
+	// With cache large enough every vertex is transformed once
+	const MeshOptimizer::VertexCacheStatistics large = MeshOptimizer::AnalyzeVertexCache(indices.data(), indices.size(), 7, 16, MeshOptimizer::CacheModel::Lru);
+	CHECK(large.cacheMisses == 7);
+	CHECK_NEAR(large.atvr, 1.0f, 1e-6f);
+}
+
+TEST_CASE(MeshOptimizer_VertexCacheLowersAcmrOfGrid)
+{
+	for (bool shuffle : { false, true })
+	{
+		const TestMesh mesh = CreateGrid(64, shuffle);
+		const size_t vertexCount = mesh.positions.size() / 3;
+		std::vector<uint32_t> indices = mesh.indices;
+		MeshOptimizer::OptimizeVertexCache(indices.data(), indices.size(), vertexCount);
+		CHECK(GetSortedTriangles(indices) == GetSortedTriangles(mesh.indices));
+
+		for (MeshOptimizer::CacheModel model : { MeshOptimizer::CacheModel::Fifo, MeshOptimizer::CacheModel::Lru })
+		{
+			const MeshOptimizer::VertexCacheStatistics before = MeshOptimizer::AnalyzeVertexCache(mesh.indices.data(), mesh.indices.size(), vertexCount, MeshOptimizer::DEFAULT_CACHE_SIZE, model);
+			const MeshOptimizer::VertexCacheStatistics after = MeshOptimizer::AnalyzeVertexCache(indices.data(), indices.size(), vertexCount, MeshOptimizer::DEFAULT_CACHE_SIZE, model);
+			CHECK(after.acmr <= before.acmr);
+			// Regular grid can't go below 0.5, Tipsify stays well under the 1.0 of row by row order
+			CHECK(after.acmr >= 0.5f);
+			CHECK(after.acmr < 0.9f);
+		}
+	}
+}
+
+TEST_CASE(MeshOptimizer_VertexFetchKeepsGeometry)
+{
+	// Last vertex is referenced by no triangle
+	TestMesh mesh = CreateGrid(32, true);
+	mesh.positions.insert(mesh.positions.end(), { -1.0f, -1.0f, -1.0f });
+	const size_t vertexCount = mesh.positions.size() / 3;
+	std::vector<float> positions = mesh.positions;
+	std::vector<uint32_t> indices = mesh.indices;
+	MeshOptimizer::OptimizeVertexFetch(positions.data(), vertexCount, 3 * sizeof(float), indices.data(), indices.size());
+
+	REQUIRE(indices.size() == mesh.indices.size());
+	uint32_t nextVertex = 0;
+	for (size_t i = 0; i < indices.size(); ++i)
+	{
+		// Every corner keeps its position, new vertices appear in order of first use
+		CHECK(memcmp(&positions[indices[i] * 3], &mesh.positions[mesh.indices[i] * 3], 3 * sizeof(float)) == 0);
+		CHECK(indices[i] <= nextVertex);
+		nextVertex = std::max<uint32_t>(nextVertex, indices[i] + 1);
+	}
+	CHECK(nextVertex == vertexCount - 1);
+	CHECK(positions[(vertexCount - 1) * 3] == -1.0f);
+}
+
+TEST_CASE(MeshOptimizer_WeldMergesBitIdenticalVertices)
+{
+	// Quad emitted per triangle corner, like ProcessMesh does - 6 vertices, 4 unique
+	const std::vector<WeldVertex> originalVertices = {
+		CreateWeldVertex(0.0f, 0.0f, 0.0f, 0.0f, 0.0f), CreateWeldVertex(0.0f, 0.0f, 1.0f, 0.0f, 1.0f), CreateWeldVertex(1.0f, 0.0f, 0.0f, 1.0f, 0.0f),
+		CreateWeldVertex(1.0f, 0.0f, 0.0f, 1.0f, 0.0f), CreateWeldVertex(0.0f, 0.0f, 1.0f, 0.0f, 1.0f), CreateWeldVertex(1.0f, 0.0f, 1.0f, 1.0f, 1.0f) };
+	const std::vector<uint32_t> originalIndices = { 0, 1, 2, 3, 4, 5 };
+	std::vector<WeldVertex> vertices = originalVertices;
+	std::vector<uint32_t> indices = originalIndices;
+
+	REQUIRE(Weld(vertices, indices, 0.0f) == 4);
+	// Unique vertices are compacted in order of first occurrence
+	CHECK((indices == std::vector<uint32_t>{ 0, 1, 2, 2, 1, 3 }));
+	CHECK(memcmp(&vertices[3], &originalVertices[5], sizeof(WeldVertex)) == 0);
+	vertices.resize(4);
+	CHECK(CornersKept(originalVertices, originalIndices, vertices, indices, 0.0f));
+}
+
+TEST_CASE(MeshOptimizer_WeldMergesWithinEpsilon)
+{
+	// Second vertex differs by a fraction of epsilon in position, normal and UV - both land in the same epsilon cell
+	const float epsilon = 1e-3f;
+	std::vector<WeldVertex> originalVertices = { CreateWeldVertex(1.0f, 2.0f, 3.0f, 0.25f, 0.5f), CreateWeldVertex(1.0f + 2e-4f, 2.0f, 3.0f - 2e-4f, 0.25f + 1e-4f, 0.5f), CreateWeldVertex(4.0f, 0.0f, 0.0f, 1.0f, 0.0f) };
+	originalVertices[1].normal[0] = 1e-4f;
+	const std::vector<uint32_t> originalIndices = { 0, 2, 1, 1, 2, 0 };
+	std::vector<WeldVertex> vertices = originalVertices;
+	std::vector<uint32_t> indices = originalIndices;
+
+	REQUIRE(Weld(vertices, indices, epsilon) == 2);
+	CHECK((indices == std::vector<uint32_t>{ 0, 1, 0, 0, 1, 0 }));
+	vertices.resize(2);
+	CHECK(CornersKept(originalVertices, originalIndices, vertices, indices, epsilon));
+}
+
+TEST_CASE(MeshOptimizer_WeldKeepsDifferentAttributesSplit)
+{
+	// Same position as the first vertex, but every other vertex differs in one rendering attribute by more than epsilon
+	const float epsilon = 1e-3f;
+	const WeldVertex base = CreateWeldVertex(1.0f, 2.0f, 3.0f, 0.25f, 0.5f);
+	std::vector<WeldVertex> originalVertices(6, base);
+	originalVertices[1].uv[0] += 10.0f * epsilon;
+	originalVertices[2].normal[1] = -1.0f;
+	originalVertices[3].tangent[2] = 10.0f * epsilon;
+	originalVertices[4].binormal[0] = 10.0f * epsilon;
+	originalVertices[5].material = 8;
+	std::vector<uint32_t> originalIndices;
+	for (uint32_t i = 0; i + 2 < originalVertices.size(); ++i)
+	{
+		originalIndices.insert(originalIndices.end(), { i, i + 1, i + 2 });
+	}
+
+	for (float weldEpsilon : { 0.0f, epsilon })
+	{
+		std::vector<WeldVertex> vertices = originalVertices;
+		std::vector<uint32_t> indices = originalIndices;
+		CHECK(Weld(vertices, indices, weldEpsilon) == originalVertices.size());
+		CHECK(indices == originalIndices);
+		CHECK(CornersKept(originalVertices, originalIndices, vertices, indices, 0.0f));
+	}
+
+	// Without epsilon even one ulp keeps vertices apart
+	std::vector<WeldVertex> vertices = { base, base };
+	vertices[1].uv[1] = std::nextafter(base.uv[1], 1.0f);
+	std::vector<uint32_t> indices = { 0, 1, 0 };
+	CHECK(Weld(vertices, indices, 0.0f) == 2);
+}
+
+TEST_CASE(MeshOptimizer_WeldRewritesIndicesOfGrid)
+{
+	// Every triangle of the grid gets its own 3 vertices, welding has to restore shared grid vertices without changing any corner
+	const TestMesh grid = CreateGrid(24, true);
+	std::vector<WeldVertex> originalVertices;
+	std::vector<uint32_t> originalIndices;
+	for (uint32_t index : grid.indices)
+	{
+		const float* position = &grid.positions[index * 3];
+		originalIndices.push_back(static_cast<uint32_t>(originalVertices.size()));
+		originalVertices.push_back(CreateWeldVertex(position[0], position[1], position[2], position[0] / 24.0f, position[2] / 24.0f));
+	}
+	std::vector<WeldVertex> vertices = originalVertices;
+	std::vector<uint32_t> indices = originalIndices;
+
+	const size_t vertexCount = Weld(vertices, indices, 0.0f);
+	CHECK(vertexCount == grid.positions.size() / 3);
+	vertices.resize(vertexCount);
+	CHECK(CornersKept(originalVertices, originalIndices, vertices, indices, 0.0f));
+	for (uint32_t index : indices)
+	{
+		CHECK(index < vertexCount);
+	}
+}
@@ -0,0 +1,180 @@
+#include "TestFramework.h"
+#include "MeshSimplifier.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	struct TestMesh {
+		std::vector<float> positions;
+		std::vector<uint32_t> indices;
+		size_t GetVertexCount() const { return positions.size() / 3; }
+	};
+
+	// Grid of size x size quads in XY plane, displaced along Z by height function
+	template<typename Height>
+	TestMesh GenerateGrid(uint32_t size, Height height)
+	{
+		TestMesh mesh;
+		for (uint32_t y = 0; y <= size; ++y)
+		{
+			for (uint32_t x = 0; x <= size; ++x)
+			{
+				const float u = static_cast<float>(x) / size;
+				const float v = static_cast<float>(y) / size;
+				mesh.positions.insert(mesh.positions.end(), { u, v, height(u, v) });
+			}
+		}
+		for (uint32_t y = 0; y < size; ++y)
+		{
+			for (uint32_t x = 0; x < size; ++x)
+			{
+				const uint32_t corner = y * (size + 1) + x;
+				mesh.indices.insert(mesh.indices.end(), { corner, corner + 1, corner + size + 2, corner, corner + size + 2, corner + size + 1 });
+			}
+		}
+		return mesh;
+	}
+
+	float ComputeArea(const std::vector<float>& positions, const uint32_t* indices, size_t indexCount)
+	{
+		double area = 0.0;
+		for (size_t i = 0; i < indexCount; i += 3)
+		{
+			const float* a = &positions[indices[i + 0] * 3];
+			const float* b = &positions[indices[i + 1] * 3];
+			const float* c = &positions[indices[i + 2] * 3];
+			const double e0[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+			const double e1[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+			const double cross[3] = { e0[1] * e1[2] - e0[2] * e1[1], e0[2] * e1[0] - e0[0] * e1[2], e0[0] * e1[1] - e0[1] * e1[0] };
+			area += 0.5 * std::sqrt(cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2]);
+		}
+		return static_cast<float>(area);
+	}
+
+	// Z of triangle normal - positive for triangles of height field facing up, negative for folded ones
+	float ComputeNormalZ(const std::vector<float>& positions, const uint32_t* triangle)
+	{
+		const float* a = &positions[triangle[0] * 3];
+		const float* b = &positions[triangle[1] * 3];
+		const float* c = &positions[triangle[2] * 3];
+		return (b[0] - a[0]) * (c[1] - a[1]) - (b[1] - a[1]) * (c[0] - a[0]);
+	}
+}
+
+TEST_CASE(MeshSimplifier_ResultReferencesOriginalVertices)
+{
+	const TestMesh mesh = GenerateGrid(32, [](float u, float v) { return 0.1f * std::sin(6.0f * u) * std::cos(4.0f * v); });
+	std::vector<uint32_t> destination(mesh.indices.size());
+	float error = -1.0f;
+	const size_t indexCount = MeshSimplifier::Simplify(destination.data(), mesh.indices.data(), mesh.indices.size(), mesh.positions.data(), mesh.GetVertexCount(),
+		3 * sizeof(float), mesh.indices.size() / 4, 0.05f, &error);
+
+	REQUIRE(indexCount % 3 == 0);
+	CHECK(indexCount > 0);
+	CHECK(indexCount <= mesh.indices.size() / 4);
+	CHECK(error >= 0.0f && error <= 0.05f);
+	for (size_t i = 0; i < indexCount; i += 3)
+	{
+		CHECK(destination[i] < mesh.GetVertexCount() && destination[i + 1] < mesh.GetVertexCount() && destination[i + 2] < mesh.GetVertexCount());
+		// Collapsed triangles are removed, none may stay degenerate or fold over - slivers of collinear grid vertices have zero normal Z
+		CHECK(destination[i] != destination[i + 1] && destination[i + 1] != destination[i + 2] && destination[i] != destination[i + 2]);
+		CHECK(ComputeNormalZ(mesh.positions, &destination[i]) >= 0.0f);
+	}
+}
+
+TEST_CASE(MeshSimplifier_FlatGridKeepsAreaWithZeroError)
+{
+	// Interior vertices of plane and straight border vertices collapse without error, corners are kept
+	const TestMesh mesh = GenerateGrid(16, [](float, float) { return 0.0f; });
+	std::vector<uint32_t> destination(mesh.indices.size());
+	float error = -1.0f;
+	const size_t indexCount = MeshSimplifier::Simplify(destination.data(), mesh.indices.data(), mesh.indices.size(), mesh.positions.data(), mesh.GetVertexCount(),
+		3 * sizeof(float), 6, 1e-4f, &error);
+
+	CHECK(indexCount < mesh.indices.size() / 10);
+	CHECK(error <= 1e-4f);
+	CHECK_NEAR(ComputeArea(mesh.positions, destination.data(), indexCount), 1.0f, 1e-4f);
+}
+
+TEST_CASE(MeshSimplifier_ErrorLimitStopsSimplification)
+{
+	const TestMesh mesh = GenerateGrid(32, [](float u, float v) { return 0.2f * std::sin(12.0f * u) * std::sin(12.0f * v); });
+	std::vector<uint32_t> loose(mesh.indices.size());
+	std::vector<uint32_t> tight(mesh.indices.size());
+	const size_t looseCount = MeshSimplifier::Simplify(loose.data(), mesh.indices.data(), mesh.indices.size(), mesh.positions.data(), mesh.GetVertexCount(),
+		3 * sizeof(float), 0, 0.1f);
+	float tightError = -1.0f;
+	const size_t tightCount = MeshSimplifier::Simplify(tight.data(), mesh.indices.data(), mesh.indices.size(), mesh.positions.data(), mesh.GetVertexCount(),
+		3 * sizeof(float), 0, 1e-3f, &tightError);
+
+	// Curved surface can't reach zero triangles under tight limit, looser limit removes more
+	CHECK(tightCount > 0);
+	CHECK(tightError <= 1e-3f);
+	CHECK(looseCount < tightCount);
+}
+
+TEST_CASE(MeshSimplifier_TargetAboveIndexCountKeepsMesh)
+{
+	const TestMesh mesh = GenerateGrid(8, [](float u, float) { return u * u; });
+	std::vector<uint32_t> destination(mesh.indices.size());
+	float error = -1.0f;
+	const size_t indexCount = MeshSimplifier::Simplify(destination.data(), mesh.indices.data(), mesh.indices.size(), mesh.positions.data(), mesh.GetVertexCount(),
+		3 * sizeof(float), mesh.indices.size(), 1.0f, &error);
+
+	CHECK(indexCount == mesh.indices.size());
+	CHECK(error == 0.0f);
+	CHECK(std::equal(mesh.indices.begin(), mesh.indices.end(), destination.begin()));
+}
+
+TEST_CASE(MeshSimplifier_SeamStaysClosed)
+{
+	// Right half of grid has its own copies of vertices along x = 0.5, like UV seam - both sides have to collapse together
+	TestMesh mesh = GenerateGrid(16, [](float u, float v) { return 0.05f * std::sin(5.0f * u + 3.0f * v); });
+	const size_t originalVertexCount = mesh.GetVertexCount();
+	std::vector<uint32_t> seamCopies(originalVertexCount, 0xFFFFFFFF);
+	for (size_t v = 0; v < originalVertexCount; ++v)
+	{
+		if (mesh.positions[v * 3] == 0.5f)
+		{
+			seamCopies[v] = static_cast<uint32_t>(mesh.GetVertexCount());
+			mesh.positions.insert(mesh.positions.end(), { mesh.positions[v * 3], mesh.positions[v * 3 + 1], mesh.positions[v * 3 + 2] });
+		}
+	}
+	for (size_t i = 0; i < mesh.indices.size(); i += 3)
+	{
+		const float centroidX = (mesh.positions[mesh.indices[i] * 3] + mesh.positions[mesh.indices[i + 1] * 3] + mesh.positions[mesh.indices[i + 2] * 3]) / 3.0f;
+		for (size_t corner = 0; corner < 3 && centroidX > 0.5f; ++corner)
+		{
+			uint32_t& index = mesh.indices[i + corner];
+			index = seamCopies[index] != 0xFFFFFFFF ? seamCopies[index] : index;
+		}
+	}
+
+	std::vector<uint32_t> destination(mesh.indices.size());
+	const size_t indexCount = MeshSimplifier::Simplify(destination.data(), mesh.indices.data(), mesh.indices.size(), mesh.positions.data(), mesh.GetVertexCount(),
+		3 * sizeof(float), mesh.indices.size() / 4, 0.05f);
+	REQUIRE(indexCount > 0);
+
+	// Every seam edge used by left half has to be used by right half too, by position - otherwise mesh would crack along seam
+	std::vector<std::pair<float, float>> leftEdges, rightEdges;
+	for (size_t i = 0; i < indexCount; i += 3)
+	{
+		for (size_t corner = 0; corner < 3; ++corner)
+		{
+			const uint32_t a = destination[i + corner];
+			const uint32_t b = destination[i + (corner + 1) % 3];
+			if (mesh.positions[a * 3] != 0.5f || mesh.positions[b * 3] != 0.5f) {
+				continue;
+			}
+			const float ya = mesh.positions[a * 3 + 1];
+			const float yb = mesh.positions[b * 3 + 1];
+			(a >= originalVertexCount ? rightEdges : leftEdges).push_back({ std::min(ya, yb), std::max(ya, yb) });
+		}
+	}
+	std::sort(leftEdges.begin(), leftEdges.end());
+	std::sort(rightEdges.begin(), rightEdges.end());
+	CHECK(!leftEdges.empty());
+	CHECK(leftEdges == rightEdges);
+	CHECK(MeshSimplifier::CountNonManifoldEdges(destination.data(), indexCount, mesh.positions.data(), mesh.GetVertexCount(), 3 * sizeof(float)) == 0);
+}
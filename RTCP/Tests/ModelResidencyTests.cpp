@@ -0,0 +1,108 @@
+#include "TestFramework.h"
+#include "DeviceManager.h"
+#include "ModelClass.h"
+
+namespace
+{
+	// WARP device is enough for buffer creation, tests run on machines without D3D12 GPU
+	ComPtr<ID3D12Device5> GetTestDevice()
+	{
+		static ComPtr<ID3D12Device5> device = []() {
+			ComPtr<IDXGIFactory4> dxgiFactory;
+			ThrowIfFailed(CreateDXGIFactory2(0, IID_PPV_ARGS(&dxgiFactory)));
+			return DeviceManager::CreateDevice(dxgiFactory, true);
+		}();
+		return device;
+	}
+
+	SceneGenerator::Settings GetSceneSettings()
+	{
+		SceneGenerator::Settings settings;
+		settings.seed = 3;
+		settings.triangleCount = 20000;
+		settings.meshCount = 16;
+		settings.instanceCount = 24;
+		return settings;
+	}
+
+	std::unique_ptr<ModelClass> GenerateModel(CpuResidency residency)
+	{
+		ModelLoadSettings settings;
+		settings.cpuResidency = residency;
+		return std::make_unique<ModelClass>(GetSceneSettings(), GetTestDevice(), settings);
+	}
+}
+
+TEST_CASE(ModelResidency_FullKeepsEveryAttribute)
+{
+	const std::unique_ptr<ModelClass> model = GenerateModel(CpuResidency::Full);
+	const ModelClass::MemoryStatistics statistics = model->GetMemoryStatistics();
+
+	CHECK(model->GetCpuResidency() == CpuResidency::Full);
+	CHECK(model->GetVertices().size() == static_cast<size_t>(model->GetVerticesCount()));
+	CHECK(model->GetIndices().size() == static_cast<size_t>(model->GetIndicesCount()));
+	CHECK(model->GetPositions() == &model->GetVertices().data()->position);
+	CHECK(model->GetPositionStride() == sizeof(ModelClass::VertexBufferStruct));
+	CHECK(statistics.cpuVertices == sizeof(ModelClass::VertexBufferStruct) * model->GetVerticesCount());
+	CHECK(statistics.cpuPositions == 0);
+	CHECK(statistics.cpuIndices == sizeof(UINT32) * model->GetIndicesCount());
+	CHECK(statistics.gpuGeometry > 0);
+	CHECK(statistics.gpuMaterials > 0);
+}
+
+TEST_CASE(ModelResidency_PositionsAndIndicesMatchFullModel)
+{
+	const std::unique_ptr<ModelClass> full = GenerateModel(CpuResidency::Full);
+	const std::unique_ptr<ModelClass> reduced = GenerateModel(CpuResidency::PositionsAndIndices);
+	const ModelClass::MemoryStatistics fullStatistics = full->GetMemoryStatistics();
+	const ModelClass::MemoryStatistics statistics = reduced->GetMemoryStatistics();
+
+	REQUIRE(reduced->GetCpuResidency() == CpuResidency::PositionsAndIndices);
+	REQUIRE(reduced->GetVerticesCount() == full->GetVerticesCount());
+	CHECK(reduced->GetVertices().empty());
+	REQUIRE(reduced->GetPositions() != nullptr);
+	CHECK(reduced->GetPositionStride() == sizeof(XMFLOAT3));
+	bool positionsEqual = true;
+	for (int i = 0; i < full->GetVerticesCount(); ++i)
+	{
+		const XMFLOAT3& expected = full->GetVertices()[i].position;
+		const XMFLOAT3& position = reduced->GetPositions()[i];
+		positionsEqual = positionsEqual && position.x == expected.x && position.y == expected.y && position.z == expected.z;
+	}
+	CHECK(positionsEqual);
+	CHECK(std::equal(full->GetIndices().begin(), full->GetIndices().end(), reduced->GetIndices().begin(), reduced->GetIndices().end()));
+
+	// Only CPU copies shrink - GPU buffers are the same whatever stays on CPU
+	CHECK(statistics.cpuVertices == 0);
+	CHECK(statistics.cpuPositions == sizeof(XMFLOAT3) * full->GetVerticesCount());
+	CHECK(statistics.cpuIndices == fullStatistics.cpuIndices);
+	CHECK(statistics.gpuGeometry == fullStatistics.gpuGeometry);
+	CHECK(statistics.gpuMaterials == fullStatistics.gpuMaterials);
+}
+
+TEST_CASE(ModelResidency_NoneKeepsOnlyCountsAndRanges)
+{
+	const std::unique_ptr<ModelClass> full = GenerateModel(CpuResidency::Full);
+	const std::unique_ptr<ModelClass> released = GenerateModel(CpuResidency::None);
+	const ModelClass::MemoryStatistics fullStatistics = full->GetMemoryStatistics();
+	const ModelClass::MemoryStatistics statistics = released->GetMemoryStatistics();
+
+	CHECK(released->GetCpuResidency() == CpuResidency::None);
+	CHECK(released->GetVertices().empty());
+	CHECK(released->GetIndices().empty());
+	CHECK(released->GetPositions() == nullptr);
+	CHECK(statistics.cpuVertices == 0);
+	CHECK(statistics.cpuPositions == 0);
+	CHECK(statistics.cpuIndices == 0);
+
+	// Counts, ranges and instances still describe GPU buffers
+	CHECK(released->GetVerticesCount() == full->GetVerticesCount());
+	CHECK(released->GetIndicesCount() == full->GetIndicesCount());
+	CHECK(released->GetMeshRanges().size() == full->GetMeshRanges().size());
+	CHECK(released->GetMeshInstances().size() == full->GetMeshInstances().size());
+	CHECK(statistics.gpuGeometry == fullStatistics.gpuGeometry);
+	for (size_t i = 0; i < released->GetMeshCount(); ++i)
+	{
+		CHECK(released->GetMeshLodCount(i) == 1);
+	}
+}
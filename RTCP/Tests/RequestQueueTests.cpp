@@ -0,0 +1,110 @@
+#include "TestFramework.h"
+#include "RequestQueue.h"
+#include <random>
+
+namespace
+{
+	std::vector<RequestQueue::RequestID> PopAll(RequestQueue& queue)
+	{
+		std::vector<RequestQueue::RequestID> order;
+		RequestQueue::RequestID id;
+		while (queue.Pop(id))
+		{
+			order.push_back(id);
+		}
+		return order;
+	}
+}
+
+TEST_CASE(RequestQueue_PopsHighestPriorityFirst)
+{
+	RequestQueue queue;
+	RequestQueue::RequestID id;
+	CHECK(queue.IsEmpty());
+	CHECK(!queue.Pop(id));
+
+	const float priorities[] = { 3.0f, 1.0f, 5.0f, 2.0f, 4.0f, 0.0f };
+	for (RequestQueue::RequestID i = 0; i < 6; ++i)
+	{
+		queue.Push(i, priorities[i]);
+	}
+	CHECK(queue.GetSize() == 6);
+	CHECK(PopAll(queue) == std::vector<RequestQueue::RequestID>({ 2, 4, 0, 3, 1, 5 }));
+	CHECK(queue.IsEmpty());
+}
+
+TEST_CASE(RequestQueue_EqualPrioritiesKeepRequestOrder)
+{
+	// Pushed in order reads finished, popped in order of requests
+	RequestQueue queue;
+	for (const RequestQueue::RequestID id : { 4u, 1u, 5u, 0u, 3u, 2u })
+	{
+		queue.Push(id, 1.0f);
+	}
+	CHECK(PopAll(queue) == std::vector<RequestQueue::RequestID>({ 0, 1, 2, 3, 4, 5 }));
+}
+
+TEST_CASE(RequestQueue_UpdatePriorityReorders)
+{
+	RequestQueue queue;
+	for (RequestQueue::RequestID i = 0; i < 4; ++i)
+	{
+		queue.Push(i, static_cast<float>(i));
+	}
+	CHECK(queue.UpdatePriority(0, 10.0f));
+	CHECK(queue.UpdatePriority(3, -1.0f));
+	// Same priority doesn't add heap entry
+	CHECK(queue.UpdatePriority(1, 1.0f));
+	CHECK(queue.GetEntryCount() == 6);
+	CHECK(!queue.UpdatePriority(7, 1.0f));
+
+	// Stale entries are skipped - every request is popped once, with its last priority
+	CHECK(queue.GetSize() == 4);
+	CHECK(PopAll(queue) == std::vector<RequestQueue::RequestID>({ 0, 2, 1, 3 }));
+	CHECK(queue.GetEntryCount() == 0);
+}
+
+TEST_CASE(RequestQueue_PoppedRequestIsNotUpdated)
+{
+	RequestQueue queue;
+	queue.Push(0, 1.0f);
+	RequestQueue::RequestID id;
+	REQUIRE(queue.Pop(id));
+	CHECK(!queue.UpdatePriority(0, 2.0f));
+	CHECK(!queue.Pop(id));
+
+	// Popped request may be queued again
+	queue.Push(0, 3.0f);
+	CHECK(PopAll(queue) == std::vector<RequestQueue::RequestID>({ 0 }));
+}
+
+TEST_CASE(RequestQueue_StaleEntriesDontAccumulate)
+{
+	// Every request reprioritized many times, as by camera movement each frame
+	constexpr RequestQueue::RequestID REQUEST_COUNT = 100;
+	RequestQueue queue;
+	std::mt19937 random(7);
+	std::uniform_real_distribution<float> distribution(0.0f, 1000.0f);
+	std::vector<float> priorities(REQUEST_COUNT);
+	for (RequestQueue::RequestID i = 0; i < REQUEST_COUNT; ++i)
+	{
+		priorities[i] = distribution(random);
+		queue.Push(i, priorities[i]);
+	}
+	for (int frame = 0; frame < 50; ++frame)
+	{
+		for (RequestQueue::RequestID i = 0; i < REQUEST_COUNT; ++i)
+		{
+			priorities[i] = distribution(random);
+			CHECK(queue.UpdatePriority(i, priorities[i]));
+		}
+		CHECK(queue.GetEntryCount() <= 2 * REQUEST_COUNT + 1);
+	}
+
+	const std::vector<RequestQueue::RequestID> order = PopAll(queue);
+	REQUIRE(order.size() == REQUEST_COUNT);
+	for (size_t i = 1; i < order.size(); ++i)
+	{
+		CHECK(priorities[order[i - 1]] >= priorities[order[i]]);
+	}
+}
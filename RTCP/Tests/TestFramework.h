@@ -0,0 +1,53 @@
+#pragma once
+#ifndef _TEST_FRAMEWORK_H_
+#define _TEST_FRAMEWORK_H_
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+// Minimal test registry for rtcp-tests - TEST_CASE registers function during static initialization, TestMain.cpp runs them.
+// Doesn't depend on Windows or D3D12 headers, so tests of portable modules build with any compiler.
+struct TestCase {
+	const char* name;
+	void (*function)();
+};
+
+inline std::vector<TestCase>& GetTestCases()
+{
+	static std::vector<TestCase> testCases;
+	return testCases;
+}
+
+// Failures of currently running test - CHECK keeps going, REQUIRE returns from test
+inline size_t& GetTestFailureCount()
+{
+	static size_t failureCount = 0;
+	return failureCount;
+}
+
+inline void ReportTestFailure(const char* file, int line, const char* expression)
+{
+	++GetTestFailureCount();
+	printf("  %s(%d): failed %s\n", file, line, expression);
+}
+
+struct TestRegistration {
+	TestRegistration(const char* name, void (*function)()) { GetTestCases().push_back({ name, function }); }
+};
+
+#define TEST_CASE(name) \
+	static void name(); \
+	static TestRegistration name##Registration(#name, name); \
+	static void name()
+
+#define CHECK(expression) \
+	do { if (!(expression)) { ReportTestFailure(__FILE__, __LINE__, #expression); } } while (0)
+
+#define REQUIRE(expression) \
+	do { if (!(expression)) { ReportTestFailure(__FILE__, __LINE__, #expression); return; } } while (0)
+
+#define CHECK_NEAR(a, b, tolerance) \
+	CHECK(std::fabs(static_cast<double>(a) - static_cast<double>(b)) <= static_cast<double>(tolerance))
+
+#endif // !_TEST_FRAMEWORK_H_
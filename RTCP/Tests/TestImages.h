@@ -0,0 +1,160 @@
+#pragma once
+#ifndef _TEST_IMAGES_H_
+#define _TEST_IMAGES_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Reference images for decoder and streamer tests - PNG is written with uncompressed (stored) deflate blocks,
+// so expected pixels are known exactly without zlib. Doesn't depend on Windows or D3D12 headers.
+namespace TestImages
+{
+	inline uint32_t Crc32(const uint8_t* data, size_t size)
+	{
+		static const std::vector<uint32_t> table = []() {
+			std::vector<uint32_t> entries(256);
+			for (uint32_t i = 0; i < 256; ++i)
+			{
+				uint32_t crc = i;
+				for (int bit = 0; bit < 8; ++bit)
+				{
+					crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+				}
+				entries[i] = crc;
+			}
+			return entries;
+		}();
+
+		uint32_t crc = 0xFFFFFFFF;
+		for (size_t i = 0; i < size; ++i)
+		{
+			crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+		}
+		return ~crc;
+	}
+
+	// Modulo is deferred for 5552 bytes, the most that can't overflow 32 bits
+	inline uint32_t Adler32(const uint8_t* data, size_t size)
+	{
+		uint32_t s1 = 1;
+		uint32_t s2 = 0;
+		while (size > 0)
+		{
+			const size_t blockSize = std::min<size_t>(size, 5552);
+			for (size_t i = 0; i < blockSize; ++i)
+			{
+				s1 += data[i];
+				s2 += s1;
+			}
+			s1 %= 65521;
+			s2 %= 65521;
+			data += blockSize;
+			size -= blockSize;
+		}
+		return (s2 << 16) | s1;
+	}
+
+	inline void AppendBigEndian(std::vector<uint8_t>& data, uint32_t value)
+	{
+		data.insert(data.end(), { static_cast<uint8_t>(value >> 24), static_cast<uint8_t>(value >> 16), static_cast<uint8_t>(value >> 8), static_cast<uint8_t>(value) });
+	}
+
+	inline void AppendChunk(std::vector<uint8_t>& png, const char* type, const std::vector<uint8_t>& content)
+	{
+		AppendBigEndian(png, static_cast<uint32_t>(content.size()));
+		const size_t typeOffset = png.size();
+		png.insert(png.end(), type, type + 4);
+		png.insert(png.end(), content.begin(), content.end());
+		AppendBigEndian(png, Crc32(png.data() + typeOffset, png.size() - typeOffset));
+	}
+
+	inline uint8_t Paeth(int a, int b, int c)
+	{
+		const int p = a + b - c;
+		const int pa = std::abs(p - a);
+		const int pb = std::abs(p - b);
+		const int pc = std::abs(p - c);
+		return static_cast<uint8_t>(pa <= pb && pa <= pc ? a : (pb <= pc ? b : c));
+	}
+
+	// Pixels are rows of samples as stored in PNG - 16 bit samples big endian. Row i uses filter type (i % filterCount) of filters, 0-4.
+	// channels: 1 gray, 2 gray + alpha, 3 RGB, 4 RGBA - srgb adds sRGB chunk
+	inline std::vector<uint8_t> EncodePng(uint32_t width, uint32_t height, uint32_t channels, uint32_t bitDepth, const uint8_t* pixels,
+		const std::vector<uint8_t>& filters = { 0 }, bool srgb = false)
+	{
+		static const uint8_t COLOR_TYPES[] = { 0, 0, 4, 2, 6 };
+		const size_t pixelSize = channels * bitDepth / 8;
+		const size_t rowSize = width * pixelSize;
+
+		// Filtered scanlines, each prefixed with its filter type
+		std::vector<uint8_t> scanlines((rowSize + 1) * height);
+		for (uint32_t y = 0; y < height; ++y)
+		{
+			const uint8_t filter = filters[y % filters.size()];
+			const uint8_t* row = pixels + y * rowSize;
+			const uint8_t* previous = y > 0 ? row - rowSize : nullptr;
+			uint8_t* scanline = &scanlines[y * (rowSize + 1)];
+			scanline[0] = filter;
+			for (size_t i = 0; i < rowSize; ++i)
+			{
+				const int a = i >= pixelSize ? row[i - pixelSize] : 0;
+				const int b = previous ? previous[i] : 0;
+				const int c = previous && i >= pixelSize ? previous[i - pixelSize] : 0;
+				const int prediction = filter == 1 ? a : filter == 2 ? b : filter == 3 ? (a + b) / 2 : filter == 4 ? Paeth(a, b, c) : 0;
+				scanline[i + 1] = static_cast<uint8_t>(row[i] - prediction);
+			}
+		}
+
+		// zlib stream of stored blocks
+		std::vector<uint8_t> zlib = { 0x78, 0x01 };
+		size_t offset = 0;
+		do {
+			const size_t blockSize = std::min<size_t>(scanlines.size() - offset, 0xFFFF);
+			const bool last = offset + blockSize == scanlines.size();
+			zlib.insert(zlib.end(), { static_cast<uint8_t>(last ? 1 : 0), static_cast<uint8_t>(blockSize), static_cast<uint8_t>(blockSize >> 8),
+				static_cast<uint8_t>(~blockSize), static_cast<uint8_t>(~blockSize >> 8) });
+			zlib.insert(zlib.end(), scanlines.begin() + offset, scanlines.begin() + offset + blockSize);
+			offset += blockSize;
+		} while (offset < scanlines.size());
+		AppendBigEndian(zlib, Adler32(scanlines.data(), scanlines.size()));
+
+		std::vector<uint8_t> png = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+		std::vector<uint8_t> header;
+		AppendBigEndian(header, width);
+		AppendBigEndian(header, height);
+		header.insert(header.end(), { static_cast<uint8_t>(bitDepth), COLOR_TYPES[channels], 0, 0, 0 });
+		AppendChunk(png, "IHDR", header);
+		if (srgb) {
+			AppendChunk(png, "sRGB", { 0 });
+		}
+		AppendChunk(png, "IDAT", zlib);
+		AppendChunk(png, "IEND", {});
+		return png;
+	}
+
+	// File in working directory, removed when test is done with it
+	class TemporaryFile
+	{
+	public:
+		TemporaryFile(const std::string& name, const std::vector<uint8_t>& data) : m_path("rtcp-tests-" + name)
+		{
+			std::ofstream file{ m_path, std::ofstream::out | std::ofstream::binary | std::ofstream::trunc };
+			file.write(reinterpret_cast<const char*>(data.data()), data.size());
+		}
+		~TemporaryFile() { remove(m_path.c_str()); }
+		TemporaryFile(const TemporaryFile&) = delete;
+		TemporaryFile& operator=(const TemporaryFile&) = delete;
+
+		const std::string& GetPath() const { return m_path; }
+
+	private:
+		std::string m_path;
+	};
+}
+
+#endif // !_TEST_IMAGES_H_
@@ -0,0 +1,27 @@
+#include "TestFramework.h"
+#include <cstring>
+
+// Runs every registered test, or only tests whose name contains first argument - exit code is number of failed tests
+int main(int argc, char** argv)
+{
+	const char* filter = argc > 1 ? argv[1] : nullptr;
+	size_t runCount = 0;
+	size_t failedCount = 0;
+	for (const TestCase& testCase : GetTestCases())
+	{
+		if (filter && strstr(testCase.name, filter) == nullptr) {
+			continue;
+		}
+
+		GetTestFailureCount() = 0;
+		testCase.function();
+		++runCount;
+		if (GetTestFailureCount() > 0) {
+			++failedCount;
+		}
+		printf("[%s] %s\n", GetTestFailureCount() > 0 ? "FAIL" : " OK ", testCase.name);
+	}
+
+	printf("%zu tests, %zu failed\n", runCount, failedCount);
+	return static_cast<int>(failedCount);
+}
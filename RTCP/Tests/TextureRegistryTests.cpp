@@ -0,0 +1,107 @@
+#include "TestFramework.h"
+#include "TestImages.h"
+#include "DeviceManager.h"
+#include "TextureRegistry.h"
+
+namespace
+{
+	// WARP device is enough for resource creation, tests run on machines without D3D12 GPU
+	ComPtr<ID3D12Device5> GetTestDevice()
+	{
+		static ComPtr<ID3D12Device5> device = []() {
+			ComPtr<IDXGIFactory4> dxgiFactory;
+			ThrowIfFailed(CreateDXGIFactory2(0, IID_PPV_ARGS(&dxgiFactory)));
+			return DeviceManager::CreateDevice(dxgiFactory, true);
+		}();
+		return device;
+	}
+
+	// Stands in for decoded texture - registry only needs a resource to share and its size
+	ComPtr<ID3D12Resource> CreateResource(size_t& loadCount)
+	{
+		++loadCount;
+		const CD3DX12_HEAP_PROPERTIES heapProperties(D3D12_HEAP_TYPE_DEFAULT);
+		const CD3DX12_RESOURCE_DESC desc = CD3DX12_RESOURCE_DESC::Buffer(64 * 1024);
+		ComPtr<ID3D12Resource> resource;
+		ThrowIfFailed(GetTestDevice()->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &desc, D3D12_RESOURCE_STATE_COMMON, nullptr, IID_PPV_ARGS(&resource)));
+		return resource;
+	}
+
+	// Registry is process-wide, tests compare statistics before and after
+	TextureRegistry::Statistics Difference(const TextureRegistry::Statistics& before)
+	{
+		TextureRegistry::Statistics after = TextureRegistry::Get().GetStatistics();
+		after.requests -= before.requests;
+		after.pathHits -= before.pathHits;
+		after.contentHits -= before.contentHits;
+		after.decodes -= before.decodes;
+		after.hashedFiles -= before.hashedFiles;
+		return after;
+	}
+}
+
+TEST_CASE(TextureRegistry_SharesSamePath)
+{
+	const TestImages::TemporaryFile file{ "registry-path.png", std::vector<uint8_t>(1021, 'a') };
+	const TextureRegistry::Statistics before = TextureRegistry::Get().GetStatistics();
+	size_t loadCount = 0;
+	const TextureRegistry::Handle first = TextureRegistry::Get().Acquire(file.GetPath(), [&]() { return CreateResource(loadCount); });
+	const TextureRegistry::Handle second = TextureRegistry::Get().Acquire(file.GetPath(), [&]() { return CreateResource(loadCount); });
+
+	CHECK(loadCount == 1);
+	CHECK(first.GetResource() == second.GetResource());
+	const TextureRegistry::Statistics statistics = Difference(before);
+	CHECK(statistics.pathHits == 1);
+	CHECK(statistics.hashedFiles == 0);
+}
+
+TEST_CASE(TextureRegistry_SharesSameContent)
+{
+	const TestImages::TemporaryFile file{ "registry-content.png", std::vector<uint8_t>(1022, 'b') };
+	const TestImages::TemporaryFile copy{ "registry-content-copy.png", std::vector<uint8_t>(1022, 'b') };
+	const TextureRegistry::Statistics before = TextureRegistry::Get().GetStatistics();
+	size_t loadCount = 0;
+	const TextureRegistry::Handle first = TextureRegistry::Get().Acquire(file.GetPath(), [&]() { return CreateResource(loadCount); });
+	const TextureRegistry::Handle second = TextureRegistry::Get().Acquire(copy.GetPath(), [&]() { return CreateResource(loadCount); });
+
+	CHECK(loadCount == 1);
+	CHECK(first.GetResource() == second.GetResource());
+	const TextureRegistry::Statistics statistics = Difference(before);
+	CHECK(statistics.contentHits == 1);
+	CHECK(statistics.hashedFiles == 2);
+}
+
+TEST_CASE(TextureRegistry_HashesOnlyFilesOfSameSize)
+{
+	// Different size - decoded without reading either file
+	const TestImages::TemporaryFile file{ "registry-small.png", std::vector<uint8_t>(1023, 'c') };
+	const TestImages::TemporaryFile larger{ "registry-large.png", std::vector<uint8_t>(1024, 'c') };
+	// Same size, different content - both files are hashed, neither is shared
+	const TestImages::TemporaryFile sameSize{ "registry-same-size.png", std::vector<uint8_t>(1023, 'd') };
+	const TextureRegistry::Statistics before = TextureRegistry::Get().GetStatistics();
+	size_t loadCount = 0;
+	const TextureRegistry::Handle first = TextureRegistry::Get().Acquire(file.GetPath(), [&]() { return CreateResource(loadCount); });
+	const TextureRegistry::Handle second = TextureRegistry::Get().Acquire(larger.GetPath(), [&]() { return CreateResource(loadCount); });
+	CHECK(loadCount == 2);
+	CHECK(Difference(before).hashedFiles == 0);
+
+	const TextureRegistry::Handle third = TextureRegistry::Get().Acquire(sameSize.GetPath(), [&]() { return CreateResource(loadCount); });
+	CHECK(loadCount == 3);
+	CHECK(first.GetResource() != third.GetResource());
+	const TextureRegistry::Statistics statistics = Difference(before);
+	CHECK(statistics.contentHits == 0);
+	CHECK(statistics.hashedFiles == 2);
+}
+
+TEST_CASE(TextureRegistry_ReleasesLastHandle)
+{
+	const TestImages::TemporaryFile file{ "registry-release.png", std::vector<uint8_t>(1025, 'e') };
+	size_t loadCount = 0;
+	{
+		const TextureRegistry::Handle handle = TextureRegistry::Get().Acquire(file.GetPath(), [&]() { return CreateResource(loadCount); });
+		CHECK(handle.IsValid());
+	}
+	// Released path is decoded again
+	const TextureRegistry::Handle handle = TextureRegistry::Get().Acquire(file.GetPath(), [&]() { return CreateResource(loadCount); });
+	CHECK(loadCount == 2);
+}
@@ -0,0 +1,155 @@
+#include "TestFramework.h"
+#include "TestImages.h"
+#include "TextureStreamer.h"
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+namespace
+{
+	std::vector<uint8_t> GenerateRgba(uint32_t width, uint32_t height, uint32_t seed)
+	{
+		std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * 4);
+		for (size_t i = 0; i < pixels.size(); ++i)
+		{
+			pixels[i] = static_cast<uint8_t>(i * 7 + i / 4099 + seed * 31);
+		}
+		return pixels;
+	}
+
+	bool MatchesPixels(const DirectX::ScratchImage& image, const std::vector<uint8_t>& pixels, uint32_t width, uint32_t height)
+	{
+		const DirectX::Image* level = image.GetImage(0, 0, 0);
+		if (level == nullptr || level->width != width || level->height != height || level->format != DXGI_FORMAT_R8G8B8A8_UNORM) {
+			return false;
+		}
+		for (uint32_t y = 0; y < height; ++y)
+		{
+			if (memcmp(level->pixels + y * level->rowPitch, pixels.data() + y * width * 4, width * 4) != 0) {
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+TEST_CASE(TextureStreamer_DeliversEveryRequestOnce)
+{
+	std::vector<std::vector<uint8_t>> images;
+	std::vector<std::unique_ptr<TestImages::TemporaryFile>> files;
+	for (uint32_t i = 0; i < 8; ++i)
+	{
+		images.push_back(GenerateRgba(16 + i, 8, i));
+		const std::vector<uint8_t> png = TestImages::EncodePng(16 + i, 8, 4, 8, images.back().data(), { static_cast<uint8_t>(i % 5) });
+		files.emplace_back(new TestImages::TemporaryFile("streamer-" + std::to_string(i) + ".png", png));
+	}
+
+	TextureStreamer streamer(2);
+	std::vector<TextureStreamer::RequestID> ids;
+	for (const std::unique_ptr<TestImages::TemporaryFile>& file : files)
+	{
+		ids.push_back(streamer.Enqueue({ file->GetPath(), 1.0f, false }));
+	}
+	// Unreadable file still completes, without image
+	const TextureStreamer::RequestID missingID = streamer.Enqueue({ "rtcp-tests-missing.png", 1.0f, false });
+
+	std::vector<size_t> deliveries(files.size(), 0);
+	size_t missingDeliveries = 0;
+	TextureStreamer::Completion completion;
+	while (streamer.WaitCompletion(completion))
+	{
+		if (completion.id == missingID)
+		{
+			CHECK(completion.image == nullptr);
+			++missingDeliveries;
+			continue;
+		}
+		const size_t index = std::find(ids.begin(), ids.end(), completion.id) - ids.begin();
+		REQUIRE(index < files.size());
+		++deliveries[index];
+		CHECK(completion.path == files[index]->GetPath());
+		REQUIRE(completion.image != nullptr);
+		CHECK(MatchesPixels(*completion.image, images[index], 16 + static_cast<uint32_t>(index), 8));
+	}
+
+	CHECK(missingDeliveries == 1);
+	CHECK(std::all_of(deliveries.begin(), deliveries.end(), [](size_t count) { return count == 1; }));
+	CHECK(streamer.GetOutstandingCount() == 0);
+	CHECK(!streamer.TryPopCompletion(completion));
+}
+
+TEST_CASE(TextureStreamer_DecodesHighestPriorityFirst)
+{
+	// Single worker is kept busy by large image - small requests are read meanwhile and wait in priority queue.
+	// Stored PNG of 2048x2048 takes around 100 ms to decode in release build, reads of small files take well under a millisecond.
+	const std::vector<uint8_t> blockerPixels = GenerateRgba(2048, 2048, 0);
+	TestImages::TemporaryFile blockerFile("streamer-blocker.png", TestImages::EncodePng(2048, 2048, 4, 8, blockerPixels.data(), { 4 }));
+	const std::vector<uint8_t> smallPixels = GenerateRgba(4, 4, 1);
+	const std::vector<uint8_t> smallPng = TestImages::EncodePng(4, 4, 4, 8, smallPixels.data());
+	const float priorities[] = { 3.0f, 1.0f, 5.0f, 2.0f, 4.0f, 0.0f };
+	std::vector<std::unique_ptr<TestImages::TemporaryFile>> files;
+	for (size_t i = 0; i < 6; ++i)
+	{
+		files.emplace_back(new TestImages::TemporaryFile("streamer-priority-" + std::to_string(i) + ".png", smallPng));
+	}
+
+	TextureStreamer streamer(1);
+	const TextureStreamer::RequestID blockerID = streamer.Enqueue({ blockerFile.GetPath(), 0.0f, false });
+	// Blocker has to be read and picked up by the worker before anything else is queued
+	std::this_thread::sleep_for(std::chrono::milliseconds(30));
+
+	std::vector<std::pair<TextureStreamer::RequestID, float>> requests;
+	for (size_t i = 0; i < files.size(); ++i)
+	{
+		requests.push_back({ streamer.Enqueue({ files[i]->GetPath(), priorities[i], false }), priorities[i] });
+	}
+	// Waiting request moves to the front once reprioritized
+	streamer.UpdatePriority(requests.back().first, 10.0f);
+	requests.back().second = 10.0f;
+
+	std::vector<TextureStreamer::RequestID> order;
+	TextureStreamer::Completion completion;
+	while (streamer.WaitCompletion(completion))
+	{
+		order.push_back(completion.id);
+	}
+
+	REQUIRE(order.size() == requests.size() + 1);
+	CHECK(order[0] == blockerID);
+	std::sort(requests.begin(), requests.end(), [](const std::pair<TextureStreamer::RequestID, float>& a, const std::pair<TextureStreamer::RequestID, float>& b) { return a.second > b.second; });
+	for (size_t i = 0; i < requests.size(); ++i)
+	{
+		CHECK(order[i + 1] == requests[i].first);
+	}
+}
+
+TEST_CASE(TextureStreamer_EqualPrioritiesKeepRequestOrder)
+{
+	const std::vector<uint8_t> blockerPixels = GenerateRgba(2048, 2048, 0);
+	TestImages::TemporaryFile blockerFile("streamer-fifo-blocker.png", TestImages::EncodePng(2048, 2048, 4, 8, blockerPixels.data(), { 4 }));
+	const std::vector<uint8_t> smallPixels = GenerateRgba(4, 4, 1);
+	std::vector<std::unique_ptr<TestImages::TemporaryFile>> files;
+	for (size_t i = 0; i < 6; ++i)
+	{
+		files.emplace_back(new TestImages::TemporaryFile("streamer-fifo-" + std::to_string(i) + ".png", TestImages::EncodePng(4, 4, 4, 8, smallPixels.data())));
+	}
+
+	TextureStreamer streamer(1);
+	const TextureStreamer::RequestID blockerID = streamer.Enqueue({ blockerFile.GetPath(), 1.0f, false });
+	std::this_thread::sleep_for(std::chrono::milliseconds(30));
+	std::vector<TextureStreamer::RequestID> ids;
+	for (const std::unique_ptr<TestImages::TemporaryFile>& file : files)
+	{
+		ids.push_back(streamer.Enqueue({ file->GetPath(), 1.0f, false }));
+	}
+
+	std::vector<TextureStreamer::RequestID> order;
+	TextureStreamer::Completion completion;
+	while (streamer.WaitCompletion(completion))
+	{
+		order.push_back(completion.id);
+	}
+	REQUIRE(order.size() == ids.size() + 1);
+	CHECK(order[0] == blockerID);
+	CHECK(std::equal(ids.begin(), ids.end(), order.begin() + 1));
+}
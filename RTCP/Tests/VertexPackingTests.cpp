@@ -0,0 +1,120 @@
+#include "TestFramework.h"
+#include "VertexPacking.h"
+#include <random>
+
+namespace
+{
+	// Orthonormal tangent frames with both bitangent signs, positions and UVs inside [-10, 10] box
+	std::vector<ModelClass::VertexBufferStruct> GenerateVertices(size_t count)
+	{
+		std::mt19937 random(7);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		std::vector<ModelClass::VertexBufferStruct> vertices(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			ModelClass::VertexBufferStruct& vertex = vertices[i];
+			XMVECTOR normal;
+			do {
+				normal = XMVectorSet(unit(random), unit(random), unit(random), 0.0f);
+			} while (XMVectorGetX(XMVector3LengthSq(normal)) < 0.01f);
+			normal = XMVector3Normalize(normal);
+			const XMVECTOR helper = std::fabs(XMVectorGetX(normal)) < 0.9f ? XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f) : XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+			const XMVECTOR tangent = XMVector3Normalize(XMVector3Cross(helper, normal));
+			const XMVECTOR binormal = XMVector3Cross(normal, tangent);
+
+			XMStoreFloat3(&vertex.position, XMVectorScale(XMVectorSet(unit(random), unit(random), unit(random), 0.0f), 10.0f));
+			XMStoreFloat3(&vertex.normal, normal);
+			XMStoreFloat3(&vertex.tangent, tangent);
+			XMStoreFloat3(&vertex.binormal, i % 2 == 0 ? binormal : XMVectorNegate(binormal));
+			vertex.uv = XMFLOAT2(unit(random) * 0.5f + 0.5f, unit(random) * 0.5f + 0.5f);
+		}
+		return vertices;
+	}
+
+	BoundingBox GetBounds(const std::vector<ModelClass::VertexBufferStruct>& vertices)
+	{
+		BoundingBox bounds;
+		BoundingBox::CreateFromPoints(bounds, vertices.size(), &vertices.data()->position, sizeof(ModelClass::VertexBufferStruct));
+		return bounds;
+	}
+}
+
+TEST_CASE(VertexPacking_OctahedralRoundTripOfAxes)
+{
+	const XMVECTOR axes[] = {
+		XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f), XMVectorSet(-1.0f, 0.0f, 0.0f, 0.0f),
+		XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f), XMVectorSet(0.0f, -1.0f, 0.0f, 0.0f),
+		XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f), XMVectorSet(0.0f, 0.0f, -1.0f, 0.0f)
+	};
+	for (const XMVECTOR& axis : axes)
+	{
+		const XMVECTOR decoded = VertexPacking::DecodeOctahedral(VertexPacking::EncodeOctahedral(axis));
+		CHECK_NEAR(XMVectorGetX(XMVector3Dot(axis, decoded)), 1.0f, 1e-6f);
+	}
+}
+
+TEST_CASE(VertexPacking_PackedRoundTripError)
+{
+	const std::vector<ModelClass::VertexBufferStruct> vertices = GenerateVertices(4096);
+	const VertexPacking::RoundTripError error = VertexPacking::MeasureRoundTripError(vertices.data(), vertices.size(), VertexFormat::Packed, GetBounds(vertices));
+
+	// Position is stored as float, snorm16 octahedral vectors are within hundredths of degree, tangent loses lowest bit to bitangent sign
+	CHECK(error.position == 0.0f);
+	CHECK(error.normal < 0.02f);
+	CHECK(error.tangent < 0.04f);
+	CHECK(error.binormal < 0.06f);
+	CHECK(error.uv <= 1.0f / 2048.0f);
+	CHECK(error.degenerateVertices == 0);
+}
+
+TEST_CASE(VertexPacking_BitangentSignSurvivesPacking)
+{
+	const std::vector<ModelClass::VertexBufferStruct> vertices = GenerateVertices(64);
+	std::vector<PackedVertex> packed(vertices.size());
+	std::vector<ModelClass::VertexBufferStruct> decoded(vertices.size());
+	VertexPacking::Encode(vertices.data(), vertices.size(), packed.data());
+	VertexPacking::Decode(packed.data(), packed.size(), decoded.data());
+
+	for (size_t i = 0; i < vertices.size(); ++i)
+	{
+		const float sign = XMVectorGetX(XMVector3Dot(XMLoadFloat3(&vertices[i].binormal), XMLoadFloat3(&decoded[i].binormal)));
+		CHECK(sign > 0.99f);
+	}
+}
+
+TEST_CASE(VertexPacking_QuantizedPositionsStayWithinStep)
+{
+	const std::vector<ModelClass::VertexBufferStruct> vertices = GenerateVertices(4096);
+	const BoundingBox bounds = GetBounds(vertices);
+	const VertexPacking::RoundTripError error = VertexPacking::MeasureRoundTripError(vertices.data(), vertices.size(), VertexFormat::PackedQuantizedPosition, bounds);
+
+	// Single snorm16 step along every axis
+	const XMVECTOR step = XMVectorScale(XMLoadFloat3(&bounds.Extents), 1.0f / 32767.0f);
+	CHECK(error.position <= XMVectorGetX(XMVector3Length(step)));
+}
+
+TEST_CASE(VertexPacking_DequantizeTransformMatchesDecode)
+{
+	const std::vector<ModelClass::VertexBufferStruct> vertices = GenerateVertices(256);
+	const BoundingBox bounds = GetBounds(vertices);
+	std::vector<PackedVertexQuantized> packed(vertices.size());
+	std::vector<ModelClass::VertexBufferStruct> decoded(vertices.size());
+	VertexPacking::Encode(vertices.data(), vertices.size(), bounds, packed.data());
+	VertexPacking::Decode(packed.data(), packed.size(), bounds, decoded.data());
+
+	// BLAS applies the transform to snorm16 positions, result has to match what hit shaders decode
+	const std::array<float, 12> transform = VertexPacking::GetDequantizeTransform(bounds);
+	for (size_t i = 0; i < packed.size(); ++i)
+	{
+		XMFLOAT4 position;
+		XMStoreFloat4(&position, XMLoadShortN4(&packed[i].position));
+		const float transformed[3] = {
+			transform[0] * position.x + transform[1] * position.y + transform[2] * position.z + transform[3],
+			transform[4] * position.x + transform[5] * position.y + transform[6] * position.z + transform[7],
+			transform[8] * position.x + transform[9] * position.y + transform[10] * position.z + transform[11]
+		};
+		CHECK_NEAR(transformed[0], decoded[i].position.x, 1e-4f);
+		CHECK_NEAR(transformed[1], decoded[i].position.y, 1e-4f);
+		CHECK_NEAR(transformed[2], decoded[i].position.z, 1e-4f);
+	}
+}
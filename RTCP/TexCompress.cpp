@@ -0,0 +1,161 @@
+// TexCompress.cpp - rtcp-texcompress entry point, offline BCn compression of model textures outside of model loading
+
+#include "pch.h"
+#include "TextureCompressor.h"
+#include "ThreadPool.h"
+#include "assimp/Importer.hpp"
+#include "assimp/scene.h"
+#include <cstdio>
+#include <cstdlib>
+#include <set>
+
+namespace
+{
+	// Texture references of every material used by a mesh, in the slots ModelClass loads them into
+	bool AddModelJobs(const std::string& modelPath, std::vector<TextureCompressor::Job>& jobs)
+	{
+		Assimp::Importer importer;
+		const aiScene* scene = importer.ReadFile(modelPath, 0);
+		if (!scene)
+		{
+			fprintf(stderr, "rtcp-texcompress: can't import %s - %s\n", modelPath.c_str(), importer.GetErrorString());
+			return false;
+		}
+
+		const std::pair<aiTextureType, TextureCompressor::TextureSlot> slots[] = {
+			{ aiTextureType_DIFFUSE, TextureCompressor::TextureSlot::Albedo },
+			{ aiTextureType_SPECULAR, TextureCompressor::TextureSlot::Specular },
+			{ aiTextureType_NORMALS, TextureCompressor::TextureSlot::Normal }
+		};
+		std::set<unsigned int> materials;
+		for (unsigned int i = 0; i < scene->mNumMeshes; ++i)
+		{
+			materials.insert(scene->mMeshes[i]->mMaterialIndex);
+		}
+		for (const unsigned int materialIndex : materials)
+		{
+			const aiMaterial* material = scene->mMaterials[materialIndex];
+			for (const auto& slot : slots)
+			{
+				for (unsigned int i = 0; i < material->GetTextureCount(slot.first); ++i)
+				{
+					aiString path;
+					material->GetTexture(slot.first, i, &path);
+					// Textures embedded in model file ("*index") have no file to compress
+					if (path.length > 0 && path.C_Str()[0] != '*') {
+						jobs.push_back({ path.C_Str(), slot.second });
+					}
+				}
+			}
+		}
+		return true;
+	}
+
+	const char* GetFormatName(DXGI_FORMAT format)
+	{
+		switch (format)
+		{
+		case DXGI_FORMAT_BC1_UNORM: return "BC1_UNORM";
+		case DXGI_FORMAT_BC5_UNORM: return "BC5_UNORM";
+		case DXGI_FORMAT_BC7_UNORM: return "BC7_UNORM";
+		// Sizes not multiple of block size stay uncompressed
+		case DXGI_FORMAT_R8G8B8A8_UNORM: return "R8G8B8A8_UNORM";
+		default: return "UNKNOWN";
+		}
+	}
+
+	void PrintUsage()
+	{
+		fprintf(stderr,
+			"Usage: rtcp-texcompress [<model>...] [--albedo <texture>] [--specular <texture>] [--normal <texture>] [--threads <count>] [--force]\n"
+			"  Writes <texture>.rtcp.dds next to every source, which RTCP loads instead of the source while it's up to date.\n"
+			"  Texture paths referenced by models are relative to the working directory - like RTCP itself.\n"
+			"  <model>          compress albedo, specular and normal textures of every material used by model meshes\n"
+			"  --albedo         compress single texture as albedo - mips filtered in linear space, BC1 if opaque, BC7 otherwise\n"
+			"  --specular       compress single texture as roughness/metallic - BC7\n"
+			"  --normal         compress single texture as normal map - renormalized mips, BC5\n"
+			"  --threads        textures compressed in parallel, all hardware threads by default\n"
+			"  --force          compress textures with up to date output as well\n");
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	std::vector<TextureCompressor::Job> jobs;
+	unsigned int threadCount = 0;
+	bool force = false;
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string argument = argv[i];
+		if (argument == "--albedo" && i + 1 < argc) {
+			jobs.push_back({ argv[++i], TextureCompressor::TextureSlot::Albedo });
+		}
+		else if (argument == "--specular" && i + 1 < argc) {
+			jobs.push_back({ argv[++i], TextureCompressor::TextureSlot::Specular });
+		}
+		else if (argument == "--normal" && i + 1 < argc) {
+			jobs.push_back({ argv[++i], TextureCompressor::TextureSlot::Normal });
+		}
+		else if (argument == "--threads" && i + 1 < argc) {
+			threadCount = static_cast<unsigned int>(strtoul(argv[++i], nullptr, 10));
+		}
+		else if (argument == "--force") {
+			force = true;
+		}
+		else if (argument[0] != '-')
+		{
+			if (!AddModelJobs(argument, jobs)) {
+				return 1;
+			}
+		}
+		else
+		{
+			PrintUsage();
+			return 1;
+		}
+	}
+	if (jobs.empty())
+	{
+		PrintUsage();
+		return 1;
+	}
+	if (threadCount == 0) {
+		threadCount = ThreadPool::GetDefaultThreadCount();
+	}
+
+	// Workers initialize COM for WIC decoders themselves, total time includes thread pool start
+	const auto startTime = std::chrono::high_resolution_clock::now();
+	const std::vector<TextureCompressor::Result> results = TextureCompressor::CompressAll(jobs, threadCount, force);
+	const std::chrono::duration<double, std::milli> totalTime = std::chrono::high_resolution_clock::now() - startTime;
+	if (results.empty())
+	{
+		printf("Nothing to compress - %zu texture references up to date or repeated\n", jobs.size());
+		return 0;
+	}
+
+	size_t failedCount = 0;
+	UINT64 pixelCount = 0;
+	UINT64 uncompressedBytes = 0;
+	UINT64 compressedBytes = 0;
+	for (const TextureCompressor::Result& result : results)
+	{
+		if (!result.success)
+		{
+			printf("%-20s %s\n", "FAILED", result.sourcePath.c_str());
+			++failedCount;
+			continue;
+		}
+		printf("%-20s %5zux%-5zu %2zu mips %8.1f KB -> %8.1f KB %8.2f ms  %s\n", GetFormatName(result.format), result.width, result.height, result.mipLevels,
+			result.uncompressedBytes / 1024.0, result.compressedBytes / 1024.0, result.time, result.sourcePath.c_str());
+		pixelCount += static_cast<UINT64>(result.width) * result.height;
+		uncompressedBytes += result.uncompressedBytes;
+		compressedBytes += result.compressedBytes;
+	}
+
+	const size_t compressedCount = results.size() - failedCount;
+	printf("Compressed %zu textures (%zu failed, %zu up to date or repeated) on %u threads in %.2f ms - %.1f textures/s, %.1f MPixels/s\n", compressedCount, failedCount,
+		jobs.size() - results.size(), threadCount, totalTime.count(), compressedCount * 1000.0 / totalTime.count(), pixelCount / (totalTime.count() * 1000.0));
+	printf("Mip chains %.1f MB as RGBA8 -> %.1f MB compressed (ratio %.2f:1)\n", uncompressedBytes / (1024.0 * 1024.0), compressedBytes / (1024.0 * 1024.0),
+		compressedBytes > 0 ? static_cast<double>(uncompressedBytes) / compressedBytes : 0.0);
+	return failedCount > 0 ? 1 : 0;
+}
@@ -0,0 +1,204 @@
+#include "TextureCompressor.h"
+#include "ThreadPool.h"
+#include "TextureStreamer.h"
+#include <regex>
+
+TextureCompressor::Result TextureCompressor::Compress(const std::string& sourcePath, TextureSlot slot, const std::string& outputPath)
+{
+	const auto startTime = std::chrono::high_resolution_clock::now();
+	Result result{};
+	result.sourcePath = sourcePath;
+
+	DirectX::ScratchImage source;
+	if (FAILED(LoadSource(sourcePath, source))) {
+		return result;
+	}
+
+	// Full chain down to 1x1 - albedo is stored in sRGB, so it's averaged in linear space
+	DirectX::ScratchImage mipChain;
+	const DirectX::TEX_FILTER_FLAGS filter = slot == TextureSlot::Albedo ? DirectX::TEX_FILTER_SRGB : DirectX::TEX_FILTER_DEFAULT;
+	if (FAILED(DirectX::GenerateMipMaps(*source.GetImage(0, 0, 0), DirectX::TEX_FILTER_BOX | filter, 0, mipChain))) {
+		return result;
+	}
+
+	// Averaged normals get shorter, every texel of every mip is normalized again
+	if (slot == TextureSlot::Normal)
+	{
+		DirectX::ScratchImage renormalized;
+		if (FAILED(RenormalizeNormals(mipChain, renormalized))) {
+			return result;
+		}
+		mipChain = std::move(renormalized);
+	}
+
+	const DirectX::TexMetadata& metadata = mipChain.GetMetadata();
+	result.format = SelectFormat(mipChain, slot);
+	result.width = metadata.width;
+	result.height = metadata.height;
+	result.mipLevels = metadata.mipLevels;
+	result.uncompressedBytes = mipChain.GetPixelsSize();
+
+	DirectX::ScratchImage output;
+	if (DirectX::IsCompressed(result.format))
+	{
+		// Textures are compressed in parallel by CompressAll, so single texture is compressed on one thread
+		if (FAILED(DirectX::Compress(mipChain.GetImages(), mipChain.GetImageCount(), metadata, result.format, DirectX::TEX_COMPRESS_BC7_QUICK, DirectX::TEX_THRESHOLD_DEFAULT, output))) {
+			return result;
+		}
+	}
+	else {
+		output = std::move(mipChain);
+	}
+
+	// Written to temporary file first, so interrupted write never leaves up to date looking output
+	const std::string tempPath = outputPath + ".tmp";
+	if (FAILED(DirectX::SaveToDDSFile(output.GetImages(), output.GetImageCount(), output.GetMetadata(), DirectX::DDS_FLAGS_NONE, ToWide(tempPath).c_str())) ||
+		!MoveFileExA(tempPath.c_str(), outputPath.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+		return result;
+	}
+
+	result.compressedBytes = output.GetPixelsSize();
+	result.success = true;
+	const std::chrono::duration<double, std::milli> time = std::chrono::high_resolution_clock::now() - startTime;
+	result.time = time.count();
+	return result;
+}
+
+std::vector<TextureCompressor::Result> TextureCompressor::CompressAll(const std::vector<Job>& jobs, unsigned int threadCount, bool force)
+{
+	// Same file may be referenced by multiple slots - first job decides its format
+	std::vector<Job> pendingJobs;
+	std::vector<std::string> outputPaths;
+	for (const Job& job : jobs)
+	{
+		const std::string outputPath = GetCompressedPath(job.sourcePath);
+		if (std::find(outputPaths.begin(), outputPaths.end(), outputPath) != outputPaths.end() || (!force && IsUpToDate(job.sourcePath, outputPath))) {
+			continue;
+		}
+		pendingJobs.push_back(job);
+		outputPaths.push_back(outputPath);
+	}
+	if (pendingJobs.empty()) {
+		return {};
+	}
+
+	const auto startTime = std::chrono::high_resolution_clock::now();
+	std::vector<Result> results(pendingJobs.size());
+	{
+		ThreadPool threadPool{ threadCount };
+		threadCount = threadPool.GetThreadCount();
+		threadPool.ParallelFor(pendingJobs.size(), [&](size_t i) {
+			// WIC decoder is COM based
+			const HRESULT comResult = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+			results[i] = Compress(pendingJobs[i].sourcePath, pendingJobs[i].slot, outputPaths[i]);
+			if (SUCCEEDED(comResult)) {
+				CoUninitialize();
+			}
+		});
+	}
+	const std::chrono::duration<double, std::milli> totalTime = std::chrono::high_resolution_clock::now() - startTime;
+
+	size_t compressedCount = 0;
+	UINT64 pixelCount = 0;
+	UINT64 uncompressedBytes = 0;
+	UINT64 compressedBytes = 0;
+	for (size_t i = 0; i < results.size(); ++i)
+	{
+		if (!results[i].success)
+		{
+			LogDebugRTCP("TextureCompressor: failed to compress %s\n", pendingJobs[i].sourcePath.c_str());
+			continue;
+		}
+		++compressedCount;
+		pixelCount += static_cast<UINT64>(results[i].width) * results[i].height;
+		uncompressedBytes += results[i].uncompressedBytes;
+		compressedBytes += results[i].compressedBytes;
+	}
+
+	LogDebugRTCP("TextureCompressor: compressed %zu/%zu textures on %u threads in %.2f ms - %.1f textures/s, %.1f MPixels/s\n", compressedCount, pendingJobs.size(),
+		threadCount, totalTime.count(), compressedCount * 1000.0 / totalTime.count(), pixelCount / (totalTime.count() * 1000.0));
+	LogDebugRTCP("TextureCompressor: mip chains %.1f MB as RGBA8 -> %.1f MB compressed (ratio %.2f:1)\n", uncompressedBytes / (1024.0 * 1024.0),
+		compressedBytes / (1024.0 * 1024.0), compressedBytes > 0 ? static_cast<double>(uncompressedBytes) / compressedBytes : 0.0);
+	return results;
+}
+
+std::string TextureCompressor::GetCompressedPath(const std::string& sourcePath)
+{
+	const size_t extension = sourcePath.find_last_of('.');
+	const size_t separator = sourcePath.find_last_of("/\\");
+	const bool hasExtension = extension != std::string::npos && (separator == std::string::npos || extension > separator);
+	return (hasExtension ? sourcePath.substr(0, extension) : sourcePath) + ".rtcp.dds";
+}
+
+bool TextureCompressor::IsUpToDate(const std::string& sourcePath, const std::string& compressedPath)
+{
+	WIN32_FILE_ATTRIBUTE_DATA source;
+	WIN32_FILE_ATTRIBUTE_DATA compressed;
+	if (!GetFileAttributesExA(sourcePath.c_str(), GetFileExInfoStandard, &source) || !GetFileAttributesExA(compressedPath.c_str(), GetFileExInfoStandard, &compressed)) {
+		return false;
+	}
+	return CompareFileTime(&compressed.ftLastWriteTime, &source.ftLastWriteTime) >= 0;
+}
+
+HRESULT TextureCompressor::LoadSource(const std::string& path, DirectX::ScratchImage& image)
+{
+	// Sources are decoded to plain RGBA8, block compressed DDS sources are decompressed first
+	const std::string extension = path.size() >= 4 ? path.substr(path.size() - 4) : "";
+	const std::unique_ptr<DirectX::ScratchImage> loaded = TextureStreamer::Decode(path, _stricmp(extension.c_str(), ".dds") == 0);
+	if (!loaded) {
+		return E_FAIL;
+	}
+
+	const DirectX::TexMetadata& metadata = loaded->GetMetadata();
+	if (DirectX::IsCompressed(metadata.format)) {
+		return DirectX::Decompress(*loaded->GetImage(0, 0, 0), DXGI_FORMAT_R8G8B8A8_UNORM, image);
+	}
+	if (metadata.format != DXGI_FORMAT_R8G8B8A8_UNORM) {
+		return DirectX::Convert(*loaded->GetImage(0, 0, 0), DXGI_FORMAT_R8G8B8A8_UNORM, DirectX::TEX_FILTER_DEFAULT, DirectX::TEX_THRESHOLD_DEFAULT, image);
+	}
+	image = std::move(*loaded);
+	return S_OK;
+}
+
+HRESULT TextureCompressor::RenormalizeNormals(const DirectX::ScratchImage& mipChain, DirectX::ScratchImage& result)
+{
+	return DirectX::TransformImage(mipChain.GetImages(), mipChain.GetImageCount(), mipChain.GetMetadata(),
+		[](DirectX::XMVECTOR* outPixels, const DirectX::XMVECTOR* inPixels, size_t width, size_t)
+		{
+			using namespace DirectX;
+			const XMVECTOR two = XMVectorReplicate(2.0f);
+			const XMVECTOR half = XMVectorReplicate(0.5f);
+			for (size_t i = 0; i < width; ++i)
+			{
+				// [0, 1] -> [-1, 1], zero vector is left as flat normal
+				XMVECTOR normal = XMVectorSubtract(XMVectorMultiply(inPixels[i], two), g_XMOne);
+				normal = XMVector3Equal(XMVector3LengthSq(normal), XMVectorZero()) ? g_XMIdentityR2 : XMVector3Normalize(normal);
+				outPixels[i] = XMVectorSelect(inPixels[i], XMVectorMultiplyAdd(normal, half, half), g_XMSelect1110);
+			}
+		}, result);
+}
+
+DXGI_FORMAT TextureCompressor::SelectFormat(const DirectX::ScratchImage& mipChain, TextureSlot slot)
+{
+	const DirectX::TexMetadata& metadata = mipChain.GetMetadata();
+	if (metadata.width % BLOCK_SIZE != 0 || metadata.height % BLOCK_SIZE != 0) {
+		return DXGI_FORMAT_R8G8B8A8_UNORM;
+	}
+
+	// UNORM formats, as uncompressed sources were uploaded - shaders don't rely on hardware sRGB decoding
+	switch (slot)
+	{
+	case TextureSlot::Albedo:
+		return mipChain.IsAlphaAllOpaque() ? DXGI_FORMAT_BC1_UNORM : DXGI_FORMAT_BC7_UNORM;
+	case TextureSlot::Normal:
+		return DXGI_FORMAT_BC5_UNORM;
+	default:
+		return DXGI_FORMAT_BC7_UNORM;
+	}
+}
+
+std::wstring TextureCompressor::ToWide(const std::string& path)
+{
+	const std::string s = std::regex_replace(path, std::regex("\\\\"), "/");
+	return std::wstring(s.begin(), s.end());
+}
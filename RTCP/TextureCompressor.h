@@ -0,0 +1,59 @@
+#pragma once
+#ifndef _TEXTURE_COMPRESSOR_H_
+#define _TEXTURE_COMPRESSOR_H_
+
+#include "pch.h"
+#include <DirectXTex.h>
+#include <string>
+#include <vector>
+
+// Offline stage preparing scene textures for GPU - generates filtered mip chain, compresses it to BCn and writes DDS file
+// next to the source (*.rtcp.dds), which is loaded instead of the source when it's up to date.
+class TextureCompressor
+{
+public:
+	// Slot decides filtering and block format
+	enum class TextureSlot
+	{
+		Albedo,		// Mips filtered in linear space, BC1 if opaque, BC7 otherwise
+		Specular,	// Independent roughness/metallic channels, BC7
+		Normal		// Mips renormalized, BC5 - shaders reconstruct Z
+	};
+
+	struct Job {
+		std::string sourcePath;
+		TextureSlot slot;
+	};
+
+	struct Result {
+		std::string sourcePath;
+		bool success;
+		DXGI_FORMAT format;
+		size_t width;
+		size_t height;
+		size_t mipLevels;
+		UINT64 uncompressedBytes;	// RGBA8 mip chain
+		UINT64 compressedBytes;
+		double time;				// Milliseconds
+	};
+
+	static Result Compress(const std::string& sourcePath, TextureSlot slot, const std::string& outputPath);
+	// Compresses textures without up to date output (every texture if forced) on threadCount threads (0 uses all hardware threads) and logs throughput.
+	// Returns result of every compressed texture, textures skipped as up to date or repeated aren't included.
+	static std::vector<Result> CompressAll(const std::vector<Job>& jobs, unsigned int threadCount = 0, bool force = false);
+
+	static std::string GetCompressedPath(const std::string& sourcePath);
+	// Compressed file exists and was written after the source
+	static bool IsUpToDate(const std::string& sourcePath, const std::string& compressedPath);
+
+private:
+	// D3D12 requires top level of block compressed texture to be multiple of 4
+	static constexpr size_t BLOCK_SIZE = 4;
+
+	static HRESULT LoadSource(const std::string& path, DirectX::ScratchImage& image);
+	static HRESULT RenormalizeNormals(const DirectX::ScratchImage& mipChain, DirectX::ScratchImage& result);
+	static DXGI_FORMAT SelectFormat(const DirectX::ScratchImage& mipChain, TextureSlot slot);
+	static std::wstring ToWide(const std::string& path);
+};
+
+#endif // !_TEXTURE_COMPRESSOR_H_
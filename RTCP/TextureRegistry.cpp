@@ -0,0 +1,193 @@
+#include "TextureRegistry.h"
+#include "MeshCacheFormat.h"
+#include <cctype>
+
+TextureRegistry::Handle& TextureRegistry::Handle::operator=(Handle&& other) noexcept
+{
+	if (this != &other)
+	{
+		Reset();
+		m_entry = std::move(other.m_entry);
+	}
+	return *this;
+}
+
+void TextureRegistry::Handle::Reset()
+{
+	if (m_entry)
+	{
+		TextureRegistry::Get().Release(m_entry);
+		m_entry.reset();
+	}
+}
+
+TextureRegistry::TextureRegistry() :
+	m_contentIndex(MeshCacheFormat::HashFile)
+{
+}
+
+TextureRegistry& TextureRegistry::Get()
+{
+	static TextureRegistry registry;
+	return registry;
+}
+
+TextureRegistry::Handle TextureRegistry::Acquire(const std::string& path, const std::function<ComPtr<ID3D12Resource>()>& loader)
+{
+	const std::string key = NormalizePath(path);
+
+	// Path lookup - new entry is registered before loading, so concurrent requests of the same path wait instead of decoding again
+	std::shared_ptr<Entry> entry;
+	std::promise<void> promise;
+	bool isNew = false;
+	{
+		std::lock_guard<std::mutex> lock{ m_mutex };
+		++m_statistics.requests;
+		const auto it = m_entriesByPath.find(key);
+		if (it != m_entriesByPath.end())
+		{
+			entry = it->second;
+			++m_statistics.pathHits;
+		}
+		else
+		{
+			entry = std::make_shared<Entry>();
+			entry->path = key;
+			entry->ready = promise.get_future().share();
+			m_entriesByPath.emplace(key, entry);
+			isNew = true;
+		}
+		++entry->refCount;
+	}
+
+	if (!isNew)
+	{
+		try {
+			entry->ready.get();
+		}
+		catch (...) {
+			Release(entry);
+			throw;
+		}
+		std::lock_guard<std::mutex> lock{ m_mutex };
+		m_statistics.savedBytes += entry->sizeBytes;
+		return Handle{ entry };
+	}
+
+	try
+	{
+		// Content lookup - only textures of the same file size can share content, so in the common case no file is read before decoding.
+		// Hashing file is still much cheaper than decoding and uploading it.
+		UINT64 fileSize = 0;
+		std::shared_ptr<Entry> sameContent;
+		if (GetFileSize(key, fileSize))
+		{
+			{
+				std::lock_guard<std::mutex> lock{ m_mutex };
+				entry->fileSize = fileSize;
+			}
+			m_contentIndex.Insert(key, fileSize, entry, sameContent);
+		}
+
+		if (sameContent)
+		{
+			// Entry with the same content may still be loading, or its load may have failed - in that case texture is decoded below
+			try {
+				sameContent->ready.get();
+			}
+			catch (...) {
+				sameContent.reset();
+			}
+		}
+
+		if (sameContent && sameContent->resource)
+		{
+			std::lock_guard<std::mutex> lock{ m_mutex };
+			entry->resource = sameContent->resource;
+			entry->sizeBytes = sameContent->sizeBytes;
+			++m_statistics.contentHits;
+			m_statistics.savedBytes += entry->sizeBytes;
+		}
+		else
+		{
+			ComPtr<ID3D12Resource> resource = loader();
+			const UINT64 sizeBytes = GetResourceSize(resource.Get());
+			std::lock_guard<std::mutex> lock{ m_mutex };
+			entry->resource = resource;
+			entry->sizeBytes = sizeBytes;
+			entry->decoded = true;
+			++m_statistics.decodes;
+			m_statistics.decodedBytes += sizeBytes;
+		}
+		promise.set_value();
+	}
+	catch (...)
+	{
+		promise.set_exception(std::current_exception());
+		Release(entry);
+		throw;
+	}
+
+	return Handle{ entry };
+}
+
+TextureRegistry::Statistics TextureRegistry::GetStatistics() const
+{
+	std::lock_guard<std::mutex> lock{ m_mutex };
+	Statistics statistics = m_statistics;
+	statistics.hashedFiles = m_contentIndex.GetHashedFileCount();
+	statistics.textureCount = m_entriesByPath.size();
+	return statistics;
+}
+
+std::string TextureRegistry::NormalizePath(const std::string& path)
+{
+	// Absolute path with backslashes, lowercase since Windows paths are case insensitive
+	char fullPath[MAX_PATH];
+	const DWORD length = GetFullPathNameA(path.c_str(), MAX_PATH, fullPath, nullptr);
+	std::string result = length > 0 && length < MAX_PATH ? std::string(fullPath, length) : path;
+	for (char& c : result)
+	{
+		c = c == '/' ? '\\' : static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+	}
+	return result;
+}
+
+void TextureRegistry::Release(const std::shared_ptr<Entry>& entry)
+{
+	std::lock_guard<std::mutex> lock{ m_mutex };
+	assert(entry->refCount > 0 && "Texture released more times than acquired");
+	if (--entry->refCount > 0) {
+		return;
+	}
+
+	// Resource itself is released with the last ComPtr - entries sharing it by content keep it alive
+	const auto pathIt = m_entriesByPath.find(entry->path);
+	if (pathIt != m_entriesByPath.end() && pathIt->second == entry) {
+		m_entriesByPath.erase(pathIt);
+	}
+	m_contentIndex.Erase(entry->fileSize, entry);
+}
+
+bool TextureRegistry::GetFileSize(const std::string& path, UINT64& size)
+{
+	// Embedded textures and missing files have no size - they are never shared by content
+	WIN32_FILE_ATTRIBUTE_DATA data;
+	if (!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &data)) {
+		return false;
+	}
+	size = (static_cast<UINT64>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+	return true;
+}
+
+UINT64 TextureRegistry::GetResourceSize(ID3D12Resource* resource)
+{
+	if (!resource) {
+		return 0;
+	}
+
+	ComPtr<ID3D12Device> device;
+	ThrowIfFailed(resource->GetDevice(IID_PPV_ARGS(&device)));
+	const D3D12_RESOURCE_DESC desc = resource->GetDesc();
+	return device->GetResourceAllocationInfo(0, 1, &desc).SizeInBytes;
+}
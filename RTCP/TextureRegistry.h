@@ -0,0 +1,86 @@
+#pragma once
+#ifndef _TEXTURE_REGISTRY_H_
+#define _TEXTURE_REGISTRY_H_
+
+#include "pch.h"
+#include "ContentIndex.h"
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Process-wide registry of texture resources, shared by every ModelClass.
+// Textures are keyed by normalized path and by content hash, so file is decoded once no matter how many meshes, models or slots reference it.
+// Content is matched by ContentIndex - file is hashed only once another registered texture has its size.
+// Resource stays registered as long as any Handle to it exists.
+class TextureRegistry
+{
+private:
+	struct Entry {
+		std::string path;
+		UINT64 fileSize = 0;
+		ComPtr<ID3D12Resource> resource;
+		UINT64 sizeBytes = 0;
+		UINT32 refCount = 0;
+		bool decoded = false;			// Resource was decoded for this entry, not shared from entry with the same content
+		std::shared_future<void> ready;	// Set when resource is loaded - other threads requesting the same path wait for it
+	};
+
+public:
+	// Reference to registered texture, released when destroyed
+	class Handle
+	{
+	public:
+		Handle() = default;
+		~Handle() { Reset(); }
+		Handle(Handle&& other) noexcept : m_entry(std::move(other.m_entry)) {}
+		Handle& operator=(Handle&& other) noexcept;
+		Handle(const Handle&) = delete;
+		Handle& operator=(const Handle&) = delete;
+
+		ComPtr<ID3D12Resource> GetResource() const { return m_entry ? m_entry->resource : nullptr; }
+		bool IsValid() const { return m_entry != nullptr; }
+		void Reset();
+
+	private:
+		friend class TextureRegistry;
+		explicit Handle(std::shared_ptr<Entry> entry) : m_entry(std::move(entry)) {}
+
+		std::shared_ptr<Entry> m_entry;
+	};
+
+	struct Statistics {
+		UINT64 requests;
+		UINT64 pathHits;		// Path was already registered
+		UINT64 contentHits;		// Different path, but the same file content was already decoded
+		UINT64 hashedFiles;		// Files read for content hash, because registered texture had the same size
+		UINT64 decodes;
+		UINT64 decodedBytes;
+		UINT64 savedBytes;		// Size of resources which would be created again without registry
+		size_t textureCount;	// Currently registered paths
+	};
+
+	static TextureRegistry& Get();
+
+	// Returns handle to texture of given file - loader decodes and uploads it, it's called only if neither path nor content is registered yet.
+	// Exception thrown by loader is rethrown to every thread waiting for the same path.
+	Handle Acquire(const std::string& path, const std::function<ComPtr<ID3D12Resource>()>& loader);
+	Statistics GetStatistics() const;
+	static std::string NormalizePath(const std::string& path);
+
+private:
+	TextureRegistry();
+	void Release(const std::shared_ptr<Entry>& entry);
+	static bool GetFileSize(const std::string& path, UINT64& size);
+	static UINT64 GetResourceSize(ID3D12Resource* resource);
+
+private:
+	mutable std::mutex m_mutex;
+	std::unordered_map<std::string, std::shared_ptr<Entry>> m_entriesByPath;
+	ContentIndex<std::shared_ptr<Entry>> m_contentIndex;
+	Statistics m_statistics{};
+};
+
+#endif // !_TEXTURE_REGISTRY_H_
@@ -0,0 +1,400 @@
+#include "TextureStreamer.h"
+#include <algorithm>
+#include <regex>
+
+TextureStreamer::TextureStreamer(unsigned int workerCount) :
+	m_reader(GetReaderSettings())
+{
+	if (workerCount == 0) {
+		workerCount = std::max(std::thread::hardware_concurrency(), 1u);
+	}
+
+	m_workers.reserve(workerCount);
+	for (unsigned int i = 0; i < workerCount; ++i)
+	{
+		m_workers.emplace_back(&TextureStreamer::WorkerLoop, this);
+	}
+}
+
+TextureStreamer::~TextureStreamer()
+{
+	{
+		std::lock_guard<std::mutex> lock{ m_mutex };
+		m_stopping = true;
+	}
+	m_condition.notify_all();
+
+	for (std::thread& worker : m_workers)
+	{
+		worker.join();
+	}
+}
+
+TextureStreamer::RequestID TextureStreamer::Enqueue(const Request& request)
+{
+	RequestID id;
+	{
+		std::lock_guard<std::mutex> lock{ m_mutex };
+		assert(!m_stopping && "Can't enqueue request after streamer started stopping");
+		id = m_nextID++;
+		m_waitingRequests.emplace(id, WaitingRequest{ request, false, {}, 0.0 });
+		m_outstanding.fetch_add(1, std::memory_order_release);
+	}
+
+	// Request is queued for decoding once its file is read - with priority it has at that time
+	m_reader.Read(request.path, [this, id](AsyncFileReader::Result& result) {
+		{
+			std::lock_guard<std::mutex> lock{ m_mutex };
+			WaitingRequest& waiting = m_waitingRequests.at(id);
+			waiting.read = true;
+			waiting.data = std::move(result.data);
+			waiting.readTime = result.readTime;
+			m_queue.Push(id, waiting.request.priority);
+		}
+		m_condition.notify_one();
+	});
+	return id;
+}
+
+void TextureStreamer::UpdatePriority(RequestID id, float priority)
+{
+	std::lock_guard<std::mutex> lock{ m_mutex };
+	const auto it = m_waitingRequests.find(id);
+	if (it == m_waitingRequests.end() || it->second.request.priority == priority) {
+		return;
+	}
+
+	// Request still being read is queued with its new priority once read
+	it->second.request.priority = priority;
+	if (it->second.read) {
+		m_queue.UpdatePriority(id, priority);
+	}
+}
+
+bool TextureStreamer::TryPopCompletion(Completion& completion)
+{
+	if (!m_completions.TryPop(completion)) {
+		return false;
+	}
+	m_outstanding.fetch_sub(1, std::memory_order_acq_rel);
+	return true;
+}
+
+bool TextureStreamer::WaitCompletion(Completion& completion)
+{
+	while (GetOutstandingCount() > 0)
+	{
+		if (TryPopCompletion(completion)) {
+			return true;
+		}
+
+		// Producer may be between its two stores in Push, so wait is bounded instead of relying only on notification
+		std::unique_lock<std::mutex> lock{ m_completionMutex };
+		m_completionCondition.wait_for(lock, std::chrono::milliseconds(1), [this]() { return !m_completions.IsEmpty(); });
+	}
+	return false;
+}
+
+void TextureStreamer::WorkerLoop()
+{
+	// WIC decoder is COM based
+	const HRESULT comResult = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+
+	while (true)
+	{
+		RequestID id;
+		WaitingRequest request;
+		{
+			std::unique_lock<std::mutex> lock{ m_mutex };
+			m_condition.wait(lock, [this]() { return m_stopping || !m_queue.IsEmpty(); });
+			if (m_stopping) {
+				break;
+			}
+
+			// Every queued request has heap entry with its current priority, so non-empty queue always pops one
+			m_queue.Pop(id);
+
+			const auto it = m_waitingRequests.find(id);
+			assert(it != m_waitingRequests.end() && "Queued request has to be waiting");
+			request = std::move(it->second);
+			m_waitingRequests.erase(it);
+		}
+
+		const auto startTime = std::chrono::high_resolution_clock::now();
+		Completion completion;
+		completion.id = id;
+		completion.path = request.request.path;
+		completion.image = Decode(request.data, request.request.forceDDS);
+		completion.readTime = request.readTime;
+		const std::chrono::duration<double, std::milli> decodeTime = std::chrono::high_resolution_clock::now() - startTime;
+		completion.decodeTime = decodeTime.count();
+
+		m_completions.Push(std::move(completion));
+		{
+			std::lock_guard<std::mutex> lock{ m_completionMutex };
+		}
+		m_completionCondition.notify_one();
+	}
+
+	if (SUCCEEDED(comResult)) {
+		CoUninitialize();
+	}
+}
+
+std::unique_ptr<DirectX::ScratchImage> TextureStreamer::Decode(const std::string& path, bool forceDDS)
+{
+	std::vector<uint8_t> data;
+	if (!ImageDecoder::LoadFile(path, data)) {
+		return nullptr;
+	}
+	return Decode(data, forceDDS);
+}
+
+std::unique_ptr<DirectX::ScratchImage> TextureStreamer::Decode(const std::vector<uint8_t>& data, bool forceDDS)
+{
+	if (data.empty()) {
+		return nullptr;
+	}
+
+	// Portable decoder first - DirectXTex only handles files it doesn't support, like progressive JPEG
+	ImageDecoder::Info info;
+	if (ImageDecoder::ReadInfo(data.data(), data.size(), info))
+	{
+		std::unique_ptr<DirectX::ScratchImage> image = std::make_unique<DirectX::ScratchImage>();
+		if (FAILED(image->Initialize(ToMetadata(info)))) {
+			return nullptr;
+		}
+
+		// ScratchImage keeps its images in D3D12 subresource order too
+		std::vector<ImageDecoder::Subresource> subresources(image->GetImageCount());
+		for (size_t i = 0; i < subresources.size(); ++i)
+		{
+			const DirectX::Image& subresource = image->GetImages()[i];
+			subresources[i] = { static_cast<size_t>(subresource.pixels - image->GetPixels()), subresource.rowPitch };
+		}
+		if (!ImageDecoder::Decode(data.data(), data.size(), info, image->GetPixels(), subresources.data())) {
+			return nullptr;
+		}
+		return image;
+	}
+
+	std::unique_ptr<DirectX::ScratchImage> image = std::make_unique<DirectX::ScratchImage>();
+	const HRESULT result = forceDDS ?
+		DirectX::LoadFromDDSMemory(data.data(), data.size(), DirectX::DDS_FLAGS_NONE, nullptr, *image) :
+		DirectX::LoadFromWICMemory(data.data(), data.size(), DirectX::WIC_FLAGS_FORCE_RGB, nullptr, *image);
+	if (FAILED(result) || image->GetImageCount() == 0) {
+		return nullptr;
+	}
+	return image;
+}
+
+bool TextureStreamer::GetMetadata(const std::string& path, bool forceDDS, DirectX::TexMetadata& metadata)
+{
+	// Reads only file header, so resource can be created before image is decoded - JPEG with large Exif block needs more than the prefix
+	constexpr size_t HEADER_PREFIX_SIZE = 64 * 1024;
+	std::vector<uint8_t> data;
+	ImageDecoder::Info info;
+	if (ImageDecoder::LoadFile(path, data, HEADER_PREFIX_SIZE))
+	{
+		bool hasInfo = ImageDecoder::ReadInfo(data.data(), data.size(), info);
+		if (!hasInfo && data.size() == HEADER_PREFIX_SIZE && ImageDecoder::LoadFile(path, data)) {
+			hasInfo = ImageDecoder::ReadInfo(data.data(), data.size(), info);
+		}
+		if (hasInfo) {
+			metadata = ToMetadata(info);
+			return true;
+		}
+	}
+
+	const std::string s = std::regex_replace(path, std::regex("\\\\"), "/");
+	const std::wstring ws(s.begin(), s.end());
+	const HRESULT result = forceDDS ?
+		DirectX::GetMetadataFromDDSFile(ws.c_str(), DirectX::DDS_FLAGS_NONE, metadata) :
+		DirectX::GetMetadataFromWICFile(ws.c_str(), DirectX::WIC_FLAGS_FORCE_RGB, metadata);
+	return SUCCEEDED(result);
+}
+
+ComPtr<ID3D12Resource> TextureStreamer::DecodeToUploadHeap(ID3D12Device* device, const std::string& path, ComPtr<ID3D12Resource>& uploadHeap)
+{
+	std::vector<uint8_t> data;
+	ImageDecoder::Info info;
+	if (!ImageDecoder::LoadFile(path, data) || !ImageDecoder::ReadInfo(data.data(), data.size(), info)) {
+		return nullptr;
+	}
+
+	ComPtr<ID3D12Resource> texture = CreateTexture(device, ToMetadata(info));
+	const D3D12_RESOURCE_DESC textureDesc = texture->GetDesc();
+	const UINT subresourceCount = info.mipLevels * info.arraySize;
+	std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> footprints(subresourceCount);
+	UINT64 uploadBufferSize = 0;
+	device->GetCopyableFootprints(&textureDesc, 0, subresourceCount, 0, footprints.data(), nullptr, nullptr, &uploadBufferSize);
+
+	ThrowIfFailed(device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(uploadBufferSize),
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&uploadHeap)
+	));
+
+	std::vector<ImageDecoder::Subresource> subresources(subresourceCount);
+	for (UINT i = 0; i < subresourceCount; ++i)
+	{
+		subresources[i] = { static_cast<size_t>(footprints[i].Offset), footprints[i].Footprint.RowPitch };
+	}
+
+	// Upload heap is write combined - decoder writes every row once and never reads it back
+	uint8_t* mapped = nullptr;
+	const CD3DX12_RANGE readRange(0, 0);
+	ThrowIfFailed(uploadHeap->Map(0, &readRange, reinterpret_cast<void**>(&mapped)));
+	const bool decoded = ImageDecoder::Decode(data.data(), data.size(), info, mapped, subresources.data());
+	uploadHeap->Unmap(0, nullptr);
+	if (!decoded) {
+		uploadHeap.Reset();
+		return nullptr;
+	}
+	return texture;
+}
+
+void TextureStreamer::RecordCopy(ID3D12Device* device, ID3D12GraphicsCommandList* commandList, ID3D12Resource* texture, ID3D12Resource* uploadHeap)
+{
+	const D3D12_RESOURCE_DESC textureDesc = texture->GetDesc();
+	const UINT subresourceCount = textureDesc.MipLevels * textureDesc.DepthOrArraySize;
+	std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> footprints(subresourceCount);
+	device->GetCopyableFootprints(&textureDesc, 0, subresourceCount, 0, footprints.data(), nullptr, nullptr, nullptr);
+
+	for (UINT i = 0; i < subresourceCount; ++i)
+	{
+		const CD3DX12_TEXTURE_COPY_LOCATION dst(texture, i);
+		const CD3DX12_TEXTURE_COPY_LOCATION src(uploadHeap, footprints[i]);
+		commandList->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+	}
+}
+
+ComPtr<ID3D12Resource> TextureStreamer::CreateTexture(ID3D12Device* device, const DirectX::TexMetadata& metadata, D3D12_RESOURCE_STATES initialState)
+{
+	const D3D12_RESOURCE_DESC textureDesc = CD3DX12_RESOURCE_DESC::Tex2D(metadata.format, metadata.width, static_cast<UINT>(metadata.height), static_cast<UINT16>(metadata.arraySize), static_cast<UINT16>(metadata.mipLevels));
+	ComPtr<ID3D12Resource> texture;
+	ThrowIfFailed(device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+		D3D12_HEAP_FLAG_NONE,
+		&textureDesc,
+		initialState,
+		nullptr,
+		IID_PPV_ARGS(&texture)
+	));
+	return texture;
+}
+
+void TextureStreamer::RecordUpload(ID3D12Device* device, ID3D12GraphicsCommandList* commandList, ID3D12Resource* texture, const DirectX::ScratchImage& image, ComPtr<ID3D12Resource>& uploadHeap)
+{
+	const D3D12_RESOURCE_DESC textureDesc = texture->GetDesc();
+	const DirectX::Image* top = image.GetImage(0, 0, 0);
+	assert(top && "Decoded image has no top mip");
+	assert(top->width == textureDesc.Width && top->height == textureDesc.Height && image.GetMetadata().mipLevels == textureDesc.MipLevels && image.GetMetadata().arraySize == textureDesc.DepthOrArraySize &&
+		"Decoded image doesn't match texture created from its metadata");
+	const UINT subresourceCount = textureDesc.MipLevels * textureDesc.DepthOrArraySize;
+
+	ThrowIfFailed(device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(GetRequiredIntermediateSize(texture, 0, subresourceCount)),
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&uploadHeap)
+	));
+
+	std::vector<D3D12_SUBRESOURCE_DATA> subresourceData(subresourceCount);
+	for (UINT item = 0; item < textureDesc.DepthOrArraySize; ++item)
+	{
+		for (UINT mip = 0; mip < textureDesc.MipLevels; ++mip)
+		{
+			const DirectX::Image* mipImage = image.GetImage(mip, item, 0);
+			D3D12_SUBRESOURCE_DATA& data = subresourceData[mip + item * textureDesc.MipLevels];
+			data.pData = mipImage->pixels;
+			data.RowPitch = static_cast<LONG_PTR>(mipImage->rowPitch);
+			data.SlicePitch = static_cast<LONG_PTR>(mipImage->slicePitch);
+		}
+	}
+	UpdateSubresources(commandList, texture, uploadHeap.Get(), 0, 0, subresourceCount, subresourceData.data());
+}
+
+ComPtr<ID3D12Resource> TextureStreamer::CreatePlaceholder(ID3D12Device* device, ID3D12GraphicsCommandList* commandList, UINT32 rgba, ComPtr<ID3D12Resource>& uploadHeap)
+{
+	DirectX::ScratchImage image;
+	ThrowIfFailed(image.Initialize2D(DXGI_FORMAT_R8G8B8A8_UNORM, 1, 1, 1, 1));
+	memcpy(image.GetPixels(), &rgba, sizeof(UINT32));
+
+	ComPtr<ID3D12Resource> texture = CreateTexture(device, image.GetMetadata());
+	RecordUpload(device, commandList, texture.Get(), image, uploadHeap);
+	return texture;
+}
+
+AsyncFileReader::Settings TextureStreamer::GetReaderSettings()
+{
+	// Callback only hands data over to workers, decoding runs on them
+	AsyncFileReader::Settings settings;
+	settings.callbackThreadCount = 1;
+	return settings;
+}
+
+DirectX::TexMetadata TextureStreamer::ToMetadata(const ImageDecoder::Info& info)
+{
+	DirectX::TexMetadata metadata = {};
+	metadata.width = info.width;
+	metadata.height = info.height;
+	metadata.depth = 1;
+	metadata.arraySize = info.arraySize;
+	metadata.mipLevels = info.mipLevels;
+	metadata.miscFlags = info.cubemap ? DirectX::TEX_MISC_TEXTURECUBE : 0;
+	metadata.format = static_cast<DXGI_FORMAT>(info.format);
+	metadata.dimension = DirectX::TEX_DIMENSION_TEXTURE2D;
+	return metadata;
+}
+
+void TextureStreamer::BenchmarkDecode(const std::vector<std::string>& paths, unsigned int maxWorkerCount)
+{
+	std::vector<unsigned int> workerCounts;
+	for (unsigned int workerCount = 1; workerCount < maxWorkerCount; workerCount *= 2)
+	{
+		workerCounts.push_back(workerCount);
+	}
+	workerCounts.push_back(maxWorkerCount);
+
+	// DDS is decided by extension here, model loading decides it by texture slot
+	auto isDDS = [](const std::string& path) {
+		return path.size() >= 4 && _stricmp(path.c_str() + path.size() - 4, ".dds") == 0;
+	};
+
+	double serialTime = 0.0;
+	for (unsigned int workerCount : workerCounts)
+	{
+		const auto startTime = std::chrono::high_resolution_clock::now();
+		size_t decodedCount = 0;
+		size_t decodedBytes = 0;
+		{
+			TextureStreamer streamer{ workerCount };
+			for (const std::string& path : paths)
+			{
+				streamer.Enqueue({ path, 0.0f, isDDS(path) });
+			}
+
+			Completion completion;
+			while (streamer.WaitCompletion(completion))
+			{
+				if (completion.image) {
+					++decodedCount;
+					decodedBytes += completion.image->GetPixelsSize();
+				}
+			}
+		}
+		const std::chrono::duration<double, std::milli> decodeTime = std::chrono::high_resolution_clock::now() - startTime;
+
+		if (workerCount == 1) {
+			serialTime = decodeTime.count();
+		}
+		LogDebugRTCP("TextureStreamer: decode benchmark - %zu/%zu textures (%.1f MB), %2u workers: %8.2f ms (%.1f textures/s, speedup x%.2f)\n", decodedCount, paths.size(),
+			decodedBytes / (1024.0 * 1024.0), workerCount, decodeTime.count(), decodedCount * 1000.0 / decodeTime.count(), serialTime / decodeTime.count());
+	}
+}
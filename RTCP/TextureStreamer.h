@@ -0,0 +1,116 @@
+#pragma once
+#ifndef _TEXTURE_STREAMER_H_
+#define _TEXTURE_STREAMER_H_
+
+#include "pch.h"
+#include "LockFreeQueue.h"
+#include "RequestQueue.h"
+#include "AsyncFileReader.h"
+#include "ImageDecoder.h"
+#include <DirectXTex.h>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Decodes texture files on bounded pool of worker threads, most important requests first.
+// Files are read in batches by AsyncFileReader as soon as they are enqueued, workers pick the most important request whose file was already read.
+// Decoding is CPU only (ImageDecoder, DirectXTex for files it doesn't support), so streamer doesn't need D3D12 device - consumer creates
+// resources and records uploads of completed images, which are delivered through lock-free queue.
+class TextureStreamer
+{
+public:
+	typedef RequestQueue::RequestID RequestID;
+
+	struct Request {
+		std::string path;
+		float priority;		// Higher is decoded first - e.g. screen coverage or triangle count of meshes using the texture
+		bool forceDDS;
+	};
+
+	struct Completion {
+		RequestID id;
+		std::string path;
+		std::unique_ptr<DirectX::ScratchImage> image;	// Null if file couldn't be decoded
+		double readTime;								// Milliseconds from request to its last byte read
+		double decodeTime;								// Milliseconds
+	};
+
+	// workerCount == 0 creates one worker per hardware thread
+	explicit TextureStreamer(unsigned int workerCount = 0);
+	// Requests not yet decoded are dropped
+	~TextureStreamer();
+	TextureStreamer(const TextureStreamer&) = delete;
+	TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+	// Thread safe
+	RequestID Enqueue(const Request& request);
+	// Reorders request still being read or waiting in queue - has no effect once its decoding started
+	void UpdatePriority(RequestID id, float priority);
+
+	// Consumer side, single thread only - TryPopCompletion never blocks, WaitCompletion blocks until next completion
+	// and returns false if every enqueued request was already popped
+	bool TryPopCompletion(Completion& completion);
+	bool WaitCompletion(Completion& completion);
+	size_t GetOutstandingCount() const { return m_outstanding.load(std::memory_order_acquire); }
+	unsigned int GetWorkerCount() const { return static_cast<unsigned int>(m_workers.size()); }
+
+	// Synchronous decoding, workers decode files already read into memory - PNG and JPEG images are decoded as RGBA.
+	// File type is detected from its content, forceDDS only picks DirectXTex loader for files ImageDecoder can't read
+	static std::unique_ptr<DirectX::ScratchImage> Decode(const std::string& path, bool forceDDS);
+	static std::unique_ptr<DirectX::ScratchImage> Decode(const std::vector<uint8_t>& data, bool forceDDS);
+	static bool GetMetadata(const std::string& path, bool forceDDS, DirectX::TexMetadata& metadata);
+	// Decodes file straight into upload heap laid out for new texture, without intermediate image - returns null if ImageDecoder can't read the file
+	static ComPtr<ID3D12Resource> DecodeToUploadHeap(ID3D12Device* device, const std::string& path, ComPtr<ID3D12Resource>& uploadHeap);
+	// Records copy of every subresource filled by DecodeToUploadHeap
+	static void RecordCopy(ID3D12Device* device, ID3D12GraphicsCommandList* commandList, ID3D12Resource* texture, ID3D12Resource* uploadHeap);
+
+	// Creates 2D texture (array) with all mips of decoded image, ready to be written by RecordUpload unless other initial state is given
+	static ComPtr<ID3D12Resource> CreateTexture(ID3D12Device* device, const DirectX::TexMetadata& metadata, D3D12_RESOURCE_STATES initialState = D3D12_RESOURCE_STATE_COPY_DEST);
+	// Records upload of every mip and array item of image into texture - upload heap has to live until command list is executed
+	static void RecordUpload(ID3D12Device* device, ID3D12GraphicsCommandList* commandList, ID3D12Resource* texture, const DirectX::ScratchImage& image, ComPtr<ID3D12Resource>& uploadHeap);
+	// 1x1 RGBA texture of given color, used in place of files which can't be read
+	static ComPtr<ID3D12Resource> CreatePlaceholder(ID3D12Device* device, ID3D12GraphicsCommandList* commandList, UINT32 rgba, ComPtr<ID3D12Resource>& uploadHeap);
+
+	// Headless benchmark - decodes given files with 1 to maxWorkerCount workers and logs throughput
+	static void BenchmarkDecode(const std::vector<std::string>& paths, unsigned int maxWorkerCount);
+
+private:
+	struct WaitingRequest {
+		Request request;
+		bool read;					// Request is pushed into the queue once file is read
+		std::vector<uint8_t> data;	// Empty if file couldn't be read
+		double readTime;
+	};
+
+	void WorkerLoop();
+
+	static AsyncFileReader::Settings GetReaderSettings();
+	static DirectX::TexMetadata ToMetadata(const ImageDecoder::Info& info);
+
+private:
+	std::vector<std::thread> m_workers;
+
+	// Waiting requests - equal priorities are decoded in request order, not in order their reads finished
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	RequestQueue m_queue;
+	std::unordered_map<RequestID, WaitingRequest> m_waitingRequests;
+	RequestID m_nextID = 0;
+	bool m_stopping = false;
+
+	// Completed requests - mutex only guards sleeping of consumer, not the queue itself
+	LockFreeQueue<Completion> m_completions;
+	std::mutex m_completionMutex;
+	std::condition_variable m_completionCondition;
+	std::atomic<size_t> m_outstanding{ 0 };
+
+	// Destroyed first - it waits for reads in flight, whose callbacks push into the queue above
+	AsyncFileReader m_reader;
+};
+
+#endif // !_TEXTURE_STREAMER_H_
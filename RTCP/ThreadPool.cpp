@@ -0,0 +1,92 @@
+#include "ThreadPool.h"
+#include <atomic>
+
+ThreadPool::ThreadPool(unsigned int threadCount)
+{
+	if (threadCount == 0) {
+		threadCount = GetDefaultThreadCount();
+	}
+
+	m_workers.reserve(threadCount);
+	for (unsigned int i = 0; i < threadCount; ++i)
+	{
+		m_workers.emplace_back(&ThreadPool::WorkerLoop, this);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock{ m_mutex };
+		m_stopping = true;
+	}
+	m_condition.notify_all();
+
+	for (std::thread& worker : m_workers)
+	{
+		worker.join();
+	}
+}
+
+void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t)>& func, size_t chunkSize)
+{
+	if (count == 0) {
+		return;
+	}
+	chunkSize = std::max<size_t>(chunkSize, 1);
+
+	// Workers pull chunks from shared counter, so uneven work (e.g. meshes of different size) is balanced automatically
+	auto nextIndex = std::make_shared<std::atomic<size_t>>(0);
+	const size_t chunkCount = (count + chunkSize - 1) / chunkSize;
+	const size_t taskCount = std::min<size_t>(chunkCount, m_workers.size());
+
+	std::vector<std::future<void>> results;
+	results.reserve(taskCount);
+	for (size_t i = 0; i < taskCount; ++i)
+	{
+		results.push_back(Enqueue([nextIndex, count, chunkSize, &func]()
+		{
+			for (size_t begin = nextIndex->fetch_add(chunkSize); begin < count; begin = nextIndex->fetch_add(chunkSize))
+			{
+				const size_t end = std::min(begin + chunkSize, count);
+				for (size_t j = begin; j < end; ++j)
+				{
+					func(j);
+				}
+			}
+		}));
+	}
+
+	// Every task references func, so all of them have to finish before first exception is rethrown
+	for (std::future<void>& result : results)
+	{
+		result.wait();
+	}
+	for (std::future<void>& result : results)
+	{
+		result.get();
+	}
+}
+
+unsigned int ThreadPool::GetDefaultThreadCount()
+{
+	return std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+void ThreadPool::WorkerLoop()
+{
+	while (true)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock{ m_mutex };
+			m_condition.wait(lock, [this]() { return m_stopping || !m_tasks.empty(); });
+			if (m_stopping && m_tasks.empty()) {
+				return;
+			}
+			task = std::move(m_tasks.front());
+			m_tasks.pop();
+		}
+		task();
+	}
+}
@@ -0,0 +1,61 @@
+#pragma once
+#ifndef _THREAD_POOL_H_
+#define _THREAD_POOL_H_
+
+#include "pch.h"
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// Fixed size pool of worker threads used by CPU heavy asset processing
+class ThreadPool
+{
+public:
+	// threadCount == 0 creates one worker per hardware thread
+	explicit ThreadPool(unsigned int threadCount = 0);
+	~ThreadPool();
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// Queues single task, exceptions thrown by task are rethrown by future::get()
+	template<typename Func>
+	auto Enqueue(Func&& func) -> std::future<decltype(func())>;
+
+	// Calls func(i) for every i in [0, count) and waits for all calls to finish - first exception is rethrown on calling thread
+	void ParallelFor(size_t count, const std::function<void(size_t)>& func, size_t chunkSize = 1);
+
+	unsigned int GetThreadCount() const { return static_cast<unsigned int>(m_workers.size()); }
+	static unsigned int GetDefaultThreadCount();
+
+private:
+	void WorkerLoop();
+
+private:
+	std::vector<std::thread> m_workers;
+	std::queue<std::function<void()>> m_tasks;
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	bool m_stopping = false;
+};
+
+template<typename Func>
+auto ThreadPool::Enqueue(Func&& func) -> std::future<decltype(func())>
+{
+	// std::function requires copyable target, so packaged task is shared
+	auto task = std::make_shared<std::packaged_task<decltype(func())()>>(std::forward<Func>(func));
+	std::future<decltype(func())> result = task->get_future();
+	{
+		std::lock_guard<std::mutex> lock{ m_mutex };
+		assert(!m_stopping && "Can't enqueue task after thread pool started stopping");
+		m_tasks.emplace([task]() { (*task)(); });
+	}
+	m_condition.notify_one();
+	return result;
+}
+
+#endif // !_THREAD_POOL_H_
@@ -0,0 +1,330 @@
+#include "TraversalSimulator.h"
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+
+template <class Visit>
+float TraversalSimulator::TraceRay(const std::vector<Node>& nodes, const std::vector<uint32_t>& primitives, const uint32_t* indices, const float* positions, size_t vertexStride,
+	const float origin[3], const float direction[3], uint32_t& closestTriangle, Visit visit)
+{
+	auto getPosition = [positions, vertexStride](uint32_t vertex)
+	{
+		return reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(positions) + vertex * vertexStride);
+	};
+
+	float inverseDirection[3];
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		inverseDirection[axis] = std::fabs(direction[axis]) > 1e-12f ? 1.0f / direction[axis] : (direction[axis] < 0.0f ? -FLT_MAX : FLT_MAX);
+	}
+
+	// Closest hit - nearer child is visited first, far one is culled by current hit distance when popped
+	float closest = FLT_MAX;
+	uint32_t stack[MAX_STACK_DEPTH];
+	size_t stackSize = 0;
+	stack[stackSize++] = 0;
+	while (stackSize > 0)
+	{
+		const Node& node = nodes[stack[--stackSize]];
+		float entry;
+		if (!IntersectBox(node, origin, inverseDirection, closest, entry)) {
+			continue;
+		}
+
+		if (node.count > 0)
+		{
+			for (uint32_t i = node.first; i < node.first + node.count; ++i)
+			{
+				const uint32_t triangle = primitives[i];
+				const uint32_t* triangleIndices = indices + triangle * 3;
+				visit(triangle);
+
+				float distance;
+				if (IntersectTriangle(getPosition(triangleIndices[0]), getPosition(triangleIndices[1]), getPosition(triangleIndices[2]), origin, direction, closest, distance)) {
+					closest = distance;
+					closestTriangle = triangle;
+				}
+			}
+			continue;
+		}
+
+		const uint32_t left = static_cast<uint32_t>(&node - nodes.data()) + 1;
+		const uint32_t right = node.first;
+		float leftEntry = FLT_MAX;
+		float rightEntry = FLT_MAX;
+		const bool leftHit = IntersectBox(nodes[left], origin, inverseDirection, closest, leftEntry);
+		const bool rightHit = IntersectBox(nodes[right], origin, inverseDirection, closest, rightEntry);
+		assert(stackSize + 2 <= MAX_STACK_DEPTH && "Traversal stack overflow");
+		if (leftHit && rightHit)
+		{
+			stack[stackSize++] = leftEntry <= rightEntry ? right : left;
+			stack[stackSize++] = leftEntry <= rightEntry ? left : right;
+		}
+		else if (leftHit || rightHit)
+		{
+			stack[stackSize++] = leftHit ? left : right;
+		}
+	}
+	return closest;
+}
+
+TraversalSimulator::Statistics TraversalSimulator::Simulate(const uint32_t* indices, size_t indexCount, const float* positions, size_t vertexCount, size_t vertexStride, const Settings& settings)
+{
+	Statistics statistics;
+	std::vector<Node> nodes;
+	std::vector<uint32_t> primitives;
+	float sceneMinimum[3];
+	float sceneMaximum[3];
+	if (settings.rayCount == 0 || !BuildBvh(indices, indexCount, positions, vertexCount, vertexStride, settings.leafSize, nodes, primitives, sceneMinimum, sceneMaximum)) {
+		return statistics;
+	}
+
+	Cache cache{ settings.cacheSize, settings.cacheLineSize, settings.cacheWays };
+	const uint64_t layoutStride = settings.splitStreams ? static_cast<uint64_t>(POSITION_SIZE) : static_cast<uint64_t>(settings.layoutVertexStride > 0 ? settings.layoutVertexStride : vertexStride);
+	const float origin[3] = { (sceneMinimum[0] + sceneMaximum[0]) * 0.5f, (sceneMinimum[1] + sceneMaximum[1]) * 0.5f, (sceneMinimum[2] + sceneMaximum[2]) * 0.5f };
+	const size_t width = std::max<size_t>(static_cast<size_t>(std::sqrt(static_cast<double>(settings.rayCount) * 2.0)), 1);
+	const size_t height = std::max<size_t>(settings.rayCount / width, 1);
+	const float pi = 3.14159265f;
+	for (size_t y = 0; y < height; ++y)
+	{
+		const float theta = pi * (y + 0.5f) / height;
+		for (size_t x = 0; x < width; ++x)
+		{
+			const float phi = 2.0f * pi * (x + 0.5f) / width;
+			const float direction[3] = { std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi) };
+			uint32_t closestTriangle = 0;
+			const float closest = TraceRay(nodes, primitives, indices, positions, vertexStride, origin, direction, closestTriangle, [&](uint32_t triangle)
+			{
+				const uint32_t* triangleIndices = indices + triangle * 3;
+				statistics.cacheMisses += cache.Access(sizeof(uint32_t) * 3 * static_cast<uint64_t>(triangle), sizeof(uint32_t) * 3, statistics.cacheAccesses);
+				for (int corner = 0; corner < 3; ++corner)
+				{
+					statistics.cacheMisses += cache.Access(VERTEX_BUFFER_ADDRESS + layoutStride * triangleIndices[corner], POSITION_SIZE, statistics.cacheAccesses);
+				}
+				++statistics.triangleTests;
+			});
+
+			++statistics.rayCount;
+			if (closest < FLT_MAX)
+			{
+				++statistics.hitCount;
+				// Hit shading reads attributes only once traversal is done
+				for (int corner = 0; corner < 3 && settings.attributeSize > 0; ++corner)
+				{
+					const uint64_t vertex = indices[closestTriangle * 3 + corner];
+					const uint64_t address = settings.splitStreams ? ATTRIBUTE_BUFFER_ADDRESS + settings.attributeSize * vertex : VERTEX_BUFFER_ADDRESS + layoutStride * vertex + POSITION_SIZE;
+					statistics.shadingMisses += cache.Access(address, settings.attributeSize, statistics.shadingAccesses);
+				}
+			}
+		}
+	}
+
+	statistics.missRate = statistics.cacheAccesses > 0 ? static_cast<float>(statistics.cacheMisses) / statistics.cacheAccesses : 0.0f;
+	statistics.missesPerRay = statistics.rayCount > 0 ? static_cast<float>(statistics.cacheMisses) / statistics.rayCount : 0.0f;
+	statistics.bytesPerRay = statistics.rayCount > 0 ? static_cast<float>((statistics.cacheAccesses + statistics.shadingAccesses) * settings.cacheLineSize) / statistics.rayCount : 0.0f;
+	statistics.missedBytesPerRay = statistics.rayCount > 0 ? static_cast<float>((statistics.cacheMisses + statistics.shadingMisses) * settings.cacheLineSize) / statistics.rayCount : 0.0f;
+	return statistics;
+}
+
+size_t TraversalSimulator::CastRays(const uint32_t* indices, size_t indexCount, const float* positions, size_t vertexCount, size_t vertexStride, const float* rays, size_t rayCount, size_t leafSize, float* distances)
+{
+	std::vector<Node> nodes;
+	std::vector<uint32_t> primitives;
+	float sceneMinimum[3];
+	float sceneMaximum[3];
+	if (!BuildBvh(indices, indexCount, positions, vertexCount, vertexStride, leafSize, nodes, primitives, sceneMinimum, sceneMaximum))
+	{
+		std::fill(distances, distances + rayCount, FLT_MAX);
+		return 0;
+	}
+
+	for (size_t i = 0; i < rayCount; ++i)
+	{
+		uint32_t closestTriangle = 0;
+		distances[i] = TraceRay(nodes, primitives, indices, positions, vertexStride, rays + i * 6, rays + i * 6 + 3, closestTriangle, [](uint32_t) {});
+	}
+	return nodes.size();
+}
+
+bool TraversalSimulator::BuildBvh(const uint32_t* indices, size_t indexCount, const float* positions, size_t vertexCount, size_t vertexStride, size_t leafSize,
+	std::vector<Node>& nodes, std::vector<uint32_t>& primitives, float sceneMinimum[3], float sceneMaximum[3])
+{
+	assert(indexCount % 3 == 0 && "Index count has to be multiple of 3");
+	const size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0) {
+		return false;
+	}
+
+	auto getPosition = [positions, vertexStride](uint32_t vertex)
+	{
+		return reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(positions) + vertex * vertexStride);
+	};
+
+	// Per triangle bounds followed by centroid - 9 floats
+	std::vector<float> bounds(triangleCount * 9);
+	primitives.resize(triangleCount);
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		sceneMinimum[axis] = FLT_MAX;
+		sceneMaximum[axis] = -FLT_MAX;
+	}
+	for (size_t i = 0; i < triangleCount; ++i)
+	{
+		assert(indices[i * 3] < vertexCount && indices[i * 3 + 1] < vertexCount && indices[i * 3 + 2] < vertexCount && "Index out of range");
+		const float* a = getPosition(indices[i * 3]);
+		const float* b = getPosition(indices[i * 3 + 1]);
+		const float* c = getPosition(indices[i * 3 + 2]);
+		float* triangleBounds = &bounds[i * 9];
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			triangleBounds[axis] = std::min(std::min(a[axis], b[axis]), c[axis]);
+			triangleBounds[3 + axis] = std::max(std::max(a[axis], b[axis]), c[axis]);
+			triangleBounds[6 + axis] = (a[axis] + b[axis] + c[axis]) / 3.0f;
+			sceneMinimum[axis] = std::min(sceneMinimum[axis], triangleBounds[axis]);
+			sceneMaximum[axis] = std::max(sceneMaximum[axis], triangleBounds[3 + axis]);
+		}
+		primitives[i] = static_cast<uint32_t>(i);
+	}
+
+	nodes.clear();
+	nodes.reserve(triangleCount * 2 / std::max<size_t>(leafSize, 1));
+	BuildNode(nodes, primitives, bounds, 0, static_cast<uint32_t>(triangleCount), std::max<size_t>(leafSize, 1));
+	return true;
+}
+
+uint32_t TraversalSimulator::BuildNode(std::vector<Node>& nodes, std::vector<uint32_t>& primitives, const std::vector<float>& bounds, uint32_t first, uint32_t count, size_t leafSize)
+{
+	const uint32_t nodeIndex = static_cast<uint32_t>(nodes.size());
+	nodes.push_back({});
+
+	Node node = {};
+	float centroidMinimum[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+	float centroidMaximum[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		node.minimum[axis] = FLT_MAX;
+		node.maximum[axis] = -FLT_MAX;
+	}
+	for (uint32_t i = first; i < first + count; ++i)
+	{
+		const float* primitiveBounds = &bounds[primitives[i] * 9];
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			node.minimum[axis] = std::min(node.minimum[axis], primitiveBounds[axis]);
+			node.maximum[axis] = std::max(node.maximum[axis], primitiveBounds[3 + axis]);
+			centroidMinimum[axis] = std::min(centroidMinimum[axis], primitiveBounds[6 + axis]);
+			centroidMaximum[axis] = std::max(centroidMaximum[axis], primitiveBounds[6 + axis]);
+		}
+	}
+
+	if (count <= leafSize)
+	{
+		node.first = first;
+		node.count = count;
+		nodes[nodeIndex] = node;
+		return nodeIndex;
+	}
+
+	// Median split along the longest centroid axis, ties are broken by triangle index to keep build deterministic
+	int splitAxis = 0;
+	for (int axis = 1; axis < 3; ++axis)
+	{
+		if (centroidMaximum[axis] - centroidMinimum[axis] > centroidMaximum[splitAxis] - centroidMinimum[splitAxis]) {
+			splitAxis = axis;
+		}
+	}
+	const uint32_t middle = first + count / 2;
+	std::nth_element(primitives.begin() + first, primitives.begin() + middle, primitives.begin() + first + count, [&bounds, splitAxis](uint32_t a, uint32_t b)
+	{
+		const float centroidA = bounds[a * 9 + 6 + splitAxis];
+		const float centroidB = bounds[b * 9 + 6 + splitAxis];
+		return centroidA < centroidB || (centroidA == centroidB && a < b);
+	});
+
+	BuildNode(nodes, primitives, bounds, first, middle - first, leafSize);
+	node.first = BuildNode(nodes, primitives, bounds, middle, first + count - middle, leafSize);
+	node.count = 0;
+	nodes[nodeIndex] = node;
+	return nodeIndex;
+}
+
+bool TraversalSimulator::IntersectBox(const Node& node, const float origin[3], const float inverseDirection[3], float maxDistance, float& distance)
+{
+	// Slab test
+	float entry = 0.0f;
+	float exit = maxDistance;
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		float t0 = (node.minimum[axis] - origin[axis]) * inverseDirection[axis];
+		float t1 = (node.maximum[axis] - origin[axis]) * inverseDirection[axis];
+		if (t0 > t1) {
+			std::swap(t0, t1);
+		}
+		entry = std::max(entry, t0);
+		exit = std::min(exit, t1);
+	}
+	distance = entry;
+	return entry <= exit;
+}
+
+bool TraversalSimulator::IntersectTriangle(const float* a, const float* b, const float* c, const float origin[3], const float direction[3], float maxDistance, float& distance)
+{
+	// Moller-Trumbore, both faces
+	const float edge1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+	const float edge2[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+	const float p[3] = { direction[1] * edge2[2] - direction[2] * edge2[1], direction[2] * edge2[0] - direction[0] * edge2[2], direction[0] * edge2[1] - direction[1] * edge2[0] };
+	const float determinant = edge1[0] * p[0] + edge1[1] * p[1] + edge1[2] * p[2];
+	if (std::fabs(determinant) < 1e-12f) {
+		return false;
+	}
+
+	const float inverseDeterminant = 1.0f / determinant;
+	const float s[3] = { origin[0] - a[0], origin[1] - a[1], origin[2] - a[2] };
+	const float u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) * inverseDeterminant;
+	if (u < 0.0f || u > 1.0f) {
+		return false;
+	}
+	const float q[3] = { s[1] * edge1[2] - s[2] * edge1[1], s[2] * edge1[0] - s[0] * edge1[2], s[0] * edge1[1] - s[1] * edge1[0] };
+	const float v = (direction[0] * q[0] + direction[1] * q[1] + direction[2] * q[2]) * inverseDeterminant;
+	if (v < 0.0f || u + v > 1.0f) {
+		return false;
+	}
+	const float t = (edge2[0] * q[0] + edge2[1] * q[1] + edge2[2] * q[2]) * inverseDeterminant;
+	if (t <= 0.0f || t >= maxDistance) {
+		return false;
+	}
+	distance = t;
+	return true;
+}
+
+TraversalSimulator::Cache::Cache(size_t size, size_t lineSize, size_t ways)
+	: m_setCount(std::max<size_t>(size / std::max<size_t>(lineSize * ways, 1), 1)), m_lineSize(std::max<size_t>(lineSize, 1)), m_ways(std::max<size_t>(ways, 1))
+{
+	m_tags.assign(m_setCount * m_ways, UINT64_MAX);
+}
+
+size_t TraversalSimulator::Cache::Access(uint64_t address, size_t size, size_t& accessedLines)
+{
+	size_t misses = 0;
+	const uint64_t lastLine = (address + size - 1) / m_lineSize;
+	for (uint64_t line = address / m_lineSize; line <= lastLine; ++line)
+	{
+		uint64_t* set = &m_tags[(line % m_setCount) * m_ways];
+		size_t way = 0;
+		while (way < m_ways && set[way] != line)
+		{
+			++way;
+		}
+		if (way == m_ways)
+		{
+			// Least recently used line is evicted
+			++misses;
+			way = m_ways - 1;
+		}
+		std::copy_backward(set, set + way, set + way + 1);
+		set[0] = line;
+		++accessedLines;
+	}
+	return misses;
+}
@@ -0,0 +1,91 @@
+#pragma once
+#ifndef _TRAVERSAL_SIMULATOR_H_
+#define _TRAVERSAL_SIMULATOR_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// CPU model of ray traversal over indexed triangle list, used to measure memory locality of triangle order. Doesn't depend on Windows or D3D12 headers, like MeshOptimizer.
+// BVH is built from centroids only, so it's the same for any triangle order - what differs is where leaf triangles live in index and vertex buffers.
+// Every triangle test fetches its 3 indices and 3 positions through simulated set associative LRU cache, BVH nodes aren't counted.
+// Closest hit can also fetch shading attributes of its 3 vertices, either interleaved after position or from separate attribute stream.
+class TraversalSimulator
+{
+public:
+	struct Settings {
+		// Closest hit rays in scanline order over panorama from center of geometry bounds, so neighbouring rays are coherent like primary rays
+		size_t rayCount = 256 * 256;
+		size_t cacheSize = 64 * 1024;
+		size_t cacheLineSize = 64;
+		size_t cacheWays = 8;
+		size_t leafSize = 4;
+		// Simulated vertex layout - positions are always read vertexStride apart, addresses follow this layout.
+		// Interleaved vertex is layoutVertexStride bytes (0 uses vertexStride) with position first, split streams store positions 12 bytes apart.
+		size_t layoutVertexStride = 0;
+		bool splitStreams = false;
+		// Attribute bytes fetched for every vertex of closest hit, 0 skips shading fetch
+		size_t attributeSize = 0;
+	};
+
+	struct Statistics {
+		size_t rayCount = 0;
+		size_t hitCount = 0;
+		size_t triangleTests = 0;
+		size_t cacheAccesses = 0;		// Cache lines touched by triangle fetches
+		size_t cacheMisses = 0;
+		size_t shadingAccesses = 0;		// Cache lines touched by attribute fetches of closest hits
+		size_t shadingMisses = 0;
+		float missRate = 0.0f;			// Triangle fetches only
+		float missesPerRay = 0.0f;
+		float bytesPerRay = 0.0f;		// Cache lines touched by triangle and attribute fetches
+		float missedBytesPerRay = 0.0f;	// Lines missed by triangle and attribute fetches - memory traffic
+	};
+
+	// Indices are global to positions, vertexStride is distance between vertices in bytes - used for both position reads and simulated addresses
+	static Statistics Simulate(const uint32_t* indices, size_t indexCount, const float* positions, size_t vertexCount, size_t vertexStride, const Settings& settings);
+	// Closest hit distance of every ray through the same BVH, FLT_MAX if ray misses - no cache simulation, reference for other intersection routines.
+	// rays holds origin and direction of every ray (6 floats), returns number of BVH nodes.
+	static size_t CastRays(const uint32_t* indices, size_t indexCount, const float* positions, size_t vertexCount, size_t vertexStride, const float* rays, size_t rayCount, size_t leafSize, float* distances);
+
+private:
+	struct Node {
+		float minimum[3];
+		float maximum[3];
+		uint32_t first;			// Right child for inner node (left child follows node), first primitive for leaf
+		uint32_t count;			// 0 for inner node
+	};
+
+	// Set associative cache of line tags, every set ordered from most to least recently used
+	class Cache
+	{
+	public:
+		Cache(size_t size, size_t lineSize, size_t ways);
+		// Returns number of missed lines of [address, address + size)
+		size_t Access(uint64_t address, size_t size, size_t& accessedLines);
+
+	private:
+		std::vector<uint64_t> m_tags;
+		size_t m_setCount;
+		size_t m_lineSize;
+		size_t m_ways;
+	};
+
+	// Builds BVH over all triangles, primitives are triangle indices in leaf order - returns false if there are no triangles
+	static bool BuildBvh(const uint32_t* indices, size_t indexCount, const float* positions, size_t vertexCount, size_t vertexStride, size_t leafSize,
+		std::vector<Node>& nodes, std::vector<uint32_t>& primitives, float sceneMinimum[3], float sceneMaximum[3]);
+	// Closest hit distance of single ray, FLT_MAX if it misses - visit is called with every tested triangle
+	template <class Visit>
+	static float TraceRay(const std::vector<Node>& nodes, const std::vector<uint32_t>& primitives, const uint32_t* indices, const float* positions, size_t vertexStride,
+		const float origin[3], const float direction[3], uint32_t& closestTriangle, Visit visit);
+	static uint32_t BuildNode(std::vector<Node>& nodes, std::vector<uint32_t>& primitives, const std::vector<float>& bounds, uint32_t first, uint32_t count, size_t leafSize);
+	static bool IntersectBox(const Node& node, const float origin[3], const float inverseDirection[3], float maxDistance, float& distance);
+	static bool IntersectTriangle(const float* a, const float* b, const float* c, const float origin[3], const float direction[3], float maxDistance, float& distance);
+
+	static constexpr uint64_t VERTEX_BUFFER_ADDRESS = 1ull << 40;
+	static constexpr uint64_t ATTRIBUTE_BUFFER_ADDRESS = 1ull << 41;
+	static constexpr size_t POSITION_SIZE = 3 * sizeof(float);
+	static constexpr size_t MAX_STACK_DEPTH = 64;
+};
+
+#endif // !_TRAVERSAL_SIMULATOR_H_
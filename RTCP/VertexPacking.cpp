@@ -0,0 +1,195 @@
+#include "VertexPacking.h"
+
+void VertexPacking::Encode(const ModelClass::VertexBufferStruct* vertices, size_t count, PackedVertex* packed)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		// Vertex is built on stack and written once, so write-combined destination is filled sequentially
+		PackedVertex vertex;
+		vertex.position = vertices[i].position;
+		vertex.attributes = EncodeAttributes(vertices[i]);
+		packed[i] = vertex;
+	}
+}
+
+void VertexPacking::Encode(const ModelClass::VertexBufferStruct* vertices, size_t count, const BoundingBox& bounds, PackedVertexQuantized* packed)
+{
+	const XMVECTOR center = XMLoadFloat3(&bounds.Center);
+	const XMVECTOR invExtents = XMVectorReciprocal(GetQuantizationExtents(bounds));
+	for (size_t i = 0; i < count; ++i)
+	{
+		PackedVertexQuantized vertex;
+		XMStoreShortN4(&vertex.position, XMVectorMultiply(XMVectorSubtract(XMLoadFloat3(&vertices[i].position), center), invExtents));
+		vertex.attributes = EncodeAttributes(vertices[i]);
+		packed[i] = vertex;
+	}
+}
+
+void VertexPacking::EncodePositions(const ModelClass::VertexBufferStruct* vertices, size_t count, const BoundingBox& bounds, XMSHORTN4* positions)
+{
+	const XMVECTOR center = XMLoadFloat3(&bounds.Center);
+	const XMVECTOR invExtents = XMVectorReciprocal(GetQuantizationExtents(bounds));
+	for (size_t i = 0; i < count; ++i)
+	{
+		XMSHORTN4 position;
+		XMStoreShortN4(&position, XMVectorMultiply(XMVectorSubtract(XMLoadFloat3(&vertices[i].position), center), invExtents));
+		positions[i] = position;
+	}
+}
+
+void VertexPacking::EncodeAttributes(const ModelClass::VertexBufferStruct* vertices, size_t count, PackedVertexAttributes* attributes)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		attributes[i] = EncodeAttributes(vertices[i]);
+	}
+}
+
+void VertexPacking::Decode(const PackedVertex* packed, size_t count, ModelClass::VertexBufferStruct* vertices)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		vertices[i].position = packed[i].position;
+		DecodeAttributes(packed[i].attributes, vertices[i]);
+	}
+}
+
+void VertexPacking::Decode(const PackedVertexQuantized* packed, size_t count, const BoundingBox& bounds, ModelClass::VertexBufferStruct* vertices)
+{
+	const XMVECTOR center = XMLoadFloat3(&bounds.Center);
+	const XMVECTOR extents = GetQuantizationExtents(bounds);
+	for (size_t i = 0; i < count; ++i)
+	{
+		XMStoreFloat3(&vertices[i].position, XMVectorMultiplyAdd(XMLoadShortN4(&packed[i].position), extents, center));
+		DecodeAttributes(packed[i].attributes, vertices[i]);
+	}
+}
+
+VertexPacking::RoundTripError VertexPacking::MeasureRoundTripError(const ModelClass::VertexBufferStruct* vertices, size_t count, VertexFormat format, const BoundingBox& bounds)
+{
+	auto angleDegrees = [](FXMVECTOR a, FXMVECTOR b)
+	{
+		const float cosAngle = XMVectorGetX(XMVector3Dot(XMVector3Normalize(a), XMVector3Normalize(b)));
+		return XMConvertToDegrees(std::acos(std::min(std::max(cosAngle, -1.0f), 1.0f)));
+	};
+
+	RoundTripError error{};
+	for (size_t i = 0; i < count; ++i)
+	{
+		const ModelClass::VertexBufferStruct& vertex = vertices[i];
+		ModelClass::VertexBufferStruct decoded;
+		if (format == VertexFormat::PackedQuantizedPosition) {
+			PackedVertexQuantized packed;
+			Encode(&vertex, 1, bounds, &packed);
+			Decode(&packed, 1, bounds, &decoded);
+		}
+		else {
+			PackedVertex packed;
+			Encode(&vertex, 1, &packed);
+			Decode(&packed, 1, &decoded);
+		}
+
+		const XMVECTOR normal = XMLoadFloat3(&vertex.normal);
+		const XMVECTOR tangent = XMLoadFloat3(&vertex.tangent);
+		const XMVECTOR binormal = XMLoadFloat3(&vertex.binormal);
+		error.position = std::max(error.position, XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&vertex.position), XMLoadFloat3(&decoded.position)))));
+		error.uv = std::max(error.uv, XMVectorGetX(XMVector2Length(XMVectorSubtract(XMLoadFloat2(&vertex.uv), XMLoadFloat2(&decoded.uv)))));
+
+		// Angles are meaningless for missing tangent frame
+		if (XMVector3Equal(normal, XMVectorZero()) || XMVector3Equal(tangent, XMVectorZero()) || XMVector3Equal(binormal, XMVectorZero())) {
+			error.degenerateVertices++;
+			continue;
+		}
+		error.normal = std::max(error.normal, angleDegrees(normal, XMLoadFloat3(&decoded.normal)));
+		error.tangent = std::max(error.tangent, angleDegrees(tangent, XMLoadFloat3(&decoded.tangent)));
+		// Bitangent is rebuilt perpendicular to normal and tangent, compare with orthogonalized input
+		const XMVECTOR expectedBinormal = XMVectorMultiply(XMVector3Cross(normal, tangent), XMVectorGetX(XMVector3Dot(XMVector3Cross(normal, tangent), binormal)) < 0.0f ? XMVectorNegate(XMVectorSplatOne()) : XMVectorSplatOne());
+		error.binormal = std::max(error.binormal, angleDegrees(expectedBinormal, XMLoadFloat3(&decoded.binormal)));
+	}
+	return error;
+}
+
+std::array<float, 12> VertexPacking::GetDequantizeTransform(const BoundingBox& bounds)
+{
+	XMFLOAT3 extents;
+	XMStoreFloat3(&extents, GetQuantizationExtents(bounds));
+	return {
+		extents.x, 0.0f, 0.0f, bounds.Center.x,
+		0.0f, extents.y, 0.0f, bounds.Center.y,
+		0.0f, 0.0f, extents.z, bounds.Center.z
+	};
+}
+
+UINT32 VertexPacking::EncodeOctahedral(FXMVECTOR vector)
+{
+	// Project on octahedron |x| + |y| + |z| = 1, lower hemisphere is folded over the diagonals
+	const XMVECTOR l1Norm = XMVector3Dot(XMVectorAbs(vector), XMVectorSplatOne());
+	if (XMVectorGetX(l1Norm) <= 0.0f) {
+		return 0;
+	}
+
+	XMVECTOR octahedral = XMVectorDivide(vector, l1Norm);
+	if (XMVectorGetZ(octahedral) < 0.0f)
+	{
+		const XMVECTOR signs = XMVectorSelect(XMVectorNegate(XMVectorSplatOne()), XMVectorSplatOne(), XMVectorGreaterOrEqual(octahedral, XMVectorZero()));
+		const XMVECTOR swapped = XMVectorSwizzle<XM_SWIZZLE_Y, XM_SWIZZLE_X, XM_SWIZZLE_Z, XM_SWIZZLE_W>(octahedral);
+		octahedral = XMVectorMultiply(XMVectorSubtract(XMVectorSplatOne(), XMVectorAbs(swapped)), signs);
+	}
+
+	XMSHORTN2 packed;
+	XMStoreShortN2(&packed, octahedral);
+	return packed.v;
+}
+
+XMVECTOR VertexPacking::DecodeOctahedral(UINT32 packed)
+{
+	XMSHORTN2 encoded;
+	encoded.v = packed;
+	XMVECTOR octahedral = XMLoadShortN2(&encoded);
+
+	// Unfold lower hemisphere without branches
+	const XMVECTOR absolute = XMVectorAbs(octahedral);
+	const XMVECTOR z = XMVectorSubtract(XMVectorSplatOne(), XMVectorAdd(XMVectorSplatX(absolute), XMVectorSplatY(absolute)));
+	const XMVECTOR fold = XMVectorMax(XMVectorNegate(z), XMVectorZero());
+	octahedral = XMVectorAdd(octahedral, XMVectorSelect(fold, XMVectorNegate(fold), XMVectorGreaterOrEqual(octahedral, XMVectorZero())));
+	octahedral = XMVectorSetZ(octahedral, XMVectorGetX(z));
+	return XMVector3Normalize(octahedral);
+}
+
+PackedVertexAttributes VertexPacking::EncodeAttributes(const ModelClass::VertexBufferStruct& vertex)
+{
+	const XMVECTOR normal = XMLoadFloat3(&vertex.normal);
+	const XMVECTOR tangent = XMLoadFloat3(&vertex.tangent);
+	const XMVECTOR binormal = XMLoadFloat3(&vertex.binormal);
+	const bool negativeBinormal = XMVectorGetX(XMVector3Dot(XMVector3Cross(normal, tangent), binormal)) < 0.0f;
+
+	XMHALF2 uv;
+	XMStoreHalf2(&uv, XMLoadFloat2(&vertex.uv));
+
+	PackedVertexAttributes attributes;
+	attributes.normal = EncodeOctahedral(normal);
+	attributes.tangent = (EncodeOctahedral(tangent) & ~1u) | (negativeBinormal ? 1u : 0u);
+	attributes.uv = uv.v;
+	return attributes;
+}
+
+void VertexPacking::DecodeAttributes(const PackedVertexAttributes& attributes, ModelClass::VertexBufferStruct& vertex)
+{
+	const XMVECTOR normal = DecodeOctahedral(attributes.normal);
+	const XMVECTOR tangent = DecodeOctahedral(attributes.tangent & ~1u);
+	const XMVECTOR binormal = XMVector3Cross(normal, tangent);
+
+	XMHALF2 uv;
+	uv.v = attributes.uv;
+
+	XMStoreFloat3(&vertex.normal, normal);
+	XMStoreFloat3(&vertex.tangent, tangent);
+	XMStoreFloat3(&vertex.binormal, (attributes.tangent & 1u) ? XMVectorNegate(binormal) : binormal);
+	XMStoreFloat2(&vertex.uv, XMLoadHalf2(&uv));
+}
+
+XMVECTOR VertexPacking::GetQuantizationExtents(const BoundingBox& bounds)
+{
+	// Flat models would divide by zero
+	return XMVectorMax(XMLoadFloat3(&bounds.Extents), XMVectorReplicate(1e-6f));
+}
@@ -0,0 +1,70 @@
+#pragma once
+#ifndef _VERTEX_PACKING_H_
+#define _VERTEX_PACKING_H_
+
+#include "pch.h"
+#include "ModelClass.h"
+#include <DirectXCollision.h>
+#include <DirectXPackedVector.h>
+
+using namespace DirectX::PackedVector;
+
+// Compact vertex layouts read by raytracing shaders - mirrored by Vertex struct in ALL_CommonBuffers.hlsl (VERTEX_FORMAT define).
+// Normal and tangent are octahedral encoded, bitangent is rebuilt as cross(normal, tangent) * sign.
+struct PackedVertexAttributes {
+	UINT32 normal;							// Octahedral, 2x snorm16
+	UINT32 tangent;							// Octahedral, 2x snorm16 - lowest bit stores negative bitangent sign
+	UINT32 uv;								// 2x half
+};
+
+struct PackedVertex {
+	XMFLOAT3 position;
+	PackedVertexAttributes attributes;
+};
+
+// Position is stored as snorm16 relative to model bounds, dequantized by BLAS geometry transform
+struct PackedVertexQuantized {
+	XMSHORTN4 position;
+	PackedVertexAttributes attributes;
+};
+
+static_assert(sizeof(PackedVertex) == 24, "PackedVertex has to match Vertex layout in ALL_CommonBuffers.hlsl");
+static_assert(sizeof(PackedVertexQuantized) == 20, "PackedVertexQuantized has to match Vertex layout in ALL_CommonBuffers.hlsl");
+
+class VertexPacking
+{
+public:
+	// Maximal error after encoding and decoding, normal/tangent/binormal errors are in degrees
+	struct RoundTripError {
+		float position = 0.0f;
+		float normal = 0.0f;
+		float tangent = 0.0f;
+		float binormal = 0.0f;
+		float uv = 0.0f;
+		size_t degenerateVertices = 0; // Zero length normal or tangent, skipped by measurement
+	};
+
+	// Batch encoding/decoding - destination may be write-combined upload heap memory, it's never read back
+	static void Encode(const ModelClass::VertexBufferStruct* vertices, size_t count, PackedVertex* packed);
+	static void Encode(const ModelClass::VertexBufferStruct* vertices, size_t count, const BoundingBox& bounds, PackedVertexQuantized* packed);
+	static void Decode(const PackedVertex* packed, size_t count, ModelClass::VertexBufferStruct* vertices);
+	static void Decode(const PackedVertexQuantized* packed, size_t count, const BoundingBox& bounds, ModelClass::VertexBufferStruct* vertices);
+	// Split streams - quantized positions and packed attributes are written to separate buffers, in the same order as vertices
+	static void EncodePositions(const ModelClass::VertexBufferStruct* vertices, size_t count, const BoundingBox& bounds, XMSHORTN4* positions);
+	static void EncodeAttributes(const ModelClass::VertexBufferStruct* vertices, size_t count, PackedVertexAttributes* attributes);
+
+	static RoundTripError MeasureRoundTripError(const ModelClass::VertexBufferStruct* vertices, size_t count, VertexFormat format, const BoundingBox& bounds);
+
+	// Row major 3x4 matrix, expanding quantized positions back to model space (D3D12 BLAS Transform3x4 layout)
+	static std::array<float, 12> GetDequantizeTransform(const BoundingBox& bounds);
+
+	static UINT32 EncodeOctahedral(FXMVECTOR vector);
+	static XMVECTOR DecodeOctahedral(UINT32 packed);
+
+private:
+	static PackedVertexAttributes EncodeAttributes(const ModelClass::VertexBufferStruct& vertex);
+	static void DecodeAttributes(const PackedVertexAttributes& attributes, ModelClass::VertexBufferStruct& vertex);
+	static XMVECTOR GetQuantizationExtents(const BoundingBox& bounds);
+};
+
+#endif // !_VERTEX_PACKING_H_